@@ -14,16 +14,33 @@
  *                Basic I/O primitives                                  *
  ************************************************************************/
 
+/* Messages smaller than this are sent uncompressed, deflating
+ * them does not win anything. */
+#define DEFLATE_MIN_SIZE 128
+
+/* Most bytes we send are node ops, which compress well, and png
+ * textures, which don't compress at all, so favour speed. */
+#define DEFLATE_LEVEL 1
+
 struct BroadwayOutput {
   GOutputStream *out;
   GString *buf;
   int error;
   guint32 serial;
+
+  /* permessage-deflate, the compression context is kept across
+   * messages, so once a message went through it, it must be sent
+   * compressed. */
+  GConverter *compressor;
+  GByteArray *compressed;
+
+  BroadwayOutputStats stats;
 };
 
 static void
 broadway_output_send_cmd (BroadwayOutput *output,
                           gboolean fin, BroadwayWSOpCode code,
+                          gboolean compressed,
                           const void *buf, gsize count)
 {
   gboolean mask = FALSE;
@@ -34,7 +51,7 @@ broadway_output_send_cmd (BroadwayOutput *output,
   gboolean long_header = count > 65535;
 
   /* NB. big-endian spec => bit 0 == MSB */
-  header[0] = ( (fin ? 0x80 : 0) | (code & 0x0f) );
+  header[0] = ( (fin ? 0x80 : 0) | (compressed ? 0x40 : 0) | (code & 0x0f) );
   header[1] = ( (mask ? 0x80 : 0) |
                 (mid_header ? 126 : long_header ? 127 : count) );
   p = 2;
@@ -52,11 +69,68 @@ broadway_output_send_cmd (BroadwayOutput *output,
   // FIXME: we should really emit these as a single write
   g_output_stream_write_all (output->out, header, p, NULL, NULL, NULL);
   g_output_stream_write_all (output->out, buf, count, NULL, NULL, NULL);
+
+  output->stats.sent_bytes += p + count;
 }
 
 void broadway_output_pong (BroadwayOutput *output)
 {
-  broadway_output_send_cmd (output, TRUE, BROADWAY_WS_CNX_PONG, NULL, 0);
+  broadway_output_send_cmd (output, TRUE, BROADWAY_WS_CNX_PONG, FALSE, NULL, 0);
+}
+
+/* Deflates the buffer into output->compressed, as described in
+ * RFC 7692: a sync flush, minus the trailing 0x00 0x00 0xff 0xff. */
+static gboolean
+deflate_buffer (BroadwayOutput *output)
+{
+  const guint8 *in = (const guint8 *) output->buf->str;
+  gsize in_left = output->buf->len;
+  gsize used = 0;
+
+  while (TRUE)
+    {
+      GConverterResult res;
+      gsize bytes_read, bytes_written, space;
+      GError *error = NULL;
+
+      space = MAX (in_left / 2, 4096);
+      g_byte_array_set_size (output->compressed, used + space);
+
+      res = g_converter_convert (output->compressor,
+                                 in, in_left,
+                                 output->compressed->data + used, space,
+                                 G_CONVERTER_FLUSH,
+                                 &bytes_read, &bytes_written,
+                                 &error);
+      if (res == G_CONVERTER_ERROR)
+        {
+          if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE))
+            {
+              g_error_free (error);
+              continue;
+            }
+
+          g_warning ("Failed to compress output: %s", error->message);
+          g_error_free (error);
+          return FALSE;
+        }
+
+      in += bytes_read;
+      in_left -= bytes_read;
+      used += bytes_written;
+
+      /* The flush is complete once deflate leaves room in the buffer */
+      if (res == G_CONVERTER_FLUSHED ||
+          (in_left == 0 && bytes_written < space))
+        break;
+    }
+
+  if (used >= 4)
+    used -= 4;
+
+  g_byte_array_set_size (output->compressed, used);
+
+  return TRUE;
 }
 
 int
@@ -65,8 +139,20 @@ broadway_output_flush (BroadwayOutput *output)
   if (output->buf->len == 0)
     return TRUE;
 
-  broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
-                            output->buf->str, output->buf->len);
+  output->stats.raw_bytes += output->buf->len;
+
+  if (output->compressor != NULL &&
+      output->buf->len >= DEFLATE_MIN_SIZE)
+    {
+      if (!deflate_buffer (output))
+        output->error = TRUE;
+      else
+        broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY, TRUE,
+                                  output->compressed->data, output->compressed->len);
+    }
+  else
+    broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY, FALSE,
+                              output->buf->str, output->buf->len);
 
   g_string_set_size (output->buf, 0);
 
@@ -74,6 +160,26 @@ broadway_output_flush (BroadwayOutput *output)
 
 }
 
+/* Called when the client accepted permessage-deflate */
+void
+broadway_output_enable_compression (BroadwayOutput *output)
+{
+  if (output->compressor != NULL)
+    return;
+
+  output->compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, DEFLATE_LEVEL));
+  output->compressed = g_byte_array_new ();
+}
+
+/* Returns the counters since the last call, and resets them */
+void
+broadway_output_take_stats (BroadwayOutput      *output,
+                            BroadwayOutputStats *stats)
+{
+  *stats = output->stats;
+  memset (&output->stats, 0, sizeof (BroadwayOutputStats));
+}
+
 BroadwayOutput *
 broadway_output_new (GOutputStream *out, guint32 serial)
 {
@@ -92,6 +198,8 @@ void
 broadway_output_free (BroadwayOutput *output)
 {
   g_object_unref (output->out);
+  g_clear_object (&output->compressor);
+  g_clear_pointer (&output->compressed, g_byte_array_unref);
   free (output);
 }
 
@@ -597,6 +705,9 @@ broadway_output_surface_set_nodes (BroadwayOutput *output,
     append_node_removes (output, old_root);
   end = output->buf->len;
   patch_uint32 (output, (end - start) / 4, size_pos);
+
+  output->stats.n_frames++;
+  output->stats.node_bytes += end - start;
 }
 
 void
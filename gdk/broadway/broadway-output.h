@@ -17,11 +17,21 @@ typedef enum {
   BROADWAY_WS_CNX_PONG = 0xa
 } BroadwayWSOpCode;
 
+typedef struct {
+  guint n_frames;      /* set_nodes messages */
+  guint64 node_bytes;  /* bytes of node ops in them */
+  guint64 raw_bytes;   /* bytes of all messages, before compression */
+  guint64 sent_bytes;  /* bytes written to the socket */
+} BroadwayOutputStats;
+
 BroadwayOutput *broadway_output_new                 (GOutputStream  *out,
                                                      guint32         serial);
 void            broadway_output_free                (BroadwayOutput *output);
 int             broadway_output_flush               (BroadwayOutput *output);
 int             broadway_output_has_error           (BroadwayOutput *output);
+void            broadway_output_enable_compression  (BroadwayOutput *output);
+void            broadway_output_take_stats          (BroadwayOutput *output,
+                                                     BroadwayOutputStats *stats);
 void            broadway_output_set_next_serial     (BroadwayOutput *output,
                                                      guint32         serial);
 guint32         broadway_output_get_next_serial     (BroadwayOutput *output);
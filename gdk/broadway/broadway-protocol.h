@@ -23,6 +23,7 @@ typedef enum { /* Sync changes with broadway.js */
   BROADWAY_NODE_TRANSFORM = 11,
   BROADWAY_NODE_DEBUG = 12,
   BROADWAY_NODE_REUSE = 13,
+  BROADWAY_NODE_GLYPHS = 14,
 } BroadwayNodeType;
 
 typedef enum { /* Sync changes with broadway.js */
@@ -48,6 +49,7 @@ static const char *broadway_node_type_names[] G_GNUC_UNUSED =  {
   "TRANSFORM",
   "DEBUG",
   "REUSE",
+  "GLYPHS",
 };
 
 typedef enum {
@@ -39,8 +39,14 @@
 typedef struct {
   int id;
   guint32 tag;
+  gint64 time;
 } BroadwayOutstandingRoundtrip;
 
+/* If the browser takes longer than this to acknowledge a frame,
+ * we stop sending it every new node tree, and only send the most
+ * recent one when it caught up. */
+#define COALESCE_LATENCY (100 * 1000)
+
 typedef struct BroadwayInput BroadwayInput;
 typedef struct BroadwaySurface BroadwaySurface;
 struct _BroadwayServer {
@@ -88,6 +94,10 @@ struct _BroadwayServer {
   int future_mouse_in_surface;
 
   GList *outstanding_roundtrips;
+
+  gboolean disable_compression;
+  guint stats_timeout;
+  guint n_coalesced_frames;
 };
 
 struct _BroadwayServerClass
@@ -112,6 +122,7 @@ struct BroadwayInput {
   gboolean seen_time;
   gint64 time_base;
   gboolean active;
+  GConverter *decompressor;
 };
 
 struct BroadwaySurface {
@@ -126,6 +137,10 @@ struct BroadwaySurface {
   guint32 texture;
   BroadwayNode *nodes;
   GHashTable *node_lookup;
+  /* Newer nodes than the ones the browser has, held back
+   * while it is behind */
+  BroadwayNode *pending_nodes;
+  GHashTable *pending_node_lookup;
 };
 
 struct _BroadwayTexture {
@@ -136,6 +151,7 @@ struct _BroadwayTexture {
 
 static void broadway_server_resync_surfaces (BroadwayServer *server);
 static void send_outstanding_roundtrips (BroadwayServer *server);
+static void send_pending_nodes (BroadwayServer *server);
 
 static void broadway_server_ref_texture (BroadwayServer   *server,
                                          guint32           id);
@@ -288,6 +304,8 @@ broadway_server_finalize (GObject *object)
   g_free (server->ssl_cert);
   g_free (server->ssl_key);
   g_hash_table_destroy (server->textures);
+  if (server->stats_timeout)
+    g_source_remove (server->stats_timeout);
 
   G_OBJECT_CLASS (broadway_server_parent_class)->finalize (object);
 }
@@ -306,7 +324,10 @@ broadway_surface_free (BroadwayServer *server,
 {
   if (surface->nodes)
     broadway_node_unref (server, surface->nodes);
+  if (surface->pending_nodes)
+    broadway_node_unref (server, surface->pending_nodes);
   g_hash_table_unref (surface->node_lookup);
+  g_hash_table_unref (surface->pending_node_lookup);
   g_free (surface);
 }
 
@@ -334,6 +355,7 @@ static void
 broadway_input_free (BroadwayInput *input)
 {
   g_object_unref (input->connection);
+  g_clear_object (&input->decompressor);
   g_byte_array_free (input->buffer, FALSE);
   g_source_destroy (input->source);
   g_free (input);
@@ -718,6 +740,8 @@ parse_input_message (BroadwayInput *input, const unsigned char *message)
         g_free (rt);
       }
 
+    send_pending_nodes (server);
+
     break;
 
   case BROADWAY_EVENT_SCREEN_SIZE_CHANGED:
@@ -763,6 +787,74 @@ hex_dump (guchar *data, gsize len)
 #endif
 }
 
+/* Inflates a message compressed with permessage-deflate, see RFC 7692 */
+static GByteArray *
+inflate_message (BroadwayInput *input,
+                 const guchar  *data,
+                 gsize          len)
+{
+  static const guchar tail[] = { 0x00, 0x00, 0xff, 0xff };
+  GByteArray *in, *out;
+  gsize pos, used;
+
+  in = g_byte_array_sized_new (len + sizeof (tail));
+  g_byte_array_append (in, data, len);
+  g_byte_array_append (in, tail, sizeof (tail));
+
+  out = g_byte_array_new ();
+  pos = 0;
+  used = 0;
+
+  while (TRUE)
+    {
+      GConverterResult res;
+      gsize bytes_read, bytes_written, space = 1024;
+      GError *error = NULL;
+
+      g_byte_array_set_size (out, used + space);
+
+      res = g_converter_convert (input->decompressor,
+                                 in->data + pos, in->len - pos,
+                                 out->data + used, space,
+                                 G_CONVERTER_NO_FLAGS,
+                                 &bytes_read, &bytes_written,
+                                 &error);
+      if (res == G_CONVERTER_ERROR)
+        {
+          if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE))
+            {
+              g_error_free (error);
+              continue;
+            }
+
+          if (pos == in->len &&
+              g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT))
+            {
+              g_error_free (error);
+              break;
+            }
+
+          g_warning ("Failed to inflate input: %s", error->message);
+          g_error_free (error);
+          g_byte_array_unref (in);
+          g_byte_array_unref (out);
+          return NULL;
+        }
+
+      pos += bytes_read;
+      used += bytes_written;
+
+      if (res == G_CONVERTER_FINISHED ||
+          (pos == in->len && bytes_written < space))
+        break;
+    }
+
+  g_byte_array_set_size (out, used);
+  g_byte_array_unref (in);
+
+  return out;
+}
+
 static void
 parse_input (BroadwayInput *input)
 {
@@ -775,7 +867,7 @@ parse_input (BroadwayInput *input)
     {
       gsize len, payload_len;
       BroadwayWSOpCode code;
-      gboolean is_mask, fin;
+      gboolean is_mask, fin, compressed;
       guchar *buf, *data, *mask;
 
       buf = input->buffer->data;
@@ -786,6 +878,7 @@ parse_input (BroadwayInput *input)
 #endif
 
       fin = buf[0] & 0x80;
+      compressed = buf[0] & 0x40;
       code = buf[0] & 0x0f;
       payload_len = buf[1] & 0x7f;
       is_mask = buf[1] & 0x80;
@@ -835,6 +928,16 @@ parse_input (BroadwayInput *input)
             g_warning ("can't yet accept fragmented input");
 #endif
           }
+        else if (compressed && input->decompressor)
+          {
+            GByteArray *message = inflate_message (input, data, payload_len);
+
+            if (message)
+              {
+                parse_input_message (input, message->data);
+                g_byte_array_unref (message);
+              }
+          }
         else
           {
             parse_input_message (input, data);
@@ -1009,6 +1112,7 @@ broadway_server_roundtrip (BroadwayServer *server,
       BroadwayOutstandingRoundtrip *rt = g_new0 (BroadwayOutstandingRoundtrip, 1);
       rt->id = id;
       rt->tag = tag;
+      rt->time = g_get_monotonic_time ();
       server->outstanding_roundtrips = g_list_prepend (server->outstanding_roundtrips, rt);
 
       broadway_output_roundtrip (server->output, id, tag);
@@ -1090,6 +1194,7 @@ start_input (HttpRequest *request)
   int i;
   char *res;
   const char *origin, *host;
+  gboolean deflate;
   BroadwayInput *input;
   const void *data_buffer;
   gsize data_buffer_size;
@@ -1106,6 +1211,7 @@ start_input (HttpRequest *request)
   key = NULL;
   origin = NULL;
   host = NULL;
+  deflate = FALSE;
   for (i = 0; lines[i] != NULL; i++)
     {
       if ((p = parse_line (lines[i], "Sec-WebSocket-Key")))
@@ -1116,8 +1222,13 @@ start_input (HttpRequest *request)
         host = p;
       else if ((p = parse_line (lines[i], "Sec-WebSocket-Origin")))
         origin = p;
+      else if ((p = parse_line (lines[i], "Sec-WebSocket-Extensions")))
+        deflate |= strstr (p, "permessage-deflate") != NULL;
     }
 
+  if (request->server->disable_compression)
+    deflate = FALSE;
+
   if (host == NULL)
     {
       g_strfreev (lines);
@@ -1135,9 +1246,11 @@ start_input (HttpRequest *request)
                              "%s%s%s"
                              "Sec-WebSocket-Location: ws://%s/socket\r\n"
                              "Sec-WebSocket-Protocol: broadway\r\n"
+                             "%s"
                              "\r\n", accept,
                              origin?"Sec-WebSocket-Origin: ":"", origin?origin:"", origin?"\r\n":"",
-                             host);
+                             host,
+                             deflate?"Sec-WebSocket-Extensions: permessage-deflate\r\n":"");
       g_free (accept);
 
 #ifdef DEBUG_WEBSOCKETS
@@ -1170,6 +1283,12 @@ start_input (HttpRequest *request)
   input->output =
     broadway_output_new (g_io_stream_get_output_stream (request->connection), 0);
 
+  if (deflate)
+    {
+      input->decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+      broadway_output_enable_compression (input->output);
+    }
+
   /* This will free and close the data input stream, but we got all the buffered content already */
   http_request_free (request);
 
@@ -1674,6 +1793,48 @@ broadway_server_set_show_keyboard (BroadwayServer *server,
     }
 }
 
+void
+broadway_server_set_compression (BroadwayServer *server,
+                                 gboolean        compression)
+{
+  server->disable_compression = !compression;
+}
+
+static gboolean
+print_stats_cb (gpointer data)
+{
+  BroadwayServer *server = data;
+  BroadwayOutputStats stats = { 0, };
+
+  if (server->output)
+    broadway_output_take_stats (server->output, &stats);
+
+  if (stats.n_frames > 0)
+    g_print ("%u frames (%u coalesced): %" G_GUINT64_FORMAT " bytes of nodes per frame, "
+             "%" G_GUINT64_FORMAT " bytes sent per frame (%" G_GUINT64_FORMAT " uncompressed)\n",
+             stats.n_frames, server->n_coalesced_frames,
+             stats.node_bytes / stats.n_frames,
+             stats.sent_bytes / stats.n_frames,
+             stats.raw_bytes / stats.n_frames);
+
+  server->n_coalesced_frames = 0;
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Prints the bytes sent per frame every interval seconds */
+void
+broadway_server_set_stats_interval (BroadwayServer *server,
+                                    guint           interval)
+{
+  if (server->stats_timeout)
+    g_source_remove (server->stats_timeout);
+  server->stats_timeout = 0;
+
+  if (interval > 0)
+    server->stats_timeout = g_timeout_add_seconds (interval, print_stats_cb, server);
+}
+
 void
 broadway_server_surface_lower (BroadwayServer *server,
                                int id)
@@ -1725,6 +1886,7 @@ broadway_server_has_client (BroadwayServer *server)
 #define NODE_SIZE_RRECT (NODE_SIZE_RECT + 4 * NODE_SIZE_SIZE)
 #define NODE_SIZE_COLOR_STOP (NODE_SIZE_FLOAT + NODE_SIZE_COLOR)
 #define NODE_SIZE_SHADOW (NODE_SIZE_COLOR + 3 * NODE_SIZE_FLOAT)
+#define NODE_SIZE_GLYPH (NODE_SIZE_POINT + 2)
 
 static guint32
 rotl (guint32 value, int shift)
@@ -1744,7 +1906,7 @@ decode_nodes (BroadwayServer *server,
 {
   BroadwayNode *node;
   guint32 type, id;
-  guint32 i, n_stops, n_shadows, n_chars;
+  guint32 i, n_stops, n_shadows, n_chars, n_glyphs;
   guint32 size, n_children;
   gint32 texture_offset;
   guint32 hash;
@@ -1760,7 +1922,9 @@ decode_nodes (BroadwayServer *server,
   id = data[(*pos)++];
   switch (type) {
   case BROADWAY_NODE_REUSE:
-    node = g_hash_table_lookup (surface->node_lookup, GINT_TO_POINTER(id));
+    node = g_hash_table_lookup (surface->pending_nodes ? surface->pending_node_lookup
+                                                       : surface->node_lookup,
+                                GINT_TO_POINTER(id));
     g_assert (node != NULL);
     return broadway_node_ref (node);
     break;
@@ -1822,6 +1986,12 @@ decode_nodes (BroadwayServer *server,
     size = 1 + (n_chars + 3) / 4;
     n_children = 1;
     break;
+  case BROADWAY_NODE_GLYPHS:
+    texture_offset = 4;
+    size = NODE_SIZE_RECT + 1 + NODE_SIZE_COLOR + 1;
+    n_glyphs = data[*pos + size++];
+    size += n_glyphs * NODE_SIZE_GLYPH;
+    break;
   default:
     g_assert_not_reached ();
   }
@@ -1862,6 +2032,84 @@ decode_nodes (BroadwayServer *server,
   return node;
 }
 
+/* The browser answers roundtrips after it handled everything sent
+ * before them, so an old unanswered roundtrip means it is behind.
+ */
+static gboolean
+client_is_behind (BroadwayServer *server)
+{
+  GList *oldest;
+  BroadwayOutstandingRoundtrip *rt;
+
+  oldest = g_list_last (server->outstanding_roundtrips);
+  if (oldest == NULL)
+    return FALSE;
+
+  rt = oldest->data;
+
+  return g_get_monotonic_time () - rt->time > COALESCE_LATENCY;
+}
+
+/* passes ownership of root, and if send is set, sends it to the
+ * browser as a diff against the nodes it has */
+static void
+set_surface_nodes (BroadwayServer  *server,
+                   BroadwaySurface *surface,
+                   BroadwayNode    *root,
+                   gboolean         send)
+{
+  if (send && server->output != NULL)
+    broadway_output_surface_set_nodes (server->output, surface->id,
+                                       root,
+                                       surface->nodes,
+                                       surface->node_lookup);
+
+  if (surface->nodes)
+    broadway_node_unref (server, surface->nodes);
+
+  surface->nodes = root;
+
+  g_hash_table_remove_all (surface->node_lookup);
+  broadway_node_add_to_lookup (root, surface->node_lookup);
+}
+
+static void
+take_pending_nodes (BroadwayServer  *server,
+                    BroadwaySurface *surface,
+                    gboolean         send)
+{
+  BroadwayNode *root = surface->pending_nodes;
+
+  surface->pending_nodes = NULL;
+  g_hash_table_remove_all (surface->pending_node_lookup);
+
+  set_surface_nodes (server, surface, root, send);
+}
+
+static void
+send_pending_nodes (BroadwayServer *server)
+{
+  gboolean sent = FALSE;
+  GList *l;
+
+  if (server->output == NULL || client_is_behind (server))
+    return;
+
+  for (l = server->surfaces; l != NULL; l = l->next)
+    {
+      BroadwaySurface *surface = l->data;
+
+      if (surface->pending_nodes)
+        {
+          take_pending_nodes (server, surface, TRUE);
+          sent = TRUE;
+        }
+    }
+
+  if (sent)
+    broadway_server_flush (server);
+}
+
 /* passes ownership of nodes */
 void
 broadway_server_surface_update_nodes (BroadwayServer   *server,
@@ -1880,19 +2128,23 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
 
   root = decode_nodes (server, surface, len, data, client_texture_map, &pos);
 
-  if (server->output != NULL)
-    broadway_output_surface_set_nodes (server->output, surface->id,
-                                       root,
-                                       surface->nodes,
-                                       surface->node_lookup);
-
-  if (surface->nodes)
-    broadway_node_unref (server, surface->nodes);
+  if (surface->pending_nodes)
+    {
+      /* The held back frame will never be seen */
+      broadway_node_unref (server, surface->pending_nodes);
+      surface->pending_nodes = NULL;
+      g_hash_table_remove_all (surface->pending_node_lookup);
+      server->n_coalesced_frames++;
+    }
 
-  surface->nodes = root;
+  if (server->output != NULL && client_is_behind (server))
+    {
+      surface->pending_nodes = root;
+      broadway_node_add_to_lookup (root, surface->pending_node_lookup);
+      return;
+    }
 
-  g_hash_table_remove_all (surface->node_lookup);
-  broadway_node_add_to_lookup (root, surface->node_lookup);
+  set_surface_nodes (server, surface, root, TRUE);
 }
 
 guint32
@@ -2086,6 +2338,7 @@ broadway_server_new_surface (BroadwayServer *server,
   surface->width = width;
   surface->height = height;
   surface->node_lookup = g_hash_table_new (g_direct_hash, g_direct_equal);
+  surface->pending_node_lookup = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   g_hash_table_insert (server->surface_id_hash,
                        GINT_TO_POINTER (surface->id),
@@ -2154,6 +2407,10 @@ broadway_server_resync_surfaces (BroadwayServer *server)
         broadway_output_set_transient_for (server->output, surface->id,
                                            surface->transient_for);
 
+      /* A new browser gets the whole tree anyway */
+      if (surface->pending_nodes)
+        take_pending_nodes (server, surface, FALSE);
+
       if (surface->nodes)
         broadway_output_surface_set_nodes (server->output, surface->id,
                                            surface->nodes,
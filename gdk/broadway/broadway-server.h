@@ -86,6 +86,10 @@ guint32             broadway_server_ungrab_pointer            (BroadwayServer  *
 gint32              broadway_server_get_mouse_surface         (BroadwayServer  *server);
 void                broadway_server_set_show_keyboard         (BroadwayServer  *server,
                                                                gboolean         show);
+void                broadway_server_set_compression           (BroadwayServer  *server,
+                                                               gboolean         compression);
+void                broadway_server_set_stats_interval        (BroadwayServer  *server,
+                                                               guint            interval);
 guint32             broadway_server_new_surface               (BroadwayServer  *server,
                                                                guint32          client,
                                                                int              x,
@@ -14,6 +14,7 @@ const BROADWAY_NODE_CLIP = 10;
 const BROADWAY_NODE_TRANSFORM = 11;
 const BROADWAY_NODE_DEBUG = 12;
 const BROADWAY_NODE_REUSE = 13;
+const BROADWAY_NODE_GLYPHS = 14;
 
 const BROADWAY_NODE_OP_INSERT_NODE = 0;
 const BROADWAY_NODE_OP_REMOVE_NODE = 1;
@@ -579,6 +580,14 @@ TransformNodes.prototype.createImage = function(id)
     return image;
 }
 
+TransformNodes.prototype.createCanvas = function(id)
+{
+    var canvas = document.createElement('canvas');
+    canvas.node_id = id;
+    this.nodes[id] = canvas;
+    return canvas;
+}
+
 TransformNodes.prototype.insertNode = function(parent, previousSibling, is_toplevel)
 {
     var type = this.decode_uint32();
@@ -809,7 +818,52 @@ TransformNodes.prototype.insertNode = function(parent, previousSibling, is_tople
         }
         break;
 
-    case 14:  // DEBUG
+    case BROADWAY_NODE_GLYPHS:
+        {
+            var rect = this.decode_rect();
+            var texture_id = this.decode_uint32();
+            var color = this.decode_color();
+            var scale = this.decode_uint32();
+            var len = this.decode_uint32();
+            var canvas = this.createCanvas(id);
+            canvas.width = Math.ceil(rect.width * scale);
+            canvas.height = Math.ceil(rect.height * scale);
+            canvas.style["position"] = "absolute";
+            set_rect_style(canvas, rect);
+
+            var texture = textures[texture_id].ref();
+            var glyphs = [];
+            for (var i = 0; i < len; i++) {
+                var p = this.decode_point();
+                var src = this.decode_uint32();
+                var size = this.decode_uint32();
+                glyphs.push([p.x, p.y, src, size]);
+            }
+
+            // The atlas page may have been uploaded in this frame and still
+            // be decoding. The glyphs are white in the atlas page, draw them
+            // and then fill them with the color
+            var block = function(canvas, texture, glyphs, color, scale) {
+                texture.decoded.then(() => {
+                    var ctx = canvas.getContext("2d");
+                    for (var i = 0; i < glyphs.length; i++) {
+                        var [x, y, src, size] = glyphs[i];
+                        var w = size & 0xffff;
+                        var h = size >>> 16;
+                        ctx.drawImage(texture.image, src & 0xffff, src >>> 16, w, h,
+                                      x * scale, y * scale, w, h);
+                    }
+                    ctx.globalCompositeOperation = "source-in";
+                    ctx.fillStyle = color;
+                    ctx.fillRect(0, 0, canvas.width, canvas.height);
+                }).finally(() => { texture.unref(); });
+            };
+            block(canvas, texture, glyphs, color, scale);
+            newNode = canvas;
+        }
+        break;
+
+    case BROADWAY_NODE_DEBUG:
         {
             var str = this.decode_string();
             var div = this.createDiv(id);
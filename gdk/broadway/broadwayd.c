@@ -535,6 +535,8 @@ main (int argc, char *argv[])
   int http_port = 0;
   char *ssl_cert = NULL;
   char *ssl_key = NULL;
+  gboolean no_compression = FALSE;
+  int stats_interval = 0;
   const char *display;
   int port = 0;
   const GOptionEntry entries[] = {
@@ -545,6 +547,8 @@ main (int argc, char *argv[])
 #endif
     { "cert", 'c', 0, G_OPTION_ARG_STRING, &ssl_cert, "SSL certificate path", "PATH" },
     { "key", 'k', 0, G_OPTION_ARG_STRING, &ssl_key, "SSL key path", "PATH" },
+    { "no-compression", 0, 0, G_OPTION_ARG_NONE, &no_compression, "Don't compress messages to the browser", NULL },
+    { "stats", 0, 0, G_OPTION_ARG_INT, &stats_interval, "Print bytes sent per frame every SECONDS", "SECONDS" },
     { NULL }
   };
 
@@ -612,6 +616,10 @@ main (int argc, char *argv[])
       return 1;
     }
 
+  broadway_server_set_compression (server, !no_compression);
+  if (stats_interval > 0)
+    broadway_server_set_stats_interval (server, stats_interval);
+
   listener = g_socket_service_new ();
   if (!g_socket_listener_add_address (G_SOCKET_LISTENER (listener),
                                       address,
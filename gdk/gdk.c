@@ -309,6 +309,9 @@ gdk_pre_parse (void)
   else if (g_getenv ("GTK_TRACE"))
     gdk_profiler_start (-1);
 
+  if (g_getenv ("GTK_TRACE_JSON"))
+    gdk_profiler_start_json (g_getenv ("GTK_TRACE_JSON"));
+
 #ifndef G_HAS_CONSTRUCTORS
   stash_desktop_startup_notification_id ();
 #endif
@@ -304,7 +304,22 @@ gdk_clipboard_read_local_async (GdkClipboard        *clipboard,
     {
       GOutputStream *output_stream;
       GIOStream *stream;
-      
+      GBytes *bytes;
+
+      /* If the data is already in memory, hand it over directly instead
+       * of copying it through a pipe chunk by chunk. */
+      bytes = gdk_content_provider_ref_bytes (priv->content, mime_type);
+      if (bytes)
+        {
+          g_task_set_task_data (task, (gpointer) mime_type, NULL);
+          g_task_return_pointer (task, g_memory_input_stream_new_from_bytes (bytes), g_object_unref);
+
+          g_bytes_unref (bytes);
+          gdk_content_formats_unref (content_formats);
+          g_object_unref (task);
+          return;
+        }
+
       stream = gdk_pipe_io_stream_new ();
       output_stream = g_io_stream_get_output_stream (stream);
       gdk_clipboard_write_async (clipboard,
@@ -571,6 +571,55 @@ gdk_content_provider_bytes_init (GdkContentProviderBytes *content)
 {
 }
 
+/*<private>
+ * gdk_content_provider_ref_bytes:
+ * @provider: a #GdkContentProvider
+ * @mime_type: an interned mime type
+ *
+ * Gets the data of @provider for @mime_type if it is already available
+ * as a #GBytes, so that in-process transfers can hand it over without
+ * serializing it into a stream.
+ *
+ * Returns: (transfer full) (nullable): the data or %NULL if it would
+ *     need to be written by gdk_content_provider_write_mime_type_async()
+ **/
+GBytes *
+gdk_content_provider_ref_bytes (GdkContentProvider *provider,
+                                const char         *mime_type)
+{
+  g_return_val_if_fail (GDK_IS_CONTENT_PROVIDER (provider), NULL);
+  g_return_val_if_fail (mime_type == g_intern_string (mime_type), NULL);
+
+  if (GDK_IS_CONTENT_PROVIDER_BYTES (provider))
+    {
+      GdkContentProviderBytes *content = GDK_CONTENT_PROVIDER_BYTES (provider);
+
+      if (content->mime_type != mime_type)
+        return NULL;
+
+      return g_bytes_ref (content->bytes);
+    }
+  else if (GDK_IS_CONTENT_PROVIDER_UNION (provider))
+    {
+      GdkContentProviderUnion *self = GDK_CONTENT_PROVIDER_UNION (provider);
+      gsize i;
+
+      /* Only look at the provider that would be asked to write the data */
+      for (i = 0; i < self->n_providers; i++)
+        {
+          GdkContentFormats *formats = gdk_content_provider_ref_formats (self->providers[i]);
+          gboolean contains = gdk_content_formats_contain_mime_type (formats, mime_type);
+
+          gdk_content_formats_unref (formats);
+
+          if (contains)
+            return gdk_content_provider_ref_bytes (self->providers[i], mime_type);
+        }
+    }
+
+  return NULL;
+}
+
 /**
  * gdk_content_provider_new_for_bytes:
  * @mime_type: the mime type
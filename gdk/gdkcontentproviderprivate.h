@@ -28,6 +28,9 @@ void                    gdk_content_provider_attach_clipboard   (GdkContentProvi
 void                    gdk_content_provider_detach_clipboard   (GdkContentProvider     *provider,
                                                                  GdkClipboard           *clipboard);
 
+GBytes *                gdk_content_provider_ref_bytes          (GdkContentProvider     *provider,
+                                                                 const char             *mime_type);
+
 G_END_DECLS
 
 #endif /* __GDK_CONTENT_PROVIDER_PRIVATE_H__ */
@@ -50,6 +50,10 @@
 #include "broadway/gdkprivate-broadway.h"
 #endif
 
+#ifdef GDK_WINDOWING_HEADLESS
+#include "headless/gdkprivate-headless.h"
+#endif
+
 #ifdef GDK_WINDOWING_MACOS
 #include "macos/gdkmacosdisplay-private.h"
 #endif
@@ -242,8 +246,9 @@ static const char *allowed_backends;
  * that are specified by this function.
  *
  * The possible backend names are x11, win32, quartz,
- * broadway, wayland. You can also include a * in the
- * list to try all remaining backends.
+ * broadway, wayland, headless. You can also include a * in the
+ * list to try all remaining backends, except headless, which is
+ * only used when it is asked for by name.
  *
  * This call must happen prior to gdk_display_open(),
  * gtk_init(), or gtk_init_check()
@@ -260,6 +265,7 @@ typedef struct _GdkBackend GdkBackend;
 struct _GdkBackend {
   const char *name;
   GdkDisplay * (* open_display) (const char *name);
+  gboolean only_by_name;
 };
 
 static GdkBackend gdk_backends[] = {
@@ -280,6 +286,9 @@ static GdkBackend gdk_backends[] = {
 #endif
 #ifdef GDK_WINDOWING_BROADWAY
   { "broadway", _gdk_broadway_display_open },
+#endif
+#ifdef GDK_WINDOWING_HEADLESS
+  { "headless", _gdk_headless_display_open, TRUE },
 #endif
   /* NULL-terminating this array so we can use commas above */
   { NULL, NULL }
@@ -425,6 +434,12 @@ gdk_display_manager_open_display (GdkDisplayManager *manager,
 
       for (j = 0; gdk_backends[j].name != NULL; j++)
         {
+          /* The headless backend always opens, so it must not
+           * win over real displays that are not available.
+           */
+          if (any && gdk_backends[j].only_by_name)
+            continue;
+
           if ((any && allow_any) ||
               (any && strstr (allowed_backends, gdk_backends[j].name)) ||
               g_str_equal (backend, gdk_backends[j].name))
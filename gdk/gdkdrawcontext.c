@@ -360,6 +360,7 @@ void
 gdk_draw_context_end_frame (GdkDrawContext *context)
 {
   GdkDrawContextPrivate *priv = gdk_draw_context_get_instance_private (context);
+  gint64 before = 0;
 
   g_return_if_fail (GDK_IS_DRAW_CONTEXT (context));
 
@@ -381,8 +382,14 @@ gdk_draw_context_end_frame (GdkDrawContext *context)
       return;
     }
 
+  if (GDK_PROFILER_IS_RUNNING)
+    before = g_get_monotonic_time ();
+
   GDK_DRAW_CONTEXT_GET_CLASS (context)->end_frame (context, priv->frame_region);
 
+  if (before != 0 && GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_end_mark (before, "present", G_OBJECT_TYPE_NAME (context));
+
 #ifdef G_ENABLE_DEBUG
   if (GDK_PROFILER_IS_RUNNING)
     gdk_profiler_set_int_counter (pixels_counter,
@@ -24,6 +24,7 @@
 #include "gdkcontentdeserializer.h"
 #include "gdkcontentformats.h"
 #include "gdkcontentprovider.h"
+#include "gdkcontentproviderprivate.h"
 #include "gdkcontentserializer.h"
 #include "gdkcursor.h"
 #include "gdkdisplay.h"
@@ -107,6 +108,7 @@ gdk_drop_read_local_async (GdkDrop             *self,
   const char *mime_type;
   GTask *task;
   GdkContentProvider *content;
+  GBytes *bytes;
 
   task = g_task_new (self, cancellable, callback, user_data);
   g_task_set_priority (task, io_priority);
@@ -122,11 +124,20 @@ gdk_drop_read_local_async (GdkDrop             *self,
 
   g_object_get (priv->drag, "content", &content, NULL);
   content_formats = gdk_content_provider_ref_formats (content);
-  g_object_unref (content); 
   content_formats = gdk_content_formats_union_serialize_mime_types (content_formats);
   mime_type = gdk_content_formats_match_mime_type (content_formats, formats);
+  bytes = mime_type ? gdk_content_provider_ref_bytes (content, mime_type) : NULL;
+  g_object_unref (content);
 
-  if (mime_type != NULL)
+  if (bytes != NULL)
+    {
+      /* The data is already in memory, hand it over directly */
+      g_task_set_task_data (task, (gpointer) mime_type, NULL);
+      g_task_return_pointer (task, g_memory_input_stream_new_from_bytes (bytes), g_object_unref);
+
+      g_bytes_unref (bytes);
+    }
+  else if (mime_type != NULL)
     {
       GOutputStream *output_stream;
       GIOStream *stream;
@@ -505,6 +505,34 @@ _gdk_event_emit (GdkEvent *event)
  * Functions for maintaining the event queue *
  *********************************************/
 
+static gboolean
+gdk_event_is_batchable (GdkEvent *event)
+{
+  switch ((int) event->event_type)
+    {
+    case GDK_MOTION_NOTIFY:
+    case GDK_TOUCH_UPDATE:
+      return TRUE;
+
+    case GDK_SCROLL:
+      return gdk_scroll_event_get_direction (event) == GDK_SCROLL_SMOOTH;
+
+    default:
+      return FALSE;
+    }
+}
+
+/* Whether @event is held back and accumulated until the
+ * frame clock flushes events, see gdk_surface_set_event_batching()
+ */
+static gboolean
+gdk_event_is_batched (GdkEvent *event)
+{
+  return event->surface != NULL &&
+         event->surface->event_batching &&
+         gdk_event_is_batchable (event);
+}
+
 /**
  * _gdk_event_queue_find_first:
  * @display: a #GdkDisplay
@@ -531,10 +559,23 @@ _gdk_event_queue_find_first (GdkDisplay *display)
       if ((event->flags & GDK_EVENT_PENDING) == 0 &&
 	  (!paused || (event->flags & GDK_EVENT_FLUSHED) != 0))
         {
-          if (pending_motion)
+          gboolean batched = (event->flags & GDK_EVENT_FLUSHED) == 0 &&
+                             gdk_event_is_batched (event);
+
+          /* Batched events wait for the frame clock, together with
+           * the batched events of other devices on the same surface.
+           */
+          if (pending_motion &&
+              !(batched && ((GdkEvent *) pending_motion->data)->surface == event->surface &&
+                gdk_event_is_batched (pending_motion->data)))
             return pending_motion;
 
-          if (event->event_type == GDK_MOTION_NOTIFY && (event->flags & GDK_EVENT_FLUSHED) == 0)
+          if (batched)
+            {
+              if (!pending_motion)
+                pending_motion = tmp_list;
+            }
+          else if (event->event_type == GDK_MOTION_NOTIFY && (event->flags & GDK_EVENT_FLUSHED) == 0)
             pending_motion = tmp_list;
           else
             return tmp_list;
@@ -635,6 +676,9 @@ gdk_event_queue_handle_scroll_compression (GdkDisplay *display)
           gdk_scroll_event_get_direction (event) != GDK_SCROLL_SMOOTH)
         break;
 
+      if (gdk_event_is_batched (event))
+        break;
+
       if (surface != NULL &&
           surface != event->surface)
         break;
@@ -769,6 +813,9 @@ _gdk_event_queue_handle_motion_compression (GdkDisplay *display)
       if (event->event_type != GDK_MOTION_NOTIFY)
         break;
 
+      if (gdk_event_is_batched (event))
+        break;
+
       if (pending_motion_surface != NULL &&
           pending_motion_surface != event->surface)
         break;
@@ -815,6 +862,173 @@ _gdk_event_queue_handle_motion_compression (GdkDisplay *display)
     }
 }
 
+static void
+gdk_event_get_time_coord (GdkEvent     *event,
+                          GdkTimeCoord *hist)
+{
+  GdkDeviceTool *tool;
+  int i;
+
+  memset (hist, 0, sizeof (GdkTimeCoord));
+  hist->time = gdk_event_get_time (event);
+
+  if (event->event_type == GDK_SCROLL)
+    {
+      hist->flags = GDK_AXIS_FLAG_DELTA_X | GDK_AXIS_FLAG_DELTA_Y;
+      gdk_scroll_event_get_deltas (event,
+                                   &hist->axes[GDK_AXIS_DELTA_X],
+                                   &hist->axes[GDK_AXIS_DELTA_Y]);
+      return;
+    }
+
+  tool = gdk_event_get_device_tool (event);
+  hist->flags = GDK_AXIS_FLAG_X | GDK_AXIS_FLAG_Y;
+  if (tool)
+    hist->flags |= gdk_device_tool_get_axes (tool);
+
+  for (i = GDK_AXIS_X; i < GDK_AXIS_LAST; i++)
+    {
+      if (hist->flags & (1 << i))
+        gdk_event_get_axis (event, i, &hist->axes[i]);
+    }
+}
+
+static GArray **
+gdk_event_get_history_location (GdkEvent *event)
+{
+  switch ((int) event->event_type)
+    {
+    case GDK_MOTION_NOTIFY:
+      return &((GdkMotionEvent *) event)->history;
+    case GDK_SCROLL:
+      return &((GdkScrollEvent *) event)->history;
+    case GDK_TOUCH_UPDATE:
+      return &((GdkTouchEvent *) event)->history;
+    default:
+      g_assert_not_reached ();
+      return NULL;
+    }
+}
+
+static gboolean
+gdk_events_can_batch (GdkEvent *older,
+                      GdkEvent *newer)
+{
+  if (older->event_type != newer->event_type ||
+      older->surface != newer->surface ||
+      older->device != newer->device)
+    return FALSE;
+
+  switch ((int) older->event_type)
+    {
+    case GDK_TOUCH_UPDATE:
+      return gdk_event_get_event_sequence (older) == gdk_event_get_event_sequence (newer) &&
+             gdk_event_get_pointer_emulated (older) == gdk_event_get_pointer_emulated (newer);
+
+    case GDK_SCROLL:
+      /* Don't lose the end of a scroll sequence */
+      return !gdk_scroll_event_is_stop (older) &&
+             gdk_event_get_device_tool (older) == gdk_event_get_device_tool (newer);
+
+    default:
+      return TRUE;
+    }
+}
+
+/* Moves @older and its history into the history of @newer */
+static void
+gdk_event_batch (GdkEvent *older,
+                 GdkEvent *newer)
+{
+  GArray **older_history = gdk_event_get_history_location (older);
+  GArray **newer_history = gdk_event_get_history_location (newer);
+  GArray *history;
+  GdkTimeCoord hist;
+
+  gdk_event_get_time_coord (older, &hist);
+
+  if (older->event_type == GDK_SCROLL)
+    {
+      GdkScrollEvent *self = (GdkScrollEvent *) newer;
+      guint i;
+
+      /* The deltas of a batched scroll event are the sum of
+       * its history, the event itself only knows its own
+       */
+      self->delta_x += hist.axes[GDK_AXIS_DELTA_X];
+      self->delta_y += hist.axes[GDK_AXIS_DELTA_Y];
+
+      if (*older_history)
+        for (i = 0; i < (*older_history)->len; i++)
+          {
+            GdkTimeCoord *h = &g_array_index (*older_history, GdkTimeCoord, i);
+
+            hist.axes[GDK_AXIS_DELTA_X] -= h->axes[GDK_AXIS_DELTA_X];
+            hist.axes[GDK_AXIS_DELTA_Y] -= h->axes[GDK_AXIS_DELTA_Y];
+          }
+    }
+
+  history = *older_history;
+  *older_history = NULL;
+  if (history == NULL)
+    history = g_array_new (FALSE, TRUE, sizeof (GdkTimeCoord));
+
+  g_array_append_val (history, hist);
+
+  if (*newer_history)
+    {
+      g_array_append_vals (history, (*newer_history)->data, (*newer_history)->len);
+      g_array_free (*newer_history, TRUE);
+    }
+
+  *newer_history = history;
+}
+
+/*
+ * If the last event in the queue is batched, merge the previous
+ * event of the same device (and touch sequence) into it, as long
+ * as only batched events of the same surface are in between. The
+ * events are then held back until the frame clock flushes them.
+ */
+void
+gdk_event_queue_handle_batching (GdkDisplay *display)
+{
+  GList *tail, *l;
+  GdkEvent *event;
+  GdkFrameClock *clock;
+
+  tail = g_queue_peek_tail_link (&display->queued_events);
+  if (tail == NULL)
+    return;
+
+  event = tail->data;
+  if ((event->flags & (GDK_EVENT_PENDING | GDK_EVENT_FLUSHED)) != 0 ||
+      !gdk_event_is_batched (event))
+    return;
+
+  for (l = tail->prev; l; l = l->prev)
+    {
+      GdkEvent *older = l->data;
+
+      if ((older->flags & (GDK_EVENT_PENDING | GDK_EVENT_FLUSHED)) != 0 ||
+          older->surface != event->surface ||
+          !gdk_event_is_batched (older))
+        break;
+
+      if (gdk_events_can_batch (older, event))
+        {
+          gdk_event_batch (older, event);
+          g_queue_delete_link (&display->queued_events, l);
+          gdk_event_unref (older);
+          break;
+        }
+    }
+
+  clock = gdk_surface_get_frame_clock (event->surface);
+  if (clock) /* might be NULL if surface was destroyed */
+    gdk_frame_clock_request_phase (clock, GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS);
+}
+
 void
 _gdk_event_queue_flush (GdkDisplay *display)
 {
@@ -1895,6 +2109,8 @@ gdk_touch_event_finalize (GdkEvent *event)
   GdkTouchEvent *self = (GdkTouchEvent *) event;
 
   g_clear_pointer (&self->axes, g_free);
+  if (self->history)
+    g_array_free (self->history, TRUE);
 
   GDK_EVENT_SUPER (event)->finalize (event);
 }
@@ -2853,7 +3069,7 @@ gdk_motion_event_new (GdkSurface      *surface,
 
 /**
  * gdk_event_get_history:
- * @event: a motion or scroll #GdkEvent
+ * @event: a motion, scroll or touch #GdkEvent
  * @out_n_coords: (out): Return location for the length of the returned array
  *
  * Retrieves the history of the @event, as a list of time and coordinates.
@@ -2862,7 +3078,9 @@ gdk_motion_event_new (GdkSurface      *surface,
  * because they occurred in the same frame as @event.
  *
  * Note that only motion and scroll events record history, and motion
- * events only if one of the mouse buttons is down.
+ * events only if one of the mouse buttons is down. When event batching
+ * is enabled with gdk_surface_set_event_batching(), motion events always
+ * record history, and touch update events do as well.
  *
  * Returns: (transfer container) (array length=out_n_coords) (nullable): an
  *   array of time and coordinates
@@ -2875,7 +3093,11 @@ gdk_event_get_history (GdkEvent *event,
 
   g_return_val_if_fail (GDK_IS_EVENT (event), NULL);
   g_return_val_if_fail (GDK_IS_EVENT_TYPE (event, GDK_MOTION_NOTIFY) ||
-                        GDK_IS_EVENT_TYPE (event, GDK_SCROLL), NULL);
+                        GDK_IS_EVENT_TYPE (event, GDK_SCROLL) ||
+                        GDK_IS_EVENT_TYPE (event, GDK_TOUCH_BEGIN) ||
+                        GDK_IS_EVENT_TYPE (event, GDK_TOUCH_UPDATE) ||
+                        GDK_IS_EVENT_TYPE (event, GDK_TOUCH_END) ||
+                        GDK_IS_EVENT_TYPE (event, GDK_TOUCH_CANCEL), NULL);
   g_return_val_if_fail (out_n_coords != NULL, NULL);
 
   if (GDK_IS_EVENT_TYPE (event, GDK_MOTION_NOTIFY))
@@ -2883,11 +3105,16 @@ gdk_event_get_history (GdkEvent *event,
       GdkMotionEvent *self = (GdkMotionEvent *) event;
       history = self->history;
     }
-  else
+  else if (GDK_IS_EVENT_TYPE (event, GDK_SCROLL))
     {
       GdkScrollEvent *self = (GdkScrollEvent *) event;
       history = self->history;
     }
+  else
+    {
+      GdkTouchEvent *self = (GdkTouchEvent *) event;
+      history = self->history;
+    }
 
   if (history && history->len > 0)
     {
@@ -169,6 +169,9 @@ struct _GdkButtonEvent
  *   if @device is the mouse
  * @sequence: the event sequence that the event belongs to
  * @emulated: whether the event is the result of a pointer emulation
+ * @history: (element-type GdkTimeCoord): a list of time and coordinates
+ *   for other touch updates that were batched before delivering the
+ *   current event
  *
  * Used for touch events.
  * @type field will be one of %GDK_TOUCH_BEGIN, %GDK_TOUCH_UPDATE,
@@ -192,6 +195,7 @@ struct _GdkTouchEvent
   GdkEventSequence *sequence;
   gboolean touch_emulating;
   gboolean pointer_emulated;
+  GArray *history; /* <GdkTimeCoord> */
 };
 
 /*
@@ -624,6 +628,7 @@ GList* _gdk_event_queue_append       (GdkDisplay *display,
 
 void    _gdk_event_queue_handle_motion_compression (GdkDisplay *display);
 void    gdk_event_queue_handle_scroll_compression  (GdkDisplay *display);
+void    gdk_event_queue_handle_batching            (GdkDisplay *display);
 void    _gdk_event_queue_flush                     (GdkDisplay       *display);
 
 
@@ -707,6 +707,9 @@ void
 _gdk_frame_clock_emit_after_paint (GdkFrameClock *frame_clock)
 {
   g_signal_emit (frame_clock, signals[AFTER_PAINT], 0);
+
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_flush_type_spans ();
 }
 
 void
@@ -22,6 +22,9 @@
 
 #include <sys/types.h>
 #include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -32,12 +35,82 @@
 #include "gdkframeclockprivate.h"
 
 #ifdef HAVE_SYSPROF_CAPTURE
-
 #include <sysprof-capture.h>
+#endif
+
+/* Marks and counters go to sysprof, when GTK is built with it and
+ * sysprof asked for them, and to a file in the Chrome trace event
+ * format, when GTK_TRACE_JSON is set. Either way, nothing but the
+ * check in GDK_PROFILER_IS_RUNNING happens when neither is on.
+ */
 
-static SysprofCaptureWriter *writer = NULL;
 static gboolean running = FALSE;
 
+typedef struct {
+  char *name;
+  char *description;
+  gboolean is_int;
+  guint sysprof_id;
+} Counter;
+
+/* Counters can be defined before the profiler starts, so that
+ * they can be defined when the code that sets them is set up.
+ */
+static GArray *counters = NULL;
+static GMutex counters_lock;
+
+/* Open type spans, see gdk_profiler_begin_type_span(). Each entry
+ * holds the time spent in the child spans of the span, in µs.
+ */
+static GArray *span_stack = NULL;
+
+static void
+reset_type_spans (void)
+{
+  /* Spans that were open when the profiler stopped never end */
+  if (span_stack)
+    g_array_set_size (span_stack, 0);
+}
+
+static int
+get_pid (void)
+{
+#ifdef HAVE_UNISTD_H
+  return getpid ();
+#else
+  return 0;
+#endif
+}
+
+#ifdef HAVE_SYSPROF_CAPTURE
+
+static SysprofCaptureWriter *writer = NULL;
+static gboolean sysprof_running = FALSE;
+
+#define SYSPROF_RUNNING (writer != NULL && sysprof_running)
+
+static void
+sysprof_define_counter (Counter *counter)
+{
+  SysprofCaptureCounter sc;
+
+  sc.id = (guint) sysprof_capture_writer_request_counter (writer, 1);
+  sc.type = counter->is_int ? SYSPROF_CAPTURE_COUNTER_INT64 : SYSPROF_CAPTURE_COUNTER_DOUBLE;
+  sc.value.vdbl = 0;
+  g_strlcpy (sc.category, "gtk", sizeof sc.category);
+  g_strlcpy (sc.name, counter->name, sizeof sc.name);
+  g_strlcpy (sc.description, counter->description, sizeof sc.description);
+
+  sysprof_capture_writer_define_counters (writer,
+                                          SYSPROF_CAPTURE_CURRENT_TIME,
+                                          -1,
+                                          get_pid (),
+                                          &sc,
+                                          1);
+
+  counter->sysprof_id = sc.id;
+}
+
 static void
 profiler_stop (int s)
 {
@@ -45,9 +118,181 @@ profiler_stop (int s)
     sysprof_capture_writer_unref (writer);
 }
 
+#endif /* HAVE_SYSPROF_CAPTURE */
+
+/* {{{ Chrome trace format */
+
+static FILE *json_file = NULL;
+static GMutex json_lock;
+static gboolean json_first_event = TRUE;
+static GPrivate json_thread_id;
+static int json_n_threads = 0;
+
+static void
+json_append_string (GString    *s,
+                    const char *str)
+{
+  const char *p;
+
+  g_string_append_c (s, '"');
+  for (p = str; *p; p++)
+    {
+      switch (*p)
+        {
+        case '"':
+          g_string_append (s, "\\\"");
+          break;
+        case '\\':
+          g_string_append (s, "\\\\");
+          break;
+        case '\n':
+          g_string_append (s, "\\n");
+          break;
+        case '\t':
+          g_string_append (s, "\\t");
+          break;
+        default:
+          if ((guchar) *p < 0x20)
+            g_string_append_printf (s, "\\u%04x", (guchar) *p);
+          else
+            g_string_append_c (s, *p);
+          break;
+        }
+    }
+  g_string_append_c (s, '"');
+}
+
+/* Small thread numbers that stay the same for the whole trace */
+static int
+json_get_thread_id (void)
+{
+  int id = GPOINTER_TO_INT (g_private_get (&json_thread_id));
+
+  if (id == 0)
+    {
+      id = g_atomic_int_add (&json_n_threads, 1) + 1;
+      g_private_set (&json_thread_id, GINT_TO_POINTER (id));
+    }
+
+  return id;
+}
+
+static void
+json_begin_event (GString    *s,
+                  const char *name,
+                  const char *phase,
+                  gint64      time)
+{
+  g_string_append (s, "{\"name\":");
+  json_append_string (s, name);
+  g_string_append_printf (s,
+                          ",\"cat\":\"gtk\",\"ph\":\"%s\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d",
+                          phase, time, get_pid (), json_get_thread_id ());
+}
+
+static void
+json_write_event (GString *s)
+{
+  g_string_append_c (s, '}');
+
+  g_mutex_lock (&json_lock);
+  if (json_file)
+    {
+      fputs (json_first_event ? "\n" : ",\n", json_file);
+      fwrite (s->str, 1, s->len, json_file);
+      json_first_event = FALSE;
+    }
+  g_mutex_unlock (&json_lock);
+
+  g_string_free (s, TRUE);
+}
+
+static void
+json_add_mark (gint64      start,
+               guint64     duration,
+               const char *name,
+               const char *message)
+{
+  GString *s = g_string_new (NULL);
+
+  json_begin_event (s, name, "X", start);
+  g_string_append_printf (s, ",\"dur\":%" G_GUINT64_FORMAT, duration);
+  if (message && *message)
+    {
+      g_string_append (s, ",\"args\":{\"message\":");
+      json_append_string (s, message);
+      g_string_append_c (s, '}');
+    }
+
+  json_write_event (s);
+}
+
+static void
+json_stop (void)
+{
+  g_mutex_lock (&json_lock);
+  if (json_file)
+    {
+      fputs ("\n]}\n", json_file);
+      fclose (json_file);
+      json_file = NULL;
+    }
+  g_mutex_unlock (&json_lock);
+}
+
+/*< private >
+ * gdk_profiler_start_json:
+ * @filename: (nullable): the file to write to
+ *
+ * Starts writing marks and counters to @filename, in the Chrome
+ * trace event format that chrome://tracing and Perfetto can show.
+ * If @filename is %NULL or empty, the file is called gtk.PID.json.
+ *
+ * The file is completed when the process exits.
+ */
+void
+gdk_profiler_start_json (const char *filename)
+{
+  char *name;
+
+  if (json_file)
+    return;
+
+  if (filename == NULL || *filename == '\0')
+    {
+      name = g_strdup_printf ("gtk.%d.json", get_pid ());
+      g_print ("Writing profiling data to %s\n", name);
+    }
+  else
+    name = g_strdup (filename);
+
+  json_file = fopen (name, "w");
+  if (json_file == NULL)
+    {
+      g_warning ("Could not open %s for writing profiling data", name);
+      g_free (name);
+      return;
+    }
+
+  g_free (name);
+
+  fputs ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", json_file);
+
+  if (!running)
+    reset_type_spans ();
+  running = TRUE;
+
+  atexit (json_stop);
+}
+
+/* }}} */
+
 void
 gdk_profiler_start (int fd)
 {
+#ifdef HAVE_SYSPROF_CAPTURE
+  guint i;
+
   if (writer)
     return;
 
@@ -66,16 +311,31 @@ gdk_profiler_start (int fd)
     writer = sysprof_capture_writer_new_from_fd (fd, 16*1024);
 
   if (writer)
-    running = TRUE;
+    {
+      if (!running)
+        reset_type_spans ();
+      running = TRUE;
+      sysprof_running = TRUE;
+
+      g_mutex_lock (&counters_lock);
+      for (i = 0; counters && i < counters->len; i++)
+        sysprof_define_counter (&g_array_index (counters, Counter, i));
+      g_mutex_unlock (&counters_lock);
+    }
 
   atexit (G_CALLBACK (profiler_stop));
   signal (SIGTERM, profiler_stop);
+#endif
 }
 
+/* Only stops sysprof. A trace file is written until the process exits */
 void
 gdk_profiler_stop (void)
 {
-  running = FALSE;
+#ifdef HAVE_SYSPROF_CAPTURE
+  sysprof_running = FALSE;
+#endif
+  running = json_file != NULL;
 }
 
 gboolean
@@ -84,6 +344,25 @@ gdk_profiler_is_running (void)
   return running;
 }
 
+static void
+add_mark (gint64      start,
+          guint64     duration,
+          const char *name,
+          const char *message)
+{
+#ifdef HAVE_SYSPROF_CAPTURE
+  if (SYSPROF_RUNNING)
+    sysprof_capture_writer_add_mark (writer,
+                                     start * 1000L,
+                                     -1, getpid (),
+                                     duration * 1000L,
+                                     "gtk", name, message);
+#endif
+
+  if (json_file)
+    json_add_mark (start, duration, name, message);
+}
+
 void
 gdk_profiler_add_mark (gint64      start,
                        guint64     duration,
@@ -93,11 +372,7 @@ gdk_profiler_add_mark (gint64      start,
   if (!running)
     return;
 
-  sysprof_capture_writer_add_mark (writer,
-                                   start * 1000L,
-                                   -1, getpid (),
-                                   duration * 1000L,
-                                   "gtk", name, message);
+  add_mark (start, duration, name, message);
 }
 
 static void add_markvf (gint64      start,
@@ -115,11 +390,7 @@ add_markvf (gint64      start,
 {
   char *message;
   message = g_strdup_vprintf (format, args);
-  sysprof_capture_writer_add_mark (writer,
-                                   start * 1000L,
-                                   -1, getpid (),
-                                   duration * 1000L,
-                                   "gtk", name, message);
+  add_mark (start, duration, name, message);
   g_free (message);
 }
 
@@ -148,11 +419,7 @@ gdk_profiler_end_mark (gint64      start,
   if (!running)
     return;
 
-  sysprof_capture_writer_add_mark (writer,
-                                   start * 1000L,
-                                   -1, getpid (),
-                                   (g_get_monotonic_time () - start) * 1000L,
-                                   "gtk", name, message);
+  add_mark (start, g_get_monotonic_time () - start, name, message);
 }
 
 void
@@ -171,46 +438,97 @@ gdk_profiler_end_markf (gint64      start,
   va_end (args);
 }
 
-
 static guint
 define_counter (const char *name,
                 const char *description,
-                int         type)
+                gboolean    is_int)
 {
-  SysprofCaptureCounter counter;
+  Counter counter;
+  guint id;
 
-  if (!writer)
-    return 0;
+  counter.name = g_strdup (name);
+  counter.description = g_strdup (description);
+  counter.is_int = is_int;
+  counter.sysprof_id = 0;
 
-  counter.id = (guint) sysprof_capture_writer_request_counter (writer, 1);
-  counter.type = type;
-  counter.value.vdbl = 0;
-  g_strlcpy (counter.category, "gtk", sizeof counter.category);
-  g_strlcpy (counter.name, name, sizeof counter.name);
-  g_strlcpy (counter.description, description, sizeof counter.name);
+  g_mutex_lock (&counters_lock);
 
-  sysprof_capture_writer_define_counters (writer,
-                                          SYSPROF_CAPTURE_CURRENT_TIME,
-                                          -1,
-                                          getpid (),
-                                          &counter,
-                                          1);
+  if (counters == NULL)
+    counters = g_array_new (FALSE, FALSE, sizeof (Counter));
 
-  return counter.id;
+#ifdef HAVE_SYSPROF_CAPTURE
+  if (SYSPROF_RUNNING)
+    sysprof_define_counter (&counter);
+#endif
+
+  g_array_append_val (counters, counter);
+  id = counters->len;
+
+  g_mutex_unlock (&counters_lock);
+
+  return id;
 }
 
 guint
 gdk_profiler_define_counter (const char *name,
                              const char *description)
 {
-  return define_counter (name, description, SYSPROF_CAPTURE_COUNTER_DOUBLE);
+  return define_counter (name, description, FALSE);
 }
 
 guint
 gdk_profiler_define_int_counter (const char *name,
                                  const char *description)
 {
-  return define_counter (name, description, SYSPROF_CAPTURE_COUNTER_INT64);
+  return define_counter (name, description, TRUE);
+}
+
+static void
+set_counter (guint  id,
+             gint64 time,
+             double dval,
+             gint64 ival)
+{
+  Counter counter;
+
+  g_mutex_lock (&counters_lock);
+  if (counters == NULL || id == 0 || id > counters->len)
+    {
+      g_mutex_unlock (&counters_lock);
+      return;
+    }
+  counter = g_array_index (counters, Counter, id - 1);
+  g_mutex_unlock (&counters_lock);
+
+#ifdef HAVE_SYSPROF_CAPTURE
+  if (SYSPROF_RUNNING && counter.sysprof_id != 0)
+    {
+      SysprofCaptureCounterValue value;
+
+      if (counter.is_int)
+        value.v64 = ival;
+      else
+        value.vdbl = dval;
+
+      sysprof_capture_writer_set_counters (writer,
+                                           time * 1000L,
+                                           -1, getpid (),
+                                           &counter.sysprof_id, &value, 1);
+    }
+#endif
+
+  if (json_file)
+    {
+      GString *s = g_string_new (NULL);
+
+      json_begin_event (s, counter.name, "C", time);
+      if (counter.is_int)
+        g_string_append_printf (s, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}", ival);
+      else
+        g_string_append_printf (s, ",\"args\":{\"value\":%g}", dval);
+
+      json_write_event (s);
+    }
 }
 
 void
@@ -218,16 +536,10 @@ gdk_profiler_set_counter (guint  id,
                           gint64 time,
                           double val)
 {
-  SysprofCaptureCounterValue value;
-
   if (!running)
     return;
 
-  value.vdbl = val;
-  sysprof_capture_writer_set_counters (writer,
-                                       time * 1000L,
-                                       -1, getpid (),
-                                       &id, &value, 1);
+  set_counter (id, time, val, (gint64) val);
 }
 
 void
@@ -235,94 +547,213 @@ gdk_profiler_set_int_counter (guint  id,
                               gint64 time,
                               gint64 val)
 {
-  SysprofCaptureCounterValue value;
-
   if (!running)
     return;
 
-  value.v64 = val;
-  sysprof_capture_writer_set_counters (writer,
-                                       time * 1000L,
-                                       -1, getpid (),
-                                       &id, &value, 1);
+  set_counter (id, time, (double) val, val);
 }
 
-#else
+/* {{{ Type spans */
 
-void
-gdk_profiler_start (int fd)
-{
-}
+/* Type spans add up the time spent in a phase, like measuring or
+ * snapshotting, by the type of the object that did the work. The
+ * time of nested spans is only counted for the innermost one, so
+ * a container does not get blamed for the time of its children.
+ *
+ * The totals are reported, and reset, once per frame.
+ */
 
-void
-gdk_profiler_stop (void)
-{
-}
+typedef struct {
+  GType type;
+  const char *phase;
+  guint count;
+  gint64 total;
+  gint64 self;
+} TypeSpanStats;
 
-gboolean
-gdk_profiler_is_running (void)
-{
-  return FALSE;
-}
+static GHashTable *span_stats = NULL;
 
-void
-gdk_profiler_add_mark (gint64      start,
-                       guint64     duration,
-                       const char *name,
-                       const char *message)
+static guint
+type_span_stats_hash (gconstpointer data)
 {
-}
+  const TypeSpanStats *stats = data;
 
-void
-gdk_profiler_add_markf (gint64      start,
-                        guint64     duration,
-                        const char *name,
-                        const char *format,
-                        ...)
-{
+  return g_direct_hash (GSIZE_TO_POINTER (stats->type)) ^ g_str_hash (stats->phase);
 }
 
-void
-gdk_profiler_end_mark (gint64      start,
-                       const char *name,
-                       const char *message)
+static gboolean
+type_span_stats_equal (gconstpointer a,
+                       gconstpointer b)
 {
-}
+  const TypeSpanStats *sa = a;
+  const TypeSpanStats *sb = b;
 
-void
-gdk_profiler_end_markf (gint64      start,
-                        const char *name,
-                        const char *format,
-                        ...)
-{
+  return sa->type == sb->type && strcmp (sa->phase, sb->phase) == 0;
 }
 
-guint
-gdk_profiler_define_counter (const char *name,
-                             const char *description)
+/*< private >
+ * gdk_profiler_begin_type_span:
+ *
+ * Starts a type span. Type spans can only be used from the
+ * main thread, and must be ended with gdk_profiler_end_type_span().
+ *
+ * Returns: the start time, to pass to gdk_profiler_end_type_span()
+ */
+gint64
+gdk_profiler_begin_type_span (void)
 {
- return 0;
+  gint64 child_time = 0;
+
+  if (span_stack == NULL)
+    span_stack = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  g_array_append_val (span_stack, child_time);
+
+  return g_get_monotonic_time ();
 }
 
+/*< private >
+ * gdk_profiler_end_type_span:
+ * @start: the value returned by gdk_profiler_begin_type_span()
+ * @phase: (not nullable): a static string naming the work, like "measure"
+ * @type: the type that did the work
+ *
+ * Ends a type span, and adds its time to the totals for
+ * @phase and @type.
+ */
 void
-gdk_profiler_set_counter (guint  id,
-                          gint64 time,
-                          double value)
+gdk_profiler_end_type_span (gint64      start,
+                            const char *phase,
+                            GType       type)
 {
+  TypeSpanStats key, *stats;
+  gint64 duration, child_time;
+
+  /* The profiler may have been started inside of the span */
+  if (span_stack == NULL || span_stack->len == 0)
+    return;
+
+  duration = g_get_monotonic_time () - start;
+  child_time = g_array_index (span_stack, gint64, span_stack->len - 1);
+  g_array_set_size (span_stack, span_stack->len - 1);
+  if (span_stack->len > 0)
+    g_array_index (span_stack, gint64, span_stack->len - 1) += duration;
+
+  if (span_stats == NULL)
+    span_stats = g_hash_table_new_full (type_span_stats_hash, type_span_stats_equal, g_free, NULL);
+
+  key.type = type;
+  key.phase = phase;
+  stats = g_hash_table_lookup (span_stats, &key);
+  if (stats == NULL)
+    {
+      stats = g_new0 (TypeSpanStats, 1);
+      stats->type = type;
+      stats->phase = phase;
+      g_hash_table_add (span_stats, stats);
+    }
+
+  stats->count++;
+  stats->total += duration;
+  stats->self += duration - child_time;
 }
 
-guint
-gdk_profiler_define_int_counter (const char *name,
-                                 const char *description)
+static int
+compare_type_span_stats (gconstpointer a,
+                         gconstpointer b)
 {
-  return 0;
+  const TypeSpanStats *sa = *(const TypeSpanStats **) a;
+  const TypeSpanStats *sb = *(const TypeSpanStats **) b;
+
+  if (sa->self != sb->self)
+    return sa->self < sb->self ? 1 : -1;
+
+  return strcmp (g_type_name (sa->type), g_type_name (sb->type));
 }
 
+/*< private >
+ * gdk_profiler_flush_type_spans:
+ *
+ * Reports the totals of the type spans since the last call as a
+ * mark, with the most expensive types first, and resets them.
+ */
 void
-gdk_profiler_set_int_counter (guint  id,
-                              gint64 time,
-                              gint64 value)
+gdk_profiler_flush_type_spans (void)
 {
+  GPtrArray *sorted;
+  GHashTableIter iter;
+  gpointer stats;
+  gint64 now;
+  guint i;
+
+  if (!running)
+    return;
+
+  if (span_stats == NULL || g_hash_table_size (span_stats) == 0)
+    return;
+
+  sorted = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, span_stats);
+  while (g_hash_table_iter_next (&iter, &stats, NULL))
+    g_ptr_array_add (sorted, stats);
+  g_ptr_array_sort (sorted, compare_type_span_stats);
+
+  now = g_get_monotonic_time ();
+
+#ifdef HAVE_SYSPROF_CAPTURE
+  if (SYSPROF_RUNNING)
+    {
+      GString *message = g_string_new (NULL);
+
+      for (i = 0; i < sorted->len; i++)
+        {
+          TypeSpanStats *s = g_ptr_array_index (sorted, i);
+
+          g_string_append_printf (message,
+                                  "%s%s %s: %u× %" G_GINT64_FORMAT "µs (self %" G_GINT64_FORMAT "µs)",
+                                  i > 0 ? ", " : "",
+                                  g_type_name (s->type), s->phase,
+                                  s->count, s->total, s->self);
+        }
+
+      sysprof_capture_writer_add_mark (writer,
+                                       now * 1000L,
+                                       -1, getpid (),
+                                       0,
+                                       "gtk", "type spans", message->str);
+      g_string_free (message, TRUE);
+    }
+#endif
+
+  if (json_file)
+    {
+      GString *s = g_string_new (NULL);
+
+      json_begin_event (s, "type spans", "i", now);
+      g_string_append (s, ",\"s\":\"p\",\"args\":{");
+      for (i = 0; i < sorted->len; i++)
+        {
+          TypeSpanStats *ts = g_ptr_array_index (sorted, i);
+          char *key;
+
+          if (i > 0)
+            g_string_append_c (s, ',');
+          key = g_strconcat (g_type_name (ts->type), " ", ts->phase, NULL);
+          json_append_string (s, key);
+          g_free (key);
+          g_string_append_printf (s,
+                                  ":{\"count\":%u,\"total\":%" G_GINT64_FORMAT ",\"self\":%" G_GINT64_FORMAT "}",
+                                  ts->count, ts->total, ts->self);
+        }
+      g_string_append_c (s, '}');
+
+      json_write_event (s);
+    }
+
+  g_ptr_array_unref (sorted);
+  g_hash_table_remove_all (span_stats);
 }
 
-#endif /* G_OS_WIN32 */
+/* }}} */
+
+/* vim:set foldmethod=marker expandtab: */
@@ -28,17 +28,14 @@ G_BEGIN_DECLS
 #error "config.h was not included before gdkprofilerprivate.h."
 #endif
 
-/* We make this a macro you use as if (GDK_PROFILER_IS_RUNNING) because that
- * way we can ensure all the code is compiled out when not supported, and
- * we can add a G_UNLIKELY() for better codegen if it is.
+/* We make this a macro you use as if (GDK_PROFILER_IS_RUNNING) so that
+ * we can add a G_UNLIKELY() for better codegen. It is always compiled in,
+ * since marks can be written to a trace file without sysprof.
  */
-#ifdef HAVE_SYSPROF_CAPTURE
 #define GDK_PROFILER_IS_RUNNING G_UNLIKELY (gdk_profiler_is_running ())
-#else
-#define GDK_PROFILER_IS_RUNNING FALSE
-#endif
 
 void     gdk_profiler_start      (int fd);
+void     gdk_profiler_start_json (const char      *filename);
 void     gdk_profiler_stop       (void);
 gboolean gdk_profiler_is_running (void);
 void     gdk_profiler_add_mark   (gint64           start,
@@ -68,6 +65,12 @@ void     gdk_profiler_set_int_counter (guint  id,
                                        gint64 time,
                                        gint64 value);
 
+gint64   gdk_profiler_begin_type_span  (void);
+void     gdk_profiler_end_type_span    (gint64      start,
+                                        const char *phase,
+                                        GType       type);
+void     gdk_profiler_flush_type_spans (void);
+
 G_END_DECLS
 
 #endif  /* __GDK_PROFILER_PRIVATE_H__ */
@@ -2057,6 +2057,51 @@ gdk_surface_set_input_region (GdkSurface     *surface,
   GDK_SURFACE_GET_CLASS (surface)->set_input_region (surface, surface->input_region);
 }
 
+/**
+ * gdk_surface_set_event_batching:
+ * @surface: a #GdkSurface
+ * @batching: whether to batch input events
+ *
+ * Sets whether motion, smooth scroll and touch update events
+ * for @surface are batched.
+ *
+ * By default, consecutive motion and scroll events are compressed,
+ * and the intermediate positions are only kept for motion events
+ * while a button is pressed. When batching is enabled, these events
+ * are instead accumulated per device (and per touch sequence) until
+ * the frame clock flushes events, and delivered as a single event
+ * whose history, as returned by gdk_event_get_history(), contains
+ * every sample that was received since the previous frame.
+ *
+ * This is meant for applications like drawing programs that need
+ * every sample, but want to process them once per frame.
+ */
+void
+gdk_surface_set_event_batching (GdkSurface *surface,
+                                gboolean    batching)
+{
+  g_return_if_fail (GDK_IS_SURFACE (surface));
+
+  surface->event_batching = batching != FALSE;
+}
+
+/**
+ * gdk_surface_get_event_batching:
+ * @surface: a #GdkSurface
+ *
+ * Returns whether input events for @surface are batched.
+ * See gdk_surface_set_event_batching().
+ *
+ * Returns: %TRUE if input events are batched
+ */
+gboolean
+gdk_surface_get_event_batching (GdkSurface *surface)
+{
+  g_return_val_if_fail (GDK_IS_SURFACE (surface), FALSE);
+
+  return surface->event_batching;
+}
+
 static void
 update_cursor (GdkDisplay *display,
                GdkDevice  *device)
@@ -2233,6 +2278,7 @@ _gdk_windowing_got_event (GdkDisplay *display,
    */
   _gdk_event_queue_handle_motion_compression (display);
   gdk_event_queue_handle_scroll_compression (display);
+  gdk_event_queue_handle_batching (display);
 }
 
 /**
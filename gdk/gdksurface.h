@@ -158,6 +158,12 @@ GDK_AVAILABLE_IN_ALL
 void          gdk_surface_set_input_region      (GdkSurface     *surface,
                                                  cairo_region_t *region);
 
+GDK_AVAILABLE_IN_ALL
+void          gdk_surface_set_event_batching    (GdkSurface     *surface,
+                                                 gboolean        batching);
+GDK_AVAILABLE_IN_ALL
+gboolean      gdk_surface_get_event_batching    (GdkSurface     *surface);
+
 GDK_AVAILABLE_IN_ALL
 gboolean      gdk_surface_get_mapped   (GdkSurface *surface);
 
@@ -0,0 +1,92 @@
+/* gdkcairocontext-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+/* Draws straight into the memory of the surface. Only the frame
+ * region is cleared and redrawn, the rest keeps what was drawn in
+ * earlier frames, like it would on a real display.
+ */
+
+typedef struct _GdkHeadlessCairoContext GdkHeadlessCairoContext;
+typedef struct _GdkCairoContextClass GdkHeadlessCairoContextClass;
+
+struct _GdkHeadlessCairoContext
+{
+  GdkCairoContext parent_instance;
+};
+
+G_DEFINE_TYPE (GdkHeadlessCairoContext, gdk_headless_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
+
+static void
+gdk_headless_cairo_context_begin_frame (GdkDrawContext *draw_context,
+                                        cairo_region_t *region)
+{
+  GdkSurface *surface = gdk_draw_context_get_surface (draw_context);
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+  cairo_t *cr;
+
+  _gdk_headless_surface_ensure_contents (surface, region);
+
+  /* clear the repaint area */
+  cr = cairo_create (impl->contents);
+  gdk_cairo_region (cr, region);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+}
+
+static void
+gdk_headless_cairo_context_end_frame (GdkDrawContext *draw_context,
+                                      cairo_region_t *painted)
+{
+  GdkSurface *surface = gdk_draw_context_get_surface (draw_context);
+
+  cairo_surface_flush (GDK_HEADLESS_SURFACE (surface)->contents);
+}
+
+static void
+gdk_headless_cairo_context_surface_resized (GdkDrawContext *draw_context)
+{
+}
+
+static cairo_t *
+gdk_headless_cairo_context_cairo_create (GdkCairoContext *context)
+{
+  GdkSurface *surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (context));
+
+  return cairo_create (GDK_HEADLESS_SURFACE (surface)->contents);
+}
+
+static void
+gdk_headless_cairo_context_class_init (GdkHeadlessCairoContextClass *klass)
+{
+  GdkDrawContextClass *draw_context_class = GDK_DRAW_CONTEXT_CLASS (klass);
+  GdkCairoContextClass *cairo_context_class = GDK_CAIRO_CONTEXT_CLASS (klass);
+
+  draw_context_class->begin_frame = gdk_headless_cairo_context_begin_frame;
+  draw_context_class->end_frame = gdk_headless_cairo_context_end_frame;
+  draw_context_class->surface_resized = gdk_headless_cairo_context_surface_resized;
+
+  cairo_context_class->cairo_create = gdk_headless_cairo_context_cairo_create;
+}
+
+static void
+gdk_headless_cairo_context_init (GdkHeadlessCairoContext *self)
+{
+}
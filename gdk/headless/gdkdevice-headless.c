@@ -0,0 +1,129 @@
+/* gdkdevice-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+#include "gdkdeviceprivate.h"
+
+typedef struct _GdkHeadlessDevice GdkHeadlessDevice;
+typedef struct _GdkDeviceClass GdkHeadlessDeviceClass;
+
+struct _GdkHeadlessDevice
+{
+  GdkDevice parent_instance;
+};
+
+G_DEFINE_TYPE (GdkHeadlessDevice, gdk_headless_device, GDK_TYPE_DEVICE)
+
+static void
+gdk_headless_device_set_surface_cursor (GdkDevice  *device,
+                                        GdkSurface *surface,
+                                        GdkCursor  *cursor)
+{
+}
+
+static void
+gdk_headless_device_query_state (GdkDevice        *device,
+                                 GdkSurface       *surface,
+                                 GdkSurface      **child_surface,
+                                 double           *win_x,
+                                 double           *win_y,
+                                 GdkModifierType  *mask)
+{
+  GdkHeadlessDisplay *display = GDK_HEADLESS_DISPLAY (gdk_device_get_display (device));
+  double x, y;
+
+  x = display->pointer_x;
+  y = display->pointer_y;
+
+  /* The pointer position is relative to the pointer surface */
+  if (surface != NULL && display->pointer_surface != NULL && surface != display->pointer_surface)
+    {
+      x += GDK_HEADLESS_SURFACE (display->pointer_surface)->root_x - GDK_HEADLESS_SURFACE (surface)->root_x;
+      y += GDK_HEADLESS_SURFACE (display->pointer_surface)->root_y - GDK_HEADLESS_SURFACE (surface)->root_y;
+    }
+
+  if (win_x)
+    *win_x = x;
+  if (win_y)
+    *win_y = y;
+  if (mask)
+    *mask = display->modifier_state;
+  if (child_surface)
+    *child_surface = surface == NULL ? display->pointer_surface : NULL;
+}
+
+static GdkGrabStatus
+gdk_headless_device_grab (GdkDevice    *device,
+                          GdkSurface   *surface,
+                          gboolean      owner_events,
+                          GdkEventMask  event_mask,
+                          GdkSurface   *confine_to,
+                          GdkCursor    *cursor,
+                          guint32       time_)
+{
+  return GDK_GRAB_SUCCESS;
+}
+
+static void
+gdk_headless_device_ungrab (GdkDevice *device,
+                            guint32    time_)
+{
+  GdkDisplay *display = gdk_device_get_display (device);
+  GdkDeviceGrabInfo *grab;
+
+  grab = _gdk_display_get_last_device_grab (display, device);
+  if (grab != NULL)
+    grab->serial_end = 0;
+
+  _gdk_display_device_grab_update (display, device, 0);
+}
+
+static GdkSurface *
+gdk_headless_device_surface_at_position (GdkDevice       *device,
+                                         double          *win_x,
+                                         double          *win_y,
+                                         GdkModifierType *mask)
+{
+  GdkSurface *surface = NULL;
+
+  gdk_headless_device_query_state (device, NULL, &surface, win_x, win_y, mask);
+
+  return surface;
+}
+
+static void
+gdk_headless_device_class_init (GdkHeadlessDeviceClass *klass)
+{
+  GdkDeviceClass *device_class = GDK_DEVICE_CLASS (klass);
+
+  device_class->set_surface_cursor = gdk_headless_device_set_surface_cursor;
+  device_class->query_state = gdk_headless_device_query_state;
+  device_class->grab = gdk_headless_device_grab;
+  device_class->ungrab = gdk_headless_device_ungrab;
+  device_class->surface_at_position = gdk_headless_device_surface_at_position;
+}
+
+static void
+gdk_headless_device_init (GdkHeadlessDevice *self)
+{
+  GdkDevice *device = GDK_DEVICE (self);
+
+  _gdk_device_add_axis (device, GDK_AXIS_X, 0, 0, 1);
+  _gdk_device_add_axis (device, GDK_AXIS_Y, 0, 0, 1);
+}
@@ -0,0 +1,470 @@
+/* gdkdisplay-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+#include "gdkdeviceprivate.h"
+#include "gdkmonitorprivate.h"
+#include "gdkseatdefaultprivate.h"
+
+#include <stdio.h>
+
+/**
+ * SECTION:gdkheadless
+ * @Short_description: Headless backend-specific functions
+ * @Title: Headless Interaction
+ * @Include: gdk/headless/gdkheadless.h
+ *
+ * The functions in this section are specific to the headless GDK
+ * backend, which keeps surfaces in memory instead of showing them,
+ * so that tests and benchmarks run the same on any machine. It is
+ * only used when it is selected with `GDK_BACKEND=headless`.
+ *
+ * Frames are timed by a virtual clock that advances by a fixed
+ * interval per frame. Input is injected with functions such as
+ * gdk_headless_surface_inject_button().
+ */
+
+#define DEFAULT_WIDTH 1024
+#define DEFAULT_HEIGHT 768
+
+G_DEFINE_TYPE (GdkHeadlessDisplay, gdk_headless_display, GDK_TYPE_DISPLAY)
+
+typedef struct
+{
+  GSource source;
+  GdkDisplay *display;
+} GdkHeadlessEventSource;
+
+static gboolean
+gdk_headless_event_source_prepare (GSource *source,
+                                   int     *timeout)
+{
+  GdkDisplay *display = ((GdkHeadlessEventSource *) source)->display;
+
+  *timeout = -1;
+
+  return _gdk_event_queue_find_first (display) != NULL;
+}
+
+static gboolean
+gdk_headless_event_source_check (GSource *source)
+{
+  GdkDisplay *display = ((GdkHeadlessEventSource *) source)->display;
+
+  return _gdk_event_queue_find_first (display) != NULL;
+}
+
+static gboolean
+gdk_headless_event_source_dispatch (GSource     *source,
+                                    GSourceFunc  callback,
+                                    gpointer     user_data)
+{
+  GdkDisplay *display = ((GdkHeadlessEventSource *) source)->display;
+  GdkEvent *event;
+
+  event = gdk_display_get_event (display);
+  if (event)
+    {
+      _gdk_event_emit (event);
+      gdk_event_unref (event);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs event_source_funcs = {
+  gdk_headless_event_source_prepare,
+  gdk_headless_event_source_check,
+  gdk_headless_event_source_dispatch,
+  NULL
+};
+
+static GSource *
+gdk_headless_event_source_new (GdkDisplay *display)
+{
+  GSource *source;
+
+  source = g_source_new (&event_source_funcs, sizeof (GdkHeadlessEventSource));
+  g_source_set_name (source, "GDK Headless Event source");
+  ((GdkHeadlessEventSource *) source)->display = display;
+
+  g_source_set_priority (source, GDK_PRIORITY_EVENTS);
+  g_source_set_can_recurse (source, TRUE);
+  g_source_attach (source, NULL);
+
+  return source;
+}
+
+/*< private >
+ * _gdk_headless_display_deliver_event:
+ * @display: a headless display
+ * @event: (transfer full): the event
+ *
+ * Queues @event as if it was just received from a display server.
+ */
+void
+_gdk_headless_display_deliver_event (GdkDisplay *display,
+                                     GdkEvent   *event)
+{
+  GdkHeadlessDisplay *self = GDK_HEADLESS_DISPLAY (display);
+  GList *node;
+
+  node = _gdk_event_queue_append (display, event);
+  _gdk_windowing_got_event (display, node, event, ++self->serial);
+}
+
+/* Parses GDK_HEADLESS_MONITOR, which looks like 1920x1080 or 1920x1080@2 */
+static void
+parse_monitor_geometry (int *width,
+                        int *height,
+                        int *scale)
+{
+  const char *spec;
+  int w, h, s;
+
+  spec = g_getenv ("GDK_HEADLESS_MONITOR");
+  if (spec == NULL)
+    return;
+
+  s = 1;
+  if (sscanf (spec, "%dx%d@%d", &w, &h, &s) < 2 ||
+      w <= 0 || h <= 0 || s <= 0)
+    {
+      g_warning ("Cannot parse GDK_HEADLESS_MONITOR \"%s\", expected WIDTHxHEIGHT[@SCALE]", spec);
+      return;
+    }
+
+  *width = w;
+  *height = h;
+  *scale = s;
+}
+
+static void
+gdk_headless_display_init (GdkHeadlessDisplay *self)
+{
+  int width, height;
+
+  gdk_display_set_input_shapes (GDK_DISPLAY (self), FALSE);
+  gdk_display_set_rgba (GDK_DISPLAY (self), TRUE);
+  gdk_display_set_composited (GDK_DISPLAY (self), TRUE);
+
+  self->free_running = TRUE;
+  self->frame_interval = GDK_HEADLESS_DEFAULT_FRAME_INTERVAL;
+
+  width = DEFAULT_WIDTH;
+  height = DEFAULT_HEIGHT;
+  self->scale_factor = 1;
+  parse_monitor_geometry (&width, &height, &self->scale_factor);
+
+  self->monitor = g_object_new (GDK_TYPE_MONITOR,
+                                "display", self,
+                                NULL);
+  gdk_monitor_set_manufacturer (self->monitor, "headless");
+  gdk_monitor_set_model (self->monitor, "0");
+  gdk_monitor_set_connector (self->monitor, "headless-0");
+  gdk_monitor_set_geometry (self->monitor, &(GdkRectangle) { 0, 0, width, height });
+  gdk_monitor_set_physical_size (self->monitor, width * 25.4 / 96, height * 25.4 / 96);
+  gdk_monitor_set_scale_factor (self->monitor, self->scale_factor);
+  gdk_monitor_set_refresh_rate (self->monitor, G_USEC_PER_SEC * 1000 / self->frame_interval);
+}
+
+static GdkDevice *
+create_device (GdkDisplay     *display,
+               const char     *name,
+               GdkInputSource  source,
+               gboolean        has_cursor)
+{
+  return g_object_new (GDK_TYPE_HEADLESS_DEVICE,
+                       "name", name,
+                       "source", source,
+                       "has-cursor", has_cursor,
+                       "display", display,
+                       NULL);
+}
+
+GdkDisplay *
+_gdk_headless_display_open (const char *display_name)
+{
+  GdkDisplay *display;
+  GdkHeadlessDisplay *self;
+  GdkSeat *seat;
+
+  display = g_object_new (GDK_TYPE_HEADLESS_DISPLAY, NULL);
+  self = GDK_HEADLESS_DISPLAY (display);
+
+  self->core_pointer = create_device (display, "Core Pointer", GDK_SOURCE_MOUSE, TRUE);
+  self->core_keyboard = create_device (display, "Core Keyboard", GDK_SOURCE_KEYBOARD, FALSE);
+  self->pointer = create_device (display, "Pointer", GDK_SOURCE_MOUSE, TRUE);
+  self->keyboard = create_device (display, "Keyboard", GDK_SOURCE_KEYBOARD, FALSE);
+
+  _gdk_device_set_associated_device (self->core_pointer, self->core_keyboard);
+  _gdk_device_set_associated_device (self->core_keyboard, self->core_pointer);
+  _gdk_device_set_associated_device (self->pointer, self->core_pointer);
+  _gdk_device_set_associated_device (self->keyboard, self->core_keyboard);
+
+  seat = gdk_seat_default_new_for_logical_pair (self->core_pointer, self->core_keyboard);
+  gdk_display_add_seat (display, seat);
+  gdk_seat_default_add_physical_device (GDK_SEAT_DEFAULT (seat), self->pointer);
+  gdk_seat_default_add_physical_device (GDK_SEAT_DEFAULT (seat), self->keyboard);
+  g_object_unref (seat);
+
+  self->event_source = gdk_headless_event_source_new (display);
+
+  g_signal_emit_by_name (display, "opened");
+
+  return display;
+}
+
+static const char *
+gdk_headless_display_get_name (GdkDisplay *display)
+{
+  return "Headless";
+}
+
+static void
+gdk_headless_display_beep (GdkDisplay *display)
+{
+}
+
+static void
+gdk_headless_display_sync (GdkDisplay *display)
+{
+}
+
+static void
+gdk_headless_display_flush (GdkDisplay *display)
+{
+}
+
+static gboolean
+gdk_headless_display_has_pending (GdkDisplay *display)
+{
+  return FALSE;
+}
+
+static void
+gdk_headless_display_queue_events (GdkDisplay *display)
+{
+}
+
+static gulong
+gdk_headless_display_get_next_serial (GdkDisplay *display)
+{
+  return GDK_HEADLESS_DISPLAY (display)->serial + 1;
+}
+
+static void
+gdk_headless_display_notify_startup_complete (GdkDisplay *display,
+                                              const char *startup_id)
+{
+}
+
+static GListModel *
+gdk_headless_display_get_monitors (GdkDisplay *display)
+{
+  GdkHeadlessDisplay *self = GDK_HEADLESS_DISPLAY (display);
+
+  if (self->monitors == NULL)
+    {
+      self->monitors = g_list_store_new (GDK_TYPE_MONITOR);
+      g_list_store_append (self->monitors, self->monitor);
+    }
+
+  return G_LIST_MODEL (self->monitors);
+}
+
+static gboolean
+gdk_headless_display_get_setting (GdkDisplay *display,
+                                  const char *name,
+                                  GValue     *value)
+{
+  return FALSE;
+}
+
+static void
+gdk_headless_display_dispose (GObject *object)
+{
+  GdkHeadlessDisplay *self = GDK_HEADLESS_DISPLAY (object);
+
+  if (self->event_source)
+    {
+      g_source_destroy (self->event_source);
+      g_source_unref (self->event_source);
+      self->event_source = NULL;
+    }
+  if (self->monitors)
+    {
+      g_list_store_remove_all (self->monitors);
+      g_clear_object (&self->monitors);
+    }
+
+  G_OBJECT_CLASS (gdk_headless_display_parent_class)->dispose (object);
+}
+
+static void
+gdk_headless_display_finalize (GObject *object)
+{
+  GdkHeadlessDisplay *self = GDK_HEADLESS_DISPLAY (object);
+
+  g_clear_object (&self->keymap);
+  g_object_unref (self->monitor);
+
+  G_OBJECT_CLASS (gdk_headless_display_parent_class)->finalize (object);
+}
+
+static void
+gdk_headless_display_class_init (GdkHeadlessDisplayClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+  GdkDisplayClass *display_class = GDK_DISPLAY_CLASS (class);
+
+  object_class->dispose = gdk_headless_display_dispose;
+  object_class->finalize = gdk_headless_display_finalize;
+
+  display_class->cairo_context_type = GDK_TYPE_HEADLESS_CAIRO_CONTEXT;
+
+  display_class->get_name = gdk_headless_display_get_name;
+  display_class->beep = gdk_headless_display_beep;
+  display_class->sync = gdk_headless_display_sync;
+  display_class->flush = gdk_headless_display_flush;
+  display_class->has_pending = gdk_headless_display_has_pending;
+  display_class->queue_events = gdk_headless_display_queue_events;
+
+  display_class->get_next_serial = gdk_headless_display_get_next_serial;
+  display_class->notify_startup_complete = gdk_headless_display_notify_startup_complete;
+  display_class->create_surface = _gdk_headless_display_create_surface;
+  display_class->get_keymap = _gdk_headless_display_get_keymap;
+
+  display_class->get_monitors = gdk_headless_display_get_monitors;
+  display_class->get_setting = gdk_headless_display_get_setting;
+}
+
+/**
+ * gdk_headless_display_set_free_running:
+ * @display: (type GdkHeadlessDisplay): a headless display
+ * @free_running: whether frames run on their own
+ *
+ * Sets whether frames are run as soon as they are requested, or
+ * only when gdk_headless_display_run_frame() is called.
+ *
+ * Free running frames don't wait for the frame interval to pass,
+ * so animations run as fast as the machine allows, while their
+ * frame times still advance by the interval. This is the default.
+ */
+void
+gdk_headless_display_set_free_running (GdkHeadlessDisplay *display,
+                                       gboolean            free_running)
+{
+  GList *l;
+
+  g_return_if_fail (GDK_IS_HEADLESS_DISPLAY (display));
+
+  free_running = !!free_running;
+  if (display->free_running == free_running)
+    return;
+
+  display->free_running = free_running;
+
+  for (l = display->frame_clocks; l; l = l->next)
+    _gdk_headless_frame_clock_reschedule (l->data);
+}
+
+/**
+ * gdk_headless_display_get_free_running:
+ * @display: (type GdkHeadlessDisplay): a headless display
+ *
+ * Gets whether frames are run as soon as they are requested.
+ * See gdk_headless_display_set_free_running().
+ *
+ * Returns: %TRUE if frames run on their own
+ */
+gboolean
+gdk_headless_display_get_free_running (GdkHeadlessDisplay *display)
+{
+  g_return_val_if_fail (GDK_IS_HEADLESS_DISPLAY (display), FALSE);
+
+  return display->free_running;
+}
+
+/**
+ * gdk_headless_display_set_frame_interval:
+ * @display: (type GdkHeadlessDisplay): a headless display
+ * @interval: the frame interval, in microseconds
+ *
+ * Sets how far the frame time of the frame clocks of @display
+ * advances with each frame. The default is 16667, which makes
+ * the display look like it refreshes 60 times a second.
+ */
+void
+gdk_headless_display_set_frame_interval (GdkHeadlessDisplay *display,
+                                         gint64              interval)
+{
+  g_return_if_fail (GDK_IS_HEADLESS_DISPLAY (display));
+  g_return_if_fail (interval > 0);
+
+  display->frame_interval = interval;
+  gdk_monitor_set_refresh_rate (display->monitor, G_USEC_PER_SEC * 1000 / interval);
+}
+
+/**
+ * gdk_headless_display_get_frame_interval:
+ * @display: (type GdkHeadlessDisplay): a headless display
+ *
+ * Gets how far the frame time advances with each frame.
+ *
+ * Returns: the frame interval, in microseconds
+ */
+gint64
+gdk_headless_display_get_frame_interval (GdkHeadlessDisplay *display)
+{
+  g_return_val_if_fail (GDK_IS_HEADLESS_DISPLAY (display), 0);
+
+  return display->frame_interval;
+}
+
+/**
+ * gdk_headless_display_run_frame:
+ * @display: (type GdkHeadlessDisplay): a headless display
+ *
+ * Runs one frame on each frame clock of @display that has
+ * anything to do, right away.
+ *
+ * This is the only way frames are run when the display is not
+ * free running. Events that are still queued are not delivered
+ * by this function, iterate the main context for that.
+ *
+ * Returns: %TRUE if a frame was run
+ */
+gboolean
+gdk_headless_display_run_frame (GdkHeadlessDisplay *display)
+{
+  GList *clocks, *l;
+  gboolean ran = FALSE;
+
+  g_return_val_if_fail (GDK_IS_HEADLESS_DISPLAY (display), FALSE);
+
+  clocks = g_list_copy_deep (display->frame_clocks, (GCopyFunc) g_object_ref, NULL);
+
+  for (l = clocks; l; l = l->next)
+    ran |= _gdk_headless_frame_clock_run_frame (l->data);
+
+  g_list_free_full (clocks, g_object_unref);
+
+  return ran;
+}
@@ -0,0 +1,397 @@
+/* gdkframeclock-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+#include "gdkprofilerprivate.h"
+
+/* A frame clock that runs on virtual time. Each frame advances the
+ * frame time by the frame interval of the display, no matter how
+ * long it took to produce, so animations and kinetic scrolling look
+ * the same on every run.
+ *
+ * When the display is free running, a frame is started from an idle
+ * as soon as one is requested, without waiting for the interval to
+ * pass. Otherwise frames only run from gdk_headless_display_run_frame().
+ */
+
+typedef struct _GdkHeadlessFrameClock GdkHeadlessFrameClock;
+typedef struct _GdkFrameClockClass GdkHeadlessFrameClockClass;
+
+#define GDK_HEADLESS_FRAME_CLOCK(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GDK_TYPE_HEADLESS_FRAME_CLOCK, GdkHeadlessFrameClock))
+
+struct _GdkHeadlessFrameClock
+{
+  GdkFrameClock parent_instance;
+
+  /* unowned, the display outlives the surfaces using the clock */
+  GdkHeadlessDisplay *display;
+
+  gint64 frame_time;
+
+  GdkFrameClockPhase requested;
+  GdkFrameClockPhase phase;
+  int updating_count;
+  int freeze_count;
+
+  guint idle_id;
+  guint in_frame : 1;
+};
+
+G_DEFINE_TYPE (GdkHeadlessFrameClock, gdk_headless_frame_clock, GDK_TYPE_FRAME_CLOCK)
+
+#define HAS_WORK(self)                                  \
+  ((self)->freeze_count == 0 &&                         \
+   ((self)->requested != 0 || (self)->updating_count > 0))
+
+#define NEEDS_PAINT(self)                                                                       \
+  (((self)->requested & ~(GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS | GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS)) != 0 || \
+   (self)->updating_count > 0)
+
+static void
+gdk_headless_frame_clock_init (GdkHeadlessFrameClock *self)
+{
+}
+
+static void
+gdk_headless_frame_clock_dispose (GObject *object)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (object);
+
+  g_clear_handle_id (&self->idle_id, g_source_remove);
+
+  if (self->display)
+    {
+      self->display->frame_clocks = g_list_remove (self->display->frame_clocks, self);
+      self->display = NULL;
+    }
+
+  G_OBJECT_CLASS (gdk_headless_frame_clock_parent_class)->dispose (object);
+}
+
+static gint64
+gdk_headless_frame_clock_get_frame_time (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  if (self->frame_time == 0)
+    return GDK_HEADLESS_FRAME_TIME_START;
+
+  return self->frame_time;
+}
+
+static gboolean
+run_frame_idle (gpointer data)
+{
+  GdkHeadlessFrameClock *self = data;
+
+  self->idle_id = 0;
+  _gdk_headless_frame_clock_run_frame (GDK_FRAME_CLOCK (self));
+
+  return G_SOURCE_REMOVE;
+}
+
+/*< private >
+ * _gdk_headless_frame_clock_reschedule:
+ * @clock: a headless frame clock
+ *
+ * Starts or stops the idle that runs frames, after the clock
+ * was asked for a frame or the display changed how it runs them.
+ */
+void
+_gdk_headless_frame_clock_reschedule (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+  gboolean run;
+
+  run = self->display != NULL &&
+        self->display->free_running &&
+        !self->in_frame &&
+        HAS_WORK (self);
+
+  if (run && self->idle_id == 0)
+    {
+      self->idle_id = g_idle_add_full (GDK_PRIORITY_REDRAW,
+                                       run_frame_idle,
+                                       g_object_ref (self),
+                                       g_object_unref);
+      g_source_set_name_by_id (self->idle_id, "[gtk] gdk_headless_frame_clock_run_frame");
+    }
+  else if (!run && self->idle_id != 0)
+    {
+      g_clear_handle_id (&self->idle_id, g_source_remove);
+    }
+}
+
+static void
+begin_frame (GdkHeadlessFrameClock *self)
+{
+  GdkFrameClock *clock = GDK_FRAME_CLOCK (self);
+  GdkFrameTimings *timings;
+  gint64 interval = self->display->frame_interval;
+
+  if (self->frame_time == 0)
+    self->frame_time = GDK_HEADLESS_FRAME_TIME_START;
+  else
+    self->frame_time += interval;
+
+  _gdk_frame_clock_begin_frame (clock);
+
+  timings = gdk_frame_clock_get_current_timings (clock);
+  timings->frame_time = self->frame_time;
+  timings->smoothed_frame_time = self->frame_time;
+  timings->refresh_interval = interval;
+  timings->predicted_presentation_time = self->frame_time + interval;
+}
+
+static void
+complete_frame (GdkHeadlessFrameClock *self)
+{
+  GdkFrameClock *clock = GDK_FRAME_CLOCK (self);
+  GdkFrameTimings *timings;
+
+  timings = gdk_frame_clock_get_current_timings (clock);
+  if (timings == NULL)
+    return;
+
+  /* Nothing waits for the frame to be shown, it is presented
+   * right when the interval is over.
+   */
+  timings->presentation_time = timings->predicted_presentation_time;
+  timings->complete = TRUE;
+
+#ifdef G_ENABLE_DEBUG
+  if (GDK_DEBUG_CHECK (FRAMES))
+    _gdk_frame_clock_debug_print_timings (clock, timings);
+#endif
+
+  if (GDK_PROFILER_IS_RUNNING)
+    _gdk_frame_clock_add_timings_to_profiler (clock, timings);
+}
+
+/*< private >
+ * _gdk_headless_frame_clock_run_frame:
+ * @clock: a headless frame clock
+ *
+ * Runs the phases that were requested from @clock, if any,
+ * advancing its frame time by one frame interval.
+ *
+ * Returns: %TRUE if there was anything to do
+ */
+gboolean
+_gdk_headless_frame_clock_run_frame (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+  gint64 before;
+  int iter;
+
+  if (self->in_frame || !HAS_WORK (self))
+    return FALSE;
+
+  before = g_get_monotonic_time ();
+
+  g_object_ref (self);
+  self->in_frame = TRUE;
+  g_clear_handle_id (&self->idle_id, g_source_remove);
+
+  if (self->requested & GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS)
+    {
+      self->requested &= ~GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS;
+      _gdk_frame_clock_emit_flush_events (clock);
+    }
+
+  if (NEEDS_PAINT (self))
+    {
+      /* Like the idle clock, we pick up where a freeze stopped us */
+      switch (self->phase)
+        {
+        case GDK_FRAME_CLOCK_PHASE_NONE:
+        case GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS:
+        case GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT:
+          if (self->freeze_count == 0)
+            {
+              begin_frame (self);
+
+              self->phase = GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
+              self->requested &= ~GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
+              _gdk_frame_clock_emit_before_paint (clock);
+              self->phase = GDK_FRAME_CLOCK_PHASE_UPDATE;
+            }
+          G_GNUC_FALLTHROUGH;
+
+        case GDK_FRAME_CLOCK_PHASE_UPDATE:
+          if (self->freeze_count == 0)
+            {
+              if ((self->requested & GDK_FRAME_CLOCK_PHASE_UPDATE) != 0 ||
+                  self->updating_count > 0)
+                {
+                  self->requested &= ~GDK_FRAME_CLOCK_PHASE_UPDATE;
+                  _gdk_frame_clock_emit_update (clock);
+                }
+            }
+          G_GNUC_FALLTHROUGH;
+
+        case GDK_FRAME_CLOCK_PHASE_LAYOUT:
+          if (self->freeze_count == 0)
+            {
+              self->phase = GDK_FRAME_CLOCK_PHASE_LAYOUT;
+              iter = 0;
+              while ((self->requested & GDK_FRAME_CLOCK_PHASE_LAYOUT) &&
+                     self->freeze_count == 0 && iter++ < 4)
+                {
+                  self->requested &= ~GDK_FRAME_CLOCK_PHASE_LAYOUT;
+                  _gdk_frame_clock_emit_layout (clock);
+                }
+              if (iter == 5)
+                g_warning ("gdk-frame-clock: layout continuously requested, giving up after 4 tries");
+            }
+          G_GNUC_FALLTHROUGH;
+
+        case GDK_FRAME_CLOCK_PHASE_PAINT:
+          if (self->freeze_count == 0)
+            {
+              self->phase = GDK_FRAME_CLOCK_PHASE_PAINT;
+              if (self->requested & GDK_FRAME_CLOCK_PHASE_PAINT)
+                {
+                  self->requested &= ~GDK_FRAME_CLOCK_PHASE_PAINT;
+                  _gdk_frame_clock_emit_paint (clock);
+                }
+            }
+          G_GNUC_FALLTHROUGH;
+
+        case GDK_FRAME_CLOCK_PHASE_AFTER_PAINT:
+          if (self->freeze_count == 0)
+            {
+              self->requested &= ~GDK_FRAME_CLOCK_PHASE_AFTER_PAINT;
+              _gdk_frame_clock_emit_after_paint (clock);
+              complete_frame (self);
+              self->phase = GDK_FRAME_CLOCK_PHASE_NONE;
+            }
+          G_GNUC_FALLTHROUGH;
+
+        case GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS:
+        default:
+          ;
+        }
+    }
+
+  if (self->requested & GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS)
+    {
+      self->requested &= ~GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS;
+      _gdk_frame_clock_emit_resume_events (clock);
+    }
+
+  if (self->freeze_count == 0)
+    self->phase = GDK_FRAME_CLOCK_PHASE_NONE;
+
+  self->in_frame = FALSE;
+  _gdk_headless_frame_clock_reschedule (clock);
+
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_end_mark (before, "frameclock cycle", NULL);
+
+  g_object_unref (self);
+
+  return TRUE;
+}
+
+static void
+gdk_headless_frame_clock_request_phase (GdkFrameClock      *clock,
+                                        GdkFrameClockPhase  phase)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  self->requested |= phase;
+  _gdk_headless_frame_clock_reschedule (clock);
+}
+
+static void
+gdk_headless_frame_clock_begin_updating (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  self->updating_count++;
+  _gdk_headless_frame_clock_reschedule (clock);
+}
+
+static void
+gdk_headless_frame_clock_end_updating (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  g_return_if_fail (self->updating_count > 0);
+
+  self->updating_count--;
+  _gdk_headless_frame_clock_reschedule (clock);
+}
+
+static void
+gdk_headless_frame_clock_freeze (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  self->freeze_count++;
+  _gdk_headless_frame_clock_reschedule (clock);
+}
+
+static void
+gdk_headless_frame_clock_thaw (GdkFrameClock *clock)
+{
+  GdkHeadlessFrameClock *self = GDK_HEADLESS_FRAME_CLOCK (clock);
+
+  g_return_if_fail (self->freeze_count > 0);
+
+  self->freeze_count--;
+  if (self->freeze_count == 0)
+    {
+      _gdk_headless_frame_clock_reschedule (clock);
+
+      /* Nothing will finish the frame if nothing more was requested */
+      if (!HAS_WORK (self))
+        self->phase = GDK_FRAME_CLOCK_PHASE_NONE;
+    }
+}
+
+static void
+gdk_headless_frame_clock_class_init (GdkHeadlessFrameClockClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GdkFrameClockClass *frame_clock_class = GDK_FRAME_CLOCK_CLASS (klass);
+
+  object_class->dispose = gdk_headless_frame_clock_dispose;
+
+  frame_clock_class->get_frame_time = gdk_headless_frame_clock_get_frame_time;
+  frame_clock_class->request_phase = gdk_headless_frame_clock_request_phase;
+  frame_clock_class->begin_updating = gdk_headless_frame_clock_begin_updating;
+  frame_clock_class->end_updating = gdk_headless_frame_clock_end_updating;
+  frame_clock_class->freeze = gdk_headless_frame_clock_freeze;
+  frame_clock_class->thaw = gdk_headless_frame_clock_thaw;
+}
+
+GdkFrameClock *
+_gdk_headless_frame_clock_new (GdkHeadlessDisplay *display)
+{
+  GdkHeadlessFrameClock *self;
+
+  self = g_object_new (GDK_TYPE_HEADLESS_FRAME_CLOCK, NULL);
+  self->display = display;
+
+  display->frame_clocks = g_list_prepend (display->frame_clocks, self);
+
+  return GDK_FRAME_CLOCK (self);
+}
@@ -0,0 +1,60 @@
+/* gdkheadlessdisplay.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GDK_HEADLESS_DISPLAY_H__
+#define __GDK_HEADLESS_DISPLAY_H__
+
+#if !defined (__GDKHEADLESS_H_INSIDE__) && !defined (GTK_COMPILATION)
+#error "Only <gdk/headless/gdkheadless.h> can be included directly."
+#endif
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+#ifdef GTK_COMPILATION
+typedef struct _GdkHeadlessDisplay GdkHeadlessDisplay;
+#else
+typedef GdkDisplay GdkHeadlessDisplay;
+#endif
+typedef struct _GdkHeadlessDisplayClass GdkHeadlessDisplayClass;
+
+#define GDK_TYPE_HEADLESS_DISPLAY              (gdk_headless_display_get_type())
+#define GDK_HEADLESS_DISPLAY(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), GDK_TYPE_HEADLESS_DISPLAY, GdkHeadlessDisplay))
+#define GDK_HEADLESS_DISPLAY_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), GDK_TYPE_HEADLESS_DISPLAY, GdkHeadlessDisplayClass))
+#define GDK_IS_HEADLESS_DISPLAY(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), GDK_TYPE_HEADLESS_DISPLAY))
+#define GDK_IS_HEADLESS_DISPLAY_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), GDK_TYPE_HEADLESS_DISPLAY))
+#define GDK_HEADLESS_DISPLAY_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), GDK_TYPE_HEADLESS_DISPLAY, GdkHeadlessDisplayClass))
+
+GDK_AVAILABLE_IN_ALL
+GType                   gdk_headless_display_get_type            (void);
+
+GDK_AVAILABLE_IN_ALL
+void                    gdk_headless_display_set_free_running    (GdkHeadlessDisplay *display,
+                                                                  gboolean            free_running);
+GDK_AVAILABLE_IN_ALL
+gboolean                gdk_headless_display_get_free_running    (GdkHeadlessDisplay *display);
+GDK_AVAILABLE_IN_ALL
+void                    gdk_headless_display_set_frame_interval  (GdkHeadlessDisplay *display,
+                                                                  gint64              interval);
+GDK_AVAILABLE_IN_ALL
+gint64                  gdk_headless_display_get_frame_interval  (GdkHeadlessDisplay *display);
+GDK_AVAILABLE_IN_ALL
+gboolean                gdk_headless_display_run_frame           (GdkHeadlessDisplay *display);
+
+G_END_DECLS
+
+#endif /* __GDK_HEADLESS_DISPLAY_H__ */
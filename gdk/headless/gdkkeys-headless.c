@@ -0,0 +1,166 @@
+/* gdkkeys-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+#include "gdkkeysprivate.h"
+
+/* There is no keyboard layout, injected key events use the keyval
+ * as the keycode, and every keyval is on its own key.
+ */
+
+typedef struct _GdkHeadlessKeymap GdkHeadlessKeymap;
+typedef struct _GdkKeymapClass GdkHeadlessKeymapClass;
+
+struct _GdkHeadlessKeymap
+{
+  GdkKeymap parent_instance;
+};
+
+static GType gdk_headless_keymap_get_type (void);
+
+G_DEFINE_TYPE (GdkHeadlessKeymap, gdk_headless_keymap, GDK_TYPE_KEYMAP)
+
+static void
+gdk_headless_keymap_init (GdkHeadlessKeymap *keymap)
+{
+}
+
+GdkKeymap *
+_gdk_headless_display_get_keymap (GdkDisplay *display)
+{
+  GdkHeadlessDisplay *self = GDK_HEADLESS_DISPLAY (display);
+
+  if (!self->keymap)
+    {
+      self->keymap = g_object_new (gdk_headless_keymap_get_type (), NULL);
+      self->keymap->display = display;
+    }
+
+  return self->keymap;
+}
+
+static PangoDirection
+gdk_headless_keymap_get_direction (GdkKeymap *keymap)
+{
+  return PANGO_DIRECTION_NEUTRAL;
+}
+
+static gboolean
+gdk_headless_keymap_have_bidi_layouts (GdkKeymap *keymap)
+{
+  return FALSE;
+}
+
+static gboolean
+gdk_headless_keymap_get_lock_state (GdkKeymap *keymap)
+{
+  return FALSE;
+}
+
+static gboolean
+gdk_headless_keymap_get_entries_for_keyval (GdkKeymap *keymap,
+                                            guint      keyval,
+                                            GArray    *retval)
+{
+  GdkKeymapKey key;
+
+  key.keycode = keyval;
+  key.group = 0;
+  key.level = 0;
+
+  g_array_append_val (retval, key);
+
+  return TRUE;
+}
+
+static gboolean
+gdk_headless_keymap_get_entries_for_keycode (GdkKeymap     *keymap,
+                                             guint          hardware_keycode,
+                                             GdkKeymapKey **keys,
+                                             guint        **keyvals,
+                                             int           *n_entries)
+{
+  if (n_entries)
+    *n_entries = 1;
+  if (keys)
+    {
+      *keys = g_new0 (GdkKeymapKey, 1);
+      (*keys)->keycode = hardware_keycode;
+    }
+  if (keyvals)
+    {
+      *keyvals = g_new0 (guint, 1);
+      (*keyvals)[0] = hardware_keycode;
+    }
+
+  return TRUE;
+}
+
+static guint
+gdk_headless_keymap_lookup_key (GdkKeymap          *keymap,
+                                const GdkKeymapKey *key)
+{
+  return key->keycode;
+}
+
+static gboolean
+gdk_headless_keymap_translate_keyboard_state (GdkKeymap       *keymap,
+                                              guint            hardware_keycode,
+                                              GdkModifierType  state,
+                                              int              group,
+                                              guint           *keyval,
+                                              int             *effective_group,
+                                              int             *level,
+                                              GdkModifierType *consumed_modifiers)
+{
+  if (keyval)
+    *keyval = hardware_keycode;
+  if (effective_group)
+    *effective_group = 0;
+  if (level)
+    *level = 0;
+  if (consumed_modifiers)
+    *consumed_modifiers = 0;
+
+  return TRUE;
+}
+
+static guint
+gdk_headless_keymap_get_modifier_state (GdkKeymap *keymap)
+{
+  return GDK_HEADLESS_DISPLAY (keymap->display)->modifier_state &
+         (GDK_SHIFT_MASK | GDK_CONTROL_MASK | GDK_ALT_MASK | GDK_SUPER_MASK | GDK_META_MASK);
+}
+
+static void
+gdk_headless_keymap_class_init (GdkHeadlessKeymapClass *klass)
+{
+  GdkKeymapClass *keymap_class = GDK_KEYMAP_CLASS (klass);
+
+  keymap_class->get_direction = gdk_headless_keymap_get_direction;
+  keymap_class->have_bidi_layouts = gdk_headless_keymap_have_bidi_layouts;
+  keymap_class->get_caps_lock_state = gdk_headless_keymap_get_lock_state;
+  keymap_class->get_num_lock_state = gdk_headless_keymap_get_lock_state;
+  keymap_class->get_scroll_lock_state = gdk_headless_keymap_get_lock_state;
+  keymap_class->get_entries_for_keyval = gdk_headless_keymap_get_entries_for_keyval;
+  keymap_class->get_entries_for_keycode = gdk_headless_keymap_get_entries_for_keycode;
+  keymap_class->lookup_key = gdk_headless_keymap_lookup_key;
+  keymap_class->translate_keyboard_state = gdk_headless_keymap_translate_keyboard_state;
+  keymap_class->get_modifier_state = gdk_headless_keymap_get_modifier_state;
+}
@@ -0,0 +1,130 @@
+/* gdkprivate-headless.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Private uninstalled header defining things local to the headless backend
+ */
+
+#ifndef __GDK_PRIVATE_HEADLESS_H__
+#define __GDK_PRIVATE_HEADLESS_H__
+
+#include "gdkheadlessdisplay.h"
+#include "gdkheadlesssurface.h"
+
+#include "gdkcairocontextprivate.h"
+#include "gdkdisplayprivate.h"
+#include "gdkframeclockprivate.h"
+#include "gdkinternals.h"
+#include "gdksurfaceprivate.h"
+
+G_BEGIN_DECLS
+
+/* Virtual frame time of the first frame, in microseconds */
+#define GDK_HEADLESS_FRAME_TIME_START G_USEC_PER_SEC
+#define GDK_HEADLESS_DEFAULT_FRAME_INTERVAL 16667
+
+struct _GdkHeadlessDisplay
+{
+  GdkDisplay parent_instance;
+
+  GdkDevice *core_pointer;
+  GdkDevice *core_keyboard;
+  GdkDevice *pointer;
+  GdkDevice *keyboard;
+
+  GSource *event_source;
+  GdkKeymap *keymap;
+
+  GListStore *monitors;
+  GdkMonitor *monitor;
+  int scale_factor;
+
+  GList *toplevels;
+  GList *frame_clocks;
+  gint64 frame_interval;
+  guint free_running : 1;
+
+  gulong serial;
+  guint32 event_time;
+
+  /* The state that injected events are relative to */
+  GdkSurface *pointer_surface;
+  GdkSurface *focus_surface;
+  double pointer_x;
+  double pointer_y;
+  GdkModifierType modifier_state;
+};
+
+struct _GdkHeadlessDisplayClass
+{
+  GdkDisplayClass parent_class;
+};
+
+struct _GdkHeadlessSurface
+{
+  GdkSurface parent_instance;
+
+  /* What was drawn into the surface, in device pixels */
+  cairo_surface_t *contents;
+
+  gboolean maximized;
+  int pre_maximize_x;
+  int pre_maximize_y;
+  int pre_maximize_width;
+  int pre_maximize_height;
+
+  GdkGeometry geometry_hints;
+  GdkSurfaceHints geometry_hints_mask;
+
+  int root_x;
+  int root_y;
+};
+
+struct _GdkHeadlessSurfaceClass
+{
+  GdkSurfaceClass parent_class;
+};
+
+#define GDK_TYPE_HEADLESS_DEVICE        (gdk_headless_device_get_type ())
+#define GDK_TYPE_HEADLESS_CAIRO_CONTEXT (gdk_headless_cairo_context_get_type ())
+#define GDK_TYPE_HEADLESS_FRAME_CLOCK   (gdk_headless_frame_clock_get_type ())
+
+GType gdk_headless_device_get_type        (void) G_GNUC_CONST;
+GType gdk_headless_cairo_context_get_type (void) G_GNUC_CONST;
+GType gdk_headless_frame_clock_get_type   (void) G_GNUC_CONST;
+
+GdkDisplay *    _gdk_headless_display_open            (const char         *display_name);
+GdkKeymap *     _gdk_headless_display_get_keymap      (GdkDisplay         *display);
+void            _gdk_headless_display_deliver_event   (GdkDisplay         *display,
+                                                       GdkEvent           *event);
+GdkSurface *    _gdk_headless_display_create_surface  (GdkDisplay         *display,
+                                                       GdkSurfaceType      surface_type,
+                                                       GdkSurface         *parent,
+                                                       int                 x,
+                                                       int                 y,
+                                                       int                 width,
+                                                       int                 height);
+
+void            _gdk_headless_surface_ensure_contents (GdkSurface         *surface,
+                                                       cairo_region_t     *region);
+
+GdkFrameClock * _gdk_headless_frame_clock_new         (GdkHeadlessDisplay *display);
+gboolean        _gdk_headless_frame_clock_run_frame   (GdkFrameClock      *clock);
+void            _gdk_headless_frame_clock_reschedule  (GdkFrameClock      *clock);
+
+G_END_DECLS
+
+#endif /* __GDK_PRIVATE_HEADLESS_H__ */
@@ -0,0 +1,1308 @@
+/* gdksurface-headless.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkprivate-headless.h"
+
+#include "gdkdeviceprivate.h"
+#include "gdkdragsurfaceprivate.h"
+#include "gdkeventsprivate.h"
+#include "gdkkeysyms.h"
+#include "gdkmonitorprivate.h"
+#include "gdkpopupprivate.h"
+#include "gdktextureprivate.h"
+#include "gdktoplevelprivate.h"
+
+G_DEFINE_TYPE (GdkHeadlessSurface, gdk_headless_surface, GDK_TYPE_SURFACE)
+
+GType gdk_headless_toplevel_get_type (void) G_GNUC_CONST;
+GType gdk_headless_popup_get_type (void) G_GNUC_CONST;
+GType gdk_headless_drag_surface_get_type (void) G_GNUC_CONST;
+
+#define GDK_TYPE_HEADLESS_TOPLEVEL (gdk_headless_toplevel_get_type ())
+#define GDK_TYPE_HEADLESS_POPUP (gdk_headless_popup_get_type ())
+#define GDK_TYPE_HEADLESS_DRAG_SURFACE (gdk_headless_drag_surface_get_type ())
+
+static void
+gdk_headless_surface_init (GdkHeadlessSurface *impl)
+{
+}
+
+static void
+gdk_headless_surface_finalize (GObject *object)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (object);
+  GdkHeadlessDisplay *display;
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (GDK_SURFACE (impl)));
+  display->toplevels = g_list_remove (display->toplevels, impl);
+
+  g_clear_pointer (&impl->contents, cairo_surface_destroy);
+
+  G_OBJECT_CLASS (gdk_headless_surface_parent_class)->finalize (object);
+}
+
+GdkSurface *
+_gdk_headless_display_create_surface (GdkDisplay     *display,
+                                      GdkSurfaceType  surface_type,
+                                      GdkSurface     *parent,
+                                      int             x,
+                                      int             y,
+                                      int             width,
+                                      int             height)
+{
+  GdkHeadlessDisplay *headless_display = GDK_HEADLESS_DISPLAY (display);
+  GdkFrameClock *frame_clock;
+  GdkSurface *surface;
+  GdkHeadlessSurface *impl;
+  GType type;
+
+  if (parent)
+    frame_clock = g_object_ref (gdk_surface_get_frame_clock (parent));
+  else
+    frame_clock = _gdk_headless_frame_clock_new (headless_display);
+
+  switch (surface_type)
+    {
+    case GDK_SURFACE_TOPLEVEL:
+      type = GDK_TYPE_HEADLESS_TOPLEVEL;
+      break;
+    case GDK_SURFACE_POPUP:
+      type = GDK_TYPE_HEADLESS_POPUP;
+      break;
+    case GDK_SURFACE_TEMP:
+      type = GDK_TYPE_HEADLESS_DRAG_SURFACE;
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+  surface = g_object_new (type,
+                          "display", display,
+                          "frame-clock", frame_clock,
+                          NULL);
+
+  g_object_unref (frame_clock);
+
+  surface->parent = parent;
+  surface->x = x;
+  surface->y = y;
+  surface->width = width;
+  surface->height = height;
+
+  impl = GDK_HEADLESS_SURFACE (surface);
+  impl->root_x = x;
+  impl->root_y = y;
+  if (parent)
+    {
+      impl->root_x += GDK_HEADLESS_SURFACE (parent)->root_x;
+      impl->root_y += GDK_HEADLESS_SURFACE (parent)->root_y;
+    }
+
+  g_object_ref (surface);
+
+  if (!surface->parent)
+    headless_display->toplevels = g_list_prepend (headless_display->toplevels, impl);
+
+  return surface;
+}
+
+/*< private >
+ * _gdk_headless_surface_ensure_contents:
+ * @surface: a headless surface
+ * @region: the region that is about to be drawn
+ *
+ * Makes sure the contents of @surface match its current size and
+ * scale. If they had to be recreated, all of @surface is added to
+ * @region, since nothing that was drawn before is left.
+ */
+void
+_gdk_headless_surface_ensure_contents (GdkSurface     *surface,
+                                       cairo_region_t *region)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+  int scale = gdk_surface_get_scale_factor (surface);
+  int width = MAX (surface->width, 1) * scale;
+  int height = MAX (surface->height, 1) * scale;
+
+  if (impl->contents != NULL &&
+      cairo_image_surface_get_width (impl->contents) == width &&
+      cairo_image_surface_get_height (impl->contents) == height)
+    return;
+
+  g_clear_pointer (&impl->contents, cairo_surface_destroy);
+  impl->contents = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cairo_surface_set_device_scale (impl->contents, scale, scale);
+
+  cairo_region_union_rectangle (region, &(cairo_rectangle_int_t) {
+                                  0, 0,
+                                  surface->width, surface->height
+                                });
+}
+
+static cairo_surface_t *
+gdk_headless_surface_ref_cairo_surface (GdkSurface *surface)
+{
+  if (GDK_SURFACE_DESTROYED (surface))
+    return NULL;
+
+  return cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+}
+
+static void
+gdk_headless_surface_grab_check_destroy (GdkSurface *surface)
+{
+  GdkDisplay *display = gdk_surface_get_display (surface);
+  GdkSeat *seat;
+  GdkDeviceGrabInfo *grab;
+  GList *devices, *d;
+
+  seat = gdk_display_get_default_seat (display);
+
+  devices = NULL;
+  devices = g_list_prepend (devices, gdk_seat_get_keyboard (seat));
+  devices = g_list_prepend (devices, gdk_seat_get_pointer (seat));
+
+  for (d = devices; d; d = d->next)
+    {
+      /* Make sure there is no lasting grab in this surface */
+      grab = _gdk_display_get_last_device_grab (display, d->data);
+
+      if (grab && grab->surface == surface)
+        {
+          grab->serial_end = grab->serial_start;
+          grab->implicit_ungrab = TRUE;
+        }
+    }
+
+  g_list_free (devices);
+}
+
+static void
+gdk_headless_surface_destroy (GdkSurface *surface,
+                              gboolean    foreign_destroy)
+{
+  GdkHeadlessDisplay *display;
+
+  g_return_if_fail (GDK_IS_SURFACE (surface));
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (surface));
+
+  if (display->pointer_surface == surface)
+    display->pointer_surface = NULL;
+  if (display->focus_surface == surface)
+    display->focus_surface = NULL;
+
+  gdk_headless_surface_grab_check_destroy (surface);
+}
+
+static void
+gdk_headless_surface_destroy_notify (GdkSurface *surface)
+{
+  if (!GDK_SURFACE_DESTROYED (surface))
+    _gdk_surface_destroy (surface, TRUE);
+
+  g_object_unref (surface);
+}
+
+static void
+gdk_headless_surface_hide (GdkSurface *surface)
+{
+  GdkHeadlessDisplay *display;
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (surface));
+
+  if (display->pointer_surface == surface)
+    display->pointer_surface = NULL;
+
+  _gdk_surface_clear_update_area (surface);
+}
+
+static int
+gdk_headless_surface_get_scale_factor (GdkSurface *surface)
+{
+  if (GDK_SURFACE_DESTROYED (surface))
+    return 1;
+
+  return GDK_HEADLESS_DISPLAY (gdk_surface_get_display (surface))->scale_factor;
+}
+
+static void
+sync_child_root_pos (GdkSurface *parent)
+{
+  GdkHeadlessSurface *parent_impl = GDK_HEADLESS_SURFACE (parent);
+  GList *l;
+
+  for (l = parent->children; l; l = l->next)
+    {
+      GdkHeadlessSurface *child_impl = l->data;
+      GdkSurface *child = GDK_SURFACE (child_impl);
+      int root_x, root_y;
+
+      root_x = child->x + parent_impl->root_x;
+      root_y = child->y + parent_impl->root_y;
+
+      if (root_x != child_impl->root_x ||
+          root_y != child_impl->root_y)
+        {
+          child_impl->root_x = root_x;
+          child_impl->root_y = root_y;
+          sync_child_root_pos (child);
+        }
+    }
+}
+
+/* x, y is relative to parent */
+static void
+gdk_headless_surface_move_resize_internal (GdkSurface *surface,
+                                           gboolean    with_move,
+                                           int         x,
+                                           int         y,
+                                           int         width,
+                                           int         height)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+
+  if (with_move)
+    {
+      surface->x = x;
+      surface->y = y;
+      impl->root_x = x;
+      impl->root_y = y;
+      if (surface->parent)
+        {
+          GdkHeadlessSurface *parent_impl = GDK_HEADLESS_SURFACE (surface->parent);
+          impl->root_x += parent_impl->root_x;
+          impl->root_y += parent_impl->root_y;
+        }
+      sync_child_root_pos (surface);
+    }
+
+  if (width > 0 || height > 0)
+    {
+      if (width < 1)
+        width = 1;
+
+      if (height < 1)
+        height = 1;
+
+      if (width != surface->width ||
+          height != surface->height)
+        {
+          GdkEvent *event;
+
+          surface->width = width;
+          surface->height = height;
+
+          event = gdk_configure_event_new (surface, width, height);
+          _gdk_surface_update_size (surface);
+          _gdk_headless_display_deliver_event (gdk_surface_get_display (surface), event);
+        }
+    }
+}
+
+static void
+gdk_headless_surface_move_resize (GdkSurface *surface,
+                                  int         x,
+                                  int         y,
+                                  int         width,
+                                  int         height)
+{
+  gdk_headless_surface_move_resize_internal (surface, TRUE,
+                                             x, y,
+                                             width, height);
+}
+
+static void
+gdk_headless_surface_toplevel_resize (GdkSurface *surface,
+                                      int         width,
+                                      int         height)
+{
+  gdk_headless_surface_move_resize_internal (surface, FALSE,
+                                             0, 0,
+                                             width, height);
+}
+
+static void
+gdk_headless_surface_move (GdkSurface *surface,
+                           int         x,
+                           int         y)
+{
+  gdk_headless_surface_move_resize_internal (surface, TRUE, x, y, -1, -1);
+}
+
+static void
+gdk_headless_surface_layout_popup (GdkSurface     *surface,
+                                   int             width,
+                                   int             height,
+                                   GdkPopupLayout *layout)
+{
+  GdkMonitor *monitor;
+  GdkRectangle bounds;
+  GdkRectangle final_rect;
+
+  monitor = gdk_surface_get_layout_monitor (surface, layout,
+                                            gdk_monitor_get_geometry);
+  gdk_monitor_get_geometry (monitor, &bounds);
+
+  gdk_surface_layout_popup_helper (surface,
+                                   width,
+                                   height,
+                                   monitor,
+                                   &bounds,
+                                   layout,
+                                   &final_rect);
+
+  gdk_headless_surface_move_resize (surface,
+                                    final_rect.x,
+                                    final_rect.y,
+                                    final_rect.width,
+                                    final_rect.height);
+}
+
+static void
+show_popup (GdkSurface *surface)
+{
+  gdk_synthesize_surface_state (surface, GDK_SURFACE_STATE_WITHDRAWN, 0);
+  gdk_surface_invalidate_rect (surface, NULL);
+}
+
+static void
+show_grabbing_popup (GdkSeat    *seat,
+                     GdkSurface *surface,
+                     gpointer    user_data)
+{
+  show_popup (surface);
+}
+
+static gboolean
+gdk_headless_surface_present_popup (GdkSurface     *surface,
+                                    int             width,
+                                    int             height,
+                                    GdkPopupLayout *layout)
+{
+  gdk_headless_surface_layout_popup (surface, width, height, layout);
+
+  if (GDK_SURFACE_IS_MAPPED (surface))
+    return TRUE;
+
+  if (surface->autohide)
+    {
+      gdk_seat_grab (gdk_display_get_default_seat (surface->display),
+                     surface,
+                     GDK_SEAT_CAPABILITY_ALL,
+                     TRUE,
+                     NULL, NULL,
+                     show_grabbing_popup, NULL);
+    }
+  else
+    {
+      show_popup (surface);
+    }
+
+  return GDK_SURFACE_IS_MAPPED (surface);
+}
+
+static void
+gdk_headless_surface_set_geometry_hints (GdkSurface        *surface,
+                                         const GdkGeometry *geometry,
+                                         GdkSurfaceHints    geom_mask)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+
+  impl->geometry_hints = *geometry;
+  impl->geometry_hints_mask = geom_mask;
+}
+
+static void
+gdk_headless_surface_get_geometry (GdkSurface *surface,
+                                   int        *x,
+                                   int        *y,
+                                   int        *width,
+                                   int        *height)
+{
+  g_return_if_fail (GDK_IS_SURFACE (surface));
+
+  if (x)
+    *x = surface->x;
+  if (y)
+    *y = surface->y;
+  if (width)
+    *width = surface->width;
+  if (height)
+    *height = surface->height;
+}
+
+static void
+gdk_headless_surface_get_root_coords (GdkSurface *surface,
+                                      int         x,
+                                      int         y,
+                                      int        *root_x,
+                                      int        *root_y)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+
+  if (root_x)
+    *root_x = x + impl->root_x;
+  if (root_y)
+    *root_y = y + impl->root_y;
+}
+
+static gboolean
+gdk_headless_surface_get_device_state (GdkSurface      *surface,
+                                       GdkDevice       *device,
+                                       double          *x,
+                                       double          *y,
+                                       GdkModifierType *mask)
+{
+  GdkSurface *child;
+
+  g_return_val_if_fail (surface == NULL || GDK_IS_SURFACE (surface), FALSE);
+
+  if (GDK_SURFACE_DESTROYED (surface))
+    return FALSE;
+
+  GDK_DEVICE_GET_CLASS (device)->query_state (device, surface,
+                                              &child,
+                                              x, y, mask);
+  return child != NULL;
+}
+
+static void
+gdk_headless_surface_set_input_region (GdkSurface     *surface,
+                                       cairo_region_t *shape_region)
+{
+}
+
+static gboolean
+gdk_headless_surface_beep (GdkSurface *surface)
+{
+  return FALSE;
+}
+
+static GdkDrag *
+gdk_headless_surface_drag_begin (GdkSurface         *surface,
+                                 GdkDevice          *device,
+                                 GdkContentProvider *content,
+                                 GdkDragAction       actions,
+                                 double              dx,
+                                 double              dy)
+{
+  return NULL;
+}
+
+static void
+gdk_headless_surface_maximize (GdkSurface *surface)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+  GdkRectangle geom;
+
+  if (GDK_SURFACE_DESTROYED (surface) || impl->maximized)
+    return;
+
+  impl->maximized = TRUE;
+
+  gdk_synthesize_surface_state (surface, 0, GDK_SURFACE_STATE_MAXIMIZED);
+
+  impl->pre_maximize_x = surface->x;
+  impl->pre_maximize_y = surface->y;
+  impl->pre_maximize_width = surface->width;
+  impl->pre_maximize_height = surface->height;
+
+  gdk_monitor_get_geometry (GDK_HEADLESS_DISPLAY (gdk_surface_get_display (surface))->monitor, &geom);
+
+  gdk_headless_surface_move_resize (surface,
+                                    geom.x, geom.y,
+                                    geom.width, geom.height);
+}
+
+static void
+gdk_headless_surface_unmaximize (GdkSurface *surface)
+{
+  GdkHeadlessSurface *impl = GDK_HEADLESS_SURFACE (surface);
+
+  if (GDK_SURFACE_DESTROYED (surface) || !impl->maximized)
+    return;
+
+  impl->maximized = FALSE;
+
+  gdk_synthesize_surface_state (surface, GDK_SURFACE_STATE_MAXIMIZED, 0);
+
+  gdk_headless_surface_move_resize (surface,
+                                    impl->pre_maximize_x,
+                                    impl->pre_maximize_y,
+                                    impl->pre_maximize_width,
+                                    impl->pre_maximize_height);
+}
+
+static void
+gdk_headless_surface_class_init (GdkHeadlessSurfaceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GdkSurfaceClass *impl_class = GDK_SURFACE_CLASS (klass);
+
+  object_class->finalize = gdk_headless_surface_finalize;
+
+  impl_class->ref_cairo_surface = gdk_headless_surface_ref_cairo_surface;
+  impl_class->hide = gdk_headless_surface_hide;
+  impl_class->get_geometry = gdk_headless_surface_get_geometry;
+  impl_class->get_root_coords = gdk_headless_surface_get_root_coords;
+  impl_class->get_device_state = gdk_headless_surface_get_device_state;
+  impl_class->set_input_region = gdk_headless_surface_set_input_region;
+  impl_class->destroy = gdk_headless_surface_destroy;
+  impl_class->beep = gdk_headless_surface_beep;
+  impl_class->destroy_notify = gdk_headless_surface_destroy_notify;
+  impl_class->drag_begin = gdk_headless_surface_drag_begin;
+  impl_class->get_scale_factor = gdk_headless_surface_get_scale_factor;
+}
+
+/**
+ * gdk_headless_surface_get_contents:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ *
+ * Gets a copy of what was last drawn into @surface, at the
+ * size of the surface in device pixels.
+ *
+ * Returns: (transfer full) (nullable): a new texture, or %NULL
+ *   if @surface has not been drawn yet
+ */
+GdkTexture *
+gdk_headless_surface_get_contents (GdkHeadlessSurface *surface)
+{
+  cairo_surface_t *copy;
+  GdkTexture *texture;
+  cairo_t *cr;
+
+  g_return_val_if_fail (GDK_IS_HEADLESS_SURFACE (surface), NULL);
+
+  if (surface->contents == NULL)
+    return NULL;
+
+  /* The texture keeps using the memory of the cairo surface,
+   * so it must not be the one that later frames draw into.
+   */
+  copy = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                     cairo_image_surface_get_width (surface->contents),
+                                     cairo_image_surface_get_height (surface->contents));
+  cr = cairo_create (copy);
+  cairo_set_source_surface (cr, surface->contents, 0, 0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  texture = gdk_texture_new_for_surface (copy);
+  cairo_surface_destroy (copy);
+
+  return texture;
+}
+
+/* Injected events get timestamps from the virtual frame time, so that
+ * they don't depend on how fast the machine runs, but never go back.
+ */
+static guint32
+next_event_time (GdkSurface *surface)
+{
+  GdkHeadlessDisplay *display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (surface));
+  GdkFrameClock *clock = gdk_surface_get_frame_clock (surface);
+  guint32 time;
+
+  time = clock ? gdk_frame_clock_get_frame_time (clock) / 1000 : 0;
+  display->event_time = MAX (display->event_time + 1, time);
+
+  return display->event_time;
+}
+
+static void
+deliver_crossing (GdkHeadlessDisplay *display,
+                  GdkSurface         *surface,
+                  GdkEventType        type,
+                  double              x,
+                  double              y)
+{
+  GdkEvent *event;
+
+  event = gdk_crossing_event_new (type,
+                                  surface,
+                                  display->core_pointer,
+                                  next_event_time (surface),
+                                  display->modifier_state,
+                                  x, y,
+                                  GDK_CROSSING_NORMAL,
+                                  GDK_NOTIFY_ANCESTOR);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+/**
+ * gdk_headless_surface_inject_motion:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ * @x: the new pointer x position, relative to @surface
+ * @y: the new pointer y position, relative to @surface
+ *
+ * Moves the pointer to the given position, as if the user
+ * moved the mouse there.
+ *
+ * If the pointer was over a different surface before, leave
+ * and enter events are sent as well.
+ *
+ * Like all injected events, the events are queued and only
+ * delivered when the main context is iterated.
+ */
+void
+gdk_headless_surface_inject_motion (GdkHeadlessSurface *surface,
+                                    double              x,
+                                    double              y)
+{
+  GdkSurface *gdk_surface = (GdkSurface *) surface;
+  GdkHeadlessDisplay *display;
+  GdkEvent *event;
+
+  g_return_if_fail (GDK_IS_HEADLESS_SURFACE (surface));
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (gdk_surface));
+
+  if (display->pointer_surface != gdk_surface)
+    {
+      if (display->pointer_surface)
+        deliver_crossing (display, display->pointer_surface, GDK_LEAVE_NOTIFY,
+                          x + surface->root_x - GDK_HEADLESS_SURFACE (display->pointer_surface)->root_x,
+                          y + surface->root_y - GDK_HEADLESS_SURFACE (display->pointer_surface)->root_y);
+
+      display->pointer_surface = gdk_surface;
+      deliver_crossing (display, gdk_surface, GDK_ENTER_NOTIFY, x, y);
+    }
+
+  display->pointer_x = x;
+  display->pointer_y = y;
+
+  event = gdk_motion_event_new (gdk_surface,
+                                display->core_pointer,
+                                NULL,
+                                next_event_time (gdk_surface),
+                                display->modifier_state,
+                                x, y,
+                                NULL);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+/**
+ * gdk_headless_surface_inject_button:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ * @button: the button number, starting at 1
+ * @pressed: %TRUE to press the button, %FALSE to release it
+ *
+ * Presses or releases a mouse button at the current pointer
+ * position, see gdk_headless_surface_inject_motion().
+ */
+void
+gdk_headless_surface_inject_button (GdkHeadlessSurface *surface,
+                                    guint               button,
+                                    gboolean            pressed)
+{
+  GdkSurface *gdk_surface = (GdkSurface *) surface;
+  GdkHeadlessDisplay *display;
+  GdkModifierType state;
+  GdkEvent *event;
+
+  g_return_if_fail (GDK_IS_HEADLESS_SURFACE (surface));
+  g_return_if_fail (button > 0);
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (gdk_surface));
+
+  /* The event has the state from before the button changed */
+  state = display->modifier_state;
+  if (button <= 5)
+    {
+      if (pressed)
+        display->modifier_state |= GDK_BUTTON1_MASK << (button - 1);
+      else
+        display->modifier_state &= ~(GDK_BUTTON1_MASK << (button - 1));
+    }
+
+  event = gdk_button_event_new (pressed ? GDK_BUTTON_PRESS : GDK_BUTTON_RELEASE,
+                                gdk_surface,
+                                display->core_pointer,
+                                NULL,
+                                next_event_time (gdk_surface),
+                                state,
+                                button,
+                                display->pointer_x,
+                                display->pointer_y,
+                                NULL);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+/**
+ * gdk_headless_surface_inject_scroll:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ * @delta_x: the horizontal scroll delta
+ * @delta_y: the vertical scroll delta
+ *
+ * Scrolls smoothly by the given deltas at the current
+ * pointer position.
+ */
+void
+gdk_headless_surface_inject_scroll (GdkHeadlessSurface *surface,
+                                    double              delta_x,
+                                    double              delta_y)
+{
+  GdkSurface *gdk_surface = (GdkSurface *) surface;
+  GdkHeadlessDisplay *display;
+  GdkEvent *event;
+
+  g_return_if_fail (GDK_IS_HEADLESS_SURFACE (surface));
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (gdk_surface));
+
+  event = gdk_scroll_event_new (gdk_surface,
+                                display->core_pointer,
+                                NULL,
+                                next_event_time (gdk_surface),
+                                display->modifier_state,
+                                delta_x, delta_y,
+                                FALSE);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+static GdkModifierType
+get_keyval_modifier (guint keyval)
+{
+  switch (keyval)
+    {
+    case GDK_KEY_Shift_L:
+    case GDK_KEY_Shift_R:
+      return GDK_SHIFT_MASK;
+    case GDK_KEY_Control_L:
+    case GDK_KEY_Control_R:
+      return GDK_CONTROL_MASK;
+    case GDK_KEY_Alt_L:
+    case GDK_KEY_Alt_R:
+      return GDK_ALT_MASK;
+    case GDK_KEY_Super_L:
+    case GDK_KEY_Super_R:
+      return GDK_SUPER_MASK;
+    case GDK_KEY_Meta_L:
+    case GDK_KEY_Meta_R:
+      return GDK_META_MASK;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * gdk_headless_surface_inject_key:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ * @keyval: the keyval of the key
+ * @pressed: %TRUE to press the key, %FALSE to release it
+ *
+ * Presses or releases a key. The headless backend has no
+ * keyboard layout, the key produces @keyval whatever the
+ * modifier state is.
+ *
+ * Pressing modifier keys such as %GDK_KEY_Control_L changes
+ * the modifier state of later events.
+ */
+void
+gdk_headless_surface_inject_key (GdkHeadlessSurface *surface,
+                                 guint               keyval,
+                                 gboolean            pressed)
+{
+  GdkSurface *gdk_surface = (GdkSurface *) surface;
+  GdkHeadlessDisplay *display;
+  GdkTranslatedKey translated;
+  GdkModifierType state, modifier;
+  GdkEvent *event;
+
+  g_return_if_fail (GDK_IS_HEADLESS_SURFACE (surface));
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (gdk_surface));
+
+  state = display->modifier_state;
+  modifier = get_keyval_modifier (keyval);
+  if (pressed)
+    display->modifier_state |= modifier;
+  else
+    display->modifier_state &= ~modifier;
+
+  translated.keyval = keyval;
+  translated.consumed = 0;
+  translated.layout = 0;
+  translated.level = 0;
+
+  event = gdk_key_event_new (pressed ? GDK_KEY_PRESS : GDK_KEY_RELEASE,
+                             gdk_surface,
+                             display->core_keyboard,
+                             next_event_time (gdk_surface),
+                             keyval,
+                             state,
+                             modifier != 0,
+                             &translated,
+                             &translated);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+/**
+ * gdk_headless_surface_inject_focus:
+ * @surface: (type GdkHeadlessSurface): a headless surface
+ *
+ * Moves the keyboard focus to @surface. The surface that had
+ * the focus before loses it.
+ *
+ * Toplevel surfaces get the focus when they are presented.
+ */
+void
+gdk_headless_surface_inject_focus (GdkHeadlessSurface *surface)
+{
+  GdkSurface *gdk_surface = (GdkSurface *) surface;
+  GdkHeadlessDisplay *display;
+  GdkEvent *event;
+
+  g_return_if_fail (GDK_IS_HEADLESS_SURFACE (surface));
+
+  display = GDK_HEADLESS_DISPLAY (gdk_surface_get_display (gdk_surface));
+
+  if (display->focus_surface == gdk_surface)
+    return;
+
+  if (display->focus_surface)
+    {
+      gdk_synthesize_surface_state (display->focus_surface, GDK_SURFACE_STATE_FOCUSED, 0);
+      event = gdk_focus_event_new (display->focus_surface, display->core_keyboard, FALSE);
+      _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+    }
+
+  display->focus_surface = gdk_surface;
+
+  gdk_synthesize_surface_state (gdk_surface, 0, GDK_SURFACE_STATE_FOCUSED);
+  event = gdk_focus_event_new (gdk_surface, display->core_keyboard, TRUE);
+  _gdk_headless_display_deliver_event (GDK_DISPLAY (display), event);
+}
+
+#define LAST_PROP 1
+
+typedef struct
+{
+  GdkHeadlessSurface parent_instance;
+} GdkHeadlessPopup;
+
+typedef struct
+{
+  GdkHeadlessSurfaceClass parent_class;
+} GdkHeadlessPopupClass;
+
+static void gdk_headless_popup_iface_init (GdkPopupInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GdkHeadlessPopup, gdk_headless_popup, GDK_TYPE_HEADLESS_SURFACE,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_POPUP,
+                                                gdk_headless_popup_iface_init))
+
+static void
+gdk_headless_popup_init (GdkHeadlessPopup *popup)
+{
+}
+
+static void
+gdk_headless_popup_get_property (GObject    *object,
+                                 guint       prop_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+  GdkSurface *surface = GDK_SURFACE (object);
+
+  switch (prop_id)
+    {
+    case LAST_PROP + GDK_POPUP_PROP_PARENT:
+      g_value_set_object (value, surface->parent);
+      break;
+
+    case LAST_PROP + GDK_POPUP_PROP_AUTOHIDE:
+      g_value_set_boolean (value, surface->autohide);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_headless_popup_set_property (GObject      *object,
+                                 guint         prop_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+  GdkSurface *surface = GDK_SURFACE (object);
+
+  switch (prop_id)
+    {
+    case LAST_PROP + GDK_POPUP_PROP_PARENT:
+      surface->parent = g_value_dup_object (value);
+      if (surface->parent != NULL)
+        surface->parent->children = g_list_prepend (surface->parent->children, surface);
+      break;
+
+    case LAST_PROP + GDK_POPUP_PROP_AUTOHIDE:
+      surface->autohide = g_value_get_boolean (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_headless_popup_class_init (GdkHeadlessPopupClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->get_property = gdk_headless_popup_get_property;
+  object_class->set_property = gdk_headless_popup_set_property;
+
+  gdk_popup_install_properties (object_class, 1);
+}
+
+static gboolean
+gdk_headless_popup_present (GdkPopup       *popup,
+                            int             width,
+                            int             height,
+                            GdkPopupLayout *layout)
+{
+  return gdk_headless_surface_present_popup (GDK_SURFACE (popup), width, height, layout);
+}
+
+static GdkGravity
+gdk_headless_popup_get_surface_anchor (GdkPopup *popup)
+{
+  return GDK_SURFACE (popup)->popup.surface_anchor;
+}
+
+static GdkGravity
+gdk_headless_popup_get_rect_anchor (GdkPopup *popup)
+{
+  return GDK_SURFACE (popup)->popup.rect_anchor;
+}
+
+static int
+gdk_headless_popup_get_position_x (GdkPopup *popup)
+{
+  return GDK_SURFACE (popup)->x;
+}
+
+static int
+gdk_headless_popup_get_position_y (GdkPopup *popup)
+{
+  return GDK_SURFACE (popup)->y;
+}
+
+static void
+gdk_headless_popup_iface_init (GdkPopupInterface *iface)
+{
+  iface->present = gdk_headless_popup_present;
+  iface->get_surface_anchor = gdk_headless_popup_get_surface_anchor;
+  iface->get_rect_anchor = gdk_headless_popup_get_rect_anchor;
+  iface->get_position_x = gdk_headless_popup_get_position_x;
+  iface->get_position_y = gdk_headless_popup_get_position_y;
+}
+
+typedef struct
+{
+  GdkHeadlessSurface parent_instance;
+} GdkHeadlessToplevel;
+
+typedef struct
+{
+  GdkHeadlessSurfaceClass parent_class;
+} GdkHeadlessToplevelClass;
+
+static void gdk_headless_toplevel_iface_init (GdkToplevelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GdkHeadlessToplevel, gdk_headless_toplevel, GDK_TYPE_HEADLESS_SURFACE,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_TOPLEVEL,
+                                                gdk_headless_toplevel_iface_init))
+
+static void
+gdk_headless_toplevel_init (GdkHeadlessToplevel *toplevel)
+{
+}
+
+static void
+gdk_headless_toplevel_set_property (GObject      *object,
+                                    guint         prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  GdkSurface *surface = GDK_SURFACE (object);
+
+  switch (prop_id)
+    {
+    case LAST_PROP + GDK_TOPLEVEL_PROP_TITLE:
+    case LAST_PROP + GDK_TOPLEVEL_PROP_STARTUP_ID:
+      g_object_notify_by_pspec (G_OBJECT (surface), pspec);
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_TRANSIENT_FOR:
+      surface->transient_for = g_value_get_object (value);
+      g_object_notify_by_pspec (G_OBJECT (surface), pspec);
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_MODAL:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_ICON_LIST:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_DECORATED:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_DELETABLE:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_SHORTCUTS_INHIBITED:
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_headless_toplevel_get_property (GObject    *object,
+                                    guint       prop_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+  GdkSurface *surface = GDK_SURFACE (object);
+
+  switch (prop_id)
+    {
+    case LAST_PROP + GDK_TOPLEVEL_PROP_STATE:
+      g_value_set_flags (value, surface->state);
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_TITLE:
+      g_value_set_string (value, "");
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_STARTUP_ID:
+      g_value_set_string (value, "");
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_TRANSIENT_FOR:
+      g_value_set_object (value, surface->transient_for);
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_ICON_LIST:
+      g_value_set_pointer (value, NULL);
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_DECORATED:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_DELETABLE:
+      break;
+
+    case LAST_PROP + GDK_TOPLEVEL_PROP_SHORTCUTS_INHIBITED:
+      g_value_set_boolean (value, surface->shortcuts_inhibited);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_headless_toplevel_class_init (GdkHeadlessToplevelClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->get_property = gdk_headless_toplevel_get_property;
+  object_class->set_property = gdk_headless_toplevel_set_property;
+
+  gdk_toplevel_install_properties (object_class, 1);
+}
+
+static void
+show_surface (GdkSurface *surface)
+{
+  gboolean was_mapped;
+
+  if (surface->destroyed)
+    return;
+
+  was_mapped = GDK_SURFACE_IS_MAPPED (surface);
+
+  if (!was_mapped)
+    {
+      gdk_synthesize_surface_state (surface, GDK_SURFACE_STATE_WITHDRAWN, 0);
+      gdk_surface_invalidate_rect (surface, NULL);
+    }
+}
+
+static gboolean
+gdk_headless_toplevel_present (GdkToplevel       *toplevel,
+                               GdkToplevelLayout *layout)
+{
+  GdkSurface *surface = GDK_SURFACE (toplevel);
+  GdkDisplay *display = gdk_surface_get_display (surface);
+  GdkRectangle monitor_geometry;
+  GdkToplevelSize size;
+  int width, height;
+  GdkGeometry geometry;
+  GdkSurfaceHints mask;
+
+  gdk_monitor_get_geometry (GDK_HEADLESS_DISPLAY (display)->monitor, &monitor_geometry);
+
+  gdk_toplevel_size_init (&size, monitor_geometry.width, monitor_geometry.height);
+  gdk_toplevel_notify_compute_size (toplevel, &size);
+  g_warn_if_fail (size.width > 0);
+  g_warn_if_fail (size.height > 0);
+  width = size.width;
+  height = size.height;
+
+  if (gdk_toplevel_layout_get_resizable (layout))
+    {
+      geometry.min_width = size.min_width;
+      geometry.min_height = size.min_height;
+      mask = GDK_HINT_MIN_SIZE;
+    }
+  else
+    {
+      geometry.max_width = geometry.min_width = width;
+      geometry.max_height = geometry.min_height = height;
+      mask = GDK_HINT_MIN_SIZE | GDK_HINT_MAX_SIZE;
+    }
+  gdk_headless_surface_set_geometry_hints (surface, &geometry, mask);
+  gdk_surface_constrain_size (&geometry, mask, width, height, &width, &height);
+  gdk_headless_surface_toplevel_resize (surface, width, height);
+
+  if (gdk_toplevel_layout_get_maximized (layout))
+    gdk_headless_surface_maximize (surface);
+  else
+    gdk_headless_surface_unmaximize (surface);
+
+  show_surface (surface);
+  gdk_headless_surface_inject_focus (GDK_HEADLESS_SURFACE (surface));
+
+  return TRUE;
+}
+
+static gboolean
+gdk_headless_toplevel_minimize (GdkToplevel *toplevel)
+{
+  return FALSE;
+}
+
+static gboolean
+gdk_headless_toplevel_lower (GdkToplevel *toplevel)
+{
+  return FALSE;
+}
+
+static void
+gdk_headless_toplevel_focus (GdkToplevel *toplevel,
+                             guint32      timestamp)
+{
+  gdk_headless_surface_inject_focus (GDK_HEADLESS_SURFACE (toplevel));
+}
+
+static gboolean
+gdk_headless_toplevel_show_window_menu (GdkToplevel *toplevel,
+                                        GdkEvent    *event)
+{
+  return FALSE;
+}
+
+static void
+gdk_headless_toplevel_begin_resize (GdkToplevel    *toplevel,
+                                    GdkSurfaceEdge  edge,
+                                    GdkDevice      *device,
+                                    int             button,
+                                    double          x,
+                                    double          y,
+                                    guint32         timestamp)
+{
+}
+
+static void
+gdk_headless_toplevel_begin_move (GdkToplevel *toplevel,
+                                  GdkDevice   *device,
+                                  int          button,
+                                  double       x,
+                                  double       y,
+                                  guint32      timestamp)
+{
+}
+
+static void
+gdk_headless_toplevel_iface_init (GdkToplevelInterface *iface)
+{
+  iface->present = gdk_headless_toplevel_present;
+  iface->minimize = gdk_headless_toplevel_minimize;
+  iface->lower = gdk_headless_toplevel_lower;
+  iface->focus = gdk_headless_toplevel_focus;
+  iface->show_window_menu = gdk_headless_toplevel_show_window_menu;
+  iface->begin_resize = gdk_headless_toplevel_begin_resize;
+  iface->begin_move = gdk_headless_toplevel_begin_move;
+}
+
+typedef struct
+{
+  GdkHeadlessSurface parent_instance;
+} GdkHeadlessDragSurface;
+
+typedef struct
+{
+  GdkHeadlessSurfaceClass parent_class;
+} GdkHeadlessDragSurfaceClass;
+
+static void gdk_headless_drag_surface_iface_init (GdkDragSurfaceInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GdkHeadlessDragSurface, gdk_headless_drag_surface, GDK_TYPE_HEADLESS_SURFACE,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_DRAG_SURFACE,
+                                                gdk_headless_drag_surface_iface_init))
+
+static void
+gdk_headless_drag_surface_init (GdkHeadlessDragSurface *surface)
+{
+}
+
+static void
+gdk_headless_drag_surface_class_init (GdkHeadlessDragSurfaceClass *class)
+{
+}
+
+static gboolean
+gdk_headless_drag_surface_present (GdkDragSurface *drag_surface,
+                                   int             width,
+                                   int             height)
+{
+  GdkSurface *surface = GDK_SURFACE (drag_surface);
+
+  gdk_headless_surface_toplevel_resize (surface, width, height);
+  show_surface (surface);
+
+  return TRUE;
+}
+
+static void
+gdk_headless_drag_surface_iface_init (GdkDragSurfaceInterface *iface)
+{
+  iface->present = gdk_headless_drag_surface_present;
+}
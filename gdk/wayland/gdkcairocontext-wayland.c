@@ -89,10 +89,8 @@ gdk_wayland_cairo_context_remove_surface (GdkWaylandCairoContext *self,
 }
 
 static void
-gdk_wayland_cairo_context_buffer_release (void             *_data,
-                                          struct wl_buffer *wl_buffer)
+gdk_wayland_cairo_context_buffer_release (cairo_surface_t *cairo_surface)
 {
-  cairo_surface_t *cairo_surface = _data;
   GdkWaylandCairoContext *self = gdk_wayland_cairo_context_get_from_surface (cairo_surface);
 
   /* context was destroyed before compositor released this buffer */
@@ -110,17 +108,12 @@ gdk_wayland_cairo_context_buffer_release (void             *_data,
   gdk_wayland_cairo_context_remove_surface (self, cairo_surface);
 }
 
-static const struct wl_buffer_listener buffer_listener = {
-  gdk_wayland_cairo_context_buffer_release
-};
-
 static cairo_surface_t *
 gdk_wayland_cairo_context_create_surface (GdkWaylandCairoContext *self)
 {
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self)));
   GdkSurface *surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (self));
   cairo_surface_t *cairo_surface;
-  struct wl_buffer *buffer;
   cairo_region_t *region;
   int width, height;
 
@@ -129,8 +122,8 @@ gdk_wayland_cairo_context_create_surface (GdkWaylandCairoContext *self)
   cairo_surface = _gdk_wayland_display_create_shm_surface (display_wayland,
                                                            width, height,
                                                            gdk_surface_get_scale_factor (surface));
-  buffer = _gdk_wayland_shm_surface_get_wl_buffer (cairo_surface);
-  wl_buffer_add_listener (buffer, &buffer_listener, cairo_surface);
+  _gdk_wayland_shm_surface_set_release_func (cairo_surface,
+                                             gdk_wayland_cairo_context_buffer_release);
   gdk_wayland_cairo_context_add_surface (self, cairo_surface);
 
   region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, width, height });
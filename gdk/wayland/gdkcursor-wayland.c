@@ -138,19 +138,6 @@ gdk_wayland_cursor_load_for_name (GdkWaylandDisplay      *display_wayland,
   return c;
 }
 
-static void
-buffer_release_callback (void             *_data,
-                         struct wl_buffer *wl_buffer)
-{
-  cairo_surface_t *cairo_surface = _data;
-
-  cairo_surface_destroy (cairo_surface);
-}
-
-static const struct wl_buffer_listener buffer_listener = {
-  buffer_release_callback
-};
-
 struct wl_buffer *
 _gdk_wayland_cursor_get_buffer (GdkWaylandDisplay *display,
                                 GdkCursor         *cursor,
@@ -202,7 +189,6 @@ _gdk_wayland_cursor_get_buffer (GdkWaylandDisplay *display,
   else
     {
       cairo_surface_t *surface;
-      struct wl_buffer *buffer;
 
       texture = gdk_cursor_get_texture (cursor);
 
@@ -230,11 +216,8 @@ from_texture:
       *height = gdk_texture_get_height (texture);
       *scale = 1;
 
-      cairo_surface_reference (surface);
-      buffer = _gdk_wayland_shm_surface_get_wl_buffer (surface);
-      wl_buffer_add_listener (buffer, &buffer_listener, surface);
-
-      return buffer;
+      /* The shm pool keeps the buffer alive while it is in use */
+      return _gdk_wayland_shm_surface_get_wl_buffer (surface);
     }
 
   if (gdk_cursor_get_fallback (cursor))
@@ -369,45 +369,37 @@ gdk_wayland_device_update_surface_cursor (GdkDevice *device)
 
   tablet = gdk_wayland_seat_find_tablet (seat, device);
 
-  if (pointer->cursor)
-    {
-      buffer = _gdk_wayland_cursor_get_buffer (GDK_WAYLAND_DISPLAY (seat->display),
-                                               pointer->cursor,
-                                               pointer->current_output_scale,
-                                               pointer->cursor_image_index,
-                                               &x, &y, &w, &h, &scale);
-    }
-  else
+  /* Getting the buffer marks it as busy until the compositor releases
+   * it, so only get it once we know it will be attached
+   */
+  if (!pointer->cursor ||
+      (tablet && !tablet->current_tool) ||
+      (!tablet && !seat->wl_pointer))
     {
       pointer->cursor_timeout_id = 0;
       return G_SOURCE_REMOVE;
     }
 
+  buffer = _gdk_wayland_cursor_get_buffer (GDK_WAYLAND_DISPLAY (seat->display),
+                                           pointer->cursor,
+                                           pointer->current_output_scale,
+                                           pointer->cursor_image_index,
+                                           &x, &y, &w, &h, &scale);
+
   if (tablet)
     {
-      if (!tablet->current_tool)
-        {
-          pointer->cursor_timeout_id = 0;
-          return G_SOURCE_REMOVE;
-        }
-
       zwp_tablet_tool_v2_set_cursor (tablet->current_tool->wp_tablet_tool,
                                      pointer->enter_serial,
                                      pointer->pointer_surface,
                                      x, y);
     }
-  else if (seat->wl_pointer)
+  else
     {
       wl_pointer_set_cursor (seat->wl_pointer,
                              pointer->enter_serial,
                              pointer->pointer_surface,
                              x, y);
     }
-  else
-    {
-      pointer->cursor_timeout_id = 0;
-      return G_SOURCE_REMOVE;
-    }
 
   if (buffer)
     {
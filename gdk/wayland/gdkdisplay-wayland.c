@@ -736,6 +736,7 @@ gdk_wayland_display_finalize (GObject *object)
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (object);
 
   _gdk_wayland_display_finalize_cursors (display_wayland);
+  _gdk_wayland_display_finalize_shm_pools (display_wayland);
 
   g_free (display_wayland->startup_notification_id);
   g_free (display_wayland->cursor_theme_name);
@@ -1182,13 +1183,63 @@ gdk_wayland_display_get_wl_compositor (GdkDisplay *display)
 
 static const cairo_user_data_key_t gdk_wayland_shm_surface_cairo_key;
 
-typedef struct _GdkWaylandCairoSurfaceData {
-  gpointer buf;
-  size_t buf_length;
+/* Shared memory pools
+ *
+ * Creating a memfd, mapping it and sending it to the compositor for
+ * every buffer is expensive, and during an interactive resize we
+ * need new buffers for every frame. So buffers are sub-allocated
+ * from a few pools per display instead.
+ *
+ * Each pool reserves address space for SHM_POOL_RESERVE bytes up
+ * front, so the file can be grown in place with ftruncate() and
+ * wl_shm_pool_resize() without moving existing buffers. Block sizes
+ * are rounded up to size classes, so that the blocks freed by one
+ * frame of a resize fit the next one. Free blocks are coalesced with
+ * their neighbours, and given back to the unused end of the pool.
+ *
+ * A block is only reused after the compositor has released the
+ * buffer that uses it, even if the cairo surface is gone by then.
+ */
+
+#define SHM_BLOCK_ALIGN (64 * 1024)
+#define SHM_POOL_RESERVE (64 * 1024 * 1024)
+
+typedef struct _GdkWaylandShmPool GdkWaylandShmPool;
+
+typedef struct {
+  gsize offset;
+  gsize size;
+} GdkWaylandShmBlock;
+
+struct _GdkWaylandShmPool
+{
+  int ref_count;
+
+  GdkWaylandDisplay *display;
   struct wl_shm_pool *pool;
+  int fd;
+  guchar *data;
+
+  gsize reserved; /* mapped address space */
+  gsize size;     /* size of the file */
+  gsize used;     /* blocks end here */
+
+  GArray *free_blocks; /* GdkWaylandShmBlock, sorted by offset */
+  guint n_live;
+};
+
+typedef struct _GdkWaylandCairoSurfaceData {
+  GdkWaylandShmPool *pool;
+  gsize offset;
+  gsize size;
   struct wl_buffer *buffer;
   GdkWaylandDisplay *display;
   uint32_t scale;
+
+  /* the compositor may still read from the buffer */
+  gboolean busy;
+  cairo_surface_t *surface;
+  void (* release_func) (cairo_surface_t *surface);
 } GdkWaylandCairoSurfaceData;
 
 static int
@@ -1251,65 +1302,308 @@ open_shared_memory (void)
   return ret;
 }
 
-static struct wl_shm_pool *
-create_shm_pool (struct wl_shm  *shm,
-                 int             size,
-                 size_t         *buf_length,
-                 void          **data_out)
+static gsize
+shm_size_class (gsize size)
 {
-  struct wl_shm_pool *pool;
+  gsize p;
+
+  size = (size + SHM_BLOCK_ALIGN - 1) & ~((gsize) SHM_BLOCK_ALIGN - 1);
+
+  for (p = SHM_BLOCK_ALIGN; p < size; p *= 2)
+    {
+      if (p + p / 2 >= size)
+        return p + p / 2;
+    }
+
+  return p;
+}
+
+static GdkWaylandShmPool *
+gdk_wayland_shm_pool_new (GdkWaylandDisplay *display,
+                          gsize              reserved)
+{
+  GdkWaylandShmPool *pool;
   int fd;
   void *data;
 
   fd = open_shared_memory ();
-
   if (fd < 0)
-    goto fail;
+    return NULL;
 
-  if (ftruncate (fd, size) < 0)
+  if (ftruncate (fd, SHM_BLOCK_ALIGN) < 0)
     {
       g_critical (G_STRLOC ": Truncating shared memory file failed: %m");
       close (fd);
-      goto fail;
+      return NULL;
     }
 
-  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-
+  /* Mapping beyond the end of the file is fine, as long as we
+   * don't touch those pages before growing the file.
+   */
+  data = mmap (NULL, reserved, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
   if (data == MAP_FAILED)
     {
       g_critical (G_STRLOC ": mmap'ping shared memory file failed: %m");
       close (fd);
-      goto fail;
+      return NULL;
     }
 
-  pool = wl_shm_create_pool (shm, fd, size);
+  pool = g_new0 (GdkWaylandShmPool, 1);
+  pool->ref_count = 1;
+  pool->display = display;
+  pool->fd = fd;
+  pool->data = data;
+  pool->reserved = reserved;
+  pool->size = SHM_BLOCK_ALIGN;
+  pool->used = 0;
+  pool->free_blocks = g_array_new (FALSE, FALSE, sizeof (GdkWaylandShmBlock));
+  pool->pool = wl_shm_create_pool (display->shm, fd, pool->size);
 
-  close (fd);
+  return pool;
+}
 
-  *data_out = data;
-  *buf_length = size;
+static GdkWaylandShmPool *
+gdk_wayland_shm_pool_ref (GdkWaylandShmPool *pool)
+{
+  pool->ref_count++;
 
   return pool;
+}
 
-fail:
-  *data_out = NULL;
-  *buf_length = 0;
-  return NULL;
+static void
+gdk_wayland_shm_pool_unref (GdkWaylandShmPool *pool)
+{
+  g_assert (pool->ref_count > 0);
+
+  pool->ref_count--;
+  if (pool->ref_count > 0)
+    return;
+
+  g_assert (pool->n_live == 0);
+
+  wl_shm_pool_destroy (pool->pool);
+  munmap (pool->data, pool->reserved);
+  close (pool->fd);
+  g_array_unref (pool->free_blocks);
+  g_free (pool);
+}
+
+static gboolean
+gdk_wayland_shm_pool_alloc (GdkWaylandShmPool *pool,
+                            gsize              size,
+                            gsize             *offset)
+{
+  GdkWaylandShmBlock *best = NULL;
+  guint i, best_index = 0;
+
+  /* best fit from the free blocks */
+  for (i = 0; i < pool->free_blocks->len; i++)
+    {
+      GdkWaylandShmBlock *block = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i);
+
+      if (block->size >= size && (best == NULL || block->size < best->size))
+        {
+          best = block;
+          best_index = i;
+          if (block->size == size)
+            break;
+        }
+    }
+
+  if (best)
+    {
+      *offset = best->offset;
+      if (best->size > size)
+        {
+          best->offset += size;
+          best->size -= size;
+        }
+      else
+        g_array_remove_index (pool->free_blocks, best_index);
+
+      pool->n_live++;
+      return TRUE;
+    }
+
+  if (pool->used + size > pool->reserved)
+    return FALSE;
+
+  if (pool->used + size > pool->size)
+    {
+      gsize new_size;
+
+      /* grow geometrically, so a growing window doesn't resize the
+       * pool on every frame
+       */
+      new_size = MIN (pool->reserved, MAX (pool->used + size, 2 * pool->size));
+
+      if (ftruncate (pool->fd, new_size) < 0)
+        return FALSE;
+
+      wl_shm_pool_resize (pool->pool, new_size);
+      pool->size = new_size;
+    }
+
+  *offset = pool->used;
+  pool->used += size;
+  pool->n_live++;
+
+  return TRUE;
 }
 
+static void
+gdk_wayland_shm_pool_free (GdkWaylandShmPool *pool,
+                           gsize              offset,
+                           gsize              size)
+{
+  GdkWaylandShmBlock *block;
+  guint i;
+
+  g_assert (pool->n_live > 0);
+  pool->n_live--;
+
+  for (i = 0; i < pool->free_blocks->len; i++)
+    {
+      if (g_array_index (pool->free_blocks, GdkWaylandShmBlock, i).offset > offset)
+        break;
+    }
+
+  g_array_insert_val (pool->free_blocks, i, ((GdkWaylandShmBlock) { offset, size }));
+
+  /* merge with the next block */
+  if (i + 1 < pool->free_blocks->len)
+    {
+      GdkWaylandShmBlock *next = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i + 1);
+
+      block = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i);
+      if (block->offset + block->size == next->offset)
+        {
+          block->size += next->size;
+          g_array_remove_index (pool->free_blocks, i + 1);
+        }
+    }
+
+  /* merge with the previous block */
+  if (i > 0)
+    {
+      GdkWaylandShmBlock *prev = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i - 1);
+
+      block = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i);
+      if (prev->offset + prev->size == block->offset)
+        {
+          prev->size += block->size;
+          g_array_remove_index (pool->free_blocks, i);
+          i--;
+        }
+    }
+
+  /* give the last block back to the unused end */
+  block = &g_array_index (pool->free_blocks, GdkWaylandShmBlock, i);
+  if (block->offset + block->size == pool->used)
+    {
+      pool->used = block->offset;
+      g_array_remove_index (pool->free_blocks, i);
+    }
+
+  /* Drop empty pools, but keep one around */
+  if (pool->n_live == 0 && pool->display && pool->display->shm_pools->len > 1)
+    g_ptr_array_remove_fast (pool->display->shm_pools, pool);
+}
+
+static GdkWaylandShmPool *
+gdk_wayland_display_alloc_shm (GdkWaylandDisplay *display,
+                               gsize              size,
+                               gsize             *offset)
+{
+  GdkWaylandShmPool *pool;
+  guint i;
+
+  if (display->shm_pools == NULL)
+    display->shm_pools = g_ptr_array_new_with_free_func ((GDestroyNotify) gdk_wayland_shm_pool_unref);
+
+  for (i = 0; i < display->shm_pools->len; i++)
+    {
+      pool = g_ptr_array_index (display->shm_pools, i);
+
+      if (gdk_wayland_shm_pool_alloc (pool, size, offset))
+        return gdk_wayland_shm_pool_ref (pool);
+    }
+
+  pool = gdk_wayland_shm_pool_new (display, MAX (size, SHM_POOL_RESERVE));
+  if (pool == NULL)
+    return NULL;
+
+  g_ptr_array_add (display->shm_pools, pool);
+
+  if (!gdk_wayland_shm_pool_alloc (pool, size, offset))
+    {
+      g_critical (G_STRLOC ": Growing shared memory file failed: %m");
+      return NULL;
+    }
+
+  return gdk_wayland_shm_pool_ref (pool);
+}
+
+void
+_gdk_wayland_display_finalize_shm_pools (GdkWaylandDisplay *display)
+{
+  guint i;
+
+  if (display->shm_pools == NULL)
+    return;
+
+  /* surfaces may outlive us */
+  for (i = 0; i < display->shm_pools->len; i++)
+    {
+      GdkWaylandShmPool *pool = g_ptr_array_index (display->shm_pools, i);
+
+      pool->display = NULL;
+    }
+
+  g_clear_pointer (&display->shm_pools, g_ptr_array_unref);
+}
+
+static void
+gdk_wayland_cairo_surface_data_free (GdkWaylandCairoSurfaceData *data)
+{
+  wl_buffer_destroy (data->buffer);
+
+  gdk_wayland_shm_pool_free (data->pool, data->offset, data->size);
+  gdk_wayland_shm_pool_unref (data->pool);
+
+  g_free (data);
+}
+
+static void
+gdk_wayland_cairo_surface_buffer_release (void             *_data,
+                                          struct wl_buffer *wl_buffer)
+{
+  GdkWaylandCairoSurfaceData *data = _data;
+
+  data->busy = FALSE;
+
+  if (data->surface == NULL)
+    gdk_wayland_cairo_surface_data_free (data);
+  else if (data->release_func)
+    data->release_func (data->surface);
+}
+
+static const struct wl_buffer_listener gdk_wayland_cairo_surface_buffer_listener = {
+  gdk_wayland_cairo_surface_buffer_release
+};
+
 static void
 gdk_wayland_cairo_surface_destroy (void *p)
 {
   GdkWaylandCairoSurfaceData *data = p;
 
-  if (data->buffer)
-    wl_buffer_destroy (data->buffer);
+  data->surface = NULL;
 
-  if (data->pool)
-    wl_shm_pool_destroy (data->pool);
+  /* keep the block until the compositor is done with it */
+  if (data->busy)
+    return;
 
-  munmap (data->buf, data->buf_length);
-  g_free (data);
+  gdk_wayland_cairo_surface_data_free (data);
 }
 
 cairo_surface_t *
@@ -1323,28 +1617,32 @@ _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *display,
   cairo_status_t status;
   int stride;
 
-  data = g_new (GdkWaylandCairoSurfaceData, 1);
+  data = g_new0 (GdkWaylandCairoSurfaceData, 1);
   data->display = display;
-  data->buffer = NULL;
   data->scale = scale;
 
   stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width*scale);
+  data->size = shm_size_class (height*scale*stride);
 
-  data->pool = create_shm_pool (display->shm,
-                                height*scale*stride,
-                                &data->buf_length,
-                                &data->buf);
+  data->pool = gdk_wayland_display_alloc_shm (display, data->size, &data->offset);
+  if (data->pool == NULL)
+    {
+      g_free (data);
+      return cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width*scale, height*scale);
+    }
 
-  surface = cairo_image_surface_create_for_data (data->buf,
+  surface = cairo_image_surface_create_for_data (data->pool->data + data->offset,
                                                  CAIRO_FORMAT_ARGB32,
                                                  width*scale,
                                                  height*scale,
                                                  stride);
 
-  data->buffer = wl_shm_pool_create_buffer (data->pool, 0,
+  data->buffer = wl_shm_pool_create_buffer (data->pool->pool, data->offset,
                                             width*scale, height*scale,
                                             stride, WL_SHM_FORMAT_ARGB8888);
+  wl_buffer_add_listener (data->buffer, &gdk_wayland_cairo_surface_buffer_listener, data);
 
+  data->surface = surface;
   cairo_surface_set_user_data (surface, &gdk_wayland_shm_surface_cairo_key,
                                data, gdk_wayland_cairo_surface_destroy);
 
@@ -1360,13 +1658,47 @@ _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *display,
   return surface;
 }
 
+/*
+ * _gdk_wayland_shm_surface_get_wl_buffer:
+ * @surface: a surface created with _gdk_wayland_display_create_shm_surface()
+ *
+ * Returns the buffer for attaching @surface. The surface counts
+ * as busy until the compositor releases the buffer, so only call
+ * this when the buffer is going to be attached.
+ */
 struct wl_buffer *
 _gdk_wayland_shm_surface_get_wl_buffer (cairo_surface_t *surface)
 {
   GdkWaylandCairoSurfaceData *data = cairo_surface_get_user_data (surface, &gdk_wayland_shm_surface_cairo_key);
+
+  g_return_val_if_fail (data != NULL, NULL);
+
+  data->busy = TRUE;
+
   return data->buffer;
 }
 
+/*
+ * _gdk_wayland_shm_surface_set_release_func:
+ * @surface: a surface created with _gdk_wayland_display_create_shm_surface()
+ * @release_func: (nullable): function to call when the compositor
+ *   releases the buffer of @surface
+ *
+ * Buffers can only have one listener, and the pool needs it to know
+ * when blocks can be reused, so use this instead of wl_buffer_add_listener().
+ * @release_func is not called once @surface has been destroyed.
+ */
+void
+_gdk_wayland_shm_surface_set_release_func (cairo_surface_t *surface,
+                                           void           (* release_func) (cairo_surface_t *surface))
+{
+  GdkWaylandCairoSurfaceData *data = cairo_surface_get_user_data (surface, &gdk_wayland_shm_surface_cairo_key);
+
+  g_return_if_fail (data != NULL);
+
+  data->release_func = release_func;
+}
+
 gboolean
 _gdk_wayland_is_shm_surface (cairo_surface_t *surface)
 {
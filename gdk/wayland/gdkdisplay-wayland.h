@@ -131,6 +131,8 @@ struct _GdkWaylandDisplay
   int cursor_theme_size;
   GHashTable *cursor_surface_cache;
 
+  GPtrArray *shm_pools;
+
   GSource *event_source;
 
   int compositor_version;
@@ -176,6 +176,9 @@ cairo_surface_t * _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *di
                                                            int                height,
                                                            guint              scale);
 struct wl_buffer *_gdk_wayland_shm_surface_get_wl_buffer (cairo_surface_t *surface);
+void _gdk_wayland_shm_surface_set_release_func (cairo_surface_t *surface,
+                                                void           (* release_func) (cairo_surface_t *surface));
+void _gdk_wayland_display_finalize_shm_pools (GdkWaylandDisplay *display);
 gboolean _gdk_wayland_is_shm_surface (cairo_surface_t *surface);
 
 EGLSurface gdk_wayland_surface_get_egl_surface (GdkSurface *surface,
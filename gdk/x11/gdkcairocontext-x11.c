@@ -30,6 +30,27 @@
 
 #include <X11/Xlib.h>
 
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
+/* Drawing
+ *
+ * If the window visual matches a cairo image format, we draw into a
+ * client side image that is kept across frames, and only push the
+ * painted region to the window, with MIT-SHM if the server can share
+ * memory with us and with XPutImage otherwise. As the back buffer
+ * keeps its contents, only new buffers need to be drawn completely.
+ *
+ * The server reads shared memory after XShmPutImage returns, so we ask
+ * it for a completion event and only wait for that event if the next
+ * frame starts before it arrived.
+ *
+ * For other visuals, we draw into a similar surface for every frame
+ * and composite that onto the window with cairo-xlib.
+ */
+
 G_DEFINE_TYPE (GdkX11CairoContext, gdk_x11_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
 
 static cairo_surface_t *
@@ -54,6 +75,263 @@ create_cairo_surface_for_surface (GdkSurface *surface)
   return cairo_surface;
 }
 
+static gboolean
+get_image_format (GdkX11Display  *display_x11,
+                  cairo_format_t *format)
+{
+  Visual *visual = gdk_x11_display_get_window_visual (display_x11);
+  int depth = gdk_x11_display_get_window_depth (display_x11);
+
+  if (visual->class != TrueColor ||
+      visual->red_mask != 0xff0000 ||
+      visual->green_mask != 0xff00 ||
+      visual->blue_mask != 0xff)
+    return FALSE;
+
+  if (depth == 24)
+    *format = CAIRO_FORMAT_RGB24;
+  else if (depth == 32)
+    *format = CAIRO_FORMAT_ARGB32;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+gdk_x11_cairo_context_free_buffer (GdkX11CairoContext *self)
+{
+  GdkDisplay *display;
+  Display *xdisplay;
+
+  if (self->image == NULL)
+    return;
+
+  display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+  xdisplay = gdk_x11_display_get_xdisplay (display);
+
+  g_clear_pointer (&self->image_surface, cairo_surface_destroy);
+
+#ifdef HAVE_XSHM
+  if (self->use_shm)
+    {
+      /* The server must be done with the memory before it goes away */
+      XShmDetach (xdisplay, &self->shm_info);
+      XSync (xdisplay, False);
+      shmdt (self->shm_info.shmaddr);
+      self->image->data = NULL;
+      self->use_shm = FALSE;
+      self->shm_pending = 0;
+    }
+  else
+#endif
+    {
+      g_free (self->image->data);
+      self->image->data = NULL;
+    }
+
+  XDestroyImage (self->image);
+  self->image = NULL;
+}
+
+#ifdef HAVE_XSHM
+static gboolean
+is_shm_completion (GdkX11CairoContext *self,
+                   const XEvent       *xevent)
+{
+  GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+
+  return self->use_shm &&
+         xevent->type == GDK_X11_DISPLAY (display)->shm_event_base + ShmCompletion &&
+         ((const XShmCompletionEvent *) xevent)->shmseg == self->shm_info.shmseg;
+}
+
+static gboolean
+gdk_x11_cairo_context_xevent (GdkX11CairoContext *self,
+                              const XEvent       *xevent,
+                              GdkX11Display      *display_x11)
+{
+  if (!is_shm_completion (self, xevent))
+    return FALSE;
+
+  if (self->shm_pending > 0)
+    self->shm_pending--;
+
+  return TRUE;
+}
+
+static Bool
+shm_completion_predicate (Display  *xdisplay,
+                          XEvent   *xevent,
+                          XPointer  arg)
+{
+  return is_shm_completion ((GdkX11CairoContext *) arg, xevent);
+}
+
+/* Waits for the completion events that haven't been handled yet,
+ * without touching other events in the queue.
+ */
+static void
+gdk_x11_cairo_context_wait_for_shm (GdkX11CairoContext *self)
+{
+  GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+  Display *xdisplay = gdk_x11_display_get_xdisplay (display);
+  XEvent xevent;
+
+  while (self->shm_pending > 0)
+    {
+      XIfEvent (xdisplay, &xevent, shm_completion_predicate, (XPointer) self);
+      self->shm_pending--;
+    }
+}
+
+static gboolean
+gdk_x11_cairo_context_create_shm_image (GdkX11CairoContext *self,
+                                        int                 width,
+                                        int                 height)
+{
+  GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+  GdkX11Display *display_x11 = GDK_X11_DISPLAY (display);
+  Display *xdisplay = gdk_x11_display_get_xdisplay (display);
+  XImage *image;
+
+  if (!display_x11->have_shm)
+    return FALSE;
+
+  /* The server reads our memory as is */
+  if (ImageByteOrder (xdisplay) != (G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst : MSBFirst))
+    return FALSE;
+
+  image = XShmCreateImage (xdisplay,
+                           gdk_x11_display_get_window_visual (display_x11),
+                           gdk_x11_display_get_window_depth (display_x11),
+                           ZPixmap,
+                           NULL,
+                           &self->shm_info,
+                           width, height);
+  if (image == NULL)
+    return FALSE;
+
+  self->shm_info.shmid = shmget (IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+  if (self->shm_info.shmid == -1)
+    {
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  self->shm_info.shmaddr = image->data = shmat (self->shm_info.shmid, NULL, 0);
+  self->shm_info.readOnly = True;
+  if (self->shm_info.shmaddr == (char *) -1)
+    {
+      shmctl (self->shm_info.shmid, IPC_RMID, NULL);
+      image->data = NULL;
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  /* Servers on other machines accept the extension, but fail to
+   * attach. Don't try again after that.
+   */
+  gdk_x11_display_error_trap_push (display);
+  XShmAttach (xdisplay, &self->shm_info);
+  XSync (xdisplay, False);
+  if (gdk_x11_display_error_trap_pop (display))
+    {
+      GDK_DISPLAY_NOTE (display, MISC, g_message ("MIT-SHM attach failed, using XPutImage"));
+      display_x11->have_shm = FALSE;
+      shmdt (self->shm_info.shmaddr);
+      shmctl (self->shm_info.shmid, IPC_RMID, NULL);
+      image->data = NULL;
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  /* The segment goes away once both sides have detached */
+  shmctl (self->shm_info.shmid, IPC_RMID, NULL);
+
+  self->image = image;
+  self->use_shm = TRUE;
+  self->shm_pending = 0;
+
+  if (!self->xevent_handler)
+    self->xevent_handler = g_signal_connect_object (display, "xevent",
+                                                    G_CALLBACK (gdk_x11_cairo_context_xevent),
+                                                    self,
+                                                    G_CONNECT_SWAPPED);
+
+  return TRUE;
+}
+#endif
+
+static gboolean
+gdk_x11_cairo_context_ensure_buffer (GdkX11CairoContext *self,
+                                     GdkSurface         *surface,
+                                     gboolean           *new_buffer)
+{
+  GdkDisplay *display = gdk_surface_get_display (surface);
+  GdkX11Display *display_x11 = GDK_X11_DISPLAY (display);
+  Display *xdisplay = gdk_x11_display_get_xdisplay (display);
+  cairo_format_t format;
+  int scale, width, height;
+
+  scale = gdk_surface_get_scale_factor (surface);
+  width = MAX (gdk_surface_get_width (surface) * scale, 1);
+  height = MAX (gdk_surface_get_height (surface) * scale, 1);
+
+  *new_buffer = FALSE;
+
+  if (self->image && self->image->width == width && self->image->height == height)
+    {
+      cairo_surface_set_device_scale (self->image_surface, scale, scale);
+      return TRUE;
+    }
+
+  gdk_x11_cairo_context_free_buffer (self);
+
+  if (!get_image_format (display_x11, &format))
+    return FALSE;
+
+#ifdef HAVE_XSHM
+  if (!gdk_x11_cairo_context_create_shm_image (self, width, height))
+#endif
+    {
+      self->image = XCreateImage (xdisplay,
+                                  gdk_x11_display_get_window_visual (display_x11),
+                                  gdk_x11_display_get_window_depth (display_x11),
+                                  ZPixmap,
+                                  0,
+                                  NULL,
+                                  width, height,
+                                  32, 0);
+      if (self->image == NULL)
+        return FALSE;
+
+      /* Xlib converts to the server's byte order if needed */
+      self->image->byte_order = G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst : MSBFirst;
+      self->image->data = g_malloc (self->image->bytes_per_line * height);
+    }
+
+  if (self->image->bits_per_pixel != 32 ||
+      self->image->bytes_per_line != cairo_format_stride_for_width (format, width))
+    {
+      gdk_x11_cairo_context_free_buffer (self);
+      return FALSE;
+    }
+
+  if (self->gc == NULL)
+    self->gc = XCreateGC (xdisplay, GDK_SURFACE_XID (surface), 0, NULL);
+
+  self->image_surface = cairo_image_surface_create_for_data ((guchar *) self->image->data,
+                                                             format,
+                                                             width, height,
+                                                             self->image->bytes_per_line);
+  cairo_surface_set_device_scale (self->image_surface, scale, scale);
+
+  *new_buffer = TRUE;
+
+  return TRUE;
+}
+
 static void
 gdk_x11_cairo_context_begin_frame (GdkDrawContext *draw_context,
                                    cairo_region_t *region)
@@ -61,9 +339,42 @@ gdk_x11_cairo_context_begin_frame (GdkDrawContext *draw_context,
   GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (draw_context);
   GdkRectangle clip_box;
   GdkSurface *surface;
+  gboolean new_buffer;
   double sx, sy;
 
   surface = gdk_draw_context_get_surface (draw_context);
+
+  if (gdk_x11_cairo_context_ensure_buffer (self, surface, &new_buffer))
+    {
+      cairo_t *cr;
+
+      /* A new buffer has no contents yet */
+      if (new_buffer)
+        cairo_region_union_rectangle (region,
+                                      &(GdkRectangle) {
+                                          0, 0,
+                                          gdk_surface_get_width (surface),
+                                          gdk_surface_get_height (surface)
+                                      });
+
+#ifdef HAVE_XSHM
+      /* Don't draw while the server may still be reading the last frame */
+      if (self->shm_pending > 0)
+        gdk_x11_cairo_context_wait_for_shm (self);
+#endif
+
+      self->paint_surface = cairo_surface_reference (self->image_surface);
+
+      cr = cairo_create (self->paint_surface);
+      gdk_cairo_region (cr, region);
+      cairo_clip (cr);
+      cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+
+      return;
+    }
+
   cairo_region_get_extents (region, &clip_box);
 
   self->window_surface = create_cairo_surface_for_surface (surface);
@@ -77,6 +388,50 @@ gdk_x11_cairo_context_begin_frame (GdkDrawContext *draw_context,
   cairo_surface_set_device_offset (self->paint_surface, -clip_box.x*sx, -clip_box.y*sy);
 }
 
+static void
+gdk_x11_cairo_context_put_image (GdkX11CairoContext *self,
+                                 GdkSurface         *surface,
+                                 cairo_region_t     *painted)
+{
+  Display *xdisplay = gdk_x11_display_get_xdisplay (gdk_surface_get_display (surface));
+  Window xid = GDK_SURFACE_XID (surface);
+  int scale = gdk_surface_get_scale_factor (surface);
+  int i, n;
+
+  cairo_surface_flush (self->image_surface);
+
+  n = cairo_region_num_rectangles (painted);
+  for (i = 0; i < n; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int x, y, width, height;
+
+      cairo_region_get_rectangle (painted, i, &rect);
+
+      x = CLAMP (rect.x * scale, 0, self->image->width);
+      y = CLAMP (rect.y * scale, 0, self->image->height);
+      width = CLAMP ((rect.x + rect.width) * scale, 0, self->image->width) - x;
+      height = CLAMP ((rect.y + rect.height) * scale, 0, self->image->height) - y;
+      if (width <= 0 || height <= 0)
+        continue;
+
+#ifdef HAVE_XSHM
+      if (self->use_shm)
+        {
+          XShmPutImage (xdisplay, xid, self->gc, self->image,
+                        x, y, x, y, width, height,
+                        True);
+          self->shm_pending++;
+        }
+      else
+#endif
+        XPutImage (xdisplay, xid, self->gc, self->image,
+                   x, y, x, y, width, height);
+    }
+
+  XFlush (xdisplay);
+}
+
 static void
 gdk_x11_cairo_context_end_frame (GdkDrawContext *draw_context,
                                  cairo_region_t *painted)
@@ -84,6 +439,15 @@ gdk_x11_cairo_context_end_frame (GdkDrawContext *draw_context,
   GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (draw_context);
   cairo_t *cr;
 
+  if (self->window_surface == NULL)
+    {
+      gdk_x11_cairo_context_put_image (self,
+                                       gdk_draw_context_get_surface (draw_context),
+                                       painted);
+      g_clear_pointer (&self->paint_surface, cairo_surface_destroy);
+      return;
+    }
+
   cr = cairo_create (self->window_surface);
 
   cairo_set_source_surface (cr, self->paint_surface, 0, 0);
@@ -109,12 +473,35 @@ gdk_x11_cairo_context_cairo_create (GdkCairoContext *context)
   return cairo_create (self->paint_surface);
 }
 
+static void
+gdk_x11_cairo_context_dispose (GObject *object)
+{
+  GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (object);
+  GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+
+  if (display && !gdk_display_is_closed (display))
+    {
+      gdk_x11_cairo_context_free_buffer (self);
+
+      if (self->gc)
+        {
+          XFreeGC (gdk_x11_display_get_xdisplay (display), self->gc);
+          self->gc = NULL;
+        }
+    }
+
+  G_OBJECT_CLASS (gdk_x11_cairo_context_parent_class)->dispose (object);
+}
+
 static void
 gdk_x11_cairo_context_class_init (GdkX11CairoContextClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GdkDrawContextClass *draw_context_class = GDK_DRAW_CONTEXT_CLASS (klass);
   GdkCairoContextClass *cairo_context_class = GDK_CAIRO_CONTEXT_CLASS (klass);
 
+  gobject_class->dispose = gdk_x11_cairo_context_dispose;
+
   draw_context_class->begin_frame = gdk_x11_cairo_context_begin_frame;
   draw_context_class->end_frame = gdk_x11_cairo_context_end_frame;
 
@@ -25,6 +25,13 @@
 
 #include "gdkcairocontextprivate.h"
 
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 G_BEGIN_DECLS
 
 #define GDK_TYPE_X11_CAIRO_CONTEXT		(gdk_x11_cairo_context_get_type ())
@@ -43,6 +50,18 @@ struct _GdkX11CairoContext
 
   cairo_surface_t *window_surface;
   cairo_surface_t *paint_surface;
+
+  /* Client side back buffer, kept across frames */
+  XImage *image;
+  cairo_surface_t *image_surface;
+  GC gc;
+#ifdef HAVE_XSHM
+  XShmSegmentInfo shm_info;
+#endif
+  /* XShmPutImage requests whose completion event hasn't arrived */
+  guint shm_pending;
+  gulong xevent_handler;
+  guint use_shm : 1;
 };
 
 struct _GdkX11CairoContextClass
@@ -69,6 +69,10 @@
 
 #include <X11/extensions/shape.h>
 
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 #ifdef HAVE_XCOMPOSITE
 #include <X11/extensions/Xcomposite.h>
 #endif
@@ -1604,6 +1608,18 @@ gdk_x11_display_open (const char *display_name)
   }
 #endif
 
+  /* This only tells us that the server supports it. We only find
+   * out whether we can share memory with it when we try to.
+   */
+  display_x11->have_shm = FALSE;
+#ifdef HAVE_XSHM
+  if (XShmQueryExtension (display_x11->xdisplay))
+    {
+      display_x11->have_shm = TRUE;
+      display_x11->shm_event_base = XShmGetEventBase (display_x11->xdisplay);
+    }
+#endif
+
 #ifdef HAVE_XDAMAGE
   display_x11->have_damage = FALSE;
   if (XDamageQueryExtension (display_x11->xdisplay,
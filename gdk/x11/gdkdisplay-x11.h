@@ -120,7 +120,9 @@ struct _GdkX11Display
 
   guint have_shapes : 1;
   guint have_input_shapes : 1;
+  guint have_shm : 1;
   int shape_event_base;
+  int shm_event_base;
 
   GSList *error_traps;
 
@@ -466,6 +466,368 @@ get_colorized_texture (GdkTexture *texture,
 }
 
 
+/* Glyphs
+ *
+ * Rendering text nodes as fallback textures means sending a new PNG
+ * for every label change. Instead, we send each glyph to the client
+ * once, as part of a small immutable atlas page, and text nodes only
+ * reference glyphs by their position in a page. The pages are normal
+ * textures, so they are shared between surfaces and live in the
+ * client as long as a glyph node or the cache here references them.
+ *
+ * Glyphs are rendered in white, the client colors them.
+ */
+
+#define MAX_CACHED_GLYPHS 4096
+#define MAX_PAGE_WIDTH 1024
+
+typedef struct {
+  PangoFont *font;
+  PangoGlyph glyph;
+  guint scale;
+} GlyphKey;
+
+typedef struct {
+  GdkTexture *page; /* NULL for empty glyphs */
+  int draw_x;
+  int draw_y;
+  int draw_width;
+  int draw_height;
+  guint16 tx;
+  guint16 ty;
+} CachedGlyph;
+
+static guint
+glyph_key_hash (gconstpointer data)
+{
+  const GlyphKey *key = data;
+
+  return g_direct_hash (key->font) ^ (key->glyph << 8) ^ key->scale;
+}
+
+static gboolean
+glyph_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const GlyphKey *ka = a;
+  const GlyphKey *kb = b;
+
+  return ka->font == kb->font &&
+         ka->glyph == kb->glyph &&
+         ka->scale == kb->scale;
+}
+
+static void
+glyph_key_free (gpointer data)
+{
+  GlyphKey *key = data;
+
+  g_object_unref (key->font);
+  g_free (key);
+}
+
+static void
+cached_glyph_free (gpointer data)
+{
+  CachedGlyph *glyph = data;
+
+  g_clear_object (&glyph->page);
+  g_free (glyph);
+}
+
+static GHashTable *
+get_glyph_cache (GdkDisplay *display)
+{
+  GHashTable *glyphs;
+
+  glyphs = g_object_get_data (G_OBJECT (display), "gsk-broadway-glyphs");
+  if (glyphs == NULL)
+    {
+      glyphs = g_hash_table_new_full (glyph_key_hash, glyph_key_equal,
+                                      glyph_key_free, cached_glyph_free);
+      g_object_set_data_full (G_OBJECT (display), "gsk-broadway-glyphs",
+                              glyphs, (GDestroyNotify) g_hash_table_unref);
+    }
+
+  return glyphs;
+}
+
+static gboolean
+can_send_glyphs (GskRenderNode *node)
+{
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const PangoGlyphInfo *glyphs;
+  cairo_scaled_font_t *scaled_font;
+  guint i, n_glyphs;
+
+  /* Color glyphs can't be recolored */
+  if (gsk_text_node_has_color_glyphs (node))
+    return FALSE;
+
+  if (!PANGO_IS_CAIRO_FONT (font))
+    return FALSE;
+
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+  if (scaled_font == NULL || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS)
+    return FALSE;
+
+  /* Hex boxes are drawn by pango, not by the font */
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      if (glyphs[i].glyph != PANGO_GLYPH_EMPTY &&
+          glyphs[i].glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Makes sure all glyphs of @node are in the cache, putting all the
+ * missing ones into one new page.
+ */
+static void
+ensure_glyphs (GHashTable    *cache,
+               GskRenderNode *node,
+               int            scale)
+{
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const PangoGlyphInfo *glyphs;
+  GPtrArray *missing = NULL;
+  guint i, n_glyphs;
+  int x, y, row_height, page_width, page_height;
+  cairo_surface_t *surface;
+  GdkTexture *page;
+  cairo_t *cr;
+
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+
+  x = y = row_height = page_width = 0;
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      GlyphKey lookup = { font, glyphs[i].glyph, scale };
+      CachedGlyph *glyph;
+      GlyphKey *key;
+      PangoRectangle ink_rect;
+      int width, height;
+
+      if (glyphs[i].glyph == PANGO_GLYPH_EMPTY ||
+          g_hash_table_contains (cache, &lookup))
+        continue;
+
+      pango_font_get_glyph_extents (font, glyphs[i].glyph, &ink_rect, NULL);
+      pango_extents_to_pixels (&ink_rect, NULL);
+
+      glyph = g_new0 (CachedGlyph, 1);
+      glyph->draw_x = ink_rect.x;
+      glyph->draw_y = ink_rect.y;
+      glyph->draw_width = ink_rect.width;
+      glyph->draw_height = ink_rect.height;
+
+      key = g_new (GlyphKey, 1);
+      key->font = g_object_ref (font);
+      key->glyph = glyphs[i].glyph;
+      key->scale = scale;
+      g_hash_table_insert (cache, key, glyph);
+
+      width = glyph->draw_width * scale;
+      height = glyph->draw_height * scale;
+      if (width <= 0 || height <= 0)
+        continue;
+
+      /* Simple shelf packing, with a pixel between glyphs
+       * so they don't bleed into each other when scaling
+       */
+      if (x > 0 && x + width > MAX_PAGE_WIDTH)
+        {
+          x = 0;
+          y += row_height + 1;
+          row_height = 0;
+        }
+
+      glyph->tx = x;
+      glyph->ty = y;
+      x += width + 1;
+      row_height = MAX (row_height, height);
+      page_width = MAX (page_width, x);
+
+      if (missing == NULL)
+        missing = g_ptr_array_new ();
+      g_ptr_array_add (missing, key);
+    }
+
+  if (missing == NULL)
+    return;
+
+  page_height = y + row_height;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, page_width, page_height);
+  cairo_surface_set_device_scale (surface, scale, scale);
+  cr = cairo_create (surface);
+  cairo_set_source_rgba (cr, 1, 1, 1, 1);
+
+  for (i = 0; i < missing->len; i++)
+    {
+      GlyphKey *key = g_ptr_array_index (missing, i);
+      CachedGlyph *glyph = g_hash_table_lookup (cache, key);
+      PangoGlyphInfo glyph_info = { key->glyph, { 0, 0, 0 }, { 1 } };
+      PangoGlyphString glyph_string = { 1, &glyph_info, NULL };
+
+      cairo_move_to (cr,
+                     (double) glyph->tx / scale - glyph->draw_x,
+                     (double) glyph->ty / scale - glyph->draw_y);
+      pango_cairo_show_glyph_string (cr, font, &glyph_string);
+    }
+
+  cairo_destroy (cr);
+
+  page = gdk_texture_new_for_surface (surface);
+  cairo_surface_destroy (surface);
+
+  for (i = 0; i < missing->len; i++)
+    {
+      CachedGlyph *glyph = g_hash_table_lookup (cache, g_ptr_array_index (missing, i));
+
+      glyph->page = g_object_ref (page);
+    }
+
+  g_object_unref (page);
+  g_ptr_array_free (missing, TRUE);
+}
+
+static void
+add_glyphs_node (GskBroadwayRenderer *self,
+                 GdkDisplay          *display,
+                 GHashTable          *cache,
+                 GskRenderNode       *node,
+                 GdkTexture          *page,
+                 int                  scale,
+                 int                  x,
+                 int                  y,
+                 int                  width,
+                 int                  height,
+                 float                offset_x,
+                 float                offset_y)
+{
+  GArray *nodes = self->nodes;
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const graphene_point_t *offset = gsk_text_node_get_offset (node);
+  const PangoGlyphInfo *glyphs;
+  guint i, n_glyphs, n_pos;
+  int x_position = 0;
+
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+
+  add_float (nodes, x - offset_x);
+  add_float (nodes, y - offset_y);
+  add_float (nodes, width);
+  add_float (nodes, height);
+  add_uint32 (nodes, gdk_broadway_display_ensure_texture (display, page));
+  add_rgba (nodes, gsk_text_node_peek_color (node));
+  add_uint32 (nodes, scale);
+  n_pos = nodes->len;
+  add_uint32 (nodes, 0);
+
+  g_ptr_array_add (self->node_textures, g_object_ref (page));
+
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &glyphs[i];
+      GlyphKey lookup = { font, gi->glyph, scale };
+      CachedGlyph *glyph;
+      float cx, cy;
+
+      if (gi->glyph == PANGO_GLYPH_EMPTY)
+        goto next;
+
+      glyph = g_hash_table_lookup (cache, &lookup);
+      if (glyph->page != page)
+        goto next;
+
+      cx = (float)(x_position + gi->geometry.x_offset) / PANGO_SCALE;
+      cy = (float)(gi->geometry.y_offset) / PANGO_SCALE;
+
+      add_float (nodes, floor (offset->x + cx + 0.125) + glyph->draw_x - x);
+      add_float (nodes, floor (offset->y + cy + 0.125) + glyph->draw_y - y);
+      add_uint32 (nodes, glyph->tx | ((guint32) glyph->ty << 16));
+      add_uint32 (nodes, (guint32) (glyph->draw_width * scale) | ((guint32) (glyph->draw_height * scale) << 16));
+      g_array_index (nodes, guint32, n_pos)++;
+
+next:
+      x_position += gi->geometry.width;
+    }
+}
+
+/* Sends a text node as one glyphs node per atlas page that it uses */
+static void
+add_text_node (GskRenderer   *renderer,
+               GskRenderNode *node,
+               float          offset_x,
+               float          offset_y)
+{
+  GskBroadwayRenderer *self = GSK_BROADWAY_RENDERER (renderer);
+  GdkDisplay *display = gdk_surface_get_display (gsk_renderer_get_surface (renderer));
+  int scale = GDK_BROADWAY_DISPLAY (display)->scale_factor;
+  PangoFont *font = gsk_text_node_peek_font (node);
+  GHashTable *cache;
+  GPtrArray *pages;
+  const PangoGlyphInfo *glyphs;
+  guint i, n_glyphs;
+  int x = floorf (node->bounds.origin.x);
+  int y = floorf (node->bounds.origin.y);
+  int width = ceil (node->bounds.origin.x + node->bounds.size.width) - x;
+  int height = ceil (node->bounds.origin.y + node->bounds.size.height) - y;
+
+  /* Don't bother with the cache if we're going to reuse the node */
+  if (self->last_node_lookup && g_hash_table_contains (self->last_node_lookup, node))
+    {
+      add_new_node (renderer, node, BROADWAY_NODE_GLYPHS);
+      return;
+    }
+
+  cache = get_glyph_cache (display);
+  ensure_glyphs (cache, node, scale);
+
+  pages = g_ptr_array_new ();
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      GlyphKey lookup = { font, glyphs[i].glyph, scale };
+      CachedGlyph *glyph;
+
+      if (glyphs[i].glyph == PANGO_GLYPH_EMPTY)
+        continue;
+
+      glyph = g_hash_table_lookup (cache, &lookup);
+      if (glyph->page && !g_ptr_array_find (pages, glyph->page, NULL))
+        g_ptr_array_add (pages, glyph->page);
+    }
+
+  if (pages->len == 1)
+    {
+      if (add_new_node (renderer, node, BROADWAY_NODE_GLYPHS))
+        add_glyphs_node (self, display, cache, node, g_ptr_array_index (pages, 0),
+                         scale, x, y, width, height, offset_x, offset_y);
+    }
+  else if (add_new_node (renderer, node, BROADWAY_NODE_CONTAINER))
+    {
+      add_uint32 (self->nodes, pages->len);
+      for (i = 0; i < pages->len; i++)
+        {
+          /* These don't correspond to a render node, so they
+           * are only ever reused as part of the container
+           */
+          add_uint32 (self->nodes, BROADWAY_NODE_GLYPHS);
+          add_uint32 (self->nodes, ++self->next_node_id);
+          add_glyphs_node (self, display, cache, node, g_ptr_array_index (pages, i),
+                           scale, x, y, width, height, offset_x, offset_y);
+        }
+    }
+
+  g_ptr_array_free (pages, TRUE);
+}
+
 /* Note: This tracks the offset so that we can convert
    the absolute coordinates of the GskRenderNodes to
    parent-relative which is what the dom uses, and
@@ -735,6 +1097,13 @@ gsk_broadway_renderer_add_node (GskRenderer *renderer,
       break; /* Fallback */
 
     case GSK_TEXT_NODE:
+      if (can_send_glyphs (node))
+        {
+          add_text_node (renderer, node, offset_x, offset_y);
+          return;
+        }
+      break; /* Fallback */
+
     case GSK_REPEATING_LINEAR_GRADIENT_NODE:
     case GSK_REPEAT_NODE:
     case GSK_BLEND_NODE:
@@ -788,9 +1157,17 @@ gsk_broadway_renderer_render (GskRenderer          *renderer,
                               const cairo_region_t *update_area)
 {
   GskBroadwayRenderer *self = GSK_BROADWAY_RENDERER (renderer);
+  GHashTable *glyphs;
 
   self->node_lookup = g_hash_table_new (g_direct_hash, g_direct_equal);
 
+  /* Start over if the glyph cache gets too big. Pages only go away
+   * in the daemon when no nodes reference them anymore.
+   */
+  glyphs = get_glyph_cache (gdk_surface_get_display (gsk_renderer_get_surface (renderer)));
+  if (g_hash_table_size (glyphs) > MAX_CACHED_GLYPHS)
+    g_hash_table_remove_all (glyphs);
+
   gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (self->draw_context), update_area);
 
   /* These are owned by the draw context between begin and end, but
@@ -21,8 +21,12 @@
  *
  * We keep count of the pixels of each atlas that are
  * taken up by old data. When the fraction of old pixels
- * gets too high, we drop the atlas and all the items it
- * contained.
+ * gets too high, the atlas gets compacted: the glyphs
+ * that are still in use are copied to another atlas on
+ * the GPU, and the old ones are dropped together with
+ * the atlas. When the atlases go over their memory
+ * budget, the least recently used one is dropped with
+ * all the glyphs it contained.
  *
  * Big glyphs are not stored in the atlas, they get their
  * own texture, but they are still cached.
@@ -272,6 +276,8 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
           gsk_gl_texture_atlas_mark_used (value->atlas, value->draw_width, value->draw_height);
           value->used = TRUE;
         }
+      if (value->atlas)
+        gsk_gl_texture_atlases_mark_accessed (cache->atlases, value->atlas);
       value->accessed = TRUE;
 
       *cached_glyph_out = value;
@@ -317,6 +323,82 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
   }
 }
 
+static void
+relocate_glyph (GskGLGlyphCache  *self,
+                GlyphCacheKey    *key,
+                GskGLCachedGlyph *value)
+{
+  const int width = value->draw_width * key->data.scale / 1024;
+  const int height = value->draw_height * key->data.scale / 1024;
+  const int source_x = (int)(value->tx * value->atlas->width);
+  const int source_y = (int)(value->ty * value->atlas->height);
+  GskGLTextureAtlas *atlas = NULL;
+  int packed_x = 0;
+  int packed_y = 0;
+
+  gsk_gl_texture_atlases_pack (self->atlases, width + 2, height + 2, &atlas, &packed_x, &packed_y);
+
+  /* The source atlas is attached to the current framebuffer */
+  glBindTexture (GL_TEXTURE_2D, atlas->texture_id);
+  glCopyTexSubImage2D (GL_TEXTURE_2D, 0,
+                       packed_x + 1, packed_y + 1,
+                       source_x, source_y,
+                       width, height);
+
+  value->tx = (float)(packed_x + 1) / atlas->width;
+  value->ty = (float)(packed_y + 1) / atlas->height;
+  value->tw = (float)width / atlas->width;
+  value->th = (float)height / atlas->height;
+
+  value->atlas = atlas;
+  value->texture_id = atlas->texture_id;
+}
+
+/* Moves the glyphs that are still in use out of @source.
+ * Returns the number of glyphs that were moved.
+ */
+static guint
+compact_atlas (GskGLGlyphCache   *self,
+               GskGLTextureAtlas *source)
+{
+  GHashTableIter iter;
+  GlyphCacheKey *key;
+  GskGLCachedGlyph *value;
+  GLint previous_framebuffer;
+  guint framebuffer;
+  guint moved = 0;
+
+  gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
+                                          "Compacting atlas %d",
+                                          source->texture_id);
+
+  glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+  glGenFramebuffers (1, &framebuffer);
+  glBindFramebuffer (GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source->texture_id, 0);
+
+  if (glCheckFramebufferStatus (GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+    {
+      g_hash_table_iter_init (&iter, self->hash_table);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value))
+        {
+          if (value->atlas == source && value->used)
+            {
+              relocate_glyph (self, key, value);
+              moved++;
+            }
+        }
+    }
+
+  glBindFramebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+  glDeleteFramebuffers (1, &framebuffer);
+  glBindTexture (GL_TEXTURE_2D, 0);
+
+  gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+
+  return moved;
+}
+
 void
 gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
                                 GskGLDriver     *driver,
@@ -326,11 +408,21 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
   GlyphCacheKey *key;
   GskGLCachedGlyph *value;
   guint dropped = 0;
+  guint moved = 0;
+  guint i;
 
   self->timestamp++;
 
   if (removed_atlases->len > 0)
     {
+      for (i = 0; i < removed_atlases->len; i++)
+        {
+          GskGLTextureAtlas *atlas = g_ptr_array_index (removed_atlases, i);
+
+          if (atlas->compacting)
+            moved += compact_atlas (self, atlas);
+        }
+
       g_hash_table_iter_init (&iter, self->hash_table);
       while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value))
         {
@@ -376,5 +468,6 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
       GSK_NOTE(GLYPH_CACHE, g_message ("%d glyphs cached", g_hash_table_size (self->hash_table)));
     }
 
+  GSK_NOTE(GLYPH_CACHE, if (moved > 0) g_message ("Moved %d glyphs", moved));
   GSK_NOTE(GLYPH_CACHE, if (dropped > 0) g_message ("Dropped %d glyphs", dropped));
 }
@@ -120,6 +120,7 @@ gsk_gl_icon_cache_lookup_or_add (GskGLIconCache  *self,
           icon_data->used = TRUE;
         }
       icon_data->accessed = TRUE;
+      gsk_gl_texture_atlases_mark_accessed (self->atlases, icon_data->atlas);
 
       *out_icon_data = icon_data;
       return;
@@ -41,6 +41,11 @@
 
 #define SHADOW_EXTRA_SIZE  4
 
+/* Fallback nodes smaller than this are rasterized right away,
+ * handing them to a worker thread costs more than drawing them */
+#define MIN_THREADED_FALLBACK_PIXELS (64 * 64)
+#define MAX_FALLBACK_THREADS 8
+
 #if DEBUG_OPS
 #define OP_PRINT(format, ...) g_print(format, ## __VA_ARGS__)
 #else
@@ -455,6 +460,28 @@ static void gsk_gl_renderer_add_render_ops     (GskGLRenderer   *self,
                                                 GskRenderNode   *node,
                                                 RenderOpBuilder *builder);
 
+typedef struct _FallbackBatch FallbackBatch;
+
+typedef struct
+{
+  GskRenderNode *node;
+  int texture_id;
+  int surface_width;
+  int surface_height;
+  float scale;
+  gboolean debug;
+  cairo_surface_t *surface;
+  FallbackBatch *batch;
+} FallbackJob;
+
+struct _FallbackBatch
+{
+  GMutex mutex;
+  GCond cond;
+  guint pending;
+  GPtrArray *jobs;
+};
+
 struct _GskGLRenderer
 {
   GskRenderer parent_instance;
@@ -477,6 +504,9 @@ struct _GskGLRenderer
 #ifdef G_ENABLE_DEBUG
   struct {
     GQuark frames;
+    GQuark atlases;
+    GQuark atlas_bytes;
+    GQuark atlas_live_bytes;
   } profile_counters;
   struct {
     GQuark cpu_time;
@@ -485,6 +515,10 @@ struct _GskGLRenderer
 #endif
 
   cairo_region_t *render_region;
+
+  /* Fallback nodes being rasterized by worker threads for the
+   * frame whose ops are currently being built */
+  FallbackBatch *fallback_batch;
 };
 
 struct _GskGLRendererClass
@@ -558,34 +592,16 @@ transform_rect (GskGLRenderer        *self,
   return r;
 }
 
-static inline void
-render_fallback_node (GskGLRenderer   *self,
-                      GskRenderNode   *node,
-                      RenderOpBuilder *builder)
+static cairo_surface_t *
+rasterize_fallback_node (GskRenderNode *node,
+                         int            surface_width,
+                         int            surface_height,
+                         float          scale,
+                         gboolean       debug)
 {
-  const float scale = ops_get_scale (builder);
-  const int surface_width = ceilf (node->bounds.size.width * scale);
-  const int surface_height = ceilf (node->bounds.size.height * scale);
   cairo_surface_t *surface;
   cairo_surface_t *rendered_surface;
   cairo_t *cr;
-  int cached_id;
-  int texture_id;
-
-  if (surface_width <= 0 ||
-      surface_height <= 0)
-    return;
-
-  cached_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, node);
-
-  if (cached_id != 0)
-    {
-      ops_set_program (builder, &self->programs->blit_program);
-      ops_set_texture (builder, cached_id);
-      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
-      return;
-    }
-
 
   /* We first draw the recording surface on an image surface,
    * just because the scaleY(-1) later otherwise screws up the
@@ -620,8 +636,7 @@ render_fallback_node (GskGLRenderer   *self,
   cairo_fill (cr);
   cairo_restore (cr);
 
-#ifdef G_ENABLE_DEBUG
-  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), FALLBACK))
+  if (debug)
     {
       cairo_move_to (cr, 0, 0);
       cairo_rectangle (cr, 0, 0, node->bounds.size.width, node->bounds.size.height);
@@ -636,13 +651,20 @@ render_fallback_node (GskGLRenderer   *self,
         cairo_set_source_rgba (cr, 1, 0, 0, 1);
       cairo_stroke (cr);
     }
-#endif
+
   cairo_destroy (cr);
+  cairo_surface_destroy (rendered_surface);
 
+  return surface;
+}
+
+static void
+upload_fallback_surface (GskGLRenderer   *self,
+                         GskRenderNode   *node,
+                         int              texture_id,
+                         cairo_surface_t *surface)
+{
   /* Upload the Cairo surface to a GL texture */
-  texture_id = gsk_gl_driver_create_texture (self->gl_driver,
-                                             surface_width,
-                                             surface_height);
   gsk_gl_driver_bind_source_texture (self->gl_driver, texture_id);
   gsk_gl_driver_init_texture_with_surface (self->gl_driver,
                                            texture_id,
@@ -654,9 +676,176 @@ render_fallback_node (GskGLRenderer   *self,
                                          "Fallback %s %d",
                                          g_type_name_from_instance ((GTypeInstance *) node),
                                          texture_id);
+}
 
-  cairo_surface_destroy (surface);
-  cairo_surface_destroy (rendered_surface);
+static void
+fallback_job_run (gpointer data,
+                  gpointer user_data)
+{
+  FallbackJob *job = data;
+
+  job->surface = rasterize_fallback_node (job->node,
+                                          job->surface_width,
+                                          job->surface_height,
+                                          job->scale,
+                                          job->debug);
+
+  g_mutex_lock (&job->batch->mutex);
+  job->batch->pending--;
+  g_cond_signal (&job->batch->cond);
+  g_mutex_unlock (&job->batch->mutex);
+}
+
+static void
+fallback_job_free (gpointer data)
+{
+  FallbackJob *job = data;
+
+  g_clear_pointer (&job->surface, cairo_surface_destroy);
+  gsk_render_node_unref (job->node);
+  g_slice_free (FallbackJob, job);
+}
+
+/* Only nodes that draw without touching anything but cairo can be
+ * rasterized off the main thread. Anything containing textures might
+ * need the GL context to download them.
+ */
+static inline gboolean
+can_rasterize_in_thread (GskRenderNode *node,
+                         int            surface_width,
+                         int            surface_height)
+{
+  if ((gsize) surface_width * surface_height < MIN_THREADED_FALLBACK_PIXELS)
+    return FALSE;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CAIRO_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+static void
+queue_fallback_job (GskGLRenderer *self,
+                    FallbackJob   *job)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    g_once_init_leave (&pool, g_thread_pool_new (fallback_job_run, NULL,
+                                                 CLAMP (g_get_num_processors () - 1, 1, MAX_FALLBACK_THREADS),
+                                                 FALSE, NULL));
+
+  if (self->fallback_batch == NULL)
+    {
+      self->fallback_batch = g_slice_new0 (FallbackBatch);
+      g_mutex_init (&self->fallback_batch->mutex);
+      g_cond_init (&self->fallback_batch->cond);
+      self->fallback_batch->jobs = g_ptr_array_new_with_free_func (fallback_job_free);
+    }
+
+  job->batch = self->fallback_batch;
+  g_ptr_array_add (self->fallback_batch->jobs, job);
+
+  g_mutex_lock (&job->batch->mutex);
+  job->batch->pending++;
+  g_mutex_unlock (&job->batch->mutex);
+
+  g_thread_pool_push (pool, job, NULL);
+}
+
+/* Waits for all fallback nodes queued while building the ops and
+ * uploads them, so their textures are ready when the ops execute.
+ */
+static void
+gsk_gl_renderer_upload_fallbacks (GskGLRenderer *self)
+{
+  FallbackBatch *batch = self->fallback_batch;
+  guint i;
+
+  if (batch == NULL)
+    return;
+
+  self->fallback_batch = NULL;
+
+  g_mutex_lock (&batch->mutex);
+  while (batch->pending > 0)
+    g_cond_wait (&batch->cond, &batch->mutex);
+  g_mutex_unlock (&batch->mutex);
+
+  for (i = 0; i < batch->jobs->len; i++)
+    {
+      FallbackJob *job = g_ptr_array_index (batch->jobs, i);
+
+      upload_fallback_surface (self, job->node, job->texture_id, job->surface);
+    }
+
+  g_ptr_array_unref (batch->jobs);
+  g_cond_clear (&batch->cond);
+  g_mutex_clear (&batch->mutex);
+  g_slice_free (FallbackBatch, batch);
+}
+
+static inline void
+render_fallback_node (GskGLRenderer   *self,
+                      GskRenderNode   *node,
+                      RenderOpBuilder *builder)
+{
+  const float scale = ops_get_scale (builder);
+  const int surface_width = ceilf (node->bounds.size.width * scale);
+  const int surface_height = ceilf (node->bounds.size.height * scale);
+  gboolean debug = FALSE;
+  int cached_id;
+  int texture_id;
+
+  if (surface_width <= 0 ||
+      surface_height <= 0)
+    return;
+
+  cached_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, node);
+
+  if (cached_id != 0)
+    {
+      ops_set_program (builder, &self->programs->blit_program);
+      ops_set_texture (builder, cached_id);
+      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
+      return;
+    }
+
+#ifdef G_ENABLE_DEBUG
+  debug = GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), FALLBACK);
+#endif
+
+  texture_id = gsk_gl_driver_create_texture (self->gl_driver,
+                                             surface_width,
+                                             surface_height);
+
+  if (can_rasterize_in_thread (node, surface_width, surface_height))
+    {
+      FallbackJob *job = g_slice_new0 (FallbackJob);
+
+      job->node = gsk_render_node_ref (node);
+      job->texture_id = texture_id;
+      job->surface_width = surface_width;
+      job->surface_height = surface_height;
+      job->scale = scale;
+      job->debug = debug;
+
+      /* The texture gets its contents in gsk_gl_renderer_upload_fallbacks() */
+      queue_fallback_job (self, job);
+    }
+  else
+    {
+      cairo_surface_t *surface;
+
+      surface = rasterize_fallback_node (node, surface_width, surface_height, scale, debug);
+      upload_fallback_surface (self, node, texture_id, surface);
+      cairo_surface_destroy (surface);
+    }
 
   gsk_gl_driver_set_texture_for_pointer (self->gl_driver, node, texture_id);
 
@@ -3126,6 +3315,8 @@ gsk_gl_renderer_unrealize (GskRenderer *renderer)
   g_clear_pointer (&self->programs, gsk_gl_renderer_programs_unref);
   g_clear_pointer (&self->glyph_cache, gsk_gl_glyph_cache_unref);
   g_clear_pointer (&self->icon_cache, gsk_gl_icon_cache_unref);
+  if (self->atlases)
+    gsk_gl_texture_atlases_remove_renderer (self->atlases, self);
   g_clear_pointer (&self->atlases, gsk_gl_texture_atlases_unref);
   gsk_gl_shadow_cache_free (&self->shadow_cache, self->gl_driver);
 
@@ -3712,7 +3903,7 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   graphene_matrix_scale (&projection, 1, -1, 1);
 
   removed = g_ptr_array_new ();
-  gsk_gl_texture_atlases_begin_frame (self->atlases, removed);
+  gsk_gl_texture_atlases_begin_frame (self->atlases, self, removed);
   gsk_gl_glyph_cache_begin_frame (self->glyph_cache, self->gl_driver, removed);
   gsk_gl_icon_cache_begin_frame (self->icon_cache, removed);
   gsk_gl_shadow_cache_begin_frame (&self->shadow_cache, self->gl_driver);
@@ -3764,6 +3955,8 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   ops_pop_clip (&self->op_builder);
   ops_finish (&self->op_builder);
 
+  gsk_gl_renderer_upload_fallbacks (self);
+
   /*g_message ("Ops: %u", self->render_ops->len);*/
 
   /* Now actually draw things... */
@@ -3795,6 +3988,16 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
 
+  {
+    guint n_atlases;
+    gsize n_bytes, n_live_bytes;
+
+    gsk_gl_texture_atlases_get_stats (self->atlases, &n_atlases, &n_bytes, &n_live_bytes);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlases, n_atlases);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_bytes, n_bytes);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_live_bytes, n_live_bytes);
+  }
+
   start_time = gsk_profiler_timer_get_start (profiler, self->profile_timers.cpu_time);
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
@@ -3975,6 +4178,9 @@ gsk_gl_renderer_init (GskGLRenderer *self)
     GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
     self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
+    self->profile_counters.atlases = gsk_profiler_add_counter (profiler, "atlases", "Texture atlases", FALSE);
+    self->profile_counters.atlas_bytes = gsk_profiler_add_counter (profiler, "atlas-bytes", "Texture atlas bytes", FALSE);
+    self->profile_counters.atlas_live_bytes = gsk_profiler_add_counter (profiler, "atlas-live-bytes", "Texture atlas bytes in use", FALSE);
 
     self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
     self->profile_timers.gpu_time = gsk_profiler_add_timer (profiler, "gpu-time", "GPU time", FALSE, TRUE);
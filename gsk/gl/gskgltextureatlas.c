@@ -2,10 +2,24 @@
 #include "config.h"
 #include "gskgltextureatlasprivate.h"
 #include "gskdebugprivate.h"
+#include "gskprivate.h"
 #include "gdkglcontextprivate.h"
 #include <epoxy/gl.h>
 
+/* Atlases in which too many pixels have become unused are
+ * compacted: they are removed from the list, and the caches
+ * get a chance to move the contents that are still in use
+ * to another atlas before the texture is freed.
+ *
+ * To respect the memory budget, we additionally drop the
+ * least recently used atlases, but never one that has been
+ * used in the previous frame of the renderer that begins a
+ * frame, or in the last frame of any other renderer sharing
+ * the atlases.
+ */
+
 #define ATLAS_SIZE (512)
+#define ATLAS_BYTES (ATLAS_SIZE * ATLAS_SIZE * 4)
 #define MAX_OLD_RATIO 0.5
 
 static void
@@ -25,6 +39,9 @@ gsk_gl_texture_atlases_new (void)
 
   self = g_new (GskGLTextureAtlases, 1);
   self->atlases = g_ptr_array_new_with_free_func (free_atlas);
+  self->max_bytes = gsk_get_atlas_budget ();
+  self->timestamp = 0;
+  self->renderer_frames = g_hash_table_new (NULL, NULL);
 
   self->ref_count = 1;
 
@@ -47,6 +64,7 @@ gsk_gl_texture_atlases_unref (GskGLTextureAtlases *self)
   if (self->ref_count == 1)
     {
       g_ptr_array_unref (self->atlases);
+      g_hash_table_unref (self->renderer_frames);
       g_free (self);
       return;
     }
@@ -73,37 +91,118 @@ write_atlas_to_png (GskGLTextureAtlas *atlas,
 }
 #endif
 
+/* Each renderer sharing the atlases calls this once per frame, so
+ * the timestamp advances once per frame of any renderer.
+ */
+static gboolean
+atlas_is_in_use (GskGLTextureAtlases *self,
+                 GskGLTextureAtlas   *atlas,
+                 guint                previous_frame)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (atlas->last_used >= previous_frame)
+    return TRUE;
+
+  g_hash_table_iter_init (&iter, self->renderer_frames);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      if (atlas->last_used == GPOINTER_TO_UINT (value))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* The atlases that are appended to @removed stay valid until
+ * @removed is freed, so that their contents can be copied.
+ */
 void
 gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
+                                    gpointer             renderer,
                                     GPtrArray           *removed)
 {
-  int i;
+  guint previous_frame;
+  gpointer value;
+  guint i;
+
+  self->timestamp++;
+
+  if (g_hash_table_lookup_extended (self->renderer_frames, renderer, NULL, &value))
+    previous_frame = GPOINTER_TO_UINT (value);
+  else
+    previous_frame = self->timestamp;
+
+  g_hash_table_insert (self->renderer_frames, renderer, GUINT_TO_POINTER (self->timestamp));
 
-  for (i = self->atlases->len - 1; i >= 0; i--)
+  g_ptr_array_set_free_func (removed, free_atlas);
+
+  for (i = self->atlases->len; i > 0; i--)
     {
-      GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+      GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i - 1);
 
       if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO)
         {
           GSK_NOTE(GLYPH_CACHE,
-                   g_message ("Dropping atlas %d (%g.2%% old)", i,
+                   g_message ("Compacting atlas %u (%.2g%% old)", i - 1,
                               100.0 * gsk_gl_texture_atlas_get_unused_ratio (atlas)));
 
-          if (atlas->texture_id != 0)
+          atlas->compacting = TRUE;
+          g_ptr_array_add (removed, g_ptr_array_steal_index (self->atlases, i - 1));
+       }
+    }
+
+  while ((gsize) self->atlases->len * ATLAS_BYTES > self->max_bytes)
+    {
+      GskGLTextureAtlas *oldest = NULL;
+      guint oldest_index = 0;
+
+      for (i = 0; i < self->atlases->len; i++)
+        {
+          GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+          if (atlas_is_in_use (self, atlas, previous_frame))
+            continue;
+
+          if (oldest == NULL || atlas->last_used < oldest->last_used)
             {
-              glDeleteTextures (1, &atlas->texture_id);
-              atlas->texture_id = 0;
+              oldest = atlas;
+              oldest_index = i;
             }
+        }
 
-          g_ptr_array_add (removed, atlas);
-          g_ptr_array_remove_index (self->atlases, i);
-       }
+      if (oldest == NULL)
+        break;
+
+      GSK_NOTE(GLYPH_CACHE,
+               g_message ("Dropping atlas %u (unused for %u frames) to stay within budget",
+                          oldest_index, self->timestamp - oldest->last_used));
+
+      oldest->compacting = FALSE;
+      g_ptr_array_add (removed, g_ptr_array_steal_index (self->atlases, oldest_index));
     }
 
   GSK_NOTE(GLYPH_CACHE, {
-    static guint timestamp;
-    if (timestamp++ % 60 == 0)
-      g_message ("%d atlases", self->atlases->len);
+    if (self->timestamp % 60 == 0)
+      {
+        guint n_atlases;
+        gsize n_bytes, n_live_bytes;
+
+        gsk_gl_texture_atlases_get_stats (self, &n_atlases, &n_bytes, &n_live_bytes);
+        g_message ("%u atlases, %" G_GSIZE_FORMAT " kB (%" G_GSIZE_FORMAT " kB live)",
+                   n_atlases, n_bytes / 1024, n_live_bytes / 1024);
+        for (i = 0; i < self->atlases->len; i++)
+          {
+            GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+            g_message ("  atlas %u: %.2g%% occupied, %.2g%% old, last used %u frames ago",
+                       i,
+                       100.0 * gsk_gl_texture_atlas_get_occupancy (atlas),
+                       100.0 * gsk_gl_texture_atlas_get_unused_ratio (atlas),
+                       self->timestamp - atlas->last_used);
+          }
+      }
   });
 
 
@@ -130,6 +229,16 @@ gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
 #endif
 }
 
+/* Called when @renderer stops using the atlases, so the
+ * atlases of its last frame are no longer kept around for it.
+ */
+void
+gsk_gl_texture_atlases_remove_renderer (GskGLTextureAtlases *self,
+                                        gpointer             renderer)
+{
+  g_hash_table_remove (self->renderer_frames, renderer);
+}
+
 gboolean
 gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
                              int                  width,
@@ -140,7 +249,7 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
 {
   GskGLTextureAtlas *atlas;
   int x, y;
-  int i;
+  guint i;
 
   g_assert (width  < ATLAS_SIZE);
   g_assert (height < ATLAS_SIZE);
@@ -172,6 +281,8 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
       GSK_NOTE(GLYPH_CACHE, g_message ("adding new atlas"));
     }
 
+  gsk_gl_texture_atlases_mark_accessed (self, atlas);
+
   *atlas_out = atlas;
   *out_x = x;
   *out_y = y;
@@ -179,6 +290,27 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
   return TRUE;
 }
 
+void
+gsk_gl_texture_atlases_get_stats (GskGLTextureAtlases *self,
+                                  guint               *n_atlases,
+                                  gsize               *n_bytes,
+                                  gsize               *n_live_bytes)
+{
+  gsize live_pixels = 0;
+  guint i;
+
+  for (i = 0; i < self->atlases->len; i++)
+    {
+      GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+      live_pixels += MAX (atlas->packed_pixels - atlas->unused_pixels, 0);
+    }
+
+  *n_atlases = self->atlases->len;
+  *n_bytes = (gsize) self->atlases->len * ATLAS_BYTES;
+  *n_live_bytes = live_pixels * 4;
+}
+
 void
 gsk_gl_texture_atlas_init (GskGLTextureAtlas *self,
                            int                width,
@@ -253,6 +385,7 @@ gsk_gl_texture_atlas_pack (GskGLTextureAtlas *self,
     {
       *out_x = rect.x;
       *out_y = rect.y;
+      self->packed_pixels += width * height;
     }
 
   return rect.was_packed;
@@ -267,6 +400,14 @@ gsk_gl_texture_atlas_get_unused_ratio (const GskGLTextureAtlas *self)
   return 0.0;
 }
 
+double
+gsk_gl_texture_atlas_get_occupancy (const GskGLTextureAtlas *self)
+{
+  int live_pixels = MAX (self->packed_pixels - self->unused_pixels, 0);
+
+  return (double) live_pixels / (double)(self->width * self->height);
+}
+
 /* Not using gdk_gl_driver_create_texture here, since we want
  * this texture to survive the driver and stay around until
  * the display gets closed.
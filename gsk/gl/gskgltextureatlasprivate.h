@@ -18,6 +18,11 @@ struct _GskGLTextureAtlas
 
   int unused_pixels; /* Pixels of rects that have been used at some point,
                         But are now unused. */
+  int packed_pixels; /* Pixels of all rects handed out by pack() */
+
+  guint last_used; /* Timestamp of the frame this was last accessed in */
+
+  guint compacting : 1; /* Removed so its live contents can be moved */
 
   void *user_data;
 };
@@ -28,21 +33,39 @@ struct _GskGLTextureAtlases
   int ref_count;
 
   GPtrArray *atlases;
+
+  gsize max_bytes;
+  guint timestamp;
+  GHashTable *renderer_frames; /* renderer => timestamp of its last frame */
 };
 typedef struct _GskGLTextureAtlases GskGLTextureAtlases;
 
+static inline void
+gsk_gl_texture_atlases_mark_accessed (GskGLTextureAtlases *atlases,
+                                      GskGLTextureAtlas   *atlas)
+{
+  atlas->last_used = atlases->timestamp;
+}
+
 GskGLTextureAtlases *gsk_gl_texture_atlases_new         (void);
 GskGLTextureAtlases *gsk_gl_texture_atlases_ref         (GskGLTextureAtlases *atlases);
 void                 gsk_gl_texture_atlases_unref       (GskGLTextureAtlases *atlases);
 
 void                 gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *atlases,
+                                                         gpointer             renderer,
                                                          GPtrArray           *removed);
+void                 gsk_gl_texture_atlases_remove_renderer (GskGLTextureAtlases *atlases,
+                                                             gpointer             renderer);
 gboolean             gsk_gl_texture_atlases_pack        (GskGLTextureAtlases *atlases,
                                                          int                  width,
                                                          int                  height,
                                                          GskGLTextureAtlas  **atlas_out,
                                                          int                 *out_x,
                                                          int                 *out_y);
+void                 gsk_gl_texture_atlases_get_stats   (GskGLTextureAtlases *atlases,
+                                                         guint               *n_atlases,
+                                                         gsize               *n_bytes,
+                                                         gsize               *n_live_bytes);
 
 void        gsk_gl_texture_atlas_init              (GskGLTextureAtlas       *self,
                                                     int                      width,
@@ -68,5 +91,6 @@ gboolean    gsk_gl_texture_atlas_pack              (GskGLTextureAtlas       *sel
                                                     int                     *out_y);
 
 double      gsk_gl_texture_atlas_get_unused_ratio  (const GskGLTextureAtlas *self);
+double      gsk_gl_texture_atlas_get_occupancy     (const GskGLTextureAtlas *self);
 
 #endif
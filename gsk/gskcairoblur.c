@@ -25,6 +25,16 @@
 #include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_BLUR_AVX2 1
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 /*
  * Gets the size for a single box blur.
  *
@@ -156,14 +166,154 @@ blur_rows (guchar *dst_buffer,
     }
 }
 
-/* Swaps width and height.
+/* Large surfaces are blurred by several threads, each of which
+ * handles a range of rows or columns. The calling thread takes the
+ * first range itself and waits for the others to be done.
+ */
+#define MAX_BLUR_THREADS 8
+#define MIN_PARALLEL_PIXELS (256 * 256)
+#define MIN_LINES_PER_JOB 32
+
+typedef void (* BlurLinesFunc) (gpointer data,
+                                int      start,
+                                int      end);
+
+typedef struct {
+  GMutex mutex;
+  GCond cond;
+  int pending;
+} BlurBatch;
+
+typedef struct {
+  BlurLinesFunc func;
+  gpointer data;
+  int start;
+  int end;
+  BlurBatch *batch;
+} BlurJob;
+
+static gboolean blur_accelerated = TRUE;
+
+static void
+blur_job_run (gpointer data,
+              gpointer user_data)
+{
+  BlurJob *job = data;
+
+  job->func (job->data, job->start, job->end);
+
+  g_mutex_lock (&job->batch->mutex);
+  job->batch->pending--;
+  g_cond_signal (&job->batch->cond);
+  g_mutex_unlock (&job->batch->mutex);
+}
+
+static int
+get_n_blur_threads (void)
+{
+  static gsize n_threads;
+
+  if (g_once_init_enter (&n_threads))
+    g_once_init_leave (&n_threads, CLAMP (g_get_num_processors (), 1, MAX_BLUR_THREADS));
+
+  return n_threads;
+}
+
+static void
+blur_lines (BlurLinesFunc func,
+            gpointer      data,
+            int           n_lines,
+            gsize         n_pixels)
+{
+  static GThreadPool *pool;
+  BlurJob jobs[MAX_BLUR_THREADS];
+  BlurBatch batch;
+  int n_jobs, i;
+
+  n_jobs = 1;
+  if (blur_accelerated && n_pixels >= MIN_PARALLEL_PIXELS)
+    n_jobs = CLAMP (n_lines / MIN_LINES_PER_JOB, 1, get_n_blur_threads ());
+
+  if (n_jobs == 1)
+    {
+      func (data, 0, n_lines);
+      return;
+    }
+
+  if (g_once_init_enter (&pool))
+    g_once_init_leave (&pool, g_thread_pool_new (blur_job_run, NULL,
+                                                 get_n_blur_threads () - 1,
+                                                 FALSE, NULL));
+
+  g_mutex_init (&batch.mutex);
+  g_cond_init (&batch.cond);
+  batch.pending = n_jobs - 1;
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      jobs[i].func = func;
+      jobs[i].data = data;
+      jobs[i].start = (gint64) n_lines * i / n_jobs;
+      jobs[i].end = (gint64) n_lines * (i + 1) / n_jobs;
+      jobs[i].batch = &batch;
+
+      if (i > 0)
+        g_thread_pool_push (pool, &jobs[i], NULL);
+    }
+
+  func (data, jobs[0].start, jobs[0].end);
+
+  g_mutex_lock (&batch.mutex);
+  while (batch.pending > 0)
+    g_cond_wait (&batch.cond, &batch.mutex);
+  g_mutex_unlock (&batch.mutex);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.mutex);
+}
+
+typedef struct {
+  guchar *buffer;
+  int width;
+  int d;
+} BlurRowsData;
+
+static void
+blur_rows_lines (gpointer data,
+                 int      start,
+                 int      end)
+{
+  BlurRowsData *rows = data;
+  guchar *tmp_buffer;
+
+  tmp_buffer = g_malloc (rows->width);
+
+  blur_rows (rows->buffer + (gsize) start * rows->width, tmp_buffer,
+             rows->width, end - start, rows->d);
+
+  g_free (tmp_buffer);
+}
+
+typedef struct {
+  guchar *dst_buffer;
+  const guchar *src_buffer;
+  int width;
+  int height;
+} FlipData;
+
+/* Swaps width and height, for the columns from start to end.
  */
 static void
-flip_buffer (guchar *dst_buffer,
-             guchar *src_buffer,
-             int     width,
-             int     height)
+flip_columns (gpointer data,
+              int      start,
+              int      end)
 {
+  FlipData *flip = data;
+  guchar *dst_buffer = flip->dst_buffer;
+  const guchar *src_buffer = flip->src_buffer;
+  int width = flip->width;
+  int height = flip->height;
+
   /* Working in blocks increases cache efficiency, compared to reading
    * or writing an entire column at once
    */
@@ -171,11 +321,11 @@ flip_buffer (guchar *dst_buffer,
 
   int i0, j0;
 
-  for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
+  for (i0 = start; i0 < end; i0 += BLOCK_SIZE)
     for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
       {
         int max_j = MIN(j0 + BLOCK_SIZE, height);
-        int max_i = MIN(i0 + BLOCK_SIZE, width);
+        int max_i = MIN(i0 + BLOCK_SIZE, end);
         int i, j;
 
         for (i = i0; i < max_i; i++)
@@ -185,6 +335,28 @@ flip_buffer (guchar *dst_buffer,
 #undef BLOCK_SIZE
 }
 
+static void
+flip_buffer (guchar       *dst_buffer,
+             const guchar *src_buffer,
+             int           width,
+             int           height)
+{
+  FlipData flip = { dst_buffer, src_buffer, width, height };
+
+  blur_lines (flip_columns, &flip, width, (gsize) width * height);
+}
+
+static void
+blur_buffer_rows (guchar *buffer,
+                  int     width,
+                  int     height,
+                  int     d)
+{
+  BlurRowsData rows = { buffer, width, d };
+
+  blur_lines (blur_rows_lines, &rows, height, (gsize) width * height);
+}
+
 static void
 _boxblur (guchar      *buffer,
           int          width,
@@ -192,30 +364,31 @@ _boxblur (guchar      *buffer,
           int          radius,
           GskBlurFlags flags)
 {
-  guchar *flipped_buffer;
   int d = get_box_filter_size (radius);
 
-  flipped_buffer = g_malloc (width * height);
-
   if (flags & GSK_BLUR_Y)
     {
+      guchar *flipped_buffer;
+
+      flipped_buffer = g_malloc (width * height);
+
       /* Step 1: swap rows and columns */
       flip_buffer (flipped_buffer, buffer, width, height);
 
       /* Step 2: blur rows (really columns) */
-      blur_rows (flipped_buffer, buffer, height, width, d);
+      blur_buffer_rows (flipped_buffer, height, width, d);
 
       /* Step 3: swap rows and columns */
       flip_buffer (buffer, flipped_buffer, height, width);
+
+      g_free (flipped_buffer);
     }
 
   if (flags & GSK_BLUR_X)
     {
       /* Step 4: blur rows */
-      blur_rows (buffer, flipped_buffer, width, height, d);
+      blur_buffer_rows (buffer, width, height, d);
     }
-
-  g_free (flipped_buffer);
 }
 
 /*
@@ -256,6 +429,858 @@ gsk_cairo_blur_surface (cairo_surface_t* surface,
   cairo_surface_mark_dirty (surface);
 }
 
+/* The box blur used for blur nodes works on all 4 channels of ARGB
+ * pixels and clamps at the edges. blur_once() is the reference
+ * implementation. The faster kernels below produce the same results,
+ * but blur columns by walking down the rows with a running sum for
+ * every column, and handle all channels of a pixel at once.
+ *
+ * The vectorized kernels divide by multiplying with the inverse of
+ * the kernel size as a float, which gives the same result as integer
+ * division for all sums we can get, as long as the kernel size stays
+ * below MAX_VECTOR_KERNEL_SIZE.
+ */
+#define MAX_VECTOR_KERNEL_SIZE 16383
+
+typedef struct {
+  const guchar *src;
+  int src_stride;
+  guchar *dest;
+  int dest_stride;
+  int width;
+  int height;
+  int radius;
+  const guchar *div_kernel_size;
+} ArgbPass;
+
+typedef struct {
+  BlurLinesFunc blur_rows;
+  BlurLinesFunc blur_columns;
+  gboolean vectorized;
+} ArgbKernels;
+
+static void
+blur_once (cairo_surface_t *src,
+           cairo_surface_t *dest,
+           int radius,
+           guchar *div_kernel_size)
+{
+  int width, height, src_rowstride, dest_rowstride, n_channels;
+  guchar *p_src, *p_dest, *c1, *c2;
+  int x, y, i, i1, i2, width_minus_1, height_minus_1, radius_plus_1;
+  int r, g, b, a;
+  guchar *p_dest_row, *p_dest_col;
+
+  width = cairo_image_surface_get_width (src);
+  height = cairo_image_surface_get_height (src);
+  n_channels = 4;
+  radius_plus_1 = radius + 1;
+
+  /* horizontal blur */
+  p_src = cairo_image_surface_get_data (src);
+  p_dest = cairo_image_surface_get_data (dest);
+  src_rowstride = cairo_image_surface_get_stride (src);
+  dest_rowstride = cairo_image_surface_get_stride (dest);
+
+  width_minus_1 = width - 1;
+  for (y = 0; y < height; y++)
+    {
+      /* calc the initial sums of the kernel */
+      r = g = b = a = 0;
+      for (i = -radius; i <= radius; i++)
+        {
+          c1 = p_src + (CLAMP (i, 0, width_minus_1) * n_channels);
+          r += c1[0];
+          g += c1[1];
+          b += c1[2];
+          a += c1[3];
+        }
+      p_dest_row = p_dest;
+      for (x = 0; x < width; x++)
+        {
+          /* set as the mean of the kernel */
+          p_dest_row[0] = div_kernel_size[r];
+          p_dest_row[1] = div_kernel_size[g];
+          p_dest_row[2] = div_kernel_size[b];
+          p_dest_row[3] = div_kernel_size[a];
+          p_dest_row += n_channels;
+
+          /* the pixel to add to the kernel */
+          i1 = x + radius_plus_1;
+          if (i1 > width_minus_1)
+            i1 = width_minus_1;
+          c1 = p_src + (i1 * n_channels);
+
+          /* the pixel to remove from the kernel */
+          i2 = x - radius;
+          if (i2 < 0)
+            i2 = 0;
+          c2 = p_src + (i2 * n_channels);
+
+          /* calc the new sums of the kernel */
+          r += c1[0] - c2[0];
+          g += c1[1] - c2[1];
+          b += c1[2] - c2[2];
+          a += c1[3] - c2[3];
+        }
+
+      p_src += src_rowstride;
+      p_dest += dest_rowstride;
+    }
+
+  /* vertical blur */
+  p_src = cairo_image_surface_get_data (dest);
+  p_dest = cairo_image_surface_get_data (src);
+  src_rowstride = cairo_image_surface_get_stride (dest);
+  dest_rowstride = cairo_image_surface_get_stride (src);
+
+  height_minus_1 = height - 1;
+  for (x = 0; x < width; x++)
+    {
+      /* calc the initial sums of the kernel */
+      r = g = b = a = 0;
+      for (i = -radius; i <= radius; i++)
+        {
+          c1 = p_src + (CLAMP (i, 0, height_minus_1) * src_rowstride);
+          r += c1[0];
+          g += c1[1];
+          b += c1[2];
+          a += c1[3];
+        }
+
+      p_dest_col = p_dest;
+      for (y = 0; y < height; y++)
+        {
+          /* set as the mean of the kernel */
+
+          p_dest_col[0] = div_kernel_size[r];
+          p_dest_col[1] = div_kernel_size[g];
+          p_dest_col[2] = div_kernel_size[b];
+          p_dest_col[3] = div_kernel_size[a];
+          p_dest_col += dest_rowstride;
+
+          /* the pixel to add to the kernel */
+          i1 = y + radius_plus_1;
+          if (i1 > height_minus_1)
+            i1 = height_minus_1;
+          c1 = p_src + (i1 * src_rowstride);
+
+          /* the pixel to remove from the kernel */
+          i2 = y - radius;
+          if (i2 < 0)
+            i2 = 0;
+          c2 = p_src + (i2 * src_rowstride);
+          /* calc the new sums of the kernel */
+          r += c1[0] - c2[0];
+          g += c1[1] - c2[1];
+          b += c1[2] - c2[2];
+          a += c1[3] - c2[3];
+        }
+
+      p_src += n_channels;
+      p_dest += n_channels;
+    }
+}
+
+static void
+blur_argb_rows (gpointer data,
+                int      start,
+                int      end)
+{
+  const ArgbPass *pass = data;
+  const guchar *div_kernel_size = pass->div_kernel_size;
+  int radius = pass->radius;
+  int last = pass->width - 1;
+  int x, y, i, c;
+
+  for (y = start; y < end; y++)
+    {
+      const guchar *src = pass->src + (gsize) y * pass->src_stride;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride;
+      int sum[4] = { 0, 0, 0, 0 };
+
+      for (i = -radius; i <= radius; i++)
+        for (c = 0; c < 4; c++)
+          sum[c] += src[CLAMP (i, 0, last) * 4 + c];
+
+      for (x = 0; x < pass->width; x++)
+        {
+          const guchar *add = src + MIN (x + radius + 1, last) * 4;
+          const guchar *sub = src + MAX (x - radius, 0) * 4;
+
+          for (c = 0; c < 4; c++)
+            {
+              dest[x * 4 + c] = div_kernel_size[sum[c]];
+              sum[c] += add[c] - sub[c];
+            }
+        }
+    }
+}
+
+static void
+blur_argb_columns (gpointer data,
+                   int      start,
+                   int      end)
+{
+  const ArgbPass *pass = data;
+  const guchar *div_kernel_size = pass->div_kernel_size;
+  int radius = pass->radius;
+  int last = pass->height - 1;
+  int n = (end - start) * 4;
+  int *sums;
+  int x, y, i;
+
+  sums = g_new0 (int, n);
+
+  for (i = -radius; i <= radius; i++)
+    {
+      const guchar *src = pass->src + (gsize) CLAMP (i, 0, last) * pass->src_stride + start * 4;
+
+      for (x = 0; x < n; x++)
+        sums[x] += src[x];
+    }
+
+  for (y = 0; y < pass->height; y++)
+    {
+      const guchar *add = pass->src + (gsize) MIN (y + radius + 1, last) * pass->src_stride + start * 4;
+      const guchar *sub = pass->src + (gsize) MAX (y - radius, 0) * pass->src_stride + start * 4;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride + start * 4;
+
+      for (x = 0; x < n; x++)
+        {
+          dest[x] = div_kernel_size[sums[x]];
+          sums[x] += add[x] - sub[x];
+        }
+    }
+
+  g_free (sums);
+}
+
+#if defined(__SSE2__)
+
+static inline __m128i
+load_pixel_sse2 (const guchar *p)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  guint32 pixel;
+
+  memcpy (&pixel, p, 4);
+
+  return _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (pixel), zero), zero);
+}
+
+static inline __m128i
+divide_sse2 (__m128i sum,
+             __m128  inv)
+{
+  return _mm_cvttps_epi32 (_mm_mul_ps (_mm_add_ps (_mm_cvtepi32_ps (sum), _mm_set1_ps (0.5f)), inv));
+}
+
+static inline void
+store_pixel_sse2 (guchar  *p,
+                  __m128i  sum,
+                  __m128   inv)
+{
+  __m128i v = divide_sse2 (sum, inv);
+  guint32 pixel;
+
+  v = _mm_packs_epi32 (v, v);
+  v = _mm_packus_epi16 (v, v);
+  pixel = _mm_cvtsi128_si32 (v);
+
+  memcpy (p, &pixel, 4);
+}
+
+static void
+blur_argb_rows_sse2 (gpointer data,
+                     int      start,
+                     int      end)
+{
+  const ArgbPass *pass = data;
+  __m128 inv = _mm_set1_ps (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->width - 1;
+  int x, y, i;
+
+  for (y = start; y < end; y++)
+    {
+      const guchar *src = pass->src + (gsize) y * pass->src_stride;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride;
+      __m128i sum = _mm_setzero_si128 ();
+
+      for (i = -radius; i <= radius; i++)
+        sum = _mm_add_epi32 (sum, load_pixel_sse2 (src + CLAMP (i, 0, last) * 4));
+
+      for (x = 0; x < pass->width; x++)
+        {
+          store_pixel_sse2 (dest + x * 4, sum, inv);
+          sum = _mm_add_epi32 (sum, _mm_sub_epi32 (load_pixel_sse2 (src + MIN (x + radius + 1, last) * 4),
+                                                   load_pixel_sse2 (src + MAX (x - radius, 0) * 4)));
+        }
+    }
+}
+
+/* Adds the 4 pixels at p to sums, as 4 * 4 channels */
+static inline void
+add_pixels_sse2 (__m128i      *sums,
+                 const guchar *p)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i v = _mm_loadu_si128 ((const __m128i *) p);
+  __m128i lo = _mm_unpacklo_epi8 (v, zero);
+  __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+  sums[0] = _mm_add_epi32 (sums[0], _mm_unpacklo_epi16 (lo, zero));
+  sums[1] = _mm_add_epi32 (sums[1], _mm_unpackhi_epi16 (lo, zero));
+  sums[2] = _mm_add_epi32 (sums[2], _mm_unpacklo_epi16 (hi, zero));
+  sums[3] = _mm_add_epi32 (sums[3], _mm_unpackhi_epi16 (hi, zero));
+}
+
+static void
+blur_argb_columns_sse2 (gpointer data,
+                        int      start,
+                        int      end)
+{
+  const ArgbPass *pass = data;
+  __m128 inv = _mm_set1_ps (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->height - 1;
+  int n = end - start;
+  int n4 = n & ~3;
+  gpointer sums_data;
+  __m128i *sums;
+  int x, y, i;
+
+  /* one 4-channel sum per pixel */
+  sums_data = g_malloc0 (sizeof (__m128i) * n + 16);
+  sums = (__m128i *) GSIZE_TO_POINTER ((GPOINTER_TO_SIZE (sums_data) + 15) & ~(gsize) 15);
+
+  for (i = -radius; i <= radius; i++)
+    {
+      const guchar *src = pass->src + (gsize) CLAMP (i, 0, last) * pass->src_stride + start * 4;
+
+      for (x = 0; x < n4; x += 4)
+        add_pixels_sse2 (sums + x, src + x * 4);
+      for (; x < n; x++)
+        sums[x] = _mm_add_epi32 (sums[x], load_pixel_sse2 (src + x * 4));
+    }
+
+  for (y = 0; y < pass->height; y++)
+    {
+      const guchar *add = pass->src + (gsize) MIN (y + radius + 1, last) * pass->src_stride + start * 4;
+      const guchar *sub = pass->src + (gsize) MAX (y - radius, 0) * pass->src_stride + start * 4;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride + start * 4;
+
+      for (x = 0; x < n4; x += 4)
+        {
+          __m128i zero = _mm_setzero_si128 ();
+          __m128i a, s, lo, hi;
+          int j;
+
+          lo = _mm_packs_epi32 (divide_sse2 (sums[x], inv), divide_sse2 (sums[x + 1], inv));
+          hi = _mm_packs_epi32 (divide_sse2 (sums[x + 2], inv), divide_sse2 (sums[x + 3], inv));
+          _mm_storeu_si128 ((__m128i *) (dest + x * 4), _mm_packus_epi16 (lo, hi));
+
+          a = _mm_loadu_si128 ((const __m128i *) (add + x * 4));
+          s = _mm_loadu_si128 ((const __m128i *) (sub + x * 4));
+
+          for (j = 0; j < 2; j++)
+            {
+              __m128i a16 = j == 0 ? _mm_unpacklo_epi8 (a, zero) : _mm_unpackhi_epi8 (a, zero);
+              __m128i s16 = j == 0 ? _mm_unpacklo_epi8 (s, zero) : _mm_unpackhi_epi8 (s, zero);
+
+              sums[x + 2 * j] = _mm_add_epi32 (sums[x + 2 * j],
+                                               _mm_sub_epi32 (_mm_unpacklo_epi16 (a16, zero),
+                                                              _mm_unpacklo_epi16 (s16, zero)));
+              sums[x + 2 * j + 1] = _mm_add_epi32 (sums[x + 2 * j + 1],
+                                                   _mm_sub_epi32 (_mm_unpackhi_epi16 (a16, zero),
+                                                                  _mm_unpackhi_epi16 (s16, zero)));
+            }
+        }
+
+      for (; x < n; x++)
+        {
+          store_pixel_sse2 (dest + x * 4, sums[x], inv);
+          sums[x] = _mm_add_epi32 (sums[x], _mm_sub_epi32 (load_pixel_sse2 (add + x * 4),
+                                                           load_pixel_sse2 (sub + x * 4)));
+        }
+    }
+
+  g_free (sums_data);
+}
+
+#if defined(HAVE_BLUR_AVX2)
+
+/* Loads pixel a into the low and pixel b into the high half */
+static inline __attribute__((target("avx2"))) __m256i
+load_pixel_pair_avx2 (const guchar *a,
+                      const guchar *b)
+{
+  guint32 pa, pb;
+
+  memcpy (&pa, a, 4);
+  memcpy (&pb, b, 4);
+
+  return _mm256_cvtepu8_epi32 (_mm_unpacklo_epi32 (_mm_cvtsi32_si128 (pa), _mm_cvtsi32_si128 (pb)));
+}
+
+static inline __attribute__((target("avx2"))) __m256i
+divide_avx2 (__m256i sum,
+             __m256  inv)
+{
+  return _mm256_cvttps_epi32 (_mm256_mul_ps (_mm256_add_ps (_mm256_cvtepi32_ps (sum), _mm256_set1_ps (0.5f)), inv));
+}
+
+/* Blurs two rows at once, one in each half of the registers */
+static __attribute__((target("avx2"))) void
+blur_argb_rows_avx2 (gpointer data,
+                     int      start,
+                     int      end)
+{
+  const ArgbPass *pass = data;
+  __m256 inv = _mm256_set1_ps (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->width - 1;
+  int x, y, i;
+
+  for (y = start; y + 1 < end; y += 2)
+    {
+      const guchar *src0 = pass->src + (gsize) y * pass->src_stride;
+      const guchar *src1 = src0 + pass->src_stride;
+      guchar *dest0 = pass->dest + (gsize) y * pass->dest_stride;
+      guchar *dest1 = dest0 + pass->dest_stride;
+      __m256i sum = _mm256_setzero_si256 ();
+
+      for (i = -radius; i <= radius; i++)
+        {
+          int o = CLAMP (i, 0, last) * 4;
+
+          sum = _mm256_add_epi32 (sum, load_pixel_pair_avx2 (src0 + o, src1 + o));
+        }
+
+      for (x = 0; x < pass->width; x++)
+        {
+          __m256i v = divide_avx2 (sum, inv);
+          guint32 p0, p1;
+          int a = MIN (x + radius + 1, last) * 4;
+          int s = MAX (x - radius, 0) * 4;
+
+          v = _mm256_packs_epi32 (v, v);
+          v = _mm256_packus_epi16 (v, v);
+          p0 = _mm_cvtsi128_si32 (_mm256_castsi256_si128 (v));
+          p1 = _mm_cvtsi128_si32 (_mm256_extracti128_si256 (v, 1));
+          memcpy (dest0 + x * 4, &p0, 4);
+          memcpy (dest1 + x * 4, &p1, 4);
+
+          sum = _mm256_add_epi32 (sum, _mm256_sub_epi32 (load_pixel_pair_avx2 (src0 + a, src1 + a),
+                                                         load_pixel_pair_avx2 (src0 + s, src1 + s)));
+        }
+    }
+
+  if (y < end)
+    blur_argb_rows_sse2 (data, y, end);
+}
+
+/* Adds the 4 pixels at p to sums, as 2 * 2 * 4 channels */
+static inline __attribute__((target("avx2"))) void
+add_pixels_avx2 (__m256i      *sums,
+                 const guchar *p)
+{
+  sums[0] = _mm256_add_epi32 (sums[0], _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) p)));
+  sums[1] = _mm256_add_epi32 (sums[1], _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (p + 8))));
+}
+
+static inline __attribute__((target("avx2"))) __m256i
+diff_pixels_avx2 (const guchar *add,
+                  const guchar *sub)
+{
+  return _mm256_sub_epi32 (_mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) add)),
+                           _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) sub)));
+}
+
+static __attribute__((target("avx2"))) void
+blur_argb_columns_avx2 (gpointer data,
+                        int      start,
+                        int      end)
+{
+  const ArgbPass *pass = data;
+  __m256 inv = _mm256_set1_ps (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->height - 1;
+  int n = end - start;
+  int n4 = n & ~3;
+  gpointer sums_data;
+  __m256i *sums;
+  int x, y, i;
+
+  if (n4 > 0)
+    {
+      /* one 2-pixel sum per 2 pixels */
+      sums_data = g_malloc0 (sizeof (__m256i) * (n4 / 2) + 32);
+      sums = (__m256i *) GSIZE_TO_POINTER ((GPOINTER_TO_SIZE (sums_data) + 31) & ~(gsize) 31);
+
+      for (i = -radius; i <= radius; i++)
+        {
+          const guchar *src = pass->src + (gsize) CLAMP (i, 0, last) * pass->src_stride + start * 4;
+
+          for (x = 0; x < n4; x += 4)
+            add_pixels_avx2 (sums + x / 2, src + x * 4);
+        }
+
+      for (y = 0; y < pass->height; y++)
+        {
+          const guchar *add = pass->src + (gsize) MIN (y + radius + 1, last) * pass->src_stride + start * 4;
+          const guchar *sub = pass->src + (gsize) MAX (y - radius, 0) * pass->src_stride + start * 4;
+          guchar *dest = pass->dest + (gsize) y * pass->dest_stride + start * 4;
+
+          for (x = 0; x < n4; x += 4)
+            {
+              __m256i *s = sums + x / 2;
+              __m256i v;
+
+              /* packing works on 128bit lanes, so this gives pixels
+               * 0, 2, 1, 3 in the four quadwords
+               */
+              v = _mm256_packs_epi32 (divide_avx2 (s[0], inv), divide_avx2 (s[1], inv));
+              v = _mm256_permute4x64_epi64 (v, _MM_SHUFFLE (3, 1, 2, 0));
+              _mm_storeu_si128 ((__m128i *) (dest + x * 4),
+                                _mm_packus_epi16 (_mm256_castsi256_si128 (v),
+                                                  _mm256_extracti128_si256 (v, 1)));
+
+              s[0] = _mm256_add_epi32 (s[0], diff_pixels_avx2 (add + x * 4, sub + x * 4));
+              s[1] = _mm256_add_epi32 (s[1], diff_pixels_avx2 (add + x * 4 + 8, sub + x * 4 + 8));
+            }
+        }
+
+      g_free (sums_data);
+    }
+
+  if (n4 < n)
+    blur_argb_columns_sse2 (data, start + n4, end);
+}
+
+#endif /* HAVE_BLUR_AVX2 */
+
+#elif defined(__ARM_NEON)
+
+static inline int32x4_t
+load_pixel_neon (const guchar *p)
+{
+  guint32 pixel;
+
+  memcpy (&pixel, p, 4);
+
+  return vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (vmovl_u8 (vcreate_u8 (pixel)))));
+}
+
+static inline int16x4_t
+divide_neon (int32x4_t   sum,
+             float32x4_t inv)
+{
+  return vmovn_s32 (vcvtq_s32_f32 (vmulq_f32 (vaddq_f32 (vcvtq_f32_s32 (sum), vdupq_n_f32 (0.5f)), inv)));
+}
+
+static inline void
+store_pixel_neon (guchar      *p,
+                  int32x4_t    sum,
+                  float32x4_t  inv)
+{
+  int16x4_t v = divide_neon (sum, inv);
+  guint32 pixel;
+
+  pixel = vget_lane_u32 (vreinterpret_u32_u8 (vqmovun_s16 (vcombine_s16 (v, v))), 0);
+
+  memcpy (p, &pixel, 4);
+}
+
+static void
+blur_argb_rows_neon (gpointer data,
+                     int      start,
+                     int      end)
+{
+  const ArgbPass *pass = data;
+  float32x4_t inv = vdupq_n_f32 (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->width - 1;
+  int x, y, i;
+
+  for (y = start; y < end; y++)
+    {
+      const guchar *src = pass->src + (gsize) y * pass->src_stride;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride;
+      int32x4_t sum = vdupq_n_s32 (0);
+
+      for (i = -radius; i <= radius; i++)
+        sum = vaddq_s32 (sum, load_pixel_neon (src + CLAMP (i, 0, last) * 4));
+
+      for (x = 0; x < pass->width; x++)
+        {
+          store_pixel_neon (dest + x * 4, sum, inv);
+          sum = vaddq_s32 (sum, vsubq_s32 (load_pixel_neon (src + MIN (x + radius + 1, last) * 4),
+                                           load_pixel_neon (src + MAX (x - radius, 0) * 4)));
+        }
+    }
+}
+
+static void
+blur_argb_columns_neon (gpointer data,
+                        int      start,
+                        int      end)
+{
+  const ArgbPass *pass = data;
+  float32x4_t inv = vdupq_n_f32 (1.0f / (2 * pass->radius + 1));
+  int radius = pass->radius;
+  int last = pass->height - 1;
+  int n = end - start;
+  int32x4_t *sums;
+  int x, y, i;
+
+  /* one 4-channel sum per pixel */
+  sums = g_new (int32x4_t, n);
+  for (x = 0; x < n; x++)
+    sums[x] = vdupq_n_s32 (0);
+
+  for (i = -radius; i <= radius; i++)
+    {
+      const guchar *src = pass->src + (gsize) CLAMP (i, 0, last) * pass->src_stride + start * 4;
+
+      for (x = 0; x < n; x++)
+        sums[x] = vaddq_s32 (sums[x], load_pixel_neon (src + x * 4));
+    }
+
+  for (y = 0; y < pass->height; y++)
+    {
+      const guchar *add = pass->src + (gsize) MIN (y + radius + 1, last) * pass->src_stride + start * 4;
+      const guchar *sub = pass->src + (gsize) MAX (y - radius, 0) * pass->src_stride + start * 4;
+      guchar *dest = pass->dest + (gsize) y * pass->dest_stride + start * 4;
+
+      for (x = 0; x + 4 <= n; x += 4)
+        {
+          uint8x16_t a = vld1q_u8 (add + x * 4);
+          uint8x16_t s = vld1q_u8 (sub + x * 4);
+          int16x8_t d0 = vreinterpretq_s16_u16 (vsubl_u8 (vget_low_u8 (a), vget_low_u8 (s)));
+          int16x8_t d1 = vreinterpretq_s16_u16 (vsubl_u8 (vget_high_u8 (a), vget_high_u8 (s)));
+          int16x8_t lo = vcombine_s16 (divide_neon (sums[x], inv), divide_neon (sums[x + 1], inv));
+          int16x8_t hi = vcombine_s16 (divide_neon (sums[x + 2], inv), divide_neon (sums[x + 3], inv));
+
+          vst1q_u8 (dest + x * 4, vcombine_u8 (vqmovun_s16 (lo), vqmovun_s16 (hi)));
+
+          sums[x] = vaddw_s16 (sums[x], vget_low_s16 (d0));
+          sums[x + 1] = vaddw_s16 (sums[x + 1], vget_high_s16 (d0));
+          sums[x + 2] = vaddw_s16 (sums[x + 2], vget_low_s16 (d1));
+          sums[x + 3] = vaddw_s16 (sums[x + 3], vget_high_s16 (d1));
+        }
+
+      for (; x < n; x++)
+        {
+          store_pixel_neon (dest + x * 4, sums[x], inv);
+          sums[x] = vaddq_s32 (sums[x], vsubq_s32 (load_pixel_neon (add + x * 4),
+                                                   load_pixel_neon (sub + x * 4)));
+        }
+    }
+
+  g_free (sums);
+}
+
+#endif
+
+static const ArgbKernels scalar_kernels = { blur_argb_rows, blur_argb_columns, FALSE };
+#if defined(__SSE2__)
+static const ArgbKernels sse2_kernels = { blur_argb_rows_sse2, blur_argb_columns_sse2, TRUE };
+#if defined(HAVE_BLUR_AVX2)
+static const ArgbKernels avx2_kernels = { blur_argb_rows_avx2, blur_argb_columns_avx2, TRUE };
+#endif
+#elif defined(__ARM_NEON)
+static const ArgbKernels neon_kernels = { blur_argb_rows_neon, blur_argb_columns_neon, TRUE };
+#endif
+
+static const ArgbKernels *argb_kernels;
+
+/* Returns NULL if the kernels aren't built in or the CPU can't run them */
+static const ArgbKernels *
+lookup_argb_kernels (GskBlurKernels which)
+{
+  switch (which)
+    {
+    case GSK_BLUR_KERNELS_DEFAULT:
+#if defined(HAVE_BLUR_AVX2)
+      if (__builtin_cpu_supports ("avx2"))
+        return &avx2_kernels;
+#endif
+#if defined(__SSE2__)
+      return &sse2_kernels;
+#elif defined(__ARM_NEON)
+      return &neon_kernels;
+#else
+      return &scalar_kernels;
+#endif
+
+    case GSK_BLUR_KERNELS_SCALAR:
+      return &scalar_kernels;
+
+    case GSK_BLUR_KERNELS_SSE2:
+#if defined(__SSE2__)
+      return &sse2_kernels;
+#else
+      return NULL;
+#endif
+
+    case GSK_BLUR_KERNELS_AVX2:
+#if defined(HAVE_BLUR_AVX2)
+      if (__builtin_cpu_supports ("avx2"))
+        return &avx2_kernels;
+#endif
+      return NULL;
+
+    case GSK_BLUR_KERNELS_NEON:
+#if defined(__ARM_NEON)
+      return &neon_kernels;
+#else
+      return NULL;
+#endif
+
+    default:
+      g_assert_not_reached ();
+      return NULL;
+    }
+}
+
+static const ArgbKernels *
+get_argb_kernels (void)
+{
+  if (argb_kernels == NULL)
+    argb_kernels = lookup_argb_kernels (GSK_BLUR_KERNELS_DEFAULT);
+
+  return argb_kernels;
+}
+
+/*<private>
+ * gsk_cairo_blur_argb_surface:
+ * @surface: a cairo image surface with 4 bytes per pixel
+ * @radius: the radius of the box blur
+ * @iterations: how often to apply the box blur
+ *
+ * Blurs all channels of @surface by applying a box blur of size
+ * 2 * @radius + 1 @iterations times, in both directions.
+ */
+void
+gsk_cairo_blur_argb_surface (cairo_surface_t *surface,
+                             int              radius,
+                             int              iterations)
+{
+  const ArgbKernels *kernels;
+  cairo_surface_t *tmp;
+  guchar *div_kernel_size;
+  ArgbPass horizontal, vertical;
+  int kernel_size;
+  int width, height;
+  int i;
+
+  g_return_if_fail (surface != NULL);
+  g_return_if_fail (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE);
+  g_return_if_fail (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32 ||
+                    cairo_image_surface_get_format (surface) == CAIRO_FORMAT_RGB24);
+
+  /* A box of size 1 doesn't change anything */
+  if (radius <= 0)
+    return;
+
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  if (width == 0 || height == 0)
+    return;
+
+  cairo_surface_flush (surface);
+
+  tmp = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  kernel_size = 2 * radius + 1;
+
+  kernels = get_argb_kernels ();
+  if (!blur_accelerated || kernel_size > MAX_VECTOR_KERNEL_SIZE)
+    kernels = NULL;
+
+  if (kernels == NULL || !kernels->vectorized)
+    {
+      div_kernel_size = g_new (guchar, 256 * kernel_size);
+      for (i = 0; i < 256 * kernel_size; i++)
+        div_kernel_size[i] = (guchar) (i / kernel_size);
+    }
+  else
+    div_kernel_size = NULL;
+
+  horizontal.src = cairo_image_surface_get_data (surface);
+  horizontal.src_stride = cairo_image_surface_get_stride (surface);
+  horizontal.dest = cairo_image_surface_get_data (tmp);
+  horizontal.dest_stride = cairo_image_surface_get_stride (tmp);
+  horizontal.width = width;
+  horizontal.height = height;
+  horizontal.radius = radius;
+  horizontal.div_kernel_size = div_kernel_size;
+
+  vertical = horizontal;
+  vertical.src = horizontal.dest;
+  vertical.src_stride = horizontal.dest_stride;
+  vertical.dest = cairo_image_surface_get_data (surface);
+  vertical.dest_stride = horizontal.src_stride;
+
+  while (iterations-- > 0)
+    {
+      if (kernels == NULL)
+        {
+          blur_once (surface, tmp, radius, div_kernel_size);
+        }
+      else
+        {
+          blur_lines (kernels->blur_rows, &horizontal, height, (gsize) width * height);
+          blur_lines (kernels->blur_columns, &vertical, width, (gsize) width * height);
+        }
+    }
+
+  g_free (div_kernel_size);
+  cairo_surface_destroy (tmp);
+
+  cairo_surface_mark_dirty (surface);
+}
+
+/*<private>
+ * gsk_cairo_blur_set_accelerated:
+ * @accelerated: %FALSE to only use the reference implementation
+ *
+ * Turns the vectorized and threaded blur code on or off. This is
+ * meant for comparing the two in tests and benchmarks.
+ */
+void
+gsk_cairo_blur_set_accelerated (gboolean accelerated)
+{
+  blur_accelerated = accelerated;
+}
+
+/*<private>
+ * gsk_cairo_blur_set_kernels:
+ * @kernels: the kernels to blur ARGB surfaces with
+ *
+ * Picks the kernels that gsk_cairo_blur_argb_surface() uses when
+ * it is accelerated, so that tests can compare all of them with
+ * the reference implementation. By default, the fastest kernels
+ * that the CPU supports are used.
+ *
+ * Returns: %FALSE if @kernels can't be used on this CPU, in which
+ *   case the kernels are not changed
+ */
+gboolean
+gsk_cairo_blur_set_kernels (GskBlurKernels kernels)
+{
+  const ArgbKernels *argb;
+
+  argb = lookup_argb_kernels (kernels);
+  if (argb == NULL)
+    return FALSE;
+
+  argb_kernels = argb;
+
+  return TRUE;
+}
+
 /*<private>
  * gsk_cairo_blur_compute_pixels:
  * @radius: the radius to compute the pixels for
@@ -405,3 +1430,47 @@ gsk_cairo_blur_finish_drawing (cairo_t         *cr,
   return original_cr;
 }
 
+/*<private>
+ * gsk_cairo_blur_draw_mask:
+ * @cr: the cairo context to draw to
+ * @mask: the target of a context returned by gsk_cairo_blur_start_drawing()
+ * @radius: the radius the mask was blurred with
+ * @color: the color to draw
+ * @blur_flags: the flags the mask was blurred with
+ *
+ * Draws @color through a mask that was blurred by
+ * gsk_cairo_blur_finish_drawing() before, as if it had been drawn
+ * and blurred for the current clip of @cr. The clip must have the
+ * same size as the one that @mask was drawn for.
+ */
+void
+gsk_cairo_blur_draw_mask (cairo_t         *cr,
+                          cairo_surface_t *mask,
+                          float            radius,
+                          const GdkRGBA   *color,
+                          GskBlurFlags     blur_flags)
+{
+  double clip_x1, clip_x2, clip_y1, clip_y2;
+  double clip_radius;
+  double x_scale, y_scale;
+  gboolean blur_x = (blur_flags & GSK_BLUR_X) != 0;
+  gboolean blur_y = (blur_flags & GSK_BLUR_Y) != 0;
+
+  cairo_clip_extents (cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+  clip_radius = gsk_cairo_blur_compute_pixels (radius);
+
+  x_scale = y_scale = 1;
+  cairo_surface_get_device_scale (cairo_get_target (cr), &x_scale, &y_scale);
+
+  cairo_surface_set_device_offset (mask,
+                                   x_scale * ((blur_x ? clip_radius : 0) - clip_x1),
+                                   y_scale * ((blur_y ? clip_radius : 0) - clip_y1));
+
+  gdk_cairo_set_source_rgba (cr, color);
+  if (blur_flags & GSK_BLUR_REPEAT)
+    mask_surface_repeat (cr, mask);
+  else
+    cairo_mask_surface (cr, mask, 0, 0);
+}
+
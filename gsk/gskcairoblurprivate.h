@@ -36,10 +36,23 @@ typedef enum {
   GSK_BLUR_REPEAT = 1<<2
 } GskBlurFlags;
 
+typedef enum {
+  GSK_BLUR_KERNELS_DEFAULT,
+  GSK_BLUR_KERNELS_SCALAR,
+  GSK_BLUR_KERNELS_SSE2,
+  GSK_BLUR_KERNELS_AVX2,
+  GSK_BLUR_KERNELS_NEON
+} GskBlurKernels;
+
 void            gsk_cairo_blur_surface          (cairo_surface_t *surface,
                                                  double           radius,
 						 GskBlurFlags     flags);
+void            gsk_cairo_blur_argb_surface     (cairo_surface_t *surface,
+                                                 int              radius,
+                                                 int              iterations);
 int             gsk_cairo_blur_compute_pixels   (double           radius);
+void            gsk_cairo_blur_set_accelerated  (gboolean         accelerated);
+gboolean        gsk_cairo_blur_set_kernels      (GskBlurKernels   kernels);
 
 cairo_t *       gsk_cairo_blur_start_drawing    (cairo_t         *cr,
                                                  float            radius,
@@ -48,6 +61,11 @@ cairo_t *       gsk_cairo_blur_finish_drawing   (cairo_t         *cr,
                                                  float            radius,
                                                  const GdkRGBA   *color,
                                                  GskBlurFlags     blur_flags);
+void            gsk_cairo_blur_draw_mask        (cairo_t         *cr,
+                                                 cairo_surface_t *mask,
+                                                 float            radius,
+                                                 const GdkRGBA   *color,
+                                                 GskBlurFlags     blur_flags);
 
 G_END_DECLS
 
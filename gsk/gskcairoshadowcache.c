@@ -0,0 +1,258 @@
+/* gskcairoshadowcache.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskcairoshadowcacheprivate.h"
+
+/* Keeps the blurred masks that the cairo code draws shadows with, so
+ * that shadows of the same shape don't need to be blurred again. The
+ * cache is only used from the thread that draws, and drops the least
+ * recently used masks once they take more than its budget in bytes.
+ */
+
+#define DEFAULT_BUDGET (4 * 1024 * 1024)
+
+typedef struct {
+  GskCairoShadowKey key;
+  guint hash;
+
+  cairo_surface_t *mask;
+  gsize size;
+
+  GList link;
+} CacheEntry;
+
+static GHashTable *cache;
+static GQueue lru = G_QUEUE_INIT;
+static gsize cache_size;
+static gsize cache_budget = DEFAULT_BUDGET;
+static guint cache_hits;
+static guint cache_misses;
+
+static inline guint
+float_hash (float f)
+{
+  union {
+    float f;
+    guint32 i;
+  } u;
+
+  u.f = f;
+
+  return u.i;
+}
+
+static guint
+shadow_key_hash (const GskCairoShadowKey *key)
+{
+  guint hash;
+  int i;
+
+  hash = key->kind ^ (key->flags << 2) ^ (key->inset << 5);
+  hash = hash * 31 + float_hash (key->blur_radius);
+  hash = hash * 31 + float_hash (key->x_scale);
+  hash = hash * 31 + float_hash (key->y_scale);
+  hash = hash * 31 + float_hash (key->size.width);
+  hash = hash * 31 + float_hash (key->size.height);
+  hash = hash * 31 + float_hash (key->outline.bounds.origin.x);
+  hash = hash * 31 + float_hash (key->outline.bounds.origin.y);
+  hash = hash * 31 + float_hash (key->outline.bounds.size.width);
+  hash = hash * 31 + float_hash (key->outline.bounds.size.height);
+  for (i = 0; i < 4; i++)
+    {
+      hash = hash * 31 + float_hash (key->outline.corner[i].width);
+      hash = hash * 31 + float_hash (key->outline.corner[i].height);
+    }
+  hash = hash * 31 + float_hash (key->clip.origin.x);
+  hash = hash * 31 + float_hash (key->clip.origin.y);
+  hash = hash * 31 + float_hash (key->clip.size.width);
+  hash = hash * 31 + float_hash (key->clip.size.height);
+
+  return hash;
+}
+
+static guint
+cache_entry_hash (gconstpointer data)
+{
+  const CacheEntry *entry = data;
+
+  return entry->hash;
+}
+
+static gboolean
+cache_entry_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const GskCairoShadowKey *key_a = &((const CacheEntry *) a)->key;
+  const GskCairoShadowKey *key_b = &((const CacheEntry *) b)->key;
+  int i;
+
+  if (key_a->kind != key_b->kind ||
+      key_a->flags != key_b->flags ||
+      key_a->inset != key_b->inset ||
+      key_a->blur_radius != key_b->blur_radius ||
+      key_a->x_scale != key_b->x_scale ||
+      key_a->y_scale != key_b->y_scale ||
+      !graphene_size_equal (&key_a->size, &key_b->size) ||
+      !graphene_rect_equal (&key_a->outline.bounds, &key_b->outline.bounds) ||
+      !graphene_rect_equal (&key_a->clip, &key_b->clip))
+    return FALSE;
+
+  for (i = 0; i < 4; i++)
+    {
+      if (!graphene_size_equal (&key_a->outline.corner[i], &key_b->outline.corner[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  g_queue_unlink (&lru, &entry->link);
+  cache_size -= entry->size;
+
+  cairo_surface_destroy (entry->mask);
+  g_slice_free (CacheEntry, entry);
+}
+
+static void
+cache_trim (void)
+{
+  while (cache_size > cache_budget)
+    g_hash_table_remove (cache, g_queue_peek_tail (&lru));
+}
+
+/*< private >
+ * gsk_cairo_shadow_cache_lookup:
+ * @key: the shadow to look for
+ *
+ * Looks for a mask for @key that was passed to
+ * gsk_cairo_shadow_cache_commit() and is still cached.
+ *
+ * Returns: (transfer full) (nullable): the mask, or %NULL
+ */
+cairo_surface_t *
+gsk_cairo_shadow_cache_lookup (const GskCairoShadowKey *key)
+{
+  CacheEntry lookup, *entry;
+
+  entry = NULL;
+  if (cache != NULL)
+    {
+      lookup.key = *key;
+      lookup.hash = shadow_key_hash (key);
+      entry = g_hash_table_lookup (cache, &lookup);
+    }
+
+  if (entry == NULL)
+    {
+      cache_misses++;
+      return NULL;
+    }
+
+  cache_hits++;
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return cairo_surface_reference (entry->mask);
+}
+
+/*< private >
+ * gsk_cairo_shadow_cache_commit:
+ * @key: the shadow that @mask was drawn for
+ * @mask: an image surface with the blurred mask
+ *
+ * Adds @mask to the cache, making room for it by dropping the
+ * least recently used masks if necessary. Masks that are larger
+ * than a quarter of the budget are not cached.
+ */
+void
+gsk_cairo_shadow_cache_commit (const GskCairoShadowKey *key,
+                               cairo_surface_t         *mask)
+{
+  CacheEntry *entry;
+  gsize size;
+
+  g_return_if_fail (cairo_surface_get_type (mask) == CAIRO_SURFACE_TYPE_IMAGE);
+
+  size = (gsize) cairo_image_surface_get_stride (mask) * cairo_image_surface_get_height (mask);
+  if (size > cache_budget / 4)
+    return;
+
+  if (cache == NULL)
+    cache = g_hash_table_new_full (cache_entry_hash, cache_entry_equal, NULL, cache_entry_free);
+
+  entry = g_slice_new0 (CacheEntry);
+  entry->key = *key;
+  entry->hash = shadow_key_hash (key);
+  entry->mask = cairo_surface_reference (mask);
+  entry->size = size;
+  entry->link.data = entry;
+
+  g_hash_table_remove (cache, entry);
+
+  g_queue_push_head_link (&lru, &entry->link);
+  cache_size += entry->size;
+  g_hash_table_add (cache, entry);
+
+  cache_trim ();
+}
+
+/*< private >
+ * gsk_cairo_shadow_cache_set_budget:
+ * @budget: the number of bytes cached masks may take
+ *
+ * Changes how much memory the cache may use, dropping masks
+ * if it uses more than that already.
+ */
+void
+gsk_cairo_shadow_cache_set_budget (gsize budget)
+{
+  cache_budget = budget;
+
+  if (cache != NULL)
+    cache_trim ();
+}
+
+/*< private >
+ * gsk_cairo_shadow_cache_get_stats:
+ * @hits: (out) (optional): return location for the number of lookups
+ *   that found a mask
+ * @misses: (out) (optional): return location for the number of lookups
+ *   that didn't
+ * @size: (out) (optional): return location for the number of bytes
+ *   that cached masks take
+ *
+ * Gets the counters of the cache.
+ */
+void
+gsk_cairo_shadow_cache_get_stats (guint *hits,
+                                  guint *misses,
+                                  gsize *size)
+{
+  if (hits)
+    *hits = cache_hits;
+  if (misses)
+    *misses = cache_misses;
+  if (size)
+    *size = cache_size;
+}
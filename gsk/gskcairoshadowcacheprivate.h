@@ -0,0 +1,58 @@
+/* gskcairoshadowcacheprivate.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__
+#define __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__
+
+#include <gsk/gsk.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GSK_CAIRO_SHADOW_CORNER,
+  GSK_CAIRO_SHADOW_SHAPE
+} GskCairoShadowKind;
+
+/* Everything that affects the pixels of a blurred shadow mask. All
+ * positions are relative to the mask, so shadows of the same shape
+ * share their mask wherever they are drawn.
+ *
+ * Corner masks only use blur_radius and the first corner of outline.
+ */
+typedef struct {
+  GskCairoShadowKind kind;
+  guint flags;
+  gboolean inset;
+  float blur_radius;
+  float x_scale;
+  float y_scale;
+  graphene_size_t size;
+  GskRoundedRect outline;
+  graphene_rect_t clip;
+} GskCairoShadowKey;
+
+cairo_surface_t *       gsk_cairo_shadow_cache_lookup           (const GskCairoShadowKey *key);
+void                    gsk_cairo_shadow_cache_commit           (const GskCairoShadowKey *key,
+                                                                 cairo_surface_t         *mask);
+void                    gsk_cairo_shadow_cache_set_budget       (gsize                    budget);
+void                    gsk_cairo_shadow_cache_get_stats        (guint                   *hits,
+                                                                 guint                   *misses,
+                                                                 gsize                   *size);
+
+G_END_DECLS
+
+#endif /* __GSK_CAIRO_SHADOW_CACHE_PRIVATE_H__ */
@@ -16,6 +16,43 @@ gsk_ensure_resources (void)
   g_once (&register_resources_once, register_resources, NULL);
 }
 
+#define DEFAULT_ATLAS_BUDGET (64 * 1024 * 1024)
+
+/*
+ * gsk_get_atlas_budget:
+ *
+ * Returns the number of bytes that the glyph atlases of a display
+ * should stay under. This can be set in megabytes with the
+ * GSK_ATLAS_BUDGET environment variable, 0 meaning unlimited.
+ *
+ * Returns: the atlas budget in bytes
+ */
+gsize
+gsk_get_atlas_budget (void)
+{
+  static gsize budget = 0;
+
+  if (g_once_init_enter (&budget))
+    {
+      const char *env = g_getenv ("GSK_ATLAS_BUDGET");
+      gsize value = DEFAULT_ATLAS_BUDGET;
+
+      if (env != NULL)
+        {
+          guint64 megabytes;
+
+          if (g_ascii_string_to_unsigned (env, 10, 0, G_MAXSIZE >> 20, &megabytes, NULL))
+            value = megabytes == 0 ? G_MAXSIZE : (gsize) megabytes << 20;
+          else
+            g_warning ("Invalid value for GSK_ATLAS_BUDGET: %s", env);
+        }
+
+      g_once_init_leave (&budget, value);
+    }
+
+  return budget;
+}
+
 int
 pango_glyph_string_num_glyphs (PangoGlyphString *glyphs)
 {
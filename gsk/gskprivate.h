@@ -8,6 +8,8 @@ G_BEGIN_DECLS
 
 void gsk_ensure_resources (void);
 
+gsize gsk_get_atlas_budget (void);
+
 int pango_glyph_string_num_glyphs (PangoGlyphString *glyphs);
 
 typedef struct _GskVulkanRender GskVulkanRender;
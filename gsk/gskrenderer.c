@@ -42,6 +42,8 @@
 #include "gskprofilerprivate.h"
 #include "gskrendernodeprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 #include "gskenumtypes.h"
 
 #include <graphene-gobject.h>
@@ -57,6 +59,9 @@
 #ifdef GDK_WINDOWING_BROADWAY
 #include "broadway/gskbroadwayrenderer.h"
 #endif
+#ifdef GDK_WINDOWING_HEADLESS
+#include <gdk/headless/gdkheadless.h>
+#endif
 #ifdef GDK_RENDERING_VULKAN
 #include "vulkan/gskvulkanrenderer.h"
 #endif
@@ -427,9 +432,17 @@ gsk_renderer_render (GskRenderer          *renderer,
     }
   else
     {
+      gint64 before_diff = 0;
+
+      if (GDK_PROFILER_IS_RUNNING)
+        before_diff = g_get_monotonic_time ();
+
       clip = cairo_region_copy (region);
       gsk_render_node_diff (priv->prev_node, root, clip);
 
+      if (before_diff != 0 && GDK_PROFILER_IS_RUNNING)
+        gdk_profiler_end_mark (before_diff, "render node diff", NULL);
+
       if (cairo_region_is_empty (clip))
         {
           cairo_region_destroy (clip);
@@ -565,6 +578,10 @@ get_renderer_for_backend (GdkSurface *surface)
   if (GDK_IS_BROADWAY_SURFACE (surface))
     return GSK_TYPE_BROADWAY_RENDERER;
 #endif
+#ifdef GDK_WINDOWING_HEADLESS
+  if (GDK_IS_HEADLESS_SURFACE (surface))
+    return GSK_TYPE_CAIRO_RENDERER;
+#endif
 #ifdef GDK_WINDOWING_MACOS
   if (GDK_IS_MACOS_SURFACE (surface))
     return GSK_TYPE_GL_RENDERER;
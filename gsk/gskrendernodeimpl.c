@@ -21,12 +21,14 @@
 #include "gskrendernodeprivate.h"
 
 #include "gskcairoblurprivate.h"
+#include "gskcairoshadowcacheprivate.h"
 #include "gskdebugprivate.h"
 #include "gskdiffprivate.h"
 #include "gskrendererprivate.h"
 #include "gskroundedrectprivate.h"
 #include "gsktransformprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include <cairo-ft.h>
 
@@ -802,6 +804,101 @@ has_empty_clip (cairo_t *cr)
   return x1 == x2 && y1 == y2;
 }
 
+/* Shadow masks are cached with 1/256 pixel precision, which is
+ * what cairo rasterizes with anyway.
+ */
+static inline float
+snap_to_grid (float value)
+{
+  return roundf (value * 256.f) / 256.f;
+}
+
+static void
+snap_rect_to_grid (graphene_rect_t *rect)
+{
+  rect->origin.x = snap_to_grid (rect->origin.x);
+  rect->origin.y = snap_to_grid (rect->origin.y);
+  rect->size.width = snap_to_grid (rect->size.width);
+  rect->size.height = snap_to_grid (rect->size.height);
+}
+
+static void
+report_shadow_cache (void)
+{
+  static guint hits_counter, misses_counter, size_counter;
+  guint hits, misses;
+  gsize size;
+  gint64 now;
+
+  if (!GDK_PROFILER_IS_RUNNING)
+    return;
+
+  if (hits_counter == 0)
+    {
+      hits_counter = gdk_profiler_define_int_counter ("cairo-shadow-hits", "Cairo Shadow Cache Hits");
+      misses_counter = gdk_profiler_define_int_counter ("cairo-shadow-misses", "Cairo Shadow Cache Misses");
+      size_counter = gdk_profiler_define_int_counter ("cairo-shadow-bytes", "Cairo Shadow Cache Bytes");
+    }
+
+  gsk_cairo_shadow_cache_get_stats (&hits, &misses, &size);
+  now = g_get_monotonic_time ();
+  gdk_profiler_set_int_counter (hits_counter, now, hits);
+  gdk_profiler_set_int_counter (misses_counter, now, misses);
+  gdk_profiler_set_int_counter (size_counter, now, size);
+}
+
+/* The mask that gsk_cairo_blur_start_drawing() creates covers the
+ * clip of cr, so we describe the shadow relative to the clip.
+ */
+static void
+shadow_key_init (GskCairoShadowKey    *key,
+                 cairo_t              *cr,
+                 gboolean              inset,
+                 const GskRoundedRect *box,
+                 const GskRoundedRect *clip_box,
+                 float                 radius,
+                 GskBlurFlags          blur_flags)
+{
+  double x1, y1, x2, y2;
+  double x_scale, y_scale;
+  float width, height;
+
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  width = x2 - x1;
+  height = y2 - y1;
+
+  x_scale = y_scale = 1;
+  cairo_surface_get_device_scale (cairo_get_target (cr), &x_scale, &y_scale);
+
+  if (blur_flags & GSK_BLUR_REPEAT)
+    {
+      if ((blur_flags & GSK_BLUR_X) == 0)
+        width = 1;
+      if ((blur_flags & GSK_BLUR_Y) == 0)
+        height = 1;
+    }
+
+  memset (key, 0, sizeof (GskCairoShadowKey));
+  key->kind = GSK_CAIRO_SHADOW_SHAPE;
+  key->flags = blur_flags;
+  key->inset = inset;
+  key->blur_radius = radius;
+  key->x_scale = x_scale;
+  key->y_scale = y_scale;
+  key->size.width = snap_to_grid (width);
+  key->size.height = snap_to_grid (height);
+
+  gsk_rounded_rect_init_copy (&key->outline, box);
+  gsk_rounded_rect_offset (&key->outline, -x1, -y1);
+  snap_rect_to_grid (&key->outline.bounds);
+
+  if (inset)
+    {
+      graphene_rect_offset_r (&clip_box->bounds, -x1, -y1, &key->clip);
+      snap_rect_to_grid (&key->clip);
+    }
+}
+
 static void
 draw_shadow (cairo_t             *cr,
              gboolean             inset,
@@ -811,11 +908,30 @@ draw_shadow (cairo_t             *cr,
              const GdkRGBA       *color,
 	     GskBlurFlags         blur_flags)
 {
+  GskCairoShadowKey key;
+  cairo_surface_t *mask;
   cairo_t *shadow_cr;
+  gboolean blurred;
 
   if (has_empty_clip (cr))
     return;
 
+  blurred = radius > 1.0 && (blur_flags & (GSK_BLUR_X | GSK_BLUR_Y)) != 0;
+
+  if (blurred)
+    {
+      shadow_key_init (&key, cr, inset, box, clip_box, radius, blur_flags);
+
+      mask = gsk_cairo_shadow_cache_lookup (&key);
+      report_shadow_cache ();
+      if (mask)
+        {
+          gsk_cairo_blur_draw_mask (cr, mask, radius, color, blur_flags);
+          cairo_surface_destroy (mask);
+          return;
+        }
+    }
+
   gdk_cairo_set_source_rgba (cr, color);
   shadow_cr = gsk_cairo_blur_start_drawing (cr, radius, blur_flags);
 
@@ -826,13 +942,19 @@ draw_shadow (cairo_t             *cr,
 
   cairo_fill (shadow_cr);
 
+  if (blurred && shadow_cr != cr)
+    mask = cairo_surface_reference (cairo_get_target (shadow_cr));
+  else
+    mask = NULL;
+
   gsk_cairo_blur_finish_drawing (shadow_cr, radius, color, blur_flags);
-}
 
-typedef struct {
-  float radius;
-  graphene_size_t corner;
-} CornerMask;
+  if (mask)
+    {
+      gsk_cairo_shadow_cache_commit (&key, mask);
+      cairo_surface_destroy (mask);
+    }
+}
 
 typedef enum {
   TOP,
@@ -841,24 +963,6 @@ typedef enum {
   LEFT
 } Side;
 
-static guint
-corner_mask_hash (CornerMask *mask)
-{
-  return ((guint)mask->radius << 24) ^
-    ((guint)(mask->corner.width*4)) << 12 ^
-    ((guint)(mask->corner.height*4)) << 0;
-}
-
-static gboolean
-corner_mask_equal (CornerMask *mask1,
-                   CornerMask *mask2)
-{
-  return
-    mask1->radius == mask2->radius &&
-    mask1->corner.width == mask2->corner.width &&
-    mask1->corner.height == mask2->corner.height;
-}
-
 static void
 draw_shadow_corner (cairo_t               *cr,
                     gboolean               inset,
@@ -877,9 +981,8 @@ draw_shadow_corner (cairo_t               *cr,
   cairo_pattern_t *pattern;
   cairo_matrix_t matrix;
   float sx, sy;
-  static GHashTable *corner_mask_cache = NULL;
   float max_other;
-  CornerMask key;
+  GskCairoShadowKey key;
   gboolean overlapped;
 
   clip_radius = gsk_cairo_blur_compute_pixels (radius);
@@ -965,15 +1068,13 @@ draw_shadow_corner (cairo_t               *cr,
    * mask, so we cache rendered masks based on the blur radius and the
    * corner radius.
    */
-  if (corner_mask_cache == NULL)
-    corner_mask_cache = g_hash_table_new_full ((GHashFunc)corner_mask_hash,
-                                               (GEqualFunc)corner_mask_equal,
-                                               g_free, (GDestroyNotify)cairo_surface_destroy);
-
-  key.radius = radius;
-  key.corner = box->corner[corner];
+  memset (&key, 0, sizeof (GskCairoShadowKey));
+  key.kind = GSK_CAIRO_SHADOW_CORNER;
+  key.blur_radius = radius;
+  key.outline.corner[0] = box->corner[corner];
 
-  mask = g_hash_table_lookup (corner_mask_cache, &key);
+  mask = gsk_cairo_shadow_cache_lookup (&key);
+  report_shadow_cache ();
   if (mask == NULL)
     {
       mask = cairo_surface_create_similar_image (cairo_get_target (cr), CAIRO_FORMAT_A8,
@@ -986,7 +1087,7 @@ draw_shadow_corner (cairo_t               *cr,
       cairo_fill (mask_cr);
       gsk_cairo_blur_surface (mask, radius, GSK_BLUR_X | GSK_BLUR_Y);
       cairo_destroy (mask_cr);
-      g_hash_table_insert (corner_mask_cache, g_memdup (&key, sizeof (key)), mask);
+      gsk_cairo_shadow_cache_commit (&key, mask);
     }
 
   gdk_cairo_set_source_rgba (cr, color);
@@ -997,6 +1098,7 @@ draw_shadow_corner (cairo_t               *cr,
   cairo_pattern_set_matrix (pattern, &matrix);
   cairo_mask (cr, pattern);
   cairo_pattern_destroy (pattern);
+  cairo_surface_destroy (mask);
 }
 
 static void
@@ -3760,154 +3862,6 @@ gsk_blur_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
-static void
-blur_once (cairo_surface_t *src,
-           cairo_surface_t *dest,
-           int radius,
-           guchar *div_kernel_size)
-{
-  int width, height, src_rowstride, dest_rowstride, n_channels;
-  guchar *p_src, *p_dest, *c1, *c2;
-  int x, y, i, i1, i2, width_minus_1, height_minus_1, radius_plus_1;
-  int r, g, b, a;
-  guchar *p_dest_row, *p_dest_col;
-
-  width = cairo_image_surface_get_width (src);
-  height = cairo_image_surface_get_height (src);
-  n_channels = 4;
-  radius_plus_1 = radius + 1;
-
-  /* horizontal blur */
-  p_src = cairo_image_surface_get_data (src);
-  p_dest = cairo_image_surface_get_data (dest);
-  src_rowstride = cairo_image_surface_get_stride (src);
-  dest_rowstride = cairo_image_surface_get_stride (dest);
-
-  width_minus_1 = width - 1;
-  for (y = 0; y < height; y++)
-    {
-      /* calc the initial sums of the kernel */
-      r = g = b = a = 0;
-      for (i = -radius; i <= radius; i++)
-        {
-          c1 = p_src + (CLAMP (i, 0, width_minus_1) * n_channels);
-          r += c1[0];
-          g += c1[1];
-          b += c1[2];
-          a += c1[3];
-        }
-      p_dest_row = p_dest;
-      for (x = 0; x < width; x++)
-        {
-          /* set as the mean of the kernel */
-          p_dest_row[0] = div_kernel_size[r];
-          p_dest_row[1] = div_kernel_size[g];
-          p_dest_row[2] = div_kernel_size[b];
-          p_dest_row[3] = div_kernel_size[a];
-          p_dest_row += n_channels;
-
-          /* the pixel to add to the kernel */
-          i1 = x + radius_plus_1;
-          if (i1 > width_minus_1)
-            i1 = width_minus_1;
-          c1 = p_src + (i1 * n_channels);
-
-          /* the pixel to remove from the kernel */
-          i2 = x - radius;
-          if (i2 < 0)
-            i2 = 0;
-          c2 = p_src + (i2 * n_channels);
-
-          /* calc the new sums of the kernel */
-          r += c1[0] - c2[0];
-          g += c1[1] - c2[1];
-          b += c1[2] - c2[2];
-          a += c1[3] - c2[3];
-        }
-
-      p_src += src_rowstride;
-      p_dest += dest_rowstride;
-    }
-
-  /* vertical blur */
-  p_src = cairo_image_surface_get_data (dest);
-  p_dest = cairo_image_surface_get_data (src);
-  src_rowstride = cairo_image_surface_get_stride (dest);
-  dest_rowstride = cairo_image_surface_get_stride (src);
-
-  height_minus_1 = height - 1;
-  for (x = 0; x < width; x++)
-    {
-      /* calc the initial sums of the kernel */
-      r = g = b = a = 0;
-      for (i = -radius; i <= radius; i++)
-        {
-          c1 = p_src + (CLAMP (i, 0, height_minus_1) * src_rowstride);
-          r += c1[0];
-          g += c1[1];
-          b += c1[2];
-          a += c1[3];
-        }
-
-      p_dest_col = p_dest;
-      for (y = 0; y < height; y++)
-        {
-          /* set as the mean of the kernel */
-
-          p_dest_col[0] = div_kernel_size[r];
-          p_dest_col[1] = div_kernel_size[g];
-          p_dest_col[2] = div_kernel_size[b];
-          p_dest_col[3] = div_kernel_size[a];
-          p_dest_col += dest_rowstride;
-
-          /* the pixel to add to the kernel */
-          i1 = y + radius_plus_1;
-          if (i1 > height_minus_1)
-            i1 = height_minus_1;
-          c1 = p_src + (i1 * src_rowstride);
-
-          /* the pixel to remove from the kernel */
-          i2 = y - radius;
-          if (i2 < 0)
-            i2 = 0;
-          c2 = p_src + (i2 * src_rowstride);
-          /* calc the new sums of the kernel */
-          r += c1[0] - c2[0];
-          g += c1[1] - c2[1];
-          b += c1[2] - c2[2];
-          a += c1[3] - c2[3];
-        }
-
-      p_src += n_channels;
-      p_dest += n_channels;
-    }
-}
-
-static void
-blur_image_surface (cairo_surface_t *surface, int radius, int iterations)
-{
-  int kernel_size;
-  int i;
-  guchar *div_kernel_size;
-  cairo_surface_t *tmp;
-  int width, height;
-
-  width = cairo_image_surface_get_width (surface);
-  height = cairo_image_surface_get_height (surface);
-  tmp = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-
-  kernel_size = 2 * radius + 1;
-  div_kernel_size = g_new (guchar, 256 * kernel_size);
-  for (i = 0; i < 256 * kernel_size; i++)
-    div_kernel_size[i] = (guchar) (i / kernel_size);
-
-  while (iterations-- > 0)
-    blur_once (surface, tmp, radius, div_kernel_size);
-
-  g_free (div_kernel_size);
-  cairo_surface_destroy (tmp);
-}
-
 static void
 gsk_blur_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
@@ -3930,7 +3884,7 @@ gsk_blur_node_draw (GskRenderNode *node,
   pattern = cairo_pop_group (cr);
   cairo_pattern_get_surface (pattern, &surface);
   image_surface = cairo_surface_map_to_image (surface, NULL);
-  blur_image_surface (image_surface, (int)self->radius, 3);
+  gsk_cairo_blur_argb_surface (image_surface, (int)self->radius, 3);
   cairo_surface_mark_dirty (surface);
   cairo_surface_unmap_image (surface, image_surface);
 
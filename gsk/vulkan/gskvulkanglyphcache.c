@@ -16,11 +16,21 @@
  * count of the pixels of each atlas that are taken up by old glyphs. We check the
  * fraction of old pixels every CHECK_INTERVAL frames, and if it is above MAX_OLD, then
  * we drop the atlas an all the glyphs contained in it from the cache.
+ *
+ * The cache is shared by all renderers of a display. The timestamp only advances when a
+ * renderer begins its second frame since the last advance, so with several windows it
+ * still counts frames of a single window, not the sum of all their frames.
+ *
+ * If the atlases use more memory than the budget allows, we also drop the least recently
+ * used atlases, as long as they have not been used since the previous check or in the
+ * last frame of any renderer sharing the cache.
  */
 
 #define MAX_AGE 60
 #define CHECK_INTERVAL 10
 #define MAX_OLD 0.333
+#define ATLAS_SIZE 512
+#define ATLAS_BYTES (ATLAS_SIZE * ATLAS_SIZE * 4)
 
 
 typedef struct {
@@ -30,18 +40,19 @@ typedef struct {
   int num_glyphs;
   GList *dirty_glyphs;
   guint old_pixels;
+  guint pixels;
+  guint64 last_used;
 } Atlas;
 
 struct _GskVulkanGlyphCache {
   GObject parent_instance;
 
-  GdkVulkanContext *vulkan;
-  GskRenderer *renderer;
-
   GHashTable *hash_table;
   GPtrArray *atlases;
 
+  gsize max_bytes;
   guint64 timestamp;
+  GHashTable *renderer_frames;
 };
 
 struct _GskVulkanGlyphCacheClass {
@@ -63,14 +74,15 @@ create_atlas (GskVulkanGlyphCache *cache)
   Atlas *atlas;
 
   atlas = g_new0 (Atlas, 1);
-  atlas->width = 512;
-  atlas->height = 512;
+  atlas->width = ATLAS_SIZE;
+  atlas->height = ATLAS_SIZE;
   atlas->y0 = 1;
   atlas->y = 1;
   atlas->x = 1;
   atlas->image = NULL;
   atlas->num_glyphs = 0;
   atlas->dirty_glyphs = NULL;
+  atlas->last_used = cache->timestamp;
 
   return atlas;
 }
@@ -91,6 +103,8 @@ gsk_vulkan_glyph_cache_init (GskVulkanGlyphCache *cache)
   cache->hash_table = g_hash_table_new_full (glyph_cache_hash, glyph_cache_equal,
                                              glyph_cache_key_free, glyph_cache_value_free);
   cache->atlases = g_ptr_array_new_with_free_func (free_atlas);
+  cache->max_bytes = gsk_get_atlas_budget ();
+  cache->renderer_frames = g_hash_table_new_full (NULL, NULL, NULL, g_free);
 }
 
 static void
@@ -100,6 +114,7 @@ gsk_vulkan_glyph_cache_finalize (GObject *object)
 
   g_ptr_array_unref (cache->atlases);
   g_hash_table_unref (cache->hash_table);
+  g_hash_table_unref (cache->renderer_frames);
 
   G_OBJECT_CLASS (gsk_vulkan_glyph_cache_parent_class)->finalize (object);
 }
@@ -230,9 +245,11 @@ add_to_cache (GskVulkanGlyphCache  *cache,
   atlas->y = MAX (atlas->y, atlas->y0 + height + 1);
 
   atlas->num_glyphs++;
+  atlas->pixels += width * height;
+  atlas->last_used = cache->timestamp;
 
 #ifdef G_ENABLE_DEBUG
-  if (GSK_RENDERER_DEBUG_CHECK (cache->renderer, GLYPH_CACHE))
+  if (GSK_DEBUG_CHECK (GLYPH_CACHE))
     {
       g_print ("Glyph cache:\n");
       for (i = 0; i < cache->atlases->len; i++)
@@ -309,8 +326,7 @@ upload_dirty_glyphs (GskVulkanGlyphCache *cache,
   for (l = atlas->dirty_glyphs, i = 0; l; l = l->next, i++)
     render_glyph (atlas, (DirtyGlyph *)l->data, &regions[i]);
 
-  GSK_RENDERER_NOTE (cache->renderer, GLYPH_CACHE,
-            g_message ("uploading %d glyphs to cache", num_regions));
+  GSK_NOTE (GLYPH_CACHE, g_message ("uploading %d glyphs to cache", num_regions));
 
   gsk_vulkan_image_upload_regions (atlas->image, uploader, num_regions, regions);
 
@@ -319,14 +335,11 @@ upload_dirty_glyphs (GskVulkanGlyphCache *cache,
 }
 
 GskVulkanGlyphCache *
-gsk_vulkan_glyph_cache_new (GskRenderer      *renderer,
-                            GdkVulkanContext *vulkan)
+gsk_vulkan_glyph_cache_new (void)
 {
   GskVulkanGlyphCache *cache;
 
   cache = GSK_VULKAN_GLYPH_CACHE (g_object_new (GSK_TYPE_VULKAN_GLYPH_CACHE, NULL));
-  cache->renderer = renderer;
-  cache->vulkan = vulkan;
   g_ptr_array_add (cache->atlases, create_atlas (cache));
 
   return cache;
@@ -361,13 +374,15 @@ gsk_vulkan_glyph_cache_lookup (GskVulkanGlyphCache *cache,
 
   if (value)
     {
+      Atlas *atlas = g_ptr_array_index (cache->atlases, value->texture_index);
+
       if (cache->timestamp - value->timestamp >= MAX_AGE)
         {
-          Atlas *atlas = g_ptr_array_index (cache->atlases, value->texture_index);
-
           atlas->old_pixels -= value->draw_width * value->draw_height;
           value->timestamp = cache->timestamp;
         }
+
+      atlas->last_used = cache->timestamp;
     }
 
   if (create && value == NULL)
@@ -404,6 +419,7 @@ gsk_vulkan_glyph_cache_lookup (GskVulkanGlyphCache *cache,
 
 GskVulkanImage *
 gsk_vulkan_glyph_cache_get_glyph_image (GskVulkanGlyphCache *cache,
+                                        GdkVulkanContext    *vulkan,
                                         GskVulkanUploader   *uploader,
                                         guint                index)
 {
@@ -414,7 +430,7 @@ gsk_vulkan_glyph_cache_get_glyph_image (GskVulkanGlyphCache *cache,
   atlas = g_ptr_array_index (cache->atlases, index);
 
   if (atlas->image == NULL)
-    atlas->image = gsk_vulkan_image_new_for_atlas (cache->vulkan, atlas->width, atlas->height);
+    atlas->image = gsk_vulkan_image_new_for_atlas (vulkan, atlas->width, atlas->height);
 
   if (atlas->dirty_glyphs)
     upload_dirty_glyphs (cache, atlas, uploader);
@@ -423,18 +439,81 @@ gsk_vulkan_glyph_cache_get_glyph_image (GskVulkanGlyphCache *cache,
 }
 
 void
-gsk_vulkan_glyph_cache_begin_frame (GskVulkanGlyphCache *cache)
+gsk_vulkan_glyph_cache_get_stats (GskVulkanGlyphCache *cache,
+                                  guint               *n_atlases,
+                                  gsize               *n_bytes,
+                                  gsize               *n_live_bytes)
+{
+  gsize live_pixels = 0;
+  guint i;
+
+  for (i = 0; i < cache->atlases->len; i++)
+    {
+      Atlas *atlas = g_ptr_array_index (cache->atlases, i);
+
+      live_pixels += atlas->pixels - MIN (atlas->old_pixels, atlas->pixels);
+    }
+
+  *n_atlases = cache->atlases->len;
+  *n_bytes = (gsize) cache->atlases->len * ATLAS_BYTES;
+  *n_live_bytes = live_pixels * 4;
+}
+
+static gboolean
+atlas_is_in_use (GskVulkanGlyphCache *cache,
+                 Atlas               *atlas)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (atlas->last_used + CHECK_INTERVAL >= cache->timestamp)
+    return TRUE;
+
+  g_hash_table_iter_init (&iter, cache->renderer_frames);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      if (atlas->last_used == *(guint64 *) value)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Each renderer sharing the cache calls this once per frame. The
+ * timestamp advances when @renderer already began a frame at the
+ * current timestamp, so renderers drawing in step share one frame.
+ */
+void
+gsk_vulkan_glyph_cache_begin_frame (GskVulkanGlyphCache *cache,
+                                    gpointer             renderer)
 {
-  int i, j;
+  guint i;
   guint *drops;
   guint *shifts;
-  guint len;
+  guint len, n_dropped_atlases;
   GHashTableIter iter;
   GlyphCacheKey *key;
   GskVulkanCachedGlyph *value;
   guint dropped = 0;
+  guint64 *frame;
+
+  frame = g_hash_table_lookup (cache->renderer_frames, renderer);
+  if (frame == NULL)
+    {
+      frame = g_new (guint64, 1);
+      *frame = cache->timestamp;
+      g_hash_table_insert (cache->renderer_frames, renderer, frame);
+      return;
+    }
+
+  if (*frame < cache->timestamp)
+    {
+      *frame = cache->timestamp;
+      return;
+    }
 
   cache->timestamp++;
+  *frame = cache->timestamp;
 
   if (cache->timestamp % CHECK_INTERVAL != 0)
     return;
@@ -457,34 +536,79 @@ gsk_vulkan_glyph_cache_begin_frame (GskVulkanGlyphCache *cache)
 
   drops = g_alloca (sizeof (guint) * len);
   shifts = g_alloca (sizeof (guint) * len);
+  n_dropped_atlases = 0;
 
+  /* look for atlases to drop */
   for (i = 0; i < len; i++)
     {
-      drops[i] = 0;
-      shifts[i] = i;
+      Atlas *atlas = g_ptr_array_index (cache->atlases, i);
+
+      drops[i] = atlas->old_pixels > MAX_OLD * atlas->width * atlas->height;
+      if (drops[i])
+        {
+          GSK_NOTE (GLYPH_CACHE,
+                    g_message ("Dropping atlas %u (%.2g%% old)", i, 100.0 * (double)atlas->old_pixels / (double)(atlas->width * atlas->height)));
+          n_dropped_atlases++;
+        }
     }
 
-  /* look for atlases to drop, and create a mapping of updated texture indices */
-  for (i = cache->atlases->len - 1; i >= 0; i--)
+  /* drop the least recently used atlases until we are within budget */
+  while ((gsize) (len - n_dropped_atlases) * ATLAS_BYTES > cache->max_bytes)
     {
-      Atlas *atlas = g_ptr_array_index (cache->atlases, i);
+      Atlas *oldest = NULL;
+      guint oldest_index = 0;
 
-      if (atlas->old_pixels > MAX_OLD * atlas->width * atlas->height)
+      for (i = 0; i < len; i++)
         {
-          GSK_RENDERER_NOTE(cache->renderer, GLYPH_CACHE,
-                   g_message ("Dropping atlas %d (%g.2%% old)", i, 100.0 * (double)atlas->old_pixels / (double)(atlas->width * atlas->height)));
-          g_ptr_array_remove_index (cache->atlases, i);
+          Atlas *atlas = g_ptr_array_index (cache->atlases, i);
+
+          if (drops[i] || atlas_is_in_use (cache, atlas))
+            continue;
 
-          drops[i] = 1;
-          for (j = i; j + 1 < len; j++)
-            shifts[j + 1] = shifts[j];
+          if (oldest == NULL || atlas->last_used < oldest->last_used)
+            {
+              oldest = atlas;
+              oldest_index = i;
+            }
         }
+
+      if (oldest == NULL)
+        break;
+
+      GSK_NOTE (GLYPH_CACHE,
+                g_message ("Dropping atlas %u (unused for %" G_GUINT64_FORMAT " frames) to stay within budget",
+                           oldest_index, cache->timestamp - oldest->last_used));
+      drops[oldest_index] = 1;
+      n_dropped_atlases++;
     }
 
+  GSK_NOTE (GLYPH_CACHE, {
+    if (cache->timestamp % (CHECK_INTERVAL * 6) == 0)
+      {
+        guint n_atlases;
+        gsize n_bytes, n_live_bytes;
+
+        gsk_vulkan_glyph_cache_get_stats (cache, &n_atlases, &n_bytes, &n_live_bytes);
+        g_message ("%u atlases, %" G_GSIZE_FORMAT " kB (%" G_GSIZE_FORMAT " kB live), %u glyphs cached",
+                   n_atlases, n_bytes / 1024, n_live_bytes / 1024,
+                   g_hash_table_size (cache->hash_table));
+      }
+  });
+
   /* no atlas dropped, we're done */
-  if (len == cache->atlases->len)
+  if (n_dropped_atlases == 0)
     return;
 
+  /* create a mapping of updated texture indices, and remove the atlases */
+  for (i = 0; i < len; i++)
+    shifts[i] = i == 0 ? 0 : shifts[i - 1] + (drops[i - 1] ? 0 : 1);
+
+  for (i = len; i > 0; i--)
+    {
+      if (drops[i - 1])
+        g_ptr_array_remove_index (cache->atlases, i - 1);
+    }
+
   /* purge glyphs and update texture indices */
   g_hash_table_iter_init (&iter, cache->hash_table);
 
@@ -501,5 +625,19 @@ gsk_vulkan_glyph_cache_begin_frame (GskVulkanGlyphCache *cache)
         }
     }
 
-  GSK_RENDERER_NOTE(cache->renderer, GLYPH_CACHE, g_message ("Dropped %d glyphs", dropped));
+  /* lookups always need an atlas to point to */
+  if (cache->atlases->len == 0)
+    g_ptr_array_add (cache->atlases, create_atlas (cache));
+
+  GSK_NOTE (GLYPH_CACHE, g_message ("Dropped %d glyphs", dropped));
+}
+
+/* Called when @renderer stops using the cache, so the atlases
+ * of its last frame are no longer kept around for it.
+ */
+void
+gsk_vulkan_glyph_cache_remove_renderer (GskVulkanGlyphCache *cache,
+                                        gpointer             renderer)
+{
+  g_hash_table_remove (cache->renderer_frames, renderer);
 }
@@ -11,10 +11,10 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE(GskVulkanGlyphCache, gsk_vulkan_glyph_cache, GSK, VULKAN_GLYPH_CACHE, GObject)
 
-GskVulkanGlyphCache  *gsk_vulkan_glyph_cache_new            (GskRenderer         *renderer,
-                                                             GdkVulkanContext    *vulkan);
+GskVulkanGlyphCache  *gsk_vulkan_glyph_cache_new            (void);
 
 GskVulkanImage *     gsk_vulkan_glyph_cache_get_glyph_image (GskVulkanGlyphCache *cache,
+                                                             GdkVulkanContext    *vulkan,
                                                              GskVulkanUploader   *uploader,
                                                              guint                index);
 
@@ -27,6 +27,14 @@ GskVulkanCachedGlyph *gsk_vulkan_glyph_cache_lookup         (GskVulkanGlyphCache
 
                                                              float                scale);
 
-void                  gsk_vulkan_glyph_cache_begin_frame    (GskVulkanGlyphCache *cache);
+void                  gsk_vulkan_glyph_cache_begin_frame    (GskVulkanGlyphCache *cache,
+                                                             gpointer             renderer);
+void                  gsk_vulkan_glyph_cache_remove_renderer (GskVulkanGlyphCache *cache,
+                                                              gpointer             renderer);
+
+void                  gsk_vulkan_glyph_cache_get_stats      (GskVulkanGlyphCache *cache,
+                                                             guint               *n_atlases,
+                                                             gsize               *n_bytes,
+                                                             gsize               *n_live_bytes);
 
 #endif /* __GSK_VULKAN_GLYPH_CACHE_PRIVATE_H__ */
@@ -3,52 +3,334 @@
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanmemoryprivate.h"
 
+/* Sub-allocation
+ *
+ * Allocating device memory is expensive, and implementations only
+ * guarantee maxMemoryAllocationCount (often 4096) live allocations.
+ * So we only use dedicated allocations for big resources. Smaller
+ * ones get a block of a slab: one allocation of SLAB_SIZE bytes that
+ * is split into blocks of the same power-of-two size class.
+ *
+ * Slabs are kept in a pool per context and memory type. Linear
+ * resources (buffers and linear images) and optimal images never
+ * share a slab, so we never have to care about bufferImageGranularity.
+ * Host-visible slabs are mapped once, for their whole lifetime, since
+ * a VkDeviceMemory can only be mapped once at a time.
+ *
+ * The pool is not owned by the context, it lives as long as there
+ * are allocations from it, and keeps the context alive until then.
+ */
+
+#define MIN_BLOCK_SHIFT 12 /* 4 kB */
+#define MAX_BLOCK_SHIFT 20 /* 1 MB */
+#define N_SIZE_CLASSES (MAX_BLOCK_SHIFT - MIN_BLOCK_SHIFT + 1)
+#define SLAB_SIZE (4 * 1024 * 1024)
+
+typedef struct _GskVulkanPool GskVulkanPool;
+typedef struct _GskVulkanSlab GskVulkanSlab;
+
+struct _GskVulkanSlab
+{
+  GskVulkanPool *pool;
+
+  VkDeviceMemory vk_memory;
+  guchar *map;
+
+  guint32 memory_type;
+  guint linear : 1;
+  guint size_class;
+
+  guint n_blocks;
+  guint n_free;
+  guint *free_blocks;
+};
+
+struct _GskVulkanPool
+{
+  int ref_count;
+
+  GdkVulkanContext *vulkan;
+  VkPhysicalDeviceMemoryProperties properties;
+
+  /* indexed by size class, linear resources come after optimal ones */
+  GPtrArray *slabs[2 * N_SIZE_CLASSES];
+};
+
 struct _GskVulkanMemory
 {
   GdkVulkanContext *vulkan;
 
   gsize size;
+  gsize offset;
 
   VkDeviceMemory vk_memory;
+
+  GskVulkanSlab *slab;
+  guint block;
 };
 
-GskVulkanMemory *
-gsk_vulkan_memory_new (GdkVulkanContext      *context,
-                       uint32_t               allowed_types,
-                       VkMemoryPropertyFlags  flags,
-                       gsize                  size)
+static guint n_device_allocations;
+static guint n_allocations;
+
+static VkDeviceMemory
+allocate_device_memory (GdkVulkanContext *context,
+                        uint32_t          memory_type,
+                        gsize             size)
 {
-  VkPhysicalDeviceMemoryProperties properties;
-  GskVulkanMemory *self;
-  uint32_t i;
+  VkDeviceMemory vk_memory;
 
-  self = g_slice_new0 (GskVulkanMemory);
+  GSK_VK_CHECK (vkAllocateMemory, gdk_vulkan_context_get_device (context),
+                                  &(VkMemoryAllocateInfo) {
+                                      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                      .allocationSize = size,
+                                      .memoryTypeIndex = memory_type
+                                  },
+                                  NULL,
+                                  &vk_memory);
 
-  self->vulkan = g_object_ref (context);
-  self->size = size;
+  n_device_allocations++;
 
+  return vk_memory;
+}
+
+static void
+free_device_memory (GdkVulkanContext *context,
+                    VkDeviceMemory    vk_memory)
+{
+  vkFreeMemory (gdk_vulkan_context_get_device (context),
+                vk_memory,
+                NULL);
+
+  n_device_allocations--;
+}
+
+static void
+gsk_vulkan_slab_free (gpointer data)
+{
+  GskVulkanSlab *slab = data;
+
+  g_assert (slab->n_free == slab->n_blocks);
+
+  if (slab->map)
+    vkUnmapMemory (gdk_vulkan_context_get_device (slab->pool->vulkan), slab->vk_memory);
+  free_device_memory (slab->pool->vulkan, slab->vk_memory);
+
+  g_free (slab->free_blocks);
+  g_slice_free (GskVulkanSlab, slab);
+}
+
+static GskVulkanPool *
+gsk_vulkan_pool_get (GdkVulkanContext *context)
+{
+  GskVulkanPool *pool;
+  guint i;
+
+  pool = g_object_get_data (G_OBJECT (context), "gsk-vulkan-memory-pool");
+  if (pool)
+    {
+      pool->ref_count++;
+      return pool;
+    }
+
+  pool = g_slice_new0 (GskVulkanPool);
+  pool->ref_count = 1;
+  pool->vulkan = g_object_ref (context);
   vkGetPhysicalDeviceMemoryProperties (gdk_vulkan_context_get_physical_device (context),
-                                       &properties);
+                                       &pool->properties);
+  for (i = 0; i < G_N_ELEMENTS (pool->slabs); i++)
+    pool->slabs[i] = g_ptr_array_new_with_free_func (gsk_vulkan_slab_free);
+
+  g_object_set_data (G_OBJECT (context), "gsk-vulkan-memory-pool", pool);
+
+  return pool;
+}
+
+static void
+gsk_vulkan_pool_unref (GskVulkanPool *pool)
+{
+  guint i;
+
+  g_assert (pool->ref_count > 0);
+
+  pool->ref_count--;
+  if (pool->ref_count > 0)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (pool->slabs); i++)
+    g_ptr_array_unref (pool->slabs[i]);
+
+  g_object_set_data (G_OBJECT (pool->vulkan), "gsk-vulkan-memory-pool", NULL);
+  g_object_unref (pool->vulkan);
+
+  g_slice_free (GskVulkanPool, pool);
+}
+
+static uint32_t
+find_memory_type (const VkPhysicalDeviceMemoryProperties *properties,
+                  uint32_t                                allowed_types,
+                  VkMemoryPropertyFlags                   flags)
+{
+  uint32_t i;
 
-  for (i = 0; i < properties.memoryTypeCount; i++)
+  for (i = 0; i < properties->memoryTypeCount; i++)
     {
       if (!(allowed_types & (1 << i)))
         continue;
 
-      if ((properties.memoryTypes[i].propertyFlags & flags) == flags)
+      if ((properties->memoryTypes[i].propertyFlags & flags) == flags)
         break;
   }
 
-  g_assert (i < properties.memoryTypeCount);
+  g_assert (i < properties->memoryTypeCount);
 
-  GSK_VK_CHECK (vkAllocateMemory, gdk_vulkan_context_get_device (context),
-                                  &(VkMemoryAllocateInfo) {
-                                      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-                                      .allocationSize = size,
-                                      .memoryTypeIndex = i
-                                  },
-                                  NULL,
-                                  &self->vk_memory);
+  return i;
+}
+
+static GskVulkanSlab *
+gsk_vulkan_slab_new (GskVulkanPool *pool,
+                     uint32_t       memory_type,
+                     gboolean       linear,
+                     guint          size_class)
+{
+  GskVulkanSlab *slab;
+  guint i;
+
+  slab = g_slice_new0 (GskVulkanSlab);
+  slab->pool = pool;
+  slab->memory_type = memory_type;
+  slab->linear = linear;
+  slab->size_class = size_class;
+  slab->n_blocks = SLAB_SIZE >> (MIN_BLOCK_SHIFT + size_class);
+  slab->n_free = slab->n_blocks;
+  slab->free_blocks = g_new (guint, slab->n_blocks);
+  /* hand out the blocks in order */
+  for (i = 0; i < slab->n_blocks; i++)
+    slab->free_blocks[i] = slab->n_blocks - 1 - i;
+
+  slab->vk_memory = allocate_device_memory (pool->vulkan, memory_type, SLAB_SIZE);
+
+  if (pool->properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+      void *data;
+
+      GSK_VK_CHECK (vkMapMemory, gdk_vulkan_context_get_device (pool->vulkan),
+                                 slab->vk_memory,
+                                 0,
+                                 VK_WHOLE_SIZE,
+                                 0,
+                                 &data);
+      slab->map = data;
+    }
+
+  return slab;
+}
+
+static gboolean
+gsk_vulkan_memory_suballocate (GskVulkanMemory *self,
+                               GskVulkanPool   *pool,
+                               uint32_t         memory_type,
+                               gboolean         linear,
+                               gsize            size,
+                               gsize            alignment)
+{
+  GskVulkanSlab *slab = NULL;
+  GPtrArray *slabs;
+  guint size_class, i;
+
+  size = MAX (size, alignment);
+  if (size > (1 << MAX_BLOCK_SHIFT))
+    return FALSE;
+
+  for (size_class = 0; ((gsize) 1 << (MIN_BLOCK_SHIFT + size_class)) < size; size_class++)
+    ;
+
+  slabs = pool->slabs[size_class + (linear ? N_SIZE_CLASSES : 0)];
+  for (i = 0; i < slabs->len; i++)
+    {
+      GskVulkanSlab *candidate = g_ptr_array_index (slabs, i);
+
+      if (candidate->memory_type == memory_type && candidate->n_free > 0)
+        {
+          slab = candidate;
+          break;
+        }
+    }
+
+  if (slab == NULL)
+    {
+      slab = gsk_vulkan_slab_new (pool, memory_type, linear, size_class);
+      g_ptr_array_add (slabs, slab);
+    }
+
+  slab->n_free--;
+  self->slab = slab;
+  self->block = slab->free_blocks[slab->n_free];
+  self->offset = (gsize) self->block << (MIN_BLOCK_SHIFT + size_class);
+  self->vk_memory = slab->vk_memory;
+
+  return TRUE;
+}
+
+static void
+gsk_vulkan_memory_release_block (GskVulkanMemory *self)
+{
+  GskVulkanSlab *slab = self->slab;
+  GskVulkanPool *pool = slab->pool;
+
+  slab->free_blocks[slab->n_free] = self->block;
+  slab->n_free++;
+
+  /* Give empty slabs back, but keep one per size class around,
+   * so that allocating and freeing the same size does not thrash.
+   */
+  if (slab->n_free == slab->n_blocks)
+    {
+      GPtrArray *slabs = pool->slabs[slab->size_class + (slab->linear ? N_SIZE_CLASSES : 0)];
+      guint i, n_empty = 0;
+
+      for (i = 0; i < slabs->len; i++)
+        {
+          GskVulkanSlab *other = g_ptr_array_index (slabs, i);
+
+          if (other->n_free == other->n_blocks)
+            n_empty++;
+        }
+
+      if (n_empty > 1)
+        g_ptr_array_remove_fast (slabs, slab);
+    }
+
+  gsk_vulkan_pool_unref (pool);
+}
+
+GskVulkanMemory *
+gsk_vulkan_memory_new (GdkVulkanContext           *context,
+                       const VkMemoryRequirements *requirements,
+                       VkMemoryPropertyFlags       flags,
+                       gboolean                    linear)
+{
+  GskVulkanPool *pool;
+  GskVulkanMemory *self;
+  uint32_t memory_type;
+
+  self = g_slice_new0 (GskVulkanMemory);
+
+  self->vulkan = g_object_ref (context);
+  self->size = requirements->size;
+
+  pool = gsk_vulkan_pool_get (context);
+  memory_type = find_memory_type (&pool->properties, requirements->memoryTypeBits, flags);
+
+  if (!gsk_vulkan_memory_suballocate (self, pool, memory_type, linear,
+                                      requirements->size, requirements->alignment))
+    {
+      gsk_vulkan_pool_unref (pool);
+
+      self->offset = 0;
+      self->vk_memory = allocate_device_memory (context, memory_type, requirements->size);
+    }
+
+  n_allocations++;
 
   return self;
 }
@@ -56,9 +338,12 @@ gsk_vulkan_memory_new (GdkVulkanContext      *context,
 void
 gsk_vulkan_memory_free (GskVulkanMemory *self)
 {
-  vkFreeMemory (gdk_vulkan_context_get_device (self->vulkan),
-                self->vk_memory,
-                NULL);
+  if (self->slab)
+    gsk_vulkan_memory_release_block (self);
+  else
+    free_device_memory (self->vulkan, self->vk_memory);
+
+  n_allocations--;
 
   g_object_unref (self->vulkan);
 
@@ -71,11 +356,24 @@ gsk_vulkan_memory_get_device_memory (GskVulkanMemory *self)
   return self->vk_memory;
 }
 
+gsize
+gsk_vulkan_memory_get_offset (GskVulkanMemory *self)
+{
+  return self->offset;
+}
+
 guchar *
 gsk_vulkan_memory_map (GskVulkanMemory *self)
 {
   void *data;
 
+  if (self->slab)
+    {
+      g_assert (self->slab->map);
+
+      return self->slab->map + self->offset;
+    }
+
   GSK_VK_CHECK (vkMapMemory, gdk_vulkan_context_get_device (self->vulkan),
                              self->vk_memory,
                              0,
@@ -89,7 +387,28 @@ gsk_vulkan_memory_map (GskVulkanMemory *self)
 void
 gsk_vulkan_memory_unmap (GskVulkanMemory *self)
 {
+  /* slabs stay mapped */
+  if (self->slab)
+    return;
+
   vkUnmapMemory (gdk_vulkan_context_get_device (self->vulkan),
                  self->vk_memory);
 }
 
+/*
+ * gsk_vulkan_memory_get_stats:
+ * @n_device_allocations: (out): return location for the number
+ *   of live vkAllocateMemory() allocations
+ * @n_allocations: (out): return location for the number of
+ *   live #GskVulkanMemory allocations
+ *
+ * Returns counts of the memory that is currently allocated,
+ * for reporting to the profiler.
+ */
+void
+gsk_vulkan_memory_get_stats (guint *n_device_allocations_out,
+                             guint *n_allocations_out)
+{
+  *n_device_allocations_out = n_device_allocations;
+  *n_allocations_out = n_allocations;
+}
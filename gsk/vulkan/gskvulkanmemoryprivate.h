@@ -8,16 +8,20 @@ G_BEGIN_DECLS
 typedef struct _GskVulkanMemory GskVulkanMemory;
 
 GskVulkanMemory *       gsk_vulkan_memory_new                           (GdkVulkanContext       *context,
-                                                                         uint32_t                allowed_types,
+                                                                         const VkMemoryRequirements *requirements,
                                                                          VkMemoryPropertyFlags   properties,
-                                                                         gsize                   size);
+                                                                         gboolean                linear);
 void                    gsk_vulkan_memory_free                          (GskVulkanMemory        *memory);
 
 VkDeviceMemory          gsk_vulkan_memory_get_device_memory             (GskVulkanMemory        *self);
+gsize                   gsk_vulkan_memory_get_offset                    (GskVulkanMemory        *self);
 
 guchar *                gsk_vulkan_memory_map                           (GskVulkanMemory        *self);
 void                    gsk_vulkan_memory_unmap                         (GskVulkanMemory        *self);
 
+void                    gsk_vulkan_memory_get_stats                     (guint                  *n_device_allocations,
+                                                                         guint                  *n_allocations);
+
 G_END_DECLS
 
 #endif /* __GSK_VULKAN_MEMORY_PRIVATE_H__ */
@@ -26,6 +26,11 @@
 #define DESCRIPTOR_POOL_MAXSETS 128
 #define DESCRIPTOR_POOL_MAXSETS_INCREASE 128
 
+/* The vertex data of all render passes of a frame is put into one
+ * buffer that is reused in the next frame. */
+#define VERTEX_BUFFER_MIN_SIZE (64 * 1024)
+#define VERTEX_DATA_ALIGNMENT 16
+
 struct _GskVulkanRender
 {
   GskRenderer *renderer;
@@ -58,6 +63,11 @@ struct _GskVulkanRender
   GList *render_passes;
   GSList *cleanup_images;
 
+  GskVulkanBuffer *vertex_buffer;
+  guchar *vertex_data;
+  gsize vertex_buffer_used;
+  GSList *cleanup_buffers;
+
   GQuark render_pass_counter;
   GQuark gpu_time_timer;
 };
@@ -643,6 +653,49 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 #endif
 }
 
+/* Reserves @size bytes of vertex data for this frame.
+ * Returns the start of the mapped buffer, the data is to be put at @offset.
+ */
+guchar *
+gsk_vulkan_render_alloc_vertex_data (GskVulkanRender  *self,
+                                     gsize             size,
+                                     GskVulkanBuffer **buffer,
+                                     gsize            *offset)
+{
+  gsize start;
+
+  start = (self->vertex_buffer_used + VERTEX_DATA_ALIGNMENT - 1) & ~(gsize) (VERTEX_DATA_ALIGNMENT - 1);
+
+  if (self->vertex_buffer == NULL ||
+      start + size > gsk_vulkan_buffer_get_size (self->vertex_buffer))
+    {
+      gsize new_size = VERTEX_BUFFER_MIN_SIZE;
+
+      if (self->vertex_buffer)
+        {
+          new_size = MAX (new_size, 2 * gsk_vulkan_buffer_get_size (self->vertex_buffer));
+
+          /* Earlier render passes of this frame may still use it */
+          gsk_vulkan_buffer_unmap (self->vertex_buffer);
+          self->cleanup_buffers = g_slist_prepend (self->cleanup_buffers, self->vertex_buffer);
+        }
+
+      while (new_size < size)
+        new_size *= 2;
+
+      self->vertex_buffer = gsk_vulkan_buffer_new (self->vulkan, new_size);
+      self->vertex_data = gsk_vulkan_buffer_map (self->vertex_buffer);
+      start = 0;
+    }
+
+  self->vertex_buffer_used = start + size;
+
+  *buffer = self->vertex_buffer;
+  *offset = start;
+
+  return self->vertex_data;
+}
+
 GdkTexture *
 gsk_vulkan_render_download_target (GskVulkanRender *self)
 {
@@ -680,6 +733,9 @@ gsk_vulkan_render_cleanup (GskVulkanRender *self)
   self->render_passes = NULL;
   g_slist_free_full (self->cleanup_images, g_object_unref);
   self->cleanup_images = NULL;
+  g_slist_free_full (self->cleanup_buffers, (GDestroyNotify) gsk_vulkan_buffer_free);
+  self->cleanup_buffers = NULL;
+  self->vertex_buffer_used = 0;
 
   g_clear_pointer (&self->clip, cairo_region_destroy);
   g_clear_object (&self->target);
@@ -716,6 +772,12 @@ gsk_vulkan_render_free (GskVulkanRender *self)
 
   g_clear_pointer (&self->uploader, gsk_vulkan_uploader_free);
 
+  if (self->vertex_buffer)
+    {
+      gsk_vulkan_buffer_unmap (self->vertex_buffer);
+      g_clear_pointer (&self->vertex_buffer, gsk_vulkan_buffer_free);
+    }
+
   for (i = 0; i < 3; i++)
     vkDestroyPipelineLayout (device,
                              self->pipeline_layout[i],
@@ -8,6 +8,7 @@
 #include "gskrendernodeprivate.h"
 #include "gskvulkanbufferprivate.h"
 #include "gskvulkanimageprivate.h"
+#include "gskvulkanmemoryprivate.h"
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanrenderprivate.h"
 #include "gskvulkanglyphcacheprivate.h"
@@ -29,6 +30,11 @@ struct _GskVulkanTextureData {
 typedef struct {
   GQuark frames;
   GQuark render_passes;
+  GQuark atlases;
+  GQuark atlas_bytes;
+  GQuark atlas_live_bytes;
+  GQuark device_allocations;
+  GQuark allocations;
   GQuark fallback_pixels;
   GQuark texture_pixels;
 } ProfileCounters;
@@ -112,6 +118,26 @@ gsk_vulkan_renderer_update_images_cb (GdkVulkanContext  *context,
     }
 }
 
+static GskVulkanGlyphCache *
+get_glyph_cache_for_display (GdkDisplay *display)
+{
+  GskVulkanGlyphCache *glyph_cache;
+
+  if (g_getenv ("GSK_NO_SHARED_CACHES"))
+    return gsk_vulkan_glyph_cache_new ();
+
+  glyph_cache = (GskVulkanGlyphCache *) g_object_get_data (G_OBJECT (display), "gsk-vulkan-glyph-cache");
+  if (glyph_cache == NULL)
+    {
+      glyph_cache = gsk_vulkan_glyph_cache_new ();
+      g_object_set_data_full (G_OBJECT (display), "gsk-vulkan-glyph-cache",
+                              glyph_cache,
+                              g_object_unref);
+    }
+
+  return g_object_ref (glyph_cache);
+}
+
 static gboolean
 gsk_vulkan_renderer_realize (GskRenderer  *renderer,
                              GdkSurface    *window,
@@ -131,7 +157,7 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
 
   self->render = gsk_vulkan_render_new (renderer, self->vulkan);
 
-  self->glyph_cache = gsk_vulkan_glyph_cache_new (renderer, self->vulkan);
+  self->glyph_cache = get_glyph_cache_for_display (gdk_surface_get_display (window));
 
   return TRUE;
 }
@@ -142,6 +168,7 @@ gsk_vulkan_renderer_unrealize (GskRenderer *renderer)
   GskVulkanRenderer *self = GSK_VULKAN_RENDERER (renderer);
   GSList *l;
 
+  gsk_vulkan_glyph_cache_remove_renderer (self->glyph_cache, self);
   g_clear_object (&self->glyph_cache);
 
   for (l = self->textures; l; l = l->next)
@@ -250,6 +277,8 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
   gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (self->vulkan), region);
   render = self->render;
 
+  gsk_vulkan_glyph_cache_begin_frame (self->glyph_cache, self);
+
   clip = gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->vulkan));
   gsk_vulkan_render_reset (render, self->targets[gdk_vulkan_context_get_draw_index (self->vulkan)], NULL, clip);
 
@@ -262,6 +291,24 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
 
+  {
+    guint n_atlases;
+    gsize n_bytes, n_live_bytes;
+
+    gsk_vulkan_glyph_cache_get_stats (self->glyph_cache, &n_atlases, &n_bytes, &n_live_bytes);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlases, n_atlases);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_bytes, n_bytes);
+    gsk_profiler_counter_set (profiler, self->profile_counters.atlas_live_bytes, n_live_bytes);
+  }
+
+  {
+    guint n_device_allocations, n_allocations;
+
+    gsk_vulkan_memory_get_stats (&n_device_allocations, &n_allocations);
+    gsk_profiler_counter_set (profiler, self->profile_counters.device_allocations, n_device_allocations);
+    gsk_profiler_counter_set (profiler, self->profile_counters.allocations, n_allocations);
+  }
+
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
@@ -294,6 +341,11 @@ gsk_vulkan_renderer_init (GskVulkanRenderer *self)
 #ifdef G_ENABLE_DEBUG
   self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
   self->profile_counters.render_passes = gsk_profiler_add_counter (profiler, "render-passes", "Render passes", FALSE);
+  self->profile_counters.atlases = gsk_profiler_add_counter (profiler, "atlases", "Glyph atlases", FALSE);
+  self->profile_counters.atlas_bytes = gsk_profiler_add_counter (profiler, "atlas-bytes", "Glyph atlas bytes", FALSE);
+  self->profile_counters.atlas_live_bytes = gsk_profiler_add_counter (profiler, "atlas-live-bytes", "Glyph atlas bytes in use", FALSE);
+  self->profile_counters.device_allocations = gsk_profiler_add_counter (profiler, "device-allocations", "Device memory allocations", FALSE);
+  self->profile_counters.allocations = gsk_profiler_add_counter (profiler, "allocations", "Memory sub-allocations", FALSE);
   self->profile_counters.fallback_pixels = gsk_profiler_add_counter (profiler, "fallback-pixels", "Fallback pixels", TRUE);
   self->profile_counters.texture_pixels = gsk_profiler_add_counter (profiler, "texture-pixels", "Texture pixels", TRUE);
 
@@ -367,7 +419,7 @@ gsk_vulkan_renderer_ref_glyph_image (GskVulkanRenderer  *self,
                                      GskVulkanUploader  *uploader,
                                      guint               index)
 {
-  return g_object_ref (gsk_vulkan_glyph_cache_get_glyph_image (self->glyph_cache, uploader, index));
+  return g_object_ref (gsk_vulkan_glyph_cache_get_glyph_image (self->glyph_cache, self->vulkan, uploader, index));
 }
 
 guint
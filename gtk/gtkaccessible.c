@@ -44,6 +44,7 @@
 
 #include "gtkaccessibleprivate.h"
 
+#include "gtkaccessiblevalueprivate.h"
 #include "gtkatcontextprivate.h"
 #include "gtkenums.h"
 #include "gtktypebuiltins.h"
@@ -65,6 +66,148 @@ gtk_accessible_default_init (GtkAccessibleInterface *iface)
                        G_PARAM_STATIC_STRINGS);
 
   g_object_interface_install_property (iface, pspec);
+
+  quark_pending_changes = g_quark_from_static_string ("gtk-accessible-pending-changes");
+}
+
+/* Accessibles usually only create their AT context when something
+ * asks for it, and many never do. Until then, we keep the attributes
+ * that get updated in a small array, and move them to the context
+ * when it gets created.
+ */
+typedef enum {
+  PENDING_STATE,
+  PENDING_PROPERTY,
+  PENDING_RELATION
+} PendingKind;
+
+typedef struct {
+  PendingKind kind;
+  int attribute;
+  GtkAccessibleValue *value;
+} PendingChange;
+
+static GQuark quark_pending_changes;
+
+static void
+pending_change_clear (gpointer data)
+{
+  PendingChange *change = data;
+
+  g_clear_pointer (&change->value, gtk_accessible_value_unref);
+}
+
+static void
+gtk_accessible_add_pending_change (GtkAccessible      *self,
+                                   PendingKind         kind,
+                                   int                 attribute,
+                                   GtkAccessibleValue *value)
+{
+  GArray *changes;
+  PendingChange change;
+  guint i;
+
+  changes = g_object_get_qdata (G_OBJECT (self), quark_pending_changes);
+  if (changes == NULL)
+    {
+      changes = g_array_new (FALSE, FALSE, sizeof (PendingChange));
+      g_array_set_clear_func (changes, pending_change_clear);
+      g_object_set_qdata_full (G_OBJECT (self), quark_pending_changes,
+                               changes, (GDestroyNotify) g_array_unref);
+    }
+
+  if (value != NULL)
+    gtk_accessible_value_ref (value);
+
+  /* Only the last value counts */
+  for (i = 0; i < changes->len; i++)
+    {
+      PendingChange *c = &g_array_index (changes, PendingChange, i);
+
+      if (c->kind == kind && c->attribute == attribute)
+        {
+          g_clear_pointer (&c->value, gtk_accessible_value_unref);
+          c->value = value;
+          return;
+        }
+    }
+
+  change.kind = kind;
+  change.attribute = attribute;
+  change.value = value;
+  g_array_append_val (changes, change);
+}
+
+static void
+gtk_accessible_apply_pending_changes (GtkAccessible *self,
+                                      GtkATContext  *context)
+{
+  GArray *changes;
+  guint i;
+
+  changes = g_object_steal_qdata (G_OBJECT (self), quark_pending_changes);
+  if (changes == NULL)
+    return;
+
+  for (i = 0; i < changes->len; i++)
+    {
+      PendingChange *change = &g_array_index (changes, PendingChange, i);
+
+      switch (change->kind)
+        {
+        case PENDING_STATE:
+          gtk_at_context_set_accessible_state (context, change->attribute, change->value);
+          break;
+        case PENDING_PROPERTY:
+          gtk_at_context_set_accessible_property (context, change->attribute, change->value);
+          break;
+        case PENDING_RELATION:
+          gtk_at_context_set_accessible_relation (context, change->attribute, change->value);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  g_array_unref (changes);
+
+  gtk_at_context_queue_update (context);
+}
+
+static void
+gtk_accessible_set_state (GtkAccessible      *self,
+                          GtkATContext       *context,
+                          GtkAccessibleState  state,
+                          GtkAccessibleValue *value)
+{
+  if (context != NULL)
+    gtk_at_context_set_accessible_state (context, state, value);
+  else
+    gtk_accessible_add_pending_change (self, PENDING_STATE, state, value);
+}
+
+static void
+gtk_accessible_set_property (GtkAccessible         *self,
+                             GtkATContext          *context,
+                             GtkAccessibleProperty  property,
+                             GtkAccessibleValue    *value)
+{
+  if (context != NULL)
+    gtk_at_context_set_accessible_property (context, property, value);
+  else
+    gtk_accessible_add_pending_change (self, PENDING_PROPERTY, property, value);
+}
+
+static void
+gtk_accessible_set_relation (GtkAccessible         *self,
+                             GtkATContext          *context,
+                             GtkAccessibleRelation  relation,
+                             GtkAccessibleValue    *value)
+{
+  if (context != NULL)
+    gtk_at_context_set_accessible_relation (context, relation, value);
+  else
+    gtk_accessible_add_pending_change (self, PENDING_RELATION, relation, value);
 }
 
 /*< private >
@@ -78,9 +221,35 @@ gtk_accessible_default_init (GtkAccessibleInterface *iface)
 GtkATContext *
 gtk_accessible_get_at_context (GtkAccessible *self)
 {
+  GtkATContext *context;
+
   g_return_val_if_fail (GTK_IS_ACCESSIBLE (self), NULL);
 
-  return GTK_ACCESSIBLE_GET_IFACE (self)->get_at_context (self);
+  context = GTK_ACCESSIBLE_GET_IFACE (self)->get_at_context (self);
+  if (context != NULL)
+    gtk_accessible_apply_pending_changes (self, context);
+
+  return context;
+}
+
+/*< private >
+ * gtk_accessible_peek_at_context:
+ * @self: a #GtkAccessible
+ *
+ * Retrieves the #GtkATContext for the given #GtkAccessible, if
+ * it has been created already.
+ *
+ * Returns: (transfer none) (nullable): the #GtkATContext
+ */
+GtkATContext *
+gtk_accessible_peek_at_context (GtkAccessible *self)
+{
+  GtkAccessibleInterface *iface = GTK_ACCESSIBLE_GET_IFACE (self);
+
+  if (iface->peek_at_context == NULL)
+    return gtk_accessible_get_at_context (self);
+
+  return iface->peek_at_context (self);
 }
 
 /**
@@ -134,9 +303,7 @@ gtk_accessible_update_state (GtkAccessible      *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   va_start (args, first_state);
 
@@ -157,7 +324,7 @@ gtk_accessible_update_state (GtkAccessible      *self,
           goto out;
         }
 
-      gtk_at_context_set_accessible_state (context, state, value);
+      gtk_accessible_set_state (self, context, state, value);
 
       if (value != NULL)
         gtk_accessible_value_unref (value);
@@ -165,7 +332,8 @@ gtk_accessible_update_state (GtkAccessible      *self,
       state = va_arg (args, int);
     }
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 
 out:
   va_end (args);
@@ -193,9 +361,7 @@ gtk_accessible_update_state_value (GtkAccessible      *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   GError *error = NULL;
   GtkAccessibleValue *real_value =
@@ -210,12 +376,13 @@ gtk_accessible_update_state_value (GtkAccessible      *self,
       return;
     }
 
-  gtk_at_context_set_accessible_state (context, state, real_value);
+  gtk_accessible_set_state (self, context, state, real_value);
 
   if (real_value != NULL)
     gtk_accessible_value_unref (real_value);
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
 
 /**
@@ -233,12 +400,11 @@ gtk_accessible_reset_state (GtkAccessible      *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
-  gtk_at_context_set_accessible_state (context, state, NULL);
-  gtk_at_context_update (context);
+  gtk_accessible_set_state (self, context, state, NULL);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
 
 /**
@@ -272,9 +438,7 @@ gtk_accessible_update_property (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   va_start (args, first_property);
 
@@ -295,7 +459,7 @@ gtk_accessible_update_property (GtkAccessible         *self,
           goto out;
         }
 
-      gtk_at_context_set_accessible_property (context, property, value);
+      gtk_accessible_set_property (self, context, property, value);
 
       if (value != NULL)
         gtk_accessible_value_unref (value);
@@ -303,7 +467,8 @@ gtk_accessible_update_property (GtkAccessible         *self,
       property = va_arg (args, int);
     }
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 
 out:
   va_end (args);
@@ -331,9 +496,7 @@ gtk_accessible_update_property_value (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   GError *error = NULL;
   GtkAccessibleValue *real_value =
@@ -348,12 +511,13 @@ gtk_accessible_update_property_value (GtkAccessible         *self,
       return;
     }
 
-  gtk_at_context_set_accessible_property (context, property, real_value);
+  gtk_accessible_set_property (self, context, property, real_value);
 
   if (real_value != NULL)
     gtk_accessible_value_unref (real_value);
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
 
 /**
@@ -371,12 +535,11 @@ gtk_accessible_reset_property (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
-  gtk_at_context_set_accessible_property (context, property, NULL);
-  gtk_at_context_update (context);
+  gtk_accessible_set_property (self, context, property, NULL);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
 
 /**
@@ -401,9 +564,7 @@ gtk_accessible_update_relation (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   va_start (args, first_relation);
 
@@ -424,7 +585,7 @@ gtk_accessible_update_relation (GtkAccessible         *self,
           goto out;
         }
 
-      gtk_at_context_set_accessible_relation (context, relation, value);
+      gtk_accessible_set_relation (self, context, relation, value);
 
       if (value != NULL)
         gtk_accessible_value_unref (value);
@@ -432,7 +593,8 @@ gtk_accessible_update_relation (GtkAccessible         *self,
       relation = va_arg (args, int);
     }
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 
 out:
   va_end (args);
@@ -460,9 +622,7 @@ gtk_accessible_update_relation_value (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
   GError *error = NULL;
   GtkAccessibleValue *real_value =
@@ -477,12 +637,13 @@ gtk_accessible_update_relation_value (GtkAccessible         *self,
       return;
     }
 
-  gtk_at_context_set_accessible_relation (context, relation, real_value);
+  gtk_accessible_set_relation (self, context, relation, real_value);
 
   if (real_value != NULL)
     gtk_accessible_value_unref (real_value);
 
-  gtk_at_context_update (context);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
 
 /**
@@ -500,10 +661,9 @@ gtk_accessible_reset_relation (GtkAccessible         *self,
 
   g_return_if_fail (GTK_IS_ACCESSIBLE (self));
 
-  context = gtk_accessible_get_at_context (self);
-  if (context == NULL)
-    return;
+  context = gtk_accessible_peek_at_context (self);
 
-  gtk_at_context_set_accessible_relation (context, relation, NULL);
-  gtk_at_context_update (context);
+  gtk_accessible_set_relation (self, context, relation, NULL);
+  if (context != NULL)
+    gtk_at_context_queue_update (context);
 }
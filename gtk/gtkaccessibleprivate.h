@@ -30,8 +30,10 @@ struct _GtkAccessibleInterface
   GTypeInterface g_iface;
 
   GtkATContext *        (* get_at_context)      (GtkAccessible *self);
+  GtkATContext *        (* peek_at_context)     (GtkAccessible *self);
 };
 
 GtkATContext *  gtk_accessible_get_at_context   (GtkAccessible *self);
+GtkATContext *  gtk_accessible_peek_at_context  (GtkAccessible *self);
 
 G_END_DECLS
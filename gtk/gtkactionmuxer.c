@@ -161,6 +161,10 @@ struct _GtkActionMuxer
   GtkAccels primary_accels;
 
   GtkBitmask *widget_actions_disabled;
+
+  GHashTable *resolutions;
+  guint64 resolutions_serial;
+  guint64 changed_serial;
 };
 
 G_DEFINE_TYPE_WITH_CODE (GtkActionMuxer, gtk_action_muxer, G_TYPE_OBJECT,
@@ -192,6 +196,16 @@ typedef struct
   gulong        handler_ids[4];
 } Group;
 
+typedef struct
+{
+  GtkActionMuxer  *muxer;
+  GtkWidgetAction *widget_action;
+  Group           *group;
+} Resolution;
+
+/* See gtk_action_muxer_resolve() */
+static guint64 resolutions_serial = 0;
+
 static inline guint
 get_action_position (GtkWidgetAction *action)
 {
@@ -311,6 +325,108 @@ gtk_action_muxer_find (GtkActionMuxer  *muxer,
   return NULL;
 }
 
+static GtkWidgetAction *
+gtk_action_muxer_find_widget_action (GtkActionMuxer *muxer,
+                                     const char     *action_name)
+{
+  GtkWidgetAction *action;
+
+  if (!muxer->widget)
+    return NULL;
+
+  for (action = GTK_WIDGET_GET_CLASS (muxer->widget)->priv->actions; action; action = action->next)
+    {
+      if (strcmp (action->name, action_name) == 0)
+        return action;
+    }
+
+  return NULL;
+}
+
+static void
+gtk_action_muxer_invalidate_resolutions (GtkActionMuxer *muxer)
+{
+  muxer->changed_serial = ++resolutions_serial;
+}
+
+/* The last change to @muxer or any of its ancestors */
+static guint64
+gtk_action_muxer_get_changed_serial (GtkActionMuxer *muxer)
+{
+  guint64 serial = 0;
+
+  for ( ; muxer != NULL; muxer = muxer->parent)
+    serial = MAX (serial, muxer->changed_serial);
+
+  return serial;
+}
+
+static void
+gtk_action_muxer_free_resolution (gpointer data)
+{
+  g_slice_free (Resolution, data);
+}
+
+/*< private >
+ * gtk_action_muxer_resolve:
+ * @muxer: a #GtkActionMuxer
+ * @action_name: the full name of an action
+ *
+ * Finds the muxer that provides @action_name, looking at @muxer
+ * and its ancestors, along with the widget action or group that
+ * has it. If no muxer provides the action, the muxer of the
+ * returned resolution is %NULL.
+ *
+ * Menus query the same actions over and over, so results are
+ * cached per muxer. Every change that can affect a result (groups
+ * or their actions coming and going, or a muxer getting a new parent)
+ * stamps the changed muxer with a new serial. Muxers don't know their
+ * children, so a cache is checked against the stamps of its muxer and
+ * the muxer's ancestors when it is next used, and dropped if any of
+ * them changed after it was built. Changes only drop the caches below
+ * the muxer that changed.
+ *
+ * The returned resolution is only valid until the next change.
+ */
+static const Resolution *
+gtk_action_muxer_resolve (GtkActionMuxer *muxer,
+                          const char     *action_name)
+{
+  Resolution *resolution;
+
+  if (muxer->resolutions == NULL)
+    muxer->resolutions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, gtk_action_muxer_free_resolution);
+  else if (muxer->resolutions_serial < gtk_action_muxer_get_changed_serial (muxer))
+    g_hash_table_remove_all (muxer->resolutions);
+
+  muxer->resolutions_serial = resolutions_serial;
+
+  resolution = g_hash_table_lookup (muxer->resolutions, action_name);
+  if (resolution)
+    return resolution;
+
+  resolution = g_slice_new0 (Resolution);
+
+  resolution->widget_action = gtk_action_muxer_find_widget_action (muxer, action_name);
+  if (resolution->widget_action == NULL)
+    resolution->group = gtk_action_muxer_find_group (muxer, action_name, NULL);
+
+  if (resolution->widget_action || resolution->group)
+    resolution->muxer = muxer;
+  else if (muxer->parent)
+    *resolution = *gtk_action_muxer_resolve (muxer->parent, action_name);
+
+  g_hash_table_insert (muxer->resolutions, g_strdup (action_name), resolution);
+
+  return resolution;
+}
+
+static inline const char *
+get_unprefixed_name (const char *action_name)
+{
+  return strchr (action_name, '.') + 1;
+}
+
 static inline Action *
 find_observers (GtkActionMuxer *muxer,
                 const char     *action_name)
@@ -326,26 +442,14 @@ gtk_action_muxer_action_enabled_changed (GtkActionMuxer *muxer,
                                          const char     *action_name,
                                          gboolean        enabled)
 {
-  GtkWidgetAction *iter;
+  GtkWidgetAction *widget_action;
   Action *action;
   GSList *node;
 
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
-
-      for (iter = priv->actions; iter; iter = iter->next)
-        {
-          if (strcmp (action_name, iter->name) == 0)
-            {
-              guint position = get_action_position (iter);
-              muxer->widget_actions_disabled =
-                _gtk_bitmask_set (muxer->widget_actions_disabled, position, !enabled);
-              break;
-            }
-        }
-    }
+  widget_action = gtk_action_muxer_find_widget_action (muxer, action_name);
+  if (widget_action)
+    muxer->widget_actions_disabled =
+      _gtk_bitmask_set (muxer->widget_actions_disabled, get_action_position (widget_action), !enabled);
 
   action = find_observers (muxer, action_name);
 
@@ -403,80 +507,6 @@ static gboolean action_muxer_query_action (GtkActionMuxer      *muxer,
                                            GVariant           **state,
                                            gboolean             recurse);
 
-static void
-notify_observers_added (GtkActionMuxer *muxer,
-                        GtkActionMuxer *parent)
-{
-  GHashTableIter iter;
-  const char *action_name;
-  Action *action;
-
-  if (!muxer->observed_actions)
-    return;
-
-  g_hash_table_iter_init (&iter, muxer->observed_actions);
-  while (g_hash_table_iter_next (&iter, (gpointer *)&action_name, (gpointer *)&action))
-    {
-      const GVariantType *parameter_type;
-      gboolean enabled;
-      GVariant *state;
-      GSList *node;
-
-      if (!action->watchers)
-        continue;
-
-      if (action_muxer_query_action (muxer, action_name,
-                                     NULL, NULL, NULL, NULL, NULL,
-                                     FALSE))
-        continue;
-
-      gtk_action_observable_register_observer (GTK_ACTION_OBSERVABLE (parent), action_name, GTK_ACTION_OBSERVER (muxer));
-
-      if (!action_muxer_query_action (parent, action_name,
-                                      &enabled, &parameter_type,
-                                      NULL, NULL, &state,
-                                      TRUE))
-        continue;
-
-      for (node = action->watchers; node; node = node->next)
-        {
-          gtk_action_observer_action_added (node->data,
-                                            GTK_ACTION_OBSERVABLE (muxer),
-                                            action_name, parameter_type, enabled, state);
-        }
-
-      if (state)
-        g_variant_unref (state);
-    }
-}
-
-static void
-notify_observers_removed (GtkActionMuxer *muxer,
-                          GtkActionMuxer *parent)
-{
-  GHashTableIter iter;
-  const char *action_name;
-  Action *action;
-
-  if (!muxer->observed_actions)
-    return;
-
-  g_hash_table_iter_init (&iter, muxer->observed_actions);
-  while (g_hash_table_iter_next (&iter, (gpointer *)&action_name, (gpointer *)&action))
-    {
-      GSList *node;
-
-      gtk_action_observable_unregister_observer (GTK_ACTION_OBSERVABLE (parent), action_name, GTK_ACTION_OBSERVER (muxer));
-
-      for (node = action->watchers; node; node = node->next)
-        {
-          gtk_action_observer_action_removed (node->data,
-                                              GTK_ACTION_OBSERVABLE (muxer),
-                                              action_name);
-        }
-    }
-}
-
 static void
 gtk_action_muxer_action_added (GtkActionMuxer     *muxer,
                                const char         *action_name,
@@ -507,6 +537,8 @@ gtk_action_muxer_action_added_to_group (GActionGroup *action_group,
   GVariant *state;
   char *fullname;
 
+  gtk_action_muxer_invalidate_resolutions (muxer);
+
   fullname = g_strconcat (group->prefix, ".", action_name, NULL);
 
    if (muxer->parent)
@@ -541,6 +573,151 @@ gtk_action_muxer_action_removed (GtkActionMuxer *muxer,
     gtk_action_observer_action_removed (node->data, GTK_ACTION_OBSERVABLE (muxer), action_name);
 }
 
+typedef struct
+{
+  char               *name;
+  gboolean            found;
+  gboolean            enabled;
+  GVariantType       *parameter_type;
+  GVariant           *state;
+} ObservedState;
+
+static void
+observed_state_clear (gpointer data)
+{
+  ObservedState *observed = data;
+
+  g_free (observed->name);
+  g_clear_pointer (&observed->parameter_type, g_variant_type_free);
+  g_clear_pointer (&observed->state, g_variant_unref);
+}
+
+static gboolean
+variant_type_equal (const GVariantType *a,
+                    const GVariantType *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return g_variant_type_equal (a, b);
+}
+
+/* Stops observing the actions that @muxer gets from its
+ * parent, and records what they look like before the parent
+ * changes.
+ */
+static GArray *
+observers_detach (GtkActionMuxer *muxer)
+{
+  GHashTableIter iter;
+  const char *action_name;
+  Action *action;
+  GArray *observed;
+
+  if (!muxer->observed_actions)
+    return NULL;
+
+  observed = g_array_new (FALSE, TRUE, sizeof (ObservedState));
+  g_array_set_clear_func (observed, observed_state_clear);
+
+  g_hash_table_iter_init (&iter, muxer->observed_actions);
+  while (g_hash_table_iter_next (&iter, (gpointer *)&action_name, (gpointer *)&action))
+    {
+      ObservedState *state;
+      const GVariantType *parameter_type;
+
+      if (muxer->parent)
+        gtk_action_observable_unregister_observer (GTK_ACTION_OBSERVABLE (muxer->parent), action_name, GTK_ACTION_OBSERVER (muxer));
+
+      if (!action->watchers ||
+          action_muxer_query_action (muxer, action_name,
+                                     NULL, NULL, NULL, NULL, NULL,
+                                     FALSE))
+        continue;
+
+      g_array_set_size (observed, observed->len + 1);
+      state = &g_array_index (observed, ObservedState, observed->len - 1);
+      state->name = g_strdup (action_name);
+
+      if (muxer->parent &&
+          action_muxer_query_action (muxer->parent, action_name,
+                                     &state->enabled, &parameter_type,
+                                     NULL, NULL, &state->state,
+                                     TRUE))
+        {
+          state->found = TRUE;
+          state->parameter_type = parameter_type ? g_variant_type_copy (parameter_type) : NULL;
+        }
+    }
+
+  return observed;
+}
+
+/* Starts observing the recorded actions on the new parent,
+ * and only tells the watchers about what actually changed.
+ * Moving a widget within a hierarchy usually resolves its
+ * actions to the same thing as before, and then nobody gets
+ * notified.
+ */
+static void
+observers_attach (GtkActionMuxer *muxer,
+                  GArray         *observed)
+{
+  guint i;
+
+  for (i = 0; i < observed->len; i++)
+    {
+      ObservedState *old = &g_array_index (observed, ObservedState, i);
+      const GVariantType *parameter_type = NULL;
+      gboolean found, enabled = FALSE;
+      GVariant *state = NULL;
+      Action *action;
+
+      /* Earlier notifications may have dropped watchers */
+      action = find_observers (muxer, old->name);
+      if (action == NULL || action->watchers == NULL)
+        continue;
+
+      found = FALSE;
+      if (muxer->parent)
+        {
+          gtk_action_observable_register_observer (GTK_ACTION_OBSERVABLE (muxer->parent), old->name, GTK_ACTION_OBSERVER (muxer));
+          found = action_muxer_query_action (muxer->parent, old->name,
+                                             &enabled, &parameter_type,
+                                             NULL, NULL, &state,
+                                             TRUE);
+        }
+
+      if (!found)
+        {
+          if (old->found)
+            gtk_action_muxer_action_removed (muxer, old->name);
+          continue;
+        }
+
+      if (!old->found)
+        {
+          gtk_action_muxer_action_added (muxer, old->name, parameter_type, enabled, state);
+        }
+      else if (!variant_type_equal (old->parameter_type, parameter_type) ||
+               !variant_type_equal (old->state ? g_variant_get_type (old->state) : NULL,
+                                    state ? g_variant_get_type (state) : NULL))
+        {
+          gtk_action_muxer_action_removed (muxer, old->name);
+          gtk_action_muxer_action_added (muxer, old->name, parameter_type, enabled, state);
+        }
+      else
+        {
+          if (old->enabled != enabled)
+            gtk_action_muxer_action_enabled_changed (muxer, old->name, enabled);
+          if (state && !g_variant_equal (old->state, state))
+            gtk_action_muxer_action_state_changed (muxer, old->name, state);
+        }
+
+      g_clear_pointer (&state, g_variant_unref);
+    }
+}
+
 static void
 gtk_action_muxer_action_removed_from_group (GActionGroup *action_group,
                                             const char   *action_name,
@@ -551,6 +728,8 @@ gtk_action_muxer_action_removed_from_group (GActionGroup *action_group,
   char *fullname;
   Action *action;
 
+  gtk_action_muxer_invalidate_resolutions (muxer);
+
   fullname = g_strconcat (group->prefix, ".", action_name, NULL);
   gtk_action_muxer_action_removed (muxer, fullname);
   g_free (fullname);
@@ -727,60 +906,43 @@ action_muxer_query_action (GtkActionMuxer      *muxer,
                            GVariant           **state,
                            gboolean             recurse)
 {
+  const Resolution *resolution;
+  GtkActionMuxer *owner;
   GtkWidgetAction *action;
-  Group *group;
-  const char *unprefixed_name;
 
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
+  resolution = gtk_action_muxer_resolve (muxer, action_name);
+  owner = resolution->muxer;
 
-      for (action = priv->actions; action; action = action->next)
-        {
-          guint position;
-
-          if (strcmp (action->name, action_name) != 0)
-            continue;
-
-          position = get_action_position (action);
-
-          if (enabled)
-            *enabled = !_gtk_bitmask_get (muxer->widget_actions_disabled, position);
-          if (parameter_type)
-            *parameter_type = action->parameter_type;
-          if (state_type)
-            *state_type = action->state_type;
-
-          if (state_hint)
-            *state_hint = NULL;
-          if (state)
-            *state = NULL;
-
-          if (action->pspec)
-            {
-              if (state)
-                *state = prop_action_get_state (muxer->widget, action);
-              if (state_hint)
-                *state_hint = prop_action_get_state_hint (muxer->widget, action);
-            }
-
-          return TRUE;
-        }
-    }
+  if (owner == NULL || (owner != muxer && !recurse))
+    return FALSE;
 
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  if (resolution->group)
+    return g_action_group_query_action (resolution->group->group, get_unprefixed_name (action_name),
+                                        enabled, parameter_type, state_type, state_hint, state);
 
-  if (group)
-    return g_action_group_query_action (group->group, unprefixed_name, enabled,
-                                        parameter_type, state_type, state_hint, state);
+  action = resolution->widget_action;
+
+  if (enabled)
+    *enabled = !_gtk_bitmask_get (owner->widget_actions_disabled, get_action_position (action));
+  if (parameter_type)
+    *parameter_type = action->parameter_type;
+  if (state_type)
+    *state_type = action->state_type;
 
-  if (muxer->parent && recurse)
-    return gtk_action_muxer_query_action (muxer->parent, action_name,
-                                          enabled, parameter_type,
-                                          state_type, state_hint, state);
+  if (state_hint)
+    *state_hint = NULL;
+  if (state)
+    *state = NULL;
 
-  return FALSE;
+  if (action->pspec)
+    {
+      if (state)
+        *state = prop_action_get_state (owner->widget, action);
+      if (state_hint)
+        *state_hint = prop_action_get_state_hint (owner->widget, action);
+    }
+
+  return TRUE;
 }
 
 gboolean
@@ -812,40 +974,28 @@ gtk_action_muxer_activate_action (GtkActionMuxer *muxer,
                                   const char     *action_name,
                                   GVariant       *parameter)
 {
-  const char *unprefixed_name;
-  Group *group;
-
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
-      GtkWidgetAction *action;
+  const Resolution *resolution;
+  GtkActionMuxer *owner;
+  GtkWidgetAction *action;
 
-      for (action = priv->actions; action; action = action->next)
-        {
-          if (strcmp (action->name, action_name) == 0)
-            {
-              guint position = get_action_position (action);
-
-              if (!_gtk_bitmask_get (muxer->widget_actions_disabled, position))
-                {
-                  if (action->activate)
-                    action->activate (muxer->widget, action->name, parameter);
-                  else if (action->pspec)
-                    prop_action_activate (muxer->widget, action, parameter);
-                }
-
-              return;
-            }
-        }
-    }
+  resolution = gtk_action_muxer_resolve (muxer, action_name);
+  owner = resolution->muxer;
+  action = resolution->widget_action;
 
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  if (owner == NULL)
+    return;
 
-  if (group)
-    g_action_group_activate_action (group->group, unprefixed_name, parameter);
-  else if (muxer->parent)
-    gtk_action_muxer_activate_action (muxer->parent, action_name, parameter);
+  if (resolution->group)
+    {
+      g_action_group_activate_action (resolution->group->group, get_unprefixed_name (action_name), parameter);
+    }
+  else if (!_gtk_bitmask_get (owner->widget_actions_disabled, get_action_position (action)))
+    {
+      if (action->activate)
+        action->activate (owner->widget, action->name, parameter);
+      else if (action->pspec)
+        prop_action_activate (owner->widget, action, parameter);
+    }
 }
 
 void
@@ -853,33 +1003,21 @@ gtk_action_muxer_change_action_state (GtkActionMuxer *muxer,
                                       const char     *action_name,
                                       GVariant       *state)
 {
+  const Resolution *resolution;
+  GtkActionMuxer *owner;
   GtkWidgetAction *action;
-  const char *unprefixed_name;
-  Group *group;
 
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
-
-      for (action = priv->actions; action; action = action->next)
-        {
-          if (strcmp (action->name, action_name) == 0)
-            {
-              if (action->pspec)
-                prop_action_set_state (muxer->widget, action, state);
+  resolution = gtk_action_muxer_resolve (muxer, action_name);
+  owner = resolution->muxer;
+  action = resolution->widget_action;
 
-              return;
-            }
-        }
-    }
-
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  if (owner == NULL)
+    return;
 
-  if (group)
-    g_action_group_change_action_state (group->group, unprefixed_name, state);
-  else if (muxer->parent)
-    gtk_action_muxer_change_action_state (muxer->parent, action_name, state);
+  if (resolution->group)
+    g_action_group_change_action_state (resolution->group->group, get_unprefixed_name (action_name), state);
+  else if (action->pspec)
+    prop_action_set_state (owner->widget, action, state);
 }
 
 static void
@@ -1029,6 +1167,8 @@ gtk_action_muxer_finalize (GObject *object)
     }
   if (muxer->groups)
     g_hash_table_unref (muxer->groups);
+  if (muxer->resolutions)
+    g_hash_table_unref (muxer->resolutions);
 
   gtk_accels_clear (&muxer->primary_accels);
 
@@ -1047,6 +1187,7 @@ gtk_action_muxer_dispose (GObject *object)
     g_hash_table_remove_all (muxer->observed_actions);
 
   muxer->widget = NULL;
+  gtk_action_muxer_invalidate_resolutions (muxer);
 
   G_OBJECT_CLASS (gtk_action_muxer_parent_class)->dispose (object);
 }
@@ -1244,6 +1385,7 @@ gtk_action_muxer_insert (GtkActionMuxer *muxer,
   group->prefix = g_strdup (prefix);
 
   g_hash_table_insert (muxer->groups, group->prefix, group);
+  gtk_action_muxer_invalidate_resolutions (muxer);
 
   actions = g_action_group_list_actions (group->group);
   for (i = 0; actions[i]; i++)
@@ -1287,6 +1429,7 @@ gtk_action_muxer_remove (GtkActionMuxer *muxer,
       int i;
 
       g_hash_table_steal (muxer->groups, prefix);
+      gtk_action_muxer_invalidate_resolutions (muxer);
 
       actions = g_action_group_list_actions (group->group);
       for (i = 0; actions[i]; i++)
@@ -1336,24 +1479,24 @@ void
 gtk_action_muxer_set_parent (GtkActionMuxer *muxer,
                              GtkActionMuxer *parent)
 {
+  GArray *observed;
+
   g_return_if_fail (GTK_IS_ACTION_MUXER (muxer));
   g_return_if_fail (parent == NULL || GTK_IS_ACTION_MUXER (parent));
 
   if (muxer->parent == parent)
     return;
 
-  if (muxer->parent != NULL)
-    {
-      notify_observers_removed (muxer, muxer->parent);
-      g_object_unref (muxer->parent);
-    }
+  observed = observers_detach (muxer);
 
-  muxer->parent = parent;
+  g_clear_object (&muxer->parent);
+  muxer->parent = parent ? g_object_ref (parent) : NULL;
+  gtk_action_muxer_invalidate_resolutions (muxer);
 
-  if (muxer->parent != NULL)
+  if (observed)
     {
-      g_object_ref (muxer->parent);
-      notify_observers_added (muxer, muxer->parent);
+      observers_attach (muxer, observed);
+      g_array_unref (observed);
     }
 
   g_object_notify_by_pspec (G_OBJECT (muxer), properties[PROP_PARENT]);
@@ -60,11 +60,18 @@ static GParamSpec *obj_props[N_PROPS];
 
 static guint obj_signals[LAST_SIGNAL];
 
+/* Contexts with changes that the AT has not been told about yet */
+static GQueue queued_updates = G_QUEUE_INIT;
+static guint queued_updates_id;
+
 static void
 gtk_at_context_finalize (GObject *gobject)
 {
   GtkATContext *self = GTK_AT_CONTEXT (gobject);
 
+  if (self->update_link.data != NULL)
+    g_queue_unlink (&queued_updates, &self->update_link);
+
   gtk_accessible_attribute_set_unref (self->properties);
   gtk_accessible_attribute_set_unref (self->relations);
   gtk_accessible_attribute_set_unref (self->states);
@@ -437,6 +444,62 @@ gtk_at_context_update (GtkATContext *self)
                  self->states, self->properties, self->relations);
 }
 
+static gboolean
+flush_queued_updates (gpointer data)
+{
+  queued_updates_id = 0;
+
+  gtk_at_context_flush_updates ();
+
+  return G_SOURCE_REMOVE;
+}
+
+/*< private >
+ * gtk_at_context_queue_update:
+ * @self: a #GtkATContext
+ *
+ * Like gtk_at_context_update(), but only notifies the AT once per
+ * frame, no matter how often the accessible changes until then.
+ */
+void
+gtk_at_context_queue_update (GtkATContext *self)
+{
+  g_return_if_fail (GTK_IS_AT_CONTEXT (self));
+
+  if (self->update_link.data != NULL)
+    return;
+
+  self->update_link.data = self;
+  g_queue_push_tail_link (&queued_updates, &self->update_link);
+
+  if (queued_updates_id == 0)
+    {
+      queued_updates_id = g_idle_add_full (GDK_PRIORITY_REDRAW + 10,
+                                           flush_queued_updates,
+                                           NULL, NULL);
+      g_source_set_name_by_id (queued_updates_id, "[gtk] flush_queued_updates");
+    }
+}
+
+/*< private >
+ * gtk_at_context_flush_updates:
+ *
+ * Notifies the AT about all queued changes right away.
+ */
+void
+gtk_at_context_flush_updates (void)
+{
+  GList *link;
+
+  while ((link = g_queue_pop_head_link (&queued_updates)) != NULL)
+    {
+      GtkATContext *context = link->data;
+
+      link->data = NULL;
+      gtk_at_context_update (context);
+    }
+}
+
 /*< private >
  * gtk_at_context_set_accessible_state:
  * @self: a #GtkATContext
@@ -90,6 +90,9 @@ struct _GtkATContext
   GtkAccessibleAttributeSet *states;
   GtkAccessibleAttributeSet *properties;
   GtkAccessibleAttributeSet *relations;
+
+  /* link in the queue of contexts waiting for an update */
+  GList update_link;
 };
 
 struct _GtkATContextClass
@@ -106,6 +109,8 @@ struct _GtkATContextClass
 };
 
 void                    gtk_at_context_update                   (GtkATContext          *self);
+void                    gtk_at_context_queue_update             (GtkATContext          *self);
+void                    gtk_at_context_flush_updates            (void);
 
 void                    gtk_at_context_set_accessible_state     (GtkATContext          *self,
                                                                  GtkAccessibleState     state,
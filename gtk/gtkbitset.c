@@ -635,6 +635,20 @@ gtk_bitset_difference (GtkBitset       *self,
   roaring_bitmap_xor_inplace (&self->roaring, &other->roaring);
 }
 
+static void
+gtk_bitset_add_offset (GtkBitset *self,
+                       gint64     offset)
+{
+  roaring_bitmap_t *shifted;
+
+  /* This moves whole containers, so it does not depend on the number
+   * of values in the set. */
+  shifted = roaring_bitmap_add_offset (&self->roaring, offset);
+  ra_clear (&self->roaring.high_low_container);
+  self->roaring = *shifted;
+  free (shifted);
+}
+
 /**
  * gtk_bitset_shift_left:
  * @self: a $GtkBitset
@@ -647,27 +661,12 @@ void
 gtk_bitset_shift_left (GtkBitset *self,
                        guint      amount)
 {
-  GtkBitset *original;
-  GtkBitsetIter iter;
-  guint value;
-  gboolean loop;
-
   g_return_if_fail (self != NULL);
 
   if (amount == 0)
     return;
 
-  original = gtk_bitset_copy (self);
-  gtk_bitset_remove_all (self);
-
-  for (loop = gtk_bitset_iter_init_at (&iter, original, amount, &value);
-       loop;
-       loop = gtk_bitset_iter_next (&iter, &value))
-    {
-      gtk_bitset_add (self, value - amount);
-    }
-
-  gtk_bitset_unref (original);
+  gtk_bitset_add_offset (self, - (gint64) amount);
 }
 
 /**
@@ -682,27 +681,12 @@ void
 gtk_bitset_shift_right (GtkBitset *self,
                         guint      amount)
 {
-  GtkBitset *original;
-  GtkBitsetIter iter;
-  guint value;
-  gboolean loop;
-
   g_return_if_fail (self != NULL);
 
   if (amount == 0)
     return;
 
-  original = gtk_bitset_copy (self);
-  gtk_bitset_remove_all (self);
-
-  for (loop = gtk_bitset_iter_init_first (&iter, original, &value);
-       loop && value <= G_MAXUINT - amount;
-       loop = gtk_bitset_iter_next (&iter, &value))
-    {
-      gtk_bitset_add (self, value + amount);
-    }
-
-  gtk_bitset_unref (original);
+  gtk_bitset_add_offset (self, amount);
 }
 
 /**
@@ -738,16 +722,18 @@ gtk_bitset_splice (GtkBitset *self,
 
   if (removed != added)
     {
-      GtkBitset *shift = gtk_bitset_copy (self);
-
-      gtk_bitset_remove_range (shift, 0, position);
-      gtk_bitset_remove_range_closed (self, position, G_MAXUINT);
-      if (added > removed)
-        gtk_bitset_shift_right (shift, added - removed);
-      else
-        gtk_bitset_shift_left (shift, removed - added);
-      gtk_bitset_union (self, shift);
-      gtk_bitset_unref (shift);
+      roaring_bitmap_t *shift;
+
+      if (gtk_bitset_is_empty (self) ||
+          gtk_bitset_get_maximum (self) < position)
+        return;
+
+      shift = roaring_bitmap_add_offset (&self->roaring, (gint64) added - removed);
+      roaring_bitmap_remove_range_closed (&self->roaring, position, G_MAXUINT);
+      if (position + added > 0)
+        roaring_bitmap_remove_range_closed (shift, 0, position + added - 1);
+      roaring_bitmap_or_inplace (&self->roaring, shift);
+      roaring_bitmap_free (shift);
     }
 }
 
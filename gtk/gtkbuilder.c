@@ -267,6 +267,7 @@ typedef struct
   GType template_type;
   GObject *current_object;
   GtkBuilderScope *scope;
+  GtkBuilderPlan *plan;
 } GtkBuilderPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GtkBuilder, gtk_builder, G_TYPE_OBJECT)
@@ -596,10 +597,10 @@ gtk_builder_get_parameters (GtkBuilder         *builder,
               continue;
             }
         }
-      else if (!gtk_builder_value_from_string (builder, prop->pspec,
-                                               prop->text->str,
-                                               &property_value,
-                                               &error))
+      else if (!gtk_builder_plan_value_from_string (priv->plan, builder, prop->pspec,
+                                                    prop->text->str,
+                                                    &property_value,
+                                                    &error))
         {
           g_warning ("Failed to set property %s.%s to %s: %s",
                      g_type_name (object_type), prop->pspec->name, prop->text->str,
@@ -1358,6 +1359,53 @@ gtk_builder_extend_with_template (GtkBuilder   *builder,
   return TRUE;
 }
 
+/*
+ * gtk_builder_extend_with_plan:
+ * @builder: a #GtkBuilder
+ * @object: the object that is being extended
+ * @template_type: the type that the template is for
+ * @plan: the plan to instantiate
+ * @error: (allow-none): return location for an error, or %NULL
+ *
+ * Like gtk_builder_extend_with_template(), but builds the data of
+ * @plan, reusing the lookups of earlier instantiations. This is what
+ * widget templates and list item factories use.
+ *
+ * Returns: %TRUE on success, %FALSE if an error occurred
+ */
+gboolean
+gtk_builder_extend_with_plan (GtkBuilder      *builder,
+                              GObject         *object,
+                              GType            template_type,
+                              GtkBuilderPlan  *plan,
+                              GError         **error)
+{
+  GtkBuilderPrivate *priv = gtk_builder_get_instance_private (builder);
+  GBytes *data;
+  gboolean result;
+
+  g_return_val_if_fail (priv->plan == NULL, FALSE);
+
+  data = gtk_builder_plan_get_data (plan);
+
+  priv->plan = gtk_builder_plan_ref (plan);
+  result = gtk_builder_extend_with_template (builder, object, template_type,
+                                             g_bytes_get_data (data, NULL),
+                                             g_bytes_get_size (data),
+                                             error);
+  g_clear_pointer (&priv->plan, gtk_builder_plan_unref);
+
+  return result;
+}
+
+GtkBuilderPlan *
+_gtk_builder_get_plan (GtkBuilder *builder)
+{
+  GtkBuilderPrivate *priv = gtk_builder_get_instance_private (builder);
+
+  return priv->plan;
+}
+
 /**
  * gtk_builder_add_from_resource:
  * @builder: a #GtkBuilder
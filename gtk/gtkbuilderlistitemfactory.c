@@ -63,6 +63,7 @@ struct _GtkBuilderListItemFactory
   GtkBuilderScope *scope;
   GBytes *bytes;
   GBytes *data;
+  GtkBuilderPlan *plan;
   char *resource;
 };
 
@@ -101,10 +102,14 @@ gtk_builder_list_item_factory_setup (GtkListItemFactory *factory,
   if (self->scope)
     gtk_builder_set_scope (builder, self->scope);
 
-  if (!gtk_builder_extend_with_template (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
-                                         (const char *)g_bytes_get_data (self->data, NULL),
-                                         g_bytes_get_size (self->data),
-                                         &error))
+  if (self->plan
+      ? !gtk_builder_extend_with_plan (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
+                                      self->plan,
+                                      &error)
+      : !gtk_builder_extend_with_template (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
+                                           (const char *)g_bytes_get_data (self->data, NULL),
+                                           g_bytes_get_size (self->data),
+                                           &error))
     {
       g_critical ("Error building template for list item: %s", error->message);
       g_error_free (error);
@@ -181,6 +186,12 @@ gtk_builder_list_item_factory_set_bytes (GtkBuilderListItemFactory *self,
           self->data = data;
         }
     }
+  else
+    {
+      self->data = g_bytes_ref (bytes);
+    }
+
+  self->plan = gtk_builder_plan_new (self->data);
 
   return TRUE;
 }
@@ -242,6 +253,7 @@ gtk_builder_list_item_factory_finalize (GObject *object)
   g_clear_object (&self->scope);
   g_bytes_unref (self->bytes);
   g_bytes_unref (self->data);
+  g_clear_pointer (&self->plan, gtk_builder_plan_unref);
   g_free (self->resource);
 
   G_OBJECT_CLASS (gtk_builder_list_item_factory_parent_class)->finalize (object);
@@ -597,7 +597,7 @@ parse_object (GtkBuildableParseContext  *context,
       /* Call the GType function, and return the GType, it's guaranteed afterwards
        * that g_type_from_name on the name will return our GType
        */
-      object_type = gtk_builder_scope_get_type_from_function (gtk_builder_get_scope (data->builder), data->builder, type_func);
+      object_type = gtk_builder_plan_get_type_from_function (data->plan, data->builder, type_func);
       if (object_type == G_TYPE_INVALID)
         {
           g_set_error (error,
@@ -612,7 +612,7 @@ parse_object (GtkBuildableParseContext  *context,
     {
       g_assert_nonnull (object_class);
 
-      object_type = gtk_builder_get_type_from_name (data->builder, object_class);
+      object_type = gtk_builder_plan_get_type_from_name (data->plan, data->builder, object_class);
       if (object_type == G_TYPE_INVALID)
         {
           g_set_error (error,
@@ -885,7 +885,7 @@ parse_property (ParserData   *data,
       return;
     }
 
-  pspec = g_object_class_find_property (object_info->oclass, name);
+  pspec = gtk_builder_plan_find_property (data->plan, object_info->oclass, name);
 
   if (!pspec)
     {
@@ -977,7 +977,7 @@ parse_binding (ParserData   *data,
       return;
     }
 
-  pspec = g_object_class_find_property (object_info->oclass, name);
+  pspec = gtk_builder_plan_find_property (data->plan, object_info->oclass, name);
 
   if (!pspec)
     {
@@ -1482,7 +1482,7 @@ parse_signal (ParserData   *data,
       return;
     }
 
-  if (!g_signal_parse_name (name, object_info->type, &id, &detail, FALSE))
+  if (!gtk_builder_plan_parse_signal_name (data->plan, name, object_info->type, &id, &detail))
     {
       g_set_error (error,
                    GTK_BUILDER_ERROR,
@@ -2184,6 +2184,11 @@ _gtk_builder_parser_parse_buffer (GtkBuilder   *builder,
   data.object_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
                                            (GDestroyNotify)g_free, NULL);
 
+  /* The plan's caches are keyed on the strings of its own data */
+  data.plan = _gtk_builder_get_plan (builder);
+  if (data.plan && buffer != g_bytes_get_data (gtk_builder_plan_get_data (data.plan), NULL))
+    data.plan = NULL;
+
   if (requested_objs)
     {
       data.inside_requested_object = FALSE;
@@ -0,0 +1,367 @@
+/* gtkbuilderplan.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkbuilderprivate.h"
+
+#include "gtkbuilderscopeprivate.h"
+#include "gsk/gsk.h"
+
+#include <string.h>
+
+/* Instantiation plans
+ *
+ * Templates are instantiated many times from the same precompiled
+ * data, and each time the parser resolves the same type names, looks
+ * up the same property and signal names, and converts the same
+ * property values from strings. A plan remembers the results of
+ * these lookups, so they are only done for the first instance.
+ *
+ * The strings handed to the parser when replaying precompiled data
+ * point into the string table of that data, and identical strings
+ * are stored only once. So as long as the plan keeps the data alive,
+ * we can key the caches on string pointers instead of hashing the
+ * strings. This is why a plan only applies to its own data.
+ *
+ * Type lookups depend on the builder scope, so a plan must only be
+ * used with builders that have the same scope, which is the case
+ * for widget templates and list item factories.
+ */
+
+struct _GtkBuilderPlan
+{
+  GBytes *data;
+
+  GHashTable *types;          /* class name -> GType */
+  GHashTable *type_functions; /* type function name -> GType */
+  GHashTable *properties;     /* PlanKey -> GParamSpec */
+  GHashTable *signals;        /* PlanKey -> PlanSignal */
+  GHashTable *values;         /* PlanValueKey -> GValue */
+};
+
+typedef struct {
+  GType type;
+  const char *name;
+} PlanKey;
+
+typedef struct {
+  guint id;
+  GQuark detail;
+} PlanSignal;
+
+typedef struct {
+  GParamSpec *pspec;
+  char *string;
+} PlanValueKey;
+
+static guint
+plan_key_hash (gconstpointer data)
+{
+  const PlanKey *key = data;
+
+  return g_direct_hash (key->name) ^ (guint) key->type;
+}
+
+static gboolean
+plan_key_equal (gconstpointer a,
+                gconstpointer b)
+{
+  const PlanKey *ka = a;
+  const PlanKey *kb = b;
+
+  return ka->type == kb->type && ka->name == kb->name;
+}
+
+static guint
+plan_value_key_hash (gconstpointer data)
+{
+  const PlanValueKey *key = data;
+
+  return g_direct_hash (key->pspec) ^ g_str_hash (key->string);
+}
+
+static gboolean
+plan_value_key_equal (gconstpointer a,
+                      gconstpointer b)
+{
+  const PlanValueKey *ka = a;
+  const PlanValueKey *kb = b;
+
+  return ka->pspec == kb->pspec && strcmp (ka->string, kb->string) == 0;
+}
+
+static void
+plan_value_key_free (gpointer data)
+{
+  PlanValueKey *key = data;
+
+  g_free (key->string);
+  g_free (key);
+}
+
+static void
+plan_value_free (gpointer data)
+{
+  GValue *value = data;
+
+  g_value_unset (value);
+  g_free (value);
+}
+
+/*
+ * gtk_builder_plan_new:
+ * @data: precompiled builder data
+ *
+ * Creates a new, empty plan for instantiating @data.
+ *
+ * Returns: (nullable): a new plan, or %NULL if @data is
+ *   not precompiled
+ */
+GtkBuilderPlan *
+gtk_builder_plan_new (GBytes *data)
+{
+  GtkBuilderPlan *self;
+
+  if (!_gtk_buildable_parser_is_precompiled (g_bytes_get_data (data, NULL),
+                                             g_bytes_get_size (data)))
+    return NULL;
+
+  self = g_rc_box_new0 (GtkBuilderPlan);
+  self->data = g_bytes_ref (data);
+  self->types = g_hash_table_new (NULL, NULL);
+  self->type_functions = g_hash_table_new (NULL, NULL);
+  self->properties = g_hash_table_new_full (plan_key_hash, plan_key_equal, g_free, NULL);
+  self->signals = g_hash_table_new_full (plan_key_hash, plan_key_equal, g_free, g_free);
+  self->values = g_hash_table_new_full (plan_value_key_hash, plan_value_key_equal,
+                                        plan_value_key_free, plan_value_free);
+
+  return self;
+}
+
+GtkBuilderPlan *
+gtk_builder_plan_ref (GtkBuilderPlan *self)
+{
+  return g_rc_box_acquire (self);
+}
+
+static void
+gtk_builder_plan_clear (gpointer data)
+{
+  GtkBuilderPlan *self = data;
+
+  g_hash_table_unref (self->values);
+  g_hash_table_unref (self->signals);
+  g_hash_table_unref (self->properties);
+  g_hash_table_unref (self->type_functions);
+  g_hash_table_unref (self->types);
+  g_bytes_unref (self->data);
+}
+
+void
+gtk_builder_plan_unref (GtkBuilderPlan *self)
+{
+  g_rc_box_release_full (self, gtk_builder_plan_clear);
+}
+
+GBytes *
+gtk_builder_plan_get_data (GtkBuilderPlan *self)
+{
+  return self->data;
+}
+
+/*
+ * gtk_builder_plan_get_type_from_name:
+ * @self: (nullable): a plan
+ *
+ * Like gtk_builder_get_type_from_name(), but remembers the result.
+ * Failed lookups are not remembered, they are errors anyway.
+ */
+GType
+gtk_builder_plan_get_type_from_name (GtkBuilderPlan *self,
+                                     GtkBuilder     *builder,
+                                     const char     *type_name)
+{
+  GType type;
+
+  if (self == NULL)
+    return gtk_builder_get_type_from_name (builder, type_name);
+
+  type = GPOINTER_TO_SIZE (g_hash_table_lookup (self->types, type_name));
+  if (type != G_TYPE_INVALID)
+    return type;
+
+  type = gtk_builder_get_type_from_name (builder, type_name);
+  if (type != G_TYPE_INVALID)
+    g_hash_table_insert (self->types, (gpointer) type_name, GSIZE_TO_POINTER (type));
+
+  return type;
+}
+
+GType
+gtk_builder_plan_get_type_from_function (GtkBuilderPlan *self,
+                                         GtkBuilder     *builder,
+                                         const char     *function_name)
+{
+  GType type;
+
+  if (self == NULL)
+    return gtk_builder_scope_get_type_from_function (gtk_builder_get_scope (builder), builder, function_name);
+
+  type = GPOINTER_TO_SIZE (g_hash_table_lookup (self->type_functions, function_name));
+  if (type != G_TYPE_INVALID)
+    return type;
+
+  type = gtk_builder_scope_get_type_from_function (gtk_builder_get_scope (builder), builder, function_name);
+  if (type != G_TYPE_INVALID)
+    g_hash_table_insert (self->type_functions, (gpointer) function_name, GSIZE_TO_POINTER (type));
+
+  return type;
+}
+
+GParamSpec *
+gtk_builder_plan_find_property (GtkBuilderPlan *self,
+                                GObjectClass   *oclass,
+                                const char     *name)
+{
+  PlanKey key = { G_OBJECT_CLASS_TYPE (oclass), name };
+  GParamSpec *pspec;
+
+  if (self == NULL)
+    return g_object_class_find_property (oclass, name);
+
+  pspec = g_hash_table_lookup (self->properties, &key);
+  if (pspec)
+    return pspec;
+
+  pspec = g_object_class_find_property (oclass, name);
+  if (pspec)
+    g_hash_table_insert (self->properties, g_memdup (&key, sizeof (PlanKey)), pspec);
+
+  return pspec;
+}
+
+gboolean
+gtk_builder_plan_parse_signal_name (GtkBuilderPlan *self,
+                                    const char     *name,
+                                    GType           type,
+                                    guint          *id,
+                                    GQuark         *detail)
+{
+  PlanKey key = { type, name };
+  PlanSignal *signal;
+
+  if (self == NULL)
+    return g_signal_parse_name (name, type, id, detail, FALSE);
+
+  signal = g_hash_table_lookup (self->signals, &key);
+  if (signal == NULL)
+    {
+      guint signal_id;
+      GQuark signal_detail;
+
+      if (!g_signal_parse_name (name, type, &signal_id, &signal_detail, FALSE))
+        return FALSE;
+
+      signal = g_new (PlanSignal, 1);
+      signal->id = signal_id;
+      signal->detail = signal_detail;
+      g_hash_table_insert (self->signals, g_memdup (&key, sizeof (PlanKey)), signal);
+    }
+
+  *id = signal->id;
+  *detail = signal->detail;
+
+  return TRUE;
+}
+
+/* Values that are immutable, so a copy of the cached value is as
+ * good as a freshly parsed one. Objects are not, and they may also
+ * depend on the builder, eg for resolving file names.
+ */
+static gboolean
+value_type_is_constant (GType type)
+{
+  switch (G_TYPE_FUNDAMENTAL (type))
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+    case G_TYPE_STRING:
+    case G_TYPE_VARIANT:
+      return TRUE;
+
+    case G_TYPE_BOXED:
+      return type == GDK_TYPE_RGBA || type == GSK_TYPE_TRANSFORM;
+
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * gtk_builder_plan_value_from_string:
+ * @self: (nullable): a plan
+ *
+ * Like gtk_builder_value_from_string(), but converts every
+ * constant value only once.
+ */
+gboolean
+gtk_builder_plan_value_from_string (GtkBuilderPlan  *self,
+                                    GtkBuilder      *builder,
+                                    GParamSpec      *pspec,
+                                    const char      *string,
+                                    GValue          *value,
+                                    GError         **error)
+{
+  PlanValueKey key = { pspec, (char *) string };
+  PlanValueKey *new_key;
+  GValue *cached;
+
+  if (self == NULL || !value_type_is_constant (G_PARAM_SPEC_VALUE_TYPE (pspec)))
+    return gtk_builder_value_from_string (builder, pspec, string, value, error);
+
+  cached = g_hash_table_lookup (self->values, &key);
+  if (cached)
+    {
+      g_value_init (value, G_VALUE_TYPE (cached));
+      g_value_copy (cached, value);
+      return TRUE;
+    }
+
+  if (!gtk_builder_value_from_string (builder, pspec, string, value, error))
+    return FALSE;
+
+  new_key = g_new (PlanValueKey, 1);
+  new_key->pspec = pspec;
+  new_key->string = g_strdup (string);
+  cached = g_new0 (GValue, 1);
+  g_value_init (cached, G_VALUE_TYPE (value));
+  g_value_copy (value, cached);
+  g_hash_table_insert (self->values, new_key, cached);
+
+  return TRUE;
+}
@@ -169,6 +169,8 @@ typedef struct {
   GObject *child;
 } SubParser;
 
+typedef struct _GtkBuilderPlan GtkBuilderPlan;
+
 typedef struct {
   const char *last_element;
   GtkBuilder *builder;
@@ -188,6 +190,8 @@ typedef struct {
   int object_counter;
 
   GHashTable *object_ids;
+
+  GtkBuilderPlan *plan;
 } ParserData;
 
 typedef GType (*GTypeGetFunc) (void);
@@ -202,6 +206,40 @@ gboolean _gtk_buildable_parser_replay_precompiled (GtkBuildableParseContext *con
                                                    const char           *data,
                                                    gssize                data_len,
                                                    GError              **error);
+GtkBuilderPlan * gtk_builder_plan_new            (GBytes                   *data);
+GtkBuilderPlan * gtk_builder_plan_ref            (GtkBuilderPlan           *self);
+void             gtk_builder_plan_unref          (GtkBuilderPlan           *self);
+GBytes *         gtk_builder_plan_get_data       (GtkBuilderPlan           *self);
+GType            gtk_builder_plan_get_type_from_name
+                                                 (GtkBuilderPlan           *self,
+                                                  GtkBuilder               *builder,
+                                                  const char               *type_name);
+GType            gtk_builder_plan_get_type_from_function
+                                                 (GtkBuilderPlan           *self,
+                                                  GtkBuilder               *builder,
+                                                  const char               *function_name);
+GParamSpec *     gtk_builder_plan_find_property  (GtkBuilderPlan           *self,
+                                                  GObjectClass             *oclass,
+                                                  const char               *name);
+gboolean         gtk_builder_plan_parse_signal_name
+                                                 (GtkBuilderPlan           *self,
+                                                  const char               *name,
+                                                  GType                     type,
+                                                  guint                    *id,
+                                                  GQuark                   *detail);
+gboolean         gtk_builder_plan_value_from_string
+                                                 (GtkBuilderPlan           *self,
+                                                  GtkBuilder               *builder,
+                                                  GParamSpec               *pspec,
+                                                  const char               *string,
+                                                  GValue                   *value,
+                                                  GError                  **error);
+gboolean gtk_builder_extend_with_plan (GtkBuilder     *builder,
+                                       GObject        *object,
+                                       GType           template_type,
+                                       GtkBuilderPlan *plan,
+                                       GError        **error);
+GtkBuilderPlan * _gtk_builder_get_plan (GtkBuilder *builder);
 void _gtk_builder_parser_parse_buffer (GtkBuilder *builder,
                                        const char *filename,
                                        const char *buffer,
@@ -155,6 +155,7 @@ struct _GtkBuilderCScopePrivate
 {
   GModule *module;
   GHashTable *callbacks;
+  GHashTable *module_callbacks; /* symbols found with g_module_symbol() */
 };
 
 static void gtk_builder_cscope_scope_init (GtkBuilderScopeInterface *iface);
@@ -273,6 +274,7 @@ gtk_builder_cscope_get_callback (GtkBuilderCScope  *self,
                                  const char        *function_name,
                                  GError           **error)
 {
+  GtkBuilderCScopePrivate *priv = gtk_builder_cscope_get_instance_private (self);
   GModule *module;
   GCallback func;
 
@@ -280,6 +282,16 @@ gtk_builder_cscope_get_callback (GtkBuilderCScope  *self,
   if (func)
     return func;
 
+  /* Looking up symbols is slow, and templates look up
+   * the same handlers for every instance
+   */
+  if (priv->module_callbacks)
+    {
+      func = g_hash_table_lookup (priv->module_callbacks, function_name);
+      if (func)
+        return func;
+    }
+
   module = gtk_builder_cscope_get_module (self);
   if (module == NULL)
     {
@@ -301,6 +313,10 @@ gtk_builder_cscope_get_callback (GtkBuilderCScope  *self,
       return NULL;
     }
 
+  if (priv->module_callbacks == NULL)
+    priv->module_callbacks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_hash_table_insert (priv->module_callbacks, g_strdup (function_name), func);
+
   return func;
 }
 
@@ -385,6 +401,7 @@ gtk_builder_cscope_finalize (GObject *object)
   GtkBuilderCScopePrivate *priv = gtk_builder_cscope_get_instance_private (self);
 
   g_clear_pointer (&priv->callbacks, g_hash_table_destroy);
+  g_clear_pointer (&priv->module_callbacks, g_hash_table_destroy);
   g_clear_pointer (&priv->module, g_module_close);
 
   G_OBJECT_CLASS (gtk_builder_cscope_parent_class)->finalize (object);
@@ -30,6 +30,7 @@
 #include "gtkcssnodeprivate.h"
 #include "gtkdropcontrollermotion.h"
 #include "gtkintl.h"
+#include "gtklistbaseprivate.h"
 #include "gtklistview.h"
 #include "gtkmain.h"
 #include "gtkprivate.h"
@@ -358,6 +359,9 @@ gtk_column_view_allocate (GtkWidget *widget,
   GtkColumnView *self = GTK_COLUMN_VIEW (widget);
   int full_width, header_height, min, nat, x;
 
+  /* The columns measure the cells of the rows */
+  gtk_list_item_manager_prepare_items (gtk_list_base_get_manager (GTK_LIST_BASE (self->listview)));
+
   x = gtk_adjustment_get_value (self->hadjustment);
   full_width = gtk_column_view_allocate_columns (self, width);
 
@@ -1468,6 +1472,8 @@ gtk_column_view_measure_across (GtkColumnView *self,
   min = 0;
   nat = 0;
 
+  gtk_list_item_manager_prepare_items (gtk_list_base_get_manager (GTK_LIST_BASE (self->listview)));
+
   for (i = 0; i < g_list_model_get_n_items (G_LIST_MODEL (self->columns)); i++)
     {
       GtkColumnViewColumn *column;
@@ -24,6 +24,8 @@
 #include "gtkconstraintexpressionprivate.h"
 #include "gtkconstraintsolverprivate.h"
 
+#include <string.h>
+
 /* {{{ Variables */
 
 typedef enum {
@@ -628,67 +630,83 @@ gtk_constraint_variable_pair_free (GtkConstraintVariablePair *pair)
  * Term:
  * @variable: a #GtkConstraintVariable
  * @coefficient: the coefficient applied to the @variable
- * @next: the next term in the expression
- * @prev: the previous term in the expression;
  *
  * A tuple of (@variable, @coefficient) in an equation.
  *
  * The term acquires a reference on the variable.
  */
-typedef struct _Term Term;
-
-struct _Term {
+typedef struct {
   GtkConstraintVariable *variable;
   double coefficient;
+} Term;
 
-  Term *next;
-  Term *prev;
+/* Rows in the tableau are sparse, and most of them only have a
+ * handful of terms, so we keep the terms of an expression in an
+ * array and find them with a linear scan. Only expressions with
+ * more terms than this get an index from variables to positions.
+ */
+#define TERMS_INDEX_THRESHOLD 16
+
+struct _GtkConstraintExpression
+{
+  double constant;
+
+  /* Array of terms, in insertion order */
+  Term *terms;
+  guint n_terms;
+  guint terms_size;
+
+  /* HashTable<Variable, position>; only for expressions with
+   * more than TERMS_INDEX_THRESHOLD terms
+   */
+  GHashTable *index;
+
+  /* Used by GtkConstraintExpressionIter to guard against changes
+   * in the expression while iterating
+   */
+  gint64 age;
 };
 
-static Term *
-term_new (GtkConstraintVariable *variable,
-          double coefficient)
+static void
+gtk_constraint_expression_build_index (GtkConstraintExpression *self)
 {
-  Term *res = g_new (Term, 1);
+  guint i;
 
-  res->variable = gtk_constraint_variable_ref (variable);
-  res->coefficient = coefficient;
-  res->next = res->prev = NULL;
+  self->index = g_hash_table_new (NULL, NULL);
 
-  return res;
+  for (i = 0; i < self->n_terms; i++)
+    g_hash_table_insert (self->index, self->terms[i].variable, GUINT_TO_POINTER (i + 1));
 }
 
-static void
-term_free (gpointer data)
+static gssize
+gtk_constraint_expression_find_term (const GtkConstraintExpression *self,
+                                     GtkConstraintVariable *variable)
 {
-  Term *term = data;
+  guint i;
 
-  if (term == NULL)
-    return;
+  if (self->index != NULL)
+    return (gssize) GPOINTER_TO_UINT (g_hash_table_lookup (self->index, variable)) - 1;
 
-  gtk_constraint_variable_unref (term->variable);
+  for (i = 0; i < self->n_terms; i++)
+    {
+      if (self->terms[i].variable == variable)
+        return i;
+    }
 
-  g_free (term);
+  return -1;
 }
 
-struct _GtkConstraintExpression
+static Term *
+gtk_constraint_expression_lookup_term (const GtkConstraintExpression *self,
+                                       GtkConstraintVariable *variable)
 {
-  double constant;
+  gssize pos = gtk_constraint_expression_find_term (self, variable);
 
-  /* HashTable<Variable, Term>; the key is the term's variable,
-   * and the value is owned by the hash table
-   */
-  GHashTable *terms;
-
-  /* List of terms, in insertion order */
-  Term *first_term;
-  Term *last_term;
+  if (pos < 0)
+    return NULL;
 
-  /* Used by GtkConstraintExpressionIter to guard against changes
-   * in the expression while iterating
-   */
-  gint64 age;
-};
+  return &self->terms[pos];
+}
 
 /*< private >
  * gtk_constraint_expression_add_term:
@@ -708,27 +726,22 @@ gtk_constraint_expression_add_term (GtkConstraintExpression *self,
 {
   Term *term;
 
-  if (self->terms == NULL)
+  if (self->n_terms == self->terms_size)
     {
-      g_assert (self->first_term == NULL && self->last_term == NULL);
-      self->terms = g_hash_table_new_full (NULL, NULL,
-                                           NULL,
-                                           term_free);
+      self->terms_size = MAX (4, self->terms_size * 2);
+      self->terms = g_renew (Term, self->terms, self->terms_size);
     }
 
-  term = term_new (variable, coefficient);
-
-  g_hash_table_insert (self->terms, term->variable, term);
+  term = &self->terms[self->n_terms];
+  term->variable = gtk_constraint_variable_ref (variable);
+  term->coefficient = coefficient;
 
-  if (self->first_term == NULL)
-    self->first_term = term;
+  self->n_terms += 1;
 
-  term->prev = self->last_term;
-
-  if (self->last_term != NULL)
-    self->last_term->next = term;
-
-  self->last_term = term;
+  if (self->index != NULL)
+    g_hash_table_insert (self->index, variable, GUINT_TO_POINTER (self->n_terms));
+  else if (self->n_terms > TERMS_INDEX_THRESHOLD)
+    gtk_constraint_expression_build_index (self);
 
   /* Increase the age of the expression, so that we can catch
    * mutations from within an iteration over the terms
@@ -740,49 +753,28 @@ static void
 gtk_constraint_expression_remove_term (GtkConstraintExpression *self,
                                        GtkConstraintVariable *variable)
 {
-  Term *term, *iter;
+  gssize pos;
+  guint i;
 
-  if (self->terms == NULL)
+  pos = gtk_constraint_expression_find_term (self, variable);
+  if (pos < 0)
     return;
 
-  term = g_hash_table_lookup (self->terms, variable);
-  if (term == NULL)
-    return;
+  gtk_constraint_variable_unref (self->terms[pos].variable);
 
-  /* Keep the variable alive for the duration of the function */
-  gtk_constraint_variable_ref (variable);
+  /* Keep the insertion order of the remaining terms */
+  self->n_terms -= 1;
+  memmove (&self->terms[pos], &self->terms[pos + 1],
+           (self->n_terms - pos) * sizeof (Term));
 
-  iter = self->first_term;
-  while (iter != NULL)
+  if (self->index != NULL)
     {
-      Term *next = iter->next;
-      Term *prev = iter->prev;
-
-      if (iter == term)
-        {
-          if (prev != NULL)
-            prev->next = next;
-          if (next != NULL)
-            next->prev = prev;
+      g_hash_table_remove (self->index, variable);
 
-          if (iter == self->first_term)
-            self->first_term = next;
-          if (iter == self->last_term)
-            self->last_term = prev;
-
-          iter->next = NULL;
-          iter->prev = NULL;
-
-          break;
-        }
-
-      iter = next;
+      for (i = pos; i < self->n_terms; i++)
+        g_hash_table_insert (self->index, self->terms[i].variable, GUINT_TO_POINTER (i + 1));
     }
 
-  g_hash_table_remove (self->terms, variable);
-
-  gtk_constraint_variable_unref (variable);
-
   self->age += 1;
 }
 
@@ -801,8 +793,9 @@ gtk_constraint_expression_new (double constant)
 
   res->age = 0;
   res->terms = NULL;
-  res->first_term = NULL;
-  res->last_term = NULL;
+  res->n_terms = 0;
+  res->terms_size = 0;
+  res->index = NULL;
   res->constant = constant;
 
   return res;
@@ -847,13 +840,18 @@ static void
 gtk_constraint_expression_clear (gpointer data)
 {
   GtkConstraintExpression *self = data;
+  guint i;
+
+  for (i = 0; i < self->n_terms; i++)
+    gtk_constraint_variable_unref (self->terms[i].variable);
 
-  g_clear_pointer (&self->terms, g_hash_table_unref);
+  g_clear_pointer (&self->terms, g_free);
+  g_clear_pointer (&self->index, g_hash_table_unref);
 
   self->age = 0;
   self->constant = 0.0;
-  self->first_term = NULL;
-  self->last_term = NULL;
+  self->n_terms = 0;
+  self->terms_size = 0;
 }
 
 /*< private >
@@ -879,7 +877,7 @@ gtk_constraint_expression_unref (GtkConstraintExpression *expression)
 gboolean
 gtk_constraint_expression_is_constant (const GtkConstraintExpression *expression)
 {
-  return expression->terms == NULL;
+  return expression->n_terms == 0;
 }
 
 /*< private >
@@ -918,17 +916,14 @@ GtkConstraintExpression *
 gtk_constraint_expression_clone (GtkConstraintExpression *expression)
 {
   GtkConstraintExpression *res;
-  Term *iter;
+  guint i;
 
   res = gtk_constraint_expression_new (expression->constant);
 
-  iter = expression->first_term;
-  while (iter != NULL)
-    {
-      gtk_constraint_expression_add_term (res, iter->variable, iter->coefficient);
-
-      iter = iter->next;
-    }
+  for (i = 0; i < expression->n_terms; i++)
+    gtk_constraint_expression_add_term (res,
+                                        expression->terms[i].variable,
+                                        expression->terms[i].coefficient);
 
   return res;
 }
@@ -959,31 +954,29 @@ gtk_constraint_expression_add_variable (GtkConstraintExpression *expression,
                                         GtkConstraintVariable *subject,
                                         GtkConstraintSolver *solver)
 {
+  Term *t;
+
   /* If the expression already contains the variable, update the coefficient */
-  if (expression->terms != NULL)
+  t = gtk_constraint_expression_lookup_term (expression, variable);
+  if (t != NULL)
     {
-      Term *t = g_hash_table_lookup (expression->terms, variable);
+      double new_coefficient = t->coefficient + coefficient;
 
-      if (t != NULL)
+      /* Setting the coefficient to 0 will remove the variable */
+      if (G_APPROX_VALUE (new_coefficient, 0.0, 0.001))
         {
-          double new_coefficient = t->coefficient + coefficient;
-
-          /* Setting the coefficient to 0 will remove the variable */
-          if (G_APPROX_VALUE (new_coefficient, 0.0, 0.001))
-            {
-              /* Update the tableau if needed */
-              if (solver != NULL)
-                gtk_constraint_solver_note_removed_variable (solver, variable, subject);
-
-              gtk_constraint_expression_remove_term (expression, variable);
-            }
-          else
-            {
-              t->coefficient = new_coefficient;
-            }
+          /* Update the tableau if needed */
+          if (solver != NULL)
+            gtk_constraint_solver_note_removed_variable (solver, variable, subject);
 
-          return;
+          gtk_constraint_expression_remove_term (expression, variable);
+        }
+      else
+        {
+          t->coefficient = new_coefficient;
         }
+
+      return;
     }
 
   /* Otherwise, add the variable if the coefficient is non-zero */
@@ -1029,15 +1022,13 @@ gtk_constraint_expression_set_variable (GtkConstraintExpression *expression,
                                         GtkConstraintVariable *variable,
                                         double coefficient)
 {
-  if (expression->terms != NULL)
-    {
-      Term *t = g_hash_table_lookup (expression->terms, variable);
+  Term *t;
 
-      if (t != NULL)
-        {
-          t->coefficient = coefficient;
-          return;
-        }
+  t = gtk_constraint_expression_lookup_term (expression, variable);
+  if (t != NULL)
+    {
+      t->coefficient = coefficient;
+      return;
     }
 
   gtk_constraint_expression_add_term (expression, variable, coefficient);
@@ -1076,21 +1067,18 @@ gtk_constraint_expression_add_expression (GtkConstraintExpression *a_expr,
                                           GtkConstraintVariable *subject,
                                           GtkConstraintSolver *solver)
 {
-  Term *iter;
+  guint i;
 
   a_expr->constant += (n * b_expr->constant);
 
-  iter = b_expr->last_term;
-  while (iter != NULL)
+  for (i = b_expr->n_terms; i > 0; i--)
     {
-      Term *next = iter->prev;
+      const Term *term = &b_expr->terms[i - 1];
 
       gtk_constraint_expression_add_variable (a_expr,
-                                              iter->variable, n * iter->coefficient,
+                                              term->variable, n * term->coefficient,
                                               subject,
                                               solver);
-
-      iter = next;
     }
 }
 
@@ -1196,21 +1184,12 @@ GtkConstraintExpression *
 gtk_constraint_expression_multiply_by (GtkConstraintExpression *expression,
                                        double factor)
 {
-  GHashTableIter iter;
-  gpointer value_p;
+  guint i;
 
   expression->constant *= factor;
 
-  if (expression->terms == NULL)
-    return expression;
-
-  g_hash_table_iter_init (&iter, expression->terms);
-  while (g_hash_table_iter_next (&iter, NULL, &value_p))
-    {
-      Term *t = value_p;
-
-      t->coefficient *= factor;
-    }
+  for (i = 0; i < expression->n_terms; i++)
+    expression->terms[i].coefficient *= factor;
 
   return expression;
 }
@@ -1269,7 +1248,7 @@ gtk_constraint_expression_new_subject (GtkConstraintExpression *expression,
 
   g_assert (!gtk_constraint_expression_is_constant (expression));
 
-  term = g_hash_table_lookup (expression->terms, subject);
+  term = gtk_constraint_expression_lookup_term (expression, subject);
   g_assert (term != NULL);
   g_assert (!G_APPROX_VALUE (term->coefficient, 0.0, 0.001));
 
@@ -1334,10 +1313,7 @@ gtk_constraint_expression_get_coefficient (GtkConstraintExpression *expression,
   g_return_val_if_fail (expression != NULL, 0.0);
   g_return_val_if_fail (variable != NULL, 0.0);
 
-  if (expression->terms == NULL)
-    return 0.0;
-
-  term = g_hash_table_lookup (expression->terms, variable);
+  term = gtk_constraint_expression_lookup_term (expression, variable);
   if (term == NULL)
     return 0.0;
 
@@ -1365,9 +1341,9 @@ gtk_constraint_expression_substitute_out (GtkConstraintExpression *expression,
                                           GtkConstraintSolver *solver)
 {
   double multiplier;
-  Term *iter;
+  guint i;
 
-  if (expression->terms == NULL)
+  if (expression->n_terms == 0)
     return;
 
   multiplier = gtk_constraint_expression_get_coefficient (expression, out_var);
@@ -1375,18 +1351,15 @@ gtk_constraint_expression_substitute_out (GtkConstraintExpression *expression,
 
   expression->constant = expression->constant + multiplier * expr->constant;
 
-  iter = expr->first_term;
-  while (iter != NULL)
+  for (i = 0; i < expr->n_terms; i++)
     {
-      GtkConstraintVariable *clv = iter->variable;
-      double coeff = iter->coefficient;
-      Term *next = iter->next;
+      GtkConstraintVariable *clv = expr->terms[i].variable;
+      double coeff = expr->terms[i].coefficient;
+      Term *t = gtk_constraint_expression_lookup_term (expression, clv);
 
-      if (expression->terms != NULL &&
-          g_hash_table_contains (expression->terms, clv))
+      if (t != NULL)
         {
-          double old_coefficient = gtk_constraint_expression_get_coefficient (expression, clv);
-          double new_coefficient = old_coefficient + multiplier * coeff;
+          double new_coefficient = t->coefficient + multiplier * coeff;
 
           if (G_APPROX_VALUE (new_coefficient, 0.0, 0.001))
             {
@@ -1396,17 +1369,15 @@ gtk_constraint_expression_substitute_out (GtkConstraintExpression *expression,
               gtk_constraint_expression_remove_term (expression, clv);
             }
           else
-            gtk_constraint_expression_set_variable (expression, clv, new_coefficient);
+            t->coefficient = new_coefficient;
         }
       else
         {
-          gtk_constraint_expression_set_variable (expression, clv, multiplier * coeff);
+          gtk_constraint_expression_add_term (expression, clv, multiplier * coeff);
 
           if (solver != NULL)
             gtk_constraint_solver_note_added_variable (solver, clv, subject);
         }
-
-      iter = next;
     }
 }
 
@@ -1422,23 +1393,18 @@ gtk_constraint_expression_substitute_out (GtkConstraintExpression *expression,
 GtkConstraintVariable *
 gtk_constraint_expression_get_pivotable_variable (GtkConstraintExpression *expression)
 {
-  Term *iter;
+  guint i;
 
-  if (expression->terms == NULL)
+  if (expression->n_terms == 0)
     {
       g_critical ("Expression %p is a constant", expression);
       return NULL;
     }
 
-  iter = expression->first_term;
-  while (iter != NULL)
+  for (i = 0; i < expression->n_terms; i++)
     {
-      Term *next = iter->next;
-
-      if (gtk_constraint_variable_is_pivotable (iter->variable))
-        return iter->variable;
-
-      iter = next;
+      if (gtk_constraint_variable_is_pivotable (expression->terms[i].variable))
+        return expression->terms[i].variable;
     }
 
   return NULL;
@@ -1459,7 +1425,7 @@ gtk_constraint_expression_to_string (const GtkConstraintExpression *expression)
 {
   gboolean needs_plus = FALSE;
   GString *buf;
-  Term *iter;
+  guint i;
 
   if (expression == NULL)
     return g_strdup ("<null>");
@@ -1470,18 +1436,14 @@ gtk_constraint_expression_to_string (const GtkConstraintExpression *expression)
     {
       g_string_append_printf (buf, "%g", expression->constant);
 
-      if (expression->terms != NULL)
+      if (expression->n_terms > 0)
         needs_plus = TRUE;
     }
 
-  if (expression->terms == NULL)
-    return g_string_free (buf, FALSE);
-
-  iter = expression->first_term;
-  while (iter != NULL)
+  for (i = 0; i < expression->n_terms; i++)
     {
+      const Term *iter = &expression->terms[i];
       char *str = gtk_constraint_variable_to_string (iter->variable);
-      Term *next = iter->next;
 
       if (needs_plus)
         g_string_append (buf, " + ");
@@ -1495,8 +1457,6 @@ gtk_constraint_expression_to_string (const GtkConstraintExpression *expression)
 
       if (!needs_plus)
         needs_plus = TRUE;
-
-      iter = next;
     }
 
   return g_string_free (buf, FALSE);
@@ -1505,7 +1465,7 @@ gtk_constraint_expression_to_string (const GtkConstraintExpression *expression)
 /* Keep in sync with GtkConstraintExpressionIter */
 typedef struct {
   GtkConstraintExpression *expression;
-  Term *current;
+  gssize current;
   gint64 age;
 } RealExpressionIter;
 
@@ -1525,7 +1485,7 @@ gtk_constraint_expression_iter_init (GtkConstraintExpressionIter *iter,
   RealExpressionIter *riter = REAL_EXPRESSION_ITER (iter);
 
   riter->expression = expression;
-  riter->current = NULL;
+  riter->current = -1;
   riter->age = expression->age;
 }
 
@@ -1550,18 +1510,21 @@ gtk_constraint_expression_iter_next (GtkConstraintExpressionIter *iter,
 
   g_assert (riter->age == riter->expression->age);
 
-  if (riter->current == NULL)
-    riter->current = riter->expression->first_term;
+  if (riter->current < 0)
+    riter->current = 0;
   else
-    riter->current = riter->current->next;
+    riter->current += 1;
 
-  if (riter->current != NULL)
+  if ((gsize) riter->current >= riter->expression->n_terms)
     {
-      *coefficient = riter->current->coefficient;
-      *variable = riter->current->variable;
+      riter->current = -1;
+      return FALSE;
     }
 
-  return riter->current != NULL;
+  *coefficient = riter->expression->terms[riter->current].coefficient;
+  *variable = riter->expression->terms[riter->current].variable;
+
+  return TRUE;
 }
 
 /*< private >
@@ -1585,18 +1548,18 @@ gtk_constraint_expression_iter_prev (GtkConstraintExpressionIter *iter,
 
   g_assert (riter->age == riter->expression->age);
 
-  if (riter->current == NULL)
-    riter->current = riter->expression->last_term;
-  else
-    riter->current = riter->current->prev;
+  if (riter->current < 0)
+    riter->current = riter->expression->n_terms;
 
-  if (riter->current != NULL)
-    {
-      *coefficient = riter->current->coefficient;
-      *variable = riter->current->variable;
-    }
+  riter->current -= 1;
+
+  if (riter->current < 0)
+    return FALSE;
+
+  *coefficient = riter->expression->terms[riter->current].coefficient;
+  *variable = riter->expression->terms[riter->current].variable;
 
-  return riter->current != NULL;
+  return TRUE;
 }
 
 typedef enum {
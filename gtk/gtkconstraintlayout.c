@@ -256,6 +256,22 @@ struct _GtkConstraintLayout
 
   GListStore *constraints_observer;
   GListStore *guides_observer;
+
+  /* The required stays that keep the layout at its allocated size;
+   * they are kept until the size changes or the layout is measured,
+   * so that allocating at the same size does not touch the solver
+   */
+  GtkConstraintRef *allocation_stays[4];
+  int allocated_width;
+  int allocated_height;
+
+  /* The edit variables of the last measure, kept for the next one
+   * as long as no constraint changes in the solver
+   */
+  GtkConstraintVariable *measure_size;
+  GtkConstraintVariable *measure_opposite_size;
+  guint measure_serial;
+  int measure_natural;
 };
 
 G_DEFINE_TYPE (GtkConstraintLayoutChild, gtk_constraint_layout_child, GTK_TYPE_LAYOUT_CHILD)
@@ -900,6 +916,35 @@ update_child_constraint (GtkConstraintLayout       *self,
     }
 }
 
+static void
+remove_allocation_stays (GtkConstraintLayout *self)
+{
+  guint i;
+
+  if (self->allocation_stays[0] == NULL)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (self->allocation_stays); i++)
+    {
+      gtk_constraint_solver_remove_constraint (self->solver, self->allocation_stays[i]);
+      self->allocation_stays[i] = NULL;
+    }
+}
+
+static void
+remove_measure_edits (GtkConstraintLayout *self)
+{
+  if (self->measure_size == NULL)
+    return;
+
+  gtk_constraint_solver_remove_edit_variable (self->solver, self->measure_size);
+  if (self->measure_opposite_size != NULL)
+    gtk_constraint_solver_remove_edit_variable (self->solver, self->measure_opposite_size);
+
+  self->measure_size = NULL;
+  self->measure_opposite_size = NULL;
+}
+
 static void
 gtk_constraint_layout_measure (GtkLayoutManager *manager,
                                GtkWidget        *widget,
@@ -967,28 +1012,49 @@ gtk_constraint_layout_measure (GtkLayoutManager *manager,
 
   g_assert (size != NULL && opposite_size != NULL);
 
-  nat_value = gtk_constraint_variable_get_value (size);
+  if (for_size <= 0)
+    opposite_size = NULL;
+
+  /* The stays of the last allocation would pin the size */
+  remove_allocation_stays (self);
 
   /* We impose a temporary value on the size and opposite size of the
    * layout, with a low weight to let the solver settle towards the
-   * natural state of the system. Once we get the value out, we can
-   * remove these constraints
+   * natural state of the system. The natural size is the one before
+   * we add these constraints.
+   *
+   * The edit variables are kept for the next measure of the same
+   * kind, so that measuring again without any change to the
+   * constraints only suggests new values.
+   */
+  if (self->measure_size != size ||
+      self->measure_opposite_size != opposite_size ||
+      self->measure_serial != gtk_constraint_solver_get_serial (solver))
+    {
+      remove_measure_edits (self);
+
+      self->measure_natural = gtk_constraint_variable_get_value (size);
+
+      gtk_constraint_solver_add_edit_variable (solver, size, GTK_CONSTRAINT_STRENGTH_STRONG * 2);
+      if (opposite_size != NULL)
+        gtk_constraint_solver_add_edit_variable (solver, opposite_size, GTK_CONSTRAINT_STRENGTH_STRONG * 2);
+
+      self->measure_size = size;
+      self->measure_opposite_size = opposite_size;
+      self->measure_serial = gtk_constraint_solver_get_serial (solver);
+    }
+
+  /* We don't end the edit phase, as that would drop the edit
+   * variables of all the layouts that share the solver
    */
-  gtk_constraint_solver_add_edit_variable (solver, size, GTK_CONSTRAINT_STRENGTH_STRONG * 2);
-  if (for_size > 0)
-    gtk_constraint_solver_add_edit_variable (solver, opposite_size, GTK_CONSTRAINT_STRENGTH_STRONG * 2);
   gtk_constraint_solver_begin_edit (solver);
   gtk_constraint_solver_suggest_value (solver, size, 0.0);
-  if (for_size > 0)
+  if (opposite_size != NULL)
     gtk_constraint_solver_suggest_value (solver, opposite_size, for_size);
   gtk_constraint_solver_resolve (solver);
 
   min_value = gtk_constraint_variable_get_value (size);
-
-  gtk_constraint_solver_remove_edit_variable (solver, size);
-  if (for_size > 0)
-    gtk_constraint_solver_remove_edit_variable (solver, opposite_size);
-  gtk_constraint_solver_end_edit (solver);
+  nat_value = self->measure_natural;
 
   GTK_NOTE (LAYOUT,
             g_print ("layout %p %s size: min %d nat %d (for opposite size: %d)\n",
@@ -1012,7 +1078,6 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
                                 int               baseline)
 {
   GtkConstraintLayout *self = GTK_CONSTRAINT_LAYOUT (manager);
-  GtkConstraintRef *stay_w, *stay_h, *stay_t, *stay_l;
   GtkConstraintSolver *solver;
   GtkConstraintVariable *layout_top, *layout_height;
   GtkConstraintVariable *layout_left, *layout_width;
@@ -1023,29 +1088,48 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
     return;
 
   /* We add required stay constraints to ensure that the layout remains
-   * within the bounds of the allocation
+   * within the bounds of the allocation. They stay around until the
+   * size changes, so allocating at the same size again reuses the
+   * current solution.
    */
   layout_top = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_TOP);
   layout_left = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_LEFT);
   layout_width = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_WIDTH);
   layout_height = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_HEIGHT);
 
-  gtk_constraint_variable_set_value (layout_top, 0.0);
-  stay_t = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_top,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
-  gtk_constraint_variable_set_value (layout_left, 0.0);
-  stay_l = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_left,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
-  gtk_constraint_variable_set_value (layout_width, width);
-  stay_w = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_width,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
-  gtk_constraint_variable_set_value (layout_height, height);
-  stay_h = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_height,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
+  remove_measure_edits (self);
+
+  if (self->allocation_stays[0] == NULL ||
+      self->allocated_width != width ||
+      self->allocated_height != height)
+    {
+      remove_allocation_stays (self);
+
+      gtk_constraint_variable_set_value (layout_top, 0.0);
+      self->allocation_stays[0] =
+        gtk_constraint_solver_add_stay_variable (solver,
+                                                 layout_top,
+                                                 GTK_CONSTRAINT_STRENGTH_REQUIRED);
+      gtk_constraint_variable_set_value (layout_left, 0.0);
+      self->allocation_stays[1] =
+        gtk_constraint_solver_add_stay_variable (solver,
+                                                 layout_left,
+                                                 GTK_CONSTRAINT_STRENGTH_REQUIRED);
+      gtk_constraint_variable_set_value (layout_width, width);
+      self->allocation_stays[2] =
+        gtk_constraint_solver_add_stay_variable (solver,
+                                                 layout_width,
+                                                 GTK_CONSTRAINT_STRENGTH_REQUIRED);
+      gtk_constraint_variable_set_value (layout_height, height);
+      self->allocation_stays[3] =
+        gtk_constraint_solver_add_stay_variable (solver,
+                                                 layout_height,
+                                                 GTK_CONSTRAINT_STRENGTH_REQUIRED);
+
+      self->allocated_width = width;
+      self->allocated_height = height;
+    }
+
   GTK_NOTE (LAYOUT,
             g_print ("Layout [%p]: { .x: %g, .y: %g, .w: %g, .h: %g }\n",
                      self,
@@ -1118,12 +1202,6 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
         }
     }
 #endif
-
-  /* The allocation stay constraints are not needed any more */
-  gtk_constraint_solver_remove_constraint (solver, stay_w);
-  gtk_constraint_solver_remove_constraint (solver, stay_h);
-  gtk_constraint_solver_remove_constraint (solver, stay_t);
-  gtk_constraint_solver_remove_constraint (solver, stay_l);
 }
 
 static void
@@ -1181,6 +1259,12 @@ gtk_constraint_layout_unroot (GtkLayoutManager *manager)
       gtk_constraint_guide_detach (guide);
     }
 
+  if (self->solver != NULL)
+    {
+      remove_allocation_stays (self);
+      remove_measure_edits (self);
+    }
+
   self->solver = NULL;
 }
 
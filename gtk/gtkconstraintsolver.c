@@ -252,6 +252,9 @@ struct _GtkConstraintSolver
   int optimize_count;
   int freeze_count;
 
+  /* Changes whenever a constraint is added or removed */
+  guint serial;
+
   /* Bitfields; keep at the end */
   guint auto_solve : 1;
   guint needs_solving : 1;
@@ -1355,6 +1358,7 @@ gtk_constraint_solver_add_constraint_internal (GtkConstraintSolver *self,
   gtk_constraint_expression_unref (expr);
 
   self->needs_solving = TRUE;
+  self->serial += 1;
 
   if (self->auto_solve)
     {
@@ -1495,6 +1499,11 @@ gtk_constraint_solver_create_variable (GtkConstraintSolver *self,
  * @solver: a #GtkConstraintSolver
  *
  * Resolves the constraints currently stored in @solver.
+ *
+ * If no constraint was added or removed, and no edit variable
+ * changed its value since the last time the solver was resolved,
+ * the values of the variables are still current, and this function
+ * only resets the stay constants.
  */
 void
 gtk_constraint_solver_resolve (GtkConstraintSolver *solver)
@@ -1505,8 +1514,11 @@ gtk_constraint_solver_resolve (GtkConstraintSolver *solver)
 
   g_return_if_fail (GTK_IS_CONSTRAINT_SOLVER (solver));
 
-  gtk_constraint_solver_dual_optimize (solver);
-  gtk_constraint_solver_set_external_variables (solver);
+  if (solver->needs_solving || solver->infeasible_rows->len > 0)
+    {
+      gtk_constraint_solver_dual_optimize (solver);
+      gtk_constraint_solver_set_external_variables (solver);
+    }
 
   g_ptr_array_set_size (solver->infeasible_rows, 0);
 
@@ -1766,6 +1778,7 @@ gtk_constraint_solver_remove_constraint (GtkConstraintSolver *self,
     return;
 
   self->needs_solving = TRUE;
+  self->serial += 1;
 
   gtk_constraint_solver_reset_stay_constants (self);
 
@@ -1989,10 +2002,34 @@ gtk_constraint_solver_suggest_value (GtkConstraintSolver *self,
       return;
     }
 
+  /* Suggesting the same value again does not change the tableau */
   delta = value - ei->prev_constant;
+  if (delta == 0.0)
+    return;
+
   ei->prev_constant = value;
 
   gtk_constraint_solver_delta_edit_constant (self, delta, ei->eplus, ei->eminus);
+
+  self->needs_solving = TRUE;
+}
+
+/*< private >
+ * gtk_constraint_solver_get_serial:
+ * @solver: a #GtkConstraintSolver
+ *
+ * Gets a number that changes whenever a constraint is added to
+ * or removed from @solver, so that callers can tell whether the
+ * values they computed from the constraints are still current.
+ *
+ * Returns: the serial of the constraints of @solver
+ */
+guint
+gtk_constraint_solver_get_serial (GtkConstraintSolver *solver)
+{
+  g_return_val_if_fail (GTK_IS_CONSTRAINT_SOLVER (solver), 0);
+
+  return solver->serial;
 }
 
 /*< private >
@@ -95,6 +95,9 @@ gtk_constraint_solver_begin_edit (GtkConstraintSolver *solver);
 void
 gtk_constraint_solver_end_edit (GtkConstraintSolver *solver);
 
+guint
+gtk_constraint_solver_get_serial (GtkConstraintSolver *solver);
+
 void
 gtk_constraint_solver_note_added_variable (GtkConstraintSolver *self,
                                            GtkConstraintVariable *variable,
@@ -50,16 +50,37 @@
  * This means you do not need access to the #GtkDirectoryList but can access
  * the #GFile directly from the #GFileInfo when operating with a #GtkListView
  * or similar.
+ *
+ * Very large directories can be loaded in bulk: #GtkDirectoryList:batch-size
+ * controls how many files are requested from the enumerator at once, and
+ * #GtkDirectoryList:initial-items and #GtkDirectoryList:initial-timeout allow
+ * deferring the first #GListModel::items-changed emission until a sizable
+ * chunk of files is available, instead of announcing every small batch.
+ *
+ * Changes reported by the directory monitor are collected and queried
+ * together, so that a burst of file changes results in one query and
+ * only a few #GListModel::items-changed emissions.
  */
 
 /* random number that everyone else seems to use, too */
 #define FILES_PER_QUERY 100
 
+/* time in ms that monitor events are collected before querying them */
+#define MONITOR_BATCH_TIMEOUT 100
+
+typedef enum {
+  MONITOR_CHANGE_QUERY,
+  MONITOR_CHANGE_REMOVE
+} MonitorChange;
+
 enum {
   PROP_0,
   PROP_ATTRIBUTES,
+  PROP_BATCH_SIZE,
   PROP_ERROR,
   PROP_FILE,
+  PROP_INITIAL_ITEMS,
+  PROP_INITIAL_TIMEOUT,
   PROP_IO_PRIORITY,
   PROP_ITEM_TYPE,
   PROP_LOADING,
@@ -76,10 +97,21 @@ struct _GtkDirectoryList
   GFileMonitor *monitor;
   gboolean monitored;
   int io_priority;
+  guint batch_size;
+  guint initial_items;
+  guint initial_timeout;
 
   GCancellable *cancellable;
   GError *error; /* Error while loading */
   GSequence *items; /* Use GPtrArray or GListStore here? */
+  guint n_pending; /* items at the end of @items that were not announced yet */
+  guint initial_timeout_id;
+  guint deferring : 1; /* TRUE until the first batch was announced */
+
+  GCancellable *monitor_cancellable;
+  GHashTable *monitor_changes; /* GFile => MonitorChange */
+  guint monitor_changes_id;
+  guint monitor_query_running : 1;
 };
 
 struct _GtkDirectoryListClass
@@ -100,7 +132,7 @@ gtk_directory_list_get_n_items (GListModel *list)
 {
   GtkDirectoryList *self = GTK_DIRECTORY_LIST (list);
 
-  return g_sequence_get_length (self->items);
+  return g_sequence_get_length (self->items) - self->n_pending;
 }
 
 static gpointer
@@ -110,6 +142,9 @@ gtk_directory_list_get_item (GListModel *list,
   GtkDirectoryList *self = GTK_DIRECTORY_LIST (list);
   GSequenceIter *iter;
 
+  if (position >= g_sequence_get_length (self->items) - self->n_pending)
+    return NULL;
+
   iter = g_sequence_get_iter_at_pos (self->items, position);
 
   if (g_sequence_iter_is_end (iter))
@@ -143,10 +178,22 @@ gtk_directory_list_set_property (GObject      *object,
       gtk_directory_list_set_attributes (self, g_value_get_string (value));
       break;
 
+    case PROP_BATCH_SIZE:
+      gtk_directory_list_set_batch_size (self, g_value_get_uint (value));
+      break;
+
     case PROP_FILE:
       gtk_directory_list_set_file (self, g_value_get_object (value));
       break;
 
+    case PROP_INITIAL_ITEMS:
+      gtk_directory_list_set_initial_items (self, g_value_get_uint (value));
+      break;
+
+    case PROP_INITIAL_TIMEOUT:
+      gtk_directory_list_set_initial_timeout (self, g_value_get_uint (value));
+      break;
+
     case PROP_IO_PRIORITY:
       gtk_directory_list_set_io_priority (self, g_value_get_int (value));
       break;
@@ -175,6 +222,10 @@ gtk_directory_list_get_property (GObject     *object,
       g_value_set_string (value, self->attributes);
       break;
 
+    case PROP_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+
     case PROP_ERROR:
       g_value_set_boxed (value, self->error);
       break;
@@ -183,6 +234,14 @@ gtk_directory_list_get_property (GObject     *object,
       g_value_set_object (value, self->file);
       break;
 
+    case PROP_INITIAL_ITEMS:
+      g_value_set_uint (value, self->initial_items);
+      break;
+
+    case PROP_INITIAL_TIMEOUT:
+      g_value_set_uint (value, self->initial_timeout);
+      break;
+
     case PROP_IO_PRIORITY:
       g_value_set_int (value, self->io_priority);
       break;
@@ -208,6 +267,9 @@ gtk_directory_list_get_property (GObject     *object,
 static gboolean
 gtk_directory_list_stop_loading (GtkDirectoryList *self)
 {
+  g_clear_handle_id (&self->initial_timeout_id, g_source_remove);
+  self->deferring = FALSE;
+
   if (self->cancellable == NULL)
     return FALSE;
 
@@ -228,6 +290,15 @@ gtk_directory_list_stop_monitoring (GtkDirectoryList *self)
   if (self->monitor)
     g_signal_handlers_disconnect_by_func (self->monitor, directory_changed, self);
   g_clear_object (&self->monitor);
+
+  if (self->monitor_cancellable)
+    {
+      g_cancellable_cancel (self->monitor_cancellable);
+      g_clear_object (&self->monitor_cancellable);
+    }
+  g_clear_handle_id (&self->monitor_changes_id, g_source_remove);
+  g_hash_table_remove_all (self->monitor_changes);
+  self->monitor_query_running = FALSE;
 }
 
 static void
@@ -236,13 +307,18 @@ gtk_directory_list_dispose (GObject *object)
   GtkDirectoryList *self = GTK_DIRECTORY_LIST (object);
 
   gtk_directory_list_stop_loading (self);
-  gtk_directory_list_stop_monitoring (self);
+  if (self->monitor_changes)
+    {
+      gtk_directory_list_stop_monitoring (self);
+      g_clear_pointer (&self->monitor_changes, g_hash_table_unref);
+    }
 
   g_clear_object (&self->file);
   g_clear_pointer (&self->attributes, g_free);
 
   g_clear_error (&self->error);
   g_clear_pointer (&self->items, g_sequence_free);
+  self->n_pending = 0;
 
   G_OBJECT_CLASS (gtk_directory_list_parent_class)->dispose (object);
 }
@@ -268,6 +344,19 @@ gtk_directory_list_class_init (GtkDirectoryListClass *class)
                            NULL,
                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkDirectoryList:batch-size:
+   *
+   * Number of files to request at once while loading, or 0 to pick
+   * a suitable value automatically
+   */
+  properties[PROP_BATCH_SIZE] =
+      g_param_spec_uint ("batch-size",
+                         P_("Batch size"),
+                         P_("Number of files to request at once while loading"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkDirectoryList:error:
    *
@@ -292,6 +381,30 @@ gtk_directory_list_class_init (GtkDirectoryListClass *class)
                            G_TYPE_FILE,
                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkDirectoryList:initial-items:
+   *
+   * Number of files to load before the first items are announced
+   */
+  properties[PROP_INITIAL_ITEMS] =
+      g_param_spec_uint ("initial-items",
+                         P_("Initial items"),
+                         P_("Number of files to load before the first items are announced"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * GtkDirectoryList:initial-timeout:
+   *
+   * Time in milliseconds to wait before the first items are announced
+   */
+  properties[PROP_INITIAL_TIMEOUT] =
+      g_param_spec_uint ("initial-timeout",
+                         P_("Initial timeout"),
+                         P_("Time in milliseconds to wait before the first items are announced"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkDirectoryList:io-priority:
    *
@@ -347,6 +460,7 @@ static void
 gtk_directory_list_init (GtkDirectoryList *self)
 {
   self->items = g_sequence_new (g_object_unref);
+  self->monitor_changes = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
   self->io_priority = G_PRIORITY_DEFAULT;
   self->monitored = TRUE;
 }
@@ -378,14 +492,13 @@ gtk_directory_list_clear_items (GtkDirectoryList *self)
 {
   guint n_items;
 
-  n_items = g_sequence_get_length (self->items);
-  if (n_items > 0)
-    {
-      g_sequence_remove_range (g_sequence_get_begin_iter (self->items),
-                               g_sequence_get_end_iter (self->items));
+  n_items = g_sequence_get_length (self->items) - self->n_pending;
+  g_sequence_remove_range (g_sequence_get_begin_iter (self->items),
+                           g_sequence_get_end_iter (self->items));
+  self->n_pending = 0;
 
-      g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, 0);
-    }
+  if (n_items > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, 0);
 
   if (self->error)
     {
@@ -394,6 +507,46 @@ gtk_directory_list_clear_items (GtkDirectoryList *self)
     }
 }
 
+static void
+gtk_directory_list_flush_pending (GtkDirectoryList *self)
+{
+  guint n_pending;
+
+  g_clear_handle_id (&self->initial_timeout_id, g_source_remove);
+  self->deferring = FALSE;
+
+  n_pending = self->n_pending;
+  if (n_pending == 0)
+    return;
+
+  self->n_pending = 0;
+  g_list_model_items_changed (G_LIST_MODEL (self),
+                              g_sequence_get_length (self->items) - n_pending,
+                              0,
+                              n_pending);
+}
+
+static gboolean
+gtk_directory_list_initial_timeout_cb (gpointer data)
+{
+  GtkDirectoryList *self = data;
+
+  self->initial_timeout_id = 0;
+  gtk_directory_list_flush_pending (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static int
+gtk_directory_list_get_query_size (GtkDirectoryList *self,
+                                   GFile            *file)
+{
+  if (self->batch_size > 0)
+    return MIN (self->batch_size, G_MAXINT);
+
+  return g_file_is_native (file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY;
+}
+
 static void
 gtk_directory_list_enumerator_closed_cb (GObject      *source,
                                          GAsyncResult *res,
@@ -411,7 +564,6 @@ gtk_directory_list_got_files_cb (GObject      *source,
   GFileEnumerator *enumerator = G_FILE_ENUMERATOR (source);
   GError *error = NULL;
   GList *l, *files;
-  guint n;
 
   files = g_file_enumerator_next_files_finish (enumerator, res, &error);
 
@@ -431,6 +583,8 @@ gtk_directory_list_got_files_cb (GObject      *source,
 
       g_object_freeze_notify (G_OBJECT (self));
 
+      gtk_directory_list_flush_pending (self);
+
       g_clear_object (&self->cancellable);
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOADING]);
 
@@ -444,7 +598,6 @@ gtk_directory_list_got_files_cb (GObject      *source,
       return;
     }
 
-  n = 0;
   for (l = files; l; l = l->next)
     {
       GFileInfo *info;
@@ -455,19 +608,21 @@ gtk_directory_list_got_files_cb (GObject      *source,
       g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
       g_object_unref (file);
       g_sequence_append (self->items, info);
-      n++;
+      self->n_pending++;
     }
   g_list_free (files);
 
   g_file_enumerator_next_files_async (enumerator,
-                                      g_file_is_native (self->file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY,
+                                      gtk_directory_list_get_query_size (self, self->file),
                                       self->io_priority,
                                       self->cancellable,
                                       gtk_directory_list_got_files_cb,
                                       self);
 
-  if (n > 0)
-    g_list_model_items_changed (G_LIST_MODEL (self), g_sequence_get_length (self->items) - n, 0, n);
+  /* When deferring, wait for the timeout unless enough items were loaded */
+  if (!self->deferring ||
+      (self->initial_items > 0 && self->n_pending >= self->initial_items))
+    gtk_directory_list_flush_pending (self);
 }
 
 static void
@@ -490,6 +645,8 @@ gtk_directory_list_got_enumerator_cb (GObject      *source,
         }
 
       g_object_freeze_notify (G_OBJECT (self));
+      g_clear_handle_id (&self->initial_timeout_id, g_source_remove);
+      self->deferring = FALSE;
       self->error = error;
       g_clear_object (&self->cancellable);
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOADING]);
@@ -499,7 +656,7 @@ gtk_directory_list_got_enumerator_cb (GObject      *source,
     }
 
   g_file_enumerator_next_files_async (enumerator,
-                                      g_file_is_native (file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY,
+                                      gtk_directory_list_get_query_size (self, file),
                                       self->io_priority,
                                       self->cancellable,
                                       gtk_directory_list_got_files_cb,
@@ -531,82 +688,277 @@ gtk_directory_list_start_loading (GtkDirectoryList *self)
                                    gtk_directory_list_got_enumerator_cb,
                                    self);
 
+  self->deferring = self->initial_items > 0 || self->initial_timeout > 0;
+  if (self->initial_timeout > 0)
+    {
+      self->initial_timeout_id = g_timeout_add (self->initial_timeout,
+                                                gtk_directory_list_initial_timeout_cb,
+                                                self);
+      g_source_set_name_by_id (self->initial_timeout_id, "[gtk] gtk_directory_list_initial_timeout_cb");
+    }
+
   if (!was_loading)
     g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOADING]);
 }
 
+typedef struct
+{
+  char *attributes;
+  GPtrArray *files; /* GFile, the first @n_query ones need to be queried */
+  guint n_query;
+  GPtrArray *infos; /* GFileInfo or NULL if the file is gone */
+} MonitorQuery;
+
 static void
-got_new_file_info_cb (GObject      *source,
-                      GAsyncResult *res,
-                      gpointer      data)
+file_info_unref0 (gpointer info)
 {
-  GFile *file = G_FILE (source);
-  GtkDirectoryList *self = GTK_DIRECTORY_LIST (data);
-  GFileInfo *info;
-  guint position;
+  if (info)
+    g_object_unref (info);
+}
 
-  info = g_file_query_info_finish (file, res, NULL);
-  if (!info)
-    return;
+static void
+monitor_query_free (gpointer data)
+{
+  MonitorQuery *query = data;
 
-  g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
-  position = g_sequence_get_length (self->items);
-  g_sequence_append (self->items, info);
-  g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+  g_free (query->attributes);
+  g_ptr_array_unref (query->files);
+  if (query->infos)
+    g_ptr_array_unref (query->infos);
+  g_slice_free (MonitorQuery, query);
 }
 
 static void
-got_existing_file_info_cb (GObject      *source,
-                           GAsyncResult *res,
-                           gpointer      data)
+monitor_query_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
 {
-  GFile *file = G_FILE (source);
-  GtkDirectoryList *self = GTK_DIRECTORY_LIST (data);
-  GFileInfo *info;
-  GSequenceIter *iter;
-
-  info = g_file_query_info_finish (file, res, NULL);
-  if (!info)
-    return;
+  MonitorQuery *query = task_data;
+  guint i;
 
-  g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
+  query->infos = g_ptr_array_new_full (query->files->len, file_info_unref0);
 
-  for (iter = g_sequence_get_begin_iter (self->items);
-       !g_sequence_iter_is_end (iter);
-       iter = g_sequence_iter_next (iter))
+  for (i = 0; i < query->files->len; i++)
     {
-      GFileInfo *item = g_sequence_get (iter);
-      GFile *f = G_FILE (g_file_info_get_attribute_object (item, "standard::file"));
-      if (g_file_equal (f, file))
+      GFile *file = g_ptr_array_index (query->files, i);
+      GFileInfo *info;
+
+      if (i >= query->n_query)
         {
-          guint position = g_sequence_iter_get_position (iter);
-          g_sequence_set (iter, g_object_ref (info));
-          g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 1);
-          break;
+          g_ptr_array_add (query->infos, NULL);
+          continue;
         }
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      info = g_file_query_info (file,
+                                query->attributes,
+                                G_FILE_QUERY_INFO_NONE,
+                                cancellable,
+                                NULL);
+      if (info)
+        g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
+      g_ptr_array_add (query->infos, info);
     }
+
+  g_task_return_boolean (task, TRUE);
 }
 
 static void
-gtk_directory_list_remove_file (GtkDirectoryList *self,
-                                GFile            *file)
+gtk_directory_list_apply_changes (GtkDirectoryList *self,
+                                  GHashTable       *changes)
 {
   GSequenceIter *iter;
+  guint position, run_position, run_removed, run_added;
+  GHashTableIter hash_iter;
+  gpointer key, value;
+  guint n_added;
 
-  for (iter = g_sequence_get_begin_iter (self->items);
-       !g_sequence_iter_is_end (iter);
-       iter = g_sequence_iter_next (iter))
+  /* Changes are relative to what is visible, so announce everything first */
+  gtk_directory_list_flush_pending (self);
+
+  /* Replace or remove existing files in a single pass, announcing each
+   * contiguous run of changes with a single items-changed emission.
+   */
+  run_position = run_removed = run_added = 0;
+  position = 0;
+  iter = g_sequence_get_begin_iter (self->items);
+  while (!g_sequence_iter_is_end (iter) && g_hash_table_size (changes) > 0)
     {
       GFileInfo *item = g_sequence_get (iter);
       GFile *f = G_FILE (g_file_info_get_attribute_object (item, "standard::file"));
-      if (g_file_equal (f, file))
+      GFileInfo *info;
+
+      if (!g_hash_table_lookup_extended (changes, f, &key, &value))
+        {
+          iter = g_sequence_iter_next (iter);
+          position++;
+          continue;
+        }
+
+      if (run_removed + run_added > 0 && position != run_position + run_added)
         {
-          guint position = g_sequence_iter_get_position (iter);
+          g_list_model_items_changed (G_LIST_MODEL (self), run_position, run_removed, run_added);
+          run_removed = run_added = 0;
+        }
+      if (run_removed + run_added == 0)
+        run_position = position;
+
+      /* Take the info out of @changes before the old item goes away,
+       * @f belongs to it and may be freed together with it. */
+      info = value ? g_object_ref (value) : NULL;
+      g_hash_table_remove (changes, key);
+
+      run_removed++;
+      if (info)
+        {
+          g_sequence_set (iter, info);
+          iter = g_sequence_iter_next (iter);
+          position++;
+          run_added++;
+        }
+      else
+        {
+          GSequenceIter *next = g_sequence_iter_next (iter);
           g_sequence_remove (iter);
-          g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
-          break;
+          iter = next;
         }
     }
+
+  if (run_removed + run_added > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self), run_position, run_removed, run_added);
+
+  /* Whatever is left are new files */
+  n_added = 0;
+  g_hash_table_iter_init (&hash_iter, changes);
+  while (g_hash_table_iter_next (&hash_iter, &key, &value))
+    {
+      GFileInfo *info = value;
+
+      if (info == NULL)
+        continue;
+
+      g_sequence_append (self->items, g_object_ref (info));
+      n_added++;
+    }
+
+  if (n_added > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self),
+                                g_sequence_get_length (self->items) - n_added,
+                                0,
+                                n_added);
+}
+
+static void gtk_directory_list_queue_monitor_changes (GtkDirectoryList *self);
+
+static void
+monitor_query_done_cb (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      data)
+{
+  GtkDirectoryList *self = GTK_DIRECTORY_LIST (source);
+  MonitorQuery *query;
+  GHashTable *changes;
+  GError *error = NULL;
+  guint i;
+
+  if (!g_task_propagate_boolean (G_TASK (res), &error))
+    {
+      /* monitoring was stopped */
+      g_clear_error (&error);
+      return;
+    }
+
+  query = g_task_get_task_data (G_TASK (res));
+
+  changes = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, NULL, file_info_unref0);
+  for (i = 0; i < query->files->len; i++)
+    {
+      GFileInfo *info = g_ptr_array_index (query->infos, i);
+
+      g_hash_table_insert (changes,
+                           g_ptr_array_index (query->files, i),
+                           info ? g_object_ref (info) : NULL);
+    }
+
+  gtk_directory_list_apply_changes (self, changes);
+  g_hash_table_unref (changes);
+
+  self->monitor_query_running = FALSE;
+  if (g_hash_table_size (self->monitor_changes) > 0)
+    gtk_directory_list_queue_monitor_changes (self);
+}
+
+static gboolean
+gtk_directory_list_monitor_changes_cb (gpointer data)
+{
+  GtkDirectoryList *self = data;
+  MonitorQuery *query;
+  GHashTableIter iter;
+  gpointer key, value;
+  GTask *task;
+
+  self->monitor_changes_id = 0;
+
+  query = g_slice_new0 (MonitorQuery);
+  query->attributes = g_strdup (self->attributes);
+  query->files = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_hash_table_iter_init (&iter, self->monitor_changes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (GPOINTER_TO_UINT (value) == MONITOR_CHANGE_QUERY)
+        g_ptr_array_add (query->files, g_object_ref (key));
+    }
+  query->n_query = query->files->len;
+
+  g_hash_table_iter_init (&iter, self->monitor_changes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (GPOINTER_TO_UINT (value) == MONITOR_CHANGE_REMOVE)
+        g_ptr_array_add (query->files, g_object_ref (key));
+    }
+  g_hash_table_remove_all (self->monitor_changes);
+
+  /* Only removals, no need to go to a thread */
+  if (query->n_query == 0)
+    {
+      GHashTable *changes;
+      guint i;
+
+      changes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+      for (i = 0; i < query->files->len; i++)
+        g_hash_table_insert (changes, g_ptr_array_index (query->files, i), NULL);
+      gtk_directory_list_apply_changes (self, changes);
+      g_hash_table_unref (changes);
+      monitor_query_free (query);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  self->monitor_query_running = TRUE;
+  task = g_task_new (self, self->monitor_cancellable, monitor_query_done_cb, NULL);
+  g_task_set_source_tag (task, gtk_directory_list_monitor_changes_cb);
+  g_task_set_priority (task, self->io_priority);
+  g_task_set_task_data (task, query, monitor_query_free);
+  g_task_run_in_thread (task, monitor_query_thread);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_directory_list_queue_monitor_changes (GtkDirectoryList *self)
+{
+  if (self->monitor_changes_id != 0 || self->monitor_query_running)
+    return;
+
+  self->monitor_changes_id = g_timeout_add (MONITOR_BATCH_TIMEOUT,
+                                            gtk_directory_list_monitor_changes_cb,
+                                            self);
+  g_source_set_name_by_id (self->monitor_changes_id, "[gtk] gtk_directory_list_monitor_changes_cb");
 }
 
 static void
@@ -620,27 +972,18 @@ directory_changed (GFileMonitor       *monitor,
   switch (event)
     {
     case G_FILE_MONITOR_EVENT_CREATED:
-      g_file_query_info_async (file,
-                               self->attributes,
-                               G_FILE_QUERY_INFO_NONE,
-                               self->io_priority,
-                               self->cancellable,
-                               got_new_file_info_cb,
-                               self);
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+      g_hash_table_insert (self->monitor_changes,
+                           g_object_ref (file),
+                           GUINT_TO_POINTER (MONITOR_CHANGE_QUERY));
+      gtk_directory_list_queue_monitor_changes (self);
       break;
 
     case G_FILE_MONITOR_EVENT_DELETED:
-      gtk_directory_list_remove_file (self, file);
-      break;
-
-    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
-      g_file_query_info_async (file,
-                               self->attributes,
-                               G_FILE_QUERY_INFO_NONE,
-                               self->io_priority,
-                               self->cancellable,
-                               got_existing_file_info_cb,
-                               self);
+      g_hash_table_insert (self->monitor_changes,
+                           g_object_ref (file),
+                           GUINT_TO_POINTER (MONITOR_CHANGE_REMOVE));
+      gtk_directory_list_queue_monitor_changes (self);
       break;
 
     case G_FILE_MONITOR_EVENT_CHANGED:
@@ -661,6 +1004,7 @@ gtk_directory_list_start_monitoring (GtkDirectoryList *self)
 {
   g_assert (self->monitor == NULL);
   self->monitor = g_file_monitor_directory (self->file, G_FILE_MONITOR_NONE, NULL, NULL);
+  self->monitor_cancellable = g_cancellable_new ();
   g_signal_connect (self->monitor, "changed", G_CALLBACK (directory_changed), self);
 }
 
@@ -906,3 +1250,136 @@ gtk_directory_list_get_monitored (GtkDirectoryList *self)
 
   return self->monitored;
 }
+
+/**
+ * gtk_directory_list_set_batch_size:
+ * @self: a #GtkDirectoryList
+ * @batch_size: number of files to request at once, or 0 for
+ *     the default
+ *
+ * Sets how many files are requested from the underlying
+ * #GFileEnumerator at once while loading.
+ *
+ * Larger values reduce the number of roundtrips, which helps a lot
+ * with big directories on network filesystems, at the cost of
+ * files appearing in bigger chunks. If @batch_size is 0, a value
+ * suitable for the kind of file being enumerated is picked.
+ *
+ * Changing the batch size while @self is loading affects the next
+ * request.
+ */
+void
+gtk_directory_list_set_batch_size (GtkDirectoryList *self,
+                                   guint             batch_size)
+{
+  g_return_if_fail (GTK_IS_DIRECTORY_LIST (self));
+
+  if (self->batch_size == batch_size)
+    return;
+
+  self->batch_size = batch_size;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_BATCH_SIZE]);
+}
+
+/**
+ * gtk_directory_list_get_batch_size:
+ * @self: a #GtkDirectoryList
+ *
+ * Gets the batch size set via gtk_directory_list_set_batch_size().
+ *
+ * Returns: The batch size, or 0 if the default is used
+ */
+guint
+gtk_directory_list_get_batch_size (GtkDirectoryList *self)
+{
+  g_return_val_if_fail (GTK_IS_DIRECTORY_LIST (self), 0);
+
+  return self->batch_size;
+}
+
+/**
+ * gtk_directory_list_set_initial_items:
+ * @self: a #GtkDirectoryList
+ * @n_items: number of files to load before announcing them, or 0
+ *
+ * Defers the first #GListModel::items-changed emission while loading
+ * until at least @n_items files have been loaded.
+ *
+ * When a timeout has been set with gtk_directory_list_set_initial_timeout(),
+ * the files are announced as soon as either condition is met. Loaded
+ * files are always announced when loading finishes.
+ *
+ * Once the first files have been announced, further files are announced
+ * as they are loaded. The setting takes effect the next time loading
+ * starts.
+ */
+void
+gtk_directory_list_set_initial_items (GtkDirectoryList *self,
+                                      guint             n_items)
+{
+  g_return_if_fail (GTK_IS_DIRECTORY_LIST (self));
+
+  if (self->initial_items == n_items)
+    return;
+
+  self->initial_items = n_items;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_INITIAL_ITEMS]);
+}
+
+/**
+ * gtk_directory_list_get_initial_items:
+ * @self: a #GtkDirectoryList
+ *
+ * Gets the value set via gtk_directory_list_set_initial_items().
+ *
+ * Returns: The number of files loaded before the first announcement
+ */
+guint
+gtk_directory_list_get_initial_items (GtkDirectoryList *self)
+{
+  g_return_val_if_fail (GTK_IS_DIRECTORY_LIST (self), 0);
+
+  return self->initial_items;
+}
+
+/**
+ * gtk_directory_list_set_initial_timeout:
+ * @self: a #GtkDirectoryList
+ * @timeout: time in milliseconds, or 0
+ *
+ * Defers the first #GListModel::items-changed emission while loading
+ * until @timeout milliseconds have passed since loading started.
+ *
+ * See gtk_directory_list_set_initial_items() for details.
+ */
+void
+gtk_directory_list_set_initial_timeout (GtkDirectoryList *self,
+                                        guint             timeout)
+{
+  g_return_if_fail (GTK_IS_DIRECTORY_LIST (self));
+
+  if (self->initial_timeout == timeout)
+    return;
+
+  self->initial_timeout = timeout;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_INITIAL_TIMEOUT]);
+}
+
+/**
+ * gtk_directory_list_get_initial_timeout:
+ * @self: a #GtkDirectoryList
+ *
+ * Gets the value set via gtk_directory_list_set_initial_timeout().
+ *
+ * Returns: The timeout in milliseconds
+ */
+guint
+gtk_directory_list_get_initial_timeout (GtkDirectoryList *self)
+{
+  g_return_val_if_fail (GTK_IS_DIRECTORY_LIST (self), 0);
+
+  return self->initial_timeout;
+}
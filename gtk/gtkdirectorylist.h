@@ -68,6 +68,22 @@ void                    gtk_directory_list_set_monitored        (GtkDirectoryLis
 GDK_AVAILABLE_IN_ALL
 gboolean                gtk_directory_list_get_monitored        (GtkDirectoryList       *self);
 
+GDK_AVAILABLE_IN_ALL
+void                    gtk_directory_list_set_batch_size       (GtkDirectoryList       *self,
+                                                                 guint                   batch_size);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_directory_list_get_batch_size       (GtkDirectoryList       *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_directory_list_set_initial_items    (GtkDirectoryList       *self,
+                                                                 guint                   n_items);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_directory_list_get_initial_items    (GtkDirectoryList       *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_directory_list_set_initial_timeout  (GtkDirectoryList       *self,
+                                                                 guint                   timeout);
+GDK_AVAILABLE_IN_ALL
+guint                   gtk_directory_list_get_initial_timeout  (GtkDirectoryList       *self);
+
 G_END_DECLS
 
 #endif /* __GTK_DIRECTORY_LIST_H__ */
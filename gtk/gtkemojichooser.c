@@ -19,17 +19,24 @@
 
 #include "gtkemojichooser.h"
 
-#include "gtkadjustmentprivate.h"
+#include "gtkbinlayout.h"
 #include "gtkbox.h"
 #include "gtkbutton.h"
 #include "gtkcssprovider.h"
+#include "gtkcustomfilter.h"
 #include "gtkentry.h"
-#include "gtkflowboxprivate.h"
+#include "gtkfilterlistmodel.h"
+#include "gtkflattenlistmodel.h"
+#include "gtkflowbox.h"
+#include "gtkgridview.h"
+#include "gtklistbaseprivate.h"
 #include "gtkstack.h"
 #include "gtklabel.h"
 #include "gtkgesturelongpress.h"
+#include "gtknoselection.h"
 #include "gtkpopover.h"
 #include "gtkscrolledwindow.h"
+#include "gtksignallistitemfactory.h"
 #include "gtkintl.h"
 #include "gtkprivate.h"
 #include "gtksearchentryprivate.h"
@@ -68,28 +75,296 @@
  *
  */
 
-#define BOX_SPACE 6
+enum {
+  SECTION_RECENT,
+  SECTION_PEOPLE,
+  SECTION_BODY,
+  SECTION_NATURE,
+  SECTION_FOOD,
+  SECTION_TRAVEL,
+  SECTION_ACTIVITIES,
+  SECTION_OBJECTS,
+  SECTION_SYMBOLS,
+  SECTION_FLAGS,
+  N_SECTIONS
+};
+
+#define MAX_RECENT (7*3)
+
+/* Emoji objects are the items of the models the chooser shows.
+ * The objects for the emoji data are created on demand, so only
+ * the emoji that are looked at cost anything.
+ */
+
+GType gtk_emoji_object_get_type (void);
+
+#define GTK_TYPE_EMOJI_OBJECT (gtk_emoji_object_get_type ())
+#define GTK_EMOJI_OBJECT(o) (G_TYPE_CHECK_INSTANCE_CAST ((o), GTK_TYPE_EMOJI_OBJECT, GtkEmojiObject))
+
+typedef struct
+{
+  GObject parent;
+
+  GVariant *data;
+  gunichar modifier;
+  guint section;
+  /* Position in the emoji data, or G_MAXUINT for recent emoji */
+  guint index;
+  char text[64];
+} GtkEmojiObject;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} GtkEmojiObjectClass;
+
+G_DEFINE_TYPE (GtkEmojiObject, gtk_emoji_object, G_TYPE_OBJECT)
+
+static void
+gtk_emoji_object_init (GtkEmojiObject *self)
+{
+}
+
+static void
+gtk_emoji_object_finalize (GObject *object)
+{
+  GtkEmojiObject *self = GTK_EMOJI_OBJECT (object);
+
+  g_variant_unref (self->data);
+
+  G_OBJECT_CLASS (gtk_emoji_object_parent_class)->finalize (object);
+}
+
+static void
+gtk_emoji_object_class_init (GtkEmojiObjectClass *class)
+{
+  G_OBJECT_CLASS (class)->finalize = gtk_emoji_object_finalize;
+}
+
+static GtkEmojiObject *
+gtk_emoji_object_new (GVariant *data,
+                      gunichar  modifier,
+                      guint     section,
+                      guint     index)
+{
+  GtkEmojiObject *self;
+  GVariant *codes;
+  char *p;
+  int i;
+
+  self = g_object_new (GTK_TYPE_EMOJI_OBJECT, NULL);
+  self->data = g_variant_ref (data);
+  self->modifier = modifier;
+  self->section = section;
+  self->index = index;
+
+  p = self->text;
+  codes = g_variant_get_child_value (data, 0);
+  for (i = 0; i < g_variant_n_children (codes); i++)
+    {
+      gunichar code;
+
+      g_variant_get_child (codes, i, "u", &code);
+      if (code == 0)
+        code = modifier;
+      if (code != 0)
+        p += g_unichar_to_utf8 (code, p);
+    }
+  g_variant_unref (codes);
+  p += g_unichar_to_utf8 (0xFE0F, p); /* U+FE0F is the Emoji variation selector */
+  p[0] = 0;
+
+  return self;
+}
+
+static const char *
+gtk_emoji_object_get_name (GtkEmojiObject *self)
+{
+  const char *name;
+
+  g_variant_get_child (self->data, 1, "&s", &name);
+
+  return name;
+}
+
+/* A list model for the emoji data */
+
+GType gtk_emoji_list_get_type (void);
+
+#define GTK_TYPE_EMOJI_LIST (gtk_emoji_list_get_type ())
+#define GTK_EMOJI_LIST(o) (G_TYPE_CHECK_INSTANCE_CAST ((o), GTK_TYPE_EMOJI_LIST, GtkEmojiList))
+
+typedef struct
+{
+  GObject parent;
+
+  GVariant *data;
+  guint n_items;
+  /* Position of the first emoji of every section */
+  guint section_start[N_SECTIONS];
+} GtkEmojiList;
+
+typedef struct
+{
+  GObjectClass parent_class;
+} GtkEmojiListClass;
+
+static GType
+gtk_emoji_list_get_item_type (GListModel *list)
+{
+  return GTK_TYPE_EMOJI_OBJECT;
+}
+
+static guint
+gtk_emoji_list_get_n_items (GListModel *list)
+{
+  return GTK_EMOJI_LIST (list)->n_items;
+}
+
+static gpointer
+gtk_emoji_list_get_item (GListModel *list,
+                         guint       position)
+{
+  GtkEmojiList *self = GTK_EMOJI_LIST (list);
+  GtkEmojiObject *object;
+  GVariant *item;
+  guint section;
+
+  if (position >= self->n_items)
+    return NULL;
+
+  for (section = N_SECTIONS - 1; section > SECTION_PEOPLE; section--)
+    {
+      if (position >= self->section_start[section])
+        break;
+    }
+
+  item = g_variant_get_child_value (self->data, position);
+  object = gtk_emoji_object_new (item, 0, section, position);
+  g_variant_unref (item);
+
+  return object;
+}
+
+static void
+gtk_emoji_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = gtk_emoji_list_get_item_type;
+  iface->get_n_items = gtk_emoji_list_get_n_items;
+  iface->get_item = gtk_emoji_list_get_item;
+}
+
+G_DEFINE_TYPE_WITH_CODE (GtkEmojiList, gtk_emoji_list, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_emoji_list_model_init))
+
+static void
+gtk_emoji_list_init (GtkEmojiList *self)
+{
+}
+
+static void
+gtk_emoji_list_finalize (GObject *object)
+{
+  GtkEmojiList *self = GTK_EMOJI_LIST (object);
+
+  g_variant_unref (self->data);
+
+  G_OBJECT_CLASS (gtk_emoji_list_parent_class)->finalize (object);
+}
+
+static void
+gtk_emoji_list_class_init (GtkEmojiListClass *class)
+{
+  G_OBJECT_CLASS (class)->finalize = gtk_emoji_list_finalize;
+}
+
+/* The names of the first emoji of every section */
+static const char *section_first[N_SECTIONS] = {
+  NULL,
+  "grinning face",
+  "selfie",
+  "monkey face",
+  "grapes",
+  "globe showing Europe-Africa",
+  "jack-o-lantern",
+  "muted speaker",
+  "ATM sign",
+  "chequered flag",
+};
+
+static GListModel *
+gtk_emoji_list_new (void)
+{
+  GtkEmojiList *self;
+  GBytes *bytes;
+  GVariantIter iter;
+  const char *name;
+  guint section, i;
+
+  self = g_object_new (GTK_TYPE_EMOJI_LIST, NULL);
+
+  bytes = g_resources_lookup_data ("/org/gtk/libgtk/emoji/emoji.data", 0, NULL);
+  self->data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(auss)"), bytes, TRUE));
+  g_bytes_unref (bytes);
+
+  self->n_items = g_variant_n_children (self->data);
+
+  /* Only look at the names, this is cheap compared to
+   * creating anything for the emoji.
+   */
+  section = SECTION_PEOPLE;
+  i = 0;
+  g_variant_iter_init (&iter, self->data);
+  while (g_variant_iter_next (&iter, "(@au&s@s)", NULL, &name, NULL))
+    {
+      if (section + 1 < N_SECTIONS && strcmp (name, section_first[section + 1]) == 0)
+        self->section_start[++section] = i;
+      i++;
+    }
+
+  /* Sections that were not found are empty */
+  for (section++; section < N_SECTIONS; section++)
+    self->section_start[section] = self->n_items;
+
+  return G_LIST_MODEL (self);
+}
+
+/* The widget showing an emoji, in the grid and in the
+ * variations popover.
+ */
 
 GType gtk_emoji_chooser_child_get_type (void);
 
 #define GTK_TYPE_EMOJI_CHOOSER_CHILD (gtk_emoji_chooser_child_get_type ())
+#define GTK_IS_EMOJI_CHOOSER_CHILD(o) (G_TYPE_CHECK_INSTANCE_TYPE ((o), GTK_TYPE_EMOJI_CHOOSER_CHILD))
 
 typedef struct
 {
-  GtkFlowBoxChild parent;
+  GtkWidget parent;
+  GtkWidget *label;
   GtkWidget *variations;
+  GtkEmojiObject *item;
 } GtkEmojiChooserChild;
 
 typedef struct
 {
-  GtkFlowBoxChildClass parent_class;
+  GtkWidgetClass parent_class;
 } GtkEmojiChooserChildClass;
 
-G_DEFINE_TYPE (GtkEmojiChooserChild, gtk_emoji_chooser_child, GTK_TYPE_FLOW_BOX_CHILD)
+G_DEFINE_TYPE (GtkEmojiChooserChild, gtk_emoji_chooser_child, GTK_TYPE_WIDGET)
 
 static void
 gtk_emoji_chooser_child_init (GtkEmojiChooserChild *child)
 {
+  PangoAttrList *attrs;
+
+  child->label = gtk_label_new (NULL);
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
+  gtk_label_set_attributes (GTK_LABEL (child->label), attrs);
+  pango_attr_list_unref (attrs);
+
+  gtk_widget_set_parent (child->label, GTK_WIDGET (child));
 }
 
 static void
@@ -98,6 +373,8 @@ gtk_emoji_chooser_child_dispose (GObject *object)
   GtkEmojiChooserChild *child = (GtkEmojiChooserChild *)object;
 
   g_clear_pointer (&child->variations, gtk_widget_unparent);
+  g_clear_pointer (&child->label, gtk_widget_unparent);
+  g_clear_object (&child->item);
 
   G_OBJECT_CLASS (gtk_emoji_chooser_child_parent_class)->dispose (object);
 }
@@ -127,32 +404,7 @@ gtk_emoji_chooser_child_focus (GtkWidget        *widget,
         return TRUE;
     }
 
-  return GTK_WIDGET_CLASS (gtk_emoji_chooser_child_parent_class)->focus (widget, direction);
-}
-
-static void scroll_to_child (GtkWidget *child);
-
-static gboolean
-gtk_emoji_chooser_child_grab_focus (GtkWidget *widget)
-{
-  gtk_widget_grab_focus_self (widget);
-  scroll_to_child (widget);
-  return TRUE;
-}
-
-static void show_variations (GtkEmojiChooser *chooser,
-                             GtkWidget       *child);
-
-static void
-gtk_emoji_chooser_child_popup_menu (GtkWidget  *widget,
-                                    const char *action_name,
-                                    GVariant   *parameters)
-{
-  GtkWidget *chooser;
-
-  chooser = gtk_widget_get_ancestor (widget, GTK_TYPE_EMOJI_CHOOSER);
-
-  show_variations (GTK_EMOJI_CHOOSER (chooser), widget);
+  return FALSE;
 }
 
 static void
@@ -164,29 +416,25 @@ gtk_emoji_chooser_child_class_init (GtkEmojiChooserChildClass *class)
   object_class->dispose = gtk_emoji_chooser_child_dispose;
   widget_class->size_allocate = gtk_emoji_chooser_child_size_allocate;
   widget_class->focus = gtk_emoji_chooser_child_focus;
-  widget_class->grab_focus = gtk_emoji_chooser_child_grab_focus;
 
-  gtk_widget_class_install_action (widget_class, "menu.popup", NULL, gtk_emoji_chooser_child_popup_menu);
+  gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BIN_LAYOUT);
+  gtk_widget_class_set_css_name (widget_class, "emoji");
+}
 
-  gtk_widget_class_add_binding_action (widget_class,
-                                       GDK_KEY_F10, GDK_SHIFT_MASK,
-                                       "menu.popup",
-                                       NULL);
-  gtk_widget_class_add_binding_action (widget_class,
-                                       GDK_KEY_Menu, 0,
-                                       "menu.popup",
-                                       NULL);
+static void
+gtk_emoji_chooser_child_set_item (GtkEmojiChooserChild *child,
+                                  GtkEmojiObject       *item)
+{
+  if (!g_set_object (&child->item, item))
+    return;
 
-  gtk_widget_class_set_css_name (widget_class, "emoji");
+  g_clear_pointer (&child->variations, gtk_widget_unparent);
+  gtk_label_set_label (GTK_LABEL (child->label), item ? item->text : "");
 }
 
 typedef struct {
-  GtkWidget *box;
-  GtkWidget *heading;
   GtkWidget *button;
-  const char *first;
-  gunichar label;
-  gboolean empty;
+  const char *title;
 } EmojiSection;
 
 struct _GtkEmojiChooser
@@ -195,25 +443,26 @@ struct _GtkEmojiChooser
 
   GtkWidget *search_entry;
   GtkWidget *stack;
+  GtkWidget *heading;
   GtkWidget *scrolled_window;
+  GtkWidget *grid;
 
-  int emoji_max_width;
+  EmojiSection sections[N_SECTIONS];
 
-  EmojiSection recent;
-  EmojiSection people;
-  EmojiSection body;
-  EmojiSection nature;
-  EmojiSection food;
-  EmojiSection travel;
-  EmojiSection activities;
-  EmojiSection objects;
-  EmojiSection symbols;
-  EmojiSection flags;
+  GListModel *emoji;
+  GListStore *recent;
+  GtkFilterListModel *filter_model;
+  GtkFilter *filter;
+  char *search_text;
+  gint64 filter_start;
 
-  GVariant *data;
-  GtkWidget *box;
-  GVariantIter *iter;
-  guint populate_idle;
+  /* For checking whether emoji can be rendered properly */
+  PangoLayout *layout;
+  int emoji_max_width;
+  /* Per emoji in the data: 0 if not checked yet, 1 if it can
+   * be rendered, 2 if it can't
+   */
+  guint8 *renderable;
 
   GSettings *settings;
 };
@@ -232,69 +481,226 @@ static int signals[LAST_SIGNAL];
 G_DEFINE_TYPE (GtkEmojiChooser, gtk_emoji_chooser, GTK_TYPE_POPOVER)
 
 static void
-gtk_emoji_chooser_finalize (GObject *object)
+gtk_emoji_chooser_dispose (GObject *object)
 {
   GtkEmojiChooser *chooser = GTK_EMOJI_CHOOSER (object);
 
-  if (chooser->populate_idle)
-    g_source_remove (chooser->populate_idle);
+  if (chooser->filter_model)
+    g_signal_handlers_disconnect_by_data (chooser->filter_model, chooser);
+
+  G_OBJECT_CLASS (gtk_emoji_chooser_parent_class)->dispose (object);
+}
+
+static void
+gtk_emoji_chooser_finalize (GObject *object)
+{
+  GtkEmojiChooser *chooser = GTK_EMOJI_CHOOSER (object);
 
-  g_clear_pointer (&chooser->data, g_variant_unref);
+  g_clear_object (&chooser->filter_model);
+  g_clear_object (&chooser->filter);
+  g_clear_object (&chooser->emoji);
+  g_clear_object (&chooser->recent);
+  g_clear_object (&chooser->layout);
   g_clear_object (&chooser->settings);
+  g_free (chooser->renderable);
+  g_free (chooser->search_text);
 
   G_OBJECT_CLASS (gtk_emoji_chooser_parent_class)->finalize (object);
 }
 
+static gboolean
+check_renderable (GtkEmojiChooser *chooser,
+                  GtkEmojiObject  *item)
+{
+  PangoRectangle rect;
+
+  pango_layout_set_text (chooser->layout, item->text, -1);
+  pango_layout_get_extents (chooser->layout, &rect, NULL);
+
+  /* Check for fallback rendering that generates too wide items */
+  return pango_layout_get_unknown_glyphs_count (chooser->layout) == 0 &&
+         rect.width < 1.5 * chooser->emoji_max_width;
+}
+
+static gboolean
+is_renderable (GtkEmojiChooser *chooser,
+               GtkEmojiObject  *item)
+{
+  if (item->index == G_MAXUINT)
+    return check_renderable (chooser, item);
+
+  if (chooser->renderable[item->index] == 0)
+    chooser->renderable[item->index] = check_renderable (chooser, item) ? 1 : 2;
+
+  return chooser->renderable[item->index] == 1;
+}
+
+static gboolean
+filter_func (gpointer item,
+             gpointer data)
+{
+  GtkEmojiChooser *chooser = data;
+  GtkEmojiObject *emoji = item;
+
+  if (!is_renderable (chooser, emoji))
+    return FALSE;
+
+  if (chooser->search_text == NULL || chooser->search_text[0] == 0)
+    return TRUE;
+
+  return g_str_match_string (chooser->search_text, gtk_emoji_object_get_name (emoji), TRUE);
+}
+
+static GtkEmojiObject *
+get_item (GtkEmojiChooser *chooser,
+          guint            position)
+{
+  return g_list_model_get_item (G_LIST_MODEL (chooser->filter_model), position);
+}
+
+/* Returns the position of the first shown emoji in @section or
+ * a later one. Sections are in order, so we can bisect.
+ */
+static guint
+find_section_start (GtkEmojiChooser *chooser,
+                    guint            section)
+{
+  guint start, end;
+
+  start = 0;
+  end = g_list_model_get_n_items (G_LIST_MODEL (chooser->filter_model));
+
+  while (start < end)
+    {
+      guint mid = start + (end - start) / 2;
+      GtkEmojiObject *item = get_item (chooser, mid);
+
+      if (item->section < section)
+        start = mid + 1;
+      else
+        end = mid;
+
+      g_object_unref (item);
+    }
+
+  return start;
+}
+
 static void
-scroll_to_section (EmojiSection *section)
+scroll_to_section (GtkEmojiChooser *chooser,
+                   guint            section,
+                   gboolean         focus)
 {
-  GtkEmojiChooser *chooser;
-  GtkAdjustment *adj;
-  GtkAllocation alloc = { 0, 0, 0, 0 };
+  guint pos;
 
-  chooser = GTK_EMOJI_CHOOSER (gtk_widget_get_ancestor (section->box, GTK_TYPE_EMOJI_CHOOSER));
+  pos = find_section_start (chooser, section);
+  if (pos >= g_list_model_get_n_items (G_LIST_MODEL (chooser->filter_model)))
+    return;
 
-  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
-  if (section->heading)
-    gtk_widget_get_allocation (section->heading, &alloc);
-  gtk_adjustment_animate_to_value (adj, alloc.y - BOX_SPACE);
+  if (focus)
+    gtk_list_base_grab_focus_on_item (GTK_LIST_BASE (chooser->grid), pos, FALSE, FALSE, FALSE);
+
+  gtk_list_base_set_anchor (GTK_LIST_BASE (chooser->grid),
+                            pos,
+                            0.0, GTK_PACK_START,
+                            0.0, GTK_PACK_START);
 }
 
 static void
-scroll_to_child (GtkWidget *child)
+section_clicked (GtkButton       *button,
+                 GtkEmojiChooser *chooser)
 {
-  GtkEmojiChooser *chooser;
-  GtkAdjustment *adj;
-  GtkAllocation alloc;
-  double pos;
-  double value;
-  double page_size;
+  guint i;
+
+  for (i = 0; i < N_SECTIONS; i++)
+    {
+      if (chooser->sections[i].button == GTK_WIDGET (button))
+        {
+          scroll_to_section (chooser, i, FALSE);
+          break;
+        }
+    }
+}
 
-  chooser = GTK_EMOJI_CHOOSER (gtk_widget_get_ancestor (child, GTK_TYPE_EMOJI_CHOOSER));
+static GtkEmojiChooserChild *
+find_child_at (GtkEmojiChooser *chooser,
+               double           x,
+               double           y)
+{
+  GtkWidget *widget, *child;
 
-  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
+  widget = gtk_widget_pick (chooser->grid, x, y, GTK_PICK_DEFAULT);
+  if (widget == NULL || GTK_IS_EMOJI_CHOOSER_CHILD (widget))
+    return (GtkEmojiChooserChild *) widget;
+
+  child = gtk_widget_get_ancestor (widget, GTK_TYPE_EMOJI_CHOOSER_CHILD);
+  if (child)
+    return (GtkEmojiChooserChild *) child;
 
-  gtk_widget_get_allocation (child, &alloc);
+  /* We hit the padding of the list item around the child */
+  while (widget && gtk_widget_get_parent (widget) != chooser->grid)
+    widget = gtk_widget_get_parent (widget);
 
-  value = gtk_adjustment_get_value (adj);
-  page_size = gtk_adjustment_get_page_size (adj);
+  if (widget)
+    widget = gtk_widget_get_first_child (widget);
 
-  gtk_widget_translate_coordinates (child, gtk_widget_get_parent (chooser->recent.box), 0, 0, NULL, &pos);
+  if (widget && GTK_IS_EMOJI_CHOOSER_CHILD (widget))
+    return (GtkEmojiChooserChild *) widget;
 
-  if (pos < value)
-    gtk_adjustment_animate_to_value (adj, pos);
-  else if (pos + alloc.height >= value + page_size)
-    gtk_adjustment_animate_to_value (adj, value + ((pos + alloc.height) - (value + page_size)));
+  return NULL;
 }
 
 static void
-add_emoji (GtkWidget    *box,
-           gboolean      prepend,
-           GVariant     *item,
-           gunichar      modifier,
-           GtkEmojiChooser *chooser);
+update_heading (GtkEmojiChooser *chooser)
+{
+  GtkAdjustment *adj;
+  GtkEmojiObject *item;
+  guint section, pos, i;
 
-#define MAX_RECENT (7*3)
+  /* Find the section of the first visible emoji. We ask the grid
+   * instead of looking at its children, which may not have been
+   * moved to the new scroll position yet.
+   */
+  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
+  item = NULL;
+  if (GTK_LIST_BASE_GET_CLASS (chooser->grid)->get_position_from_allocation (GTK_LIST_BASE (chooser->grid),
+                                                                              0, gtk_adjustment_get_value (adj),
+                                                                              &pos, NULL))
+    item = get_item (chooser, pos);
+
+  if (item)
+    {
+      section = item->section;
+      g_object_unref (item);
+    }
+  else
+    section = g_list_model_get_n_items (G_LIST_MODEL (chooser->recent)) > 0 ? SECTION_RECENT : SECTION_PEOPLE;
+
+  gtk_label_set_label (GTK_LABEL (chooser->heading), chooser->sections[section].title);
+
+  /* Un/Check the section buttons accordingly */
+  for (i = 0; i < N_SECTIONS; i++)
+    {
+      if (i == section)
+        gtk_widget_set_state_flags (chooser->sections[i].button, GTK_STATE_FLAG_CHECKED, FALSE);
+      else
+        gtk_widget_unset_state_flags (chooser->sections[i].button, GTK_STATE_FLAG_CHECKED);
+    }
+}
+
+static void
+adj_value_changed (GtkAdjustment *adj,
+                   gpointer       data)
+{
+  update_heading (GTK_EMOJI_CHOOSER (data));
+}
+
+static void
+update_recent_button (GtkEmojiChooser *chooser)
+{
+  gtk_widget_set_sensitive (chooser->sections[SECTION_RECENT].button,
+                            g_list_model_get_n_items (G_LIST_MODEL (chooser->recent)) > 0);
+}
 
 static void
 populate_recent_section (GtkEmojiChooser *chooser)
@@ -302,106 +708,111 @@ populate_recent_section (GtkEmojiChooser *chooser)
   GVariant *variant;
   GVariant *item;
   GVariantIter iter;
-  gboolean empty = FALSE;
 
   variant = g_settings_get_value (chooser->settings, "recent-emoji");
   g_variant_iter_init (&iter, variant);
   while ((item = g_variant_iter_next_value (&iter)))
     {
+      GtkEmojiObject *emoji;
       GVariant *emoji_data;
       gunichar modifier;
 
       emoji_data = g_variant_get_child_value (item, 0);
       g_variant_get_child (item, 1, "u", &modifier);
-      add_emoji (chooser->recent.box, FALSE, emoji_data, modifier, chooser);
+      emoji = gtk_emoji_object_new (emoji_data, modifier, SECTION_RECENT, G_MAXUINT);
+      g_list_store_append (chooser->recent, emoji);
+      g_object_unref (emoji);
       g_variant_unref (emoji_data);
       g_variant_unref (item);
-      empty = FALSE;
     }
 
-  gtk_widget_set_visible (chooser->recent.box, !empty);
-  gtk_widget_set_sensitive (chooser->recent.button, !empty);
+  update_recent_button (chooser);
 
   g_variant_unref (variant);
 }
 
 static void
 add_recent_item (GtkEmojiChooser *chooser,
-                 GVariant        *item,
-                 gunichar         modifier)
+                 GtkEmojiObject  *item)
 {
-  GList *children, *l;
-  int i;
   GVariantBuilder builder;
-  GtkWidget *child;
-
-  g_variant_ref (item);
+  GtkEmojiObject *recent;
+  guint i;
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("a((auss)u)"));
-  g_variant_builder_add (&builder, "(@(auss)u)", item, modifier);
+  g_variant_builder_add (&builder, "(@(auss)u)", item->data, item->modifier);
 
-  children = NULL;
-  for (child = gtk_widget_get_last_child (chooser->recent.box);
-       child != NULL;
-       child = gtk_widget_get_prev_sibling (child))
-    children = g_list_prepend (children, child);
-
-  for (l = children, i = 1; l; l = l->next, i++)
+  for (i = 0; i < g_list_model_get_n_items (G_LIST_MODEL (chooser->recent)); )
     {
-      GVariant *item2 = g_object_get_data (G_OBJECT (l->data), "emoji-data");
-      gunichar modifier2 = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (l->data), "modifier"));
+      GtkEmojiObject *item2 = g_list_model_get_item (G_LIST_MODEL (chooser->recent), i);
 
-      if (modifier == modifier2 && g_variant_equal (item, item2))
+      if ((item->modifier == item2->modifier && g_variant_equal (item->data, item2->data)) ||
+          i + 1 >= MAX_RECENT)
         {
-          gtk_flow_box_remove (GTK_FLOW_BOX (chooser->recent.box), l->data);
-          i--;
-          continue;
+          g_list_store_remove (chooser->recent, i);
         }
-      if (i >= MAX_RECENT)
+      else
         {
-          gtk_flow_box_remove (GTK_FLOW_BOX (chooser->recent.box), l->data);
-          continue;
+          g_variant_builder_add (&builder, "(@(auss)u)", item2->data, item2->modifier);
+          i++;
         }
 
-      g_variant_builder_add (&builder, "(@(auss)u)", item2, modifier2);
+      g_object_unref (item2);
     }
-  g_list_free (children);
 
-  add_emoji (chooser->recent.box, TRUE, item, modifier, chooser);
+  recent = gtk_emoji_object_new (item->data, item->modifier, SECTION_RECENT, G_MAXUINT);
+  g_list_store_insert (chooser->recent, 0, recent);
+  g_object_unref (recent);
 
-  /* Enable recent */
-  gtk_widget_show (chooser->recent.box);
-  gtk_widget_set_sensitive (chooser->recent.button, TRUE);
+  update_recent_button (chooser);
 
   g_settings_set_value (chooser->settings, "recent-emoji", g_variant_builder_end (&builder));
-
-  g_variant_unref (item);
 }
 
 static void
-emoji_activated (GtkFlowBox      *box,
-                 GtkFlowBoxChild *child,
-                 gpointer         data)
+emoji_picked (GtkEmojiChooser *chooser,
+              GtkEmojiObject  *item)
 {
-  GtkEmojiChooser *chooser = data;
   char *text;
-  GtkWidget *label;
-  GVariant *item;
-  gunichar modifier;
 
   gtk_popover_popdown (GTK_POPOVER (chooser));
 
-  label = gtk_flow_box_child_get_child (child);
-  text = g_strdup (gtk_label_get_label (GTK_LABEL (label)));
+  text = g_strdup (item->text);
+  add_recent_item (chooser, item);
 
-  item = (GVariant*) g_object_get_data (G_OBJECT (child), "emoji-data");
-  modifier = (gunichar) GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (child), "modifier"));
-  add_recent_item (chooser, item, modifier);
-
-  g_signal_emit (data, signals[EMOJI_PICKED], 0, text);
+  g_signal_emit (chooser, signals[EMOJI_PICKED], 0, text);
   g_free (text);
 }
 
+static void
+emoji_activated (GtkGridView     *grid,
+                 guint            position,
+                 GtkEmojiChooser *chooser)
+{
+  GtkEmojiObject *item;
+
+  item = get_item (chooser, position);
+  if (item == NULL)
+    return;
+
+  emoji_picked (chooser, item);
+  g_object_unref (item);
+}
+
+static void
+variation_activated (GtkFlowBox      *box,
+                     GtkFlowBoxChild *child,
+                     GtkEmojiChooser *chooser)
+{
+  GtkEmojiChooserChild *emoji;
+  GtkEmojiObject *item;
+
+  emoji = (GtkEmojiChooserChild *) gtk_flow_box_child_get_child (child);
+  item = g_object_ref (emoji->item);
+  emoji_picked (chooser, item);
+  g_object_unref (item);
+}
+
 static gboolean
 has_variations (GVariant *emoji_data)
 {
@@ -427,32 +838,47 @@ has_variations (GVariant *emoji_data)
 }
 
 static void
-show_variations (GtkEmojiChooser *chooser,
-                 GtkWidget       *child)
+add_variation (GtkEmojiChooser *chooser,
+               GtkWidget       *box,
+               GVariant        *emoji_data,
+               gunichar         modifier)
+{
+  GtkEmojiObject *item;
+  GtkWidget *child;
+
+  item = gtk_emoji_object_new (emoji_data, modifier, SECTION_RECENT, G_MAXUINT);
+
+  if (check_renderable (chooser, item))
+    {
+      child = g_object_new (GTK_TYPE_EMOJI_CHOOSER_CHILD, NULL);
+      gtk_emoji_chooser_child_set_item ((GtkEmojiChooserChild *) child, item);
+      gtk_flow_box_insert (GTK_FLOW_BOX (box), child, -1);
+    }
+
+  g_object_unref (item);
+}
+
+static void
+show_variations (GtkEmojiChooser      *chooser,
+                 GtkEmojiChooserChild *child)
 {
   GtkWidget *popover;
   GtkWidget *view;
   GtkWidget *box;
   GVariant *emoji_data;
-  GtkWidget *parent_popover;
   gunichar modifier;
-  GtkEmojiChooserChild *ch = (GtkEmojiChooserChild *)child;
-
-  if (!child)
-    return;
 
-  emoji_data = (GVariant*) g_object_get_data (G_OBJECT (child), "emoji-data");
-  if (!emoji_data)
+  if (!child || !child->item)
     return;
 
+  emoji_data = child->item->data;
   if (!has_variations (emoji_data))
     return;
 
-  parent_popover = gtk_widget_get_ancestor (child, GTK_TYPE_POPOVER);
-  g_clear_pointer (&ch->variations, gtk_widget_unparent);
-  popover = ch->variations = gtk_popover_new ();
+  g_clear_pointer (&child->variations, gtk_widget_unparent);
+  popover = child->variations = gtk_popover_new ();
   gtk_popover_set_autohide (GTK_POPOVER (popover), TRUE);
-  gtk_widget_set_parent (popover, child);
+  gtk_widget_set_parent (popover, GTK_WIDGET (child));
   view = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
   gtk_widget_add_css_class (view, "view");
   box = gtk_flow_box_new ();
@@ -465,11 +891,11 @@ show_variations (GtkEmojiChooser *chooser,
   gtk_popover_set_child (GTK_POPOVER (popover), view);
   gtk_box_append (GTK_BOX (view), box);
 
-  g_signal_connect (box, "child-activated", G_CALLBACK (emoji_activated), parent_popover);
+  g_signal_connect (box, "child-activated", G_CALLBACK (variation_activated), chooser);
 
-  add_emoji (box, FALSE, emoji_data, 0, chooser);
+  add_variation (chooser, box, emoji_data, 0);
   for (modifier = 0x1f3fb; modifier <= 0x1f3ff; modifier++)
-    add_emoji (box, FALSE, emoji_data, modifier, chooser);
+    add_variation (chooser, box, emoji_data, modifier);
 
   gtk_popover_popup (GTK_POPOVER (popover));
 }
@@ -481,12 +907,8 @@ long_pressed_cb (GtkGesture *gesture,
                  gpointer    data)
 {
   GtkEmojiChooser *chooser = data;
-  GtkWidget *box;
-  GtkWidget *child;
 
-  box = gtk_event_controller_get_widget (GTK_EVENT_CONTROLLER (gesture));
-  child = GTK_WIDGET (gtk_flow_box_get_child_at_pos (GTK_FLOW_BOX (box), x, y));
-  show_variations (chooser, child);
+  show_variations (chooser, find_child_at (chooser, x, y));
 }
 
 static void
@@ -497,286 +919,129 @@ pressed_cb (GtkGesture *gesture,
             gpointer    data)
 {
   GtkEmojiChooser *chooser = data;
-  GtkWidget *box;
-  GtkWidget *child;
 
-  box = gtk_event_controller_get_widget (GTK_EVENT_CONTROLLER (gesture));
-  child = GTK_WIDGET (gtk_flow_box_get_child_at_pos (GTK_FLOW_BOX (box), x, y));
-  show_variations (chooser, child);
+  show_variations (chooser, find_child_at (chooser, x, y));
 }
 
-static void
-add_emoji (GtkWidget    *box,
-           gboolean      prepend,
-           GVariant     *item,
-           gunichar      modifier,
-           GtkEmojiChooser *chooser)
+static GtkEmojiChooserChild *
+get_focus_child (GtkEmojiChooser *chooser)
 {
-  GtkWidget *child;
-  GtkWidget *label;
-  PangoAttrList *attrs;
-  GVariant *codes;
-  char text[64];
-  char *p = text;
-  int i;
-  PangoLayout *layout;
-  PangoRectangle rect;
-
-  codes = g_variant_get_child_value (item, 0);
-  for (i = 0; i < g_variant_n_children (codes); i++)
-    {
-      gunichar code;
-
-      g_variant_get_child (codes, i, "u", &code);
-      if (code == 0)
-        code = modifier;
-      if (code != 0)
-        p += g_unichar_to_utf8 (code, p);
-    }
-  g_variant_unref (codes);
-  p += g_unichar_to_utf8 (0xFE0F, p); /* U+FE0F is the Emoji variation selector */
-  p[0] = 0;
+  GtkWidget *focus;
 
-  label = gtk_label_new (text);
-  attrs = pango_attr_list_new ();
-  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
-  gtk_label_set_attributes (GTK_LABEL (label), attrs);
-  pango_attr_list_unref (attrs);
+  focus = gtk_root_get_focus (gtk_widget_get_root (GTK_WIDGET (chooser)));
+  if (focus == NULL || !gtk_widget_is_ancestor (focus, chooser->grid))
+    return NULL;
 
-  layout = gtk_label_get_layout (GTK_LABEL (label));
-  pango_layout_get_extents (layout, &rect, NULL);
+  /* The list items take the focus, not the children */
+  if (GTK_IS_EMOJI_CHOOSER_CHILD (focus))
+    return (GtkEmojiChooserChild *) focus;
 
-  /* Check for fallback rendering that generates too wide items */
-  if (pango_layout_get_unknown_glyphs_count (layout) > 0 ||
-      rect.width >= 1.5 * chooser->emoji_max_width)
-    {
-      g_object_ref_sink (label);
-      g_object_unref (label);
-      return;
-    }
+  focus = gtk_widget_get_first_child (focus);
+  if (focus && GTK_IS_EMOJI_CHOOSER_CHILD (focus))
+    return (GtkEmojiChooserChild *) focus;
 
-  child = g_object_new (GTK_TYPE_EMOJI_CHOOSER_CHILD, NULL);
-  g_object_set_data_full (G_OBJECT (child), "emoji-data",
-                          g_variant_ref (item),
-                          (GDestroyNotify)g_variant_unref);
-  if (modifier != 0)
-    g_object_set_data (G_OBJECT (child), "modifier", GUINT_TO_POINTER (modifier));
-
-  gtk_flow_box_child_set_child (GTK_FLOW_BOX_CHILD (child), label);
-  gtk_flow_box_insert (GTK_FLOW_BOX (box), child, prepend ? 0 : -1);
+  return NULL;
 }
 
-static gboolean
-populate_emoji_chooser (gpointer data)
+static void
+gtk_emoji_chooser_popup_menu (GtkWidget  *widget,
+                              const char *action_name,
+                              GVariant   *parameters)
 {
-  GtkEmojiChooser *chooser = data;
-  GVariant *item;
-  guint64 start, now;
-
-  start = g_get_monotonic_time ();
-
-  if (!chooser->data)
-    {
-      GBytes *bytes = g_resources_lookup_data ("/org/gtk/libgtk/emoji/emoji.data", 0, NULL);
-      chooser->data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(auss)"), bytes, TRUE));
-      g_bytes_unref (bytes);
-    }
-
-  if (!chooser->iter)
-    {
-      chooser->iter = g_variant_iter_new (chooser->data);
-      chooser->box = chooser->people.box;
-    }
-
-  while ((item = g_variant_iter_next_value (chooser->iter)))
-    {
-      const char *name;
-
-      g_variant_get_child (item, 1, "&s", &name);
-
-      if (strcmp (name, chooser->body.first) == 0)
-        chooser->box = chooser->body.box;
-      else if (strcmp (name, chooser->nature.first) == 0)
-        chooser->box = chooser->nature.box;
-      else if (strcmp (name, chooser->food.first) == 0)
-        chooser->box = chooser->food.box;
-      else if (strcmp (name, chooser->travel.first) == 0)
-        chooser->box = chooser->travel.box;
-      else if (strcmp (name, chooser->activities.first) == 0)
-        chooser->box = chooser->activities.box;
-      else if (strcmp (name, chooser->objects.first) == 0)
-        chooser->box = chooser->objects.box;
-      else if (strcmp (name, chooser->symbols.first) == 0)
-        chooser->box = chooser->symbols.box;
-      else if (strcmp (name, chooser->flags.first) == 0)
-        chooser->box = chooser->flags.box;
-
-      add_emoji (chooser->box, FALSE, item, 0, chooser);
-      g_variant_unref (item);
-
-      now = g_get_monotonic_time ();
-      if (now > start + 8000)
-        {
-          if (GDK_PROFILER_IS_RUNNING)
-            gdk_profiler_add_mark (start, (now - start), "emojichooser", "populate");
-          return G_SOURCE_CONTINUE;
-        }
-    }
-
-  g_variant_iter_free (chooser->iter);
-  chooser->iter = NULL;
-  chooser->box = NULL;
-  chooser->populate_idle = 0;
-
-  if (GDK_PROFILER_IS_RUNNING)
-    gdk_profiler_end_mark (start, "emojichooser", "populate (finish)");
+  GtkEmojiChooser *chooser = GTK_EMOJI_CHOOSER (widget);
 
-  return G_SOURCE_REMOVE;
+  show_variations (chooser, get_focus_child (chooser));
 }
 
 static void
-adj_value_changed (GtkAdjustment *adj,
-                   gpointer       data)
+setup_item (GtkSignalListItemFactory *factory,
+            GtkListItem              *list_item,
+            GtkEmojiChooser          *chooser)
 {
-  GtkEmojiChooser *chooser = data;
-  double value = gtk_adjustment_get_value (adj);
-  EmojiSection const *sections[] = {
-    &chooser->recent,
-    &chooser->people,
-    &chooser->body,
-    &chooser->nature,
-    &chooser->food,
-    &chooser->travel,
-    &chooser->activities,
-    &chooser->objects,
-    &chooser->symbols,
-    &chooser->flags,
-  };
-  EmojiSection const *select_section = sections[0];
-  gsize i;
-
-  /* Figure out which section the current scroll position is within */
-  for (i = 0; i < G_N_ELEMENTS (sections); ++i)
-    {
-      EmojiSection const *section = sections[i];
-      GtkAllocation alloc;
-
-      if (!gtk_widget_get_visible (section->box))
-        continue;
-
-      if (section->heading)
-        gtk_widget_get_allocation (section->heading, &alloc);
-      else
-        gtk_widget_get_allocation (section->box, &alloc);
-
-      if (value < alloc.y - BOX_SPACE)
-        break;
-
-      select_section = section;
-    }
-
-  /* Un/Check the section buttons accordingly */
-  for (i = 0; i < G_N_ELEMENTS (sections); ++i)
-    {
-      EmojiSection const *section = sections[i];
-
-      if (section == select_section)
-        gtk_widget_set_state_flags (section->button, GTK_STATE_FLAG_CHECKED, FALSE);
-      else
-        gtk_widget_unset_state_flags (section->button, GTK_STATE_FLAG_CHECKED);
-    }
+  gtk_list_item_set_child (list_item, g_object_new (GTK_TYPE_EMOJI_CHOOSER_CHILD, NULL));
 }
 
-static gboolean
-filter_func (GtkFlowBoxChild *child,
-             gpointer         data)
+static void
+bind_item (GtkSignalListItemFactory *factory,
+           GtkListItem              *list_item,
+           GtkEmojiChooser          *chooser)
 {
-  EmojiSection *section = data;
-  GtkEmojiChooser *chooser;
-  GVariant *emoji_data;
-  const char *text;
-  const char *name;
-  gboolean res;
-
-  res = TRUE;
-
-  chooser = GTK_EMOJI_CHOOSER (gtk_widget_get_ancestor (GTK_WIDGET (child), GTK_TYPE_EMOJI_CHOOSER));
-  text = gtk_editable_get_text (GTK_EDITABLE (chooser->search_entry));
-  emoji_data = (GVariant *) g_object_get_data (G_OBJECT (child), "emoji-data");
-
-  if (text[0] == 0)
-    goto out;
-
-  if (!emoji_data)
-    goto out;
-
-  g_variant_get_child (emoji_data, 1, "&s", &name);
-  res = g_str_match_string (text, name, TRUE);
-
-out:
-  if (res)
-    section->empty = FALSE;
-
-  return res;
+  gtk_emoji_chooser_child_set_item ((GtkEmojiChooserChild *) gtk_list_item_get_child (list_item),
+                                    gtk_list_item_get_item (list_item));
 }
 
 static void
-invalidate_section (EmojiSection *section)
+unbind_item (GtkSignalListItemFactory *factory,
+             GtkListItem              *list_item,
+             GtkEmojiChooser          *chooser)
 {
-  section->empty = TRUE;
-  gtk_flow_box_invalidate_filter (GTK_FLOW_BOX (section->box));
+  gtk_emoji_chooser_child_set_item ((GtkEmojiChooserChild *) gtk_list_item_get_child (list_item), NULL);
 }
 
 static void
-update_headings (GtkEmojiChooser *chooser)
-{
-  gtk_widget_set_visible (chooser->people.heading, !chooser->people.empty);
-  gtk_widget_set_visible (chooser->people.box, !chooser->people.empty);
-  gtk_widget_set_visible (chooser->body.heading, !chooser->body.empty);
-  gtk_widget_set_visible (chooser->body.box, !chooser->body.empty);
-  gtk_widget_set_visible (chooser->nature.heading, !chooser->nature.empty);
-  gtk_widget_set_visible (chooser->nature.box, !chooser->nature.empty);
-  gtk_widget_set_visible (chooser->food.heading, !chooser->food.empty);
-  gtk_widget_set_visible (chooser->food.box, !chooser->food.empty);
-  gtk_widget_set_visible (chooser->travel.heading, !chooser->travel.empty);
-  gtk_widget_set_visible (chooser->travel.box, !chooser->travel.empty);
-  gtk_widget_set_visible (chooser->activities.heading, !chooser->activities.empty);
-  gtk_widget_set_visible (chooser->activities.box, !chooser->activities.empty);
-  gtk_widget_set_visible (chooser->objects.heading, !chooser->objects.empty);
-  gtk_widget_set_visible (chooser->objects.box, !chooser->objects.empty);
-  gtk_widget_set_visible (chooser->symbols.heading, !chooser->symbols.empty);
-  gtk_widget_set_visible (chooser->symbols.box, !chooser->symbols.empty);
-  gtk_widget_set_visible (chooser->flags.heading, !chooser->flags.empty);
-  gtk_widget_set_visible (chooser->flags.box, !chooser->flags.empty);
-
-  if (chooser->recent.empty && chooser->people.empty &&
-      chooser->body.empty && chooser->nature.empty &&
-      chooser->food.empty && chooser->travel.empty &&
-      chooser->activities.empty && chooser->objects.empty &&
-      chooser->symbols.empty && chooser->flags.empty)
+update_empty (GtkEmojiChooser *chooser)
+{
+  /* While filtering is still going on, more emoji may turn up */
+  if (g_list_model_get_n_items (G_LIST_MODEL (chooser->filter_model)) == 0 &&
+      gtk_filter_list_model_get_pending (chooser->filter_model) == 0)
     gtk_stack_set_visible_child_name (GTK_STACK (chooser->stack), "empty");
   else
     gtk_stack_set_visible_child_name (GTK_STACK (chooser->stack), "list");
 }
 
+static void
+filter_items_changed (GListModel      *model,
+                      guint            position,
+                      guint            removed,
+                      guint            added,
+                      GtkEmojiChooser *chooser)
+{
+  update_empty (chooser);
+  update_heading (chooser);
+}
+
+static void
+filter_pending_changed (GObject         *object,
+                        GParamSpec      *pspec,
+                        GtkEmojiChooser *chooser)
+{
+  update_empty (chooser);
+
+  if (GDK_PROFILER_IS_RUNNING &&
+      gtk_filter_list_model_get_pending (chooser->filter_model) == 0)
+    gdk_profiler_end_mark (chooser->filter_start, "emojichooser", "filter");
+}
+
 static void
 search_changed (GtkEntry *entry,
                 gpointer  data)
 {
   GtkEmojiChooser *chooser = data;
+  const char *text;
+  GtkFilterChange change;
+
+  text = gtk_editable_get_text (GTK_EDITABLE (chooser->search_entry));
+
+  if (g_strcmp0 (text, chooser->search_text) == 0)
+    return;
+
+  /* Typing more only ever hides emoji, deleting only shows more */
+  if (chooser->search_text == NULL || chooser->search_text[0] == 0)
+    change = GTK_FILTER_CHANGE_MORE_STRICT;
+  else if (text[0] == 0)
+    change = GTK_FILTER_CHANGE_LESS_STRICT;
+  else if (g_str_has_prefix (text, chooser->search_text))
+    change = GTK_FILTER_CHANGE_MORE_STRICT;
+  else if (g_str_has_prefix (chooser->search_text, text))
+    change = GTK_FILTER_CHANGE_LESS_STRICT;
+  else
+    change = GTK_FILTER_CHANGE_DIFFERENT;
 
-  invalidate_section (&chooser->recent);
-  invalidate_section (&chooser->people);
-  invalidate_section (&chooser->body);
-  invalidate_section (&chooser->nature);
-  invalidate_section (&chooser->food);
-  invalidate_section (&chooser->travel);
-  invalidate_section (&chooser->activities);
-  invalidate_section (&chooser->objects);
-  invalidate_section (&chooser->symbols);
-  invalidate_section (&chooser->flags);
-
-  update_headings (chooser);
+  g_free (chooser->search_text);
+  chooser->search_text = g_strdup (text);
+
+  chooser->filter_start = g_get_monotonic_time ();
+  gtk_filter_changed (chooser->filter, change);
 }
 
 static void
@@ -788,17 +1053,14 @@ stop_search (GtkEntry *entry,
 
 static void
 setup_section (GtkEmojiChooser *chooser,
-               EmojiSection   *section,
-               const char     *first,
-               const char     *icon)
+               guint            section,
+               const char      *title,
+               const char      *icon)
 {
-  section->first = first;
-
-  gtk_button_set_icon_name (GTK_BUTTON (section->button), icon);
+  chooser->sections[section].title = title;
 
-  gtk_flow_box_disable_move_cursor (GTK_FLOW_BOX (section->box));
-  gtk_flow_box_set_filter_func (GTK_FLOW_BOX (section->box), filter_func, section, NULL);
-  g_signal_connect_swapped (section->button, "clicked", G_CALLBACK (scroll_to_section), section);
+  gtk_button_set_icon_name (GTK_BUTTON (chooser->sections[section].button), icon);
+  g_signal_connect (chooser->sections[section].button, "clicked", G_CALLBACK (section_clicked), chooser);
 }
 
 static void
@@ -806,6 +1068,12 @@ gtk_emoji_chooser_init (GtkEmojiChooser *chooser)
 {
   GtkAdjustment *adj;
   GtkText *text;
+  GListStore *models;
+  GtkListItemFactory *factory;
+  GtkNoSelection *selection;
+  PangoAttrList *attrs;
+  PangoRectangle rect;
+  gint64 before = g_get_monotonic_time ();
 
   chooser->settings = g_settings_new ("org.gtk.gtk4.Settings.EmojiChooser");
 
@@ -819,88 +1087,83 @@ gtk_emoji_chooser_init (GtkEmojiChooser *chooser)
    * font does not contain and therefore end up being rendered
    * as multiply glyphs.
    */
-  {
-    PangoLayout *layout = gtk_widget_create_pango_layout (GTK_WIDGET (chooser), "🙂");
-    PangoAttrList *attrs;
-    PangoRectangle rect;
-
-    attrs = pango_attr_list_new ();
-    pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
-    pango_layout_set_attributes (layout, attrs);
-    pango_attr_list_unref (attrs);
-
-    pango_layout_get_extents (layout, &rect, NULL);
-    chooser->emoji_max_width = rect.width;
+  chooser->layout = gtk_widget_create_pango_layout (GTK_WIDGET (chooser), "🙂");
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
+  pango_layout_set_attributes (chooser->layout, attrs);
+  pango_attr_list_unref (attrs);
 
-    g_object_unref (layout);
-  }
+  pango_layout_get_extents (chooser->layout, &rect, NULL);
+  chooser->emoji_max_width = rect.width;
 
   adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
   g_signal_connect (adj, "value-changed", G_CALLBACK (adj_value_changed), chooser);
 
-  setup_section (chooser, &chooser->recent, NULL, "emoji-recent-symbolic");
-  setup_section (chooser, &chooser->people, "grinning face", "emoji-people-symbolic");
-  setup_section (chooser, &chooser->body, "selfie", "emoji-body-symbolic");
-  setup_section (chooser, &chooser->nature, "monkey face", "emoji-nature-symbolic");
-  setup_section (chooser, &chooser->food, "grapes", "emoji-food-symbolic");
-  setup_section (chooser, &chooser->travel, "globe showing Europe-Africa", "emoji-travel-symbolic");
-  setup_section (chooser, &chooser->activities, "jack-o-lantern", "emoji-activities-symbolic");
-  setup_section (chooser, &chooser->objects, "muted speaker", "emoji-objects-symbolic");
-  setup_section (chooser, &chooser->symbols, "ATM sign", "emoji-symbols-symbolic");
-  setup_section (chooser, &chooser->flags, "chequered flag", "emoji-flags-symbolic");
-
+  setup_section (chooser, SECTION_RECENT, C_("emoji category", "Recent"), "emoji-recent-symbolic");
+  setup_section (chooser, SECTION_PEOPLE, C_("emoji category", "Smileys & People"), "emoji-people-symbolic");
+  setup_section (chooser, SECTION_BODY, C_("emoji category", "Body & Clothing"), "emoji-body-symbolic");
+  setup_section (chooser, SECTION_NATURE, C_("emoji category", "Animals & Nature"), "emoji-nature-symbolic");
+  setup_section (chooser, SECTION_FOOD, C_("emoji category", "Food & Drink"), "emoji-food-symbolic");
+  setup_section (chooser, SECTION_TRAVEL, C_("emoji category", "Travel & Places"), "emoji-travel-symbolic");
+  setup_section (chooser, SECTION_ACTIVITIES, C_("emoji category", "Activities"), "emoji-activities-symbolic");
+  setup_section (chooser, SECTION_OBJECTS, C_("emoji category", "Objects"), "emoji-objects-symbolic");
+  setup_section (chooser, SECTION_SYMBOLS, C_("emoji category", "Symbols"), "emoji-symbols-symbolic");
+  setup_section (chooser, SECTION_FLAGS, C_("emoji category", "Flags"), "emoji-flags-symbolic");
+
+  chooser->recent = g_list_store_new (GTK_TYPE_EMOJI_OBJECT);
   populate_recent_section (chooser);
 
-  chooser->populate_idle = g_idle_add (populate_emoji_chooser, chooser);
-  g_source_set_name_by_id (chooser->populate_idle, "[gtk] populate_emoji_chooser");
+  chooser->emoji = gtk_emoji_list_new ();
+  chooser->renderable = g_new0 (guint8, g_list_model_get_n_items (chooser->emoji));
+
+  /* The recent emoji come first, then all the others */
+  models = g_list_store_new (G_TYPE_LIST_MODEL);
+  g_list_store_append (models, chooser->recent);
+  g_list_store_append (models, chooser->emoji);
+
+  /* Checking whether emoji can be rendered needs a layout per
+   * emoji, so filter in chunks instead of blocking.
+   */
+  chooser->filter_start = g_get_monotonic_time ();
+  chooser->filter = gtk_custom_filter_new (filter_func, chooser, NULL);
+  chooser->filter_model = gtk_filter_list_model_new (G_LIST_MODEL (gtk_flatten_list_model_new (G_LIST_MODEL (models))),
+                                                     g_object_ref (chooser->filter));
+  gtk_filter_list_model_set_incremental (chooser->filter_model, TRUE);
+  g_signal_connect (chooser->filter_model, "items-changed", G_CALLBACK (filter_items_changed), chooser);
+  g_signal_connect (chooser->filter_model, "notify::pending", G_CALLBACK (filter_pending_changed), chooser);
+
+  factory = gtk_signal_list_item_factory_new ();
+  g_signal_connect (factory, "setup", G_CALLBACK (setup_item), chooser);
+  g_signal_connect (factory, "bind", G_CALLBACK (bind_item), chooser);
+  g_signal_connect (factory, "unbind", G_CALLBACK (unbind_item), chooser);
+  gtk_grid_view_set_factory (GTK_GRID_VIEW (chooser->grid), factory);
+  g_object_unref (factory);
+
+  selection = gtk_no_selection_new (g_object_ref (G_LIST_MODEL (chooser->filter_model)));
+  gtk_grid_view_set_model (GTK_GRID_VIEW (chooser->grid), G_LIST_MODEL (selection));
+  g_object_unref (selection);
+
+  update_heading (chooser);
+
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_end_mark (before, "emojichooser", "init");
 }
 
 static void
 gtk_emoji_chooser_show (GtkWidget *widget)
 {
   GtkEmojiChooser *chooser = GTK_EMOJI_CHOOSER (widget);
-  GtkAdjustment *adj;
 
   GTK_WIDGET_CLASS (gtk_emoji_chooser_parent_class)->show (widget);
 
-  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
-  gtk_adjustment_set_value (adj, 0);
-  adj_value_changed (adj, chooser);
-
   gtk_editable_set_text (GTK_EDITABLE (chooser->search_entry), "");
-}
 
-static EmojiSection *
-find_next_section (GtkEmojiChooser *chooser,
-                   GtkWidget       *box,
-                   gboolean         down)
-{
-  EmojiSection *next;
-
-  if (box == chooser->recent.box)
-    next = down ? &chooser->people : NULL;
-  else if (box == chooser->people.box)
-    next = down ? &chooser->body : &chooser->recent;
-  else if (box == chooser->body.box)
-    next = down ? &chooser->nature : &chooser->people;
-  else if (box == chooser->nature.box)
-    next = down ? &chooser->food : &chooser->body;
-  else if (box == chooser->food.box)
-    next = down ? &chooser->travel : &chooser->nature;
-  else if (box == chooser->travel.box)
-    next = down ? &chooser->activities : &chooser->food;
-  else if (box == chooser->activities.box)
-    next = down ? &chooser->objects : &chooser->travel;
-  else if (box == chooser->objects.box)
-    next = down ? &chooser->symbols : &chooser->activities;
-  else if (box == chooser->symbols.box)
-    next = down ? &chooser->flags : &chooser->objects;
-  else if (box == chooser->flags.box)
-    next = down ? NULL : &chooser->symbols;
-  else
-    next = NULL;
-
-  return next;
+  if (g_list_model_get_n_items (G_LIST_MODEL (chooser->filter_model)) > 0)
+    gtk_list_base_set_anchor (GTK_LIST_BASE (chooser->grid),
+                              0,
+                              0.0, GTK_PACK_START,
+                              0.0, GTK_PACK_START);
+  update_heading (chooser);
 }
 
 static void
@@ -910,95 +1173,40 @@ gtk_emoji_chooser_scroll_section (GtkWidget  *widget,
 {
   GtkEmojiChooser *chooser = GTK_EMOJI_CHOOSER (widget);
   int direction = g_variant_get_int32 (parameter);
+  GtkEmojiChooserChild *child;
   GtkWidget *focus;
-  GtkWidget *box;
-  EmojiSection *next;
+  int section;
 
   focus = gtk_root_get_focus (gtk_widget_get_root (widget));
   if (focus == NULL)
     return;
 
-  if (gtk_widget_is_ancestor (focus, chooser->search_entry))
-    box = chooser->recent.box;
+  child = get_focus_child (chooser);
+  if (child && child->item)
+    section = child->item->section;
+  else if (gtk_widget_is_ancestor (focus, chooser->search_entry))
+    section = SECTION_RECENT - 1;
   else
-    box = gtk_widget_get_ancestor (focus, GTK_TYPE_FLOW_BOX);
-
-  next = find_next_section (chooser, box, direction > 0);
+    return;
 
-  if (next)
+  /* Skip sections that have nothing to show */
+  for (section += direction; section >= 0 && section < N_SECTIONS; section += direction)
     {
-      gtk_widget_child_focus (next->box, GTK_DIR_TAB_FORWARD);
-      scroll_to_section (next);
-    }
-}
-
-static gboolean
-keynav_failed (GtkWidget        *box,
-               GtkDirectionType  direction,
-               GtkEmojiChooser  *chooser)
-{
-  EmojiSection *next;
-  GtkWidget *focus; 
-  GtkWidget *child;
-  GtkWidget *sibling;
-  int i;
-  int column;
-
-  focus = gtk_root_get_focus (gtk_widget_get_root (box));
-  if (focus == NULL)
-    return FALSE;
-
-  child = gtk_widget_get_ancestor (focus, GTK_TYPE_EMOJI_CHOOSER_CHILD);
-
-  i = 0;
-  for (sibling = gtk_widget_get_first_child (box);
-       sibling != child;
-       sibling = gtk_widget_get_next_sibling (sibling))
-    i++;
-
-  column = i % 7;
+      guint pos = find_section_start (chooser, section);
+      GtkEmojiObject *item = get_item (chooser, pos);
 
-  if (direction == GTK_DIR_DOWN)
-    {
-      next = find_next_section (chooser, box, TRUE);
-      if (next == NULL)
-        return FALSE;
-
-      i = 0;
-      for (sibling = gtk_widget_get_first_child (next->box);
-           sibling;
-           sibling = gtk_widget_get_next_sibling (sibling), i++)
+      if (item != NULL)
         {
-          if (i == column)
+          gboolean found = item->section == section;
+
+          g_object_unref (item);
+          if (found)
             {
-              gtk_widget_grab_focus (sibling);
-              return TRUE;
+              scroll_to_section (chooser, section, TRUE);
+              return;
             }
         }
     }
-  else if (direction == GTK_DIR_UP)
-    {
-      next = find_next_section (chooser, box, FALSE);
-      if (next == NULL)
-        return FALSE;
-
-      i = 0;
-      child = NULL;
-      for (sibling = gtk_widget_get_first_child (next->box);
-           sibling;
-           sibling = gtk_widget_get_next_sibling (sibling), i++)
-        {
-          if ((i % 7) == column)
-            child = sibling;
-        }
-      if (child)
-        {
-          gtk_widget_grab_focus (child);
-          return TRUE;
-        }
-    }
-
-  return FALSE;
 }
 
 static void
@@ -1007,6 +1215,7 @@ gtk_emoji_chooser_class_init (GtkEmojiChooserClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = gtk_emoji_chooser_dispose;
   object_class->finalize = gtk_emoji_chooser_finalize;
   widget_class->show = gtk_emoji_chooser_show;
 
@@ -1030,53 +1239,32 @@ gtk_emoji_chooser_class_init (GtkEmojiChooserClass *klass)
 
   gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, search_entry);
   gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, stack);
+  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, heading);
   gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, scrolled_window);
+  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, grid);
 
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, recent.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, recent.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, people.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, people.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, people.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, body.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, body.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, body.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, nature.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, nature.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, nature.button);
+#define BIND_SECTION_BUTTON(name, section) \
+  gtk_widget_class_bind_template_child_full (widget_class, name, FALSE, \
+                                             G_STRUCT_OFFSET (GtkEmojiChooser, sections[section].button))
 
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, food.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, food.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, food.button);
+  BIND_SECTION_BUTTON ("recent.button", SECTION_RECENT);
+  BIND_SECTION_BUTTON ("people.button", SECTION_PEOPLE);
+  BIND_SECTION_BUTTON ("body.button", SECTION_BODY);
+  BIND_SECTION_BUTTON ("nature.button", SECTION_NATURE);
+  BIND_SECTION_BUTTON ("food.button", SECTION_FOOD);
+  BIND_SECTION_BUTTON ("travel.button", SECTION_TRAVEL);
+  BIND_SECTION_BUTTON ("activities.button", SECTION_ACTIVITIES);
+  BIND_SECTION_BUTTON ("objects.button", SECTION_OBJECTS);
+  BIND_SECTION_BUTTON ("symbols.button", SECTION_SYMBOLS);
+  BIND_SECTION_BUTTON ("flags.button", SECTION_FLAGS);
 
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, travel.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, travel.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, travel.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, activities.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, activities.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, activities.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, objects.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, objects.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, objects.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, symbols.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, symbols.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, symbols.button);
-
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, flags.box);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, flags.heading);
-  gtk_widget_class_bind_template_child (widget_class, GtkEmojiChooser, flags.button);
+#undef BIND_SECTION_BUTTON
 
   gtk_widget_class_bind_template_callback (widget_class, emoji_activated);
   gtk_widget_class_bind_template_callback (widget_class, search_changed);
   gtk_widget_class_bind_template_callback (widget_class, stop_search);
   gtk_widget_class_bind_template_callback (widget_class, pressed_cb);
   gtk_widget_class_bind_template_callback (widget_class, long_pressed_cb);
-  gtk_widget_class_bind_template_callback (widget_class, keynav_failed);
 
   /**
    * GtkEmojiChooser|scroll.section:
@@ -1091,6 +1279,17 @@ gtk_emoji_chooser_class_init (GtkEmojiChooserClass *klass)
                                        "scroll.section", "i", 1);
   gtk_widget_class_add_binding_action (widget_class, GDK_KEY_p, GDK_CONTROL_MASK,
                                        "scroll.section", "i", -1);
+
+  gtk_widget_class_install_action (widget_class, "menu.popup", NULL, gtk_emoji_chooser_popup_menu);
+
+  gtk_widget_class_add_binding_action (widget_class,
+                                       GDK_KEY_F10, GDK_SHIFT_MASK,
+                                       "menu.popup",
+                                       NULL);
+  gtk_widget_class_add_binding_action (widget_class,
+                                       GDK_KEY_Menu, 0,
+                                       "menu.popup",
+                                       NULL);
 }
 
 /**
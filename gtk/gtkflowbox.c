@@ -47,6 +47,12 @@
  *
  * The children of a GtkFlowBox can be dynamically sorted and filtered.
  *
+ * A GtkFlowBox that is bound to a model with gtk_flow_box_bind_model()
+ * normally creates a child for every item in the model. For large models,
+ * the #GtkFlowBox:virtualized property can be set to only create children
+ * for the items that are in or near the visible part of the box. All
+ * children of a virtualized box get the same size.
+ *
  * Although a GtkFlowBox must have only #GtkFlowBoxChild children,
  * you can add any kind of widget to it via gtk_flow_box_insert(), and
  * a GtkFlowBoxChild widget will automatically be inserted between
@@ -96,6 +102,7 @@
 #include "gtkstylecontextprivate.h"
 #include "gtktypebuiltins.h"
 #include "gtkviewport.h"
+#include "gtkvirtualizerprivate.h"
 #include "gtkwidgetprivate.h"
 
 /* Forward declarations and utilities {{{1 */
@@ -127,6 +134,26 @@ static void gtk_flow_box_set_accept_unpaired_release (GtkFlowBox *box,
 
 static void gtk_flow_box_check_model_compat  (GtkFlowBox *box);
 
+static gboolean gtk_flow_box_is_virtual             (GtkFlowBox      *box);
+static void     gtk_flow_box_virtual_update         (GtkWidget       *widget,
+                                                     guint            start,
+                                                     guint            n_lines);
+static void     gtk_flow_box_realize_range          (GtkFlowBox      *box,
+                                                     guint            start,
+                                                     guint            end);
+static GtkFlowBoxChild *
+                gtk_flow_box_ensure_child           (GtkFlowBox      *box,
+                                                     guint            position);
+static void     gtk_flow_box_update_virtual_adjustment (GtkFlowBox   *box);
+static void     gtk_flow_box_virtual_measure        (GtkFlowBox      *box,
+                                                     GtkOrientation   orientation,
+                                                     int              for_size,
+                                                     int             *minimum,
+                                                     int             *natural);
+static void     gtk_flow_box_virtual_allocate       (GtkFlowBox      *box,
+                                                     int              width,
+                                                     int              height);
+
 static void
 path_from_horizontal_line_rects (cairo_t      *cr,
                                  GdkRectangle *lines,
@@ -264,6 +291,9 @@ struct _GtkFlowBoxChildPrivate
   GtkWidget     *child;
   GSequenceIter *iter;
   gboolean       selected;
+  /* The item in the model, for virtualized boxes */
+  guint          position;
+  gboolean       laid_out;
 };
 
 #define CHILD_PRIV(child) ((GtkFlowBoxChildPrivate*)gtk_flow_box_child_get_instance_private ((GtkFlowBoxChild*)(child)))
@@ -602,6 +632,9 @@ gtk_flow_box_child_get_child (GtkFlowBoxChild *self)
  *
  * Gets the current index of the @child in its #GtkFlowBox container.
  *
+ * If the flow box is virtualized, this is the position of the
+ * item of the child in the bound model.
+ *
  * Returns: the index of the @child, or -1 if the @child is not
  *     in a flow box.
  */
@@ -609,15 +642,20 @@ int
 gtk_flow_box_child_get_index (GtkFlowBoxChild *child)
 {
   GtkFlowBoxChildPrivate *priv;
+  GtkFlowBox *box;
 
   g_return_val_if_fail (GTK_IS_FLOW_BOX_CHILD (child), -1);
 
   priv = CHILD_PRIV (child);
 
-  if (priv->iter != NULL)
-    return g_sequence_iter_get_position (priv->iter);
+  if (priv->iter == NULL)
+    return -1;
+
+  box = gtk_flow_box_child_get_box (child);
+  if (box && gtk_flow_box_is_virtual (box))
+    return priv->position;
 
-  return -1;
+  return g_sequence_iter_get_position (priv->iter);
 }
 
 /**
@@ -709,6 +747,7 @@ enum {
   PROP_SELECTION_MODE,
   PROP_ACTIVATE_ON_SINGLE_CLICK,
   PROP_ACCEPT_UNPAIRED_RELEASE,
+  PROP_VIRTUALIZED,
 
   /* orientable */
   PROP_ORIENTATION,
@@ -793,6 +832,9 @@ struct _GtkFlowBoxPrivate {
   gpointer                    create_widget_func_data;
   GDestroyNotify              create_widget_func_data_destroy;
 
+  gboolean           virtualized;
+  GtkVirtualizer     virtualizer;
+
   gboolean           disable_move_cursor;
 };
 
@@ -955,7 +997,17 @@ static void
 gtk_flow_box_update_cursor (GtkFlowBox      *box,
                             GtkFlowBoxChild *child)
 {
-  BOX_PRIV (box)->cursor_child = child;
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  priv->cursor_child = child;
+
+  /* Children of a virtualized box that have just been created
+   * don't have a position yet, so move the box to them instead.
+   */
+  if (gtk_flow_box_is_virtual (box) && !CHILD_PRIV (child)->laid_out)
+    gtk_virtualizer_scroll_to (&priv->virtualizer,
+                               CHILD_PRIV (child)->position / MAX (1, priv->cur_children_per_line));
+
   gtk_widget_grab_focus (GTK_WIDGET (child));
 }
 
@@ -985,6 +1037,22 @@ gtk_flow_box_select_all_between (GtkFlowBox      *box,
 {
   GSequenceIter *iter, *iter1, *iter2;
 
+  if (gtk_flow_box_is_virtual (box))
+    {
+      guint start, end;
+
+      start = child1 ? CHILD_PRIV (child1)->position : 0;
+      end = child2 ? CHILD_PRIV (child2)->position + 1 : g_list_model_get_n_items (BOX_PRIV (box)->bound_model);
+      if (end <= start)
+        {
+          guint tmp = start + 1;
+          start = end - 1;
+          end = tmp;
+        }
+
+      gtk_flow_box_realize_range (box, start, end);
+    }
+
   if (child1)
     iter1 = CHILD_PRIV (child1)->iter;
   else
@@ -1526,6 +1594,12 @@ gtk_flow_box_size_allocate (GtkWidget *widget,
   int i, this_line_size;
   GSequenceIter *iter;
 
+  if (gtk_flow_box_is_virtual (box))
+    {
+      gtk_flow_box_virtual_allocate (box, width, height);
+      return;
+    }
+
   min_items = MAX (1, priv->min_children_per_line);
 
   if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
@@ -1961,6 +2035,12 @@ gtk_flow_box_measure (GtkWidget      *widget,
   GtkFlowBox *box = GTK_FLOW_BOX (widget);
   GtkFlowBoxPrivate *priv = BOX_PRIV (box);
 
+  if (gtk_flow_box_is_virtual (box))
+    {
+      gtk_flow_box_virtual_measure (box, orientation, for_size, minimum, natural);
+      return;
+    }
+
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
       if (for_size < 0)
@@ -3039,6 +3119,8 @@ gtk_flow_box_remove (GtkFlowBox *box,
     priv->active_child = NULL;
   if (child == priv->selected_child)
     priv->selected_child = NULL;
+  if (child == priv->cursor_child)
+    priv->cursor_child = NULL;
 
   g_sequence_remove (CHILD_PRIV (child)->iter);
   gtk_widget_unparent (GTK_WIDGET (child));
@@ -3069,6 +3151,17 @@ gtk_flow_box_focus (GtkWidget        *widget,
       if (gtk_widget_child_focus (focus_child, direction))
         return TRUE;
 
+      /* Make sure the neighbours of the focus child exist */
+      if (gtk_flow_box_is_virtual (box))
+        {
+          guint position = CHILD_PRIV (focus_child)->position;
+          guint line_length = MAX (1, BOX_PRIV (box)->cur_children_per_line);
+
+          gtk_flow_box_realize_range (box,
+                                      position - MIN (position, line_length),
+                                      position + line_length + 1);
+        }
+
       iter = CHILD_PRIV (focus_child)->iter;
 
       if (direction == GTK_DIR_LEFT || direction == GTK_DIR_TAB_BACKWARD)
@@ -3210,6 +3303,46 @@ gtk_flow_box_move_cursor (GtkFlowBox      *box,
          }
     }
 
+  /* In a virtualized box, create the children we might move to first.
+   * Pages are moved by the number of lines that fit on a page, since
+   * the children in between may not exist.
+   */
+  if (gtk_flow_box_is_virtual (box))
+    {
+      guint n_items = g_list_model_get_n_items (priv->bound_model);
+      guint line_length = MAX (1, priv->cur_children_per_line);
+
+      adjustment = vertical ? priv->hadjustment : priv->vadjustment;
+      if (step == GTK_MOVEMENT_PAGES && adjustment != NULL)
+        {
+          count *= MAX (1, (int) (gtk_adjustment_get_page_increment (adjustment) /
+                                  MAX (1, gtk_virtualizer_get_estimated_size (&priv->virtualizer))));
+          step = GTK_MOVEMENT_DISPLAY_LINES;
+        }
+
+      if (step == GTK_MOVEMENT_BUFFER_ENDS)
+        {
+          if (count < 0)
+            gtk_flow_box_realize_range (box, 0, GTK_VIRTUALIZER_EXTRA_LINES * line_length);
+          else
+            gtk_flow_box_realize_range (box,
+                                        n_items - MIN (n_items, GTK_VIRTUALIZER_EXTRA_LINES * line_length),
+                                        n_items);
+        }
+      else if (priv->cursor_child != NULL)
+        {
+          guint position = CHILD_PRIV (priv->cursor_child)->position;
+          guint distance = ABS (count);
+
+          if (step == GTK_MOVEMENT_DISPLAY_LINES)
+            distance *= line_length;
+
+          gtk_flow_box_realize_range (box,
+                                      position - MIN (position, distance),
+                                      position + distance + 1);
+        }
+    }
+
   child = NULL;
   switch ((guint) step)
     {
@@ -3416,6 +3549,9 @@ gtk_flow_box_get_property (GObject    *object,
     case PROP_ACCEPT_UNPAIRED_RELEASE:
       g_value_set_boolean (value, priv->accept_unpaired_release);
       break;
+    case PROP_VIRTUALIZED:
+      g_value_set_boolean (value, priv->virtualized);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3442,6 +3578,7 @@ gtk_flow_box_set_property (GObject      *object,
             priv->orientation = orientation;
 
             gtk_widget_update_orientation (GTK_WIDGET (box), priv->orientation);
+            gtk_flow_box_update_virtual_adjustment (box);
 
             /* Re-box the children in the new orientation */
             gtk_widget_queue_resize (GTK_WIDGET (box));
@@ -3473,6 +3610,9 @@ gtk_flow_box_set_property (GObject      *object,
     case PROP_ACCEPT_UNPAIRED_RELEASE:
       gtk_flow_box_set_accept_unpaired_release (box, g_value_get_boolean (value));
       break;
+    case PROP_VIRTUALIZED:
+      gtk_flow_box_set_virtualized (box, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3506,6 +3646,7 @@ gtk_flow_box_dispose (GObject *obj)
 
   g_clear_object (&priv->hadjustment);
   g_clear_object (&priv->vadjustment);
+  gtk_virtualizer_finish (&priv->virtualizer);
 
   if (priv->bound_model)
     {
@@ -3600,6 +3741,21 @@ gtk_flow_box_class_init (GtkFlowBoxClass *class)
                           FALSE,
                           GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkFlowBox:virtualized:
+   *
+   * Whether children are only created for the items of the bound
+   * model that are in or near the visible part of the box.
+   *
+   * See gtk_flow_box_set_virtualized().
+   */
+  props[PROP_VIRTUALIZED] =
+    g_param_spec_boolean ("virtualized",
+                          P_("Virtualized"),
+                          P_("Only create children for visible items of the model"),
+                          FALSE,
+                          GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkFlowBox:homogeneous:
    *
@@ -3891,6 +4047,7 @@ gtk_flow_box_init (GtkFlowBox *box)
   gtk_widget_update_orientation (GTK_WIDGET (box), priv->orientation);
 
   priv->children = g_sequence_new (NULL);
+  gtk_virtualizer_init (&priv->virtualizer, GTK_WIDGET (box), gtk_flow_box_virtual_update);
 
   gesture = gtk_gesture_click_new ();
   gtk_gesture_single_set_touch_only (GTK_GESTURE_SINGLE (gesture),
@@ -3930,6 +4087,505 @@ gtk_flow_box_init (GtkFlowBox *box)
   gtk_widget_add_controller (GTK_WIDGET (box), controller);
 }
 
+static GtkFlowBoxChild *
+gtk_flow_box_create_child (GtkFlowBox *box,
+                           guint       position,
+                           int         index)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GObject *item;
+  GtkWidget *widget;
+  GtkFlowBoxChild *child;
+
+  item = g_list_model_get_item (priv->bound_model, position);
+  widget = priv->create_widget_func (item, priv->create_widget_func_data);
+
+  /* We need to sink the floating reference here, so that we can accept
+   * both instances created with a floating reference (e.g. C functions
+   * that just return the result of g_object_new()) and without (e.g.
+   * from language bindings which will automatically sink the floating
+   * reference).
+   *
+   * See the similar code in gtklistbox.c:gtk_list_box_create_row.
+   */
+  if (g_object_is_floating (widget))
+    g_object_ref_sink (widget);
+
+  gtk_widget_show (widget);
+
+  if (GTK_IS_FLOW_BOX_CHILD (widget))
+    child = GTK_FLOW_BOX_CHILD (widget);
+  else
+    {
+      child = GTK_FLOW_BOX_CHILD (gtk_flow_box_child_new ());
+      gtk_flow_box_child_set_child (child, widget);
+    }
+
+  CHILD_PRIV (child)->position = position;
+  gtk_flow_box_insert (box, GTK_WIDGET (child), index);
+
+  g_object_unref (widget);
+  g_object_unref (item);
+
+  return child;
+}
+
+/* Virtualization {{{3 */
+
+/* A virtualized box lays out the children by the position of their
+ * item in the model, with all children having the same size, so that
+ * the line of an item is known without creating the children before it.
+ * The lines are handed to a #GtkVirtualizer, which decides which of
+ * them need children.
+ */
+
+static gboolean
+gtk_flow_box_is_virtual (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  return priv->virtualized && priv->bound_model != NULL;
+}
+
+static int
+child_position_cmp_func (gconstpointer a,
+                         gconstpointer b,
+                         gpointer      user_data)
+{
+  guint position = GPOINTER_TO_UINT (b);
+
+  /* Never report a match, so that searching finds the first child
+   * at or after the position.
+   */
+  if (CHILD_PRIV (a)->position < position)
+    return -1;
+
+  return 1;
+}
+
+/* Returns the first child of a virtualized box whose item is
+ * at or after @position.
+ */
+static GSequenceIter *
+gtk_flow_box_get_iter_at_position (GtkFlowBox *box,
+                                   guint       position)
+{
+  return g_sequence_search (BOX_PRIV (box)->children,
+                            GUINT_TO_POINTER (position),
+                            child_position_cmp_func,
+                            NULL);
+}
+
+static GtkFlowBoxChild *
+gtk_flow_box_ensure_child (GtkFlowBox *box,
+                           guint       position)
+{
+  GSequenceIter *iter;
+  GtkFlowBoxChild *child;
+
+  iter = gtk_flow_box_get_iter_at_position (box, position);
+  if (!g_sequence_iter_is_end (iter))
+    {
+      child = g_sequence_get (iter);
+      if (CHILD_PRIV (child)->position == position)
+        return child;
+    }
+
+  return gtk_flow_box_create_child (box, position, g_sequence_iter_get_position (iter));
+}
+
+static void
+gtk_flow_box_realize_range (GtkFlowBox *box,
+                            guint       start,
+                            guint       end)
+{
+  GSequenceIter *iter;
+  guint position;
+
+  end = MIN (end, g_list_model_get_n_items (BOX_PRIV (box)->bound_model));
+
+  iter = gtk_flow_box_get_iter_at_position (box, start);
+  for (position = start; position < end; position++)
+    {
+      if (!g_sequence_iter_is_end (iter) &&
+          CHILD_PRIV (g_sequence_get (iter))->position == position)
+        iter = g_sequence_iter_next (iter);
+      else
+        gtk_flow_box_create_child (box, position, g_sequence_iter_get_position (iter));
+    }
+}
+
+static guint
+gtk_flow_box_get_n_virtual_lines (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  guint line_length = MAX (1, priv->cur_children_per_line);
+
+  return (g_list_model_get_n_items (priv->bound_model) + line_length - 1) / line_length;
+}
+
+static void
+gtk_flow_box_virtual_update (GtkWidget *widget,
+                             guint      start,
+                             guint      n_lines)
+{
+  GtkFlowBox *box = GTK_FLOW_BOX (widget);
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *iter;
+  GtkWidget *focus_child;
+  guint line_length, end;
+
+  if (!gtk_flow_box_is_virtual (box))
+    return;
+
+  line_length = MAX (1, priv->cur_children_per_line);
+  end = (start + n_lines) * line_length;
+  start = start * line_length;
+
+  /* Children outside of the window are destroyed, unless they
+   * carry state that we would lose.
+   */
+  focus_child = gtk_widget_get_focus_child (widget);
+
+  iter = g_sequence_get_begin_iter (priv->children);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkFlowBoxChild *child = g_sequence_get (iter);
+      GtkFlowBoxChildPrivate *child_priv = CHILD_PRIV (child);
+
+      iter = g_sequence_iter_next (iter);
+
+      if (child_priv->position >= start && child_priv->position < end)
+        continue;
+
+      if (child_priv->selected ||
+          child == priv->cursor_child ||
+          child == priv->active_child ||
+          child == priv->selected_child ||
+          child == priv->rubberband_first ||
+          child == priv->rubberband_last ||
+          GTK_WIDGET (child) == focus_child)
+        continue;
+
+      gtk_flow_box_remove (box, GTK_WIDGET (child));
+    }
+
+  gtk_flow_box_realize_range (box, start, end);
+}
+
+/* The adjustment along the lines, which decides which lines are visible */
+static void
+gtk_flow_box_update_virtual_adjustment (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (!gtk_flow_box_is_virtual (box))
+    gtk_virtualizer_set_adjustment (&priv->virtualizer, NULL, FALSE);
+  else if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+    gtk_virtualizer_set_adjustment (&priv->virtualizer, priv->vadjustment, FALSE);
+  else
+    gtk_virtualizer_set_adjustment (&priv->virtualizer, priv->hadjustment,
+                                    gtk_widget_get_direction (GTK_WIDGET (box)) == GTK_TEXT_DIR_RTL);
+}
+
+/* Finds how many items fit on a line of @avail_size, or of the
+ * natural size if @avail_size is -1, like the homogeneous layout does.
+ */
+static guint
+gtk_flow_box_get_virtual_line_length (GtkFlowBox *box,
+                                      int         avail_size,
+                                      int        *item_size,
+                                      int        *line_size)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  int nat_item_size, item_spacing, min_items, line_length;
+
+  if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+    item_spacing = priv->column_spacing;
+  else
+    item_spacing = priv->row_spacing;
+
+  min_items = MAX (1, priv->min_children_per_line);
+
+  get_max_item_size (box, priv->orientation, NULL, &nat_item_size);
+  if (nat_item_size <= 0)
+    {
+      *item_size = 0;
+      *line_size = 0;
+      return MIN (min_items, priv->max_children_per_line);
+    }
+
+  if (avail_size < 0)
+    {
+      line_length = min_items;
+      *item_size = nat_item_size;
+    }
+  else
+    {
+      /* By default flow at the natural item width */
+      line_length = avail_size / (nat_item_size + item_spacing);
+
+      /* After the above aproximation, check if we cant fit one more on the line */
+      if (line_length * item_spacing + (line_length + 1) * nat_item_size <= avail_size)
+        line_length++;
+
+      line_length = MAX (min_items, line_length);
+      line_length = MIN (line_length, priv->max_children_per_line);
+
+      *item_size = (avail_size - (line_length - 1) * item_spacing) / line_length;
+
+      /* Cut out the expand space if we're not distributing any */
+      if (ORIENTATION_ALIGN (box) != GTK_ALIGN_FILL)
+        *item_size = MIN (*item_size, nat_item_size);
+    }
+
+  get_largest_size_for_opposing_orientation (box,
+                                             priv->orientation,
+                                             *item_size,
+                                             NULL,
+                                             line_size);
+
+  return line_length;
+}
+
+/* Collects the lines that have children for the virtualizer.
+ * A line includes the spacing after it.
+ */
+static GArray *
+gtk_flow_box_get_virtual_lines (GtkFlowBox *box,
+                                guint       line_length,
+                                int         line_size)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *iter;
+  GArray *lines;
+  int line_spacing;
+
+  if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+    line_spacing = priv->row_spacing;
+  else
+    line_spacing = priv->column_spacing;
+
+  lines = g_array_new (FALSE, FALSE, sizeof (GtkVirtualizerLine));
+
+  for (iter = g_sequence_get_begin_iter (priv->children);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      GtkVirtualizerLine line = { 0, line_size + line_spacing, 0 };
+
+      line.line = CHILD_PRIV (g_sequence_get (iter))->position / line_length;
+
+      if (lines->len > 0 &&
+          g_array_index (lines, GtkVirtualizerLine, lines->len - 1).line == line.line)
+        continue;
+
+      g_array_append_val (lines, line);
+    }
+
+  return lines;
+}
+
+static void
+gtk_flow_box_virtual_measure (GtkFlowBox     *box,
+                              GtkOrientation  orientation,
+                              int             for_size,
+                              int            *minimum,
+                              int            *natural)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (orientation == priv->orientation)
+    {
+      int min_item_size, nat_item_size;
+      int min_items, nat_items;
+      int item_spacing;
+
+      item_spacing = orientation == GTK_ORIENTATION_HORIZONTAL ? priv->column_spacing : priv->row_spacing;
+      min_items = MAX (1, priv->min_children_per_line);
+      nat_items = MAX (min_items, priv->max_children_per_line);
+
+      get_max_item_size (box, orientation, &min_item_size, &nat_item_size);
+
+      *minimum = min_item_size * min_items + (min_items - 1) * item_spacing;
+      *natural = nat_item_size * nat_items + (nat_items - 1) * item_spacing;
+    }
+  else
+    {
+      guint line_length, n_items;
+      int item_size, line_size, line_spacing, size;
+
+      line_spacing = orientation == GTK_ORIENTATION_HORIZONTAL ? priv->column_spacing : priv->row_spacing;
+      line_length = gtk_flow_box_get_virtual_line_length (box, for_size, &item_size, &line_size);
+
+      if (line_length == MAX (1, priv->cur_children_per_line))
+        {
+          GArray *lines;
+
+          lines = gtk_flow_box_get_virtual_lines (box, line_length, line_size);
+          size = gtk_virtualizer_measure (&priv->virtualizer,
+                                          (GtkVirtualizerLine *) lines->data,
+                                          lines->len);
+          g_array_unref (lines);
+        }
+      else
+        {
+          /* The virtualizer counts lines of a different length */
+          n_items = g_list_model_get_n_items (priv->bound_model);
+          size = (int) ((n_items + line_length - 1) / line_length) * (line_size + line_spacing);
+        }
+
+      /* No spacing after the last line */
+      *minimum = *natural = MAX (0, size - line_spacing);
+    }
+}
+
+static void
+gtk_flow_box_virtual_allocate (GtkFlowBox *box,
+                               int         width,
+                               int         height)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GtkAllocation child_allocation;
+  GtkAlign item_align;
+  GSequenceIter *iter;
+  GArray *lines;
+  guint line_length, i;
+  int avail_size, item_spacing;
+  int item_size, line_size, item_start, extra_pixels;
+
+  if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+    {
+      avail_size = width;
+      item_spacing = priv->column_spacing;
+    }
+  else /* GTK_ORIENTATION_VERTICAL */
+    {
+      avail_size = height;
+      item_spacing = priv->row_spacing;
+    }
+
+  /* The text direction may have changed */
+  gtk_flow_box_update_virtual_adjustment (box);
+
+  line_length = gtk_flow_box_get_virtual_line_length (box, avail_size, &item_size, &line_size);
+  if (line_length != MAX (1, priv->cur_children_per_line))
+    {
+      guint anchor;
+
+      /* Keep the first item of the anchor line in view */
+      anchor = gtk_virtualizer_get_anchor (&priv->virtualizer) * MAX (1, priv->cur_children_per_line);
+      priv->cur_children_per_line = line_length;
+      gtk_virtualizer_set_n_lines (&priv->virtualizer,
+                                   gtk_flow_box_get_n_virtual_lines (box),
+                                   anchor / line_length);
+    }
+
+  item_align = ORIENTATION_ALIGN (box);
+  extra_pixels = avail_size - ((int) line_length - 1) * item_spacing - item_size * (int) line_length;
+  if (item_align == GTK_ALIGN_CENTER || item_align == GTK_ALIGN_END)
+    item_start = get_offset_pixels (item_align, MAX (extra_pixels, 0));
+  else
+    item_start = 0;
+
+  lines = gtk_flow_box_get_virtual_lines (box, line_length, line_size);
+  gtk_virtualizer_allocate (&priv->virtualizer,
+                            (GtkVirtualizerLine *) lines->data,
+                            lines->len);
+
+  for (iter = g_sequence_get_begin_iter (priv->children), i = 0;
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      GtkFlowBoxChild *child = g_sequence_get (iter);
+      GtkFlowBoxChildPrivate *child_priv = CHILD_PRIV (child);
+      int item_offset, line_offset;
+
+      while (g_array_index (lines, GtkVirtualizerLine, i).line != child_priv->position / line_length)
+        i++;
+
+      child_priv->laid_out = TRUE;
+
+      if (!child_is_visible (GTK_WIDGET (child)))
+        continue;
+
+      item_offset = item_start + (int) (child_priv->position % line_length) * (item_size + item_spacing);
+      line_offset = g_array_index (lines, GtkVirtualizerLine, i).offset;
+
+      if (priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+        {
+          child_allocation.x = item_offset;
+          child_allocation.y = line_offset;
+          child_allocation.width = item_size;
+          child_allocation.height = line_size;
+        }
+      else /* GTK_ORIENTATION_VERTICAL */
+        {
+          child_allocation.x = line_offset;
+          child_allocation.y = item_offset;
+          child_allocation.width = line_size;
+          child_allocation.height = item_size;
+        }
+
+      if (gtk_widget_get_direction (GTK_WIDGET (box)) == GTK_TEXT_DIR_RTL)
+        child_allocation.x = width - child_allocation.x - child_allocation.width;
+
+      gtk_widget_size_allocate (GTK_WIDGET (child), &child_allocation, -1);
+    }
+
+  g_array_unref (lines);
+}
+
+static void
+gtk_flow_box_virtual_items_changed (GtkFlowBox *box,
+                                    guint       position,
+                                    guint       removed,
+                                    guint       added)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+  GSequenceIter *iter;
+  guint line_length, first_line, n_lines;
+
+  iter = gtk_flow_box_get_iter_at_position (box, position);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkFlowBoxChild *child = g_sequence_get (iter);
+
+      iter = g_sequence_iter_next (iter);
+
+      if (CHILD_PRIV (child)->position < position + removed)
+        {
+          if (child == priv->rubberband_first)
+            priv->rubberband_first = NULL;
+          if (child == priv->rubberband_last)
+            priv->rubberband_last = NULL;
+
+          gtk_flow_box_remove (box, GTK_WIDGET (child));
+        }
+      else
+        CHILD_PRIV (child)->position += added - removed;
+    }
+
+  /* The items after @position move to other lines. Keep the anchor
+   * on the line that was moved the same number of lines.
+   */
+  line_length = MAX (1, priv->cur_children_per_line);
+  first_line = position / line_length;
+  gtk_virtualizer_items_changed (&priv->virtualizer,
+                                 first_line,
+                                 (position + removed) / line_length - first_line,
+                                 (position + added) / line_length - first_line);
+
+  n_lines = gtk_flow_box_get_n_virtual_lines (box);
+  if (n_lines != priv->virtualizer.n_lines)
+    gtk_virtualizer_set_n_lines (&priv->virtualizer,
+                                 n_lines,
+                                 gtk_virtualizer_get_anchor (&priv->virtualizer));
+
+  gtk_virtualizer_update (&priv->virtualizer);
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+}
+
 static void
 gtk_flow_box_bound_model_changed (GListModel *list,
                                   guint       position,
@@ -3938,9 +4594,14 @@ gtk_flow_box_bound_model_changed (GListModel *list,
                                   gpointer    user_data)
 {
   GtkFlowBox *box = user_data;
-  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
   int i;
 
+  if (gtk_flow_box_is_virtual (box))
+    {
+      gtk_flow_box_virtual_items_changed (box, position, removed, added);
+      return;
+    }
+
   while (removed--)
     {
       GtkFlowBoxChild *child;
@@ -3950,30 +4611,32 @@ gtk_flow_box_bound_model_changed (GListModel *list,
     }
 
   for (i = 0; i < added; i++)
-    {
-      GObject *item;
-      GtkWidget *widget;
-
-      item = g_list_model_get_item (list, position + i);
-      widget = priv->create_widget_func (item, priv->create_widget_func_data);
-
-      /* We need to sink the floating reference here, so that we can accept
-       * both instances created with a floating reference (e.g. C functions
-       * that just return the result of g_object_new()) and without (e.g.
-       * from language bindings which will automatically sink the floating
-       * reference).
-       *
-       * See the similar code in gtklistbox.c:gtk_list_box_bound_model_changed.
-       */
-      if (g_object_is_floating (widget))
-        g_object_ref_sink (widget);
+    gtk_flow_box_create_child (box, position + i, position + i);
+}
+
+static void
+gtk_flow_box_remove_all_children (GtkFlowBox *box)
+{
+  GtkWidget *child;
 
-      gtk_widget_show (widget);
-      gtk_flow_box_insert (box, widget, position + i);
+  while ((child = gtk_widget_get_first_child (GTK_WIDGET (box))))
+    gtk_flow_box_remove (box, child);
+}
 
-      g_object_unref (widget);
-      g_object_unref (item);
+static void
+gtk_flow_box_add_bound_children (GtkFlowBox *box)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  if (gtk_flow_box_is_virtual (box))
+    {
+      gtk_virtualizer_reset (&priv->virtualizer, gtk_flow_box_get_n_virtual_lines (box));
+      gtk_virtualizer_update (&priv->virtualizer);
     }
+  else
+    gtk_flow_box_bound_model_changed (priv->bound_model,
+                                      0, 0, g_list_model_get_n_items (priv->bound_model),
+                                      box);
 }
 
 /* Buildable implemenation {{{3 */
@@ -4097,6 +4760,9 @@ gtk_flow_box_insert (GtkFlowBox *box,
  *
  * Gets the nth child in the @box.
  *
+ * If @box is virtualized, the child for the @idx'th item of the
+ * model is created if it doesn't exist yet.
+ *
  * Returns: (transfer none) (nullable): the child widget, which will
  *     always be a #GtkFlowBoxChild or %NULL in case no child widget
  *     with the given index exists.
@@ -4109,6 +4775,14 @@ gtk_flow_box_get_child_at_index (GtkFlowBox *box,
 
   g_return_val_if_fail (GTK_IS_FLOW_BOX (box), NULL);
 
+  if (gtk_flow_box_is_virtual (box))
+    {
+      if (idx < 0 || (guint) idx >= g_list_model_get_n_items (BOX_PRIV (box)->bound_model))
+        return NULL;
+
+      return gtk_flow_box_ensure_child (box, idx);
+    }
+
   iter = g_sequence_get_iter_at_pos (BOX_PRIV (box)->children, idx);
   if (!g_sequence_iter_is_end (iter))
     return g_sequence_get (iter);
@@ -4158,6 +4832,9 @@ gtk_flow_box_get_child_at_pos (GtkFlowBox *box,
  * The adjustments have to be in pixel units and in the same
  * coordinate system as the allocation for immediate children
  * of the box.
+ *
+ * For a virtualized vertical box, this adjustment decides
+ * which children are created, see gtk_flow_box_set_virtualized().
  */
 void
 gtk_flow_box_set_hadjustment (GtkFlowBox    *box,
@@ -4174,6 +4851,8 @@ gtk_flow_box_set_hadjustment (GtkFlowBox    *box,
   if (priv->hadjustment)
     g_object_unref (priv->hadjustment);
   priv->hadjustment = adjustment;
+
+  gtk_flow_box_update_virtual_adjustment (box);
 }
 
 /**
@@ -4192,6 +4871,9 @@ gtk_flow_box_set_hadjustment (GtkFlowBox    *box,
  * The adjustments have to be in pixel units and in the same
  * coordinate system as the allocation for immediate children
  * of the box.
+ *
+ * For a virtualized horizontal box, this adjustment decides
+ * which children are created, see gtk_flow_box_set_virtualized().
  */
 void
 gtk_flow_box_set_vadjustment (GtkFlowBox    *box,
@@ -4208,6 +4890,8 @@ gtk_flow_box_set_vadjustment (GtkFlowBox    *box,
   if (priv->vadjustment)
     g_object_unref (priv->vadjustment);
   priv->vadjustment = adjustment;
+
+  gtk_flow_box_update_virtual_adjustment (box);
 }
 
 static void
@@ -4244,6 +4928,9 @@ gtk_flow_box_check_model_compat (GtkFlowBox *box)
  * Note that using a model is incompatible with the filtering and sorting
  * functionality in GtkFlowBox. When using a model, filtering and sorting
  * should be implemented by the model.
+ *
+ * For large models, see gtk_flow_box_set_virtualized() to only create
+ * widgets for the items that are visible.
  */
 void
 gtk_flow_box_bind_model (GtkFlowBox                 *box,
@@ -4253,7 +4940,6 @@ gtk_flow_box_bind_model (GtkFlowBox                 *box,
                          GDestroyNotify              user_data_free_func)
 {
   GtkFlowBoxPrivate *priv = BOX_PRIV (box);
-  GtkWidget *child;
 
   g_return_if_fail (GTK_IS_FLOW_BOX (box));
   g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
@@ -4266,10 +4952,10 @@ gtk_flow_box_bind_model (GtkFlowBox                 *box,
 
       g_signal_handlers_disconnect_by_func (priv->bound_model, gtk_flow_box_bound_model_changed, box);
       g_clear_object (&priv->bound_model);
+      gtk_flow_box_update_virtual_adjustment (box);
     }
 
-  while ((child = gtk_widget_get_first_child (GTK_WIDGET (box))))
-    gtk_flow_box_remove (box, child);
+  gtk_flow_box_remove_all_children (box);
 
   if (model == NULL)
     return;
@@ -4282,7 +4968,77 @@ gtk_flow_box_bind_model (GtkFlowBox                 *box,
   gtk_flow_box_check_model_compat (box);
 
   g_signal_connect (priv->bound_model, "items-changed", G_CALLBACK (gtk_flow_box_bound_model_changed), box);
-  gtk_flow_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+  gtk_flow_box_update_virtual_adjustment (box);
+  gtk_flow_box_add_bound_children (box);
+}
+
+/**
+ * gtk_flow_box_set_virtualized:
+ * @box: a #GtkFlowBox
+ * @virtualized: %TRUE to only create children for visible items
+ *
+ * Sets whether @box only creates children for the items of the model
+ * bound with gtk_flow_box_bind_model() that are in or near the visible
+ * part of the box.
+ *
+ * This only has an effect if @box is bound to a model and given the
+ * adjustment of its #GtkScrolledWindow along the lines, that is the
+ * vertical adjustment for horizontal boxes and the horizontal one for
+ * vertical boxes, with gtk_flow_box_set_vadjustment() or
+ * gtk_flow_box_set_hadjustment(). Children are destroyed once they are
+ * scrolled out of view, unless they are selected, focused or the cursor
+ * child, and created again when they come back into view.
+ *
+ * A virtualized box gives all children the same size, as if
+ * #GtkFlowBox:homogeneous was set.
+ *
+ * Functions that look at the children of @box, like
+ * gtk_flow_box_get_selected_children(), only see the children that
+ * exist. gtk_flow_box_get_child_at_index() creates the child if needed,
+ * and gtk_flow_box_child_get_index() returns the position of the item
+ * in the model.
+ */
+void
+gtk_flow_box_set_virtualized (GtkFlowBox *box,
+                              gboolean    virtualized)
+{
+  GtkFlowBoxPrivate *priv = BOX_PRIV (box);
+
+  g_return_if_fail (GTK_IS_FLOW_BOX (box));
+
+  virtualized = virtualized != FALSE;
+
+  if (priv->virtualized == virtualized)
+    return;
+
+  priv->virtualized = virtualized;
+  gtk_flow_box_update_virtual_adjustment (box);
+
+  if (priv->bound_model)
+    {
+      gtk_flow_box_remove_all_children (box);
+      gtk_flow_box_add_bound_children (box);
+    }
+
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+  g_object_notify_by_pspec (G_OBJECT (box), props[PROP_VIRTUALIZED]);
+}
+
+/**
+ * gtk_flow_box_get_virtualized:
+ * @box: a #GtkFlowBox
+ *
+ * Returns whether @box only creates children for the visible
+ * items of its model.
+ *
+ * Returns: %TRUE if @box is virtualized
+ */
+gboolean
+gtk_flow_box_get_virtualized (GtkFlowBox *box)
+{
+  g_return_val_if_fail (GTK_IS_FLOW_BOX (box), FALSE);
+
+  return BOX_PRIV (box)->virtualized;
 }
 
 /* Setters and getters {{{2 */
@@ -4618,6 +5374,9 @@ gtk_flow_box_unselect_child (GtkFlowBox      *box,
  *
  * Select all children of @box, if the selection
  * mode allows it.
+ *
+ * If @box is virtualized, this creates children for all
+ * items of the model.
  */
 void
 gtk_flow_box_select_all (GtkFlowBox *box)
@@ -4627,6 +5386,9 @@ gtk_flow_box_select_all (GtkFlowBox *box)
   if (BOX_PRIV (box)->selection_mode != GTK_SELECTION_MULTIPLE)
     return;
 
+  if (gtk_flow_box_is_virtual (box))
+    gtk_flow_box_realize_range (box, 0, g_list_model_get_n_items (BOX_PRIV (box)->bound_model));
+
   if (g_sequence_get_length (BOX_PRIV (box)->children) > 0)
     {
       gtk_flow_box_select_all_between (box, NULL, NULL, FALSE);
@@ -108,6 +108,12 @@ void                  gtk_flow_box_bind_model                (GtkFlowBox
                                                               gpointer                    user_data,
                                                               GDestroyNotify              user_data_free_func);
 
+GDK_AVAILABLE_IN_ALL
+void                  gtk_flow_box_set_virtualized           (GtkFlowBox           *box,
+                                                              gboolean              virtualized);
+GDK_AVAILABLE_IN_ALL
+gboolean              gtk_flow_box_get_virtualized           (GtkFlowBox           *box);
+
 GDK_AVAILABLE_IN_ALL
 void                  gtk_flow_box_set_homogeneous           (GtkFlowBox           *box,
                                                               gboolean              homogeneous);
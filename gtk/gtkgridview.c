@@ -701,6 +701,8 @@ gtk_grid_view_measure (GtkWidget      *widget,
 {
   GtkGridView *self = GTK_GRID_VIEW (widget);
 
+  gtk_list_item_manager_prepare_items (self->item_manager);
+
   if (orientation == gtk_list_base_get_orientation (GTK_LIST_BASE (self)))
     gtk_grid_view_measure_list (widget, for_size, minimum, natural);
   else
@@ -756,6 +758,8 @@ gtk_grid_view_size_allocate (GtkWidget *widget,
   if (gtk_list_item_manager_get_root (self->item_manager) == NULL)
     return;
 
+  gtk_list_item_manager_prepare_items (self->item_manager);
+
   /* step 1: determine width of the list */
   gtk_grid_view_measure_column_size (self, &col_min, &col_nat);
   self->n_columns = gtk_grid_view_compute_n_columns (self, 
@@ -33,6 +33,7 @@
 #include "gtkprivate.h"
 #include "gtkscalerprivate.h"
 #include "gtksnapshot.h"
+#include "gtktextureloaderprivate.h"
 #include "gtktypebuiltins.h"
 #include "gtkwidgetprivate.h"
 
@@ -91,6 +92,9 @@ struct _GtkImage
 
   char *filename;
   char *resource_path;
+
+  GCancellable *cancellable;
+  gboolean load_async;
 };
 
 struct _GtkImageClass
@@ -137,6 +141,7 @@ enum
   PROP_GICON,
   PROP_RESOURCE,
   PROP_USE_FALLBACK,
+  PROP_LOAD_ASYNC,
   NUM_PROPERTIES
 };
 
@@ -262,6 +267,20 @@ gtk_image_class_init (GtkImageClass *class)
                             FALSE,
                             GTK_PARAM_READWRITE|G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkImage:load-async:
+   *
+   * Whether files and resources are loaded in the background.
+   * While they are loading, the image shows the “image-loading”
+   * icon.
+   */
+  image_props[PROP_LOAD_ASYNC] =
+      g_param_spec_boolean ("load-async",
+                            P_("Load async"),
+                            P_("Load files in the background"),
+                            FALSE,
+                            GTK_PARAM_READWRITE|G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, image_props);
 
   gtk_widget_class_set_css_name (widget_class, I_("image"));
@@ -331,6 +350,10 @@ gtk_image_set_property (GObject      *object,
         g_object_notify_by_pspec (object, pspec);
       break;
 
+    case PROP_LOAD_ASYNC:
+      gtk_image_set_load_async (image, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -374,6 +397,9 @@ gtk_image_get_property (GObject     *object,
     case PROP_STORAGE_TYPE:
       g_value_set_enum (value, _gtk_icon_helper_get_storage_type (image->icon_helper));
       break;
+    case PROP_LOAD_ASYNC:
+      g_value_set_boolean (value, image->load_async);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -643,6 +669,71 @@ load_scalable_with_loader (GtkImage    *image,
   return animation;
 }
 
+static void
+load_done (GObject      *source,
+           GAsyncResult *result,
+           gpointer      data)
+{
+  GtkImage *image = data;
+  GdkPaintable *paintable;
+  GError *error = NULL;
+  char *filename, *resource_path;
+
+  paintable = gtk_texture_loader_load_finish (result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
+
+  g_clear_object (&image->cancellable);
+  g_clear_error (&error);
+
+  g_object_freeze_notify (G_OBJECT (image));
+
+  /* Still the same file, so don't let gtk_image_clear() drop it */
+  filename = g_steal_pointer (&image->filename);
+  resource_path = g_steal_pointer (&image->resource_path);
+
+  if (paintable)
+    gtk_image_set_from_paintable (image, paintable);
+  else
+    gtk_image_set_from_icon_name (image, "image-missing");
+
+  image->filename = filename;
+  image->resource_path = resource_path;
+
+  g_object_thaw_notify (G_OBJECT (image));
+
+  g_clear_object (&paintable);
+}
+
+/* Shows @file if it was loaded recently and otherwise starts
+ * loading it, with a placeholder in the meantime.
+ */
+static void
+gtk_image_load_async (GtkImage *image,
+                      GFile    *file)
+{
+  GdkPaintable *paintable;
+  int scale_factor;
+
+  scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (image));
+
+  paintable = gtk_texture_loader_lookup (file, scale_factor);
+  if (paintable)
+    {
+      gtk_image_set_from_paintable (image, paintable);
+      g_object_unref (paintable);
+      return;
+    }
+
+  gtk_image_set_from_icon_name (image, "image-loading");
+
+  image->cancellable = g_cancellable_new ();
+  gtk_texture_loader_load_async (file, scale_factor, image->cancellable, load_done, image);
+}
+
 /**
  * gtk_image_set_from_file:
  * @image: a #GtkImage
@@ -672,6 +763,18 @@ gtk_image_set_from_file   (GtkImage    *image,
       return;
     }
 
+  if (image->load_async)
+    {
+      GFile *file = g_file_new_for_path (filename);
+
+      gtk_image_load_async (image, file);
+      image->filename = g_strdup (filename);
+
+      g_object_unref (file);
+      g_object_thaw_notify (G_OBJECT (image));
+      return;
+    }
+
   anim = load_scalable_with_loader (image, filename, NULL, &scale_factor);
 
   if (anim == NULL)
@@ -758,6 +861,26 @@ gtk_image_set_from_resource (GtkImage    *image,
       g_warning ("GdkPixdata format images are not supported, remove the \"to-pixdata\" option from your GResource files");
       animation = NULL;
     }
+  else if (image->load_async)
+    {
+      char *uri, *escaped;
+      GFile *file;
+
+      escaped = g_uri_escape_string (resource_path,
+                                     G_URI_RESERVED_CHARS_ALLOWED_IN_PATH, FALSE);
+      uri = g_strconcat ("resource://", escaped, NULL);
+      file = g_file_new_for_uri (uri);
+
+      gtk_image_load_async (image, file);
+      image->resource_path = g_strdup (resource_path);
+      g_object_notify_by_pspec (G_OBJECT (image), image_props[PROP_RESOURCE]);
+
+      g_object_unref (file);
+      g_free (uri);
+      g_free (escaped);
+      g_object_thaw_notify (G_OBJECT (image));
+      return;
+    }
   else
     {
       animation = load_scalable_with_loader (image, NULL, resource_path, &scale_factor);
@@ -1186,6 +1309,12 @@ gtk_image_clear (GtkImage *image)
 {
   GtkImageType storage_type;
 
+  if (image->cancellable)
+    {
+      g_cancellable_cancel (image->cancellable);
+      g_clear_object (&image->cancellable);
+    }
+
   g_object_freeze_notify (G_OBJECT (image));
   storage_type = gtk_image_get_storage_type (image);
 
@@ -1356,6 +1485,49 @@ gtk_image_get_icon_size (GtkImage *image)
   return image->icon_size;
 }
 
+/**
+ * gtk_image_set_load_async:
+ * @image: a #GtkImage
+ * @load_async: whether to load files in the background
+ *
+ * If set to %TRUE, gtk_image_set_from_file() and
+ * gtk_image_set_from_resource() load the image in the background
+ * and show the “image-loading” icon until that is done.
+ *
+ * Images that were loaded in the background recently are shown
+ * right away.
+ */
+void
+gtk_image_set_load_async (GtkImage *image,
+                          gboolean  load_async)
+{
+  g_return_if_fail (GTK_IS_IMAGE (image));
+
+  load_async = !!load_async;
+
+  if (image->load_async == load_async)
+    return;
+
+  image->load_async = load_async;
+  g_object_notify_by_pspec (G_OBJECT (image), image_props[PROP_LOAD_ASYNC]);
+}
+
+/**
+ * gtk_image_get_load_async:
+ * @image: a #GtkImage
+ *
+ * Returns whether @image loads files in the background.
+ *
+ * Returns: %TRUE if files are loaded in the background
+ **/
+gboolean
+gtk_image_get_load_async (GtkImage *image)
+{
+  g_return_val_if_fail (GTK_IS_IMAGE (image), FALSE);
+
+  return image->load_async;
+}
+
 void
 gtk_image_get_image_size (GtkImage *image,
                           int      *width,
@@ -46,6 +46,7 @@
 #include "gtkshortcutcontroller.h"
 #include "gtkshortcuttrigger.h"
 #include "gtkshow.h"
+#include "gtksizerequestcacheprivate.h"
 #include "gtksnapshot.h"
 #include "gtkstylecontextprivate.h"
 #include "gtktextutil.h"
@@ -60,6 +61,7 @@
 #include "gtkcsscolorvalueprivate.h"
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 /**
@@ -283,6 +285,9 @@ struct _GtkLabel
   guint    single_line_mode   : 1;
   guint    in_click           : 1;
   guint    track_links        : 1;
+  guint    layout_prepared    : 1;
+
+  guint    layout_serial;
 
   guint    mnemonic_keyval;
 
@@ -2762,6 +2767,7 @@ static void
 gtk_label_clear_layout (GtkLabel *self)
 {
   g_clear_object (&self->layout);
+  self->layout_prepared = FALSE;
 }
 
 /**
@@ -2911,17 +2917,17 @@ gtk_label_update_layout_attributes (GtkLabel      *self,
 }
 
 static void
-gtk_label_ensure_layout (GtkLabel *self)
+gtk_label_create_layout (GtkLabel     *self,
+                         PangoContext *context)
 {
   PangoAlignment align;
   gboolean rtl;
 
-  if (self->layout)
-    return;
-
   align = PANGO_ALIGN_LEFT; /* Quiet gcc */
   rtl = _gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL;
-  self->layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), self->text);
+  self->layout = pango_layout_new (context);
+  if (self->text)
+    pango_layout_set_text (self->layout, self->text, -1);
 
   gtk_label_update_layout_attributes (self, NULL);
 
@@ -2955,6 +2961,250 @@ gtk_label_ensure_layout (GtkLabel *self)
     pango_layout_set_width (self->layout, gtk_widget_get_width (GTK_WIDGET (self)) * PANGO_SCALE);
 }
 
+static void
+gtk_label_ensure_layout (GtkLabel *self)
+{
+  GtkWidget *widget = GTK_WIDGET (self);
+
+  if (self->layout)
+    {
+      /* A prepared layout has its own context, so it doesn't see
+       * changes to ours. Drop it when ours changed.
+       */
+      if (!self->layout_prepared ||
+          self->layout_serial == pango_context_get_serial (gtk_widget_get_pango_context (widget)))
+        return;
+
+      gtk_label_clear_layout (self);
+    }
+
+  gtk_label_create_layout (self, gtk_widget_get_pango_context (widget));
+}
+
+/* Shaping layouts on worker threads
+ *
+ * Pango font maps must not be used by several threads at the same
+ * time, so every worker shapes with its own font map. The layouts it
+ * creates keep using that font map once they are installed in their
+ * labels. That is fine because the workers only run while the main
+ * thread waits for them in gtk_label_prepare_layouts().
+ */
+
+#define MAX_SHAPING_THREADS 8
+#define MIN_LABELS_PER_THREAD 8
+
+typedef struct {
+  PangoFontMap *font_maps[MAX_SHAPING_THREADS];
+  guint font_map_serial;
+  GThreadPool *pool;
+
+  GMutex mutex;
+  GCond cond;
+  guint n_pending;
+} LabelShaping;
+
+typedef struct {
+  LabelShaping *shaping;
+  GtkLabel **labels;
+  guint n_labels;
+} LabelShapingJob;
+
+static guint
+shaping_threads (void)
+{
+  static int n_threads = -1;
+
+  if (G_UNLIKELY (n_threads < 0))
+    {
+      const char *env = g_getenv ("GTK_SHAPING_THREADS");
+
+      n_threads = env ? CLAMP (atoi (env), 0, MAX_SHAPING_THREADS) : 0;
+    }
+
+  return n_threads;
+}
+
+static void
+shape_labels (LabelShapingJob *job)
+{
+  PangoRectangle rect;
+  guint i;
+
+  for (i = 0; i < job->n_labels; i++)
+    pango_layout_get_extents (job->labels[i]->layout, NULL, &rect);
+}
+
+static void
+shape_labels_thread (gpointer data,
+                     gpointer user_data)
+{
+  LabelShapingJob *job = data;
+  LabelShaping *shaping = job->shaping;
+
+  shape_labels (job);
+
+  g_mutex_lock (&shaping->mutex);
+  shaping->n_pending--;
+  if (shaping->n_pending == 0)
+    g_cond_signal (&shaping->cond);
+  g_mutex_unlock (&shaping->mutex);
+}
+
+static LabelShaping *
+get_label_shaping (void)
+{
+  static LabelShaping *shaping;
+  PangoFontMap *default_map;
+  guint i;
+
+  if (G_UNLIKELY (shaping == NULL))
+    {
+      shaping = g_new0 (LabelShaping, 1);
+      g_mutex_init (&shaping->mutex);
+      g_cond_init (&shaping->cond);
+      shaping->pool = g_thread_pool_new (shape_labels_thread, NULL,
+                                         shaping_threads () - 1, FALSE, NULL);
+    }
+
+  /* Font configuration changes only reach the default font map, so
+   * start over with fresh font maps when it changed.
+   */
+  default_map = pango_cairo_font_map_get_default ();
+  if (shaping->font_map_serial != pango_font_map_get_serial (default_map))
+    {
+      for (i = 0; i < MAX_SHAPING_THREADS; i++)
+        g_clear_object (&shaping->font_maps[i]);
+
+      shaping->font_map_serial = pango_font_map_get_serial (default_map);
+    }
+
+  return shaping;
+}
+
+static PangoContext *
+copy_pango_context (PangoContext *context,
+                    PangoFontMap *font_map)
+{
+  PangoContext *copy;
+
+  copy = pango_font_map_create_context (font_map);
+  pango_context_set_font_description (copy, pango_context_get_font_description (context));
+  pango_context_set_language (copy, pango_context_get_language (context));
+  pango_context_set_base_dir (copy, pango_context_get_base_dir (context));
+  pango_context_set_base_gravity (copy, pango_context_get_base_gravity (context));
+  pango_context_set_gravity_hint (copy, pango_context_get_gravity_hint (context));
+  pango_context_set_matrix (copy, pango_context_get_matrix (context));
+  pango_context_set_round_glyph_positions (copy, pango_context_get_round_glyph_positions (context));
+  pango_cairo_context_set_resolution (copy, pango_cairo_context_get_resolution (context));
+  pango_cairo_context_set_font_options (copy, pango_cairo_context_get_font_options (context));
+
+  return copy;
+}
+
+/*< private >
+ * gtk_label_needs_layout:
+ * @self: a #GtkLabel
+ *
+ * Checks whether @self would have to create and shape a layout
+ * when it is measured next, and whether gtk_label_prepare_layouts()
+ * can do that for it.
+ *
+ * Returns: %TRUE if @self should be passed to gtk_label_prepare_layouts()
+ */
+gboolean
+gtk_label_needs_layout (GtkLabel *self)
+{
+  PangoContext *context;
+
+  g_return_val_if_fail (GTK_IS_LABEL (self), FALSE);
+
+  if (shaping_threads () < 2)
+    return FALSE;
+
+  /* Wrapping labels throw away their layout for height-for-width */
+  if (self->layout != NULL || self->wrap ||
+      self->text == NULL || self->text[0] == '\0' ||
+      !gtk_widget_get_visible (GTK_WIDGET (self)))
+    return FALSE;
+
+  context = gtk_widget_get_pango_context (GTK_WIDGET (self));
+
+  return pango_context_get_font_map (context) == pango_cairo_font_map_get_default ();
+}
+
+/*< private >
+ * gtk_label_prepare_layouts:
+ * @labels: (array length=n_labels): labels for which
+ *   gtk_label_needs_layout() returned %TRUE
+ * @n_labels: the number of labels
+ *
+ * Creates the layouts of @labels and shapes them on worker threads,
+ * so the labels don't need to do it one after another when they are
+ * measured.
+ *
+ * If this isn't called, labels shape their layout when they need it.
+ * Setting `GTK_SHAPING_THREADS` to the number of threads to use enables
+ * this.
+ */
+void
+gtk_label_prepare_layouts (GtkLabel **labels,
+                           guint      n_labels)
+{
+  LabelShaping *shaping;
+  LabelShapingJob *jobs;
+  guint i, n_jobs, start;
+
+  n_jobs = MIN (shaping_threads (), n_labels / MIN_LABELS_PER_THREAD);
+  if (n_jobs < 2)
+    return;
+
+  shaping = get_label_shaping ();
+  jobs = g_newa (LabelShapingJob, n_jobs);
+
+  for (i = 0, start = 0; i < n_jobs; i++)
+    {
+      guint j, end = (guint64) n_labels * (i + 1) / n_jobs;
+
+      if (shaping->font_maps[i] == NULL)
+        shaping->font_maps[i] = pango_cairo_font_map_new ();
+
+      for (j = start; j < end; j++)
+        {
+          GtkLabel *self = labels[j];
+          PangoContext *context, *copy;
+
+          context = gtk_widget_get_pango_context (GTK_WIDGET (self));
+          copy = copy_pango_context (context, shaping->font_maps[i]);
+
+          gtk_label_create_layout (self, copy);
+          /* Measuring starts with an unlimited width */
+          if (gtk_widget_get_width (GTK_WIDGET (self)) <= 1)
+            pango_layout_set_width (self->layout, -1);
+          self->layout_prepared = TRUE;
+          self->layout_serial = pango_context_get_serial (context);
+
+          g_object_unref (copy);
+        }
+
+      jobs[i].shaping = shaping;
+      jobs[i].labels = labels + start;
+      jobs[i].n_labels = end - start;
+      start = end;
+    }
+
+  shaping->n_pending = n_jobs - 1;
+  for (i = 1; i < n_jobs; i++)
+    g_thread_pool_push (shaping->pool, &jobs[i], NULL);
+
+  /* Do our share while we wait */
+  shape_labels (&jobs[0]);
+
+  g_mutex_lock (&shaping->mutex);
+  while (shaping->n_pending > 0)
+    g_cond_wait (&shaping->cond, &shaping->mutex);
+  g_mutex_unlock (&shaping->mutex);
+}
+
 static GtkSizeRequestMode
 gtk_label_get_request_mode (GtkWidget *widget)
 {
@@ -3150,6 +3400,235 @@ gtk_label_get_preferred_size (GtkWidget      *widget,
     }
 }
 
+/* Shared measurements
+ *
+ * Lists often contain many labels with the same text and style, and
+ * every one of them lays out its text to find its size. If
+ * GTK_SHARED_SIZE_CACHE is set, labels remember their measurements in
+ * a cache that is shared with all labels that have the same style,
+ * text, attributes and layout properties, so only the first of them
+ * needs to measure.
+ *
+ * The cache holds references on the styles, so it is bounded, and
+ * we simply drop it when it is full.
+ */
+#define MAX_SHARED_MEASUREMENTS 1024
+
+typedef struct {
+  GtkCssStyle *style;
+  GdkDisplay *display;
+  PangoFontMap *font_map;
+  cairo_font_options_t *font_options;
+  char *text;
+  PangoAttrList *attrs;
+  PangoAttrList *markup_attrs;
+  guint flags;
+  int scale;
+  int width_chars;
+  int max_width_chars;
+  int lines;
+  int for_size;
+  guint hash;
+} SharedMeasureKey;
+
+typedef struct {
+  SharedMeasureKey key;
+
+  int minimum;
+  int natural;
+  int minimum_baseline;
+  int natural_baseline;
+} SharedMeasure;
+
+static GHashTable *shared_measurements;
+
+static gboolean
+shared_measurements_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_getenv ("GTK_SHARED_SIZE_CACHE") != NULL;
+
+  return enabled;
+}
+
+static gboolean
+attr_lists_equal (PangoAttrList *a,
+                  PangoAttrList *b)
+{
+  GSList *la, *lb, *l, *m;
+  gboolean equal = TRUE;
+
+  if (a == b)
+    return TRUE;
+
+  if (a == NULL || b == NULL)
+    return FALSE;
+
+  la = pango_attr_list_get_attributes (a);
+  lb = pango_attr_list_get_attributes (b);
+
+  for (l = la, m = lb; l && m; l = l->next, m = m->next)
+    {
+      PangoAttribute *attr_a = l->data;
+      PangoAttribute *attr_b = m->data;
+
+      if (attr_a->start_index != attr_b->start_index ||
+          attr_a->end_index != attr_b->end_index ||
+          !pango_attribute_equal (attr_a, attr_b))
+        {
+          equal = FALSE;
+          break;
+        }
+    }
+
+  if (l != NULL || m != NULL)
+    equal = FALSE;
+
+  g_slist_free_full (la, (GDestroyNotify) pango_attribute_destroy);
+  g_slist_free_full (lb, (GDestroyNotify) pango_attribute_destroy);
+
+  return equal;
+}
+
+static gboolean
+font_options_equal (const cairo_font_options_t *a,
+                    const cairo_font_options_t *b)
+{
+  if (a == b)
+    return TRUE;
+
+  if (a == NULL || b == NULL)
+    return FALSE;
+
+  return cairo_font_options_equal (a, b);
+}
+
+static guint
+shared_measure_key_hash (gconstpointer data)
+{
+  const SharedMeasureKey *key = data;
+
+  return key->hash;
+}
+
+static gboolean
+shared_measure_key_equal (gconstpointer a,
+                          gconstpointer b)
+{
+  const SharedMeasureKey *ka = a;
+  const SharedMeasureKey *kb = b;
+
+  return ka->hash == kb->hash &&
+         ka->style == kb->style &&
+         ka->display == kb->display &&
+         ka->font_map == kb->font_map &&
+         ka->flags == kb->flags &&
+         ka->scale == kb->scale &&
+         ka->width_chars == kb->width_chars &&
+         ka->max_width_chars == kb->max_width_chars &&
+         ka->lines == kb->lines &&
+         ka->for_size == kb->for_size &&
+         font_options_equal (ka->font_options, kb->font_options) &&
+         strcmp (ka->text, kb->text) == 0 &&
+         attr_lists_equal (ka->attrs, kb->attrs) &&
+         attr_lists_equal (ka->markup_attrs, kb->markup_attrs);
+}
+
+static void
+shared_measure_free (gpointer data)
+{
+  SharedMeasure *measure = data;
+
+  g_object_unref (measure->key.style);
+  g_object_unref (measure->key.display);
+  g_object_unref (measure->key.font_map);
+  g_clear_pointer (&measure->key.font_options, cairo_font_options_destroy);
+  g_free (measure->key.text);
+  g_clear_pointer (&measure->key.attrs, pango_attr_list_unref);
+  g_clear_pointer (&measure->key.markup_attrs, pango_attr_list_unref);
+  g_free (measure);
+}
+
+/* The key does not own its members, see shared_measure_insert().
+ *
+ * The font map and font options are taken from the widget's
+ * pango context, so they include what was set on the label or
+ * inherited from its parents, and the settings.
+ */
+static void
+shared_measure_key_init (SharedMeasureKey *key,
+                         GtkLabel         *self,
+                         GtkOrientation    orientation,
+                         int               for_size)
+{
+  GtkWidget *widget = GTK_WIDGET (self);
+  PangoContext *context = gtk_widget_get_pango_context (widget);
+
+  key->style = gtk_css_node_get_style (gtk_widget_get_css_node (widget));
+  key->display = gtk_widget_get_display (widget);
+  key->font_map = pango_context_get_font_map (context);
+  key->font_options = (cairo_font_options_t *) pango_cairo_context_get_font_options (context);
+  key->text = self->text;
+  key->attrs = self->attrs;
+  key->markup_attrs = self->markup_attrs;
+  key->flags = orientation |
+               self->jtype << 1 |
+               self->wrap << 3 |
+               self->ellipsize << 4 |
+               self->wrap_mode << 7 |
+               self->single_line_mode << 10 |
+               self->mnemonics_visible << 11 |
+               _gtk_widget_get_direction (widget) << 12;
+  key->scale = gtk_widget_get_scale_factor (widget);
+  key->width_chars = self->width_chars;
+  key->max_width_chars = self->max_width_chars;
+  key->lines = self->lines;
+  key->for_size = for_size;
+
+  key->hash = g_str_hash (key->text) ^
+              g_direct_hash (key->style) ^
+              g_direct_hash (key->font_map) ^
+              (key->font_options ? (guint) cairo_font_options_hash (key->font_options) : 0) ^
+              (key->flags << 16) ^
+              (guint) for_size;
+}
+
+static void
+shared_measure_insert (const SharedMeasureKey *key,
+                       int                     minimum,
+                       int                     natural,
+                       int                     minimum_baseline,
+                       int                     natural_baseline)
+{
+  SharedMeasure *measure;
+
+  if (shared_measurements == NULL)
+    shared_measurements = g_hash_table_new_full (shared_measure_key_hash,
+                                                 shared_measure_key_equal,
+                                                 shared_measure_free,
+                                                 NULL);
+  else if (g_hash_table_size (shared_measurements) >= MAX_SHARED_MEASUREMENTS)
+    g_hash_table_remove_all (shared_measurements);
+
+  measure = g_new (SharedMeasure, 1);
+  measure->key = *key;
+  measure->key.style = g_object_ref (key->style);
+  measure->key.display = g_object_ref (key->display);
+  measure->key.font_map = g_object_ref (key->font_map);
+  measure->key.font_options = key->font_options ? cairo_font_options_copy (key->font_options) : NULL;
+  measure->key.text = g_strdup (key->text);
+  measure->key.attrs = key->attrs ? pango_attr_list_copy (key->attrs) : NULL;
+  measure->key.markup_attrs = key->markup_attrs ? pango_attr_list_copy (key->markup_attrs) : NULL;
+  measure->minimum = minimum;
+  measure->natural = natural;
+  measure->minimum_baseline = minimum_baseline;
+  measure->natural_baseline = natural_baseline;
+
+  g_hash_table_add (shared_measurements, measure);
+}
+
 static void
 gtk_label_measure (GtkWidget      *widget,
                    GtkOrientation  orientation,
@@ -3160,15 +3639,59 @@ gtk_label_measure (GtkWidget      *widget,
                    int            *natural_baseline)
 {
   GtkLabel *self = GTK_LABEL (widget);
+  gboolean height_for_width;
+  SharedMeasureKey key;
+  int min, nat, min_baseline = -1, nat_baseline = -1;
 
-  if (orientation == GTK_ORIENTATION_VERTICAL && for_size != -1 && self->wrap)
+  height_for_width = orientation == GTK_ORIENTATION_VERTICAL && for_size != -1 && self->wrap;
+
+  if (shared_measurements_enabled ())
+    {
+      SizeRequestCacheStats *stats = _gtk_size_request_cache_get_stats ();
+      const SharedMeasure *measure = NULL;
+
+      shared_measure_key_init (&key, self, orientation, height_for_width ? for_size : -1);
+
+      if (shared_measurements != NULL)
+        measure = g_hash_table_lookup (shared_measurements, &key);
+
+      if (measure != NULL)
+        {
+          stats->shared_hits++;
+
+          if (height_for_width)
+            gtk_label_clear_layout (self);
+
+          min = measure->minimum;
+          nat = measure->natural;
+          min_baseline = measure->minimum_baseline;
+          nat_baseline = measure->natural_baseline;
+
+          goto out;
+        }
+
+      stats->shared_misses++;
+    }
+
+  if (height_for_width)
     {
       gtk_label_clear_layout (self);
 
-      get_height_for_width (self, for_size, minimum, natural, minimum_baseline, natural_baseline);
+      get_height_for_width (self, for_size, &min, &nat, &min_baseline, &nat_baseline);
     }
   else
-    gtk_label_get_preferred_size (widget, orientation, minimum, natural, minimum_baseline, natural_baseline);
+    gtk_label_get_preferred_size (widget, orientation, &min, &nat, &min_baseline, &nat_baseline);
+
+  if (shared_measurements_enabled ())
+    shared_measure_insert (&key, min, nat, min_baseline, nat_baseline);
+
+out:
+  *minimum = min;
+  *natural = nat;
+  if (minimum_baseline)
+    *minimum_baseline = min_baseline;
+  if (natural_baseline)
+    *natural_baseline = nat_baseline;
 }
 
 static void
@@ -44,6 +44,10 @@ gboolean     _gtk_label_get_link_visited (GtkLabel *label,
                                           int       idx);
 gboolean     _gtk_label_get_link_focused (GtkLabel *label,
                                           int       idx);
+
+gboolean     gtk_label_needs_layout      (GtkLabel  *self);
+void         gtk_label_prepare_layouts   (GtkLabel **labels,
+                                          guint      n_labels);
                              
 G_END_DECLS
 
@@ -31,6 +31,7 @@
 #include "gtkprivate.h"
 #include "gtkscrollable.h"
 #include "gtktypebuiltins.h"
+#include "gtkvirtualizerprivate.h"
 #include "gtkwidgetprivate.h"
 
 #include <float.h>
@@ -66,6 +67,18 @@
  *
  * The GtkListBox widget was added in GTK+ 3.10.
  *
+ * # Virtualized models
+ *
+ * A GtkListBox that is bound to a model with gtk_list_box_bind_model()
+ * normally creates a row for every item in the model. For large models,
+ * the #GtkListBox:virtualized property can be set to only create rows
+ * for the items that are in or near the visible part of the list, when
+ * the list box is placed in a #GtkScrolledWindow. Rows are created on
+ * demand with the create_widget_func and destroyed again once they have
+ * been scrolled out of view, unless they are selected, focused or hold
+ * the cursor. The heights of items that don't have a row are estimated
+ * from the rows that do.
+ *
  * # GtkListBox as GtkBuildable
  *
  * The GtkListBox implementation of the #GtkBuildable interface supports
@@ -135,6 +148,10 @@ struct _GtkListBox
   GtkListBoxCreateWidgetFunc create_widget_func;
   gpointer create_widget_func_data;
   GDestroyNotify create_widget_func_data_destroy;
+
+  /* Virtualization of the bound model, with one line per item */
+  gboolean virtualized;
+  GtkVirtualizer virtualizer;
 };
 
 struct _GtkListBoxClass
@@ -163,8 +180,10 @@ typedef struct
   GSequenceIter *iter;
   GtkWidget *header;
   GtkActionHelper *action_helper;
+  guint position;
   int y;
   int height;
+  guint laid_out    :1;
   guint visible     :1;
   guint selected    :1;
   guint activatable :1;
@@ -194,6 +213,7 @@ enum {
   PROP_ACTIVATE_ON_SINGLE_CLICK,
   PROP_ACCEPT_UNPAIRED_RELEASE,
   PROP_SHOW_SEPARATORS,
+  PROP_VIRTUALIZED,
   LAST_PROPERTY
 };
 
@@ -312,6 +332,23 @@ static void                 gtk_list_box_bound_model_changed            (GListMo
 
 static void                 gtk_list_box_check_model_compat             (GtkListBox          *box);
 
+static gboolean             gtk_list_box_is_virtual                     (GtkListBox          *box);
+static void                 gtk_list_box_update_virtual_adjustment      (GtkListBox          *box);
+static void                 gtk_list_box_virtual_update                 (GtkWidget           *widget,
+                                                                         guint                start,
+                                                                         guint                n_items);
+static void                 gtk_list_box_realize_range                  (GtkListBox          *box,
+                                                                         guint                start,
+                                                                         guint                end);
+static GtkListBoxRow *      gtk_list_box_ensure_row                     (GtkListBox          *box,
+                                                                         guint                position);
+static gboolean             gtk_list_box_virtual_knows_before           (GtkListBox          *box,
+                                                                         GSequenceIter       *iter);
+static int                  gtk_list_box_virtual_measure                (GtkListBox          *box,
+                                                                         int                  width);
+static void                 gtk_list_box_virtual_allocate               (GtkListBox          *box,
+                                                                         int                  width);
+
 static void gtk_list_box_measure (GtkWidget     *widget,
                                   GtkOrientation  orientation,
                                   int             for_size,
@@ -385,6 +422,9 @@ gtk_list_box_get_property (GObject    *obj,
     case PROP_SHOW_SEPARATORS:
       g_value_set_boolean (value, box->show_separators);
       break;
+    case PROP_VIRTUALIZED:
+      g_value_set_boolean (value, box->virtualized);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, property_id, pspec);
       break;
@@ -413,6 +453,9 @@ gtk_list_box_set_property (GObject      *obj,
     case PROP_SHOW_SEPARATORS:
       gtk_list_box_set_show_separators (box, g_value_get_boolean (value));
       break;
+    case PROP_VIRTUALIZED:
+      gtk_list_box_set_virtualized (box, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, property_id, pspec);
       break;
@@ -422,8 +465,11 @@ gtk_list_box_set_property (GObject      *obj,
 static void
 gtk_list_box_dispose (GObject *object)
 {
+  GtkListBox *box = GTK_LIST_BOX (object);
   GtkWidget *child;
 
+  gtk_virtualizer_finish (&box->virtualizer);
+
   while ((child = gtk_widget_get_first_child (GTK_WIDGET (object))))
     gtk_list_box_remove (GTK_LIST_BOX (object), child);
 
@@ -514,6 +560,21 @@ gtk_list_box_class_init (GtkListBoxClass *klass)
                           FALSE,
                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkListBox:virtualized:
+   *
+   * Whether rows are only created for the items of the bound model
+   * that are in or near the visible part of the list.
+   *
+   * See gtk_list_box_set_virtualized().
+   */
+  properties[PROP_VIRTUALIZED] =
+    g_param_spec_boolean ("virtualized",
+                          P_("Virtualized"),
+                          P_("Only create rows for visible items of the model"),
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, LAST_PROPERTY, properties);
 
   /**
@@ -695,6 +756,7 @@ gtk_list_box_init (GtkListBox *box)
 
   box->children = g_sequence_new (NULL);
   box->header_hash = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, NULL);
+  gtk_virtualizer_init (&box->virtualizer, widget, gtk_list_box_virtual_update);
 
   gesture = gtk_gesture_click_new ();
   gtk_event_controller_set_propagation_phase (GTK_EVENT_CONTROLLER (gesture),
@@ -745,6 +807,9 @@ gtk_list_box_get_selected_row (GtkListBox *box)
  * If @_index is negative or larger than the number of items in the
  * list, %NULL is returned.
  *
+ * If @box is virtualized, the row for the @index_'th item of the
+ * model is created if it doesn't exist yet.
+ *
  * Returns: (transfer none) (nullable): the child #GtkWidget or %NULL
  */
 GtkListBoxRow *
@@ -755,6 +820,14 @@ gtk_list_box_get_row_at_index (GtkListBox *box,
 
   g_return_val_if_fail (GTK_IS_LIST_BOX (box), NULL);
 
+  if (gtk_list_box_is_virtual (box))
+    {
+      if (index_ < 0 || (guint) index_ >= g_list_model_get_n_items (box->bound_model))
+        return NULL;
+
+      return gtk_list_box_ensure_row (box, index_);
+    }
+
   iter = g_sequence_get_iter_at_pos (box->children, index_);
   if (!g_sequence_iter_is_end (iter))
     return g_sequence_get (iter);
@@ -858,6 +931,8 @@ gtk_list_box_unselect_row (GtkListBox    *box,
  * @box: a #GtkListBox
  *
  * Select all children of @box, if the selection mode allows it.
+ *
+ * If @box is virtualized, this creates rows for all items of the model.
  */
 void
 gtk_list_box_select_all (GtkListBox *box)
@@ -867,6 +942,9 @@ gtk_list_box_select_all (GtkListBox *box)
   if (box->selection_mode != GTK_SELECTION_MULTIPLE)
     return;
 
+  if (gtk_list_box_is_virtual (box))
+    gtk_list_box_realize_range (box, 0, g_list_model_get_n_items (box->bound_model));
+
   if (g_sequence_get_length (box->children) > 0)
     {
       gtk_list_box_select_all_between (box, NULL, NULL, FALSE);
@@ -1032,6 +1110,8 @@ gtk_list_box_set_adjustment (GtkListBox    *box,
   if (box->adjustment)
     g_object_unref (box->adjustment);
   box->adjustment = adjustment;
+
+  gtk_list_box_update_virtual_adjustment (box);
 }
 
 /**
@@ -1487,6 +1567,15 @@ ensure_row_visible (GtkListBox    *box,
   if (!box->adjustment)
     return;
 
+  /* Rows of a virtualized list that have just been created don't have
+   * a position yet, so move the list to them instead.
+   */
+  if (gtk_list_box_is_virtual (box) && !ROW_PRIV (row)->laid_out)
+    {
+      gtk_virtualizer_scroll_to (&box->virtualizer, ROW_PRIV (row)->position);
+      return;
+    }
+
   if (!gtk_widget_compute_bounds (GTK_WIDGET (row), GTK_WIDGET (box), &rect))
     return;
 
@@ -1638,6 +1727,22 @@ gtk_list_box_select_all_between (GtkListBox    *box,
 {
   GSequenceIter *iter, *iter1, *iter2;
 
+  if (gtk_list_box_is_virtual (box))
+    {
+      guint start, end;
+
+      start = row1 ? ROW_PRIV (row1)->position : 0;
+      end = row2 ? ROW_PRIV (row2)->position + 1 : g_list_model_get_n_items (box->bound_model);
+      if (end <= start)
+        {
+          guint tmp = start + 1;
+          start = end - 1;
+          end = tmp;
+        }
+
+      gtk_list_box_realize_range (box, start, end);
+    }
+
   if (row1)
     iter1 = ROW_PRIV (row1)->iter;
   else
@@ -1910,6 +2015,22 @@ gtk_list_box_focus (GtkWidget        *widget,
       if (gtk_widget_child_focus (focus_child, direction))
         return TRUE;
 
+      /* Make sure the neighbours of the focus row exist */
+      if (gtk_list_box_is_virtual (box))
+        {
+          if (GTK_IS_LIST_BOX_ROW (focus_child))
+            row = focus_child;
+          else
+            row = g_hash_table_lookup (box->header_hash, focus_child);
+
+          if (GTK_IS_LIST_BOX_ROW (row))
+            {
+              guint position = ROW_PRIV (row)->position;
+
+              gtk_list_box_realize_range (box, position - MIN (position, 1), position + 2);
+            }
+        }
+
       if (direction == GTK_DIR_UP || direction == GTK_DIR_TAB_BACKWARD)
         {
           if (GTK_IS_LIST_BOX_ROW (focus_child))
@@ -2193,6 +2314,11 @@ gtk_list_box_update_header (GtkListBox    *box,
   if (iter == NULL || g_sequence_iter_is_end (iter))
     return;
 
+  /* Keep the current header if we can't tell which row comes before */
+  if (gtk_list_box_is_virtual (box) &&
+      !gtk_list_box_virtual_knows_before (box, iter))
+    return;
+
   row = g_sequence_get (iter);
   g_object_ref (row);
 
@@ -2468,6 +2594,13 @@ gtk_list_box_measure (GtkWidget     *widget,
                             minimum, NULL,
                             NULL, NULL);
 
+      if (gtk_list_box_is_virtual (box))
+        {
+          *minimum += gtk_list_box_virtual_measure (box, for_size);
+          *natural = *minimum;
+          return;
+        }
+
       for (iter = g_sequence_get_begin_iter (box->children);
            !g_sequence_iter_is_end (iter);
            iter = g_sequence_iter_next (iter))
@@ -2535,6 +2668,12 @@ gtk_list_box_size_allocate (GtkWidget *widget,
       child_allocation.y += child_min;
     }
 
+  if (gtk_list_box_is_virtual (box))
+    {
+      gtk_list_box_virtual_allocate (box, width);
+      return;
+    }
+
   for (iter = g_sequence_get_begin_iter (box->children);
        !g_sequence_iter_is_end (iter);
        iter = g_sequence_iter_next (iter))
@@ -2750,6 +2889,39 @@ gtk_list_box_move_cursor (GtkListBox      *box,
   int end_y;
   int height;
 
+  /* In a virtualized list, create the rows we might move to first.
+   * Pages are moved by the number of rows that fit on a page, since
+   * the rows in between may not exist.
+   */
+  if (gtk_list_box_is_virtual (box))
+    {
+      guint n_items = g_list_model_get_n_items (box->bound_model);
+
+      if (step == GTK_MOVEMENT_PAGES && box->adjustment != NULL)
+        {
+          count *= MAX (1, (int) (gtk_adjustment_get_page_increment (box->adjustment) /
+                                  MAX (1, gtk_virtualizer_get_estimated_size (&box->virtualizer))));
+          step = GTK_MOVEMENT_DISPLAY_LINES;
+        }
+
+      if (step == GTK_MOVEMENT_BUFFER_ENDS)
+        {
+          if (count < 0)
+            gtk_list_box_realize_range (box, 0, GTK_VIRTUALIZER_EXTRA_LINES);
+          else
+            gtk_list_box_realize_range (box, n_items - MIN (n_items, GTK_VIRTUALIZER_EXTRA_LINES), n_items);
+        }
+      else if (step == GTK_MOVEMENT_DISPLAY_LINES && box->cursor_row != NULL)
+        {
+          guint position = ROW_PRIV (box->cursor_row)->position;
+
+          if (count < 0)
+            gtk_list_box_realize_range (box, position - MIN (position, (guint) -count), position);
+          else
+            gtk_list_box_realize_range (box, position + 1, position + 1 + count);
+        }
+    }
+
   row = NULL;
   switch ((guint) step)
     {
@@ -3101,19 +3273,27 @@ gtk_list_box_row_set_header (GtkListBoxRow *row,
  *
  * Gets the current index of the @row in its #GtkListBox container.
  *
+ * If the list box is virtualized, this is the position of the
+ * item of the row in the bound model.
+ *
  * Returns: the index of the @row, or -1 if the @row is not in a listbox
  */
 int
 gtk_list_box_row_get_index (GtkListBoxRow *row)
 {
   GtkListBoxRowPrivate *priv = ROW_PRIV (row);
+  GtkListBox *box;
 
   g_return_val_if_fail (GTK_IS_LIST_BOX_ROW (row), -1);
 
-  if (priv->iter != NULL)
-    return g_sequence_iter_get_position (priv->iter);
+  if (priv->iter == NULL)
+    return -1;
 
-  return -1;
+  box = gtk_list_box_row_get_box (row);
+  if (box && gtk_list_box_is_virtual (box))
+    return priv->position;
+
+  return g_sequence_iter_get_position (priv->iter);
 }
 
 /**
@@ -3510,6 +3690,361 @@ gtk_list_box_buildable_interface_init (GtkBuildableIface *iface)
   iface->add_child = gtk_list_box_buildable_add_child;
 }
 
+static GtkListBoxRow *
+gtk_list_box_create_row (GtkListBox *box,
+                         guint       position,
+                         int         index)
+{
+  GObject *item;
+  GtkWidget *widget;
+  GtkListBoxRow *row;
+
+  item = g_list_model_get_item (box->bound_model, position);
+  widget = box->create_widget_func (item, box->create_widget_func_data);
+
+  /* We allow the create_widget_func to either return a full
+   * reference or a floating reference.  If we got the floating
+   * reference, then turn it into a full reference now.  That means
+   * that gtk_list_box_insert() will take another full reference.
+   * Finally, we'll release this full reference below, leaving only
+   * the one held by the box.
+   */
+  if (g_object_is_floating (widget))
+    g_object_ref_sink (widget);
+
+  gtk_widget_show (widget);
+
+  if (GTK_IS_LIST_BOX_ROW (widget))
+    row = GTK_LIST_BOX_ROW (widget);
+  else
+    {
+      row = GTK_LIST_BOX_ROW (gtk_list_box_row_new ());
+      gtk_list_box_row_set_child (row, widget);
+    }
+
+  ROW_PRIV (row)->position = position;
+  gtk_list_box_insert (box, GTK_WIDGET (row), index);
+
+  g_object_unref (widget);
+  g_object_unref (item);
+
+  return row;
+}
+
+static gboolean
+gtk_list_box_is_virtual (GtkListBox *box)
+{
+  return box->virtualized && box->bound_model != NULL;
+}
+
+/* Only let the virtualizer follow the adjustment while it has rows
+ * to create, so that other list boxes don't pay for its updates.
+ */
+static void
+gtk_list_box_update_virtual_adjustment (GtkListBox *box)
+{
+  gtk_virtualizer_set_adjustment (&box->virtualizer,
+                                  gtk_list_box_is_virtual (box) ? box->adjustment : NULL,
+                                  FALSE);
+}
+
+static int
+row_position_cmp_func (gconstpointer a,
+                       gconstpointer b,
+                       gpointer      user_data)
+{
+  guint position = GPOINTER_TO_UINT (b);
+
+  /* Never report a match, so that searching finds the first row
+   * at or after the position.
+   */
+  if (ROW_PRIV (a)->position < position)
+    return -1;
+
+  return 1;
+}
+
+/* Returns the first row of a virtualized list whose item is
+ * at or after @position.
+ */
+static GSequenceIter *
+gtk_list_box_get_iter_at_position (GtkListBox *box,
+                                   guint       position)
+{
+  return g_sequence_search (box->children,
+                            GUINT_TO_POINTER (position),
+                            row_position_cmp_func,
+                            NULL);
+}
+
+static GtkListBoxRow *
+gtk_list_box_ensure_row (GtkListBox *box,
+                         guint       position)
+{
+  GSequenceIter *iter;
+  GtkListBoxRow *row;
+
+  iter = gtk_list_box_get_iter_at_position (box, position);
+  if (!g_sequence_iter_is_end (iter))
+    {
+      row = g_sequence_get (iter);
+      if (ROW_PRIV (row)->position == position)
+        return row;
+    }
+
+  return gtk_list_box_create_row (box, position, g_sequence_iter_get_position (iter));
+}
+
+static void
+gtk_list_box_realize_range (GtkListBox *box,
+                            guint       start,
+                            guint       end)
+{
+  GSequenceIter *iter;
+  guint position;
+
+  end = MIN (end, g_list_model_get_n_items (box->bound_model));
+
+  iter = gtk_list_box_get_iter_at_position (box, start);
+  for (position = start; position < end; position++)
+    {
+      if (!g_sequence_iter_is_end (iter) &&
+          ROW_PRIV (g_sequence_get (iter))->position == position)
+        iter = g_sequence_iter_next (iter);
+      else
+        gtk_list_box_create_row (box, position, g_sequence_iter_get_position (iter));
+    }
+}
+
+static void
+gtk_list_box_virtual_update (GtkWidget *widget,
+                             guint      start,
+                             guint      n_items)
+{
+  GtkListBox *box = GTK_LIST_BOX (widget);
+  GSequenceIter *iter;
+  GtkWidget *focus_row;
+  guint end;
+
+  if (!gtk_list_box_is_virtual (box))
+    return;
+
+  end = start + n_items;
+
+  /* Rows outside of the window are destroyed, unless they
+   * carry state that we would lose.
+   */
+  focus_row = gtk_widget_get_focus_child (GTK_WIDGET (box));
+  if (focus_row && !GTK_IS_LIST_BOX_ROW (focus_row))
+    focus_row = g_hash_table_lookup (box->header_hash, focus_row);
+
+  iter = g_sequence_get_begin_iter (box->children);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkListBoxRow *row = g_sequence_get (iter);
+      GtkListBoxRowPrivate *row_priv = ROW_PRIV (row);
+
+      iter = g_sequence_iter_next (iter);
+
+      if (row_priv->position >= start && row_priv->position < end)
+        continue;
+
+      if (row_priv->selected ||
+          row == box->cursor_row ||
+          row == box->active_row ||
+          row == box->drag_highlighted_row ||
+          GTK_WIDGET (row) == focus_row)
+        continue;
+
+      gtk_list_box_remove (box, GTK_WIDGET (row));
+    }
+
+  gtk_list_box_realize_range (box, start, end);
+}
+
+/* Whether the row before @iter is known, ie all items between it
+ * and the closest visible row in front of it have rows.
+ */
+static gboolean
+gtk_list_box_virtual_knows_before (GtkListBox    *box,
+                                   GSequenceIter *iter)
+{
+  guint position;
+
+  position = ROW_PRIV (g_sequence_get (iter))->position;
+
+  while (position > 0)
+    {
+      GtkListBoxRow *row;
+
+      if (g_sequence_iter_is_begin (iter))
+        return FALSE;
+
+      iter = g_sequence_iter_prev (iter);
+      row = g_sequence_get (iter);
+      if (ROW_PRIV (row)->position != position - 1)
+        return FALSE;
+
+      if (row_is_visible (row))
+        return TRUE;
+
+      position--;
+    }
+
+  return TRUE;
+}
+
+/* Collects the rows as lines for the virtualizer. A line is
+ * a row together with its header.
+ */
+static GArray *
+gtk_list_box_get_virtual_lines (GtkListBox *box,
+                                int         width)
+{
+  GSequenceIter *iter;
+  GArray *lines;
+
+  lines = g_array_sized_new (FALSE, FALSE,
+                             sizeof (GtkVirtualizerLine),
+                             g_sequence_get_length (box->children));
+
+  for (iter = g_sequence_get_begin_iter (box->children);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      GtkListBoxRow *row = g_sequence_get (iter);
+      GtkVirtualizerLine line = { ROW_PRIV (row)->position, 0, 0 };
+      int child_min;
+
+      if (row_is_visible (row))
+        {
+          if (ROW_PRIV (row)->header != NULL)
+            {
+              gtk_widget_measure (ROW_PRIV (row)->header, GTK_ORIENTATION_VERTICAL, width,
+                                  &child_min, NULL, NULL, NULL);
+              line.size += child_min;
+            }
+
+          gtk_widget_measure (GTK_WIDGET (row), GTK_ORIENTATION_VERTICAL, width,
+                              &child_min, NULL, NULL, NULL);
+          line.size += child_min;
+        }
+
+      g_array_append_val (lines, line);
+    }
+
+  return lines;
+}
+
+static int
+gtk_list_box_virtual_measure (GtkListBox *box,
+                              int         width)
+{
+  GArray *lines;
+  int height;
+
+  lines = gtk_list_box_get_virtual_lines (box, width);
+  height = gtk_virtualizer_measure (&box->virtualizer,
+                                    (GtkVirtualizerLine *) lines->data,
+                                    lines->len);
+  g_array_unref (lines);
+
+  return height;
+}
+
+static void
+gtk_list_box_virtual_allocate (GtkListBox *box,
+                               int         width)
+{
+  GtkAllocation child_allocation;
+  GtkAllocation header_allocation;
+  GSequenceIter *iter;
+  GArray *lines;
+  guint i;
+  int child_min;
+
+  lines = gtk_list_box_get_virtual_lines (box, width);
+  gtk_virtualizer_allocate (&box->virtualizer,
+                            (GtkVirtualizerLine *) lines->data,
+                            lines->len);
+
+  child_allocation.x = 0;
+  child_allocation.width = width;
+
+  header_allocation.x = 0;
+  header_allocation.width = width;
+
+  for (iter = g_sequence_get_begin_iter (box->children), i = 0;
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter), i++)
+    {
+      GtkListBoxRow *row = g_sequence_get (iter);
+      GtkListBoxRowPrivate *row_priv = ROW_PRIV (row);
+
+      child_allocation.y = g_array_index (lines, GtkVirtualizerLine, i).offset;
+      row_priv->laid_out = TRUE;
+
+      if (!row_is_visible (row))
+        {
+          row_priv->y = child_allocation.y;
+          row_priv->height = 0;
+          continue;
+        }
+
+      if (row_priv->header != NULL)
+        {
+          gtk_widget_measure (row_priv->header, GTK_ORIENTATION_VERTICAL,
+                              width,
+                              &child_min, NULL, NULL, NULL);
+          header_allocation.height = child_min;
+          header_allocation.y = child_allocation.y;
+          gtk_widget_size_allocate (row_priv->header, &header_allocation, -1);
+          child_allocation.y += child_min;
+        }
+
+      row_priv->y = child_allocation.y;
+
+      gtk_widget_measure (GTK_WIDGET (row), GTK_ORIENTATION_VERTICAL,
+                          width,
+                          &child_min, NULL, NULL, NULL);
+      child_allocation.height = child_min;
+
+      row_priv->height = child_allocation.height;
+      gtk_widget_size_allocate (GTK_WIDGET (row), &child_allocation, -1);
+    }
+
+  g_array_unref (lines);
+}
+
+static void
+gtk_list_box_virtual_items_changed (GtkListBox *box,
+                                    guint       position,
+                                    guint       removed,
+                                    guint       added)
+{
+  GSequenceIter *iter;
+
+  iter = gtk_list_box_get_iter_at_position (box, position);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkListBoxRow *row = g_sequence_get (iter);
+
+      iter = g_sequence_iter_next (iter);
+
+      if (ROW_PRIV (row)->position < position + removed)
+        gtk_list_box_remove (box, GTK_WIDGET (row));
+      else
+        ROW_PRIV (row)->position += added - removed;
+    }
+
+  if (gtk_widget_get_visible (GTK_WIDGET (box)))
+    gtk_list_box_update_header (box, gtk_list_box_get_iter_at_position (box, position));
+
+  gtk_virtualizer_items_changed (&box->virtualizer, position, removed, added);
+  gtk_virtualizer_update (&box->virtualizer);
+  gtk_widget_queue_resize (GTK_WIDGET (box));
+}
+
 static void
 gtk_list_box_bound_model_changed (GListModel *list,
                                   guint       position,
@@ -3520,6 +4055,12 @@ gtk_list_box_bound_model_changed (GListModel *list,
   GtkListBox *box = user_data;
   guint i;
 
+  if (gtk_list_box_is_virtual (box))
+    {
+      gtk_list_box_virtual_items_changed (box, position, removed, added);
+      return;
+    }
+
   while (removed--)
     {
       GtkListBoxRow *row;
@@ -3529,29 +4070,35 @@ gtk_list_box_bound_model_changed (GListModel *list,
     }
 
   for (i = 0; i < added; i++)
-    {
-      GObject *item;
-      GtkWidget *widget;
-
-      item = g_list_model_get_item (list, position + i);
-      widget = box->create_widget_func (item, box->create_widget_func_data);
+    gtk_list_box_create_row (box, position + i, position + i);
+}
 
-      /* We allow the create_widget_func to either return a full
-       * reference or a floating reference.  If we got the floating
-       * reference, then turn it into a full reference now.  That means
-       * that gtk_list_box_insert() will take another full reference.
-       * Finally, we'll release this full reference below, leaving only
-       * the one held by the box.
-       */
-      if (g_object_is_floating (widget))
-        g_object_ref_sink (widget);
+static void
+gtk_list_box_remove_all_rows (GtkListBox *box)
+{
+  GSequenceIter *iter;
 
-      gtk_widget_show (widget);
-      gtk_list_box_insert (box, widget, position + i);
+  iter = g_sequence_get_begin_iter (box->children);
+  while (!g_sequence_iter_is_end (iter))
+    {
+      GtkWidget *row = g_sequence_get (iter);
+      iter = g_sequence_iter_next (iter);
+      gtk_list_box_remove (box, row);
+    }
+}
 
-      g_object_unref (widget);
-      g_object_unref (item);
+static void
+gtk_list_box_add_bound_rows (GtkListBox *box)
+{
+  if (gtk_list_box_is_virtual (box))
+    {
+      gtk_virtualizer_reset (&box->virtualizer, g_list_model_get_n_items (box->bound_model));
+      gtk_virtualizer_update (&box->virtualizer);
     }
+  else
+    gtk_list_box_bound_model_changed (box->bound_model,
+                                      0, 0, g_list_model_get_n_items (box->bound_model),
+                                      box);
 }
 
 static void
@@ -3587,6 +4134,9 @@ gtk_list_box_check_model_compat (GtkListBox *box)
  * Note that using a model is incompatible with the filtering and sorting
  * functionality in GtkListBox. When using a model, filtering and sorting
  * should be implemented by the model.
+ *
+ * For large models, see gtk_list_box_set_virtualized() to only create
+ * widgets for the items that are visible.
  */
 void
 gtk_list_box_bind_model (GtkListBox                 *box,
@@ -3595,8 +4145,6 @@ gtk_list_box_bind_model (GtkListBox                 *box,
                          gpointer                    user_data,
                          GDestroyNotify              user_data_free_func)
 {
-  GSequenceIter *iter;
-
   g_return_if_fail (GTK_IS_LIST_BOX (box));
   g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
   g_return_if_fail (model == NULL || create_widget_func != NULL);
@@ -3608,16 +4156,10 @@ gtk_list_box_bind_model (GtkListBox                 *box,
 
       g_signal_handlers_disconnect_by_func (box->bound_model, gtk_list_box_bound_model_changed, box);
       g_clear_object (&box->bound_model);
+      gtk_list_box_update_virtual_adjustment (box);
     }
 
-  iter = g_sequence_get_begin_iter (box->children);
-  while (!g_sequence_iter_is_end (iter))
-    {
-      GtkWidget *row = g_sequence_get (iter);
-      iter = g_sequence_iter_next (iter);
-      gtk_list_box_remove (box, row);
-    }
-
+  gtk_list_box_remove_all_rows (box);
 
   if (model == NULL)
     return;
@@ -3630,7 +4172,68 @@ gtk_list_box_bind_model (GtkListBox                 *box,
   gtk_list_box_check_model_compat (box);
 
   g_signal_connect (box->bound_model, "items-changed", G_CALLBACK (gtk_list_box_bound_model_changed), box);
-  gtk_list_box_bound_model_changed (model, 0, 0, g_list_model_get_n_items (model), box);
+  gtk_list_box_update_virtual_adjustment (box);
+  gtk_list_box_add_bound_rows (box);
+}
+
+/**
+ * gtk_list_box_set_virtualized:
+ * @box: a #GtkListBox
+ * @virtualized: %TRUE to only create rows for visible items
+ *
+ * Sets whether @box only creates rows for the items of the model bound
+ * with gtk_list_box_bind_model() that are in or near the visible part
+ * of the list.
+ *
+ * This only has an effect if @box is bound to a model and placed in a
+ * #GtkScrolledWindow. Rows are destroyed once they are scrolled out of
+ * view, unless they are selected, focused or the cursor row, and
+ * created again when they come back into view.
+ *
+ * Functions that look at the rows of @box, like
+ * gtk_list_box_get_selected_rows(), only see the rows that exist.
+ * gtk_list_box_get_row_at_index() creates the row if needed, and
+ * gtk_list_box_row_get_index() returns the position of the item
+ * in the model.
+ */
+void
+gtk_list_box_set_virtualized (GtkListBox *box,
+                              gboolean    virtualized)
+{
+  g_return_if_fail (GTK_IS_LIST_BOX (box));
+
+  virtualized = virtualized != FALSE;
+
+  if (box->virtualized == virtualized)
+    return;
+
+  box->virtualized = virtualized;
+  gtk_list_box_update_virtual_adjustment (box);
+
+  if (box->bound_model)
+    {
+      gtk_list_box_remove_all_rows (box);
+      gtk_list_box_add_bound_rows (box);
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (box), properties[PROP_VIRTUALIZED]);
+}
+
+/**
+ * gtk_list_box_get_virtualized:
+ * @box: a #GtkListBox
+ *
+ * Returns whether @box only creates rows for the visible
+ * items of its model.
+ *
+ * Returns: %TRUE if @box is virtualized
+ */
+gboolean
+gtk_list_box_get_virtualized (GtkListBox *box)
+{
+  g_return_val_if_fail (GTK_IS_LIST_BOX (box), FALSE);
+
+  return box->virtualized;
 }
 
 /**
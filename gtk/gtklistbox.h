@@ -262,6 +262,12 @@ void           gtk_list_box_bind_model                   (GtkListBox
                                                           gpointer                      user_data,
                                                           GDestroyNotify                user_data_free_func);
 
+GDK_AVAILABLE_IN_ALL
+void           gtk_list_box_set_virtualized              (GtkListBox                   *box,
+                                                          gboolean                      virtualized);
+GDK_AVAILABLE_IN_ALL
+gboolean       gtk_list_box_get_virtualized              (GtkListBox                   *box);
+
 GDK_AVAILABLE_IN_ALL
 void           gtk_list_box_set_show_separators          (GtkListBox                   *box,
                                                           gboolean                      show_separators);
@@ -21,6 +21,8 @@
 
 #include "gtklistitemmanagerprivate.h"
 
+#include "gtklabelprivate.h"
+#include "gtklistitemrangeprivate.h"
 #include "gtklistitemwidgetprivate.h"
 #include "gtkwidgetprivate.h"
 
@@ -38,6 +40,9 @@ struct _GtkListItemManager
 
   GtkRbTree *items;
   GSList *trackers;
+
+  /* items were bound since the last gtk_list_item_manager_prepare_items() */
+  gboolean needs_prepare;
 };
 
 struct _GtkListItemManagerClass
@@ -47,10 +52,9 @@ struct _GtkListItemManagerClass
 
 struct _GtkListItemTracker
 {
-  guint position;
+  /* must be first, so the trackers can be queried as ranges */
+  GtkListItemRange range;
   GtkListItemWidget *widget;
-  guint n_before;
-  guint n_after;
 };
 
 static GtkWidget *      gtk_list_item_manager_acquire_list_item (GtkListItemManager     *self,
@@ -251,97 +255,7 @@ gtk_list_item_tracker_unset_position (GtkListItemManager *self,
                                       GtkListItemTracker *tracker)
 {
   tracker->widget = NULL;
-  tracker->position = GTK_INVALID_LIST_POSITION;
-}
-
-static gboolean
-gtk_list_item_tracker_query_range (GtkListItemManager *self,
-                                   GtkListItemTracker *tracker,
-                                   guint               n_items,
-                                   guint              *out_start,
-                                   guint              *out_n_items)
-{
-  /* We can't look at tracker->widget here because we might not
-   * have set it yet.
-   */
-  if (tracker->position == GTK_INVALID_LIST_POSITION)
-    return FALSE;
-
-  /* This is magic I made up that is meant to be both
-   * correct and doesn't overflow when start and/or end are close to 0 or
-   * close to max.
-   * But beware, I didn't test it.
-   */
-  *out_n_items = tracker->n_before + tracker->n_after + 1;
-  *out_n_items = MIN (*out_n_items, n_items);
-
-  *out_start = MAX (tracker->position, tracker->n_before) - tracker->n_before;
-  *out_start = MIN (*out_start, n_items - *out_n_items);
-
-  return TRUE;
-}
-
-static void
-gtk_list_item_query_tracked_range (GtkListItemManager *self,
-                                   guint               n_items,
-                                   guint               position,
-                                   guint              *out_n_items,
-                                   gboolean           *out_tracked)
-{
-  GSList *l;
-  guint tracker_start, tracker_n_items;
-
-  g_assert (position < n_items);
-
-  *out_tracked = FALSE;
-  *out_n_items = n_items - position;
-
-  /* step 1: Check if position is tracked */
-
-  for (l = self->trackers; l; l = l->next)
-    {
-      if (!gtk_list_item_tracker_query_range (self, l->data, n_items, &tracker_start, &tracker_n_items))
-        continue;
-
-      if (tracker_start > position)
-        {
-          *out_n_items = MIN (*out_n_items, tracker_start - position);
-        }
-      else if (tracker_start + tracker_n_items <= position)
-        {
-          /* do nothing */
-        }
-      else
-        {
-          *out_tracked = TRUE;
-          *out_n_items = tracker_start + tracker_n_items - position;
-          break;
-        }
-    }
-
-  /* If nothing's tracked, we're done */
-  if (!*out_tracked)
-    return;
-
-  /* step 2: make the tracked range as large as possible
-   * NB: This is O(N_TRACKERS^2), but the number of trackers should be <5 */
-restart:
-  for (l = self->trackers; l; l = l->next)
-    {
-      if (!gtk_list_item_tracker_query_range (self, l->data, n_items, &tracker_start, &tracker_n_items))
-        continue;
-
-      if (tracker_start + tracker_n_items <= position + *out_n_items)
-        continue;
-      if (tracker_start > position + *out_n_items)
-        continue;
-
-      if (*out_n_items + position < tracker_start + tracker_n_items)
-        {
-          *out_n_items = tracker_start + tracker_n_items - position;
-          goto restart;
-        }
-    }
+  tracker->range.position = GTK_INVALID_LIST_POSITION;
 }
 
 static void
@@ -429,7 +343,7 @@ gtk_list_item_manager_release_items (GtkListItemManager *self,
 
   while (position < n_items)
     {
-      gtk_list_item_query_tracked_range (self, n_items, position, &query_n_items, &tracked);
+      gtk_list_item_ranges_query (self->trackers, n_items, position, &query_n_items, &tracked);
       if (tracked)
         {
           position += query_n_items;
@@ -492,7 +406,7 @@ gtk_list_item_manager_ensure_items (GtkListItemManager *self,
 
   while (position < n_items)
     {
-      gtk_list_item_query_tracked_range (self, n_items, position, &query_n_items, &tracked);
+      gtk_list_item_ranges_query (self->trackers, n_items, position, &query_n_items, &tracked);
       if (!tracked)
         {
           position += query_n_items;
@@ -665,28 +579,28 @@ gtk_list_item_manager_model_items_changed_cb (GListModel         *model,
     {
       GtkListItemTracker *tracker = l->data;
 
-      if (tracker->position == GTK_INVALID_LIST_POSITION)
+      if (tracker->range.position == GTK_INVALID_LIST_POSITION)
         {
           /* if the list is no longer empty, set the tracker to a valid position. */
           if (n_items > 0 && n_items == added && removed == 0)
-            tracker->position = 0;
+            tracker->range.position = 0;
         }
-      else if (tracker->position >= position + removed)
+      else if (tracker->range.position >= position + removed)
         {
-          tracker->position += added - removed;
+          tracker->range.position += added - removed;
         }
-      else if (tracker->position >= position)
+      else if (tracker->range.position >= position)
         {
           if (g_hash_table_lookup (change, gtk_list_item_widget_get_item (tracker->widget)))
             {
               /* The item is gone. Guess a good new position */
-              tracker->position = position + (tracker->position - position) * added / removed;
-              if (tracker->position >= n_items)
+              tracker->range.position = position + (tracker->range.position - position) * added / removed;
+              if (tracker->range.position >= n_items)
                 {
                   if (n_items == 0)
-                    tracker->position = GTK_INVALID_LIST_POSITION;
+                    tracker->range.position = GTK_INVALID_LIST_POSITION;
                   else
-                    tracker->position--;
+                    tracker->range.position--;
                 }
               tracker->widget = NULL;
             }
@@ -695,7 +609,7 @@ gtk_list_item_manager_model_items_changed_cb (GListModel         *model,
               /* item was put in its right place in the expensive loop above,
                * and we updated its position while at it. So grab it from there.
                */
-              tracker->position = gtk_list_item_widget_get_position (tracker->widget);
+              tracker->range.position = gtk_list_item_widget_get_position (tracker->widget);
             }
         }
       else
@@ -716,10 +630,10 @@ gtk_list_item_manager_model_items_changed_cb (GListModel         *model,
       GtkListItemManagerItem *item;
 
       if (tracker->widget != NULL || 
-          tracker->position == GTK_INVALID_LIST_POSITION)
+          tracker->range.position == GTK_INVALID_LIST_POSITION)
         continue;
 
-      item = gtk_list_item_manager_get_nth (self, tracker->position, NULL);
+      item = gtk_list_item_manager_get_nth (self, tracker->range.position, NULL);
       g_assert (item != NULL);
       g_assert (item->widget);
       tracker->widget = GTK_LIST_ITEM_WIDGET (item->widget);
@@ -841,7 +755,7 @@ gtk_list_item_manager_set_factory (GtkListItemManager *self,
       if (tracker->widget == NULL)
         continue;
 
-      item = gtk_list_item_manager_get_nth (self, tracker->position, NULL);
+      item = gtk_list_item_manager_get_nth (self, tracker->range.position, NULL);
       g_assert (item);
       tracker->widget = GTK_LIST_ITEM_WIDGET (item->widget);
     }
@@ -932,6 +846,7 @@ gtk_list_item_manager_acquire_list_item (GtkListItemManager *self,
   gtk_list_item_widget_update (GTK_LIST_ITEM_WIDGET (result), position, item, selected);
   g_object_unref (item);
   gtk_widget_insert_after (result, self->widget, prev_sibling);
+  self->needs_prepare = TRUE;
 
   return GTK_WIDGET (result);
 }
@@ -1015,6 +930,7 @@ gtk_list_item_manager_move_list_item (GtkListItemManager     *self,
                                selected);
   gtk_widget_insert_after (list_item, _gtk_widget_get_parent (list_item), prev_sibling);
   g_object_unref (item);
+  self->needs_prepare = TRUE;
 }
 
 /**
@@ -1044,6 +960,64 @@ gtk_list_item_manager_update_list_item (GtkListItemManager *self,
                                selected);
 }
 
+static void
+gtk_list_item_manager_collect_labels (GtkWidget *widget,
+                                      GPtrArray *labels)
+{
+  GtkWidget *child;
+
+  if (GTK_IS_LABEL (widget))
+    {
+      if (gtk_label_needs_layout (GTK_LABEL (widget)))
+        g_ptr_array_add (labels, widget);
+      return;
+    }
+
+  for (child = _gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = _gtk_widget_get_next_sibling (child))
+    gtk_list_item_manager_collect_labels (child, labels);
+}
+
+/*
+ * gtk_list_item_manager_prepare_items:
+ * @self: a #GtkListItemManager
+ *
+ * Gets the items that were bound since the last call ready for
+ * measuring, by shaping the text of their labels in parallel.
+ *
+ * Widgets call this before they measure their items. If they
+ * don't, the items do this work themselves while being measured.
+ **/
+void
+gtk_list_item_manager_prepare_items (GtkListItemManager *self)
+{
+  GPtrArray *labels;
+  GtkListItemManagerItem *item;
+
+  g_return_if_fail (GTK_IS_LIST_ITEM_MANAGER (self));
+
+  if (!self->needs_prepare)
+    return;
+
+  self->needs_prepare = FALSE;
+
+  labels = g_ptr_array_new ();
+
+  for (item = gtk_rb_tree_get_first (self->items);
+       item != NULL;
+       item = gtk_rb_tree_node_get_next (item))
+    {
+      if (item->widget)
+        gtk_list_item_manager_collect_labels (item->widget, labels);
+    }
+
+  if (labels->len > 0)
+    gtk_label_prepare_layouts ((GtkLabel **) labels->pdata, labels->len);
+
+  g_ptr_array_unref (labels);
+}
+
 /*
  * gtk_list_item_manager_release_list_item:
  * @self: a #GtkListItemManager
@@ -1112,7 +1086,7 @@ gtk_list_item_tracker_new (GtkListItemManager *self)
 
   tracker = g_slice_new0 (GtkListItemTracker);
 
-  tracker->position = GTK_INVALID_LIST_POSITION;
+  tracker->range.position = GTK_INVALID_LIST_POSITION;
 
   self->trackers = g_slist_prepend (self->trackers, tracker);
 
@@ -1153,9 +1127,9 @@ gtk_list_item_tracker_set_position (GtkListItemManager *self,
   if (position >= n_items)
     position = n_items - 1; /* for n_items == 0 this underflows to GTK_INVALID_LIST_POSITION */
 
-  tracker->position = position;
-  tracker->n_before = n_before;
-  tracker->n_after = n_after;
+  tracker->range.position = position;
+  tracker->range.n_before = n_before;
+  tracker->range.n_after = n_after;
 
   gtk_list_item_manager_ensure_items (self, NULL, G_MAXUINT);
 
@@ -1170,5 +1144,5 @@ guint
 gtk_list_item_tracker_get_position (GtkListItemManager *self,
                                     GtkListItemTracker *tracker)
 {
-  return tracker->position;
+  return tracker->range.position;
 }
@@ -0,0 +1,131 @@
+/* gtklistitemrange.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtklistitemrangeprivate.h"
+
+#include "gtktypes.h"
+
+/*
+ * gtk_list_item_range_get_span:
+ * @range: a #GtkListItemRange
+ * @n_items: the number of items in the model
+ * @out_start: (out): the first item in @range
+ * @out_n_items: (out): the number of items in @range
+ *
+ * Clamps @range to a model with @n_items items.
+ *
+ * Returns: %FALSE if @range doesn't have a valid position
+ **/
+gboolean
+gtk_list_item_range_get_span (const GtkListItemRange *range,
+                              guint                   n_items,
+                              guint                  *out_start,
+                              guint                  *out_n_items)
+{
+  if (range->position == GTK_INVALID_LIST_POSITION)
+    return FALSE;
+
+  /* This is magic I made up that is meant to be both
+   * correct and doesn't overflow when start and/or end are close to 0 or
+   * close to max.
+   * But beware, I didn't test it.
+   */
+  *out_n_items = range->n_before + range->n_after + 1;
+  *out_n_items = MIN (*out_n_items, n_items);
+
+  *out_start = MAX (range->position, range->n_before) - range->n_before;
+  *out_start = MIN (*out_start, n_items - *out_n_items);
+
+  return TRUE;
+}
+
+/*
+ * gtk_list_item_ranges_query:
+ * @ranges: (element-type GtkListItemRange): the ranges to check. The
+ *     elements may be larger structs that start with a #GtkListItemRange.
+ * @n_items: the number of items in the model
+ * @position: the item to query
+ * @out_n_items: (out): the number of items starting at @position that
+ *     share the result
+ * @out_tracked: (out): whether the item at @position is in any of @ranges
+ *
+ * Finds out whether the item at @position is part of any of @ranges
+ * and how far the answer stays the same.
+ **/
+void
+gtk_list_item_ranges_query (GSList   *ranges,
+                            guint     n_items,
+                            guint     position,
+                            guint    *out_n_items,
+                            gboolean *out_tracked)
+{
+  GSList *l;
+  guint range_start, range_n_items;
+
+  g_assert (position < n_items);
+
+  *out_tracked = FALSE;
+  *out_n_items = n_items - position;
+
+  /* step 1: Check if position is tracked */
+
+  for (l = ranges; l; l = l->next)
+    {
+      if (!gtk_list_item_range_get_span (l->data, n_items, &range_start, &range_n_items))
+        continue;
+
+      if (range_start > position)
+        {
+          *out_n_items = MIN (*out_n_items, range_start - position);
+        }
+      else if (range_start + range_n_items <= position)
+        {
+          /* do nothing */
+        }
+      else
+        {
+          *out_tracked = TRUE;
+          *out_n_items = range_start + range_n_items - position;
+          break;
+        }
+    }
+
+  /* If nothing's tracked, we're done */
+  if (!*out_tracked)
+    return;
+
+  /* step 2: make the tracked range as large as possible
+   * NB: This is O(N_RANGES^2), but the number of ranges should be <5 */
+restart:
+  for (l = ranges; l; l = l->next)
+    {
+      if (!gtk_list_item_range_get_span (l->data, n_items, &range_start, &range_n_items))
+        continue;
+
+      if (range_start + range_n_items <= position + *out_n_items)
+        continue;
+      if (range_start > position + *out_n_items)
+        continue;
+
+      if (*out_n_items + position < range_start + range_n_items)
+        {
+          *out_n_items = range_start + range_n_items - position;
+          goto restart;
+        }
+    }
+}
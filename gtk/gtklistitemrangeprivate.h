@@ -0,0 +1,48 @@
+/* gtklistitemrangeprivate.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_LIST_ITEM_RANGE_PRIVATE_H__
+#define __GTK_LIST_ITEM_RANGE_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GtkListItemRange GtkListItemRange;
+
+/* The items at @position and @n_before items before and @n_after
+ * items after it. This is what list item trackers keep alive.
+ */
+struct _GtkListItemRange
+{
+  guint position;
+  guint n_before;
+  guint n_after;
+};
+
+gboolean        gtk_list_item_range_get_span            (const GtkListItemRange *range,
+                                                         guint                   n_items,
+                                                         guint                  *out_start,
+                                                         guint                  *out_n_items);
+void            gtk_list_item_ranges_query              (GSList                 *ranges,
+                                                         guint                   n_items,
+                                                         guint                   position,
+                                                         guint                  *out_n_items,
+                                                         gboolean               *out_tracked);
+
+G_END_DECLS
+
+#endif /* __GTK_LIST_ITEM_RANGE_PRIVATE_H__ */
@@ -580,6 +580,8 @@ gtk_list_view_measure (GtkWidget      *widget,
 {
   GtkListView *self = GTK_LIST_VIEW (widget);
 
+  gtk_list_item_manager_prepare_items (self->item_manager);
+
   if (orientation == gtk_list_base_get_orientation (GTK_LIST_BASE (self)))
     gtk_list_view_measure_list (widget, orientation, for_size, minimum, natural);
   else
@@ -608,6 +610,8 @@ gtk_list_view_size_allocate (GtkWidget *widget,
   if (gtk_list_item_manager_get_root (self->item_manager) == NULL)
     return;
 
+  gtk_list_item_manager_prepare_items (self->item_manager);
+
   /* step 1: determine width of the list */
   gtk_widget_measure (widget, opposite_orientation,
                       -1,
@@ -26,8 +26,8 @@
 #include "gtkcssstyleprivate.h"
 #include "gtkintl.h"
 #include "gtkprivate.h"
-#include "gtkscalerprivate.h"
 #include "gtksnapshot.h"
+#include "gtktextureloaderprivate.h"
 #include "gtkwidgetprivate.h"
 
 /**
@@ -51,6 +51,12 @@
  * gdk_texture_new_from_file(), then create the #GtkPicture with
  * gtk_picture_new_for_paintable().
  *
+ * Loading large images can take a while. If #GtkPicture:load-async
+ * is set, files are loaded in the background and the picture stays
+ * empty until they are, so many pictures, like the ones in a grid of
+ * photos, don't block the user interface. Recently loaded files are
+ * shared between pictures showing the same file.
+ *
  * Sometimes an application will want to avoid depending on external data
  * files, such as image files. See the documentation of #GResource for details.
  * In this case, gtk_picture_new_for_resource() and gtk_picture_set_resource()
@@ -73,6 +79,7 @@ enum
   PROP_ALTERNATIVE_TEXT,
   PROP_KEEP_ASPECT_RATIO,
   PROP_CAN_SHRINK,
+  PROP_LOAD_ASYNC,
   NUM_PROPERTIES
 };
 
@@ -82,10 +89,12 @@ struct _GtkPicture
 
   GdkPaintable *paintable;
   GFile *file;
+  GCancellable *cancellable;
 
   char *alternative_text;
   guint keep_aspect_ratio : 1;
   guint can_shrink : 1;
+  guint load_async : 1;
 };
 
 struct _GtkPictureClass
@@ -236,6 +245,10 @@ gtk_picture_set_property (GObject      *object,
       gtk_picture_set_can_shrink (self, g_value_get_boolean (value));
       break;
 
+    case PROP_LOAD_ASYNC:
+      gtk_picture_set_load_async (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -272,17 +285,32 @@ gtk_picture_get_property (GObject     *object,
       g_value_set_boolean (value, self->can_shrink);
       break;
 
+    case PROP_LOAD_ASYNC:
+      g_value_set_boolean (value, self->load_async);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
     }
 }
 
+static void
+gtk_picture_cancel_load (GtkPicture *self)
+{
+  if (self->cancellable == NULL)
+    return;
+
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+}
+
 static void
 gtk_picture_dispose (GObject *object)
 {
   GtkPicture *self = GTK_PICTURE (object);
 
+  gtk_picture_cancel_load (self);
   gtk_picture_set_paintable (self, NULL);
 
   g_clear_object (&self->file);
@@ -366,6 +394,19 @@ gtk_picture_class_init (GtkPictureClass *class)
                             TRUE,
                             GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkPicture:load-async:
+   *
+   * Whether files set with gtk_picture_set_file() are loaded in
+   * the background.
+   */
+  properties[PROP_LOAD_ASYNC] =
+      g_param_spec_boolean ("load-async",
+                            P_("Load async"),
+                            P_("Load files in the background"),
+                            FALSE,
+                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   gtk_widget_class_set_css_name (widget_class, I_("picture"));
@@ -542,75 +583,27 @@ gtk_picture_new_for_resource (const char *resource_path)
   return result;
 }
 
-typedef struct {
-  int scale_factor;
-} LoaderData;
-
 static void
-on_loader_size_prepared (GdkPixbufLoader *loader,
-			 int              width,
-			 int              height,
-			 gpointer         user_data)
+load_done (GObject      *source,
+           GAsyncResult *result,
+           gpointer      data)
 {
-  LoaderData *loader_data = user_data;
-  GdkPixbufFormat *format;
+  GtkPicture *self = data;
+  GdkPaintable *paintable;
+  GError *error = NULL;
 
-  /* Let the regular icon helper code path handle non-scalable pictures */
-  format = gdk_pixbuf_loader_get_format (loader);
-  if (!gdk_pixbuf_format_is_scalable (format))
+  paintable = gtk_texture_loader_load_finish (result, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      loader_data->scale_factor = 1;
+      g_error_free (error);
       return;
     }
 
-  gdk_pixbuf_loader_set_size (loader,
-                              width * loader_data->scale_factor,
-                              height * loader_data->scale_factor);
-}
-
-static GdkPaintable *
-load_scalable_with_loader (GFile *file,
-                           int    scale_factor)
-{
-  GdkPixbufLoader *loader;
-  GBytes *bytes;
-  GdkPixbufAnimation *animation;
-  GdkPaintable *result, *scaler;
-  LoaderData loader_data;
-
-  result = NULL;
-
-  loader = gdk_pixbuf_loader_new ();
-  loader_data.scale_factor = scale_factor;
-
-  g_signal_connect (loader, "size-prepared", G_CALLBACK (on_loader_size_prepared), &loader_data);
-
-  bytes = g_file_load_bytes (file, NULL, NULL, NULL);
-  if (bytes == NULL)
-    goto out1;
-
-  if (!gdk_pixbuf_loader_write_bytes (loader, bytes, NULL))
-    goto out2;
+  g_clear_object (&self->cancellable);
+  g_clear_error (&error);
 
-  if (!gdk_pixbuf_loader_close (loader, NULL))
-    goto out2;
-
-  animation = gdk_pixbuf_loader_get_animation (loader);
-  if (animation == NULL)
-    goto out2;
-
-  result = GDK_PAINTABLE (gdk_texture_new_for_pixbuf (gdk_pixbuf_animation_get_static_image (animation)));
-  scaler = gtk_scaler_new (result, loader_data.scale_factor);
-  g_object_unref (result);
-  result = scaler;
-
-out2:
-  g_bytes_unref (bytes);
-out1:
-  gdk_pixbuf_loader_close (loader, NULL);
-  g_object_unref (loader);
-
-  return result;
+  gtk_picture_set_paintable (self, paintable);
+  g_clear_object (&paintable);
 }
 
 /**
@@ -627,6 +620,7 @@ gtk_picture_set_file (GtkPicture *self,
                       GFile      *file)
 {
   GdkPaintable *paintable;
+  int scale_factor;
 
   g_return_if_fail (GTK_IS_PICTURE (self));
   g_return_if_fail (file == NULL || G_IS_FILE (file));
@@ -639,10 +633,24 @@ gtk_picture_set_file (GtkPicture *self,
   g_set_object (&self->file, file);
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_FILE]);
 
-  paintable = load_scalable_with_loader (file, gtk_widget_get_scale_factor (GTK_WIDGET (self)));
+  scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (self));
+
+  if (file == NULL)
+    paintable = NULL;
+  else if (self->load_async)
+    paintable = gtk_texture_loader_lookup (file, scale_factor);
+  else
+    paintable = gtk_texture_loader_load (file, scale_factor);
+
   gtk_picture_set_paintable (self, paintable);
   g_clear_object (&paintable);
 
+  if (file && self->load_async && self->paintable == NULL)
+    {
+      self->cancellable = g_cancellable_new ();
+      gtk_texture_loader_load_async (file, scale_factor, self->cancellable, load_done, self);
+    }
+
   g_object_thaw_notify (G_OBJECT (self));
 }
 
@@ -793,6 +801,8 @@ gtk_picture_set_paintable (GtkPicture   *self,
   g_return_if_fail (GTK_IS_PICTURE (self));
   g_return_if_fail (paintable == NULL || GDK_IS_PAINTABLE (paintable));
 
+  gtk_picture_cancel_load (self);
+
   if (self->paintable == paintable)
     return;
 
@@ -946,6 +956,50 @@ gtk_picture_get_can_shrink (GtkPicture *self)
   return self->can_shrink;
 }
 
+/**
+ * gtk_picture_set_load_async:
+ * @self: a #GtkPicture
+ * @load_async: whether to load files in the background
+ *
+ * If set to %TRUE, files set with gtk_picture_set_file() and the
+ * functions calling it are loaded in the background. Until that is
+ * done, @self doesn't display anything.
+ *
+ * Files that were loaded in the background recently are displayed
+ * right away.
+ */
+void
+gtk_picture_set_load_async (GtkPicture *self,
+                            gboolean    load_async)
+{
+  g_return_if_fail (GTK_IS_PICTURE (self));
+
+  load_async = !!load_async;
+
+  if (self->load_async == load_async)
+    return;
+
+  self->load_async = load_async;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOAD_ASYNC]);
+}
+
+/**
+ * gtk_picture_get_load_async:
+ * @self: a #GtkPicture
+ *
+ * Returns whether @self loads files in the background.
+ *
+ * Returns: %TRUE if files are loaded in the background
+ */
+gboolean
+gtk_picture_get_load_async (GtkPicture *self)
+{
+  g_return_val_if_fail (GTK_IS_PICTURE (self), FALSE);
+
+  return self->load_async;
+}
+
 /**
  * gtk_picture_set_alternative_text:
  * @self: a #GtkPicture
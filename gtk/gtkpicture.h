@@ -79,6 +79,11 @@ void            gtk_picture_set_can_shrink              (GtkPicture
                                                          gboolean                can_shrink);
 GDK_AVAILABLE_IN_ALL
 gboolean        gtk_picture_get_can_shrink              (GtkPicture             *self);
+GDK_AVAILABLE_IN_ALL
+void            gtk_picture_set_load_async              (GtkPicture             *self,
+                                                         gboolean                load_async);
+GDK_AVAILABLE_IN_ALL
+gboolean        gtk_picture_get_load_async              (GtkPicture             *self);
 
 GDK_AVAILABLE_IN_ALL
 void            gtk_picture_set_alternative_text        (GtkPicture             *self,
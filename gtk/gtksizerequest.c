@@ -33,6 +33,8 @@
 #include "gtkcssnumbervalueprivate.h"
 #include "gtklayoutmanagerprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 
 #ifdef G_ENABLE_CONSISTENCY_CHECKS
 static GQuark recursion_check_quark = 0;
@@ -183,6 +185,7 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
       int css_extra_for_size;
       int css_extra_size;
       int widget_margins_for_size;
+      gint64 span_start = 0;
 
       style = gtk_css_node_get_style (gtk_widget_get_css_node (widget));
       get_box_margin (style, &margin);
@@ -210,6 +213,9 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
 
       GtkLayoutManager *layout_manager = gtk_widget_get_layout_manager (widget);
 
+      if (GDK_PROFILER_IS_RUNNING)
+        span_start = gdk_profiler_begin_type_span ();
+
       if (layout_manager != NULL)
         {
           if (for_size < 0)
@@ -290,6 +296,9 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
             }
         }
 
+      if (GDK_PROFILER_IS_RUNNING)
+        gdk_profiler_end_type_span (span_start, "measure", G_OBJECT_TYPE (widget));
+
       min_size = MAX (0, MAX (reported_min_size, css_min_size)) + css_extra_size;
       nat_size = MAX (0, MAX (reported_nat_size, css_min_size)) + css_extra_size;
 
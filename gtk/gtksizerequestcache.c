@@ -25,48 +25,103 @@
 
 #include <string.h>
 
+static SizeRequestCacheStats stats;
+
 void
 _gtk_size_request_cache_init (SizeRequestCache *cache)
 {
   memset (cache, 0, sizeof (SizeRequestCache));
+
+  cache->flags[GTK_ORIENTATION_HORIZONTAL].max_cached_requests = GTK_SIZE_REQUEST_CACHED_SIZES;
+  cache->flags[GTK_ORIENTATION_VERTICAL].max_cached_requests = GTK_SIZE_REQUEST_CACHED_SIZES;
 }
 
-static void
-free_sizes_x (SizeRequestX **sizes)
+void
+_gtk_size_request_cache_free (SizeRequestCache *cache)
 {
-  int i;
-
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestX, sizes[i]);
-
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
+  g_free (cache->requests_x);
+  g_free (cache->requests_y);
 }
 
+/* The number of slots only changes when a widget is probed for
+ * more sizes than fit, so it survives clearing the cache. If the
+ * widget did not need most of its slots since the last time the
+ * cache was cleared, we give some of them back.
+ */
 static void
-free_sizes_y (SizeRequestY **sizes)
+shrink_slots (SizeRequestCache *cache,
+              GtkOrientation    orientation)
 {
-  int i;
+  guint max = cache->flags[orientation].max_cached_requests;
 
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestY, sizes[i]);
+  if (max > GTK_SIZE_REQUEST_CACHED_SIZES &&
+      cache->flags[orientation].n_cached_requests <= max / 4)
+    {
+      max = MAX (max / 2, GTK_SIZE_REQUEST_CACHED_SIZES);
 
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
+      if (orientation == GTK_ORIENTATION_HORIZONTAL)
+        cache->requests_x = g_renew (SizeRequestX, cache->requests_x, max);
+      else
+        cache->requests_y = g_renew (SizeRequestY, cache->requests_y, max);
+    }
+
+  cache->flags[orientation].max_cached_requests = max;
+  cache->flags[orientation].n_cached_requests = 0;
+  cache->flags[orientation].last_cached_request = 0;
+  cache->flags[orientation].n_evictions = 0;
+  cache->flags[orientation].cached_size_valid = FALSE;
 }
 
 void
-_gtk_size_request_cache_free (SizeRequestCache *cache)
+_gtk_size_request_cache_clear (SizeRequestCache *cache)
 {
-  if (cache->requests_x)
-    free_sizes_x (cache->requests_x);
-  if (cache->requests_y)
-    free_sizes_y (cache->requests_y);
+  /* Keep the arrays around, the widget will most
+   * likely be measured again soon */
+  shrink_slots (cache, GTK_ORIENTATION_HORIZONTAL);
+  shrink_slots (cache, GTK_ORIENTATION_VERTICAL);
+
+  cache->request_mode_valid = FALSE;
 }
 
-void
-_gtk_size_request_cache_clear (SizeRequestCache *cache)
+/* Finds the slot for a new cache entry. If all slots are taken,
+ * the oldest entry is replaced; once a full cache worth of entries
+ * got replaced, the widget is being probed for more sizes than we
+ * can remember, and we grow the cache instead.
+ */
+static guint
+next_slot (SizeRequestCache *cache,
+           GtkOrientation    orientation,
+           gboolean         *grow)
 {
-  _gtk_size_request_cache_free (cache);
-  _gtk_size_request_cache_init (cache);
+  guint n_sizes = cache->flags[orientation].n_cached_requests;
+  guint max = cache->flags[orientation].max_cached_requests;
+
+  *grow = FALSE;
+
+  if (n_sizes == max)
+    {
+      if (cache->flags[orientation].n_evictions + 1 >= max &&
+          max < GTK_SIZE_REQUEST_MAX_CACHED_SIZES)
+        {
+          cache->flags[orientation].max_cached_requests = MIN (max * 2, GTK_SIZE_REQUEST_MAX_CACHED_SIZES);
+          cache->flags[orientation].n_evictions = 0;
+          *grow = TRUE;
+        }
+      else
+        {
+          cache->flags[orientation].n_evictions++;
+
+          if (++cache->flags[orientation].last_cached_request == max)
+            cache->flags[orientation].last_cached_request = 0;
+
+          return cache->flags[orientation].last_cached_request;
+        }
+    }
+
+  cache->flags[orientation].n_cached_requests++;
+  cache->flags[orientation].last_cached_request = cache->flags[orientation].n_cached_requests - 1;
+
+  return cache->flags[orientation].last_cached_request;
 }
 
 void
@@ -78,7 +133,8 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
                                 int               minimum_baseline,
                                 int               natural_baseline)
 {
-  guint         i, n_sizes;
+  guint         i, n_sizes, slot;
+  gboolean      grow;
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
@@ -112,44 +168,32 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
    */
   n_sizes = cache->flags[orientation].n_cached_requests;
 
-
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-      SizeRequestX **cached_sizes = cache->requests_x;
-      SizeRequestX  *cached_size;
+      SizeRequestX *cached_size;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size)
+          cached_size = &cache->requests_x[i];
+
+	  if (cached_size->cached_size.minimum_size == minimum_size &&
+	      cached_size->cached_size.natural_size == natural_size)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
+	      cached_size->lower_for_size = MIN (cached_size->lower_for_size, for_size);
+	      cached_size->upper_for_size = MAX (cached_size->upper_for_size, for_size);
 	      return;
 	    }
 	}
 
       /* If not found, pull a new size from the cache, the returned size cache
-       * will immediately be used to cache the new computed size so we go ahead
-       * and increment the last_cached_request right away */
-      if (n_sizes < GTK_SIZE_REQUEST_CACHED_SIZES)
-	{
-	  cache->flags[orientation].n_cached_requests++;
-	  cache->flags[orientation].last_cached_request = cache->flags[orientation].n_cached_requests - 1;
-	}
-      else
-	{
-	  if (++cache->flags[orientation].last_cached_request == GTK_SIZE_REQUEST_CACHED_SIZES)
-	    cache->flags[orientation].last_cached_request = 0;
-	}
-
-      if (cache->requests_x == NULL)
-	cache->requests_x = g_slice_alloc0 (sizeof (SizeRequestX *) * GTK_SIZE_REQUEST_CACHED_SIZES);
+       * will immediately be used to cache the new computed size */
+      slot = next_slot (cache, orientation, &grow);
 
-      if (cache->requests_x[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_x[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestX);
+      if (cache->requests_x == NULL || grow)
+        cache->requests_x = g_renew (SizeRequestX, cache->requests_x,
+                                     cache->flags[orientation].max_cached_requests);
 
-      cached_size = cache->requests_x[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_x[slot];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -157,43 +201,32 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
     }
   else
     {
-      SizeRequestY **cached_sizes = cache->requests_y;
-      SizeRequestY  *cached_size;
+      SizeRequestY *cached_size;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size &&
-	      cached_sizes[i]->cached_size.minimum_baseline == minimum_baseline &&
-	      cached_sizes[i]->cached_size.natural_baseline == natural_baseline)
+          cached_size = &cache->requests_y[i];
+
+	  if (cached_size->cached_size.minimum_size == minimum_size &&
+	      cached_size->cached_size.natural_size == natural_size &&
+	      cached_size->cached_size.minimum_baseline == minimum_baseline &&
+	      cached_size->cached_size.natural_baseline == natural_baseline)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
+	      cached_size->lower_for_size = MIN (cached_size->lower_for_size, for_size);
+	      cached_size->upper_for_size = MAX (cached_size->upper_for_size, for_size);
 	      return;
 	    }
 	}
 
       /* If not found, pull a new size from the cache, the returned size cache
-       * will immediately be used to cache the new computed size so we go ahead
-       * and increment the last_cached_request right away */
-      if (n_sizes < GTK_SIZE_REQUEST_CACHED_SIZES)
-	{
-	  cache->flags[orientation].n_cached_requests++;
-	  cache->flags[orientation].last_cached_request = cache->flags[orientation].n_cached_requests - 1;
-	}
-      else
-	{
-	  if (++cache->flags[orientation].last_cached_request == GTK_SIZE_REQUEST_CACHED_SIZES)
-	    cache->flags[orientation].last_cached_request = 0;
-	}
-
-      if (cache->requests_y == NULL)
-	cache->requests_y = g_slice_alloc0 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES);
+       * will immediately be used to cache the new computed size */
+      slot = next_slot (cache, orientation, &grow);
 
-      if (cache->requests_y[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_y[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestY);
+      if (cache->requests_y == NULL || grow)
+        cache->requests_y = g_renew (SizeRequestY, cache->requests_y,
+                                     cache->flags[orientation].max_cached_requests);
 
-      cached_size = cache->requests_y[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_y[slot];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -229,9 +262,11 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 
               *minimum = result->minimum_size;
               *natural = result->natural_size;
+              stats.hits++;
               return TRUE;
             }
 
+          stats.misses++;
           return FALSE;
         }
       else
@@ -239,7 +274,7 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 	  /* Search for an already cached size */
           for (i = 0, p = cache->flags[GTK_ORIENTATION_HORIZONTAL].n_cached_requests; i < p; i++)
             {
-              const SizeRequestX *cur = cache->requests_x[i];
+              const SizeRequestX *cur = &cache->requests_x[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -248,11 +283,12 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 
                   *minimum = result->minimum_size;
                   *natural = result->natural_size;
-
+                  stats.hits++;
                   return TRUE;
                 }
             }
 
+          stats.misses++;
           return FALSE;
 	}
     }
@@ -268,9 +304,11 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
               *natural = result->natural_size;
               *minimum_baseline = result->minimum_baseline;
               *natural_baseline = result->natural_baseline;
+              stats.hits++;
               return TRUE;
             }
 
+          stats.misses++;
           return FALSE;
         }
       else
@@ -278,7 +316,7 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 	  /* Search for an already cached size */
           for (i = 0, p = cache->flags[GTK_ORIENTATION_VERTICAL].n_cached_requests; i < p; i++)
             {
-              const SizeRequestY *cur = cache->requests_y[i];
+              const SizeRequestY *cur = &cache->requests_y[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -289,12 +327,27 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
                   *natural = result->natural_size;
                   *minimum_baseline = result->minimum_baseline;
                   *natural_baseline = result->natural_baseline;
+                  stats.hits++;
                   return TRUE;
                 }
             }
 
+          stats.misses++;
           return FALSE;
         }
     }
 }
 
+guint
+_gtk_size_request_cache_get_n_slots (const SizeRequestCache *cache,
+                                     GtkOrientation          orientation)
+{
+  return cache->flags[orientation].max_cached_requests;
+}
+
+/* Counters for the inspector */
+SizeRequestCacheStats *
+_gtk_size_request_cache_get_stats (void)
+{
+  return &stats;
+}
@@ -35,8 +35,13 @@ G_BEGIN_DECLS
  * for a said widget to have, if a label can
  * only wrap to 3 lines, only 3 caches will
  * ever be allocated for it.
+ *
+ * Widgets that get probed for more sizes than
+ * that, like wrapping labels in a flow box, get
+ * a bigger cache, up to the maximum.
  */
-#define GTK_SIZE_REQUEST_CACHED_SIZES   (5)
+#define GTK_SIZE_REQUEST_CACHED_SIZES     (5)
+#define GTK_SIZE_REQUEST_MAX_CACHED_SIZES (40)
 
 typedef struct {
   int minimum_size;
@@ -65,8 +70,8 @@ typedef struct
 } SizeRequestY;
 
 typedef struct {
-  SizeRequestX **requests_x;
-  SizeRequestY **requests_y;
+  SizeRequestX *requests_x;
+  SizeRequestY *requests_y;
 
   CachedSizeX  cached_size_x;
   CachedSizeY  cached_size_y;
@@ -74,12 +79,21 @@ typedef struct {
   GtkSizeRequestMode request_mode   : 3;
   guint       request_mode_valid    : 1;
   struct {
-    guint       n_cached_requests   : 3;
-    guint       last_cached_request : 3;
+    guint       n_cached_requests   : 6;
+    guint       last_cached_request : 6;
+    guint       max_cached_requests : 6;
+    guint       n_evictions         : 6;
     guint       cached_size_valid   : 1;
   }           flags[2];
 } SizeRequestCache;
 
+typedef struct {
+  guint64 hits;
+  guint64 misses;
+  guint64 shared_hits;
+  guint64 shared_misses;
+} SizeRequestCacheStats;
+
 void            _gtk_size_request_cache_init                    (SizeRequestCache       *cache);
 void            _gtk_size_request_cache_free                    (SizeRequestCache       *cache);
 
@@ -99,6 +113,11 @@ gboolean        _gtk_size_request_cache_lookup                  (const SizeReque
                                                                  int                    *minimum_baseline,
                                                                  int                    *natural_baseline);
 
+SizeRequestCacheStats *
+                _gtk_size_request_cache_get_stats               (void);
+guint           _gtk_size_request_cache_get_n_slots             (const SizeRequestCache *cache,
+                                                                 GtkOrientation          orientation);
+
 G_END_DECLS
 
 #endif /* __GTK_SIZE_REQUEST_CACHE_PRIVATE_H__ */
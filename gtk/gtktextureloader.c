@@ -0,0 +1,489 @@
+/* gtktextureloader.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtktextureloaderprivate.h"
+
+#include "gtkscalerprivate.h"
+#include "gdk/gdkprofilerprivate.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+/* Loads image files into textures for GtkPicture and GtkImage.
+ *
+ * Asynchronous loads are decoded by a small pool of threads, so a
+ * view full of pictures can't occupy all of GLib's worker threads.
+ * The textures they produce are kept in a cache that is only used
+ * from the main thread, and that drops the least recently used
+ * textures once they take more than MAX_CACHE_SIZE bytes.
+ *
+ * Cached textures of local files remember the etag that the file had
+ * when it was loaded, and are dropped when it changes. Other files
+ * are too expensive to check on every lookup, so their textures stay
+ * cached until they are pushed out.
+ */
+
+#define MAX_LOADER_THREADS 4
+#define MAX_CACHE_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+  GFile *file;
+  int scale_factor;
+  guint hash;
+
+  GdkTexture *texture;
+  int texture_scale;
+  char *etag;
+  gsize size;
+
+  GList link;
+} CacheEntry;
+
+typedef struct {
+  GFile *file;
+  int scale_factor;
+
+  GdkTexture *texture;
+  int texture_scale;
+  char *etag;
+  GError *error;
+} LoadData;
+
+static GHashTable *cache;
+static GQueue lru = G_QUEUE_INIT;
+static gsize cache_size;
+
+static guint
+cache_entry_hash (gconstpointer data)
+{
+  const CacheEntry *entry = data;
+
+  return entry->hash;
+}
+
+static gboolean
+cache_entry_equal (gconstpointer a,
+                   gconstpointer b)
+{
+  const CacheEntry *entry_a = a;
+  const CacheEntry *entry_b = b;
+
+  return entry_a->hash == entry_b->hash &&
+         entry_a->scale_factor == entry_b->scale_factor &&
+         g_file_equal (entry_a->file, entry_b->file);
+}
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  g_queue_unlink (&lru, &entry->link);
+  cache_size -= entry->size;
+
+  g_object_unref (entry->file);
+  g_object_unref (entry->texture);
+  g_free (entry->etag);
+  g_slice_free (CacheEntry, entry);
+}
+
+static void
+cache_entry_init_key (CacheEntry *key,
+                      GFile      *file,
+                      int         scale_factor)
+{
+  key->file = file;
+  key->scale_factor = scale_factor;
+  key->hash = g_file_hash (file) ^ ((guint) scale_factor << 24);
+}
+
+static void
+cache_insert (GFile      *file,
+              int         scale_factor,
+              GdkTexture *texture,
+              int         texture_scale,
+              const char *etag)
+{
+  CacheEntry *entry;
+
+  entry = g_slice_new0 (CacheEntry);
+  cache_entry_init_key (entry, g_object_ref (file), scale_factor);
+  entry->texture = g_object_ref (texture);
+  entry->texture_scale = texture_scale;
+  entry->etag = g_strdup (etag);
+  entry->size = (gsize) gdk_texture_get_width (texture) * gdk_texture_get_height (texture) * 4;
+  entry->link.data = entry;
+
+  /* Textures larger than the whole cache would just flush it */
+  if (entry->size > MAX_CACHE_SIZE)
+    {
+      g_object_unref (entry->file);
+      g_object_unref (entry->texture);
+      g_free (entry->etag);
+      g_slice_free (CacheEntry, entry);
+      return;
+    }
+
+  if (cache == NULL)
+    cache = g_hash_table_new_full (cache_entry_hash, cache_entry_equal, NULL, cache_entry_free);
+
+  g_hash_table_remove (cache, entry);
+
+  g_queue_push_head_link (&lru, &entry->link);
+  cache_size += entry->size;
+  g_hash_table_add (cache, entry);
+
+  while (cache_size > MAX_CACHE_SIZE)
+    g_hash_table_remove (cache, g_queue_peek_tail (&lru));
+}
+
+/* Can be called from any thread.
+ * Returns NULL for files that aren't local or can't be queried.
+ */
+static char *
+get_file_etag (GFile        *file,
+               GCancellable *cancellable)
+{
+  GFileInfo *info;
+  char *etag;
+
+  if (!g_file_is_native (file))
+    return NULL;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_ETAG_VALUE,
+                            G_FILE_QUERY_INFO_NONE,
+                            cancellable,
+                            NULL);
+  if (info == NULL)
+    return NULL;
+
+  etag = g_strdup (g_file_info_get_etag (info));
+  g_object_unref (info);
+
+  return etag;
+}
+
+typedef struct {
+  int scale_factor;
+} LoaderData;
+
+static void
+on_loader_size_prepared (GdkPixbufLoader *loader,
+                         int              width,
+                         int              height,
+                         gpointer         user_data)
+{
+  LoaderData *loader_data = user_data;
+  GdkPixbufFormat *format;
+
+  /* Let the regular icon helper code path handle non-scalable pictures */
+  format = gdk_pixbuf_loader_get_format (loader);
+  if (!gdk_pixbuf_format_is_scalable (format))
+    {
+      loader_data->scale_factor = 1;
+      return;
+    }
+
+  gdk_pixbuf_loader_set_size (loader,
+                              width * loader_data->scale_factor,
+                              height * loader_data->scale_factor);
+}
+
+/* Can be called from any thread */
+static GdkTexture *
+decode_file (GFile         *file,
+             int            scale_factor,
+             int           *texture_scale,
+             char         **etag,
+             GCancellable  *cancellable,
+             GError       **error)
+{
+  GdkPixbufLoader *loader;
+  GBytes *bytes;
+  GdkPixbufAnimation *animation;
+  GdkTexture *result;
+  LoaderData loader_data;
+  gint64 before;
+
+  before = g_get_monotonic_time ();
+  result = NULL;
+
+  loader = gdk_pixbuf_loader_new ();
+  loader_data.scale_factor = scale_factor;
+
+  g_signal_connect (loader, "size-prepared", G_CALLBACK (on_loader_size_prepared), &loader_data);
+
+  /* Query this before reading, so that a change while
+   * we read makes the cached texture outdated
+   */
+  if (etag)
+    *etag = get_file_etag (file, cancellable);
+
+  bytes = g_file_load_bytes (file, cancellable, NULL, error);
+  if (bytes == NULL)
+    goto out1;
+
+  if (!gdk_pixbuf_loader_write_bytes (loader, bytes, error))
+    goto out2;
+
+  if (!gdk_pixbuf_loader_close (loader, error))
+    goto out2;
+
+  animation = gdk_pixbuf_loader_get_animation (loader);
+  if (animation == NULL)
+    goto out2;
+
+  result = gdk_texture_new_for_pixbuf (gdk_pixbuf_animation_get_static_image (animation));
+  *texture_scale = loader_data.scale_factor;
+
+  if (GDK_PROFILER_IS_RUNNING)
+    {
+      char *uri = g_file_get_uri (file);
+      gdk_profiler_end_markf (before, "texture load", "%s@%d", uri, scale_factor);
+      g_free (uri);
+    }
+
+out2:
+  g_bytes_unref (bytes);
+out1:
+  gdk_pixbuf_loader_close (loader, NULL);
+  g_object_unref (loader);
+
+  if (result == NULL && error && *error == NULL)
+    g_set_error (error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE,
+                 "Failed to load image");
+
+  return result;
+}
+
+static GdkPaintable *
+create_paintable (GdkTexture *texture,
+                  int         texture_scale)
+{
+  return gtk_scaler_new (GDK_PAINTABLE (texture), texture_scale);
+}
+
+/*< private >
+ * gtk_texture_loader_lookup:
+ * @file: the file to look up
+ * @scale_factor: the scale factor to load scalable images at
+ *
+ * Looks for a texture for @file that was loaded with
+ * gtk_texture_loader_load_async() and is still cached. Textures
+ * of local files are only returned if the file hasn't changed
+ * since it was loaded.
+ *
+ * Returns: (transfer full) (nullable): a paintable for the cached
+ *   texture, or %NULL if it isn't cached
+ */
+GdkPaintable *
+gtk_texture_loader_lookup (GFile *file,
+                           int    scale_factor)
+{
+  CacheEntry key, *entry;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  if (cache == NULL)
+    return NULL;
+
+  cache_entry_init_key (&key, file, scale_factor);
+  entry = g_hash_table_lookup (cache, &key);
+  if (entry == NULL)
+    return NULL;
+
+  if (g_file_is_native (file))
+    {
+      char *etag = get_file_etag (file, NULL);
+      gboolean changed = g_strcmp0 (etag, entry->etag) != 0;
+
+      g_free (etag);
+
+      if (changed)
+        {
+          g_hash_table_remove (cache, entry);
+          return NULL;
+        }
+    }
+
+  g_queue_unlink (&lru, &entry->link);
+  g_queue_push_head_link (&lru, &entry->link);
+
+  return create_paintable (entry->texture, entry->texture_scale);
+}
+
+/*< private >
+ * gtk_texture_loader_load:
+ * @file: the file to load
+ * @scale_factor: the scale factor to load scalable images at
+ *
+ * Loads @file right away, using a cached texture if there is one.
+ * The result is not added to the cache.
+ *
+ * Returns: (transfer full) (nullable): a paintable for the contents
+ *   of @file, or %NULL if it could not be loaded
+ */
+GdkPaintable *
+gtk_texture_loader_load (GFile *file,
+                         int    scale_factor)
+{
+  GdkPaintable *result;
+  GdkTexture *texture;
+  int texture_scale;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  result = gtk_texture_loader_lookup (file, scale_factor);
+  if (result)
+    return result;
+
+  texture = decode_file (file, scale_factor, &texture_scale, NULL, NULL, NULL);
+  if (texture == NULL)
+    return NULL;
+
+  result = create_paintable (texture, texture_scale);
+  g_object_unref (texture);
+
+  return result;
+}
+
+static void
+load_data_free (gpointer data)
+{
+  LoadData *load = data;
+
+  g_object_unref (load->file);
+  g_clear_object (&load->texture);
+  g_free (load->etag);
+  g_clear_error (&load->error);
+  g_slice_free (LoadData, load);
+}
+
+static gboolean
+load_done (gpointer data)
+{
+  GTask *task = data;
+  LoadData *load = g_task_get_task_data (task);
+
+  if (load->texture)
+    {
+      /* Cache it even if the load was cancelled, chances are that the
+       * file gets shown again soon, eg when scrolling back.
+       */
+      cache_insert (load->file, load->scale_factor, load->texture, load->texture_scale, load->etag);
+
+      g_task_return_pointer (task,
+                             create_paintable (load->texture, load->texture_scale),
+                             g_object_unref);
+    }
+  else
+    {
+      g_task_return_error (task, g_steal_pointer (&load->error));
+    }
+
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+load_thread (gpointer data,
+             gpointer user_data)
+{
+  GTask *task = data;
+  LoadData *load = g_task_get_task_data (task);
+  GCancellable *cancellable = g_task_get_cancellable (task);
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, &load->error))
+    {
+      g_main_context_invoke (g_task_get_context (task), load_done, task);
+      return;
+    }
+
+  load->texture = decode_file (load->file,
+                               load->scale_factor,
+                               &load->texture_scale,
+                               &load->etag,
+                               cancellable,
+                               &load->error);
+
+  g_main_context_invoke (g_task_get_context (task), load_done, task);
+}
+
+/*< private >
+ * gtk_texture_loader_load_async:
+ * @file: the file to load
+ * @scale_factor: the scale factor to load scalable images at
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the texture is loaded
+ * @user_data: data to pass to @callback
+ *
+ * Loads @file on a worker thread. Call gtk_texture_loader_lookup()
+ * first to avoid loading it again if it is still cached.
+ *
+ * This must be called from the main thread.
+ */
+void
+gtk_texture_loader_load_async (GFile               *file,
+                               int                  scale_factor,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  static GThreadPool *pool;
+  LoadData *load;
+  GTask *task;
+
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  if (G_UNLIKELY (pool == NULL))
+    pool = g_thread_pool_new (load_thread, NULL,
+                              MIN (g_get_num_processors (), MAX_LOADER_THREADS),
+                              FALSE, NULL);
+
+  load = g_slice_new0 (LoadData);
+  load->file = g_object_ref (file);
+  load->scale_factor = scale_factor;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gtk_texture_loader_load_async);
+  g_task_set_task_data (task, load, load_data_free);
+
+  g_thread_pool_push (pool, task, NULL);
+}
+
+/*< private >
+ * gtk_texture_loader_load_finish:
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for an error
+ *
+ * Finishes a load started with gtk_texture_loader_load_async().
+ *
+ * Returns: (transfer full) (nullable): a paintable for the contents
+ *   of the file, or %NULL on error
+ */
+GdkPaintable *
+gtk_texture_loader_load_finish (GAsyncResult  *result,
+                                GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gtk_texture_loader_load_async, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,38 @@
+/* gtktextureloaderprivate.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_TEXTURE_LOADER_PRIVATE_H__
+#define __GTK_TEXTURE_LOADER_PRIVATE_H__
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+GdkPaintable *  gtk_texture_loader_load         (GFile                  *file,
+                                                 int                     scale_factor);
+GdkPaintable *  gtk_texture_loader_lookup       (GFile                  *file,
+                                                 int                     scale_factor);
+void            gtk_texture_loader_load_async   (GFile                  *file,
+                                                 int                     scale_factor,
+                                                 GCancellable           *cancellable,
+                                                 GAsyncReadyCallback     callback,
+                                                 gpointer                user_data);
+GdkPaintable *  gtk_texture_loader_load_finish  (GAsyncResult           *result,
+                                                 GError                **error);
+
+G_END_DECLS
+
+#endif /* __GTK_TEXTURE_LOADER_PRIVATE_H__ */
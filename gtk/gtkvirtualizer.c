@@ -0,0 +1,566 @@
+/* gtkvirtualizer.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkvirtualizerprivate.h"
+
+#include "gtkmain.h"
+
+#include <math.h>
+#include <string.h>
+
+static void     gtk_virtualizer_adjustment_value_changed        (GtkAdjustment  *adjustment,
+                                                                 GtkVirtualizer *self);
+
+void
+gtk_virtualizer_init (GtkVirtualizer           *self,
+                      GtkWidget                *widget,
+                      GtkVirtualizerUpdateFunc  update_func)
+{
+  memset (self, 0, sizeof (GtkVirtualizer));
+
+  self->widget = widget;
+  self->update_func = update_func;
+  self->allocated = g_array_new (FALSE, FALSE, sizeof (GtkVirtualizerLine));
+}
+
+void
+gtk_virtualizer_finish (GtkVirtualizer *self)
+{
+  gtk_virtualizer_set_adjustment (self, NULL, FALSE);
+  g_clear_handle_id (&self->update_id, g_source_remove);
+  g_clear_pointer (&self->allocated, g_array_unref);
+}
+
+static double
+gtk_virtualizer_get_value (GtkVirtualizer *self)
+{
+  double value;
+
+  value = gtk_adjustment_get_value (self->adjustment);
+  if (self->inverted)
+    value = gtk_adjustment_get_upper (self->adjustment)
+            - gtk_adjustment_get_page_size (self->adjustment)
+            - value;
+
+  return MAX (value, 0);
+}
+
+/* Moves the adjustment without picking a new anchor */
+static void
+gtk_virtualizer_set_value (GtkVirtualizer *self,
+                           double          value)
+{
+  if (self->inverted)
+    value = gtk_adjustment_get_upper (self->adjustment)
+            - gtk_adjustment_get_page_size (self->adjustment)
+            - value;
+
+  g_signal_handlers_block_by_func (self->adjustment, gtk_virtualizer_adjustment_value_changed, self);
+  gtk_adjustment_set_value (self->adjustment, value);
+  g_signal_handlers_unblock_by_func (self->adjustment, gtk_virtualizer_adjustment_value_changed, self);
+}
+
+/* Estimates where @line starts from the lines of the last allocation */
+static int
+gtk_virtualizer_get_line_offset (GtkVirtualizer *self,
+                                 guint           line)
+{
+  gboolean found_before;
+  guint i;
+  int offset;
+
+  offset = line * self->estimated_size;
+  found_before = FALSE;
+
+  for (i = 0; i < self->allocated->len; i++)
+    {
+      const GtkVirtualizerLine *l = &g_array_index (self->allocated, GtkVirtualizerLine, i);
+
+      if (l->line == line)
+        return l->offset;
+
+      if (l->line > line)
+        {
+          if (!found_before)
+            offset = MAX (0, l->offset - (int) (l->line - line) * self->estimated_size);
+          break;
+        }
+
+      offset = l->offset + l->size + (int) (line - l->line - 1) * self->estimated_size;
+      found_before = TRUE;
+    }
+
+  return offset;
+}
+
+/* Picks the line at @value as the new anchor */
+static void
+gtk_virtualizer_anchor_at (GtkVirtualizer *self,
+                           int             value)
+{
+  guint i, gap_line;
+  int gap_offset;
+
+  if (self->n_lines == 0)
+    return;
+
+  gap_offset = 0;
+  gap_line = 0;
+
+  for (i = 0; i < self->allocated->len; i++)
+    {
+      const GtkVirtualizerLine *l = &g_array_index (self->allocated, GtkVirtualizerLine, i);
+
+      if (value < l->offset)
+        {
+          /* The value is in the space of the lines that don't
+           * exist in front of this one.
+           */
+          if (l->line > gap_line)
+            {
+              self->window.position = gap_line + (guint) ((double) (value - gap_offset) / (l->offset - gap_offset) *
+                                                          (l->line - gap_line));
+              self->anchor_offset = value;
+            }
+          else
+            {
+              self->window.position = l->line;
+              self->anchor_offset = l->offset;
+            }
+          return;
+        }
+
+      if (value < l->offset + l->size)
+        {
+          self->window.position = l->line;
+          self->anchor_offset = l->offset;
+          return;
+        }
+
+      gap_offset = l->offset + l->size;
+      gap_line = l->line + 1;
+    }
+
+  if (gap_line < self->n_lines)
+    {
+      self->window.position = gap_line + (value - gap_offset) / MAX (1, self->estimated_size);
+      self->window.position = MIN (self->window.position, self->n_lines - 1);
+      self->anchor_offset = value;
+    }
+  else
+    {
+      self->window.position = self->n_lines - 1;
+      self->anchor_offset = gtk_virtualizer_get_line_offset (self, self->window.position);
+    }
+}
+
+static void
+gtk_virtualizer_adjustment_value_changed (GtkAdjustment  *adjustment,
+                                          GtkVirtualizer *self)
+{
+  /* This is emitted during the allocation of our parent, so we
+   * can't create or destroy children here.
+   */
+  self->needs_anchor = TRUE;
+  gtk_virtualizer_queue_update (self);
+}
+
+static void
+gtk_virtualizer_adjustment_changed (GtkAdjustment  *adjustment,
+                                    GtkVirtualizer *self)
+{
+  /* The page size may have changed */
+  gtk_virtualizer_queue_update (self);
+}
+
+/*
+ * gtk_virtualizer_set_adjustment:
+ * @self: a #GtkVirtualizer
+ * @adjustment: (nullable): the adjustment that scrolls the lines
+ * @inverted: whether the adjustment goes from the last line
+ *     to the first, as it does for right-to-left layouts
+ *
+ * Sets the adjustment that decides which lines are visible.
+ * Without an adjustment, all lines are created.
+ **/
+void
+gtk_virtualizer_set_adjustment (GtkVirtualizer *self,
+                                GtkAdjustment  *adjustment,
+                                gboolean        inverted)
+{
+  self->inverted = inverted;
+
+  if (self->adjustment == adjustment)
+    return;
+
+  if (self->adjustment)
+    {
+      g_signal_handlers_disconnect_by_func (self->adjustment, gtk_virtualizer_adjustment_value_changed, self);
+      g_signal_handlers_disconnect_by_func (self->adjustment, gtk_virtualizer_adjustment_changed, self);
+      g_clear_object (&self->adjustment);
+    }
+
+  if (adjustment)
+    {
+      self->adjustment = g_object_ref (adjustment);
+      g_signal_connect (adjustment, "value-changed",
+                        G_CALLBACK (gtk_virtualizer_adjustment_value_changed), self);
+      g_signal_connect (adjustment, "changed",
+                        G_CALLBACK (gtk_virtualizer_adjustment_changed), self);
+    }
+
+  gtk_virtualizer_queue_update (self);
+}
+
+/*
+ * gtk_virtualizer_reset:
+ * @self: a #GtkVirtualizer
+ * @n_lines: the new number of lines
+ *
+ * Forgets everything about the previous lines and anchors
+ * the first line at the start.
+ **/
+void
+gtk_virtualizer_reset (GtkVirtualizer *self,
+                       guint           n_lines)
+{
+  self->n_lines = n_lines;
+  self->window.position = 0;
+  self->anchor_offset = 0;
+  self->needs_anchor = FALSE;
+  g_array_set_size (self->allocated, 0);
+}
+
+/*
+ * gtk_virtualizer_set_n_lines:
+ * @self: a #GtkVirtualizer
+ * @n_lines: the new number of lines
+ * @anchor: the line to anchor at the current anchor offset
+ *
+ * Sets a new number of lines after the lines have been
+ * rearranged, like when the number of items per line changed.
+ **/
+void
+gtk_virtualizer_set_n_lines (GtkVirtualizer *self,
+                             guint           n_lines,
+                             guint           anchor)
+{
+  self->n_lines = n_lines;
+  self->window.position = MIN (anchor, n_lines - MIN (n_lines, 1));
+  g_array_set_size (self->allocated, 0);
+
+  gtk_virtualizer_queue_update (self);
+}
+
+/*
+ * gtk_virtualizer_items_changed:
+ * @self: a #GtkVirtualizer
+ * @position: the first changed line
+ * @removed: the number of removed lines
+ * @added: the number of added lines
+ *
+ * Updates the lines after a change in the model. The anchor is kept
+ * on the same line unless that line was removed.
+ **/
+void
+gtk_virtualizer_items_changed (GtkVirtualizer *self,
+                               guint           position,
+                               guint           removed,
+                               guint           added)
+{
+  guint i;
+
+  self->n_lines = self->n_lines - removed + added;
+
+  if (self->window.position >= position + removed)
+    self->window.position += added - removed;
+  else if (self->window.position >= position)
+    self->window.position = position;
+
+  if (self->window.position >= self->n_lines)
+    self->window.position = self->n_lines - MIN (self->n_lines, 1);
+
+  i = 0;
+  while (i < self->allocated->len)
+    {
+      GtkVirtualizerLine *l = &g_array_index (self->allocated, GtkVirtualizerLine, i);
+
+      if (l->line >= position + removed)
+        l->line += added - removed;
+      else if (l->line >= position)
+        {
+          g_array_remove_index (self->allocated, i);
+          continue;
+        }
+
+      i++;
+    }
+
+  gtk_virtualizer_queue_update (self);
+}
+
+guint
+gtk_virtualizer_get_anchor (GtkVirtualizer *self)
+{
+  return self->window.position;
+}
+
+int
+gtk_virtualizer_get_estimated_size (GtkVirtualizer *self)
+{
+  return self->estimated_size;
+}
+
+/*
+ * gtk_virtualizer_scroll_to:
+ * @self: a #GtkVirtualizer
+ * @line: the line to show
+ *
+ * Moves the adjustment to the estimated offset of @line,
+ * for lines that haven't been allocated yet.
+ **/
+void
+gtk_virtualizer_scroll_to (GtkVirtualizer *self,
+                           guint           line)
+{
+  self->window.position = line;
+  self->anchor_offset = gtk_virtualizer_get_line_offset (self, line);
+  self->needs_anchor = FALSE;
+
+  gtk_virtualizer_queue_update (self);
+  gtk_widget_queue_resize (self->widget);
+
+  if (self->adjustment)
+    gtk_virtualizer_set_value (self, self->anchor_offset);
+}
+
+static gboolean
+gtk_virtualizer_update_cb (gpointer data)
+{
+  GtkVirtualizer *self = data;
+
+  self->update_id = 0;
+  gtk_virtualizer_update (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * gtk_virtualizer_queue_update:
+ * @self: a #GtkVirtualizer
+ *
+ * Makes sure the lines are updated before the next layout.
+ **/
+void
+gtk_virtualizer_queue_update (GtkVirtualizer *self)
+{
+  /* Nothing to do after gtk_virtualizer_finish() */
+  if (self->update_id != 0 || self->allocated == NULL)
+    return;
+
+  self->update_id = g_idle_add_full (GTK_PRIORITY_RESIZE - 2,
+                                     gtk_virtualizer_update_cb,
+                                     self,
+                                     NULL);
+  g_source_set_name_by_id (self->update_id, "[gtk] gtk_virtualizer_update_cb");
+}
+
+/*
+ * gtk_virtualizer_update:
+ * @self: a #GtkVirtualizer
+ *
+ * Picks a new anchor if the adjustment was moved and calls
+ * the update function for the lines around it.
+ **/
+void
+gtk_virtualizer_update (GtkVirtualizer *self)
+{
+  guint start, n_lines;
+
+  g_clear_handle_id (&self->update_id, g_source_remove);
+
+  if (self->adjustment == NULL)
+    {
+      /* Without a viewport we can't tell what is visible */
+      self->update_func (self->widget, 0, self->n_lines);
+      return;
+    }
+
+  if (self->needs_anchor)
+    {
+      self->needs_anchor = FALSE;
+      gtk_virtualizer_anchor_at (self, gtk_virtualizer_get_value (self));
+    }
+
+  self->window.n_before = GTK_VIRTUALIZER_EXTRA_LINES;
+  if (self->estimated_size > 0)
+    self->window.n_after = ceil (gtk_adjustment_get_page_size (self->adjustment) / self->estimated_size)
+                           + GTK_VIRTUALIZER_EXTRA_LINES;
+  else
+    self->window.n_after = GTK_VIRTUALIZER_INITIAL_LINES;
+
+  if (!gtk_list_item_range_get_span (&self->window, self->n_lines, &start, &n_lines))
+    {
+      start = 0;
+      n_lines = 0;
+    }
+
+  self->update_func (self->widget, start, n_lines);
+}
+
+/* Lays out the lines: existing lines are stacked as usual, lines
+ * that don't exist take up @estimate each, and the space before the
+ * first line is picked so that the anchor line stays at anchor_offset.
+ * @shift is set to how far the anchor line had to be moved to not
+ * leave a gap at the start.
+ *
+ * Returns: the size of all lines
+ */
+static int
+gtk_virtualizer_layout (GtkVirtualizer     *self,
+                        GtkVirtualizerLine *lines,
+                        guint               n_lines,
+                        int                *estimate_out,
+                        int                *shift_out)
+{
+  guint i, n_sized, first_line, next_line;
+  int estimate, size, offset, anchor_offset, start;
+  gboolean found_anchor;
+
+  size = 0;
+  n_sized = 0;
+  for (i = 0; i < n_lines; i++)
+    {
+      if (lines[i].size <= 0)
+        continue;
+
+      size += lines[i].size;
+      n_sized++;
+    }
+
+  if (n_sized > 0)
+    estimate = (size + n_sized - 1) / n_sized;
+  else
+    estimate = self->estimated_size;
+
+  first_line = n_lines > 0 ? lines[0].line : self->n_lines;
+  next_line = first_line;
+  offset = 0;
+  anchor_offset = 0;
+  found_anchor = FALSE;
+
+  for (i = 0; i < n_lines; i++)
+    {
+      guint line = lines[i].line;
+
+      if (!found_anchor && self->window.position < line)
+        {
+          anchor_offset = offset + ((int) self->window.position - (int) next_line) * estimate;
+          found_anchor = TRUE;
+        }
+
+      offset += (int) (line - next_line) * estimate;
+
+      if (!found_anchor && self->window.position == line)
+        {
+          anchor_offset = offset;
+          found_anchor = TRUE;
+        }
+
+      lines[i].offset = offset;
+      offset += lines[i].size;
+      next_line = line + 1;
+    }
+
+  if (!found_anchor)
+    anchor_offset = offset + ((int) self->window.position - (int) next_line) * estimate;
+
+  if (self->n_lines > next_line)
+    offset += (int) (self->n_lines - next_line) * estimate;
+
+  start = self->anchor_offset - anchor_offset;
+  if (first_line == 0)
+    *shift_out = -start;
+  else
+    *shift_out = MAX (start, 0) - start;
+  start += *shift_out;
+
+  for (i = 0; i < n_lines; i++)
+    lines[i].offset += start;
+
+  *estimate_out = estimate;
+
+  return start + offset;
+}
+
+/*
+ * gtk_virtualizer_measure:
+ * @self: a #GtkVirtualizer
+ * @lines: (array length=n_lines): the existing lines, sorted
+ * @n_lines: the number of existing lines
+ *
+ * Returns: the size needed for all lines
+ **/
+int
+gtk_virtualizer_measure (GtkVirtualizer     *self,
+                         GtkVirtualizerLine *lines,
+                         guint               n_lines)
+{
+  int estimate, shift;
+
+  return gtk_virtualizer_layout (self, lines, n_lines, &estimate, &shift);
+}
+
+/*
+ * gtk_virtualizer_allocate:
+ * @self: a #GtkVirtualizer
+ * @lines: (array length=n_lines): the existing lines, sorted
+ * @n_lines: the number of existing lines
+ *
+ * Sets the offsets of @lines and remembers them for
+ * picking the anchor when the adjustment is moved.
+ **/
+void
+gtk_virtualizer_allocate (GtkVirtualizer     *self,
+                          GtkVirtualizerLine *lines,
+                          guint               n_lines)
+{
+  int estimate, shift;
+
+  gtk_virtualizer_layout (self, lines, n_lines, &estimate, &shift);
+
+  if (shift != 0)
+    {
+      /* Move the viewport along with the anchor, so that
+       * nothing appears to move.
+       */
+      self->anchor_offset += shift;
+
+      if (self->adjustment)
+        gtk_virtualizer_set_value (self, gtk_virtualizer_get_value (self) + shift);
+    }
+
+  g_array_set_size (self->allocated, 0);
+  g_array_append_vals (self->allocated, lines, n_lines);
+
+  if (estimate != self->estimated_size)
+    {
+      self->estimated_size = estimate;
+      gtk_virtualizer_queue_update (self);
+    }
+}
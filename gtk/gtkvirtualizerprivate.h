@@ -0,0 +1,110 @@
+/* gtkvirtualizerprivate.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_VIRTUALIZER_PRIVATE_H__
+#define __GTK_VIRTUALIZER_PRIVATE_H__
+
+#include "gtk/gtkadjustment.h"
+#include "gtk/gtklistitemrangeprivate.h"
+#include "gtk/gtkwidget.h"
+
+G_BEGIN_DECLS
+
+/* Number of lines kept around before and after the visible ones */
+#define GTK_VIRTUALIZER_EXTRA_LINES 16
+/* Number of lines created before the size of lines is known */
+#define GTK_VIRTUALIZER_INITIAL_LINES 64
+
+typedef struct _GtkVirtualizer GtkVirtualizer;
+typedef struct _GtkVirtualizerLine GtkVirtualizerLine;
+
+/* Called to make @widget create the lines from @start to
+ * @start + @n_lines and drop the ones it doesn't need anymore.
+ */
+typedef void (* GtkVirtualizerUpdateFunc) (GtkWidget *widget,
+                                           guint      start,
+                                           guint      n_lines);
+
+struct _GtkVirtualizerLine
+{
+  guint line;
+  int size;
+  int offset;
+};
+
+/* Keeps track of which lines of a widget that lays out many lines
+ * one after another need to exist, for widgets that only create
+ * children for the lines that are visible in the adjustment.
+ *
+ * The anchor line is kept at a fixed offset, and the lines around
+ * it are laid out from there. Lines that don't exist are given
+ * the average size of those that do.
+ */
+struct _GtkVirtualizer
+{
+  GtkWidget *widget;
+  GtkVirtualizerUpdateFunc update_func;
+  GtkAdjustment *adjustment;
+
+  guint n_lines;
+  /* The lines to create; position is the anchor */
+  GtkListItemRange window;
+  int anchor_offset;
+  int estimated_size;
+  /* The GtkVirtualizerLines of the last allocation */
+  GArray *allocated;
+
+  guint update_id;
+  guint needs_anchor : 1;
+  guint inverted     : 1;
+};
+
+void            gtk_virtualizer_init                    (GtkVirtualizer           *self,
+                                                         GtkWidget                *widget,
+                                                         GtkVirtualizerUpdateFunc  update_func);
+void            gtk_virtualizer_finish                  (GtkVirtualizer           *self);
+
+void            gtk_virtualizer_set_adjustment          (GtkVirtualizer           *self,
+                                                         GtkAdjustment            *adjustment,
+                                                         gboolean                  inverted);
+void            gtk_virtualizer_reset                   (GtkVirtualizer           *self,
+                                                         guint                     n_lines);
+void            gtk_virtualizer_set_n_lines             (GtkVirtualizer           *self,
+                                                         guint                     n_lines,
+                                                         guint                     anchor);
+void            gtk_virtualizer_items_changed           (GtkVirtualizer           *self,
+                                                         guint                     position,
+                                                         guint                     removed,
+                                                         guint                     added);
+
+guint           gtk_virtualizer_get_anchor              (GtkVirtualizer           *self);
+int             gtk_virtualizer_get_estimated_size      (GtkVirtualizer           *self);
+void            gtk_virtualizer_scroll_to               (GtkVirtualizer           *self,
+                                                         guint                     line);
+
+void            gtk_virtualizer_queue_update            (GtkVirtualizer           *self);
+void            gtk_virtualizer_update                  (GtkVirtualizer           *self);
+
+int             gtk_virtualizer_measure                 (GtkVirtualizer           *self,
+                                                         GtkVirtualizerLine       *lines,
+                                                         guint                     n_lines);
+void            gtk_virtualizer_allocate                (GtkVirtualizer           *self,
+                                                         GtkVirtualizerLine       *lines,
+                                                         guint                     n_lines);
+
+G_END_DECLS
+
+#endif /* __GTK_VIRTUALIZER_PRIVATE_H__ */
@@ -3766,6 +3766,7 @@ gtk_widget_allocate (GtkWidget    *widget,
   GtkCssStyle *style;
   GtkBorder margin, border, padding;
   GskTransform *css_transform;
+  gint64 span_start = 0;
 
   g_return_if_fail (GTK_IS_WIDGET (widget));
   g_return_if_fail (baseline >= -1);
@@ -3874,6 +3875,9 @@ gtk_widget_allocate (GtkWidget    *widget,
   priv->height = adjusted.height;
   priv->baseline = baseline;
 
+  if (GDK_PROFILER_IS_RUNNING)
+    span_start = gdk_profiler_begin_type_span ();
+
   if (priv->layout_manager != NULL)
     {
       gtk_layout_manager_allocate (priv->layout_manager, widget,
@@ -3889,6 +3893,9 @@ gtk_widget_allocate (GtkWidget    *widget,
                                                     baseline);
     }
 
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_end_type_span (span_start, "allocate", G_OBJECT_TYPE (widget));
+
   /* Size allocation is god... after consulting god, no further requests or allocations are needed */
 #ifdef G_ENABLE_DEBUG
   if (GTK_DISPLAY_DEBUG_CHECK (_gtk_widget_get_display (widget), GEOMETRY) &&
@@ -8092,10 +8099,20 @@ gtk_widget_accessible_get_at_context (GtkAccessible *accessible)
   return priv->at_context;
 }
 
+static GtkATContext *
+gtk_widget_accessible_peek_at_context (GtkAccessible *accessible)
+{
+  GtkWidget *self = GTK_WIDGET (accessible);
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (self);
+
+  return priv->at_context;
+}
+
 static void
 gtk_widget_accessible_interface_init (GtkAccessibleInterface *iface)
 {
   iface->get_at_context = gtk_widget_accessible_get_at_context;
+  iface->peek_at_context = gtk_widget_accessible_peek_at_context;
 }
 
 /*
@@ -10152,6 +10169,7 @@ template_data_free (GtkWidgetTemplate *template_data)
   if (template_data)
     {
       g_bytes_unref (template_data->data);
+      g_clear_pointer (&template_data->plan, gtk_builder_plan_unref);
       g_slist_free_full (template_data->children, (GDestroyNotify)template_child_class_free);
 
       g_object_unref (template_data->scope);
@@ -10284,14 +10302,24 @@ gtk_widget_init_template (GtkWidget *widget)
 
   gtk_builder_set_current_object (builder, G_OBJECT (widget));
 
+  /* The plan is created on first use, not in class_init, since
+   * the scope may be set after the template.
+   */
+  if (template->plan == NULL)
+    template->plan = gtk_builder_plan_new (template->data);
+
   /* This will build the template XML as children to the widget instance, also it
    * will validate that the template is created for the correct GType and assert that
    * there is no infinite recursion.
    */
-  if (!gtk_builder_extend_with_template  (builder, G_OBJECT (widget), class_type,
-					  (const char *)g_bytes_get_data (template->data, NULL),
-					  g_bytes_get_size (template->data),
-					  &error))
+  if (template->plan
+      ? !gtk_builder_extend_with_plan (builder, G_OBJECT (widget), class_type,
+                                       template->plan,
+                                       &error)
+      : !gtk_builder_extend_with_template (builder, G_OBJECT (widget), class_type,
+					   (const char *)g_bytes_get_data (template->data, NULL),
+					   g_bytes_get_size (template->data),
+					   &error))
     {
       g_critical ("Error building template class '%s' for an instance of type '%s': %s",
 		  g_type_name (class_type), G_OBJECT_TYPE_NAME (object), error->message);
@@ -10477,6 +10505,8 @@ gtk_widget_class_set_template_scope (GtkWidgetClass  *widget_class,
 
   /* Defensive, destroy any previously set data */
   g_set_object (&widget_class->priv->template->scope, scope);
+  /* Types resolved with the old scope may be wrong now */
+  g_clear_pointer (&widget_class->priv->template->plan, gtk_builder_plan_unref);
 }
 
 /**
@@ -10847,6 +10877,7 @@ gtk_widget_create_render_node (GtkWidget   *widget,
   GtkCssValue *filter_value;
   double css_opacity, opacity;
   GtkCssStyle *style;
+  gint64 span_start = 0;
 
   style = gtk_css_node_get_style (priv->cssnode);
 
@@ -10872,6 +10903,9 @@ gtk_widget_create_render_node (GtkWidget   *widget,
   gtk_css_style_snapshot_background (&boxes, snapshot);
   gtk_css_style_snapshot_border (&boxes, snapshot);
 
+  if (GDK_PROFILER_IS_RUNNING)
+    span_start = gdk_profiler_begin_type_span ();
+
   if (priv->overflow == GTK_OVERFLOW_HIDDEN)
     {
       gtk_snapshot_push_rounded_clip (snapshot, gtk_css_boxes_get_padding_box (&boxes));
@@ -10883,6 +10917,9 @@ gtk_widget_create_render_node (GtkWidget   *widget,
       klass->snapshot (widget, snapshot);
     }
 
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_end_type_span (span_start, "snapshot", G_OBJECT_TYPE (widget));
+
   gtk_css_style_snapshot_outline (&boxes, snapshot);
 
   if (opacity < 1.0)
@@ -29,6 +29,7 @@
 
 #include "gtkactionmuxerprivate.h"
 #include "gtkatcontextprivate.h"
+#include "gtkbuilderprivate.h"
 #include "gtkcsstypesprivate.h"
 #include "gtkeventcontrollerprivate.h"
 #include "gtklistlistmodelprivate.h"
@@ -203,6 +204,7 @@ typedef struct
   GBytes *data;
   GSList *children;
   GtkBuilderScope *scope;
+  GtkBuilderPlan *plan;
 } GtkWidgetTemplate;
 
 struct _GtkWidgetClassPrivate
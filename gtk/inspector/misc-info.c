@@ -31,6 +31,7 @@
 #include "gtkmenubutton.h"
 #include "gtkwidgetprivate.h"
 #include "gtkbinlayout.h"
+#include "gtksizerequestcacheprivate.h"
 
 
 struct _GtkInspectorMiscInfo
@@ -53,6 +54,10 @@ struct _GtkInspectorMiscInfo
   GtkWidget *mnemonic_label;
   GtkWidget *request_mode_row;
   GtkWidget *request_mode;
+  GtkWidget *size_cache_row;
+  GtkWidget *size_cache;
+  GtkWidget *shared_size_cache_row;
+  GtkWidget *shared_size_cache;
   GtkWidget *allocated_size_row;
   GtkWidget *allocated_size;
   GtkWidget *baseline_row;
@@ -158,6 +163,30 @@ update_allocation (GtkWidget            *w,
   g_type_class_unref (class);
 }
 
+static void
+update_size_cache (GtkWidget            *w,
+                   GtkInspectorMiscInfo *sl)
+{
+  SizeRequestCache *cache = _gtk_widget_peek_request_cache (w);
+  SizeRequestCacheStats *stats = _gtk_size_request_cache_get_stats ();
+  char *tmp;
+
+  tmp = g_strdup_printf ("%u × %u slots, %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses",
+                         _gtk_size_request_cache_get_n_slots (cache, GTK_ORIENTATION_HORIZONTAL),
+                         _gtk_size_request_cache_get_n_slots (cache, GTK_ORIENTATION_VERTICAL),
+                         stats->hits, stats->misses);
+  gtk_label_set_label (GTK_LABEL (sl->size_cache), tmp);
+  g_free (tmp);
+
+  if (stats->shared_hits + stats->shared_misses > 0)
+    tmp = g_strdup_printf ("%" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses",
+                           stats->shared_hits, stats->shared_misses);
+  else
+    tmp = g_strdup ("—");
+  gtk_label_set_label (GTK_LABEL (sl->shared_size_cache), tmp);
+  g_free (tmp);
+}
+
 static void
 disconnect_each_other (gpointer  still_alive,
                        GObject  *for_science)
@@ -344,6 +373,8 @@ update_info (gpointer data)
       g_list_free (list);
 
       gtk_widget_set_visible (sl->tick_callback, gtk_widget_has_tick_callback (GTK_WIDGET (sl->object)));
+
+      update_size_cache (GTK_WIDGET (sl->object), sl);
     }
 
   update_surface (sl);
@@ -419,6 +450,8 @@ gtk_inspector_misc_info_set_object (GtkInspectorMiscInfo *sl,
       gtk_widget_show (sl->refcount_row);
       gtk_widget_show (sl->state_row);
       gtk_widget_show (sl->request_mode_row);
+      gtk_widget_show (sl->size_cache_row);
+      gtk_widget_show (sl->shared_size_cache_row);
       gtk_widget_show (sl->allocated_size_row);
       gtk_widget_show (sl->baseline_row);
       gtk_widget_show (sl->mnemonic_label_row);
@@ -438,6 +471,8 @@ gtk_inspector_misc_info_set_object (GtkInspectorMiscInfo *sl,
     {
       gtk_widget_hide (sl->state_row);
       gtk_widget_hide (sl->request_mode_row);
+      gtk_widget_hide (sl->size_cache_row);
+      gtk_widget_hide (sl->shared_size_cache_row);
       gtk_widget_hide (sl->mnemonic_label_row);
       gtk_widget_hide (sl->allocated_size_row);
       gtk_widget_hide (sl->baseline_row);
@@ -540,6 +575,10 @@ gtk_inspector_misc_info_class_init (GtkInspectorMiscInfoClass *klass)
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, mnemonic_label);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, request_mode_row);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, request_mode);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, size_cache_row);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, size_cache);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, shared_size_cache_row);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, shared_size_cache);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, allocated_size_row);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, allocated_size);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, baseline_row);
@@ -3557,8 +3557,43 @@ int bitset_container_compute_cardinality(const bitset_container_t *bitset) {
 
 #else
 
+#ifdef ROARING_AVX2_RUNTIME_DISPATCH
+
+/* GTK: checks once whether the AVX2 kernels can be used */
+static inline bool roaring_cpu_has_avx2(void) {
+    static int has_avx2 = -1;
+    if (has_avx2 < 0) {
+        __builtin_cpu_init();
+        has_avx2 = __builtin_cpu_supports("avx2") &&
+                   __builtin_cpu_supports("popcnt");
+    }
+    return has_avx2;
+}
+
+ROARING_TARGET_AVX2
+static int bitset_container_compute_cardinality_avx2(
+    const bitset_container_t *bitset) {
+    const uint64_t *array = bitset->array;
+    uint64_t sum = 0;
+    for (int i = 0; i < BITSET_CONTAINER_SIZE_IN_WORDS; i += 4) {
+        sum += _mm_popcnt_u64(array[i]);
+        sum += _mm_popcnt_u64(array[i + 1]);
+        sum += _mm_popcnt_u64(array[i + 2]);
+        sum += _mm_popcnt_u64(array[i + 3]);
+    }
+    return (int) sum;
+}
+
+#define BITSET_COMPUTE_CARDINALITY_NAME bitset_container_compute_cardinality_scalar
+#define BITSET_COMPUTE_CARDINALITY_QUALIFIER static
+#else
+#define BITSET_COMPUTE_CARDINALITY_NAME bitset_container_compute_cardinality
+#define BITSET_COMPUTE_CARDINALITY_QUALIFIER
+#endif
+
 /* Get the number of bits set (force computation) */
-int bitset_container_compute_cardinality(const bitset_container_t *bitset) {
+BITSET_COMPUTE_CARDINALITY_QUALIFIER
+int BITSET_COMPUTE_CARDINALITY_NAME(const bitset_container_t *bitset) {
     const uint64_t *array = bitset->array;
     int32_t sum = 0;
     for (int i = 0; i < BITSET_CONTAINER_SIZE_IN_WORDS; i += 4) {
@@ -3570,6 +3605,14 @@ int bitset_container_compute_cardinality(const bitset_container_t *bitset) {
     return sum;
 }
 
+#ifdef ROARING_AVX2_RUNTIME_DISPATCH
+int bitset_container_compute_cardinality(const bitset_container_t *bitset) {
+    if (roaring_cpu_has_avx2())
+        return bitset_container_compute_cardinality_avx2(bitset);
+    return bitset_container_compute_cardinality_scalar(bitset);
+}
+#endif
+
 #endif
 
 #ifdef USEAVX
@@ -3747,8 +3790,9 @@ int bitset_container_##opname##_justcard(const bitset_container_t *src_1,     \
 
 #else /* not USEAVX  */
 
-#define BITSET_CONTAINER_FN(opname, opsymbol, avx_intrinsic, neon_intrinsic)  \
-int bitset_container_##opname(const bitset_container_t *src_1,            \
+#define BITSET_CONTAINER_SCALAR_FN(opname, opsymbol, qualifier, suffix)   \
+qualifier int bitset_container_##opname##suffix(                          \
+                              const bitset_container_t *src_1,            \
                               const bitset_container_t *src_2,            \
                               bitset_container_t *dst) {                  \
     const uint64_t * __restrict__ array_1 = src_1->array;                 \
@@ -3766,7 +3810,8 @@ int bitset_container_##opname(const bitset_container_t *src_1,            \
     dst->cardinality = sum;                                               \
     return dst->cardinality;                                              \
 }                                                                         \
-int bitset_container_##opname##_nocard(const bitset_container_t *src_1,   \
+qualifier int bitset_container_##opname##_nocard##suffix(                  \
+                                       const bitset_container_t *src_1,   \
                                        const bitset_container_t *src_2,   \
                                        bitset_container_t *dst) {         \
     const uint64_t * __restrict__ array_1 = src_1->array;                 \
@@ -3778,7 +3823,8 @@ int bitset_container_##opname##_nocard(const bitset_container_t *src_1,   \
     dst->cardinality = BITSET_UNKNOWN_CARDINALITY;                        \
     return dst->cardinality;                                              \
 }                                                                         \
-int bitset_container_##opname##_justcard(const bitset_container_t *src_1, \
+qualifier int bitset_container_##opname##_justcard##suffix(                \
+                              const bitset_container_t *src_1,            \
                               const bitset_container_t *src_2) {          \
     const uint64_t * __restrict__ array_1 = src_1->array;                 \
     const uint64_t * __restrict__ array_2 = src_2->array;                 \
@@ -3792,6 +3838,102 @@ int bitset_container_##opname##_justcard(const bitset_container_t *src_1, \
     return sum;                                                           \
 }
 
+#ifdef ROARING_AVX2_RUNTIME_DISPATCH
+
+/* GTK: AVX2 versions compiled for runtime dispatch */
+#ifndef WORDS_IN_AVX2_REG
+#define WORDS_IN_AVX2_REG sizeof(__m256i) / sizeof(uint64_t)
+#endif
+#define BITSET_CONTAINER_AVX2_FN(opname, avx_intrinsic)                   \
+ROARING_TARGET_AVX2                                                       \
+static int bitset_container_##opname##_avx2(                              \
+                              const bitset_container_t *src_1,            \
+                              const bitset_container_t *src_2,            \
+                              bitset_container_t *dst) {                  \
+    const __m256i *array_1 = (const __m256i *) src_1->array;              \
+    const __m256i *array_2 = (const __m256i *) src_2->array;              \
+    __m256i *out = (__m256i *) dst->array;                                \
+    uint64_t sum = 0;                                                     \
+    for (size_t i = 0;                                                    \
+         i < BITSET_CONTAINER_SIZE_IN_WORDS / (WORDS_IN_AVX2_REG); i++) { \
+        __m256i AO = avx_intrinsic(_mm256_loadu_si256(array_2 + i),       \
+                                   _mm256_loadu_si256(array_1 + i));      \
+        _mm256_storeu_si256(out + i, AO);                                 \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 0));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 1));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 2));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 3));     \
+    }                                                                     \
+    dst->cardinality = (int32_t) sum;                                     \
+    return dst->cardinality;                                              \
+}                                                                         \
+ROARING_TARGET_AVX2                                                       \
+static int bitset_container_##opname##_nocard_avx2(                       \
+                              const bitset_container_t *src_1,            \
+                              const bitset_container_t *src_2,            \
+                              bitset_container_t *dst) {                  \
+    const __m256i *array_1 = (const __m256i *) src_1->array;              \
+    const __m256i *array_2 = (const __m256i *) src_2->array;              \
+    __m256i *out = (__m256i *) dst->array;                                \
+    for (size_t i = 0;                                                    \
+         i < BITSET_CONTAINER_SIZE_IN_WORDS / (WORDS_IN_AVX2_REG); i++) { \
+        _mm256_storeu_si256(out + i,                                      \
+                            avx_intrinsic(_mm256_loadu_si256(array_2 + i),\
+                                          _mm256_loadu_si256(array_1 + i)));\
+    }                                                                     \
+    dst->cardinality = BITSET_UNKNOWN_CARDINALITY;                        \
+    return dst->cardinality;                                              \
+}                                                                         \
+ROARING_TARGET_AVX2                                                       \
+static int bitset_container_##opname##_justcard_avx2(                     \
+                              const bitset_container_t *src_1,            \
+                              const bitset_container_t *src_2) {          \
+    const __m256i *array_1 = (const __m256i *) src_1->array;              \
+    const __m256i *array_2 = (const __m256i *) src_2->array;              \
+    uint64_t sum = 0;                                                     \
+    for (size_t i = 0;                                                    \
+         i < BITSET_CONTAINER_SIZE_IN_WORDS / (WORDS_IN_AVX2_REG); i++) { \
+        __m256i AO = avx_intrinsic(_mm256_loadu_si256(array_2 + i),       \
+                                   _mm256_loadu_si256(array_1 + i));      \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 0));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 1));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 2));     \
+        sum += _mm_popcnt_u64((uint64_t)_mm256_extract_epi64(AO, 3));     \
+    }                                                                     \
+    return (int) sum;                                                     \
+}
+
+#define BITSET_CONTAINER_FN(opname, opsymbol, avx_intrinsic, neon_intrinsic)  \
+BITSET_CONTAINER_SCALAR_FN(opname, opsymbol, static, _scalar)             \
+BITSET_CONTAINER_AVX2_FN(opname, avx_intrinsic)                           \
+int bitset_container_##opname(const bitset_container_t *src_1,            \
+                              const bitset_container_t *src_2,            \
+                              bitset_container_t *dst) {                  \
+    if (roaring_cpu_has_avx2())                                           \
+        return bitset_container_##opname##_avx2(src_1, src_2, dst);       \
+    return bitset_container_##opname##_scalar(src_1, src_2, dst);         \
+}                                                                         \
+int bitset_container_##opname##_nocard(const bitset_container_t *src_1,   \
+                                       const bitset_container_t *src_2,   \
+                                       bitset_container_t *dst) {         \
+    if (roaring_cpu_has_avx2())                                           \
+        return bitset_container_##opname##_nocard_avx2(src_1, src_2, dst);\
+    return bitset_container_##opname##_nocard_scalar(src_1, src_2, dst);  \
+}                                                                         \
+int bitset_container_##opname##_justcard(const bitset_container_t *src_1, \
+                              const bitset_container_t *src_2) {          \
+    if (roaring_cpu_has_avx2())                                           \
+        return bitset_container_##opname##_justcard_avx2(src_1, src_2);   \
+    return bitset_container_##opname##_justcard_scalar(src_1, src_2);     \
+}
+
+#else
+
+#define BITSET_CONTAINER_FN(opname, opsymbol, avx_intrinsic, neon_intrinsic)  \
+BITSET_CONTAINER_SCALAR_FN(opname, opsymbol, , )
+
+#endif /* ROARING_AVX2_RUNTIME_DISPATCH */
+
 #endif
 
 // we duplicate the function because other containers use the "or" term, makes API more consistent
@@ -10368,6 +10510,222 @@ roaring_bitmap_frozen_view(const char *buf, size_t length) {
 
     return rb;
 }
+
+/*
+ * GTK addition: shifting all values of a bitmap by an offset, backported
+ * from later CRoaring versions. Containers are split into the part that
+ * stays with its (shifted) key and the part that spills into the next one,
+ * so the cost is linear in the size of the containers, not in the number
+ * of values.
+ */
+static void array_container_offset(const array_container_t *c,
+                                   void **loc, void **hic,
+                                   uint16_t offset) {
+    array_container_t *lo = NULL, *hi = NULL;
+    int32_t top, lo_card, hi_card, i;
+
+    top = (1 << 16) - offset;
+    lo_card = binarySearch(c->array, c->cardinality, (uint16_t)top);
+    if (lo_card < 0) lo_card = -lo_card - 1;
+    hi_card = c->cardinality - lo_card;
+
+    if (loc && lo_card) {
+        lo = array_container_create_given_capacity(lo_card);
+        for (i = 0; i < lo_card; ++i)
+            lo->array[i] = (uint16_t)(c->array[i] + offset);
+        lo->cardinality = lo_card;
+        *loc = lo;
+    }
+
+    if (hic && hi_card) {
+        hi = array_container_create_given_capacity(hi_card);
+        for (i = 0; i < hi_card; ++i)
+            hi->array[i] = (uint16_t)(c->array[lo_card + i] + offset);
+        hi->cardinality = hi_card;
+        *hic = hi;
+    }
+}
+
+/* word @w of the bitset shifted by @offset bits into a virtual bitset of
+ * twice the size */
+static inline uint64_t bitset_shifted_word(const uint64_t *words,
+                                           int32_t w, uint16_t offset) {
+    const int32_t b = offset / 64, s = offset % 64;
+    const int32_t j = w - b;
+    uint64_t result = 0;
+
+    if (j >= 0 && j < BITSET_CONTAINER_SIZE_IN_WORDS)
+        result = words[j] << s;
+    if (s != 0 && j - 1 >= 0 && j - 1 < BITSET_CONTAINER_SIZE_IN_WORDS)
+        result |= words[j - 1] >> (64 - s);
+
+    return result;
+}
+
+static void *bitset_container_offset_half(const bitset_container_t *c,
+                                          int32_t first_word, uint16_t offset,
+                                          uint8_t *typecode) {
+    bitset_container_t *bc = bitset_container_create();
+    int32_t i;
+
+    for (i = 0; i < BITSET_CONTAINER_SIZE_IN_WORDS; ++i)
+        bc->array[i] = bitset_shifted_word(c->array, first_word + i, offset);
+    bc->cardinality = bitset_container_compute_cardinality(bc);
+
+    if (bc->cardinality == 0) {
+        bitset_container_free(bc);
+        return NULL;
+    }
+    if (bc->cardinality <= DEFAULT_MAX_SIZE) {
+        array_container_t *ac = array_container_from_bitset(bc);
+        bitset_container_free(bc);
+        *typecode = ARRAY_CONTAINER_TYPE_CODE;
+        return ac;
+    }
+    *typecode = BITSET_CONTAINER_TYPE_CODE;
+    return bc;
+}
+
+static void bitset_container_offset(const bitset_container_t *c,
+                                    void **loc, uint8_t *lo_type,
+                                    void **hic, uint8_t *hi_type,
+                                    uint16_t offset) {
+    if (loc)
+        *loc = bitset_container_offset_half(c, 0, offset, lo_type);
+    if (hic)
+        *hic = bitset_container_offset_half(c, BITSET_CONTAINER_SIZE_IN_WORDS,
+                                            offset, hi_type);
+}
+
+static void run_container_offset(const run_container_t *c,
+                                 void **loc, void **hic,
+                                 uint16_t offset) {
+    run_container_t *lo = NULL, *hi = NULL;
+    int32_t i;
+
+    for (i = 0; i < c->n_runs; ++i) {
+        const int32_t start = (int32_t)c->runs[i].value + offset;
+        const int32_t end = start + c->runs[i].length;
+
+        if (start < (1 << 16) && loc) {
+            if (lo == NULL)
+                lo = run_container_create_given_capacity(c->n_runs);
+            lo->runs[lo->n_runs].value = (uint16_t)start;
+            lo->runs[lo->n_runs].length =
+                (uint16_t)((end < (1 << 16) ? end : (1 << 16) - 1) - start);
+            lo->n_runs++;
+        }
+        if (end >= (1 << 16) && hic) {
+            const int32_t hi_start = start < (1 << 16) ? 0 : start - (1 << 16);
+
+            if (hi == NULL)
+                hi = run_container_create_given_capacity(c->n_runs);
+            hi->runs[hi->n_runs].value = (uint16_t)hi_start;
+            hi->runs[hi->n_runs].length =
+                (uint16_t)(end - (1 << 16) - hi_start);
+            hi->n_runs++;
+        }
+    }
+
+    if (loc) *loc = lo;
+    if (hic) *hic = hi;
+}
+
+static void container_add_offset(const void *c, uint8_t type,
+                                 void **lo, uint8_t *lo_type,
+                                 void **hi, uint8_t *hi_type,
+                                 uint16_t offset) {
+    *lo_type = *hi_type = type;
+    switch (type) {
+        case ARRAY_CONTAINER_TYPE_CODE:
+            array_container_offset((const array_container_t *)c, lo, hi,
+                                   offset);
+            break;
+        case BITSET_CONTAINER_TYPE_CODE:
+            bitset_container_offset((const bitset_container_t *)c,
+                                    lo, lo_type, hi, hi_type, offset);
+            break;
+        case RUN_CONTAINER_TYPE_CODE:
+            run_container_offset((const run_container_t *)c, lo, hi, offset);
+            break;
+        default:
+            assert(false);
+            __builtin_unreachable();
+    }
+}
+
+/* appends c with key k to ra, merging it into the last container
+ * if that one has the same key */
+static void offset_append_with_merge(roaring_array_t *ra, uint16_t k,
+                                     void *c, uint8_t t) {
+    const int32_t size = ra->size;
+
+    if (size > 0 && ra->keys[size - 1] == k) {
+        uint8_t last_type = ra->typecodes[size - 1], result_type;
+        void *last = ra->containers[size - 1];
+        void *result = container_ior(last, last_type, c, t, &result_type);
+
+        if (result != last) container_free(last, last_type);
+        ra->containers[size - 1] = result;
+        ra->typecodes[size - 1] = result_type;
+        container_free(c, t);
+    } else {
+        ra_append(ra, k, c, t);
+    }
+}
+
+roaring_bitmap_t *roaring_bitmap_add_offset(const roaring_bitmap_t *bm,
+                                            int64_t offset) {
+    const roaring_array_t *bm_ra = &bm->high_low_container;
+    const int32_t length = bm_ra->size;
+    roaring_bitmap_t *answer;
+    roaring_array_t *ans_ra;
+    int64_t container_offset;
+    uint16_t in_offset;
+    int32_t i;
+
+    if (offset == 0) return roaring_bitmap_copy(bm);
+
+    container_offset = offset >> 16;
+    in_offset = (uint16_t)(offset - container_offset * (1 << 16));
+
+    answer = roaring_bitmap_create_with_capacity(length + 1);
+    ans_ra = &answer->high_low_container;
+
+    if (in_offset == 0) {
+        for (i = 0; i < length; ++i) {
+            const int64_t key = (int64_t)bm_ra->keys[i] + container_offset;
+
+            if (key < 0 || key >= (1 << 16)) continue;
+            ra_append_copy(ans_ra, bm_ra, (uint16_t)i, false);
+            ans_ra->keys[ans_ra->size - 1] = (uint16_t)key;
+        }
+        return answer;
+    }
+
+    for (i = 0; i < length; ++i) {
+        const int64_t k = (int64_t)bm_ra->keys[i] + container_offset;
+        void *lo = NULL, *hi = NULL;
+        void **lo_ptr = NULL, **hi_ptr = NULL;
+        uint8_t t, lo_type, hi_type;
+        const void *c;
+
+        if (k >= 0 && k < (1 << 16)) lo_ptr = &lo;
+        if (k + 1 >= 0 && k + 1 < (1 << 16)) hi_ptr = &hi;
+        if (lo_ptr == NULL && hi_ptr == NULL) continue;
+
+        c = ra_get_container_at_index(bm_ra, (uint16_t)i, &t);
+        c = container_unwrap_shared(c, &t);
+
+        container_add_offset(c, t, lo_ptr, &lo_type, hi_ptr, &hi_type,
+                             in_offset);
+        if (lo != NULL)
+            offset_append_with_merge(ans_ra, (uint16_t)k, lo, lo_type);
+        if (hi != NULL) ra_append(ans_ra, (uint16_t)(k + 1), hi, hi_type);
+    }
+
+    return answer;
+}
 /* end file src/roaring.c */
 /* begin file src/roaring_array.c */
 #include <assert.h>
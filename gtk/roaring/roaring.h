@@ -139,6 +139,14 @@ enum {
 
 #endif  // DISABLE_X64
 
+// GTK: when AVX2 is not enabled at compile time, the hottest bitset container
+// kernels are still built for AVX2 and selected at runtime based on the CPU
+#if defined(IS_X64) && !defined(USEAVX) && !defined(DISABLEAVX) && \
+    !defined(_MSC_VER) && (defined(__GNUC__) || defined(__clang__))
+#define ROARING_AVX2_RUNTIME_DISPATCH
+#define ROARING_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
 #ifdef _MSC_VER
 /* Microsoft C/C++-compatible compiler */
 #include <intrin.h>
@@ -7116,6 +7124,14 @@ roaring_bitmap_t *roaring_bitmap_flip(const roaring_bitmap_t *x1,
 void roaring_bitmap_flip_inplace(roaring_bitmap_t *x1, uint64_t range_start,
                                  uint64_t range_end);
 
+/**
+ * Returns a new bitmap with all values of bm shifted by offset. Values
+ * that end up outside of [0, UINT32_MAX] are discarded.
+ * The caller is responsible for memory management.
+ */
+roaring_bitmap_t *roaring_bitmap_add_offset(const roaring_bitmap_t *bm,
+                                            int64_t offset);
+
 /**
  * Selects the element at index 'rank' where the smallest element is at index 0.
  * If the size of the roaring bitmap is strictly greater than rank, then this
@@ -0,0 +1,76 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Creates a lot of widgets and changes their accessible state a few
+ * times, first with nothing looking at the accessibles, and then with
+ * every accessible queried once, like an AT would.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_WIDGETS 50000
+#define N_CHANGES 4
+
+static void
+flush_updates (void)
+{
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+}
+
+static void
+run (gboolean listening)
+{
+  GtkWidget **widgets;
+  GTimer *timer;
+  double create, change, destroy;
+  guint i, j;
+
+  widgets = g_new (GtkWidget *, N_WIDGETS);
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < N_WIDGETS; i++)
+    {
+      widgets[i] = g_object_ref_sink (gtk_check_button_new_with_label ("Check"));
+      if (listening)
+        gtk_accessible_get_accessible_role (GTK_ACCESSIBLE (widgets[i]));
+    }
+  flush_updates ();
+  create = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (j = 0; j < N_CHANGES; j++)
+    {
+      for (i = 0; i < N_WIDGETS; i++)
+        {
+          gtk_check_button_set_active (GTK_CHECK_BUTTON (widgets[i]), j % 2 == 0);
+          gtk_widget_set_sensitive (widgets[i], j % 2 == 1);
+        }
+      flush_updates ();
+    }
+  change = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_WIDGETS; i++)
+    g_object_unref (widgets[i]);
+  destroy = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_print ("%s:\n", listening ? "with contexts" : "without contexts");
+  g_print ("  creating %d widgets: %8.3f msec\n", N_WIDGETS, create);
+  g_print ("  %d rounds of changes:  %8.3f msec\n", N_CHANGES, change);
+  g_print ("  destroying:           %8.3f msec\n", destroy);
+
+  g_timer_destroy (timer);
+  g_free (widgets);
+}
+
+int
+main (int argc, char **argv)
+{
+  gtk_init ();
+
+  run (FALSE);
+  run (TRUE);
+
+  return 0;
+}
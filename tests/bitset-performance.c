@@ -0,0 +1,184 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+#define N_ITEMS 10000000
+
+typedef void (* BitsetFunc) (GtkBitset *set);
+
+static void
+select_all (GtkBitset *set)
+{
+  gtk_bitset_add_range (set, 0, N_ITEMS);
+}
+
+static void
+unselect_all (GtkBitset *set)
+{
+  gtk_bitset_remove_range (set, 0, N_ITEMS);
+}
+
+static void
+invert (GtkBitset *set)
+{
+  GtkBitset *all = gtk_bitset_new_range (0, N_ITEMS);
+
+  gtk_bitset_difference (set, all);
+  gtk_bitset_unref (all);
+}
+
+static void
+intersect_half (GtkBitset *set)
+{
+  GtkBitset *half = gtk_bitset_new_range (N_ITEMS / 4, N_ITEMS / 2);
+
+  gtk_bitset_intersect (set, half);
+  gtk_bitset_unref (half);
+}
+
+static void
+shift_right_1 (GtkBitset *set)
+{
+  gtk_bitset_shift_right (set, 1);
+}
+
+static void
+shift_left_1 (GtkBitset *set)
+{
+  gtk_bitset_shift_left (set, 1);
+}
+
+static void
+shift_right_65536 (GtkBitset *set)
+{
+  gtk_bitset_shift_right (set, 65536);
+}
+
+static void
+splice_insert (GtkBitset *set)
+{
+  gtk_bitset_splice (set, N_ITEMS / 2, 0, 1);
+}
+
+static void
+splice_remove (GtkBitset *set)
+{
+  gtk_bitset_splice (set, N_ITEMS / 2, 1000, 0);
+}
+
+static void
+size (GtkBitset *set)
+{
+  gtk_bitset_get_size (set);
+}
+
+static void
+size_in_range (GtkBitset *set)
+{
+  gtk_bitset_get_size_in_range (set, N_ITEMS / 3, 2 * N_ITEMS / 3);
+}
+
+static GtkBitset *
+create_empty (void)
+{
+  return gtk_bitset_new_empty ();
+}
+
+static GtkBitset *
+create_full (void)
+{
+  return gtk_bitset_new_range (0, N_ITEMS);
+}
+
+static GtkBitset *
+create_every_other (void)
+{
+  GtkBitset *set = gtk_bitset_new_empty ();
+
+  gtk_bitset_add_rectangle (set, 0, 1, N_ITEMS / 2, 2);
+
+  return set;
+}
+
+static GtkBitset *
+create_random (void)
+{
+  GtkBitset *set = gtk_bitset_new_empty ();
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i;
+
+  for (i = 0; i < N_ITEMS / 10; i++)
+    gtk_bitset_add (set, g_rand_int_range (rand, 0, N_ITEMS));
+
+  g_rand_free (rand);
+
+  return set;
+}
+
+static struct {
+  const char *name;
+  GtkBitset * (* create) (void);
+} sets[] = {
+  { "empty", create_empty },
+  { "full", create_full },
+  { "every other", create_every_other },
+  { "random 10%", create_random },
+};
+
+static struct {
+  const char *name;
+  BitsetFunc func;
+} benchmarks[] = {
+  { "select all", select_all },
+  { "unselect all", unselect_all },
+  { "invert", invert },
+  { "intersect", intersect_half },
+  { "shift right 1", shift_right_1 },
+  { "shift left 1", shift_left_1 },
+  { "shift right 65536", shift_right_65536 },
+  { "splice insert", splice_insert },
+  { "splice remove", splice_remove },
+  { "size", size },
+  { "size in range", size_in_range },
+};
+
+int
+main (int argc, char **argv)
+{
+  GTimer *timer;
+  guint i, j, k, runs;
+
+  timer = g_timer_new ();
+  runs = 10;
+
+  g_print ("%d items, best of %u runs\n", N_ITEMS, runs);
+
+  for (i = 0; i < G_N_ELEMENTS (sets); i++)
+    {
+      g_print ("\n%s:\n", sets[i].name);
+
+      for (j = 0; j < G_N_ELEMENTS (benchmarks); j++)
+        {
+          double best = G_MAXDOUBLE;
+
+          for (k = 0; k < runs; k++)
+            {
+              GtkBitset *set = sets[i].create ();
+              double msec;
+
+              g_timer_start (timer);
+              benchmarks[j].func (set);
+              msec = g_timer_elapsed (timer, NULL) * 1000;
+              best = MIN (best, msec);
+
+              gtk_bitset_unref (set);
+            }
+
+          g_print ("  %-20s %8.3f msec\n", benchmarks[j].name, best);
+        }
+    }
+
+  g_timer_destroy (timer);
+
+  return 0;
+}
@@ -1,6 +1,12 @@
 /* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
 
+/* Times the blurs of the cairo fallback paths, with the reference
+ * code and with the vectorized and threaded code, and checks that
+ * both produce the same pixels.
+ */
+
 #include <gsk/gskcairoblurprivate.h>
+#include <string.h>
 
 static void
 init_surface (cairo_t *cr)
@@ -9,20 +15,59 @@ init_surface (cairo_t *cr)
   int h = cairo_image_surface_get_height (cairo_get_target (cr));
 
   cairo_set_source_rgb (cr, 0, 0, 0);
-  cairo_fill (cr);
+  cairo_paint (cr);
 
-  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_set_source_rgba (cr, 1, 0.5, 0.25, 0.75);
   cairo_arc (cr, w/2, h/2, w/2, 0, 2*G_PI);
   cairo_fill (cr);
+
+  cairo_set_source_rgb (cr, 0.2, 0.9, 0.4);
+  cairo_rectangle (cr, w/7, h/5, w/3, h/9);
+  cairo_fill (cr);
+}
+
+static double
+blur (cairo_surface_t *surface,
+      int              radius,
+      gboolean         accelerated,
+      GTimer          *timer)
+{
+  cairo_t *cr;
+
+  cr = cairo_create (surface);
+  init_surface (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  gsk_cairo_blur_set_accelerated (accelerated);
+
+  g_timer_start (timer);
+  if (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_A8)
+    gsk_cairo_blur_surface (surface, radius, GSK_BLUR_X | GSK_BLUR_Y);
+  else
+    gsk_cairo_blur_argb_surface (surface, radius, 3);
+
+  return g_timer_elapsed (timer, NULL) * 1000;
+}
+
+static gboolean
+surfaces_equal (cairo_surface_t *a,
+                cairo_surface_t *b)
+{
+  return memcmp (cairo_image_surface_get_data (a),
+                 cairo_image_surface_get_data (b),
+                 cairo_image_surface_get_stride (a) * cairo_image_surface_get_height (a)) == 0;
 }
 
 int
 main (int argc, char **argv)
 {
-  cairo_surface_t *surface;
-  cairo_t *cr;
+  cairo_format_t formats[] = { CAIRO_FORMAT_A8, CAIRO_FORMAT_ARGB32 };
+  cairo_surface_t *reference, *surface;
   GTimer *timer;
-  double msec;
+  double reference_msec, msec;
+  gboolean all_equal = TRUE;
+  guint f;
   int i, j;
   int size;
 
@@ -30,25 +75,37 @@ main (int argc, char **argv)
 
   size = 2000;
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
+  for (f = 0; f < G_N_ELEMENTS (formats); f++)
+    {
+      g_print ("%s\n", formats[f] == CAIRO_FORMAT_A8 ? "A8" : "ARGB32");
 
-  cr = cairo_create (surface);
+      reference = cairo_image_surface_create (formats[f], size, size);
+      surface = cairo_image_surface_create (formats[f], size, size);
 
-  /* We do everything three times, first two as warmup */
-  for (j = 0; j < 2; j++)
-    {
-      for (i = 1; i < 16; i++)
-	{
-	  init_surface (cr);
-	  g_timer_start (timer);
-	  gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
-	  msec = g_timer_elapsed (timer, NULL) * 1000;
-	  if (j == 1)
-	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
-	}
+      /* We do everything three times, first two as warmup */
+      for (j = 0; j < 3; j++)
+        {
+          for (i = 1; i < 16; i++)
+            {
+              gboolean equal;
+
+              reference_msec = blur (reference, i, FALSE, timer);
+              msec = blur (surface, i, TRUE, timer);
+              equal = surfaces_equal (reference, surface);
+              all_equal &= equal;
+
+              if (j == 2)
+                g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec, reference %.2f msec, %s\n",
+                         i, msec, size*size/(msec*1000), reference_msec,
+                         equal ? "same output" : "DIFFERENT OUTPUT");
+            }
+        }
+
+      cairo_surface_destroy (reference);
+      cairo_surface_destroy (surface);
     }
 
   g_timer_destroy (timer);
 
-  return 0;
+  return all_equal ? 0 : 1;
 }
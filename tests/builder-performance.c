@@ -0,0 +1,188 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+#include <gtk/gtk.h>
+
+#define N_INSTANCES 10000
+
+static const char template_ui[] =
+  "<interface>"
+  "  <template class=\"TestRow\" parent=\"GtkWidget\">"
+  "    <property name=\"hexpand\">1</property>"
+  "    <property name=\"margin-start\">6</property>"
+  "    <property name=\"margin-end\">6</property>"
+  "    <child>"
+  "      <object class=\"GtkBox\" id=\"box\">"
+  "        <property name=\"orientation\">vertical</property>"
+  "        <property name=\"spacing\">6</property>"
+  "        <child>"
+  "          <object class=\"GtkBox\">"
+  "            <property name=\"spacing\">12</property>"
+  "            <child>"
+  "              <object class=\"GtkImage\">"
+  "                <property name=\"icon-name\">folder-symbolic</property>"
+  "                <property name=\"pixel-size\">32</property>"
+  "              </object>"
+  "            </child>"
+  "            <child>"
+  "              <object class=\"GtkLabel\" id=\"title\">"
+  "                <property name=\"label\">Title</property>"
+  "                <property name=\"xalign\">0</property>"
+  "                <property name=\"ellipsize\">end</property>"
+  "                <property name=\"hexpand\">1</property>"
+  "              </object>"
+  "            </child>"
+  "            <child>"
+  "              <object class=\"GtkLabel\">"
+  "                <property name=\"label\">Subtitle</property>"
+  "                <property name=\"xalign\">1</property>"
+  "                <property name=\"wrap\">1</property>"
+  "                <property name=\"wrap-mode\">word-char</property>"
+  "                <property name=\"justify\">right</property>"
+  "                <property name=\"width-chars\">20</property>"
+  "                <property name=\"visible\" bind-source=\"title\" bind-property=\"visible\" bind-flags=\"sync-create\"/>"
+  "              </object>"
+  "            </child>"
+  "          </object>"
+  "        </child>"
+  "        <child>"
+  "          <object class=\"GtkBox\">"
+  "            <property name=\"spacing\">6</property>"
+  "            <property name=\"halign\">end</property>"
+  "            <child>"
+  "              <object class=\"GtkEntry\">"
+  "                <property name=\"placeholder-text\">Search</property>"
+  "                <property name=\"max-length\">64</property>"
+  "                <property name=\"input-purpose\">free-form</property>"
+  "                <signal name=\"activate\" handler=\"row_activated\" swapped=\"no\"/>"
+  "              </object>"
+  "            </child>"
+  "            <child>"
+  "              <object class=\"GtkCheckButton\">"
+  "                <property name=\"label\">Enabled</property>"
+  "                <property name=\"active\">1</property>"
+  "                <signal name=\"toggled\" handler=\"row_toggled\" swapped=\"no\"/>"
+  "              </object>"
+  "            </child>"
+  "            <child>"
+  "              <object class=\"GtkButton\">"
+  "                <property name=\"label\">Open</property>"
+  "                <property name=\"focus-on-click\">0</property>"
+  "                <signal name=\"clicked\" handler=\"row_clicked\" swapped=\"no\"/>"
+  "              </object>"
+  "            </child>"
+  "          </object>"
+  "        </child>"
+  "      </object>"
+  "    </child>"
+  "  </template>"
+  "</interface>";
+
+typedef struct _TestRow TestRow;
+typedef struct _TestRowClass TestRowClass;
+
+struct _TestRow
+{
+  GtkWidget parent_instance;
+
+  GtkWidget *box;
+  GtkWidget *title;
+};
+
+struct _TestRowClass
+{
+  GtkWidgetClass parent_class;
+};
+
+G_DEFINE_TYPE (TestRow, test_row, GTK_TYPE_WIDGET)
+
+static void
+row_activated (GtkEntry *entry)
+{
+}
+
+static void
+row_toggled (GtkCheckButton *button)
+{
+}
+
+static void
+row_clicked (GtkButton *button)
+{
+}
+
+static void
+test_row_dispose (GObject *object)
+{
+  TestRow *self = (TestRow *) object;
+
+  g_clear_pointer (&self->box, gtk_widget_unparent);
+
+  G_OBJECT_CLASS (test_row_parent_class)->dispose (object);
+}
+
+static void
+test_row_class_init (TestRowClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+  GBytes *bytes;
+
+  object_class->dispose = test_row_dispose;
+
+  bytes = g_bytes_new_static (template_ui, strlen (template_ui));
+  gtk_widget_class_set_template (widget_class, bytes);
+  g_bytes_unref (bytes);
+
+  gtk_widget_class_bind_template_child (widget_class, TestRow, box);
+  gtk_widget_class_bind_template_child (widget_class, TestRow, title);
+  gtk_widget_class_bind_template_callback (widget_class, row_activated);
+  gtk_widget_class_bind_template_callback (widget_class, row_toggled);
+  gtk_widget_class_bind_template_callback (widget_class, row_clicked);
+
+  gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BIN_LAYOUT);
+}
+
+static void
+test_row_init (TestRow *self)
+{
+  gtk_widget_init_template (GTK_WIDGET (self));
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget **rows;
+  GTimer *timer;
+  double first, build, destroy;
+  guint i;
+
+  gtk_init ();
+
+  rows = g_new (GtkWidget *, N_INSTANCES);
+  timer = g_timer_new ();
+
+  /* The first instance does all the lookups */
+  g_timer_start (timer);
+  rows[0] = g_object_ref_sink (g_object_new (test_row_get_type (), NULL));
+  first = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (i = 1; i < N_INSTANCES; i++)
+    rows[i] = g_object_ref_sink (g_object_new (test_row_get_type (), NULL));
+  build = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_INSTANCES; i++)
+    g_object_unref (rows[i]);
+  destroy = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_print ("first instance:     %8.3f msec\n", first);
+  g_print ("%d instances:    %8.3f msec (%.3f usec each)\n",
+           N_INSTANCES - 1, build, build * 1000 / (N_INSTANCES - 1));
+  g_print ("destroying:         %8.3f msec\n", destroy);
+
+  g_timer_destroy (timer);
+  g_free (rows);
+
+  return 0;
+}
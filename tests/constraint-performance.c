@@ -0,0 +1,181 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Lays out a large grid of buttons with a constraint layout, built
+ * from VFL, and reports how long it takes to add the constraints,
+ * to measure the grid, and to allocate it at the same size and at
+ * changing sizes.
+ *
+ * Allocating again at the same size keeps the constraints of the
+ * previous allocation, so it should not need to solve anything and
+ * take a tiny fraction of the time of a resize.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_ROWS 30
+#define N_COLUMNS 20
+#define N_ITERATIONS 100
+
+static char *
+view_name (guint row,
+           guint col)
+{
+  return g_strdup_printf ("b_%u_%u", row, col);
+}
+
+static char **
+build_lines (GHashTable *views,
+             GtkWidget  *grid,
+             gsize      *n_lines)
+{
+  GPtrArray *lines = g_ptr_array_new ();
+  GString *line;
+  guint row, col;
+
+  for (row = 0; row < N_ROWS; row++)
+    {
+      for (col = 0; col < N_COLUMNS; col++)
+        {
+          char *label = g_strdup_printf ("%u, %u", row, col);
+          GtkWidget *button = gtk_button_new_with_label (label);
+
+          gtk_widget_set_parent (button, grid);
+          g_hash_table_insert (views, view_name (row, col), button);
+
+          g_free (label);
+        }
+    }
+
+  for (row = 0; row < N_ROWS; row++)
+    {
+      line = g_string_new ("H:|-");
+      for (col = 0; col < N_COLUMNS; col++)
+        {
+          char *name = view_name (row, col);
+
+          if (col == 0)
+            g_string_append_printf (line, "[%s(>=40)]", name);
+          else
+            g_string_append_printf (line, "-[%s(==b_%u_0)]", name, row);
+
+          g_free (name);
+        }
+      g_string_append (line, "-|");
+      g_ptr_array_add (lines, g_string_free (line, FALSE));
+    }
+
+  for (col = 0; col < N_COLUMNS; col++)
+    {
+      line = g_string_new ("V:|-");
+      for (row = 0; row < N_ROWS; row++)
+        {
+          char *name = view_name (row, col);
+
+          if (row == 0)
+            g_string_append_printf (line, "[%s(>=20)]", name);
+          else
+            g_string_append_printf (line, "-[%s(==b_0_%u)]", name, col);
+
+          g_free (name);
+        }
+      g_string_append (line, "-|");
+      g_ptr_array_add (lines, g_string_free (line, FALSE));
+    }
+
+  *n_lines = lines->len;
+  g_ptr_array_add (lines, NULL);
+
+  return (char **) g_ptr_array_free (lines, FALSE);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkLayoutManager *layout;
+  GtkWidget *window, *grid;
+  GHashTable *views;
+  GError *error = NULL;
+  GList *constraints;
+  GtkWidget *child;
+  char **lines;
+  gsize n_lines;
+  GTimer *timer;
+  double add, measure, first, same_size, resize;
+  int min_width, min_height;
+  int i;
+
+  gtk_init ();
+
+  window = gtk_window_new ();
+  grid = gtk_widget_new (GTK_TYPE_WIDGET, NULL);
+  layout = gtk_constraint_layout_new ();
+  gtk_widget_set_layout_manager (grid, layout);
+  gtk_window_set_child (GTK_WINDOW (window), grid);
+
+  views = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  lines = build_lines (views, grid, &n_lines);
+
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  constraints = gtk_constraint_layout_add_constraints_from_descriptionv (GTK_CONSTRAINT_LAYOUT (layout),
+                                                                         (const char * const *) lines,
+                                                                         n_lines,
+                                                                         8, 8,
+                                                                         views,
+                                                                         &error);
+  add = g_timer_elapsed (timer, NULL) * 1000;
+  g_assert_no_error (error);
+
+  /* Fill the size request caches of the buttons once */
+  gtk_layout_manager_measure (layout, grid, GTK_ORIENTATION_HORIZONTAL, -1,
+                              &min_width, NULL, NULL, NULL);
+  gtk_layout_manager_measure (layout, grid, GTK_ORIENTATION_VERTICAL, -1,
+                              &min_height, NULL, NULL, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      gtk_layout_manager_measure (layout, grid, GTK_ORIENTATION_HORIZONTAL, -1,
+                                  NULL, NULL, NULL, NULL);
+      gtk_layout_manager_measure (layout, grid, GTK_ORIENTATION_VERTICAL, min_width + i,
+                                  NULL, NULL, NULL, NULL);
+    }
+  measure = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  gtk_layout_manager_allocate (layout, grid, min_width, min_height, -1);
+  first = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    gtk_layout_manager_allocate (layout, grid, min_width, min_height, -1);
+  same_size = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ITERATIONS; i++)
+    gtk_layout_manager_allocate (layout, grid, min_width + 3 * i, min_height + 2 * i, -1);
+  resize = g_timer_elapsed (timer, NULL) * 1000;
+
+  g_print ("%d buttons, %u constraints\n",
+           N_ROWS * N_COLUMNS, g_list_length (constraints));
+  g_print ("adding constraints:  %8.3f msec\n", add);
+  g_print ("measuring:           %8.3f msec (%.3f msec each)\n",
+           measure, measure / (2 * N_ITERATIONS));
+  g_print ("allocating, first:   %8.3f msec\n", first);
+  g_print ("allocating, same:    %8.3f msec (%.3f msec each)\n",
+           same_size, same_size / N_ITERATIONS);
+  g_print ("allocating, resized: %8.3f msec (%.3f msec each)\n",
+           resize, resize / N_ITERATIONS);
+
+  g_list_free (constraints);
+  g_strfreev (lines);
+  g_hash_table_unref (views);
+  g_timer_destroy (timer);
+
+  while ((child = gtk_widget_get_first_child (grid)) != NULL)
+    gtk_widget_unparent (child);
+  gtk_window_destroy (GTK_WINDOW (window));
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Resizes a window on every frame and reports how long the frames
+ * took. This mostly measures the cost of getting new buffers for
+ * every size, so run it with GSK_RENDERER=cairo to test the shm
+ * buffer path, eg on a headless weston.
+ */
+
+#include <gtk/gtk.h>
+
+#define N_FRAMES 600
+#define MIN_SIZE 200
+#define MAX_SIZE 1000
+#define STEP 7
+
+static GtkWidget *window;
+static int size = MIN_SIZE;
+static int step = STEP;
+static guint n_frames;
+static gint64 start_time;
+static gboolean done;
+
+static void
+draw_func (GtkDrawingArea *da,
+           cairo_t        *cr,
+           int             width,
+           int             height,
+           gpointer        data)
+{
+  cairo_set_source_rgb (cr, 0.2, 0.4, 0.6);
+  cairo_paint (cr);
+}
+
+static gboolean
+tick_callback (GtkWidget     *widget,
+               GdkFrameClock *frame_clock,
+               gpointer       user_data)
+{
+  if (n_frames == 0)
+    start_time = g_get_monotonic_time ();
+
+  if (n_frames == N_FRAMES)
+    {
+      double msec = (g_get_monotonic_time () - start_time) / 1000.;
+
+      g_print ("%d resizes: %8.3f msec (%.3f msec per frame)\n",
+               N_FRAMES, msec, msec / N_FRAMES);
+
+      done = TRUE;
+      g_main_context_wakeup (NULL);
+
+      return G_SOURCE_REMOVE;
+    }
+
+  /* grow and shrink, so buffers of all sizes get freed and reused */
+  size += step;
+  if (size >= MAX_SIZE || size <= MIN_SIZE)
+    step = -step;
+
+  gtk_window_resize (GTK_WINDOW (window), size, size * 3 / 4);
+  gtk_widget_queue_draw (widget);
+
+  n_frames++;
+
+  return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *da;
+
+  gtk_init ();
+
+  window = gtk_window_new ();
+  gtk_window_resize (GTK_WINDOW (window), size, size * 3 / 4);
+
+  da = gtk_drawing_area_new ();
+  gtk_drawing_area_set_draw_func (GTK_DRAWING_AREA (da), draw_func, NULL, NULL);
+  gtk_window_set_child (GTK_WINDOW (window), da);
+
+  gtk_widget_add_tick_callback (window, tick_callback, NULL, NULL);
+
+  gtk_widget_show (window);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  gtk_window_destroy (GTK_WINDOW (window));
+
+  return 0;
+}
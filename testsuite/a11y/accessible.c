@@ -1,5 +1,6 @@
 #include <gtk/gtk.h>
 #include "gtk/gtkaccessibleprivate.h"
+#include "gtk/gtkatcontextprivate.h"
 
 /* These tests verify that the GtkAccessible machinery works, independent
  * of any concrete widget accessible implementations. Therefore, we use
@@ -34,10 +35,19 @@ test_object_accessible_get_at_context (GtkAccessible *accessible)
   return self->at_context;
 }
 
+static GtkATContext *
+test_object_accessible_peek_at_context (GtkAccessible *accessible)
+{
+  TestObject *self = (TestObject*)accessible;
+
+  return self->at_context;
+}
+
 static void
 test_object_accessible_init (GtkAccessibleInterface *iface)
 {
   iface->get_at_context = test_object_accessible_get_at_context;
+  iface->peek_at_context = test_object_accessible_peek_at_context;
 }
 
 G_DEFINE_TYPE_WITH_CODE (TestObject, test_object, G_TYPE_OBJECT,
@@ -619,6 +629,85 @@ test_reflist_relation (gconstpointer data)
   g_object_unref (third);
 }
 
+/* Tests for context creation and updates */
+
+static void
+test_lazy_context (void)
+{
+  TestObject *object;
+
+  object = test_object_new (GTK_ACCESSIBLE_ROLE_CHECKBOX);
+
+  gtk_accessible_update_state (GTK_ACCESSIBLE (object),
+                               GTK_ACCESSIBLE_STATE_CHECKED, GTK_ACCESSIBLE_TRISTATE_MIXED,
+                               -1);
+  gtk_accessible_update_state (GTK_ACCESSIBLE (object),
+                               GTK_ACCESSIBLE_STATE_CHECKED, GTK_ACCESSIBLE_TRISTATE_TRUE,
+                               -1);
+  gtk_accessible_update_property (GTK_ACCESSIBLE (object),
+                                  GTK_ACCESSIBLE_PROPERTY_LABEL, "Label",
+                                  -1);
+
+  /* Nothing asked for the context yet */
+  g_assert_null (object->at_context);
+
+  gtk_test_accessible_assert_state (object, GTK_ACCESSIBLE_STATE_CHECKED, GTK_ACCESSIBLE_TRISTATE_TRUE);
+  gtk_test_accessible_assert_property (object, GTK_ACCESSIBLE_PROPERTY_LABEL, "Label");
+  g_assert_nonnull (object->at_context);
+
+  g_object_unref (object);
+}
+
+static void
+count_state_change (GtkATContext *context,
+                    guint         changed_states,
+                    guint         changed_properties,
+                    guint         changed_relations,
+                    gpointer      states,
+                    gpointer      properties,
+                    gpointer      relations,
+                    gpointer      data)
+{
+  guint *count = data;
+
+  (*count)++;
+}
+
+static void
+test_coalesced_updates (void)
+{
+  TestObject *object;
+  GtkATContext *context;
+  guint count = 0;
+
+  object = test_object_new (GTK_ACCESSIBLE_ROLE_CHECKBOX);
+  context = gtk_accessible_get_at_context (GTK_ACCESSIBLE (object));
+  gtk_at_context_flush_updates ();
+
+  g_signal_connect (context, "state-change", G_CALLBACK (count_state_change), &count);
+
+  gtk_accessible_update_state (GTK_ACCESSIBLE (object),
+                               GTK_ACCESSIBLE_STATE_CHECKED, GTK_ACCESSIBLE_TRISTATE_TRUE,
+                               -1);
+  gtk_accessible_update_state (GTK_ACCESSIBLE (object),
+                               GTK_ACCESSIBLE_STATE_DISABLED, TRUE,
+                               -1);
+  gtk_accessible_update_property (GTK_ACCESSIBLE (object),
+                                  GTK_ACCESSIBLE_PROPERTY_LABEL, "Label",
+                                  -1);
+
+  /* The values are there right away, the notification comes later */
+  gtk_test_accessible_assert_state (object, GTK_ACCESSIBLE_STATE_DISABLED, TRUE);
+  g_assert_cmpuint (count, ==, 0);
+
+  while (count == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (count, ==, 1);
+
+  g_object_unref (object);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -676,5 +765,8 @@ main (int argc, char *argv[])
   g_test_add_data_func ("/a11y/relation/row-span", GUINT_TO_POINTER (GTK_ACCESSIBLE_RELATION_ROW_SPAN), test_int_relation);
   g_test_add_data_func ("/a11y/relation/set-size", GUINT_TO_POINTER (GTK_ACCESSIBLE_RELATION_SET_SIZE), test_int_relation);
 
+  g_test_add_func ("/a11y/context/lazy", test_lazy_context);
+  g_test_add_func ("/a11y/context/coalesced-updates", test_coalesced_updates);
+
   return g_test_run ();
 }
@@ -70,6 +70,88 @@ test_clipboard_basic (void)
   g_value_unset (&value);
 }
 
+static void
+stream_received (GObject      *source,
+                 GAsyncResult *res,
+                 gpointer      data)
+{
+  GdkClipboard *clipboard = GDK_CLIPBOARD (source);
+  GInputStream **stream = data;
+  GError *error = NULL;
+  const char *mime_type;
+
+  *stream = gdk_clipboard_read_finish (clipboard, res, &mime_type, &error);
+
+  g_assert_no_error (error);
+  g_assert_nonnull (*stream);
+  g_assert_cmpstr (mime_type, ==, "application/x-gtk-test");
+
+  g_main_context_wakeup (NULL);
+}
+
+static void
+test_clipboard_large (void)
+{
+  GdkClipboard *clipboard;
+  GdkContentProvider *content;
+  GInputStream *stream;
+  GOutputStream *output;
+  GBytes *bytes, *result;
+  gsize i, size;
+  guchar *data;
+  gint64 start, elapsed;
+  GError *error = NULL;
+
+  size = 64 * 1024 * 1024;
+  data = g_malloc (size);
+  for (i = 0; i < size; i++)
+    data[i] = i % 251;
+  bytes = g_bytes_new_take (data, size);
+
+  clipboard = gdk_display_get_clipboard (gdk_display_get_default ());
+  content = gdk_content_provider_new_for_bytes ("application/x-gtk-test", bytes);
+  gdk_clipboard_set_content (clipboard, content);
+  g_object_unref (content);
+
+  start = g_get_monotonic_time ();
+
+  stream = NULL;
+  gdk_clipboard_read_async (clipboard,
+                            (const char *[]) { "application/x-gtk-test", NULL },
+                            G_PRIORITY_DEFAULT,
+                            NULL,
+                            stream_received,
+                            &stream);
+
+  while (stream == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* in-process reads of in-memory data must not go through a pipe */
+  g_assert_true (G_IS_MEMORY_INPUT_STREAM (stream));
+
+  output = g_memory_output_stream_new_resizable ();
+  g_output_stream_splice (output,
+                          stream,
+                          G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                          NULL,
+                          &error);
+  g_assert_no_error (error);
+  result = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_assert_true (g_bytes_equal (bytes, result));
+
+  if (g_test_perf ())
+    g_test_maximized_result ((double) size / MAX (elapsed, 1),
+                             "%.1f MB/s", (double) size / MAX (elapsed, 1));
+
+  g_bytes_unref (result);
+  g_object_unref (output);
+  g_object_unref (stream);
+  g_bytes_unref (bytes);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -78,6 +160,7 @@ main (int argc, char *argv[])
   gtk_init ();
 
   g_test_add_func ("/clipboard/basic", test_clipboard_basic);
+  g_test_add_func ("/clipboard/large", test_clipboard_large);
 
   return g_test_run ();
 }
@@ -0,0 +1,232 @@
+#include "config.h"
+
+#include "gdk/gdk-private.h"
+#include "gdk/gdkeventsprivate.h"
+
+#define SEQUENCE ((GdkEventSequence *) GUINT_TO_POINTER (1))
+
+static GdkDisplay *display;
+static GdkSurface *surface;
+static GdkDevice *pointer;
+
+/* What the backends do with a new event */
+static void
+queue_event (GdkEvent *event)
+{
+  _gdk_event_queue_append (display, event);
+
+  _gdk_event_queue_handle_motion_compression (display);
+  gdk_event_queue_handle_scroll_compression (display);
+  gdk_event_queue_handle_batching (display);
+}
+
+static GdkEvent *
+motion_event (guint32 time,
+              double  x)
+{
+  return gdk_motion_event_new (surface, pointer, NULL, time, 0, x, 0, NULL);
+}
+
+static GdkEvent *
+touch_update_event (guint32 time,
+                    double  x)
+{
+  return gdk_touch_event_new (GDK_TOUCH_UPDATE, SEQUENCE, surface, pointer,
+                              time, 0, x, 0, NULL, FALSE);
+}
+
+static void
+assert_event (GdkEvent     *event,
+              GdkEventType  type,
+              guint32       time,
+              guint         n_history)
+{
+  GdkTimeCoord *history;
+  guint n_coords;
+
+  g_assert_nonnull (event);
+  g_assert_cmpint (gdk_event_get_event_type (event), ==, type);
+  g_assert_cmpuint (gdk_event_get_time (event), ==, time);
+
+  if (type == GDK_BUTTON_PRESS)
+    return;
+
+  history = gdk_event_get_history (event, &n_coords);
+  g_assert_cmpuint (n_coords, ==, n_history);
+  g_free (history);
+}
+
+static void
+clear_queue (void)
+{
+  GdkEvent *event;
+
+  _gdk_event_queue_flush (display);
+  while ((event = _gdk_event_unqueue (display)))
+    gdk_event_unref (event);
+}
+
+/* Consecutive motions are held back until the frame clock flushes
+ * the events, and are then delivered as one event that has the
+ * others in its history.
+ */
+static void
+test_batched_motion (void)
+{
+  GdkEvent *event;
+  GdkTimeCoord *history;
+  guint n_coords;
+
+  clear_queue ();
+  gdk_surface_set_event_batching (surface, TRUE);
+  g_assert_true (gdk_surface_get_event_batching (surface));
+
+  queue_event (motion_event (10, 1));
+  queue_event (motion_event (20, 2));
+  queue_event (motion_event (30, 3));
+
+  g_assert_null (_gdk_event_unqueue (display));
+
+  _gdk_event_queue_flush (display);
+
+  event = _gdk_event_unqueue (display);
+  assert_event (event, GDK_MOTION_NOTIFY, 30, 2);
+
+  history = gdk_event_get_history (event, &n_coords);
+  g_assert_cmpuint (history[0].time, ==, 10);
+  g_assert_cmpfloat (history[0].axes[GDK_AXIS_X], ==, 1);
+  g_assert_cmpuint (history[1].time, ==, 20);
+  g_assert_cmpfloat (history[1].axes[GDK_AXIS_X], ==, 2);
+  g_free (history);
+  gdk_event_unref (event);
+
+  g_assert_null (_gdk_event_unqueue (display));
+
+  gdk_surface_set_event_batching (surface, FALSE);
+}
+
+/* Without batching, touch updates aren't compressed,
+ * so every one of them is delivered.
+ */
+static void
+test_unbatched (void)
+{
+  GdkEvent *event;
+  guint32 time;
+
+  clear_queue ();
+  g_assert_false (gdk_surface_get_event_batching (surface));
+
+  queue_event (touch_update_event (10, 1));
+  queue_event (touch_update_event (20, 2));
+  queue_event (touch_update_event (30, 3));
+
+  for (time = 10; time <= 30; time += 10)
+    {
+      event = _gdk_event_unqueue (display);
+      assert_event (event, GDK_TOUCH_UPDATE, time, 0);
+      gdk_event_unref (event);
+    }
+
+  g_assert_null (_gdk_event_unqueue (display));
+}
+
+/* With batching, the same touch updates are delivered as one */
+static void
+test_batched_touch (void)
+{
+  GdkEvent *event;
+
+  clear_queue ();
+  gdk_surface_set_event_batching (surface, TRUE);
+
+  queue_event (touch_update_event (10, 1));
+  queue_event (touch_update_event (20, 2));
+  queue_event (touch_update_event (30, 3));
+
+  g_assert_null (_gdk_event_unqueue (display));
+  _gdk_event_queue_flush (display);
+
+  event = _gdk_event_unqueue (display);
+  assert_event (event, GDK_TOUCH_UPDATE, 30, 2);
+  gdk_event_unref (event);
+
+  g_assert_null (_gdk_event_unqueue (display));
+
+  gdk_surface_set_event_batching (surface, FALSE);
+}
+
+/* Other events are not held back, and the batch in front of them
+ * is delivered first. Motions after them start a new batch.
+ */
+static void
+test_flush_on_other_event (void)
+{
+  GdkEvent *event;
+
+  clear_queue ();
+  gdk_surface_set_event_batching (surface, TRUE);
+
+  queue_event (motion_event (10, 1));
+  queue_event (motion_event (20, 2));
+  queue_event (gdk_button_event_new (GDK_BUTTON_PRESS, surface, pointer, NULL,
+                                     30, 0, GDK_BUTTON_PRIMARY, 2, 0, NULL));
+  queue_event (motion_event (40, 4));
+
+  event = _gdk_event_unqueue (display);
+  assert_event (event, GDK_MOTION_NOTIFY, 20, 1);
+  gdk_event_unref (event);
+
+  event = _gdk_event_unqueue (display);
+  assert_event (event, GDK_BUTTON_PRESS, 30, 0);
+  gdk_event_unref (event);
+
+  g_assert_null (_gdk_event_unqueue (display));
+  _gdk_event_queue_flush (display);
+
+  event = _gdk_event_unqueue (display);
+  assert_event (event, GDK_MOTION_NOTIFY, 40, 0);
+  gdk_event_unref (event);
+
+  g_assert_null (_gdk_event_unqueue (display));
+
+  gdk_surface_set_event_batching (surface, FALSE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GdkSeat *seat = NULL;
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gdk_pre_parse ();
+  display = gdk_display_open_default ();
+  if (display)
+    {
+      surface = gdk_surface_new_toplevel (display);
+      seat = gdk_display_get_default_seat (display);
+    }
+  if (seat)
+    pointer = gdk_seat_get_pointer (seat);
+
+  /* Events need a surface and a device */
+  if (pointer)
+    {
+      g_test_add_func ("/eventbatching/batched-motion", test_batched_motion);
+      g_test_add_func ("/eventbatching/unbatched", test_unbatched);
+      g_test_add_func ("/eventbatching/batched-touch", test_batched_touch);
+      g_test_add_func ("/eventbatching/flush-on-other-event", test_flush_on_other_event);
+    }
+
+  result = g_test_run ();
+
+  if (surface)
+    {
+      clear_queue ();
+      gdk_surface_destroy (surface);
+    }
+
+  return result;
+}
@@ -0,0 +1,350 @@
+#include <gtk/gtk.h>
+
+#ifdef GDK_WINDOWING_HEADLESS
+#include <gdk/headless/gdkheadless.h>
+#endif
+
+/* These tests only run with the headless setup, where
+ * GDK_BACKEND=headless makes the default display headless.
+ */
+
+#ifdef GDK_WINDOWING_HEADLESS
+
+#define WIDTH 20
+#define HEIGHT 10
+
+static GdkDisplay *
+get_headless_display (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+
+  if (display == NULL || !GDK_IS_HEADLESS_DISPLAY (display))
+    {
+      g_test_skip ("Needs the headless backend");
+      return NULL;
+    }
+
+  return display;
+}
+
+static void
+compute_size (GdkToplevel     *toplevel,
+              GdkToplevelSize *size,
+              gpointer         data)
+{
+  gdk_toplevel_size_set_size (size, WIDTH, HEIGHT);
+}
+
+static GdkSurface *
+create_toplevel (GdkDisplay *display)
+{
+  GdkSurface *surface;
+  GdkToplevelLayout *layout;
+
+  surface = gdk_surface_new_toplevel (display);
+  g_signal_connect (surface, "compute-size", G_CALLBACK (compute_size), NULL);
+
+  layout = gdk_toplevel_layout_new ();
+  gdk_toplevel_present (GDK_TOPLEVEL (surface), layout);
+  gdk_toplevel_layout_unref (layout);
+
+  g_assert_true (gdk_surface_get_mapped (surface));
+  g_assert_cmpint (gdk_surface_get_width (surface), ==, WIDTH);
+  g_assert_cmpint (gdk_surface_get_height (surface), ==, HEIGHT);
+
+  return surface;
+}
+
+static void
+record_frame_time (GdkFrameClock *clock,
+                   GArray        *times)
+{
+  gint64 frame_time = gdk_frame_clock_get_frame_time (clock);
+
+  g_array_append_val (times, frame_time);
+}
+
+static void
+test_frame_clock_stepped (void)
+{
+  GdkDisplay *display;
+  GdkSurface *surface;
+  GdkFrameClock *clock;
+  GArray *times;
+  int i;
+
+  display = get_headless_display ();
+  if (display == NULL)
+    return;
+
+  gdk_headless_display_set_free_running (display, FALSE);
+  gdk_headless_display_set_frame_interval (display, 10000);
+  g_assert_false (gdk_headless_display_get_free_running (display));
+  g_assert_cmpint (gdk_headless_display_get_frame_interval (display), ==, 10000);
+
+  surface = gdk_surface_new_toplevel (display);
+  clock = gdk_surface_get_frame_clock (surface);
+  times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_signal_connect (clock, "update", G_CALLBACK (record_frame_time), times);
+
+  /* Finish whatever the new surface asked for */
+  while (gdk_headless_display_run_frame (display));
+
+  /* Requested frames wait for the test to run them */
+  gdk_frame_clock_request_phase (clock, GDK_FRAME_CLOCK_PHASE_UPDATE);
+  for (i = 0; i < 10; i++)
+    g_main_context_iteration (NULL, FALSE);
+  g_assert_cmpuint (times->len, ==, 0);
+
+  g_assert_true (gdk_headless_display_run_frame (display));
+  g_assert_cmpuint (times->len, ==, 1);
+
+  /* Nothing was requested, so nothing runs */
+  g_assert_false (gdk_headless_display_run_frame (display));
+  g_assert_cmpuint (times->len, ==, 1);
+
+  /* Each frame advances the frame time by exactly one interval */
+  gdk_frame_clock_begin_updating (clock);
+  g_assert_true (gdk_headless_display_run_frame (display));
+  g_assert_true (gdk_headless_display_run_frame (display));
+  gdk_frame_clock_end_updating (clock);
+  g_assert_cmpuint (times->len, ==, 3);
+  g_assert_cmpint (g_array_index (times, gint64, 1) - g_array_index (times, gint64, 0), ==, 10000);
+  g_assert_cmpint (g_array_index (times, gint64, 2) - g_array_index (times, gint64, 1), ==, 10000);
+
+  g_signal_handlers_disconnect_by_func (clock, record_frame_time, times);
+  g_array_unref (times);
+  gdk_surface_destroy (surface);
+
+  gdk_headless_display_set_frame_interval (display, 16667);
+  gdk_headless_display_set_free_running (display, TRUE);
+}
+
+static void
+test_frame_clock_free_running (void)
+{
+  GdkDisplay *display;
+  GdkSurface *surface;
+  GdkFrameClock *clock;
+  GArray *times;
+  guint i;
+
+  display = get_headless_display ();
+  if (display == NULL)
+    return;
+
+  g_assert_true (gdk_headless_display_get_free_running (display));
+
+  surface = gdk_surface_new_toplevel (display);
+  clock = gdk_surface_get_frame_clock (surface);
+  times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_signal_connect (clock, "update", G_CALLBACK (record_frame_time), times);
+
+  /* Frames run on their own, as fast as the main loop goes,
+   * but the frame time still advances by the interval
+   */
+  gdk_frame_clock_begin_updating (clock);
+  while (times->len < 5)
+    g_main_context_iteration (NULL, TRUE);
+  gdk_frame_clock_end_updating (clock);
+
+  for (i = 1; i < times->len; i++)
+    g_assert_cmpint (g_array_index (times, gint64, i) - g_array_index (times, gint64, i - 1),
+                     ==,
+                     gdk_headless_display_get_frame_interval (display));
+
+  /* Without work, no more frames run */
+  for (i = 0; i < 10; i++)
+    g_main_context_iteration (NULL, FALSE);
+  g_assert_cmpuint (times->len, ==, 5);
+
+  g_signal_handlers_disconnect_by_func (clock, record_frame_time, times);
+  g_array_unref (times);
+  gdk_surface_destroy (surface);
+}
+
+static gboolean
+record_event (GdkSurface *surface,
+              GdkEvent   *event,
+              GPtrArray  *events)
+{
+  g_ptr_array_add (events, gdk_event_ref (event));
+
+  return TRUE;
+}
+
+static GdkEvent *
+find_event (GPtrArray    *events,
+            GdkEventType  type)
+{
+  guint i;
+
+  for (i = 0; i < events->len; i++)
+    {
+      GdkEvent *event = g_ptr_array_index (events, i);
+
+      if (gdk_event_get_event_type (event) == type)
+        return event;
+    }
+
+  return NULL;
+}
+
+static void
+test_inject_events (void)
+{
+  GdkDisplay *display;
+  GdkSurface *surface;
+  GPtrArray *events;
+  GdkEvent *event;
+  double x, y;
+
+  display = get_headless_display ();
+  if (display == NULL)
+    return;
+
+  surface = create_toplevel (display);
+  events = g_ptr_array_new_with_free_func ((GDestroyNotify) gdk_event_unref);
+  g_signal_connect (surface, "event", G_CALLBACK (record_event), events);
+
+  gdk_headless_surface_inject_motion (surface, 5, 7);
+  gdk_headless_surface_inject_button (surface, GDK_BUTTON_PRIMARY, TRUE);
+  gdk_headless_surface_inject_button (surface, GDK_BUTTON_PRIMARY, FALSE);
+  gdk_headless_surface_inject_scroll (surface, 0, 1);
+  gdk_headless_surface_inject_key (surface, GDK_KEY_a, TRUE);
+
+  /* Events are only delivered from the main loop */
+  g_assert_null (find_event (events, GDK_KEY_PRESS));
+  while (find_event (events, GDK_KEY_PRESS) == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_nonnull (find_event (events, GDK_ENTER_NOTIFY));
+
+  event = find_event (events, GDK_MOTION_NOTIFY);
+  g_assert_nonnull (event);
+  g_assert_true (gdk_event_get_position (event, &x, &y));
+  g_assert_cmpfloat (x, ==, 5);
+  g_assert_cmpfloat (y, ==, 7);
+
+  event = find_event (events, GDK_BUTTON_PRESS);
+  g_assert_nonnull (event);
+  g_assert_cmpuint (gdk_button_event_get_button (event), ==, GDK_BUTTON_PRIMARY);
+  g_assert_true (gdk_event_get_position (event, &x, &y));
+  g_assert_cmpfloat (x, ==, 5);
+  g_assert_cmpfloat (y, ==, 7);
+
+  event = find_event (events, GDK_BUTTON_RELEASE);
+  g_assert_nonnull (event);
+  g_assert_true ((gdk_event_get_modifier_state (event) & GDK_BUTTON1_MASK) != 0);
+
+  event = find_event (events, GDK_SCROLL);
+  g_assert_nonnull (event);
+  g_assert_true (gdk_event_get_surface (event) == surface);
+
+  event = find_event (events, GDK_KEY_PRESS);
+  g_assert_cmpuint (gdk_key_event_get_keyval (event), ==, GDK_KEY_a);
+  g_assert_true (gdk_event_get_surface (event) == surface);
+
+  g_signal_handlers_disconnect_by_func (surface, record_event, events);
+  g_ptr_array_unref (events);
+  gdk_surface_destroy (surface);
+}
+
+static void
+draw (GdkCairoContext     *context,
+      const GdkRectangle  *area,
+      double               red,
+      double               blue)
+{
+  cairo_region_t *region;
+  cairo_t *cr;
+
+  region = cairo_region_create_rectangle (area);
+  gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (context), region);
+  cairo_region_destroy (region);
+
+  cr = gdk_cairo_context_cairo_create (context);
+  cairo_set_source_rgb (cr, red, 0, blue);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (context));
+}
+
+static guint32
+get_pixel (GdkTexture *texture,
+           int         x,
+           int         y)
+{
+  int width = gdk_texture_get_width (texture);
+  int height = gdk_texture_get_height (texture);
+  guint32 *data;
+  guint32 pixel;
+
+  data = g_new (guint32, width * height);
+  gdk_texture_download (texture, (guchar *) data, width * 4);
+  pixel = data[y * width + x];
+  g_free (data);
+
+  return pixel;
+}
+
+static void
+test_contents (void)
+{
+  GdkDisplay *display;
+  GdkSurface *surface;
+  GdkCairoContext *context;
+  GdkTexture *first, *second;
+  int scale;
+
+  display = get_headless_display ();
+  if (display == NULL)
+    return;
+
+  surface = create_toplevel (display);
+  scale = gdk_surface_get_scale_factor (surface);
+  g_assert_null (gdk_headless_surface_get_contents (surface));
+
+  context = gdk_surface_create_cairo_context (surface);
+  draw (context, &(GdkRectangle) { 0, 0, WIDTH, HEIGHT }, 1, 0);
+
+  first = gdk_headless_surface_get_contents (surface);
+  g_assert_nonnull (first);
+  g_assert_cmpint (gdk_texture_get_width (first), ==, WIDTH * scale);
+  g_assert_cmpint (gdk_texture_get_height (first), ==, HEIGHT * scale);
+  g_assert_cmphex (get_pixel (first, 0, 0), ==, 0xffff0000);
+
+  /* Later frames only change what they draw, and don't
+   * change the textures that were returned before
+   */
+  draw (context, &(GdkRectangle) { 0, 0, WIDTH / 2, HEIGHT }, 0, 1);
+
+  second = gdk_headless_surface_get_contents (surface);
+  g_assert_cmphex (get_pixel (second, 0, 0), ==, 0xff0000ff);
+  g_assert_cmphex (get_pixel (second, WIDTH * scale - 1, 0), ==, 0xffff0000);
+  g_assert_cmphex (get_pixel (first, 0, 0), ==, 0xffff0000);
+
+  g_object_unref (first);
+  g_object_unref (second);
+  g_object_unref (context);
+  gdk_surface_destroy (surface);
+}
+
+#endif
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gtk_init ();
+
+#ifdef GDK_WINDOWING_HEADLESS
+  g_test_add_func ("/headless/frame-clock/stepped", test_frame_clock_stepped);
+  g_test_add_func ("/headless/frame-clock/free-running", test_frame_clock_free_running);
+  g_test_add_func ("/headless/inject-events", test_inject_events);
+  g_test_add_func ("/headless/contents", test_contents);
+#endif
+
+  return g_test_run ();
+}
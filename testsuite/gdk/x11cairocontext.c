@@ -0,0 +1,202 @@
+#include "config.h"
+
+#include "gdk/gdk-private.h"
+#include "gdk/x11/gdkx.h"
+#include "gdk/x11/gdkcairocontext-x11.h"
+#include "gdk/x11/gdkdisplay-x11.h"
+
+/* Draws with the X11 cairo context on a real X server, such as Xvfb,
+ * and checks that the pixels arrive and that MIT-SHM uploads are only
+ * waited for while their completion event is outstanding.
+ */
+
+#define SIZE 64
+
+static void
+compute_size (GdkToplevel     *toplevel,
+              GdkToplevelSize *size,
+              gpointer         data)
+{
+  gdk_toplevel_size_set_size (size, SIZE, SIZE);
+}
+
+static gboolean
+timeout_cb (gpointer data)
+{
+  gboolean *timed_out = data;
+
+  *timed_out = TRUE;
+  g_main_context_wakeup (NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static GdkSurface *
+create_mapped_surface (GdkDisplay *display)
+{
+  GdkSurface *surface;
+  GdkToplevelLayout *layout;
+  gboolean timed_out = FALSE;
+  guint id;
+
+  surface = gdk_surface_new_toplevel (display);
+  g_signal_connect (surface, "compute-size", G_CALLBACK (compute_size), NULL);
+
+  layout = gdk_toplevel_layout_new ();
+  gdk_toplevel_present (GDK_TOPLEVEL (surface), layout);
+  gdk_toplevel_layout_unref (layout);
+
+  id = g_timeout_add (5000, timeout_cb, &timed_out);
+  while (!timed_out &&
+         (!gdk_surface_get_mapped (surface) ||
+          gdk_surface_get_width (surface) != SIZE ||
+          gdk_surface_get_height (surface) != SIZE))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_false (timed_out);
+  g_source_remove (id);
+
+  return surface;
+}
+
+static void
+begin_frame (GdkCairoContext *context)
+{
+  cairo_region_t *region;
+
+  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, SIZE, SIZE });
+  gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (context), region);
+  cairo_region_destroy (region);
+}
+
+static void
+end_frame (GdkCairoContext *context,
+           double           red)
+{
+  cairo_t *cr;
+
+  cr = gdk_cairo_context_cairo_create (context);
+  cairo_set_source_rgb (cr, red, 0, 1);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (context));
+}
+
+static void
+draw_frame (GdkCairoContext *context,
+            double           red)
+{
+  begin_frame (context);
+  end_frame (context, red);
+}
+
+static void
+assert_window_pixel (GdkSurface *surface,
+                     guint32     pixel)
+{
+  Display *xdisplay = gdk_x11_display_get_xdisplay (gdk_surface_get_display (surface));
+  XImage *image;
+
+  XSync (xdisplay, False);
+  image = XGetImage (xdisplay, gdk_x11_surface_get_xid (surface),
+                     SIZE / 2, SIZE / 2, 1, 1,
+                     AllPlanes, ZPixmap);
+  g_assert_nonnull (image);
+  g_assert_cmphex (XGetPixel (image, 0, 0) & 0xffffff, ==, pixel);
+  XDestroyImage (image);
+}
+
+static void
+test_draw (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+  GdkSurface *surface;
+  GdkCairoContext *context;
+  GdkX11CairoContext *context_x11;
+
+  if (!GDK_IS_X11_DISPLAY (display))
+    {
+      g_test_skip ("Needs an X server");
+      return;
+    }
+
+  surface = create_mapped_surface (display);
+  context = gdk_surface_create_cairo_context (surface);
+  context_x11 = GDK_X11_CAIRO_CONTEXT (context);
+
+  draw_frame (context, 1);
+  if (context_x11->image == NULL)
+    {
+      g_test_skip ("The visual has no client side buffer");
+      goto out;
+    }
+  assert_window_pixel (surface, 0xff00ff);
+
+  /* The buffer is kept, and pushed again on the next frame */
+  draw_frame (context, 0);
+  assert_window_pixel (surface, 0x0000ff);
+
+out:
+  g_object_unref (context);
+  gdk_surface_destroy (surface);
+}
+
+static void
+test_shm_completion (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+  GdkSurface *surface;
+  GdkCairoContext *context;
+  GdkX11CairoContext *context_x11;
+
+  if (!GDK_IS_X11_DISPLAY (display))
+    {
+      g_test_skip ("Needs an X server");
+      return;
+    }
+
+  surface = create_mapped_surface (display);
+  context = gdk_surface_create_cairo_context (surface);
+  context_x11 = GDK_X11_CAIRO_CONTEXT (context);
+
+  draw_frame (context, 1);
+  if (!context_x11->use_shm)
+    {
+      g_test_skip ("The X server can't share memory with us");
+      goto out;
+    }
+
+  /* The upload is in flight until its completion event arrives */
+  g_assert_cmpuint (context_x11->shm_pending, >, 0);
+
+  /* Handling the completion event ends it without blocking */
+  XSync (gdk_x11_display_get_xdisplay (display), False);
+  while (context_x11->shm_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* A frame that starts before the event was handled waits for it */
+  draw_frame (context, 0);
+  g_assert_cmpuint (context_x11->shm_pending, >, 0);
+  begin_frame (context);
+  g_assert_cmpuint (context_x11->shm_pending, ==, 0);
+  end_frame (context, 1);
+
+  assert_window_pixel (surface, 0xff00ff);
+
+out:
+  g_object_unref (context);
+  gdk_surface_destroy (surface);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  gdk_set_allowed_backends ("x11");
+  gdk_display_open (NULL);
+
+  g_test_add_func ("/x11/cairo-context/draw", test_draw);
+  g_test_add_func ("/x11/cairo-context/shm-completion", test_shm_completion);
+
+  return g_test_run ();
+}
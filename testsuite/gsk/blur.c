@@ -0,0 +1,143 @@
+#include "config.h"
+
+#include <string.h>
+#include "gsk/gskcairoblurprivate.h"
+
+/* Checks that the vectorized and threaded blurs produce exactly the
+ * same pixels as the reference implementation, with sizes that leave
+ * partial vectors at the end of rows and strides with padding.
+ */
+
+typedef struct {
+  int width;
+  int height;
+  int padding;
+} Size;
+
+static const Size sizes[] = {
+  { 1, 1, 0 },
+  { 3, 7, 4 },
+  { 17, 5, 12 },
+  { 33, 31, 4 },
+  /* Big enough to be split between threads */
+  { 301, 263, 8 },
+};
+
+static const int radii[] = { 1, 2, 5, 16 };
+
+static const cairo_user_data_key_t data_key;
+
+typedef void (* BlurFunc) (cairo_surface_t *surface,
+                           int              radius,
+                           int              param);
+
+static cairo_surface_t *
+create_surface (cairo_format_t  format,
+                const Size     *size,
+                guint32         seed)
+{
+  cairo_surface_t *surface;
+  guchar *data;
+  int stride, i;
+  GRand *rand;
+
+  stride = cairo_format_stride_for_width (format, size->width) + size->padding;
+  data = g_malloc (stride * size->height);
+
+  rand = g_rand_new_with_seed (seed);
+  for (i = 0; i < stride * size->height; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+  g_rand_free (rand);
+
+  surface = cairo_image_surface_create_for_data (data, format, size->width, size->height, stride);
+  g_assert_cmpint (cairo_surface_status (surface), ==, CAIRO_STATUS_SUCCESS);
+  cairo_surface_set_user_data (surface, &data_key, data, g_free);
+
+  return surface;
+}
+
+static void
+compare_blurs (cairo_format_t format,
+               BlurFunc       blur,
+               int            param)
+{
+  cairo_surface_t *reference, *surface;
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    for (j = 0; j < G_N_ELEMENTS (radii); j++)
+      {
+        reference = create_surface (format, &sizes[i], i * 31 + j);
+        surface = create_surface (format, &sizes[i], i * 31 + j);
+
+        gsk_cairo_blur_set_accelerated (FALSE);
+        blur (reference, radii[j], param);
+        gsk_cairo_blur_set_accelerated (TRUE);
+        blur (surface, radii[j], param);
+
+        if (memcmp (cairo_image_surface_get_data (reference),
+                    cairo_image_surface_get_data (surface),
+                    cairo_image_surface_get_stride (surface) * sizes[i].height) != 0)
+          g_error ("Blurring %dx%d with radius %d differs",
+                   sizes[i].width, sizes[i].height, radii[j]);
+
+        cairo_surface_destroy (reference);
+        cairo_surface_destroy (surface);
+      }
+}
+
+static void
+blur_a8 (cairo_surface_t *surface,
+         int              radius,
+         int              flags)
+{
+  gsk_cairo_blur_surface (surface, radius, flags);
+}
+
+static void
+blur_argb (cairo_surface_t *surface,
+           int              radius,
+           int              iterations)
+{
+  gsk_cairo_blur_argb_surface (surface, radius, iterations);
+}
+
+/* A8 surfaces are only blurred by the scalar code, but in threads */
+static void
+test_a8 (void)
+{
+  compare_blurs (CAIRO_FORMAT_A8, blur_a8, GSK_BLUR_X);
+  compare_blurs (CAIRO_FORMAT_A8, blur_a8, GSK_BLUR_Y);
+  compare_blurs (CAIRO_FORMAT_A8, blur_a8, GSK_BLUR_X | GSK_BLUR_Y);
+}
+
+static void
+test_argb (gconstpointer data)
+{
+  GskBlurKernels kernels = GPOINTER_TO_INT (data);
+
+  if (!gsk_cairo_blur_set_kernels (kernels))
+    {
+      g_test_skip ("Not supported on this CPU");
+      return;
+    }
+
+  compare_blurs (CAIRO_FORMAT_ARGB32, blur_argb, 1);
+  compare_blurs (CAIRO_FORMAT_ARGB32, blur_argb, 3);
+
+  gsk_cairo_blur_set_kernels (GSK_BLUR_KERNELS_DEFAULT);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/blur/a8", test_a8);
+  g_test_add_data_func ("/blur/argb/scalar", GINT_TO_POINTER (GSK_BLUR_KERNELS_SCALAR), test_argb);
+  g_test_add_data_func ("/blur/argb/sse2", GINT_TO_POINTER (GSK_BLUR_KERNELS_SSE2), test_argb);
+  g_test_add_data_func ("/blur/argb/avx2", GINT_TO_POINTER (GSK_BLUR_KERNELS_AVX2), test_argb);
+  g_test_add_data_func ("/blur/argb/neon", GINT_TO_POINTER (GSK_BLUR_KERNELS_NEON), test_argb);
+
+  return g_test_run ();
+}
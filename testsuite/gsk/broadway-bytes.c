@@ -0,0 +1,307 @@
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#ifdef GDK_WINDOWING_BROADWAY
+#include <gdk/broadway/gdkbroadway.h>
+#include <gsk/broadway/gskbroadwayrenderer.h>
+#endif
+
+/* Connects to broadwayd like a browser would, and counts the bytes
+ * it sends us when a label changes. If GTK_BROADWAYD points to a
+ * broadwayd binary, as it does when run from the build directory,
+ * the test starts its own server. Otherwise it needs a running
+ * broadwayd, and skips without one.
+ */
+
+#define N_UPDATES 20
+
+/* A fallback texture for the label is a few kB. Sending glyphs
+ * costs a few hundred bytes.
+ */
+#define MAX_BYTES_PER_UPDATE 1024
+
+#ifdef GDK_WINDOWING_BROADWAY
+static const char request[] =
+  "GET /socket HTTP/1.1\r\n"
+  "Host: localhost\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Sec-WebSocket-Protocol: broadway\r\n"
+  "Sec-WebSocket-Version: 13\r\n";
+
+static GSocketConnection *
+connect_browser (gboolean deflate)
+{
+  const char *display_name;
+  GSocketClient *client;
+  GSocketConnection *connection;
+  GSocket *socket;
+  char *headers;
+  int port = 8080;
+
+  display_name = g_getenv ("BROADWAY_DISPLAY");
+  if (display_name && display_name[0] == ':')
+    port += atoi (display_name + 1);
+
+  client = g_socket_client_new ();
+  connection = g_socket_client_connect_to_host (client, "localhost", port, NULL, NULL);
+  g_object_unref (client);
+
+  if (connection == NULL)
+    return NULL;
+
+  socket = g_socket_connection_get_socket (connection);
+  headers = g_strconcat (request,
+                         deflate ? "Sec-WebSocket-Extensions: permessage-deflate\r\n" : "",
+                         "\r\n",
+                         NULL);
+  if (g_socket_send (socket, headers, strlen (headers), NULL, NULL) < 0)
+    g_clear_object (&connection);
+  g_free (headers);
+
+  return connection;
+}
+
+/* Reads everything broadwayd sent us so far */
+static gsize
+drain (GSocketConnection *connection)
+{
+  GSocket *socket = g_socket_connection_get_socket (connection);
+  char buffer[4096];
+  gsize total = 0;
+
+  while (g_socket_condition_timed_wait (socket, G_IO_IN, 200 * 1000, NULL, NULL))
+    {
+      gssize n = g_socket_receive (socket, buffer, sizeof (buffer), NULL, NULL);
+
+      if (n <= 0)
+        break;
+
+      total += n;
+    }
+
+  return total;
+}
+
+static void
+render_label (GskRenderer *renderer,
+              PangoLayout *layout,
+              const char  *text)
+{
+  GtkSnapshot *snapshot;
+  GskRenderNode *node;
+
+  pango_layout_set_text (layout, text, -1);
+
+  snapshot = gtk_snapshot_new ();
+  gtk_snapshot_append_color (snapshot,
+                             &(GdkRGBA) { 1, 1, 1, 1 },
+                             &GRAPHENE_RECT_INIT (0, 0, 200, 50));
+  gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 0, 0, 0, 1 });
+  node = gtk_snapshot_free_to_node (snapshot);
+
+  gsk_renderer_render (renderer, node, NULL);
+  gsk_render_node_unref (node);
+
+  gdk_display_sync (gdk_surface_get_display (gsk_renderer_get_surface (renderer)));
+}
+
+/* Returns the average number of bytes per label update, or 0 if
+ * there is no broadwayd to talk to */
+static gsize
+measure_label_updates (gboolean deflate)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+  GSocketConnection *connection;
+  GdkSurface *surface;
+  GskRenderer *renderer;
+  PangoContext *context;
+  PangoLayout *layout;
+  GError *error = NULL;
+  gsize first, updates;
+  guint i;
+
+  connection = connect_browser (deflate);
+  if (connection == NULL)
+    return 0;
+
+  /* handshake and resync */
+  drain (connection);
+
+  surface = gdk_surface_new_toplevel (display);
+  renderer = gsk_broadway_renderer_new ();
+  gsk_renderer_realize (renderer, surface, &error);
+  g_assert_no_error (error);
+
+  context = gdk_pango_context_get_for_display (display);
+  layout = pango_layout_new (context);
+
+  /* The first frame sends all glyphs we need */
+  render_label (renderer, layout, "Counter: 0123456789");
+  first = drain (connection);
+
+  updates = 0;
+  for (i = 1; i <= N_UPDATES; i++)
+    {
+      char *text = g_strdup_printf ("Counter: %u", i * 1237);
+
+      render_label (renderer, layout, text);
+      updates += drain (connection);
+
+      g_free (text);
+    }
+
+  g_test_message ("%s: first frame: %" G_GSIZE_FORMAT " bytes, updates: %" G_GSIZE_FORMAT " bytes each",
+                  deflate ? "compressed" : "uncompressed",
+                  first, updates / N_UPDATES);
+
+  g_object_unref (layout);
+  g_object_unref (context);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+  g_object_unref (connection);
+
+  return MAX (updates / N_UPDATES, 1);
+}
+#endif
+
+static void
+test_label_updates (void)
+{
+#ifdef GDK_WINDOWING_BROADWAY
+  gsize bytes;
+
+  if (!GDK_IS_BROADWAY_DISPLAY (gdk_display_get_default ()))
+    {
+      g_test_skip ("Not running on broadway");
+      return;
+    }
+
+  bytes = measure_label_updates (FALSE);
+  if (bytes == 0)
+    {
+      g_test_skip ("Can't connect to broadwayd");
+      return;
+    }
+
+  g_assert_cmpuint (bytes, <=, MAX_BYTES_PER_UPDATE);
+#else
+  g_test_skip ("Broadway support not compiled in");
+#endif
+}
+
+static void
+test_label_updates_compressed (void)
+{
+#ifdef GDK_WINDOWING_BROADWAY
+  gsize plain, compressed;
+
+  if (!GDK_IS_BROADWAY_DISPLAY (gdk_display_get_default ()))
+    {
+      g_test_skip ("Not running on broadway");
+      return;
+    }
+
+  plain = measure_label_updates (FALSE);
+  compressed = measure_label_updates (TRUE);
+  if (plain == 0 || compressed == 0)
+    {
+      g_test_skip ("Can't connect to broadwayd");
+      return;
+    }
+
+  g_assert_cmpuint (compressed, <, plain);
+#else
+  g_test_skip ("Broadway support not compiled in");
+#endif
+}
+
+#ifdef GDK_WINDOWING_BROADWAY
+static GPid server_pid;
+
+static gboolean
+start_broadwayd (void)
+{
+  const char *broadwayd = g_getenv ("GTK_BROADWAYD");
+  char *display;
+  char *argv[3];
+  GError *error = NULL;
+  guint i;
+
+  if (broadwayd == NULL || g_getenv ("BROADWAY_DISPLAY") != NULL)
+    return FALSE;
+
+  display = g_strdup_printf (":%d", 50 + getpid () % 50);
+
+  argv[0] = (char *) broadwayd;
+  argv[1] = display;
+  argv[2] = NULL;
+
+  if (!g_spawn_async (NULL, argv, NULL, G_SPAWN_DEFAULT, NULL, NULL, &server_pid, &error))
+    {
+      g_printerr ("Failed to start %s: %s\n", broadwayd, error->message);
+      g_error_free (error);
+      g_free (display);
+      return FALSE;
+    }
+
+  g_setenv ("BROADWAY_DISPLAY", display, TRUE);
+  g_setenv ("GDK_BACKEND", "broadway", TRUE);
+  g_free (display);
+
+  /* Wait until the server accepts connections */
+  for (i = 0; i < 50; i++)
+    {
+      GSocketConnection *connection = connect_browser (FALSE);
+
+      if (connection)
+        {
+          g_object_unref (connection);
+          return TRUE;
+        }
+
+      g_usleep (100 * 1000);
+    }
+
+  return TRUE;
+}
+
+static void
+stop_broadwayd (void)
+{
+  if (server_pid == 0)
+    return;
+
+  kill (server_pid, SIGTERM);
+  g_spawn_close_pid (server_pid);
+  server_pid = 0;
+}
+#endif
+
+int
+main (int argc, char *argv[])
+{
+  int result;
+
+#ifdef GDK_WINDOWING_BROADWAY
+  start_broadwayd ();
+#endif
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/broadway/bytes/label-updates", test_label_updates);
+  g_test_add_func ("/broadway/bytes/label-updates-compressed", test_label_updates_compressed);
+
+  result = g_test_run ();
+
+#ifdef GDK_WINDOWING_BROADWAY
+  stop_broadwayd ();
+#endif
+
+  return result;
+}
@@ -0,0 +1,237 @@
+#include "config.h"
+
+#include <string.h>
+#include "gsk/gskcairoshadowcacheprivate.h"
+
+/* Checks that the cache of blurred shadow masks stays within its
+ * budget, and that shadows drawn from cached masks look the same
+ * as the ones they were cached from.
+ */
+
+static void
+key_init (GskCairoShadowKey *key,
+          float              width)
+{
+  memset (key, 0, sizeof (GskCairoShadowKey));
+  key->kind = GSK_CAIRO_SHADOW_SHAPE;
+  key->blur_radius = 10;
+  key->x_scale = key->y_scale = 1;
+  key->size = GRAPHENE_SIZE_INIT (width, 50);
+  gsk_rounded_rect_init_from_rect (&key->outline, &GRAPHENE_RECT_INIT (10, 10, width - 20, 30), 5);
+}
+
+static void
+test_lookup (void)
+{
+  GskCairoShadowKey key;
+  cairo_surface_t *mask, *found;
+  guint hits, misses, old_hits, old_misses;
+
+  gsk_cairo_shadow_cache_set_budget (1024 * 1024);
+  gsk_cairo_shadow_cache_get_stats (&old_hits, &old_misses, NULL);
+
+  key_init (&key, 100);
+  g_assert_null (gsk_cairo_shadow_cache_lookup (&key));
+
+  mask = cairo_image_surface_create (CAIRO_FORMAT_A8, 100, 50);
+  gsk_cairo_shadow_cache_commit (&key, mask);
+
+  found = gsk_cairo_shadow_cache_lookup (&key);
+  g_assert_true (found == mask);
+  cairo_surface_destroy (found);
+
+  key.outline.corner[GSK_CORNER_BOTTOM_LEFT].width = 6;
+  g_assert_null (gsk_cairo_shadow_cache_lookup (&key));
+
+  gsk_cairo_shadow_cache_get_stats (&hits, &misses, NULL);
+  g_assert_cmpuint (hits - old_hits, ==, 1);
+  g_assert_cmpuint (misses - old_misses, ==, 2);
+
+  cairo_surface_destroy (mask);
+  gsk_cairo_shadow_cache_set_budget (0);
+}
+
+static void
+test_budget (void)
+{
+  GskCairoShadowKey key;
+  cairo_surface_t *mask, *found;
+  gsize size;
+  int i;
+
+  gsk_cairo_shadow_cache_set_budget (64 * 1024);
+
+  for (i = 0; i < 20; i++)
+    {
+      key_init (&key, 100 + i);
+      mask = cairo_image_surface_create (CAIRO_FORMAT_A8, 100 + i, 50);
+      gsk_cairo_shadow_cache_commit (&key, mask);
+      cairo_surface_destroy (mask);
+
+      /* Keep the first one in use */
+      key_init (&key, 100);
+      found = gsk_cairo_shadow_cache_lookup (&key);
+      g_assert_nonnull (found);
+      cairo_surface_destroy (found);
+    }
+
+  gsk_cairo_shadow_cache_get_stats (NULL, NULL, &size);
+  g_assert_cmpuint (size, <=, 64 * 1024);
+
+  key_init (&key, 101);
+  g_assert_null (gsk_cairo_shadow_cache_lookup (&key));
+  key_init (&key, 119);
+  found = gsk_cairo_shadow_cache_lookup (&key);
+  g_assert_nonnull (found);
+  cairo_surface_destroy (found);
+
+  /* Masks that would push out most of the others are not kept */
+  key_init (&key, 1000);
+  mask = cairo_image_surface_create (CAIRO_FORMAT_A8, 1000, 50);
+  gsk_cairo_shadow_cache_commit (&key, mask);
+  cairo_surface_destroy (mask);
+  g_assert_null (gsk_cairo_shadow_cache_lookup (&key));
+
+  gsk_cairo_shadow_cache_set_budget (0);
+  gsk_cairo_shadow_cache_get_stats (NULL, NULL, &size);
+  g_assert_cmpuint (size, ==, 0);
+}
+
+static void
+draw_node (GskRenderNode *node,
+           guint32       *pixel)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 200, 150);
+  cr = cairo_create (surface);
+  gsk_render_node_draw (node, cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  /* Left of the outline, where the shadow is partly covering */
+  if (pixel)
+    *pixel = *(guint32 *) (cairo_image_surface_get_data (surface) +
+                           60 * cairo_image_surface_get_stride (surface) + 27 * 4);
+
+  cairo_surface_destroy (surface);
+}
+
+static GskRenderNode *
+shadow_node_new (const GdkRGBA *color,
+                 float          blur_radius)
+{
+  GskRoundedRect outline;
+
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (30, 30, 100, 60), 8);
+
+  return gsk_outset_shadow_node_new (&outline, color, 3, 2, 4, blur_radius);
+}
+
+/* Drawing the same shadow again uses the masks of the first one,
+ * a different blur radius needs new ones, and a different color
+ * uses the same masks, as they don't depend on it.
+ */
+static void
+test_render (void)
+{
+  const GdkRGBA black = { 0, 0, 0, 1 };
+  const GdkRGBA red = { 1, 0, 0, 1 };
+  GskRenderNode *node;
+  guint hits, misses, old_hits, old_misses;
+  guint32 pixel;
+
+  /* Start out empty */
+  gsk_cairo_shadow_cache_set_budget (0);
+  gsk_cairo_shadow_cache_set_budget (4 * 1024 * 1024);
+
+  node = shadow_node_new (&black, 12);
+  draw_node (node, NULL);
+  gsk_cairo_shadow_cache_get_stats (&old_hits, &old_misses, NULL);
+  g_assert_cmpuint (old_misses, >, 0);
+
+  draw_node (node, &pixel);
+  gsk_render_node_unref (node);
+  gsk_cairo_shadow_cache_get_stats (&hits, &misses, NULL);
+  g_assert_cmpuint (hits, >, old_hits);
+  g_assert_cmpuint (misses, ==, old_misses);
+  g_assert_cmpuint (pixel >> 24, >, 0);
+  g_assert_cmpuint (pixel & 0xffffff, ==, 0);
+
+  old_hits = hits;
+  old_misses = misses;
+  node = shadow_node_new (&black, 13);
+  draw_node (node, NULL);
+  gsk_render_node_unref (node);
+  gsk_cairo_shadow_cache_get_stats (&hits, &misses, NULL);
+  g_assert_cmpuint (misses, >, old_misses);
+
+  old_hits = hits;
+  old_misses = misses;
+  node = shadow_node_new (&red, 12);
+  draw_node (node, &pixel);
+  gsk_render_node_unref (node);
+  gsk_cairo_shadow_cache_get_stats (&hits, &misses, NULL);
+  g_assert_cmpuint (hits, >, old_hits);
+  g_assert_cmpuint (misses, ==, old_misses);
+  g_assert_cmpuint ((pixel >> 16) & 0xff, >, 0);
+  g_assert_cmpuint (pixel & 0xffff, ==, 0);
+
+  gsk_cairo_shadow_cache_set_budget (0);
+}
+
+static void
+test_same_pixels (void)
+{
+  const GdkRGBA color = { 0, 0, 0, 1 };
+  GskRenderNode *nodes[2], *container;
+  GskRoundedRect outline;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  guchar *data;
+  int stride, x, y;
+
+  /* The same shadow twice, 200 pixels apart, so the second one can
+   * be drawn from the masks of the first one.
+   */
+  gsk_cairo_shadow_cache_set_budget (4 * 1024 * 1024);
+
+  gsk_rounded_rect_init_from_rect (&outline, &GRAPHENE_RECT_INIT (30.5, 30, 100, 60), 8);
+  nodes[0] = gsk_outset_shadow_node_new (&outline, &color, 3, 2, 4, 12);
+  gsk_rounded_rect_offset (&outline, 200, 0);
+  nodes[1] = gsk_outset_shadow_node_new (&outline, &color, 3, 2, 4, 12);
+  container = gsk_container_node_new (nodes, 2);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 400, 150);
+  cr = cairo_create (surface);
+  gsk_render_node_draw (container, cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  for (y = 0; y < 150; y++)
+    for (x = 0; x < 200; x++)
+      g_assert_cmpuint (((guint32 *) (data + y * stride))[x], ==,
+                        ((guint32 *) (data + y * stride))[x + 200]);
+
+  cairo_surface_destroy (surface);
+  gsk_cairo_shadow_cache_set_budget (0);
+  gsk_render_node_unref (container);
+  gsk_render_node_unref (nodes[0]);
+  gsk_render_node_unref (nodes[1]);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/shadowcache/lookup", test_lookup);
+  g_test_add_func ("/shadowcache/budget", test_budget);
+  g_test_add_func ("/shadowcache/render", test_render);
+  g_test_add_func ("/shadowcache/same-pixels", test_same_pixels);
+
+  return g_test_run ();
+}
@@ -0,0 +1,177 @@
+#include "config.h"
+
+#include "gdk/gdk-private.h"
+#include "gsk/gl/gskgltextureatlasprivate.h"
+
+/* Big enough that every atlas only fits one of them */
+#define BIG_SIZE 500
+
+static GskGLTextureAtlas *
+add_atlas (GskGLTextureAtlases *atlases)
+{
+  GskGLTextureAtlas *atlas;
+  int x, y;
+
+  g_assert_true (gsk_gl_texture_atlases_pack (atlases, BIG_SIZE, BIG_SIZE, &atlas, &x, &y));
+
+  return atlas;
+}
+
+static guint
+begin_frame (GskGLTextureAtlases *atlases,
+             gpointer             renderer)
+{
+  GPtrArray *removed;
+  guint n_removed;
+
+  removed = g_ptr_array_new ();
+  gsk_gl_texture_atlases_begin_frame (atlases, renderer, removed);
+  n_removed = removed->len;
+  g_ptr_array_unref (removed);
+
+  return n_removed;
+}
+
+static GskGLTextureAtlases *
+create_atlases (void)
+{
+  GskGLTextureAtlases *atlases;
+
+  atlases = gsk_gl_texture_atlases_new ();
+  /* Drop every atlas that isn't in use */
+  atlases->max_bytes = 0;
+
+  return atlases;
+}
+
+/* Two renderers alternating frames, each using its own atlas in
+ * every frame, must never lose them.
+ */
+static void
+test_shared_renderers (void)
+{
+  GskGLTextureAtlases *atlases;
+  GskGLTextureAtlas *atlas_a, *atlas_b;
+  int renderer_a, renderer_b;
+  guint i;
+
+  atlases = create_atlases ();
+
+  begin_frame (atlases, &renderer_a);
+  atlas_a = add_atlas (atlases);
+  begin_frame (atlases, &renderer_b);
+  atlas_b = add_atlas (atlases);
+
+  for (i = 0; i < 10; i++)
+    {
+      g_assert_cmpuint (begin_frame (atlases, &renderer_a), ==, 0);
+      gsk_gl_texture_atlases_mark_accessed (atlases, atlas_a);
+
+      g_assert_cmpuint (begin_frame (atlases, &renderer_b), ==, 0);
+      gsk_gl_texture_atlases_mark_accessed (atlases, atlas_b);
+    }
+
+  g_assert_cmpuint (atlases->atlases->len, ==, 2);
+
+  gsk_gl_texture_atlases_unref (atlases);
+}
+
+/* An atlas used by one renderer is kept while another one renders,
+ * and dropped once its renderer had a frame without it.
+ */
+static void
+test_idle_eviction (void)
+{
+  GskGLTextureAtlases *atlases;
+  int renderer_a, renderer_b;
+
+  atlases = create_atlases ();
+
+  begin_frame (atlases, &renderer_a);
+  add_atlas (atlases);
+  begin_frame (atlases, &renderer_b);
+  add_atlas (atlases);
+
+  /* Both were used in the last frame of their renderer */
+  g_assert_cmpuint (begin_frame (atlases, &renderer_a), ==, 0);
+  g_assert_cmpuint (atlases->atlases->len, ==, 2);
+
+  /* The last frame of renderer A didn't use its atlas */
+  g_assert_cmpuint (begin_frame (atlases, &renderer_b), ==, 1);
+  g_assert_cmpuint (atlases->atlases->len, ==, 1);
+
+  /* Neither did the last frame of renderer B */
+  g_assert_cmpuint (begin_frame (atlases, &renderer_a), ==, 1);
+  g_assert_cmpuint (atlases->atlases->len, ==, 0);
+
+  gsk_gl_texture_atlases_unref (atlases);
+}
+
+/* A renderer that went away no longer keeps its atlases */
+static void
+test_remove_renderer (void)
+{
+  GskGLTextureAtlases *atlases;
+  int renderer_a, renderer_b;
+
+  atlases = create_atlases ();
+
+  begin_frame (atlases, &renderer_a);
+  add_atlas (atlases);
+  begin_frame (atlases, &renderer_b);
+  gsk_gl_texture_atlases_remove_renderer (atlases, &renderer_a);
+
+  g_assert_cmpuint (begin_frame (atlases, &renderer_b), ==, 1);
+  g_assert_cmpuint (atlases->atlases->len, ==, 0);
+
+  gsk_gl_texture_atlases_unref (atlases);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GdkDisplay *display;
+  GdkSurface *surface = NULL;
+  GdkGLContext *context = NULL;
+  GError *error = NULL;
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gdk_pre_parse ();
+  display = gdk_display_open_default ();
+  if (display)
+    {
+      surface = gdk_surface_new_toplevel (display);
+      context = gdk_surface_create_gl_context (surface, &error);
+      if (context && !gdk_gl_context_realize (context, &error))
+        g_clear_object (&context);
+      if (error)
+        {
+          g_printerr ("No GL: %s\n", error->message);
+          g_clear_error (&error);
+        }
+    }
+
+  /* Atlases are GL textures, so there is nothing to test without GL */
+  if (context)
+    {
+      gdk_gl_context_make_current (context);
+
+      g_test_add_func ("/textureatlas/shared-renderers", test_shared_renderers);
+      g_test_add_func ("/textureatlas/idle-eviction", test_idle_eviction);
+      g_test_add_func ("/textureatlas/remove-renderer", test_remove_renderer);
+    }
+
+  result = g_test_run ();
+
+  if (context)
+    {
+      gdk_gl_context_clear_current ();
+      g_object_unref (context);
+    }
+  if (surface)
+    gdk_surface_destroy (surface);
+
+  return result;
+}
@@ -717,6 +717,159 @@ test_enabled (void)
   g_object_unref (g_object_ref_sink (text));
 }
 
+/* Test that action lookups see changes made to
+ * the hierarchy after earlier lookups of the same
+ * action, since lookups are cached.
+ */
+static void
+test_lookup_changes (void)
+{
+  GtkWidget *window;
+  GtkWidget *box;
+  GtkWidget *box2;
+  GtkWidget *button;
+  GActionEntry entries[] = {
+    { "action", activate, NULL, NULL, NULL },
+  };
+  GSimpleActionGroup *win_actions;
+  GSimpleActionGroup *box_actions;
+  GSimpleActionGroup *box2_actions;
+  int win_activated = 0;
+  int box_activated = 0;
+  int box2_activated = 0;
+
+  /* Our hierarchy looks like this:
+   *
+   * window
+   *   |
+   *  box2
+   *   |
+   *  box
+   *   |
+   * button
+   */
+  window = gtk_window_new ();
+  box2 = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  button = gtk_button_new ();
+
+  gtk_window_set_child (GTK_WINDOW (window), box2);
+  gtk_box_append (GTK_BOX (box2), box);
+  gtk_box_append (GTK_BOX (box), button);
+
+  win_actions = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (win_actions), entries, G_N_ELEMENTS (entries), &win_activated);
+  box_actions = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (box_actions), entries, G_N_ELEMENTS (entries), &box_activated);
+  box2_actions = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (box2_actions), entries, G_N_ELEMENTS (entries), &box2_activated);
+
+  g_assert_false (gtk_widget_activate_action (button, "group.action", NULL));
+
+  /* A group appearing on an ancestor */
+  gtk_widget_insert_action_group (window, "group", G_ACTION_GROUP (win_actions));
+  g_assert_true (gtk_widget_activate_action (button, "group.action", NULL));
+  g_assert_cmpint (win_activated, ==, 1);
+
+  /* A closer group hiding it */
+  gtk_widget_insert_action_group (box, "group", G_ACTION_GROUP (box_actions));
+  g_assert_true (gtk_widget_activate_action (button, "group.action", NULL));
+  g_assert_cmpint (win_activated, ==, 1);
+  g_assert_cmpint (box_activated, ==, 1);
+
+  /* The action going away from the closer group */
+  g_action_map_remove_action (G_ACTION_MAP (box_actions), "action");
+  g_assert_true (gtk_widget_activate_action (button, "group.action", NULL));
+  g_assert_cmpint (win_activated, ==, 2);
+  g_assert_cmpint (box_activated, ==, 1);
+
+  /* A new parent with its own group */
+  gtk_widget_insert_action_group (box2, "group", G_ACTION_GROUP (box2_actions));
+  g_object_ref (button);
+  gtk_box_remove (GTK_BOX (box), button);
+  gtk_box_append (GTK_BOX (box2), button);
+  g_object_unref (button);
+  g_assert_true (gtk_widget_activate_action (button, "group.action", NULL));
+  g_assert_cmpint (win_activated, ==, 2);
+  g_assert_cmpint (box2_activated, ==, 1);
+
+  /* The group going away */
+  gtk_widget_insert_action_group (box2, "group", NULL);
+  g_assert_true (gtk_widget_activate_action (button, "group.action", NULL));
+  g_assert_cmpint (win_activated, ==, 3);
+  g_assert_cmpint (box2_activated, ==, 1);
+
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_object_unref (win_actions);
+  g_object_unref (box_actions);
+  g_object_unref (box2_actions);
+}
+
+/* Test that actionables follow the state of their
+ * action when they are moved between parents that
+ * provide it differently.
+ */
+static void
+test_reparent_actionable (void)
+{
+  GtkWidget *window;
+  GtkWidget *box;
+  GtkWidget *box1;
+  GtkWidget *box2;
+  GtkWidget *button;
+  GActionEntry entries[] = {
+    { "action", activate, NULL, NULL, NULL },
+  };
+  GSimpleActionGroup *actions1;
+  GSimpleActionGroup *actions2;
+  GAction *action;
+  int activated = 0;
+
+  window = gtk_window_new ();
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  box1 = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  box2 = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  button = gtk_button_new ();
+  gtk_actionable_set_action_name (GTK_ACTIONABLE (button), "group.action");
+
+  gtk_window_set_child (GTK_WINDOW (window), box);
+  gtk_box_append (GTK_BOX (box), box1);
+  gtk_box_append (GTK_BOX (box), box2);
+
+  actions1 = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (actions1), entries, G_N_ELEMENTS (entries), &activated);
+  actions2 = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (actions2), entries, G_N_ELEMENTS (entries), &activated);
+  action = g_action_map_lookup_action (G_ACTION_MAP (actions2), "action");
+  g_simple_action_set_enabled (G_SIMPLE_ACTION (action), FALSE);
+
+  gtk_widget_insert_action_group (box1, "group", G_ACTION_GROUP (actions1));
+  gtk_widget_insert_action_group (box2, "group", G_ACTION_GROUP (actions2));
+
+  g_object_ref (button);
+
+  gtk_box_append (GTK_BOX (box1), button);
+  g_assert_true (gtk_widget_get_sensitive (button));
+
+  gtk_box_remove (GTK_BOX (box1), button);
+  gtk_box_append (GTK_BOX (box2), button);
+  g_assert_false (gtk_widget_get_sensitive (button));
+
+  gtk_box_remove (GTK_BOX (box2), button);
+  gtk_box_append (GTK_BOX (box1), button);
+  g_assert_true (gtk_widget_get_sensitive (button));
+
+  gtk_box_remove (GTK_BOX (box1), button);
+  gtk_box_append (GTK_BOX (box), button);
+  g_assert_false (gtk_widget_get_sensitive (button));
+
+  g_object_unref (button);
+
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_object_unref (actions1);
+  g_object_unref (actions2);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -732,6 +885,8 @@ main (int   argc,
   g_test_add_func ("/action/overlap2", test_overlap2);
   g_test_add_func ("/action/introspection", test_introspection);
   g_test_add_func ("/action/enabled", test_enabled);
+  g_test_add_func ("/action/lookup-changes", test_lookup_changes);
+  g_test_add_func ("/action/reparent-actionable", test_reparent_actionable);
 
   return g_test_run();
 }
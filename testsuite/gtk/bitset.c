@@ -555,6 +555,66 @@ test_splice_overflow (void)
   g_assert_true (gtk_bitset_equals (set, compare));
 }
 
+static void
+test_splice_large (void)
+{
+  guint i, j;
+
+  for (i = 0; i < 100; i++)
+    {
+      GtkBitset *set, *expected;
+      GtkBitsetIter iter;
+      guint position, removed, added, value;
+      gboolean more;
+
+      set = gtk_bitset_new_empty ();
+      for (j = 0; j < 1000; j++)
+        gtk_bitset_add (set, g_test_rand_int_range (0, 400000));
+      if (i % 2)
+        gtk_bitset_add_range (set, g_test_rand_int_range (0, 300000), 100000);
+
+      position = g_test_rand_int_range (0, 400000);
+      removed = g_test_rand_int_range (0, 100000);
+      added = g_test_rand_int_range (0, 100000);
+
+      expected = gtk_bitset_new_empty ();
+      for (more = gtk_bitset_iter_init_first (&iter, set, &value);
+           more;
+           more = gtk_bitset_iter_next (&iter, &value))
+        {
+          if (value < position)
+            gtk_bitset_add (expected, value);
+          else if (value >= position + removed)
+            gtk_bitset_add (expected, value - removed + added);
+        }
+
+      gtk_bitset_splice (set, position, removed, added);
+      g_assert_true (gtk_bitset_equals (set, expected));
+
+      gtk_bitset_unref (expected);
+      gtk_bitset_unref (set);
+    }
+}
+
+static void
+test_shift_overflow (void)
+{
+  GtkBitset *set, *compare;
+
+  set = gtk_bitset_new_range (G_MAXUINT - 70000, 70001);
+  gtk_bitset_shift_right (set, 65537);
+  compare = gtk_bitset_new_range (G_MAXUINT - 70000 + 65537, 70001 - 65537);
+  g_assert_true (gtk_bitset_equals (set, compare));
+  gtk_bitset_unref (compare);
+
+  gtk_bitset_shift_left (set, G_MAXUINT - 10);
+  compare = gtk_bitset_new_range (0, 11);
+  g_assert_true (gtk_bitset_equals (set, compare));
+  gtk_bitset_unref (compare);
+
+  gtk_bitset_unref (set);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -575,6 +635,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/bitset/rectangle", test_rectangle);
   g_test_add_func ("/bitset/iter", test_iter);
   g_test_add_func ("/bitset/splice-overflow", test_splice_overflow);
+  g_test_add_func ("/bitset/splice-large", test_splice_large);
+  g_test_add_func ("/bitset/shift-overflow", test_shift_overflow);
 
   return g_test_run ();
 }
@@ -2297,6 +2297,104 @@ test_template (void)
   g_assert (GTK_IS_LABEL (my_gtk_grid->priv->label));
 }
 
+#define MY_GTK_BOX_TEMPLATE "\
+<interface>\n\
+ <template class=\"MyGtkBox\" parent=\"GtkBox\">\n\
+   <property name=\"orientation\">vertical</property>\n\
+   <property name=\"spacing\">6</property>\n\
+    <child>\n\
+     <object class=\"GtkLabel\" id=\"label\">\n\
+       <property name=\"label\">Hello</property>\n\
+       <property name=\"ellipsize\">end</property>\n\
+       <property name=\"xalign\">0.25</property>\n\
+       <property name=\"selectable\">True</property>\n\
+     </object>\n\
+  </child>\n\
+    <child>\n\
+     <object class=\"GtkButton\" id=\"button\">\n\
+       <property name=\"label\">Click</property>\n\
+       <signal name=\"clicked\" handler=\"my_gtk_box_clicked\"/>\n\
+     </object>\n\
+  </child>\n\
+ </template>\n\
+</interface>\n"
+
+typedef struct
+{
+  GtkBoxClass parent_class;
+} MyGtkBoxClass;
+
+typedef struct
+{
+  GtkBox parent_instance;
+  GtkLabel *label;
+  GtkButton *button;
+  guint n_clicks;
+} MyGtkBox;
+
+G_DEFINE_TYPE (MyGtkBox, my_gtk_box, GTK_TYPE_BOX);
+
+static void
+my_gtk_box_clicked (GtkButton *button,
+                    MyGtkBox  *box)
+{
+  box->n_clicks++;
+}
+
+static void
+my_gtk_box_init (MyGtkBox *box)
+{
+  gtk_widget_init_template (GTK_WIDGET (box));
+}
+
+static void
+my_gtk_box_class_init (MyGtkBoxClass *klass)
+{
+  GBytes *template = g_bytes_new_static (MY_GTK_BOX_TEMPLATE, strlen (MY_GTK_BOX_TEMPLATE));
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  gtk_widget_class_set_template (widget_class, template);
+  gtk_widget_class_bind_template_child (widget_class, MyGtkBox, label);
+  gtk_widget_class_bind_template_child (widget_class, MyGtkBox, button);
+  gtk_widget_class_bind_template_callback (widget_class, my_gtk_box_clicked);
+  g_bytes_unref (template);
+}
+
+/* Later instances reuse the lookups and values of the first one,
+ * make sure they come out the same
+ */
+static void
+test_template_instances (void)
+{
+  MyGtkBox *boxes[3];
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (boxes); i++)
+    boxes[i] = g_object_ref_sink (g_object_new (my_gtk_box_get_type (), NULL));
+
+  for (i = 0; i < G_N_ELEMENTS (boxes); i++)
+    {
+      MyGtkBox *box = boxes[i];
+
+      g_assert_cmpint (gtk_orientable_get_orientation (GTK_ORIENTABLE (box)), ==, GTK_ORIENTATION_VERTICAL);
+      g_assert_cmpint (gtk_box_get_spacing (GTK_BOX (box)), ==, 6);
+      g_assert_true (GTK_IS_LABEL (box->label));
+      g_assert_cmpstr (gtk_label_get_label (box->label), ==, "Hello");
+      g_assert_cmpint (gtk_label_get_ellipsize (box->label), ==, PANGO_ELLIPSIZE_END);
+      g_assert_cmpfloat (gtk_label_get_xalign (box->label), ==, 0.25);
+      g_assert_true (gtk_label_get_selectable (box->label));
+
+      if (i > 0)
+        g_assert_true (box->label != boxes[i - 1]->label);
+
+      g_signal_emit_by_name (box->button, "clicked");
+      g_assert_cmpuint (box->n_clicks, ==, 1);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (boxes); i++)
+    g_object_unref (boxes[i]);
+}
+
 _BUILDER_TEST_EXPORT void
 on_cellrenderertoggle1_toggled (GtkCellRendererToggle *cell)
 {
@@ -2547,6 +2645,7 @@ main (int argc, char **argv)
   g_test_add_func ("/Builder/LevelBar", test_level_bar);
   g_test_add_func ("/Builder/Expose Object", test_expose_object);
   g_test_add_func ("/Builder/Template", test_template);
+  g_test_add_func ("/Builder/Template/Instances", test_template_instances);
   g_test_add_func ("/Builder/No IDs", test_no_ids);
   g_test_add_func ("/Builder/Property Bindings", test_property_bindings);
   g_test_add_func ("/Builder/anaconda-signal", test_anaconda_signal);
@@ -275,12 +275,96 @@ constraint_solver_edit_var_suggest (void)
   g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (a), 12.0, 0.001);
   g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (b), 12.0, 0.001);
 
+  gtk_constraint_solver_suggest_value (solver, a, 12.0);
+  gtk_constraint_solver_resolve (solver);
+
+  g_test_message ("Check values after suggesting the same value");
+
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (a), 12.0, 0.001);
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (b), 12.0, 0.001);
+
+  gtk_constraint_solver_suggest_value (solver, a, 4.0);
+  gtk_constraint_solver_resolve (solver);
+
+  g_test_message ("Check values after fourth edit");
+
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (a), 4.0, 0.001);
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (b), 4.0, 0.001);
+
   gtk_constraint_variable_unref (a);
   gtk_constraint_variable_unref (b);
 
   g_object_unref (solver);
 }
 
+#define N_TERMS 32
+
+static void
+constraint_solver_many_terms (void)
+{
+  GtkConstraintSolver *solver = gtk_constraint_solver_new ();
+  GtkConstraintVariable *vars[N_TERMS];
+  GtkConstraintRef *first;
+  GtkConstraintExpressionBuilder builder;
+  GtkConstraintExpression *expr;
+  GtkConstraintVariable *total;
+  int i;
+
+  total = gtk_constraint_solver_create_variable (solver, NULL, "total", 0.0);
+
+  for (i = 0; i < N_TERMS; i++)
+    vars[i] = gtk_constraint_solver_create_variable (solver, NULL, "v", 0.0);
+
+  /* total = v0 + v1 + … + vn, which is long enough for the
+   * expression to need an index of its terms
+   */
+  gtk_constraint_expression_builder_init (&builder, solver);
+  for (i = 0; i < N_TERMS; i++)
+    {
+      if (i > 0)
+        gtk_constraint_expression_builder_plus (&builder);
+      gtk_constraint_expression_builder_term (&builder, vars[i]);
+    }
+  expr = gtk_constraint_expression_builder_finish (&builder);
+  gtk_constraint_solver_add_constraint (solver,
+                                        total, GTK_CONSTRAINT_RELATION_EQ, expr,
+                                        GTK_CONSTRAINT_STRENGTH_REQUIRED);
+
+  first = NULL;
+  for (i = 0; i < N_TERMS; i++)
+    {
+      GtkConstraintRef *ref;
+
+      ref = gtk_constraint_solver_add_constraint (solver,
+                                                  vars[i], GTK_CONSTRAINT_RELATION_EQ,
+                                                  gtk_constraint_expression_new (i),
+                                                  GTK_CONSTRAINT_STRENGTH_REQUIRED);
+      if (i == 0)
+        first = ref;
+    }
+
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (total),
+                                  N_TERMS * (N_TERMS - 1) / 2, 0.001);
+
+  g_test_message ("Check values after replacing a term");
+
+  gtk_constraint_solver_remove_constraint (solver, first);
+  gtk_constraint_solver_add_constraint (solver,
+                                        vars[0], GTK_CONSTRAINT_RELATION_EQ,
+                                        gtk_constraint_expression_new (100.0),
+                                        GTK_CONSTRAINT_STRENGTH_REQUIRED);
+
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (vars[0]), 100.0, 0.001);
+  g_assert_cmpfloat_with_epsilon (gtk_constraint_variable_get_value (total),
+                                  N_TERMS * (N_TERMS - 1) / 2 + 100, 0.001);
+
+  for (i = 0; i < N_TERMS; i++)
+    gtk_constraint_variable_unref (vars[i]);
+  gtk_constraint_variable_unref (total);
+
+  g_object_unref (solver);
+}
+
 static void
 constraint_solver_paper (void)
 {
@@ -375,6 +459,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/constraint-solver/cassowary", constraint_solver_cassowary);
   g_test_add_func ("/constraint-solver/edit/required", constraint_solver_edit_var_required);
   g_test_add_func ("/constraint-solver/edit/suggest", constraint_solver_edit_var_suggest);
+  g_test_add_func ("/constraint-solver/expression/many-terms", constraint_solver_many_terms);
 
   return g_test_run ();
 }
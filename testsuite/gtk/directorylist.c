@@ -0,0 +1,311 @@
+/* GtkDirectoryList tests
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+#include <glib/gstdio.h>
+
+#include <gtk/gtk.h>
+
+typedef struct {
+  guint n_changes;
+  guint first_added;
+  guint n_items;
+} Changes;
+
+static void
+items_changed (GListModel *model,
+               guint       position,
+               guint       removed,
+               guint       added,
+               Changes    *changes)
+{
+  g_assert (removed != 0 || added != 0);
+  g_assert_cmpuint (position + removed, <=, changes->n_items);
+
+  if (changes->n_changes == 0)
+    changes->first_added = added;
+
+  changes->n_changes++;
+  changes->n_items = changes->n_items - removed + added;
+
+  g_assert_cmpuint (changes->n_items, ==, g_list_model_get_n_items (model));
+}
+
+/* Prefer tmpfs, so the test measures us and not the disk */
+static char *
+create_directory (guint n_files)
+{
+  GError *error = NULL;
+  char *dir;
+  guint i;
+
+  if (g_file_test ("/dev/shm", G_FILE_TEST_IS_DIR))
+    {
+      dir = g_build_filename ("/dev/shm", "gtk-directorylist-XXXXXX", NULL);
+      if (g_mkdtemp (dir) == NULL)
+        g_clear_pointer (&dir, g_free);
+    }
+  else
+    dir = NULL;
+
+  if (dir == NULL)
+    {
+      dir = g_dir_make_tmp ("gtk-directorylist-XXXXXX", &error);
+      g_assert_no_error (error);
+    }
+
+  for (i = 0; i < n_files; i++)
+    {
+      char *name = g_strdup_printf ("%s/file-%06u", dir, i);
+      g_file_set_contents (name, "", 0, &error);
+      g_assert_no_error (error);
+      g_free (name);
+    }
+
+  return dir;
+}
+
+static void
+remove_directory (const char *dir)
+{
+  GDir *d;
+  const char *name;
+
+  d = g_dir_open (dir, 0, NULL);
+  g_assert_nonnull (d);
+  while ((name = g_dir_read_name (d)))
+    {
+      char *path = g_build_filename (dir, name, NULL);
+      g_remove (path);
+      g_free (path);
+    }
+  g_dir_close (d);
+  g_rmdir (dir);
+}
+
+static GtkDirectoryList *
+new_model (Changes *changes)
+{
+  GtkDirectoryList *list;
+
+  list = g_object_new (GTK_TYPE_DIRECTORY_LIST,
+                       "attributes", G_FILE_ATTRIBUTE_STANDARD_NAME,
+                       "monitored", FALSE,
+                       NULL);
+  g_signal_connect (list, "items-changed", G_CALLBACK (items_changed), changes);
+
+  return list;
+}
+
+static void
+wait_for_loading (GtkDirectoryList *list)
+{
+  while (gtk_directory_list_is_loading (list))
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static gboolean
+timeout_cb (gpointer data)
+{
+  gboolean *timed_out = data;
+
+  *timed_out = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+wait_for_n_items (GListModel *model,
+                  guint       n_items)
+{
+  gboolean timed_out = FALSE;
+  guint id;
+
+  id = g_timeout_add_seconds (10, timeout_cb, &timed_out);
+  while (g_list_model_get_n_items (model) != n_items && !timed_out)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_false (timed_out);
+  g_source_remove (id);
+}
+
+static void
+test_bulk_load (void)
+{
+  const guint n_files = 200000;
+  GtkDirectoryList *list;
+  Changes changes = { 0, };
+  GFile *file;
+  char *dir;
+
+  dir = create_directory (n_files);
+
+  list = new_model (&changes);
+  gtk_directory_list_set_batch_size (list, 5000);
+  gtk_directory_list_set_initial_items (list, 50000);
+  g_assert_cmpuint (gtk_directory_list_get_batch_size (list), ==, 5000);
+  g_assert_cmpuint (gtk_directory_list_get_initial_items (list), ==, 50000);
+
+  file = g_file_new_for_path (dir);
+  gtk_directory_list_set_file (list, file);
+  g_object_unref (file);
+
+  /* Nothing is announced before enough files are there */
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (list)), ==, 0);
+
+  wait_for_loading (list);
+
+  g_assert_null (gtk_directory_list_get_error (list));
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (list)), ==, n_files);
+  g_assert_cmpuint (changes.first_added, >=, 50000);
+  g_assert_cmpuint (changes.n_changes, <=, 1 + (n_files - 50000) / 5000 + 1);
+
+  g_object_unref (list);
+  remove_directory (dir);
+  g_free (dir);
+}
+
+static void
+test_initial_timeout (void)
+{
+  const guint n_files = 1000;
+  GtkDirectoryList *list;
+  Changes changes = { 0, };
+  GFile *file;
+  char *dir;
+
+  dir = create_directory (n_files);
+
+  list = new_model (&changes);
+  gtk_directory_list_set_batch_size (list, 10);
+  gtk_directory_list_set_initial_timeout (list, 60 * 1000);
+  g_assert_cmpuint (gtk_directory_list_get_initial_timeout (list), ==, 60 * 1000);
+
+  file = g_file_new_for_path (dir);
+  gtk_directory_list_set_file (list, file);
+  g_object_unref (file);
+
+  wait_for_loading (list);
+
+  /* Loading finished before the timeout, so everything is announced at once */
+  g_assert_cmpuint (changes.n_changes, ==, 1);
+  g_assert_cmpuint (changes.first_added, ==, n_files);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (list)), ==, n_files);
+
+  g_object_unref (list);
+  remove_directory (dir);
+  g_free (dir);
+}
+
+static void
+test_no_deferral (void)
+{
+  const guint n_files = 1000;
+  GtkDirectoryList *list;
+  Changes changes = { 0, };
+  GFile *file;
+  char *dir;
+
+  dir = create_directory (n_files);
+
+  list = new_model (&changes);
+  gtk_directory_list_set_batch_size (list, 100);
+
+  file = g_file_new_for_path (dir);
+  gtk_directory_list_set_file (list, file);
+  g_object_unref (file);
+
+  wait_for_loading (list);
+
+  /* The enumerator may hand out fewer files than requested, so only
+   * check that files arrive in batches and not one by one. */
+  g_assert_cmpuint (changes.n_changes, >, 0);
+  g_assert_cmpuint (changes.n_changes, <, n_files / 10);
+  g_assert_cmpuint (changes.first_added, >, 0);
+  g_assert_cmpuint (changes.first_added, <=, 100);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (list)), ==, n_files);
+
+  g_object_unref (list);
+  remove_directory (dir);
+  g_free (dir);
+}
+
+static void
+test_monitor_batching (void)
+{
+  const guint n_files = 100;
+  GtkDirectoryList *list;
+  Changes changes = { 0, };
+  GError *error = NULL;
+  GFile *file;
+  char *dir;
+  guint i;
+
+  dir = create_directory (n_files);
+
+  list = new_model (&changes);
+  file = g_file_new_for_path (dir);
+  gtk_directory_list_set_file (list, file);
+  g_object_unref (file);
+  gtk_directory_list_set_monitored (list, TRUE);
+
+  wait_for_loading (list);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (list)), ==, n_files);
+
+  changes.n_changes = 0;
+  for (i = 0; i < 500; i++)
+    {
+      char *name = g_strdup_printf ("%s/new-%06u", dir, i);
+      g_file_set_contents (name, "", 0, &error);
+      g_assert_no_error (error);
+      g_free (name);
+    }
+
+  wait_for_n_items (G_LIST_MODEL (list), n_files + 500);
+
+  /* The creations were batched, not announced one by one */
+  g_assert_cmpuint (changes.n_changes, <, 50);
+
+  changes.n_changes = 0;
+  for (i = 0; i < 500; i++)
+    {
+      char *name = g_strdup_printf ("%s/new-%06u", dir, i);
+      g_remove (name);
+      g_free (name);
+    }
+
+  wait_for_n_items (G_LIST_MODEL (list), n_files);
+
+  g_assert_cmpuint (changes.n_changes, <, 500);
+
+  g_object_unref (list);
+  remove_directory (dir);
+  g_free (dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  g_test_add_func ("/directorylist/bulk-load", test_bulk_load);
+  g_test_add_func ("/directorylist/initial-timeout", test_initial_timeout);
+  g_test_add_func ("/directorylist/no-deferral", test_no_deferral);
+  g_test_add_func ("/directorylist/monitor-batching", test_monitor_batching);
+
+  return g_test_run ();
+}
@@ -48,12 +48,173 @@ test_measure_crash (void)
   gtk_window_destroy (GTK_WINDOW (window));
 }
 
+static GtkWidget *
+create_label (gpointer item,
+              gpointer user_data)
+{
+  return gtk_label_new (gtk_string_object_get_string (item));
+}
+
+static GtkStringList *
+create_model (guint n_items)
+{
+  GtkStringList *model;
+  char *s;
+  guint i;
+
+  model = gtk_string_list_new (NULL);
+  for (i = 0; i < n_items; i++)
+    {
+      s = g_strdup_printf ("%u", i);
+      gtk_string_list_append (model, s);
+      g_free (s);
+    }
+
+  return model;
+}
+
+static gboolean
+has_child (GtkFlowBox *box,
+           int         index)
+{
+  GtkWidget *child;
+
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (box));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (gtk_flow_box_child_get_index (GTK_FLOW_BOX_CHILD (child)) == index)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Vertical flow boxes lay out their lines along the horizontal
+ * adjustment, which runs backwards in right-to-left layouts.
+ */
+static void
+test_virtualized (void)
+{
+  GtkFlowBox *box;
+  GtkFlowBoxChild *child;
+  GtkStringList *model;
+  GtkAdjustment *adjustment;
+  GtkWidget *child_widget;
+  guint n_children;
+
+  model = create_model (10000);
+
+  box = GTK_FLOW_BOX (gtk_flow_box_new ());
+  g_object_ref_sink (box);
+  gtk_orientable_set_orientation (GTK_ORIENTABLE (box), GTK_ORIENTATION_VERTICAL);
+  gtk_widget_set_direction (GTK_WIDGET (box), GTK_TEXT_DIR_RTL);
+  adjustment = gtk_adjustment_new (0, 0, 0, 0, 0, 0);
+  gtk_flow_box_set_hadjustment (box, adjustment);
+
+  gtk_flow_box_set_virtualized (box, TRUE);
+  g_assert_true (gtk_flow_box_get_virtualized (box));
+  gtk_flow_box_bind_model (box, G_LIST_MODEL (model), create_label, NULL, NULL);
+
+  /* Only children near the start exist */
+  n_children = 0;
+  for (child_widget = gtk_widget_get_first_child (GTK_WIDGET (box));
+       child_widget != NULL;
+       child_widget = gtk_widget_get_next_sibling (child_widget))
+    n_children++;
+  g_assert_cmpuint (n_children, >, 0);
+  g_assert_cmpuint (n_children, <, 100);
+
+  /* Children are created on demand and follow items added before them */
+  child = gtk_flow_box_get_child_at_index (box, 5000);
+  g_assert_nonnull (child);
+  g_assert_cmpstr (gtk_label_get_label (GTK_LABEL (gtk_flow_box_child_get_child (child))), ==, "5000");
+  gtk_flow_box_select_child (box, child);
+  gtk_string_list_splice (model, 0, 0, (const char *[]) { "a", "b", NULL });
+  g_assert_cmpint (gtk_flow_box_child_get_index (child), ==, 5002);
+  g_assert_true (gtk_flow_box_get_child_at_index (box, 5002) == child);
+  g_assert_null (gtk_flow_box_get_child_at_index (box, 10002));
+
+  /* The end of the lines is at the start of the inverted adjustment,
+   * and the selected child is kept wherever it is scrolled to
+   */
+  gtk_adjustment_configure (adjustment, 1000000 - 100, 0, 1000000, 10, 100, 100);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_child (box, 0));
+  gtk_adjustment_set_value (adjustment, 0);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_child (box, 10001));
+  g_assert_true (has_child (box, 5002));
+  g_assert_false (has_child (box, 0));
+
+  g_object_unref (box);
+  g_object_unref (model);
+}
+
+static int
+move_cursor (GtkFlowBox      *box,
+             GtkMovementStep  step,
+             int              count)
+{
+  GList *selected;
+  gboolean handled;
+  int index;
+
+  g_signal_emit_by_name (box, "move-cursor", step, count, FALSE, FALSE, &handled);
+  g_assert_true (handled);
+
+  selected = gtk_flow_box_get_selected_children (box);
+  g_assert_cmpuint (g_list_length (selected), ==, 1);
+  index = gtk_flow_box_child_get_index (selected->data);
+  g_list_free (selected);
+
+  return index;
+}
+
+static void
+test_virtualized_keynav (void)
+{
+  GtkWidget *window, *sw;
+  GtkFlowBox *box;
+  GtkStringList *model;
+
+  model = create_model (10000);
+
+  window = gtk_window_new ();
+  sw = gtk_scrolled_window_new ();
+  gtk_window_set_child (GTK_WINDOW (window), sw);
+  box = GTK_FLOW_BOX (gtk_flow_box_new ());
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), GTK_WIDGET (box));
+
+  gtk_flow_box_set_virtualized (box, TRUE);
+  gtk_flow_box_set_selection_mode (box, GTK_SELECTION_SINGLE);
+  gtk_flow_box_bind_model (box, G_LIST_MODEL (model), create_label, NULL, NULL);
+  g_assert_false (has_child (box, 9999));
+
+  /* Moving the cursor creates the children it moves to */
+  g_assert_cmpint (move_cursor (box, GTK_MOVEMENT_BUFFER_ENDS, 1), ==, 9999);
+  g_assert_cmpint (move_cursor (box, GTK_MOVEMENT_VISUAL_POSITIONS, -1), ==, 9998);
+  g_assert_cmpint (move_cursor (box, GTK_MOVEMENT_BUFFER_ENDS, -1), ==, 0);
+  g_assert_cmpint (move_cursor (box, GTK_MOVEMENT_VISUAL_POSITIONS, 1), ==, 1);
+
+  /* The cursor child survives being scrolled out of view */
+  g_assert_cmpint (move_cursor (box, GTK_MOVEMENT_BUFFER_ENDS, 1), ==, 9999);
+  gtk_adjustment_set_value (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sw)), 0);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_child (box, 9999));
+
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_object_unref (model);
+}
+
 int
 main (int argc, char *argv[])
 {
   gtk_test_init (&argc, &argv);
 
   g_test_add_func ("/flowbox/measure-crash", test_measure_crash);
+  g_test_add_func ("/flowbox/virtualized", test_virtualized);
+  g_test_add_func ("/flowbox/virtualized-keynav", test_virtualized_keynav);
 
   return g_test_run ();
 }
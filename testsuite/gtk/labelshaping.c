@@ -0,0 +1,155 @@
+#include <gtk/gtk.h>
+
+/* Checks that labels in a list view get their layouts shaped by
+ * worker threads, and that those layouts measure the same as the
+ * ones labels create themselves.
+ */
+
+#define N_ITEMS 300
+
+static const char *words[] = {
+  "Grüße", "Size", "مرحبا", "日本語のテキスト", "Ελληνικά", "fi ffl",
+  "Lorem ipsum dolor sit amet", "שלום", "AVAWAY", "1234567890"
+};
+
+static void
+setup_item (GtkSignalListItemFactory *factory,
+            GtkListItem              *item)
+{
+  gtk_list_item_set_child (item, gtk_label_new (NULL));
+}
+
+static void
+bind_item (GtkSignalListItemFactory *factory,
+           GtkListItem              *item)
+{
+  GtkStringObject *string = gtk_list_item_get_item (item);
+
+  gtk_label_set_label (GTK_LABEL (gtk_list_item_get_child (item)),
+                       gtk_string_object_get_string (string));
+}
+
+static GtkWidget *
+create_list (void)
+{
+  GtkStringList *strings;
+  GtkListItemFactory *factory;
+  guint i;
+
+  strings = gtk_string_list_new (NULL);
+  for (i = 0; i < N_ITEMS; i++)
+    {
+      char *text = g_strdup_printf ("%u %s %s", i,
+                                    words[i % G_N_ELEMENTS (words)],
+                                    words[(i / 3) % G_N_ELEMENTS (words)]);
+      gtk_string_list_append (strings, text);
+      g_free (text);
+    }
+
+  factory = gtk_signal_list_item_factory_new ();
+  g_signal_connect (factory, "setup", G_CALLBACK (setup_item), NULL);
+  g_signal_connect (factory, "bind", G_CALLBACK (bind_item), NULL);
+
+  return gtk_list_view_new (GTK_SELECTION_MODEL (gtk_no_selection_new (G_LIST_MODEL (strings))),
+                            factory);
+}
+
+static GtkWidget *
+get_label (GtkWidget *row)
+{
+  GtkWidget *label = gtk_widget_get_first_child (row);
+
+  g_assert_true (GTK_IS_LABEL (label));
+
+  return label;
+}
+
+static void
+test_prepared_sizes (void)
+{
+  GtkWidget *window, *list, *row;
+  guint n_prepared = 0;
+
+  window = gtk_window_new ();
+  list = create_list ();
+  gtk_window_set_child (GTK_WINDOW (window), list);
+
+  gtk_widget_measure (list, GTK_ORIENTATION_HORIZONTAL, -1, NULL, NULL, NULL, NULL);
+
+  for (row = gtk_widget_get_first_child (list);
+       row != NULL;
+       row = gtk_widget_get_next_sibling (row))
+    {
+      GtkWidget *label, *reference;
+      PangoLayout *layout;
+      int min, nat, ref_min, ref_nat;
+      int min_baseline, ref_min_baseline;
+
+      if (!gtk_widget_get_visible (row))
+        continue;
+
+      label = get_label (row);
+      layout = gtk_label_get_layout (GTK_LABEL (label));
+      if (pango_layout_get_context (layout) != gtk_widget_get_pango_context (label))
+        n_prepared++;
+
+      /* A label in the same place that shapes by itself */
+      reference = gtk_label_new (gtk_label_get_label (GTK_LABEL (label)));
+      gtk_widget_insert_after (reference, row, label);
+
+      gtk_widget_measure (label, GTK_ORIENTATION_HORIZONTAL, -1, &min, &nat, NULL, NULL);
+      gtk_widget_measure (reference, GTK_ORIENTATION_HORIZONTAL, -1, &ref_min, &ref_nat, NULL, NULL);
+      g_assert_cmpint (min, ==, ref_min);
+      g_assert_cmpint (nat, ==, ref_nat);
+
+      gtk_widget_measure (label, GTK_ORIENTATION_VERTICAL, -1, &min, &nat, &min_baseline, NULL);
+      gtk_widget_measure (reference, GTK_ORIENTATION_VERTICAL, -1, &ref_min, &ref_nat, &ref_min_baseline, NULL);
+      g_assert_cmpint (min, ==, ref_min);
+      g_assert_cmpint (nat, ==, ref_nat);
+      g_assert_cmpint (min_baseline, ==, ref_min_baseline);
+
+      gtk_widget_unparent (reference);
+    }
+
+  g_assert_cmpuint (n_prepared, >, 0);
+
+  gtk_window_destroy (GTK_WINDOW (window));
+}
+
+static void
+test_prepared_context_changes (void)
+{
+  GtkWidget *window, *list, *label;
+  PangoLayout *layout;
+
+  window = gtk_window_new ();
+  list = create_list ();
+  gtk_window_set_child (GTK_WINDOW (window), list);
+
+  gtk_widget_measure (list, GTK_ORIENTATION_HORIZONTAL, -1, NULL, NULL, NULL, NULL);
+
+  label = get_label (gtk_widget_get_first_child (list));
+  layout = gtk_label_get_layout (GTK_LABEL (label));
+  g_assert_true (pango_layout_get_context (layout) != gtk_widget_get_pango_context (label));
+
+  /* The prepared layout can't see this, so the label must replace it */
+  gtk_widget_set_direction (label, GTK_TEXT_DIR_RTL);
+
+  layout = gtk_label_get_layout (GTK_LABEL (label));
+  g_assert_true (pango_layout_get_context (layout) == gtk_widget_get_pango_context (label));
+
+  gtk_window_destroy (GTK_WINDOW (window));
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_setenv ("GTK_SHAPING_THREADS", "4", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/label/shaping/prepared-sizes", test_prepared_sizes);
+  g_test_add_func ("/label/shaping/context-changes", test_prepared_context_changes);
+
+  return g_test_run ();
+}
@@ -440,6 +440,302 @@ test_header (void)
   g_object_unref (list);
 }
 
+static GtkWidget *
+create_label (gpointer item,
+              gpointer user_data)
+{
+  return gtk_label_new (gtk_string_object_get_string (item));
+}
+
+static GtkStringList *
+create_model (guint n_items)
+{
+  GtkStringList *model;
+  char *s;
+  guint i;
+
+  model = gtk_string_list_new (NULL);
+  for (i = 0; i < n_items; i++)
+    {
+      s = g_strdup_printf ("%u", i);
+      gtk_string_list_append (model, s);
+      g_free (s);
+    }
+
+  return model;
+}
+
+static const char *
+row_get_label (GtkListBoxRow *row)
+{
+  return gtk_label_get_label (GTK_LABEL (gtk_list_box_row_get_child (row)));
+}
+
+static guint
+count_rows (GtkListBox *list)
+{
+  GtkWidget *row;
+  guint count;
+
+  count = 0;
+  for (row = gtk_widget_get_first_child (GTK_WIDGET (list));
+       row != NULL;
+       row = gtk_widget_get_next_sibling (row))
+    {
+      if (GTK_IS_LIST_BOX_ROW (row))
+        count++;
+    }
+
+  return count;
+}
+
+static gboolean
+has_row (GtkListBox *list,
+         int         index)
+{
+  GtkWidget *row;
+
+  for (row = gtk_widget_get_first_child (GTK_WIDGET (list));
+       row != NULL;
+       row = gtk_widget_get_next_sibling (row))
+    {
+      if (GTK_IS_LIST_BOX_ROW (row) &&
+          gtk_list_box_row_get_index (GTK_LIST_BOX_ROW (row)) == index)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+test_virtualized (void)
+{
+  GtkWidget *sw;
+  GtkListBox *list;
+  GtkListBoxRow *row;
+  GtkStringList *model;
+  GtkAdjustment *adjustment;
+  GtkWidget *label;
+  guint n_rows;
+
+  model = create_model (10000);
+
+  sw = gtk_scrolled_window_new ();
+  g_object_ref_sink (sw);
+  list = GTK_LIST_BOX (gtk_list_box_new ());
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), GTK_WIDGET (list));
+
+  gtk_list_box_set_virtualized (list, TRUE);
+  g_assert_true (gtk_list_box_get_virtualized (list));
+  gtk_list_box_bind_model (list, G_LIST_MODEL (model), create_label, NULL, NULL);
+
+  /* Only rows near the top exist */
+  g_assert_cmpuint (count_rows (list), >, 0);
+  g_assert_cmpuint (count_rows (list), <, 100);
+
+  /* Rows are created on demand and know their position in the model */
+  row = gtk_list_box_get_row_at_index (list, 5000);
+  g_assert_nonnull (row);
+  g_assert_cmpint (gtk_list_box_row_get_index (row), ==, 5000);
+  label = gtk_list_box_row_get_child (row);
+  g_assert_cmpstr (gtk_label_get_label (GTK_LABEL (label)), ==, "5000");
+  g_assert_null (gtk_list_box_get_row_at_index (list, 10000));
+
+  /* Selected rows are kept, and follow changes to the model */
+  gtk_list_box_select_row (list, row);
+  gtk_string_list_splice (model, 0, 10, NULL);
+  g_assert_true (gtk_list_box_get_selected_row (list) == row);
+  g_assert_cmpint (gtk_list_box_row_get_index (row), ==, 4990);
+  g_assert_true (gtk_list_box_get_row_at_index (list, 4990) == row);
+
+  /* Scrolling doesn't create rows right away, but before the next layout */
+  adjustment = gtk_list_box_get_adjustment (list);
+  g_assert_nonnull (adjustment);
+  gtk_adjustment_configure (adjustment, 0, 0, 1000000, 10, 100, 100);
+  n_rows = count_rows (list);
+  g_assert_false (has_row (list, 9989));
+  gtk_adjustment_set_value (adjustment, 1000000 - 100);
+  g_assert_cmpuint (count_rows (list), ==, n_rows);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_row (list, 9989));
+  g_assert_true (has_row (list, 4990));
+  g_assert_false (has_row (list, 0));
+
+  /* Turning virtualization off creates all rows */
+  gtk_list_box_set_virtualized (list, FALSE);
+  g_assert_cmpuint (count_rows (list), ==, 9990);
+
+  g_object_unref (sw);
+  g_object_unref (model);
+}
+
+static void
+virtual_header_func (GtkListBoxRow *row,
+                     GtkListBoxRow *before,
+                     gpointer       data)
+{
+  char *s;
+
+  if (before)
+    s = g_strdup_printf ("After %s", row_get_label (before));
+  else
+    s = g_strdup ("First");
+
+  gtk_list_box_row_set_header (row, gtk_label_new (s));
+  g_free (s);
+}
+
+/* Checks the header of every row whose row before it exists,
+ * and that no headers are left behind for destroyed rows.
+ */
+static void
+check_virtual_headers (GtkListBox *list)
+{
+  GtkWidget *child;
+  GtkListBoxRow *row, *before;
+  GtkWidget *header;
+  guint n_headers, n_rows_with_header, n_checked;
+  char *s;
+
+  n_headers = n_rows_with_header = n_checked = 0;
+  before = NULL;
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (list));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (!GTK_IS_LIST_BOX_ROW (child))
+        {
+          n_headers++;
+          continue;
+        }
+
+      row = GTK_LIST_BOX_ROW (child);
+      header = gtk_list_box_row_get_header (row);
+      if (header)
+        n_rows_with_header++;
+
+      if (gtk_list_box_row_get_index (row) == 0)
+        {
+          g_assert_nonnull (header);
+          g_assert_cmpstr (gtk_label_get_label (GTK_LABEL (header)), ==, "First");
+          n_checked++;
+        }
+      else if (before && gtk_list_box_row_get_index (before) + 1 == gtk_list_box_row_get_index (row))
+        {
+          s = g_strdup_printf ("After %s", row_get_label (before));
+          g_assert_nonnull (header);
+          g_assert_cmpstr (gtk_label_get_label (GTK_LABEL (header)), ==, s);
+          g_free (s);
+          n_checked++;
+        }
+
+      before = row;
+    }
+
+  g_assert_cmpuint (n_checked, >, 0);
+  g_assert_cmpuint (n_headers, ==, n_rows_with_header);
+}
+
+static void
+test_virtualized_header (void)
+{
+  GtkWidget *sw;
+  GtkListBox *list;
+  GtkStringList *model;
+  GtkAdjustment *adjustment;
+
+  model = create_model (10000);
+
+  sw = gtk_scrolled_window_new ();
+  g_object_ref_sink (sw);
+  list = GTK_LIST_BOX (gtk_list_box_new ());
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), GTK_WIDGET (list));
+
+  gtk_list_box_set_virtualized (list, TRUE);
+  gtk_list_box_set_header_func (list, virtual_header_func, NULL, NULL);
+  gtk_list_box_bind_model (list, G_LIST_MODEL (model), create_label, NULL, NULL);
+  check_virtual_headers (list);
+
+  /* Rows created far away get headers once the rows before them exist */
+  gtk_list_box_get_row_at_index (list, 5000);
+  check_virtual_headers (list);
+
+  adjustment = gtk_list_box_get_adjustment (list);
+  gtk_adjustment_configure (adjustment, 0, 0, 1000000, 10, 100, 100);
+  gtk_adjustment_set_value (adjustment, 1000000 - 100);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_row (list, 9999));
+  check_virtual_headers (list);
+
+  /* The new first row loses the header that pointed at a removed row */
+  gtk_adjustment_set_value (adjustment, 0);
+  while (g_main_context_iteration (NULL, FALSE));
+  gtk_string_list_splice (model, 0, 10, NULL);
+  g_assert_cmpstr (row_get_label (gtk_list_box_get_row_at_index (list, 0)), ==, "10");
+  check_virtual_headers (list);
+
+  g_object_unref (sw);
+  g_object_unref (model);
+}
+
+static int
+move_cursor (GtkListBox      *list,
+             GtkMovementStep  step,
+             int              count)
+{
+  GtkListBoxRow *row;
+
+  g_signal_emit_by_name (list, "move-cursor", step, count, FALSE, FALSE);
+
+  row = gtk_list_box_get_selected_row (list);
+  g_assert_nonnull (row);
+  g_assert_true (gtk_widget_get_parent (GTK_WIDGET (row)) == GTK_WIDGET (list));
+
+  return gtk_list_box_row_get_index (row);
+}
+
+static void
+test_virtualized_keynav (void)
+{
+  GtkWidget *window, *sw;
+  GtkListBox *list;
+  GtkStringList *model;
+  int index;
+
+  model = create_model (10000);
+
+  window = gtk_window_new ();
+  sw = gtk_scrolled_window_new ();
+  gtk_window_set_child (GTK_WINDOW (window), sw);
+  list = GTK_LIST_BOX (gtk_list_box_new ());
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), GTK_WIDGET (list));
+
+  gtk_list_box_set_virtualized (list, TRUE);
+  gtk_list_box_bind_model (list, G_LIST_MODEL (model), create_label, NULL, NULL);
+  g_assert_false (has_row (list, 9999));
+
+  /* Moving the cursor creates the rows it moves to */
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_BUFFER_ENDS, 1), ==, 9999);
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_DISPLAY_LINES, -1), ==, 9998);
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_BUFFER_ENDS, -1), ==, 0);
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_DISPLAY_LINES, 1), ==, 1);
+
+  /* Pages move by whole rows, even if they don't exist yet */
+  index = move_cursor (list, GTK_MOVEMENT_PAGES, 1);
+  g_assert_cmpint (index, >, 1);
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_PAGES, -1), <, index);
+
+  /* The cursor row survives being scrolled out of view */
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_BUFFER_ENDS, 1), ==, 9999);
+  gtk_adjustment_set_value (gtk_list_box_get_adjustment (list), 0);
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_true (has_row (list, 9999));
+  g_assert_cmpint (move_cursor (list, GTK_MOVEMENT_DISPLAY_LINES, -1), ==, 9998);
+
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_object_unref (model);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -450,6 +746,9 @@ main (int argc, char *argv[])
   g_test_add_func ("/listbox/multi-selection", test_multi_selection);
   g_test_add_func ("/listbox/filter", test_filter);
   g_test_add_func ("/listbox/header", test_header);
+  g_test_add_func ("/listbox/virtualized", test_virtualized);
+  g_test_add_func ("/listbox/virtualized-header", test_virtualized_header);
+  g_test_add_func ("/listbox/virtualized-keynav", test_virtualized_keynav);
 
   return g_test_run ();
 }
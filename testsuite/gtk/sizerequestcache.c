@@ -0,0 +1,232 @@
+#include <gtk/gtk.h>
+
+#include "../../gtk/gtksizerequestcacheprivate.h"
+
+#define N_SIZES 20
+
+/* Probes the cache like a flow box measuring a wrapping label at
+ * many widths, and returns the number of misses */
+static guint
+probe (SizeRequestCache *cache)
+{
+  guint misses = 0;
+  int i;
+
+  for (i = 0; i < N_SIZES; i++)
+    {
+      int for_size = 100 + 10 * i;
+      int min, nat, min_baseline, nat_baseline;
+
+      if (_gtk_size_request_cache_lookup (cache, GTK_ORIENTATION_VERTICAL, for_size,
+                                          &min, &nat, &min_baseline, &nat_baseline))
+        {
+          g_assert_cmpint (min, ==, 1000 / for_size);
+          g_assert_cmpint (nat, ==, 2000 / for_size);
+          continue;
+        }
+
+      misses++;
+      _gtk_size_request_cache_commit (cache, GTK_ORIENTATION_VERTICAL, for_size,
+                                      1000 / for_size, 2000 / for_size, -1, -1);
+    }
+
+  return misses;
+}
+
+static void
+test_grow (void)
+{
+  SizeRequestCache cache;
+  int round;
+
+  _gtk_size_request_cache_init (&cache);
+
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL), ==, GTK_SIZE_REQUEST_CACHED_SIZES);
+
+  for (round = 0; round < 3; round++)
+    probe (&cache);
+
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL), >=, N_SIZES);
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_HORIZONTAL), ==, GTK_SIZE_REQUEST_CACHED_SIZES);
+  g_assert_cmpuint (probe (&cache), ==, 0);
+
+  _gtk_size_request_cache_free (&cache);
+}
+
+static void
+test_few_sizes (void)
+{
+  SizeRequestCache cache;
+  int i, round;
+
+  _gtk_size_request_cache_init (&cache);
+
+  /* A widget that is only measured for a few sizes keeps a small cache */
+  for (round = 0; round < 10; round++)
+    {
+      for (i = 0; i < 3; i++)
+        {
+          int min, nat, min_baseline, nat_baseline;
+
+          if (!_gtk_size_request_cache_lookup (&cache, GTK_ORIENTATION_VERTICAL, 100 * i,
+                                               &min, &nat, &min_baseline, &nat_baseline))
+            _gtk_size_request_cache_commit (&cache, GTK_ORIENTATION_VERTICAL, 100 * i,
+                                            i, i, -1, -1);
+        }
+    }
+
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL), ==, GTK_SIZE_REQUEST_CACHED_SIZES);
+
+  _gtk_size_request_cache_free (&cache);
+}
+
+static void
+test_clear (void)
+{
+  SizeRequestCache cache;
+  guint n_slots;
+  int round;
+
+  _gtk_size_request_cache_init (&cache);
+
+  for (round = 0; round < 3; round++)
+    probe (&cache);
+
+  n_slots = _gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL);
+
+  /* The cache keeps its size while the widget keeps being probed */
+  _gtk_size_request_cache_clear (&cache);
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL), ==, n_slots);
+  g_assert_cmpuint (probe (&cache), ==, N_SIZES);
+  g_assert_cmpuint (probe (&cache), ==, 0);
+
+  /* and shrinks when it isn't */
+  _gtk_size_request_cache_clear (&cache);
+  _gtk_size_request_cache_clear (&cache);
+  g_assert_cmpuint (_gtk_size_request_cache_get_n_slots (&cache, GTK_ORIENTATION_VERTICAL), <, n_slots);
+
+  _gtk_size_request_cache_free (&cache);
+}
+
+/* A font map that counts how often it is asked for fonts, so we
+ * can tell if a label measured its text or found it in the shared
+ * cache. It derives from whatever font map pango uses here.
+ */
+static PangoFontset *
+counting_font_map_load_fontset (PangoFontMap               *font_map,
+                                PangoContext               *context,
+                                const PangoFontDescription *desc,
+                                PangoLanguage              *language)
+{
+  PangoFontMapClass *parent_class;
+  guint n_loads;
+
+  n_loads = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (font_map), "n-loads"));
+  g_object_set_data (G_OBJECT (font_map), "n-loads", GUINT_TO_POINTER (n_loads + 1));
+
+  parent_class = g_type_class_peek (g_type_parent (G_OBJECT_TYPE (font_map)));
+
+  return parent_class->load_fontset (font_map, context, desc, language);
+}
+
+static void
+counting_font_map_class_init (gpointer g_class,
+                              gpointer class_data)
+{
+  PANGO_FONT_MAP_CLASS (g_class)->load_fontset = counting_font_map_load_fontset;
+}
+
+static PangoFontMap *
+counting_font_map_new (void)
+{
+  static GType type = 0;
+
+  if (type == 0)
+    {
+      GType parent = G_OBJECT_TYPE (pango_cairo_font_map_get_default ());
+      GTypeQuery query;
+      GTypeInfo info = { 0, };
+
+      g_type_query (parent, &query);
+      info.class_size = query.class_size;
+      info.class_init = counting_font_map_class_init;
+      info.instance_size = query.instance_size;
+
+      type = g_type_register_static (parent, "CountingFontMap", &info, 0);
+    }
+
+  return g_object_new (type, NULL);
+}
+
+static guint
+get_n_loads (PangoFontMap *font_map)
+{
+  return GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (font_map), "n-loads"));
+}
+
+static void
+measure_label (GtkWidget *label,
+               int       *width)
+{
+  gtk_widget_measure (label, GTK_ORIENTATION_HORIZONTAL, -1, width, NULL, NULL, NULL);
+}
+
+static void
+test_shared_labels (void)
+{
+  PangoFontMap *font_map, *other_font_map;
+  GtkWidget *box, *first, *second, *third;
+  int width, second_width;
+  guint n_loads;
+
+  font_map = counting_font_map_new ();
+  other_font_map = counting_font_map_new ();
+
+  /* The labels are in the middle of a box, so they share their style */
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  g_object_ref_sink (box);
+  gtk_widget_set_font_map (box, font_map);
+  gtk_box_append (GTK_BOX (box), gtk_label_new (NULL));
+  first = gtk_label_new ("Shared measurements");
+  gtk_box_append (GTK_BOX (box), first);
+  second = gtk_label_new ("Shared measurements");
+  gtk_box_append (GTK_BOX (box), second);
+  third = gtk_label_new ("Shared measurements");
+  gtk_box_append (GTK_BOX (box), third);
+  gtk_box_append (GTK_BOX (box), gtk_label_new (NULL));
+
+  measure_label (first, &width);
+  n_loads = get_n_loads (font_map);
+  g_assert_cmpuint (n_loads, >, 0);
+
+  /* The same text, style and fonts are not measured again */
+  measure_label (second, &second_width);
+  g_assert_cmpint (second_width, ==, width);
+  g_assert_cmpuint (get_n_loads (font_map), ==, n_loads);
+
+  /* but a different font map is */
+  gtk_widget_set_font_map (third, other_font_map);
+  measure_label (third, &width);
+  g_assert_cmpuint (get_n_loads (font_map), ==, n_loads);
+  g_assert_cmpuint (get_n_loads (other_font_map), >, 0);
+
+  g_object_unref (box);
+  g_object_unref (font_map);
+  g_object_unref (other_font_map);
+}
+
+int
+main (int argc, char *argv[])
+{
+  /* Read once, by the first label that is measured */
+  g_setenv ("GTK_SHARED_SIZE_CACHE", "1", TRUE);
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/size-request-cache/grow", test_grow);
+  g_test_add_func ("/size-request-cache/few-sizes", test_few_sizes);
+  g_test_add_func ("/size-request-cache/clear", test_clear);
+  g_test_add_func ("/size-request-cache/shared-labels", test_shared_labels);
+
+  return g_test_run ();
+}
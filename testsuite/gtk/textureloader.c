@@ -0,0 +1,249 @@
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* Checks that pictures and images load files in the background when
+ * asked to, and share the textures of files that were loaded recently.
+ */
+
+static void
+write_image_file (const char *filename,
+                  int         width,
+                  int         height)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+  guchar *data;
+
+  data = g_malloc (width * height * 4);
+  memset (data, 0x80, width * height * 4);
+  bytes = g_bytes_new_take (data, width * height * 4);
+  texture = gdk_memory_texture_new (width, height,
+                                    GDK_MEMORY_DEFAULT,
+                                    bytes,
+                                    width * 4);
+
+  g_assert_true (gdk_texture_save_to_png (texture, filename));
+
+  g_object_unref (texture);
+  g_bytes_unref (bytes);
+}
+
+static char *
+create_image_file (int width,
+                   int height)
+{
+  char *filename;
+  int fd;
+
+  fd = g_file_open_tmp ("textureloader-XXXXXX.png", &filename, NULL);
+  g_assert_cmpint (fd, >=, 0);
+  g_close (fd, NULL);
+
+  write_image_file (filename, width, height);
+
+  return filename;
+}
+
+static void
+notify_cb (GObject    *object,
+           GParamSpec *pspec,
+           gpointer    data)
+{
+  gboolean *done = data;
+
+  *done = TRUE;
+}
+
+static void
+wait_for_notify (gpointer    object,
+                 const char *signal)
+{
+  gboolean done = FALSE;
+  gulong id;
+
+  id = g_signal_connect (object, signal, G_CALLBACK (notify_cb), &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_signal_handler_disconnect (object, id);
+}
+
+static void
+test_picture_async (void)
+{
+  GtkWidget *picture, *other;
+  GdkPaintable *paintable;
+  char *filename;
+
+  filename = create_image_file (37, 23);
+
+  picture = g_object_ref_sink (gtk_picture_new ());
+  gtk_picture_set_load_async (GTK_PICTURE (picture), TRUE);
+  gtk_picture_set_filename (GTK_PICTURE (picture), filename);
+
+  /* Nothing to show until the file is loaded */
+  g_assert_null (gtk_picture_get_paintable (GTK_PICTURE (picture)));
+
+  wait_for_notify (picture, "notify::paintable");
+
+  paintable = gtk_picture_get_paintable (GTK_PICTURE (picture));
+  g_assert_nonnull (paintable);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (paintable), ==, 37);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (paintable), ==, 23);
+  g_assert_nonnull (gtk_picture_get_file (GTK_PICTURE (picture)));
+
+  /* The second picture gets the cached texture right away */
+  other = g_object_ref_sink (gtk_picture_new ());
+  gtk_picture_set_load_async (GTK_PICTURE (other), TRUE);
+  gtk_picture_set_filename (GTK_PICTURE (other), filename);
+
+  paintable = gtk_picture_get_paintable (GTK_PICTURE (other));
+  g_assert_nonnull (paintable);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (paintable), ==, 37);
+
+  g_object_unref (other);
+  g_object_unref (picture);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_picture_async_changed (void)
+{
+  GtkWidget *picture, *other;
+  GdkPaintable *paintable;
+  GFile *file;
+  char *filename;
+
+  filename = create_image_file (41, 43);
+
+  picture = g_object_ref_sink (gtk_picture_new ());
+  gtk_picture_set_load_async (GTK_PICTURE (picture), TRUE);
+  gtk_picture_set_filename (GTK_PICTURE (picture), filename);
+  wait_for_notify (picture, "notify::paintable");
+
+  /* Make sure the modification time differs, even on file
+   * systems that only store it in seconds
+   */
+  write_image_file (filename, 47, 53);
+  file = g_file_new_for_path (filename);
+  g_assert_true (g_file_set_attribute_uint64 (file,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                              g_get_real_time () / G_USEC_PER_SEC + 10,
+                                              G_FILE_QUERY_INFO_NONE,
+                                              NULL, NULL));
+  g_object_unref (file);
+
+  /* The cached texture is outdated, so the file gets loaded again */
+  other = g_object_ref_sink (gtk_picture_new ());
+  gtk_picture_set_load_async (GTK_PICTURE (other), TRUE);
+  gtk_picture_set_filename (GTK_PICTURE (other), filename);
+  g_assert_null (gtk_picture_get_paintable (GTK_PICTURE (other)));
+
+  wait_for_notify (other, "notify::paintable");
+
+  paintable = gtk_picture_get_paintable (GTK_PICTURE (other));
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (paintable), ==, 47);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (paintable), ==, 53);
+
+  g_object_unref (other);
+  g_object_unref (picture);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_picture_async_cancel (void)
+{
+  GtkWidget *picture;
+  char *first, *second;
+  GdkPaintable *paintable;
+
+  first = create_image_file (11, 13);
+  second = create_image_file (17, 19);
+
+  picture = g_object_ref_sink (gtk_picture_new ());
+  gtk_picture_set_load_async (GTK_PICTURE (picture), TRUE);
+
+  /* Only the last file may show up */
+  gtk_picture_set_filename (GTK_PICTURE (picture), first);
+  gtk_picture_set_filename (GTK_PICTURE (picture), second);
+
+  wait_for_notify (picture, "notify::paintable");
+
+  paintable = gtk_picture_get_paintable (GTK_PICTURE (picture));
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (paintable), ==, 17);
+
+  /* Loads that are still running when the picture goes away are dropped */
+  gtk_picture_set_filename (GTK_PICTURE (picture), first);
+  g_object_unref (picture);
+
+  while (g_main_context_iteration (NULL, FALSE));
+
+  g_unlink (first);
+  g_unlink (second);
+  g_free (first);
+  g_free (second);
+}
+
+static void
+test_image_async (void)
+{
+  GtkWidget *image;
+  GdkPaintable *paintable;
+  char *filename;
+
+  filename = create_image_file (29, 31);
+
+  image = g_object_ref_sink (gtk_image_new ());
+  gtk_image_set_load_async (GTK_IMAGE (image), TRUE);
+  gtk_image_set_from_file (GTK_IMAGE (image), filename);
+
+  g_assert_cmpint (gtk_image_get_storage_type (GTK_IMAGE (image)), ==, GTK_IMAGE_ICON_NAME);
+  g_assert_cmpstr (gtk_image_get_icon_name (GTK_IMAGE (image)), ==, "image-loading");
+
+  wait_for_notify (image, "notify::paintable");
+
+  g_assert_cmpint (gtk_image_get_storage_type (GTK_IMAGE (image)), ==, GTK_IMAGE_PAINTABLE);
+  paintable = gtk_image_get_paintable (GTK_IMAGE (image));
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (paintable), ==, 29);
+
+  g_object_unref (image);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_image_async_missing (void)
+{
+  GtkWidget *image;
+
+  image = g_object_ref_sink (gtk_image_new ());
+  gtk_image_set_load_async (GTK_IMAGE (image), TRUE);
+  gtk_image_set_from_file (GTK_IMAGE (image), "/does/not/exist.png");
+
+  wait_for_notify (image, "notify::icon-name");
+
+  g_assert_cmpstr (gtk_image_get_icon_name (GTK_IMAGE (image)), ==, "image-missing");
+
+  g_object_unref (image);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/textureloader/picture", test_picture_async);
+  g_test_add_func ("/textureloader/picture-changed", test_picture_async_changed);
+  g_test_add_func ("/textureloader/picture-cancel", test_picture_async_cancel);
+  g_test_add_func ("/textureloader/image", test_image_async);
+  g_test_add_func ("/textureloader/image-missing", test_image_async_missing);
+
+  return g_test_run ();
+}
@@ -0,0 +1,141 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Sort and filter throughput of the list models */
+
+#include <gtk/gtk.h>
+
+#include "benchmark.h"
+
+#define N_ITEMS 100000
+
+typedef struct {
+  GtkStringList *strings;
+  GListModel *model;
+} ModelState;
+
+static GtkStringList *
+create_strings (void)
+{
+  GtkStringList *strings;
+  GRand *rand;
+  char **words;
+  guint i;
+
+  /* Use a fixed seed so every run sees the same data */
+  rand = g_rand_new_with_seed (42);
+  words = g_new (char *, N_ITEMS + 1);
+  for (i = 0; i < N_ITEMS; i++)
+    words[i] = g_strdup_printf ("item %u", g_rand_int (rand));
+  words[N_ITEMS] = NULL;
+
+  strings = gtk_string_list_new ((const char * const *) words);
+
+  g_strfreev (words);
+  g_rand_free (rand);
+
+  return strings;
+}
+
+static GtkExpression *
+create_string_expression (void)
+{
+  return gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string");
+}
+
+static gpointer
+sort_setup (gpointer data)
+{
+  ModelState *state = g_new0 (ModelState, 1);
+
+  state->strings = g_object_ref (data);
+
+  return state;
+}
+
+static void
+sort_run (gpointer data)
+{
+  ModelState *state = data;
+  GtkSortListModel *sort;
+
+  sort = gtk_sort_list_model_new (g_object_ref (G_LIST_MODEL (state->strings)),
+                                  GTK_SORTER (gtk_string_sorter_new (create_string_expression ())));
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sort)), ==, N_ITEMS);
+
+  state->model = G_LIST_MODEL (sort);
+}
+
+static void
+model_teardown (gpointer data)
+{
+  ModelState *state = data;
+
+  g_clear_object (&state->model);
+  g_object_unref (state->strings);
+  g_free (state);
+}
+
+static gpointer
+filter_setup (gpointer data)
+{
+  ModelState *state = g_new0 (ModelState, 1);
+  GtkFilter *filter;
+
+  state->strings = g_object_ref (data);
+  filter = GTK_FILTER (gtk_string_filter_new (create_string_expression ()));
+  state->model = G_LIST_MODEL (gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (state->strings)),
+                                                          filter));
+
+  return state;
+}
+
+static void
+filter_run (gpointer data)
+{
+  ModelState *state = data;
+  GtkStringFilter *filter;
+  const char *searches[] = { "1", "12", "123", "12", "1", "" };
+  guint i;
+
+  filter = GTK_STRING_FILTER (gtk_filter_list_model_get_filter (GTK_FILTER_LIST_MODEL (state->model)));
+
+  for (i = 0; i < G_N_ELEMENTS (searches); i++)
+    gtk_string_filter_set_search (filter, searches[i]);
+
+  g_assert_cmpuint (g_list_model_get_n_items (state->model), ==, N_ITEMS);
+}
+
+static const Benchmark benchmarks[] = {
+  {
+    .name = "sortlistmodel-sort",
+    .n_items = N_ITEMS,
+    .setup = sort_setup,
+    .run = sort_run,
+    .teardown = model_teardown,
+  },
+  {
+    .name = "filterlistmodel-search",
+    .n_items = N_ITEMS * 6,
+    .setup = filter_setup,
+    .run = filter_run,
+    .teardown = model_teardown,
+  },
+};
+
+int
+main (int argc, char *argv[])
+{
+  GtkStringList *strings;
+  guint i;
+
+  benchmark_init (&argc, &argv);
+
+  strings = create_strings ();
+
+  for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+    benchmark_run (&benchmarks[i], strings);
+
+  g_object_unref (strings);
+
+  return benchmark_finish ();
+}
@@ -0,0 +1,243 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Render node diffing and Cairo rendering */
+
+#include <gtk/gtk.h>
+
+#include "benchmark.h"
+
+#define N_ROWS 100
+#define N_COLUMNS 100
+#define SIZE 8
+#define N_DIFFS 100
+#define N_RENDERS 5
+
+typedef struct {
+  GskRenderNode *rows[N_ROWS];
+  GskRenderNode *changed_rows[N_ROWS];
+} Scene;
+
+static GskRenderNode *
+create_row (guint    row,
+            gboolean changed)
+{
+  GskRenderNode *children[N_COLUMNS];
+  GskRenderNode *node;
+  guint i;
+
+  for (i = 0; i < N_COLUMNS; i++)
+    {
+      GdkRGBA color = { (float) i / N_COLUMNS, (float) row / N_ROWS, changed ? 1.0 : 0.5, 1.0 };
+      graphene_rect_t bounds = GRAPHENE_RECT_INIT (i * SIZE, row * SIZE, SIZE, SIZE);
+
+      if ((i + row) % 3 == 0)
+        {
+          GskColorStop stops[2] = { { 0, color }, { 1, { 0, 0, 0, 1 } } };
+
+          children[i] = gsk_linear_gradient_node_new (&bounds,
+                                                      &bounds.origin,
+                                                      &GRAPHENE_POINT_INIT (bounds.origin.x + SIZE, bounds.origin.y + SIZE),
+                                                      stops, G_N_ELEMENTS (stops));
+        }
+      else
+        children[i] = gsk_color_node_new (&color, &bounds);
+    }
+
+  node = gsk_container_node_new (children, N_COLUMNS);
+
+  for (i = 0; i < N_COLUMNS; i++)
+    gsk_render_node_unref (children[i]);
+
+  return node;
+}
+
+static void
+scene_init (Scene *scene)
+{
+  guint i;
+
+  for (i = 0; i < N_ROWS; i++)
+    {
+      scene->rows[i] = create_row (i, FALSE);
+      scene->changed_rows[i] = create_row (i, TRUE);
+    }
+}
+
+static void
+scene_clear (Scene *scene)
+{
+  guint i;
+
+  for (i = 0; i < N_ROWS; i++)
+    {
+      gsk_render_node_unref (scene->rows[i]);
+      gsk_render_node_unref (scene->changed_rows[i]);
+    }
+}
+
+/* Returns the whole scene, with row @changed replaced, or no row
+ * replaced if @changed is out of range. All other rows are shared
+ * between the returned trees.
+ */
+static GskRenderNode *
+scene_get_root (Scene *scene,
+                guint  changed)
+{
+  GskRenderNode *rows[N_ROWS];
+  guint i;
+
+  for (i = 0; i < N_ROWS; i++)
+    rows[i] = i == changed ? scene->changed_rows[i] : scene->rows[i];
+
+  return gsk_container_node_new (rows, N_ROWS);
+}
+
+/* Diffing, measured through gsk_renderer_render() which diffs
+ * against the previous frame and redraws only the damage.
+ */
+
+typedef struct {
+  Scene *scene;
+  GtkWidget *window;
+  GskRenderer *renderer;
+} DiffState;
+
+static gpointer
+diff_setup (gpointer data)
+{
+  DiffState *state = g_new0 (DiffState, 1);
+  GError *error = NULL;
+  GskRenderNode *root;
+
+  state->scene = data;
+
+  state->window = gtk_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (state->window), N_COLUMNS * SIZE, N_ROWS * SIZE);
+  gtk_widget_show (state->window);
+  benchmark_wait_for_frame (state->window);
+
+  state->renderer = gsk_cairo_renderer_new ();
+  if (!gsk_renderer_realize (state->renderer,
+                             gtk_native_get_surface (GTK_NATIVE (state->window)),
+                             &error))
+    g_error ("Failed to realize renderer: %s", error->message);
+
+  /* The first frame has nothing to diff against */
+  root = scene_get_root (state->scene, N_ROWS);
+  gsk_renderer_render (state->renderer, root, NULL);
+  gsk_render_node_unref (root);
+
+  return state;
+}
+
+static void
+diff_run (gpointer data)
+{
+  DiffState *state = data;
+  guint i;
+
+  for (i = 0; i < N_DIFFS; i++)
+    {
+      GskRenderNode *root = scene_get_root (state->scene, i % N_ROWS);
+
+      gsk_renderer_render (state->renderer, root, NULL);
+      gsk_render_node_unref (root);
+    }
+}
+
+static void
+diff_teardown (gpointer data)
+{
+  DiffState *state = data;
+
+  gsk_renderer_unrealize (state->renderer);
+  g_object_unref (state->renderer);
+  gtk_window_destroy (GTK_WINDOW (state->window));
+  g_free (state);
+}
+
+/* Rendering the full scene to a texture */
+
+typedef struct {
+  Scene *scene;
+  GskRenderer *renderer;
+  GskRenderNode *root;
+} CairoState;
+
+static gpointer
+cairo_setup (gpointer data)
+{
+  CairoState *state = g_new0 (CairoState, 1);
+  GError *error = NULL;
+
+  state->scene = data;
+  state->root = scene_get_root (state->scene, N_ROWS);
+
+  state->renderer = gsk_cairo_renderer_new ();
+  if (!gsk_renderer_realize (state->renderer, NULL, &error))
+    g_error ("Failed to realize renderer: %s", error->message);
+
+  return state;
+}
+
+static void
+cairo_run (gpointer data)
+{
+  CairoState *state = data;
+  guint i;
+
+  for (i = 0; i < N_RENDERS; i++)
+    {
+      GdkTexture *texture;
+
+      texture = gsk_renderer_render_texture (state->renderer, state->root, NULL);
+      g_object_unref (texture);
+    }
+}
+
+static void
+cairo_teardown (gpointer data)
+{
+  CairoState *state = data;
+
+  gsk_renderer_unrealize (state->renderer);
+  g_object_unref (state->renderer);
+  gsk_render_node_unref (state->root);
+  g_free (state);
+}
+
+static const Benchmark benchmarks[] = {
+  {
+    .name = "rendernode-diff",
+    .n_items = N_DIFFS,
+    .needs_display = TRUE,
+    .setup = diff_setup,
+    .run = diff_run,
+    .teardown = diff_teardown,
+  },
+  {
+    .name = "cairo-render",
+    .n_items = N_RENDERS,
+    .setup = cairo_setup,
+    .run = cairo_run,
+    .teardown = cairo_teardown,
+  },
+};
+
+int
+main (int argc, char *argv[])
+{
+  Scene scene;
+  guint i;
+
+  benchmark_init (&argc, &argv);
+
+  scene_init (&scene);
+
+  for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+    benchmark_run (&benchmarks[i], &scene);
+
+  scene_clear (&scene);
+
+  return benchmark_finish ();
+}
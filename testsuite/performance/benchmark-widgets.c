@@ -0,0 +1,422 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Scrolling, restyling, text layout, builder instantiation
+ * and opening menus
+ */
+
+#include <gtk/gtk.h>
+
+#include "benchmark.h"
+
+#define N_ROWS 10000
+#define N_SCROLLS 100
+#define N_CHILDREN 500
+#define N_RESTYLES 20
+#define N_LINES 2000
+#define N_BUILDS 50
+#define N_MENU_SECTIONS 10
+#define N_MENU_ITEMS 30
+#define N_MENU_DEPTH 20
+#define N_MENU_OPENS 5
+
+static GtkWidget *
+create_window (GtkWidget *child)
+{
+  GtkWidget *window;
+
+  window = gtk_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (window), 600, 800);
+  gtk_window_set_child (GTK_WINDOW (window), child);
+  gtk_widget_show (window);
+
+  benchmark_wait_for_frame (window);
+
+  return window;
+}
+
+static void
+destroy_window (gpointer data)
+{
+  gtk_window_destroy (GTK_WINDOW (data));
+}
+
+/* List view scrolling */
+
+static void
+setup_label (GtkSignalListItemFactory *factory,
+             GtkListItem              *item)
+{
+  gtk_list_item_set_child (item, gtk_label_new (NULL));
+}
+
+static void
+bind_label (GtkSignalListItemFactory *factory,
+            GtkListItem              *item)
+{
+  GtkStringObject *string = gtk_list_item_get_item (item);
+
+  gtk_label_set_label (GTK_LABEL (gtk_list_item_get_child (item)),
+                       gtk_string_object_get_string (string));
+}
+
+static gpointer
+listview_setup (gpointer data)
+{
+  GtkStringList *strings;
+  GtkListItemFactory *factory;
+  GtkWidget *sw, *list;
+  guint i;
+
+  strings = gtk_string_list_new (NULL);
+  for (i = 0; i < N_ROWS; i++)
+    {
+      char *s = g_strdup_printf ("Row %u", i);
+      gtk_string_list_append (strings, s);
+      g_free (s);
+    }
+
+  factory = gtk_signal_list_item_factory_new ();
+  g_signal_connect (factory, "setup", G_CALLBACK (setup_label), NULL);
+  g_signal_connect (factory, "bind", G_CALLBACK (bind_label), NULL);
+
+  list = gtk_list_view_new_with_factory (G_LIST_MODEL (gtk_no_selection_new (G_LIST_MODEL (strings))), factory);
+  sw = gtk_scrolled_window_new ();
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), list);
+
+  return create_window (sw);
+}
+
+static void
+listview_run (gpointer data)
+{
+  GtkWidget *window = data;
+  GtkAdjustment *adjustment;
+  double upper, page;
+  guint i;
+
+  adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (gtk_window_get_child (GTK_WINDOW (window))));
+
+  for (i = 0; i < N_SCROLLS; i++)
+    {
+      upper = gtk_adjustment_get_upper (adjustment);
+      page = gtk_adjustment_get_page_size (adjustment);
+      gtk_adjustment_set_value (adjustment, (upper - page) * (i + 1) / N_SCROLLS);
+      benchmark_wait_for_frame (window);
+    }
+}
+
+/* CSS restyle */
+
+static gpointer
+css_setup (gpointer data)
+{
+  GtkWidget *box;
+  guint i;
+
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  for (i = 0; i < N_CHILDREN; i++)
+    {
+      GtkWidget *row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+
+      gtk_box_append (GTK_BOX (row), gtk_label_new ("Label"));
+      gtk_box_append (GTK_BOX (row), gtk_button_new_with_label ("Button"));
+      gtk_box_append (GTK_BOX (row), gtk_check_button_new ());
+      gtk_box_append (GTK_BOX (box), row);
+    }
+
+  return create_window (box);
+}
+
+static void
+css_run (gpointer data)
+{
+  GtkWidget *window = data;
+  guint i;
+
+  /* Toggling a class on the toplevel invalidates all descendants */
+  for (i = 0; i < N_RESTYLES; i++)
+    {
+      if (i % 2 == 0)
+        gtk_widget_add_css_class (window, "benchmark");
+      else
+        gtk_widget_remove_css_class (window, "benchmark");
+      benchmark_wait_for_frame (window);
+    }
+}
+
+/* Text insertion and layout */
+
+static gpointer
+textview_setup (gpointer data)
+{
+  GtkWidget *sw;
+
+  sw = gtk_scrolled_window_new ();
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (sw), gtk_text_view_new ());
+
+  return create_window (sw);
+}
+
+static void
+textview_run (gpointer data)
+{
+  GtkWidget *window = data;
+  GtkWidget *sw, *view;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  guint i;
+
+  sw = gtk_window_get_child (GTK_WINDOW (window));
+  view = gtk_scrolled_window_get_child (GTK_SCROLLED_WINDOW (sw));
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
+
+  for (i = 0; i < N_LINES; i++)
+    {
+      gtk_text_buffer_get_end_iter (buffer, &iter);
+      gtk_text_buffer_insert (buffer, &iter,
+                              "The quick brown fox jumps over the lazy dog, "
+                              "and then it does it again for good measure.\n", -1);
+    }
+
+  /* Validate the whole buffer, not just the visible part */
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (view), &iter, 0, FALSE, 0, 0);
+  benchmark_wait_for_frame (window);
+}
+
+/* Builder instantiation */
+
+static const char ui[] =
+"<interface>"
+"  <object class='GtkWindow'>"
+"    <property name='title'>Benchmark</property>"
+"    <child>"
+"      <object class='GtkGrid'>"
+"        <property name='row-spacing'>6</property>"
+"        <property name='column-spacing'>6</property>"
+"        <child>"
+"          <object class='GtkLabel'>"
+"            <property name='label'>Name</property>"
+"            <layout><property name='column'>0</property><property name='row'>0</property></layout>"
+"          </object>"
+"        </child>"
+"        <child>"
+"          <object class='GtkEntry'>"
+"            <layout><property name='column'>1</property><property name='row'>0</property></layout>"
+"          </object>"
+"        </child>"
+"        <child>"
+"          <object class='GtkLabel'>"
+"            <property name='label'>Count</property>"
+"            <layout><property name='column'>0</property><property name='row'>1</property></layout>"
+"          </object>"
+"        </child>"
+"        <child>"
+"          <object class='GtkSpinButton'>"
+"            <property name='adjustment'>"
+"              <object class='GtkAdjustment'>"
+"                <property name='upper'>100</property>"
+"                <property name='step-increment'>1</property>"
+"              </object>"
+"            </property>"
+"            <layout><property name='column'>1</property><property name='row'>1</property></layout>"
+"          </object>"
+"        </child>"
+"        <child>"
+"          <object class='GtkCheckButton'>"
+"            <property name='label'>Enabled</property>"
+"            <layout><property name='column'>1</property><property name='row'>2</property></layout>"
+"          </object>"
+"        </child>"
+"        <child>"
+"          <object class='GtkButton'>"
+"            <property name='label'>OK</property>"
+"            <layout><property name='column'>1</property><property name='row'>3</property></layout>"
+"          </object>"
+"        </child>"
+"      </object>"
+"    </child>"
+"  </object>"
+"</interface>";
+
+static void
+builder_run (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < N_BUILDS; i++)
+    {
+      GtkBuilder *builder = gtk_builder_new_from_string (ui, -1);
+      GSList *objects, *l;
+
+      objects = gtk_builder_get_objects (builder);
+      for (l = objects; l; l = l->next)
+        {
+          if (GTK_IS_WINDOW (l->data))
+            gtk_window_destroy (GTK_WINDOW (l->data));
+        }
+      g_slist_free (objects);
+      g_object_unref (builder);
+    }
+}
+
+/* Opening a large menu deep in a hierarchy */
+
+typedef struct {
+  GtkWidget *window;
+  GtkWidget *button;
+  GMenuModel *model;
+} MenuState;
+
+static void
+menu_activate (GSimpleAction *action,
+               GVariant      *parameter,
+               gpointer       data)
+{
+}
+
+static gpointer
+popovermenu_setup (gpointer data)
+{
+  MenuState *state = g_new0 (MenuState, 1);
+  GSimpleActionGroup *actions;
+  GtkWidget *parent, *box;
+  GMenu *menu;
+  guint i, j;
+
+  actions = g_simple_action_group_new ();
+  menu = g_menu_new ();
+
+  for (i = 0; i < N_MENU_SECTIONS; i++)
+    {
+      GMenu *section = g_menu_new ();
+
+      for (j = 0; j < N_MENU_ITEMS; j++)
+        {
+          char *name = g_strdup_printf ("action%u", i * N_MENU_ITEMS + j);
+          char *detailed = g_strconcat ("bench.", name, NULL);
+          char *label = g_strdup_printf ("Item %u", i * N_MENU_ITEMS + j);
+          GSimpleAction *action;
+
+          /* Mix in some check items */
+          if (j % 3 == 0)
+            action = g_simple_action_new_stateful (name, NULL, g_variant_new_boolean (j % 2));
+          else
+            action = g_simple_action_new (name, NULL);
+          g_signal_connect (action, "activate", G_CALLBACK (menu_activate), NULL);
+          g_action_map_add_action (G_ACTION_MAP (actions), G_ACTION (action));
+          g_object_unref (action);
+
+          g_menu_append (section, label, detailed);
+
+          g_free (label);
+          g_free (detailed);
+          g_free (name);
+        }
+
+      g_menu_append_section (menu, NULL, G_MENU_MODEL (section));
+      g_object_unref (section);
+    }
+
+  state->model = G_MENU_MODEL (menu);
+
+  box = parent = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  for (i = 0; i < N_MENU_DEPTH; i++)
+    {
+      GtkWidget *child = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+
+      gtk_box_append (GTK_BOX (parent), child);
+      parent = child;
+    }
+  state->button = gtk_button_new_with_label ("Menu");
+  gtk_box_append (GTK_BOX (parent), state->button);
+
+  state->window = create_window (box);
+  gtk_widget_insert_action_group (state->window, "bench", G_ACTION_GROUP (actions));
+  g_object_unref (actions);
+
+  return state;
+}
+
+static void
+popovermenu_run (gpointer data)
+{
+  MenuState *state = data;
+  guint i;
+
+  for (i = 0; i < N_MENU_OPENS; i++)
+    {
+      GtkWidget *popover;
+
+      popover = gtk_popover_menu_new_from_model (state->model);
+      gtk_widget_set_parent (popover, state->button);
+      gtk_popover_popup (GTK_POPOVER (popover));
+      benchmark_wait_for_frame (popover);
+      gtk_popover_popdown (GTK_POPOVER (popover));
+      gtk_widget_unparent (popover);
+    }
+}
+
+static void
+popovermenu_teardown (gpointer data)
+{
+  MenuState *state = data;
+
+  gtk_window_destroy (GTK_WINDOW (state->window));
+  g_object_unref (state->model);
+  g_free (state);
+}
+
+static const Benchmark benchmarks[] = {
+  {
+    .name = "listview-scroll",
+    .n_items = N_SCROLLS,
+    .needs_display = TRUE,
+    .setup = listview_setup,
+    .run = listview_run,
+    .teardown = destroy_window,
+  },
+  {
+    .name = "css-restyle",
+    .n_items = N_RESTYLES,
+    .needs_display = TRUE,
+    .setup = css_setup,
+    .run = css_run,
+    .teardown = destroy_window,
+  },
+  {
+    .name = "textview-insert-layout",
+    .n_items = N_LINES,
+    .needs_display = TRUE,
+    .setup = textview_setup,
+    .run = textview_run,
+    .teardown = destroy_window,
+  },
+  {
+    .name = "builder-instantiate",
+    .n_items = N_BUILDS,
+    .needs_display = TRUE,
+    .run = builder_run,
+  },
+  {
+    .name = "popovermenu-open",
+    .n_items = N_MENU_OPENS * N_MENU_SECTIONS * N_MENU_ITEMS,
+    .needs_display = TRUE,
+    .setup = popovermenu_setup,
+    .run = popovermenu_run,
+    .teardown = popovermenu_teardown,
+  },
+};
+
+int
+main (int argc, char *argv[])
+{
+  guint i;
+
+  benchmark_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+    benchmark_run (&benchmarks[i], NULL);
+
+  return benchmark_finish ();
+}
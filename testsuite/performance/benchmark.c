@@ -0,0 +1,170 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* A small harness for the benchmarks in this directory.
+ *
+ * Every benchmark is run once to warm up, and then timed for a
+ * number of runs. The results are printed to stdout as one JSON
+ * object per line, so they can be collected per commit:
+ *
+ *   {"benchmark":"sortlistmodel-sort","display":"Headless","runs":10,
+ *    "items":100000,"min_us":..., "median_us":..., "max_us":...,
+ *    "items_per_second":...}
+ *
+ * Benchmarks that need a display are skipped if none can be opened.
+ * Run them with GDK_BACKEND=headless, or with the headless test
+ * setup, to get results that don't depend on a display server.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+
+static int opt_runs = 10;
+static char *opt_filter = NULL;
+static gboolean have_display = FALSE;
+
+static GOptionEntry options[] = {
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &opt_runs, "Number of timed runs", "COUNT" },
+  { "filter", 'f', 0, G_OPTION_ARG_STRING, &opt_filter, "Only run benchmarks whose name contains TEXT", "TEXT" },
+  { NULL }
+};
+
+void
+benchmark_init (int    *argc,
+                char ***argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, argc, argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      exit (1);
+    }
+  g_option_context_free (context);
+
+  if (opt_runs < 1)
+    {
+      g_printerr ("The number of runs must be positive\n");
+      exit (1);
+    }
+
+  have_display = gtk_init_check ();
+}
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 ta = *(const gint64 *) a;
+  gint64 tb = *(const gint64 *) b;
+
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static const char *
+get_display_name (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+
+  return display ? G_OBJECT_TYPE_NAME (display) : "none";
+}
+
+static gint64
+run_once (const Benchmark *benchmark,
+          gpointer         data)
+{
+  gpointer state;
+  gint64 start, end;
+
+  state = benchmark->setup ? benchmark->setup (data) : data;
+
+  start = g_get_monotonic_time ();
+  benchmark->run (state);
+  end = g_get_monotonic_time ();
+
+  if (benchmark->teardown)
+    benchmark->teardown (state);
+
+  return end - start;
+}
+
+void
+benchmark_run (const Benchmark *benchmark,
+               gpointer         data)
+{
+  gint64 *times;
+  gint64 median;
+  int i;
+
+  if (opt_filter && strstr (benchmark->name, opt_filter) == NULL)
+    return;
+
+  if (benchmark->needs_display && !have_display)
+    {
+      g_print ("{\"benchmark\":\"%s\",\"skipped\":\"no display\"}\n", benchmark->name);
+      return;
+    }
+
+  /* Warm up caches, lazily created types and the like */
+  run_once (benchmark, data);
+
+  times = g_new (gint64, opt_runs);
+  for (i = 0; i < opt_runs; i++)
+    times[i] = run_once (benchmark, data);
+
+  qsort (times, opt_runs, sizeof (gint64), compare_times);
+  median = times[opt_runs / 2];
+
+  g_print ("{\"benchmark\":\"%s\",\"display\":\"%s\",\"runs\":%d,\"items\":%u,"
+           "\"min_us\":%" G_GINT64_FORMAT ",\"median_us\":%" G_GINT64_FORMAT ",\"max_us\":%" G_GINT64_FORMAT ","
+           "\"items_per_second\":%.1f}\n",
+           benchmark->name,
+           get_display_name (),
+           opt_runs,
+           benchmark->n_items,
+           times[0], median, times[opt_runs - 1],
+           median > 0 ? benchmark->n_items * (double) G_USEC_PER_SEC / median : 0.0);
+
+  g_free (times);
+}
+
+int
+benchmark_finish (void)
+{
+  g_clear_pointer (&opt_filter, g_free);
+
+  return 0;
+}
+
+static void
+after_paint (GdkFrameClock *clock,
+             gboolean      *done)
+{
+  *done = TRUE;
+}
+
+/* Waits until the frame clock of the widget's surface has
+ * run a frame that includes layout and paint.
+ */
+void
+benchmark_wait_for_frame (GtkWidget *widget)
+{
+  GdkFrameClock *clock;
+  gboolean done = FALSE;
+  gulong id;
+
+  clock = gtk_widget_get_frame_clock (widget);
+  g_assert (clock != NULL);
+
+  id = g_signal_connect (clock, "after-paint", G_CALLBACK (after_paint), &done);
+  gdk_frame_clock_request_phase (clock, GDK_FRAME_CLOCK_PHASE_LAYOUT | GDK_FRAME_CLOCK_PHASE_PAINT);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_signal_handler_disconnect (clock, id);
+}
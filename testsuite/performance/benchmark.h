@@ -0,0 +1,30 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <gtk/gtk.h>
+
+typedef struct _Benchmark Benchmark;
+
+struct _Benchmark
+{
+  const char *name;
+  /* How many items one run handles, for items per second */
+  guint n_items;
+  /* Whether the benchmark needs a display */
+  gboolean needs_display;
+
+  /* Not timed. Returns the state for run and teardown */
+  gpointer (* setup)    (gpointer data);
+  void     (* run)      (gpointer state);
+  void     (* teardown) (gpointer state);
+};
+
+void benchmark_init           (int              *argc,
+                               char           ***argv);
+void benchmark_run            (const Benchmark  *benchmark,
+                               gpointer          data);
+int  benchmark_finish         (void);
+
+void benchmark_wait_for_frame (GtkWidget        *widget);
+
+#endif /* __BENCHMARK_H__ */